@@ -0,0 +1,34 @@
+#version 450 core
+// Physically Based Rendering
+// Copyright (c) 2017-2018 Michał Siejak
+
+// Compares split-sum BRDF LUT with a high sample count reference (see IBLBenchmark).
+// One invocation per point of a regular grid over (cosLo, roughness) domain, both LUTs are sampled bilinearly at grid points
+// so LUTs of different sizes can be compared.
+
+#if VULKAN
+layout(set=0, binding=0) uniform sampler2D inputTexture;
+layout(set=0, binding=5) uniform sampler2D referenceTexture;
+layout(set=0, binding=6, std430) writeonly buffer Results
+{
+	vec2 values[];
+} results;
+#else
+layout(binding=0) uniform sampler2D inputTexture;
+layout(binding=1) uniform sampler2D referenceTexture;
+layout(binding=0, std430) writeonly buffer Results
+{
+	vec2 values[];
+} results;
+#endif // VULKAN
+
+layout(local_size_x=8, local_size_y=8, local_size_z=1) in;
+void main(void)
+{
+	uvec2 gridSize = gl_NumWorkGroups.xy * gl_WorkGroupSize.xy;
+	vec2 uv = (vec2(gl_GlobalInvocationID.xy) + 0.5) / vec2(gridSize);
+
+	vec2 value = textureLod(inputTexture, uv, 0).rg;
+	vec2 reference = textureLod(referenceTexture, uv, 0).rg;
+	results.values[gl_GlobalInvocationID.y * gridSize.x + gl_GlobalInvocationID.x] = vec2(abs(value.x - reference.x) + abs(value.y - reference.y), reference.x + reference.y);
+}
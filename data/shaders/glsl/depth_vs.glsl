@@ -0,0 +1,26 @@
+#version 450 core
+// Physically Based Rendering
+// Copyright (c) 2017-2018 Michał Siejak
+
+// Depth pre-pass: Vertex program (reads position-only vertex stream, no fragment program).
+// Position must be computed exactly as in pbr_vs so that the main pass can shade with an equal depth test.
+
+#if VULKAN
+layout(set=0, binding=0) uniform TransformUniforms
+#else
+layout(std140, binding=0) uniform TransformUniforms
+#endif // VULKAN
+{
+	mat4 viewProjectionMatrix;
+	mat4 skyProjectionMatrix;
+	mat4 sceneRotationMatrix;
+};
+
+layout(location=0) in vec3 position;
+
+invariant gl_Position;
+
+void main()
+{
+	gl_Position = viewProjectionMatrix * sceneRotationMatrix * vec4(position, 1.0);
+}
@@ -0,0 +1,26 @@
+#version 450 core
+// Physically Based Rendering
+// Copyright (c) 2017-2018 Michał Siejak
+
+// Resolves multisampled scene depth for temporal anti-aliasing (Vulkan only, OpenGL blits depth instead):
+// closest depth of all samples of each pixel is written into a single sampled texture read by taa_cs.
+
+layout(set=0, binding=0) uniform sampler2DMS sceneDepth;
+layout(set=0, binding=1, r32f) restrict writeonly uniform image2D outputDepth;
+
+layout(local_size_x=8, local_size_y=8, local_size_z=1) in;
+void main(void)
+{
+	ivec2 size = imageSize(outputDepth);
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	if(any(greaterThanEqual(pixel, size))) {
+		return;
+	}
+
+	float depth = 1.0;
+	int numSamples = textureSamples(sceneDepth);
+	for(int i=0; i<numSamples; ++i) {
+		depth = min(depth, texelFetch(sceneDepth, pixel, i).r);
+	}
+	imageStore(outputDepth, pixel, vec4(depth));
+}
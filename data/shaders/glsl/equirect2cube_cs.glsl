@@ -36,7 +36,15 @@ vec3 getSamplingVector()
     return normalize(ret);
 }
 
+// Thread group size is chosen at startup (see WorkgroupTuner): a specialization constant in Vulkan and an optional
+// preprocessor definition in OpenGL.
+#if VULKAN
+layout(local_size_x_id=0, local_size_y_id=1, local_size_z=1) in;
+#elif defined(WORKGROUP_SIZE)
+layout(local_size_x=WORKGROUP_SIZE, local_size_y=WORKGROUP_SIZE, local_size_z=1) in;
+#else
 layout(local_size_x=32, local_size_y=32, local_size_z=1) in;
+#endif
 void main(void)
 {
 	vec3 v = getSamplingVector();
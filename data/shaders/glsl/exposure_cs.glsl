@@ -0,0 +1,68 @@
+#version 450 core
+// Physically Based Rendering
+// Copyright (c) 2017-2018 Michał Siejak
+
+// Average luminance of the histogram built by histogram_cs (see AutoExposure class), adapted over time & converted to exposure
+// read by tone mapping. Runs as a single thread group (one thread per bin), which also clears the histogram for next frame.
+
+const uint NumBins = 256;
+
+#if VULKAN
+layout(push_constant) uniform ExposureParameters
+#else
+layout(std140, binding=2) uniform ExposureParameters
+#endif // VULKAN
+{
+	vec4 histogramRange;
+	vec4 adaptation;
+	uvec4 region;
+};
+
+#if VULKAN
+layout(set=0, binding=1, std430) restrict buffer Histogram
+#else
+layout(binding=0, std430) restrict buffer Histogram
+#endif // VULKAN
+{
+	uint bins[NumBins];
+};
+
+#if VULKAN
+layout(set=0, binding=2, std430) restrict buffer Exposure
+#else
+layout(binding=1, std430) restrict buffer Exposure
+#endif // VULKAN
+{
+	float averageLuminance; // Adapted (zero until first frame)
+	float exposure;
+};
+
+shared float weightedCounts[NumBins];
+
+layout(local_size_x=256, local_size_y=1, local_size_z=1) in;
+void main(void)
+{
+	uint index = gl_LocalInvocationIndex;
+	uint count = bins[index];
+	weightedCounts[index] = float(count) * float(index);
+	bins[index] = 0;
+	barrier();
+
+	for(uint stride=NumBins/2; stride > 0; stride >>= 1) {
+		if(index < stride) {
+			weightedCounts[index] += weightedCounts[index + stride];
+		}
+		barrier();
+	}
+
+	if(index == 0) {
+		// Mean bin of pixels which are not black (those counted in bin 0 by this thread), mapped back to log2 luminance.
+		float numPixels = max(float(region.z) - float(count), 1.0);
+		float meanBin = max(weightedCounts[0] / numPixels - 1.0, 0.0);
+		float luminance = exp2(meanBin / float(NumBins - 2) * histogramRange.z + histogramRange.x);
+
+		float adaptedLuminance = (averageLuminance > 0.0) ? mix(averageLuminance, luminance, adaptation.x) : luminance;
+		averageLuminance = adaptedLuminance;
+		exposure = adaptation.y / adaptedLuminance;
+	}
+}
@@ -0,0 +1,61 @@
+#version 450 core
+// Physically Based Rendering
+// Copyright (c) 2017-2018 Michał Siejak
+
+// Log2 luminance histogram of the resolved scene (see AutoExposure class): each thread group bins its pixels in shared memory
+// & adds non-empty bins to the global histogram. Bin 0 counts (nearly) black pixels, bins 1 to 255 span the luminance range.
+
+const uint NumBins = 256;
+const float MinLuminance = 0.0001;
+
+#if VULKAN
+layout(push_constant) uniform ExposureParameters
+#else
+layout(std140, binding=2) uniform ExposureParameters
+#endif // VULKAN
+{
+	vec4 histogramRange;
+	vec4 adaptation;
+	uvec4 region;
+};
+
+#if VULKAN
+layout(set=0, binding=0) uniform sampler2D sceneColor;
+layout(set=0, binding=1, std430) restrict buffer Histogram
+#else
+layout(binding=0) uniform sampler2D sceneColor;
+layout(binding=0, std430) restrict buffer Histogram
+#endif // VULKAN
+{
+	uint bins[NumBins];
+};
+
+shared uint localBins[NumBins];
+
+uint luminanceBin(vec3 color)
+{
+	float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+	if(luminance < MinLuminance) {
+		return 0;
+	}
+	float t = clamp((log2(luminance) - histogramRange.x) * histogramRange.y, 0.0, 1.0);
+	return uint(t * float(NumBins - 2) + 1.0);
+}
+
+layout(local_size_x=16, local_size_y=16, local_size_z=1) in;
+void main(void)
+{
+	localBins[gl_LocalInvocationIndex] = 0;
+	barrier();
+
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	if(all(lessThan(pixel, ivec2(region.xy)))) {
+		atomicAdd(localBins[luminanceBin(texelFetch(sceneColor, pixel, 0).rgb)], 1);
+	}
+	barrier();
+
+	uint count = localBins[gl_LocalInvocationIndex];
+	if(count > 0) {
+		atomicAdd(bins[gl_LocalInvocationIndex], count);
+	}
+}
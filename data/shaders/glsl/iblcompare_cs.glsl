@@ -0,0 +1,49 @@
+#version 450 core
+// Physically Based Rendering
+// Copyright (c) 2017-2018 Michał Siejak
+
+// Compares pre-filtered environment cube map (specular or irradiance) with a high sample count reference (see IBLBenchmark).
+// One invocation per direction (spherical Fibonacci set) & roughness step (Y thread group index). Both maps are sampled the way
+// the PBR shader samples them (LOD proportional to roughness & number of levels) so maps of different sizes can be compared.
+
+// Must match IBLBenchmark::NumErrorDirections.
+const uint NumErrorDirections = 4096;
+
+#if VULKAN
+layout(set=0, binding=0) uniform samplerCube inputTexture;
+layout(set=0, binding=5) uniform samplerCube referenceTexture;
+layout(set=0, binding=6, std430) writeonly buffer Results
+{
+	vec2 values[];
+} results;
+#else
+layout(binding=0) uniform samplerCube inputTexture;
+layout(binding=1) uniform samplerCube referenceTexture;
+layout(binding=0, std430) writeonly buffer Results
+{
+	vec2 values[];
+} results;
+#endif // VULKAN
+
+float luminance(vec3 color)
+{
+	return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main(void)
+{
+	uint index = gl_GlobalInvocationID.x;
+	uint step = gl_WorkGroupID.y;
+	float roughness = (gl_NumWorkGroups.y > 1) ? float(step) / float(gl_NumWorkGroups.y - 1) : 0.0;
+
+	// Spherical Fibonacci point set.
+	float z = 1.0 - (2.0 * float(index) + 1.0) / float(NumErrorDirections);
+	float phi = float(index) * 2.399963;
+	float r = sqrt(max(1.0 - z*z, 0.0));
+	vec3 v = vec3(r * cos(phi), r * sin(phi), z);
+
+	vec3 value = textureLod(inputTexture, v, roughness * textureQueryLevels(inputTexture)).rgb;
+	vec3 reference = textureLod(referenceTexture, v, roughness * textureQueryLevels(referenceTexture)).rgb;
+	results.values[step * NumErrorDirections + index] = vec2(luminance(abs(value - reference)), luminance(reference));
+}
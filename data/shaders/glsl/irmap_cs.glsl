@@ -3,21 +3,86 @@
 // Copyright (c) 2017-2018 Michał Siejak
 
 // Computes diffuse irradiance cubemap convolution for image-based lighting.
-// Uses quasi Monte Carlo sampling with Hammersley sequence.
+// Uses quasi Monte Carlo sampling with Hammersley sequence, optionally combined with environment importance sampling.
 
 const float PI = 3.141592;
 const float TwoPI = 2 * PI;
 const float Epsilon = 0.00001;
 
-const uint NumSamples = 64 * 1024;
-const float InvNumSamples = 1.0 / float(NumSamples);
+// Alias table entry of environment radiance distribution (see EnvironmentDistribution).
+struct AliasTableEntry
+{
+	float threshold;
+	uint alias;
+	float pdf;
+};
 
+// Sample count & sampling strategy are specialization constants in Vulkan and preprocessor definitions in OpenGL.
+// With environment importance sampling NumSamples is the number of sample pairs (one from each strategy).
 #if VULKAN
+layout(constant_id=0) const uint NumSamples = 64 * 1024;
+layout(constant_id=1) const bool EnvImportanceSampling = false;
 layout(set=0, binding=0) uniform samplerCube inputTexture;
-layout(set=0, binding=1, rgba16f) restrict writeonly uniform imageCube outputTexture;
+layout(set=0, binding=1, rgba16f) restrict uniform imageCube outputTexture;
+layout(set=0, binding=4, std430) readonly buffer EnvironmentDistribution
+{
+	uint width;
+	uint height;
+	AliasTableEntry entries[];
+} distribution;
+#else
+#if defined(NUM_SAMPLES)
+const uint NumSamples = NUM_SAMPLES;
+#else
+const uint NumSamples = 64 * 1024;
+#endif
+#if defined(ENV_IMPORTANCE_SAMPLING)
+const bool EnvImportanceSampling = true;
 #else
+const bool EnvImportanceSampling = false;
+#endif
 layout(binding=0) uniform samplerCube inputTexture;
-layout(binding=0, rgba16f) restrict writeonly uniform imageCube outputTexture;
+layout(binding=0, rgba16f) restrict uniform imageCube outputTexture;
+layout(binding=1, std430) readonly buffer EnvironmentDistribution
+{
+	uint width;
+	uint height;
+	AliasTableEntry entries[];
+} distribution;
+#endif // VULKAN
+
+// Integration can be split into interleaved batches of samples (batch, batch+numBatches, batch+2*numBatches, ...)
+// executed by separate dispatches. Each batch is blended into the output as a running average, so after all batches
+// have been processed the output is identical to single pass integration.
+#if VULKAN
+layout(push_constant) uniform PushConstants
+{
+	// First output cubemap face.
+	uint face;
+	// Sample batch to process & total number of batches.
+	uint batch;
+	uint numBatches;
+	// Input texture LOD to sample from (non-zero when using lower sample counts).
+	float sourceLod;
+} pushConstants;
+
+#define PARAM_FACE        pushConstants.face
+#define PARAM_BATCH       pushConstants.batch
+#define PARAM_NUM_BATCHES max(pushConstants.numBatches, 1)
+#define PARAM_SOURCE_LOD  pushConstants.sourceLod
+#else
+// First output cubemap face.
+layout(location=0) uniform uint face;
+// Sample batch to process & total number of batches.
+layout(location=1) uniform uint batch;
+layout(location=2) uniform uint numBatches;
+// Input texture LOD to sample from (non-zero when using lower sample counts).
+layout(location=3) uniform float sourceLod;
+
+#define PARAM_FACE        face
+#define PARAM_BATCH       batch
+#define PARAM_NUM_BATCHES max(numBatches, 1)
+#define PARAM_SOURCE_LOD  sourceLod
 #endif // VULKAN
 
 // Compute Van der Corput radical inverse
@@ -32,10 +97,21 @@ float radicalInverse_VdC(uint bits)
 	return float(bits) * 2.3283064365386963e-10; // / 0x100000000
 }
 
+// Radical inverse in given (prime) base: further dimensions of Halton/Hammersley point set.
+float radicalInverse(uint i, uint base)
+{
+	float result = 0.0;
+	float invBase = 1.0 / float(base);
+	for(float f = invBase; i > 0; i /= base, f *= invBase) {
+		result += f * float(i % base);
+	}
+	return result;
+}
+
 // Sample i-th point from Hammersley point set of NumSamples points total.
 vec2 sampleHammersley(uint i)
 {
-	return vec2(i * InvNumSamples, radicalInverse_VdC(i));
+	return vec2(i / float(NumSamples), radicalInverse_VdC(i));
 }
 
 // Uniformly sample point on a hemisphere.
@@ -48,23 +124,64 @@ vec3 sampleHemisphere(float u1, float u2)
 	return vec3(cos(TwoPI*u2) * u1p, sin(TwoPI*u2) * u1p, u1);
 }
 
-// Calculate normalized sampling direction vector based on current fragment coordinates (gl_GlobalInvocationID.xyz).
+// Sample hemisphere with cosine weighted density (pdf = cos(theta) / PI).
+vec3 sampleCosineHemisphere(float u1, float u2)
+{
+	const float r = sqrt(u1);
+	return vec3(cos(TwoPI*u2) * r, sin(TwoPI*u2) * r, sqrt(max(0.0, 1.0 - u1)));
+}
+
+// Pick environment map cell using alias table & sample direction uniformly within it (equal area in phi & cos(theta)).
+// Directions follow equirectangular mapping used by equirect2cube_cs shader. Fractional part of u.x scaled by cell count
+// is the alias threshold test, so u.x must not be a lattice coordinate i/N (with N a divisor of the cell count the
+// fraction would always be zero and only every (cells/N)-th cell could ever be picked).
+vec3 sampleEnvironment(vec3 u, out float pdf)
+{
+	uint numCells = distribution.width * distribution.height;
+	float x = u.x * float(numCells);
+	uint cell = min(uint(x), numCells - 1);
+	if(x - float(cell) >= distribution.entries[cell].threshold) {
+		cell = distribution.entries[cell].alias;
+	}
+	pdf = distribution.entries[cell].pdf;
+
+	uint column = cell % distribution.width;
+	uint row = cell / distribution.width;
+	float phi = TwoPI * (float(column) + u.y) / float(distribution.width);
+	float cosTheta = mix(cos(PI * float(row) / float(distribution.height)), cos(PI * float(row + 1) / float(distribution.height)), u.z);
+	float sinTheta = sqrt(max(0.0, 1.0 - cosTheta*cosTheta));
+	return vec3(sinTheta * cos(phi), cosTheta, sinTheta * sin(phi));
+}
+
+// Density of environment importance sampling for given direction.
+float environmentPdf(vec3 v)
+{
+	float phi = atan(v.z, v.x);
+	phi = (phi < 0.0) ? phi + TwoPI : phi;
+	float theta = acos(clamp(v.y, -1.0, 1.0));
+
+	uint column = min(uint(phi / TwoPI * float(distribution.width)), distribution.width - 1);
+	uint row = min(uint(theta / PI * float(distribution.height)), distribution.height - 1);
+	return distribution.entries[row * distribution.width + column].pdf;
+}
+
+// Calculate normalized sampling direction vector based on current fragment coordinates (id.xyz).
 // This is essentially "inverse-sampling": we reconstruct what the sampling vector would be if we wanted it to "hit"
 // this particular fragment in a cubemap.
 // See: OpenGL core profile specs, section 8.13.
-vec3 getSamplingVector()
+vec3 getSamplingVector(uvec3 id)
 {
-    vec2 st = gl_GlobalInvocationID.xy/vec2(imageSize(outputTexture));
+    vec2 st = id.xy/vec2(imageSize(outputTexture));
     vec2 uv = 2.0 * vec2(st.x, 1.0-st.y) - vec2(1.0);
 
     vec3 ret;
     // Sadly 'switch' doesn't seem to work, at least on NVIDIA.
-    if(gl_GlobalInvocationID.z == 0)      ret = vec3(1.0,  uv.y, -uv.x);
-    else if(gl_GlobalInvocationID.z == 1) ret = vec3(-1.0, uv.y,  uv.x);
-    else if(gl_GlobalInvocationID.z == 2) ret = vec3(uv.x, 1.0, -uv.y);
-    else if(gl_GlobalInvocationID.z == 3) ret = vec3(uv.x, -1.0, uv.y);
-    else if(gl_GlobalInvocationID.z == 4) ret = vec3(uv.x, uv.y, 1.0);
-    else if(gl_GlobalInvocationID.z == 5) ret = vec3(-uv.x, uv.y, -1.0);
+    if(id.z == 0)      ret = vec3(1.0,  uv.y, -uv.x);
+    else if(id.z == 1) ret = vec3(-1.0, uv.y,  uv.x);
+    else if(id.z == 2) ret = vec3(uv.x, 1.0, -uv.y);
+    else if(id.z == 3) ret = vec3(uv.x, -1.0, uv.y);
+    else if(id.z == 4) ret = vec3(uv.x, uv.y, 1.0);
+    else if(id.z == 5) ret = vec3(-uv.x, uv.y, -1.0);
     return normalize(ret);
 }
 
@@ -85,11 +202,20 @@ vec3 tangentToWorld(const vec3 v, const vec3 N, const vec3 S, const vec3 T)
 	return S * v.x + T * v.y + N * v.z;
 }
 
+// Thread group size is chosen at startup (see WorkgroupTuner): a specialization constant in Vulkan and an optional
+// preprocessor definition in OpenGL.
+#if VULKAN
+layout(local_size_x_id=2, local_size_y_id=3, local_size_z=1) in;
+#elif defined(WORKGROUP_SIZE)
+layout(local_size_x=WORKGROUP_SIZE, local_size_y=WORKGROUP_SIZE, local_size_z=1) in;
+#else
 layout(local_size_x=32, local_size_y=32, local_size_z=1) in;
+#endif
 void main(void)
 {
-	vec3 N = getSamplingVector();
-	
+	uvec3 id = gl_GlobalInvocationID + uvec3(0, 0, PARAM_FACE);
+	vec3 N = getSamplingVector(id);
+
 	vec3 S, T;
 	computeBasisVectors(N, S, T);
 
@@ -97,15 +223,48 @@ void main(void)
 	// As a small optimization this also includes Lambertian BRDF assuming perfectly white surface (albedo of 1.0)
 	// so we don't need to normalize in PBR fragment shader (so technically it encodes exitant radiance rather than irradiance).
 	vec3 irradiance = vec3(0);
-	for(uint i=0; i<NumSamples; ++i) {
-		vec2 u  = sampleHammersley(i);
-		vec3 Li = tangentToWorld(sampleHemisphere(u.x, u.y), N, S, T);
-		float cosTheta = max(0.0, dot(Li, N));
+	uint numBatchSamples = 0;
+	if(EnvImportanceSampling) {
+		// Multiple importance sampling of cosine lobe & environment radiance distribution (one sample from each strategy
+		// per iteration, balance heuristic). Handles both bright compact light sources and smooth skies with few samples.
+		for(uint i=PARAM_BATCH; i<NumSamples; i+=PARAM_NUM_BATCHES) {
+			vec2 u = sampleHammersley(i);
+
+			vec3 Lc = tangentToWorld(sampleCosineHemisphere(u.x, u.y), N, S, T);
+			float cosThetaC = max(0.0, dot(Lc, N));
+			if(cosThetaC > 0.0) {
+				float pdfC = cosThetaC / PI;
+				irradiance += textureLod(inputTexture, Lc, PARAM_SOURCE_LOD).rgb * (cosThetaC / PI) / (pdfC + environmentPdf(Lc));
+			}
+
+			// Cell is picked by an independent base 5 dimension, position within the cell by the remaining two.
+			float pdfE;
+			vec3 Le = sampleEnvironment(vec3(radicalInverse(i, 5), u.y, radicalInverse(i, 3)), pdfE);
+			float cosThetaE = dot(Le, N);
+			if(cosThetaE > 0.0) {
+				irradiance += textureLod(inputTexture, Le, PARAM_SOURCE_LOD).rgb * (cosThetaE / PI) / (cosThetaE / PI + pdfE);
+			}
+			++numBatchSamples;
+		}
+	}
+	else {
+		for(uint i=PARAM_BATCH; i<NumSamples; i+=PARAM_NUM_BATCHES) {
+			vec2 u  = sampleHammersley(i);
+			vec3 Li = tangentToWorld(sampleHemisphere(u.x, u.y), N, S, T);
+			float cosTheta = max(0.0, dot(Li, N));
+
+			// PIs here cancel out because of division by pdf.
+			irradiance += 2.0 * textureLod(inputTexture, Li, PARAM_SOURCE_LOD).rgb * cosTheta;
+			++numBatchSamples;
+		}
+	}
+	irradiance /= vec3(numBatchSamples);
 
-		// PIs here cancel out because of division by pdf.
-		irradiance += 2.0 * textureLod(inputTexture, Li, 0).rgb * cosTheta;
+	// Blend with results of previous batches (all batches have equal sample counts).
+	if(PARAM_BATCH > 0) {
+		vec3 previous = imageLoad(outputTexture, ivec3(id)).rgb;
+		irradiance = mix(previous, irradiance, 1.0 / float(PARAM_BATCH + 1));
 	}
-	irradiance /= vec3(NumSamples);
 
-	imageStore(outputTexture, ivec3(gl_GlobalInvocationID), vec4(irradiance, 1.0));
+	imageStore(outputTexture, ivec3(id), vec4(irradiance, 1.0));
 }
@@ -0,0 +1,74 @@
+#version 450 core
+// Physically Based Rendering
+// Copyright (c) 2017-2018 Michał Siejak
+
+// Converts pre-filtered specular environment cube map into octahedral atlas (see OctahedralAtlas class for its layout).
+// Each atlas level is resampled from the matching cube map mip level, including its one texel wrap-around gutter.
+
+#if VULKAN
+layout(set=0, binding=0) uniform samplerCube inputTexture;
+layout(set=0, binding=1, rgba16f) restrict writeonly uniform image2D outputTexture;
+#else
+layout(binding=0) uniform samplerCube inputTexture;
+layout(binding=0, rgba16f) restrict writeonly uniform image2D outputTexture;
+#endif // VULKAN
+
+// Sign function which never returns zero (keeps octahedral folding well defined on the axes).
+vec2 signNotZero(vec2 v)
+{
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Direction for point on octahedral map in [-1,1]^2 (lower hemisphere is folded over square diagonals).
+vec3 octDecode(vec2 e)
+{
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if(v.z < 0.0) {
+		v.xy = (1.0 - abs(v.yx)) * signNotZero(v.xy);
+	}
+	return normalize(v);
+}
+
+layout(local_size_x=32, local_size_y=32, local_size_z=1) in;
+void main(void)
+{
+	ivec2 atlasSize = imageSize(outputTexture);
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	int size = atlasSize.y;
+	int numLevels = textureQueryLevels(inputTexture) - 1;
+
+	// Find level region containing this texel: level 0 is on the left, levels 1+ stacked top to bottom on the right.
+	int level = -1;
+	ivec2 origin = ivec2(0);
+	if(texel.x < size) {
+		level = 0;
+	}
+	else {
+		for(int i=1; i<numLevels; ++i) {
+			ivec2 levelOrigin = ivec2(size, size - (size >> (i-1)));
+			if(texel.y >= levelOrigin.y && texel.y < levelOrigin.y + (size >> i)) {
+				level = i;
+				origin = levelOrigin;
+				break;
+			}
+		}
+	}
+	int levelSize = size >> max(level, 0);
+	if(level < 0 || texel.x >= origin.x + levelSize) {
+		return;
+	}
+
+	// Map texel center to octahedral coordinates (interior texels span [-1,1], gutter texels fall just outside).
+	vec2 e = 2.0 * (vec2(texel - origin) - 0.5) / float(levelSize - 2) - 1.0;
+
+	// Wrap gutter texels: octahedral map is mirrored across each edge (and all four corners meet at the same direction).
+	if(abs(e.x) > 1.0) {
+		e = vec2(sign(e.x) * 2.0 - e.x, -e.y);
+	}
+	if(abs(e.y) > 1.0) {
+		e = vec2(-e.x, sign(e.y) * 2.0 - e.y);
+	}
+
+	vec4 color = textureLod(inputTexture, octDecode(e), level);
+	imageStore(outputTexture, texel, color);
+}
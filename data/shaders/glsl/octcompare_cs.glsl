@@ -0,0 +1,128 @@
+#version 450 core
+// Physically Based Rendering
+// Copyright (c) 2017-2018 Michał Siejak
+
+// Compares octahedral atlas with the pre-filtered cube map it has been converted from.
+// Mode 0 measures error: one invocation per direction (spherical Fibonacci set) & atlas level (Y thread group index).
+// Modes 1 & 2 measure sampling cost of cube map & atlas respectively: each invocation takes a number of trilinear lookups
+// with pseudo-random directions & LODs (result is written out only under a never satisfied condition to keep lookups alive).
+
+const float PI = 3.141592;
+
+// Must match OctahedralAtlas::NumErrorDirections & NumCostSamplesPerInvocation.
+const uint NumErrorDirections = 4096;
+const uint NumCostSamples = 16;
+
+#if VULKAN
+layout(set=0, binding=0) uniform samplerCube cubeTexture;
+layout(set=0, binding=2) uniform sampler2D atlasTexture;
+layout(set=0, binding=3, std430) writeonly buffer Results
+{
+	vec4 values[];
+} results;
+layout(push_constant) uniform PushConstants
+{
+	uint mode;
+} pushConstants;
+#define MODE pushConstants.mode
+#else
+layout(binding=0) uniform samplerCube cubeTexture;
+layout(binding=1) uniform sampler2D atlasTexture;
+layout(binding=0, std430) writeonly buffer Results
+{
+	vec4 values[];
+} results;
+layout(location=0) uniform uint mode;
+#define MODE mode
+#endif // VULKAN
+
+vec2 signNotZero(vec2 v)
+{
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Point on octahedral map in [-1,1]^2 for given unit direction.
+vec2 octEncode(vec3 v)
+{
+	v /= abs(v.x) + abs(v.y) + abs(v.z);
+	vec2 e = v.xy;
+	if(v.z < 0.0) {
+		e = (1.0 - abs(v.yx)) * signNotZero(v.xy);
+	}
+	return e;
+}
+
+// Bilinear lookup within single atlas level region (texel coordinates are kept inside its gutter).
+vec3 sampleAtlasLevel(vec2 e, int level)
+{
+	ivec2 atlasSize = textureSize(atlasTexture, 0);
+	int levelSize = atlasSize.y >> level;
+	vec2 origin = (level == 0) ? vec2(0.0) : vec2(atlasSize.y, atlasSize.y - (atlasSize.y >> (level-1)));
+	vec2 texel = origin + 1.0 + (0.5 * e + 0.5) * float(levelSize - 2);
+	return textureLod(atlasTexture, texel / vec2(atlasSize), 0).rgb;
+}
+
+// Trilinear lookup of octahedral atlas (LOD is clamped to its last level).
+vec3 sampleAtlas(vec3 v, float lod)
+{
+	int numLevels = findMSB(textureSize(atlasTexture, 0).y) - 1;
+	lod = clamp(lod, 0.0, float(numLevels - 1));
+	int level0 = int(lod);
+	int level1 = min(level0 + 1, numLevels - 1);
+	vec2 e = octEncode(v);
+	return mix(sampleAtlasLevel(e, level0), sampleAtlasLevel(e, level1), lod - float(level0));
+}
+
+// Hash-based pseudo-random number in [0,1).
+float random(inout uint state)
+{
+	state = state * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return float((word >> 22u) ^ word) / 4294967296.0;
+}
+
+vec3 randomDirection(inout uint state)
+{
+	float z = 2.0 * random(state) - 1.0;
+	float phi = 2.0 * PI * random(state);
+	float r = sqrt(max(1.0 - z*z, 0.0));
+	return vec3(r * cos(phi), r * sin(phi), z);
+}
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main(void)
+{
+	if(MODE == 0) {
+		uint index = gl_GlobalInvocationID.x;
+		int level = int(gl_WorkGroupID.y);
+
+		// Spherical Fibonacci point set.
+		float z = 1.0 - (2.0 * float(index) + 1.0) / float(NumErrorDirections);
+		float phi = float(index) * 2.399963;
+		float r = sqrt(max(1.0 - z*z, 0.0));
+		vec3 v = vec3(r * cos(phi), r * sin(phi), z);
+
+		vec3 reference = textureLod(cubeTexture, v, level).rgb;
+		vec3 value = sampleAtlas(v, level);
+		float luminance = dot(reference, vec3(0.2126, 0.7152, 0.0722));
+		results.values[level * NumErrorDirections + index] = vec4(abs(value - reference), luminance);
+	}
+	else {
+		int numLevels = findMSB(textureSize(atlasTexture, 0).y) - 1;
+		uint state = gl_GlobalInvocationID.x;
+		vec3 sum = vec3(0.0);
+		for(uint i=0; i<NumCostSamples; ++i) {
+			vec3 v = randomDirection(state);
+			float lod = random(state) * float(numLevels - 1);
+			if(MODE == 1) {
+				sum += textureLod(cubeTexture, v, lod).rgb;
+			}
+			else {
+				sum += sampleAtlas(v, lod);
+			}
+		}
+		if(sum.r == -1.0) {
+			results.values[0] = vec4(sum, 0.0);
+		}
+	}
+}
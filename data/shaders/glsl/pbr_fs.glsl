@@ -2,6 +2,16 @@
 // Physically Based Rendering
 // Copyright (c) 2017-2018 Michał Siejak
 
+// Half precision variant (see PBRPermutation::Feature_HalfPrecision): built as a separate SPIR-V module in Vulkan, since
+// float16 arithmetic is a capability of the module (and device feature) rather than something a specialization constant can toggle.
+#if defined(HALF_PRECISION)
+#if VULKAN
+#extension GL_EXT_shader_explicit_arithmetic_types_float16 : require
+#else
+#extension GL_AMD_gpu_shader_half_float : require
+#endif
+#endif
+
 // Physically Based shading model: Lambetrtian diffuse BRDF + Cook-Torrance microfacet specular BRDF + IBL for ambient.
 
 // This implementation is based on "Real Shading in Unreal Engine 4" SIGGRAPH 2013 course notes by Epic Games.
@@ -11,15 +21,100 @@ const float PI = 3.141592;
 const float Epsilon = 0.00001;
 
 const int NumLights = 3;
+const int MaxProbes = 8;
+// Must match IrradianceVolume::NumTextureSlabs.
+const int NumVolumeTextureSlabs = 7;
+// Must match ClusteredLights::TileSize.
+const uint ClusterTileSize = 64;
+// Must match ShadowCascades::NumCascades.
+const int NumShadowCascades = 3;
+
+// Shader permutation (see PBRPermutation class): features left out of a variant are never evaluated nor sampled.
+// Sample current pre-filtered specular environment from octahedral atlas instead of cube map (see OctahedralAtlas class).
+#if VULKAN
+layout(constant_id=0) const bool OctahedralAtlas = false;
+#elif defined(OCTAHEDRAL_ATLAS)
+const bool OctahedralAtlas = true;
+#else
+const bool OctahedralAtlas = false;
+#endif
+// Shadows of analytical lights.
+#if VULKAN
+layout(constant_id=1) const bool ShadowMapping = false;
+#elif defined(SHADOW_MAPPING)
+const bool ShadowMapping = true;
+#else
+const bool ShadowMapping = false;
+#endif
+// Clustered dynamic lights.
+#if VULKAN
+layout(constant_id=2) const bool DynamicLighting = false;
+#elif defined(DYNAMIC_LIGHTING)
+const bool DynamicLighting = true;
+#else
+const bool DynamicLighting = false;
+#endif
+// Reflection probes.
+#if VULKAN
+layout(constant_id=3) const bool ReflectionProbes = false;
+#elif defined(REFLECTION_PROBES)
+const bool ReflectionProbes = true;
+#else
+const bool ReflectionProbes = false;
+#endif
+// Spherical harmonics irradiance from the volume instead of the irradiance cube map within its bounds.
+#if VULKAN
+layout(constant_id=4) const bool IrradianceVolume = false;
+#elif defined(IRRADIANCE_VOLUME)
+const bool IrradianceVolume = true;
+#else
+const bool IrradianceVolume = false;
+#endif
+// Blending with previous environment after a switch.
+#if VULKAN
+layout(constant_id=5) const bool EnvironmentBlending = false;
+#elif defined(ENVIRONMENT_BLENDING)
+const bool EnvironmentBlending = true;
+#else
+const bool EnvironmentBlending = false;
+#endif
+// Analytical approximation of split-sum specular BRDF instead of the LUT.
+#if VULKAN
+layout(constant_id=6) const bool AnalyticBRDF = false;
+#elif defined(ANALYTIC_BRDF)
+const bool AnalyticBRDF = true;
+#else
+const bool AnalyticBRDF = false;
+#endif
+
+// BRDF factors bounded to [0,1] (material inputs, Fresnel, geometry & diffuse weights) are evaluated in half precision
+// by the half precision variant. Positions, directions, NDF (whose alpha^2 underflows fp16 for smooth surfaces), radiance
+// & final sums stay in full precision.
+#if defined(HALF_PRECISION)
+#define hfloat float16_t
+#define hvec3  f16vec3
+#else
+#define hfloat float
+#define hvec3  vec3
+#endif
 
 // Constant normal incidence Fresnel factor for all dielectrics.
 const vec3 Fdielectric = vec3(0.04);
 
 struct AnalyticalLight {
 	vec3 direction;
+	// Shadow map layer of light's first cascade (negative if the light casts no shadows).
+	int shadowMap;
 	vec3 radiance;
 };
 
+// Dynamic point or spot light (see ClusteredLights::Light).
+struct DynamicLight {
+	vec4 positionRange;
+	vec4 radianceSpotScale;
+	vec4 directionSpotOffset;
+};
+
 layout(location=0) in Vertex
 {
 	vec3 position;
@@ -35,8 +130,55 @@ layout(set=0, binding=1) uniform ShadingUniforms
 layout(std140, binding=1) uniform ShadingUniforms
 #endif // VULKAN
 {
+	// Enabled analytical lights are packed at the front.
 	AnalyticalLight lights[NumLights];
 	vec3 eyePosition;
+	// Weight of previous environment's pre-filtered maps (non-zero while blending after environment switch).
+	float environmentBlend;
+	// Reflection probes: world space position (xyz) & radius of influence (w, zero until probe has been captured).
+	vec4 probes[MaxProbes];
+	uint numProbes;
+	uint numLights;
+	// Irradiance volume: minimum corner of bounds (xyz) & non-zero once volume has been baked (w), inverse extent of bounds (xyz).
+	vec4 volumeBounds;
+	vec4 volumeInvExtent;
+	// Clustered dynamic lights: view space depth row of view matrix, log depth to slice scale & bias (xy), froxel grid size
+	// (xyz) & non-zero if there are dynamic lights to shade (w, always zero in probe & volume captures whose views differ).
+	vec4 clusterDepth;
+	vec4 clusterSlices;
+	uvec4 clusterGrid;
+	// Cascaded shadow maps: world space to map texture coordinates & depth transforms of all map layers,
+	// normal offsets of each (packed) light's cascades.
+	mat4 shadowMatrices[NumLights * NumShadowCascades];
+	vec4 shadowNormalOffsets[NumLights];
+};
+
+#if VULKAN
+layout(set=0, binding=2, std430) readonly buffer DynamicLights
+#else
+layout(binding=0, std430) readonly buffer DynamicLights
+#endif // VULKAN
+{
+	DynamicLight dynamicLights[];
+};
+
+// Offset into cluster light index list & number of lights of each froxel.
+#if VULKAN
+layout(set=0, binding=3, std430) readonly buffer ClusterGrid
+#else
+layout(binding=1, std430) readonly buffer ClusterGrid
+#endif // VULKAN
+{
+	uvec2 clusters[];
+};
+
+#if VULKAN
+layout(set=0, binding=4, std430) readonly buffer ClusterLightIndices
+#else
+layout(binding=2, std430) readonly buffer ClusterLightIndices
+#endif // VULKAN
+{
+	uint clusterLightIndices[];
 };
 
 #if VULKAN
@@ -47,6 +189,13 @@ layout(set=1, binding=3) uniform sampler2D roughnessTexture;
 layout(set=1, binding=4) uniform samplerCube specularTexture;
 layout(set=1, binding=5) uniform samplerCube irradianceTexture;
 layout(set=1, binding=6) uniform sampler2D specularBRDF_LUT;
+layout(set=1, binding=7) uniform samplerCube prevSpecularTexture;
+layout(set=1, binding=8) uniform samplerCube prevIrradianceTexture;
+layout(set=1, binding=9) uniform samplerCubeArray probeSpecularTextures;
+layout(set=1, binding=10) uniform samplerCubeArray probeIrradianceTextures;
+layout(set=1, binding=11) uniform sampler3D irradianceVolumeTexture;
+layout(set=1, binding=12) uniform sampler2D specularAtlas;
+layout(set=1, binding=13) uniform sampler2DArrayShadow shadowMaps;
 #else
 layout(binding=0) uniform sampler2D albedoTexture;
 layout(binding=1) uniform sampler2D normalTexture;
@@ -55,6 +204,13 @@ layout(binding=3) uniform sampler2D roughnessTexture;
 layout(binding=4) uniform samplerCube specularTexture;
 layout(binding=5) uniform samplerCube irradianceTexture;
 layout(binding=6) uniform sampler2D specularBRDF_LUT;
+layout(binding=7) uniform samplerCube prevSpecularTexture;
+layout(binding=8) uniform samplerCube prevIrradianceTexture;
+layout(binding=9) uniform samplerCubeArray probeSpecularTextures;
+layout(binding=10) uniform samplerCubeArray probeIrradianceTextures;
+layout(binding=11) uniform sampler3D irradianceVolumeTexture;
+layout(binding=12) uniform sampler2D specularAtlas;
+layout(binding=13) uniform sampler2DArrayShadow shadowMaps;
 #endif // VULKAN
 
 // GGX/Towbridge-Reitz normal distribution function.
@@ -69,30 +225,156 @@ float ndfGGX(float cosLh, float roughness)
 }
 
 // Single term for separable Schlick-GGX below.
-float gaSchlickG1(float cosTheta, float k)
+hfloat gaSchlickG1(hfloat cosTheta, hfloat k)
 {
-	return cosTheta / (cosTheta * (1.0 - k) + k);
+	return cosTheta / (cosTheta * (hfloat(1.0) - k) + k);
 }
 
 // Schlick-GGX approximation of geometric attenuation function using Smith's method.
-float gaSchlickGGX(float cosLi, float cosLo, float roughness)
+hfloat gaSchlickGGX(hfloat cosLi, hfloat cosLo, hfloat roughness)
 {
-	float r = roughness + 1.0;
-	float k = (r * r) / 8.0; // Epic suggests using this roughness remapping for analytic lights.
+	hfloat r = roughness + hfloat(1.0);
+	hfloat k = (r * r) / hfloat(8.0); // Epic suggests using this roughness remapping for analytic lights.
 	return gaSchlickG1(cosLi, k) * gaSchlickG1(cosLo, k);
 }
 
 // Shlick's approximation of the Fresnel factor.
-vec3 fresnelSchlick(vec3 F0, float cosTheta)
+hvec3 fresnelSchlick(hvec3 F0, hfloat cosTheta)
 {
-	return F0 + (vec3(1.0) - F0) * pow(1.0 - cosTheta, 5.0);
+	return F0 + (hvec3(1.0) - F0) * pow(hfloat(1.0) - cosTheta, hfloat(5.0));
+}
+
+// Split-sum specular BRDF scale & bias (as stored in the LUT) fitted analytically.
+// See: "Physically Based Shading on Mobile", https://www.unrealengine.com/en-US/blog/physically-based-shading-on-mobile
+vec2 specularBRDFApprox(float cosLo, float roughness)
+{
+	const vec4 c0 = vec4(-1.0, -0.0275, -0.572, 0.022);
+	const vec4 c1 = vec4(1.0, 0.0425, 1.04, -0.04);
+	vec4 r = roughness * c0 + c1;
+	float a004 = min(r.x * r.x, exp2(-9.28 * cosLo)) * r.x + r.y;
+	return vec2(-1.04, 1.04) * a004 + r.zw;
+}
+
+// Blend weight of reflection probe at given position: falls off smoothly towards the edge of its influence sphere.
+float probeWeight(vec4 probe, vec3 position)
+{
+	if(probe.w <= 0.0) {
+		return 0.0;
+	}
+	float falloff = max(0.0, 1.0 - distance(position, probe.xyz) / probe.w);
+	return falloff * falloff;
+}
+
+vec2 signNotZero(vec2 v)
+{
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Point on octahedral map in [-1,1]^2 for given unit direction (lower hemisphere is folded over square diagonals).
+vec2 octEncode(vec3 v)
+{
+	v /= abs(v.x) + abs(v.y) + abs(v.z);
+	vec2 e = v.xy;
+	if(v.z < 0.0) {
+		e = (1.0 - abs(v.yx)) * signNotZero(v.xy);
+	}
+	return e;
+}
+
+// Bilinear lookup within single specular atlas level region (texel coordinates are kept inside its gutter).
+vec3 sampleAtlasLevel(vec2 e, int level)
+{
+	ivec2 atlasSize = textureSize(specularAtlas, 0);
+	int levelSize = atlasSize.y >> level;
+	vec2 origin = (level == 0) ? vec2(0.0) : vec2(atlasSize.y, atlasSize.y - (atlasSize.y >> (level-1)));
+	vec2 texel = origin + 1.0 + (0.5 * e + 0.5) * float(levelSize - 2);
+	return textureLod(specularAtlas, texel / vec2(atlasSize), 0).rgb;
+}
+
+// Trilinear lookup of specular atlas, LOD is given in cube map levels (atlas lacks the last one).
+vec3 sampleSpecularAtlas(vec3 v, float lod)
+{
+	int numLevels = findMSB(textureSize(specularAtlas, 0).y) - 1;
+	lod = clamp(lod, 0.0, float(numLevels - 1));
+	int level0 = int(lod);
+	int level1 = min(level0 + 1, numLevels - 1);
+	vec2 e = octEncode(v);
+	return mix(sampleAtlasLevel(e, level0), sampleAtlasLevel(e, level1), lod - float(level0));
+}
+
+// Evaluate irradiance volume SH at given normalized position within volume bounds.
+// Lookups are clamped to texel centers of each coefficient slab so that trilinear filtering never mixes neighbouring slabs.
+vec3 sampleIrradianceVolume(vec3 p, vec3 N)
+{
+	vec3 size = vec3(textureSize(irradianceVolumeTexture, 0));
+	vec3 gridSize = vec3(size.x / NumVolumeTextureSlabs, size.yz);
+	vec3 texel = vec3(0.5) + p * (gridSize - vec3(1.0));
+
+	vec4 s[NumVolumeTextureSlabs];
+	for(int i=0; i<NumVolumeTextureSlabs; ++i) {
+		s[i] = textureLod(irradianceVolumeTexture, (texel + vec3(i * gridSize.x, 0.0, 0.0)) / size, 0);
+	}
+
+	// Unpack 9 RGB coefficients (see shproject_cs) & evaluate cosine convolved SH in normal direction.
+	vec3 irradiance = 0.282095 * s[0].rgb;
+	irradiance += 0.488603 * (N.y * vec3(s[0].a, s[1].rg) + N.z * vec3(s[1].ba, s[2].r) + N.x * s[2].gba);
+	irradiance += 1.092548 * (N.x * N.y * s[3].rgb + N.y * N.z * vec3(s[3].a, s[4].rg) + N.x * N.z * s[5].gba);
+	irradiance += 0.315392 * (3.0 * N.z * N.z - 1.0) * vec3(s[4].ba, s[5].r);
+	irradiance += 0.546274 * (N.x * N.x - N.y * N.y) * s[6].rgb;
+	return max(irradiance, vec3(0.0));
+}
+
+// Fraction of analytical light reaching given position, looked up in the first (finest) cascade covering it.
+float shadowFactor(int firstMap, vec3 normalOffsets, vec3 position, vec3 normal)
+{
+	for(int cascade=0; cascade<NumShadowCascades; ++cascade) {
+		vec4 shadowCoord = shadowMatrices[firstMap + cascade] * vec4(position + normal * normalOffsets[cascade], 1.0);
+		if(all(greaterThan(shadowCoord.xyz, vec3(0.0))) && all(lessThan(shadowCoord.xyz, vec3(1.0)))) {
+			return texture(shadowMaps, vec4(shadowCoord.xy, firstMap + cascade, shadowCoord.z));
+		}
+	}
+	return 1.0;
+}
+
+// Contribution of a single light arriving from direction Li with given radiance.
+vec3 directLight(vec3 Li, vec3 Lradiance, vec3 N, vec3 Lo, float cosLo, hvec3 F0, hvec3 albedo, hfloat metalness, float roughness)
+{
+	// Half-vector between Li and Lo.
+	vec3 Lh = normalize(Li + Lo);
+
+	// Calculate angles between surface normal and various light vectors.
+	float cosLi = max(0.0, dot(N, Li));
+	float cosLh = max(0.0, dot(N, Lh));
+
+	// Calculate Fresnel term for direct lighting. 
+	hvec3 F = fresnelSchlick(F0, hfloat(max(0.0, dot(Lh, Lo))));
+	// Calculate normal distribution for specular BRDF.
+	float D = ndfGGX(cosLh, roughness);
+	// Calculate geometric attenuation for specular BRDF.
+	hfloat G = gaSchlickGGX(hfloat(cosLi), hfloat(cosLo), hfloat(roughness));
+
+	// Diffuse scattering happens due to light being refracted multiple times by a dielectric medium.
+	// Metals on the other hand either reflect or absorb energy, so diffuse contribution is always zero.
+	// To be energy conserving we must scale diffuse BRDF contribution based on Fresnel factor & metalness.
+	hvec3 kd = mix(hvec3(1.0) - F, hvec3(0.0), metalness);
+
+	// Lambert diffuse BRDF.
+	// We don't scale by 1/PI for lighting & material units to be more convenient.
+	// See: https://seblagarde.wordpress.com/2012/01/08/pi-or-not-to-pi-in-game-lighting-equation/
+	vec3 diffuseBRDF = vec3(kd * albedo);
+
+	// Cook-Torrance specular microfacet BRDF.
+	vec3 specularBRDF = (vec3(F * G) * D) / max(Epsilon, 4.0 * cosLi * cosLo);
+
+	// Total contribution for this light.
+	return (diffuseBRDF + specularBRDF) * Lradiance * cosLi;
 }
 
 void main()
 {
 	// Sample input textures to get shading model params.
-	vec3 albedo = texture(albedoTexture, vin.texcoord).rgb;
-	float metalness = texture(metalnessTexture, vin.texcoord).r;
+	hvec3 albedo = hvec3(texture(albedoTexture, vin.texcoord).rgb);
+	hfloat metalness = hfloat(texture(metalnessTexture, vin.texcoord).r);
 	float roughness = texture(roughnessTexture, vin.texcoord).r;
 
 	// Outgoing light direction (vector from world-space fragment position to the "eye").
@@ -109,44 +391,40 @@ void main()
 	vec3 Lr = 2.0 * cosLo * N - Lo;
 
 	// Fresnel reflectance at normal incidence (for metals use albedo color).
-	vec3 F0 = mix(Fdielectric, albedo, metalness);
+	hvec3 F0 = mix(hvec3(Fdielectric), albedo, metalness);
 
 	// Direct lighting calculation for analytical lights.
 	vec3 directLighting = vec3(0);
-	for(int i=0; i<NumLights; ++i)
-	{
-		vec3 Li = -lights[i].direction;
+	for(uint i=0; i<numLights; ++i) {
 		vec3 Lradiance = lights[i].radiance;
+		if(ShadowMapping && lights[i].shadowMap >= 0) {
+			Lradiance *= shadowFactor(lights[i].shadowMap, shadowNormalOffsets[i].xyz, vin.position, normalize(vin.tangentBasis[2]));
+		}
+		directLighting += directLight(-lights[i].direction, Lradiance, N, Lo, cosLo, F0, albedo, metalness, roughness);
+	}
 
-		// Half-vector between Li and Lo.
-		vec3 Lh = normalize(Li + Lo);
-
-		// Calculate angles between surface normal and various light vectors.
-		float cosLi = max(0.0, dot(N, Li));
-		float cosLh = max(0.0, dot(N, Lh));
-
-		// Calculate Fresnel term for direct lighting. 
-		vec3 F  = fresnelSchlick(F0, max(0.0, dot(Lh, Lo)));
-		// Calculate normal distribution for specular BRDF.
-		float D = ndfGGX(cosLh, roughness);
-		// Calculate geometric attenuation for specular BRDF.
-		float G = gaSchlickGGX(cosLi, cosLo, roughness);
-
-		// Diffuse scattering happens due to light being refracted multiple times by a dielectric medium.
-		// Metals on the other hand either reflect or absorb energy, so diffuse contribution is always zero.
-		// To be energy conserving we must scale diffuse BRDF contribution based on Fresnel factor & metalness.
-		vec3 kd = mix(vec3(1.0) - F, vec3(0.0), metalness);
-
-		// Lambert diffuse BRDF.
-		// We don't scale by 1/PI for lighting & material units to be more convenient.
-		// See: https://seblagarde.wordpress.com/2012/01/08/pi-or-not-to-pi-in-game-lighting-equation/
-		vec3 diffuseBRDF = kd * albedo;
-
-		// Cook-Torrance specular microfacet BRDF.
-		vec3 specularBRDF = (F * D * G) / max(Epsilon, 4.0 * cosLi * cosLo);
-
-		// Total contribution for this light.
-		directLighting += (diffuseBRDF + specularBRDF) * Lradiance * cosLi;
+	// Dynamic lights binned into this fragment's froxel.
+	if(DynamicLighting && clusterGrid.w != 0) {
+		float depth = dot(clusterDepth, vec4(vin.position, 1.0));
+		uint slice = uint(clamp(log(depth) * clusterSlices.x + clusterSlices.y, 0.0, float(clusterGrid.z - 1)));
+		uvec2 tile = min(uvec2(gl_FragCoord.xy) / ClusterTileSize, clusterGrid.xy - 1);
+		uvec2 cluster = clusters[(slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x];
+		for(uint i=0; i<cluster.y; ++i) {
+			DynamicLight light = dynamicLights[clusterLightIndices[cluster.x + i]];
+
+			vec3 Lv = light.positionRange.xyz - vin.position;
+			float distanceSq = dot(Lv, Lv);
+			vec3 Li = Lv * inversesqrt(max(distanceSq, Epsilon));
+
+			// Inverse square falloff windowed to reach zero at light's range & smooth angular falloff of spot lights.
+			float rangeFraction = distanceSq / (light.positionRange.w * light.positionRange.w);
+			float window = clamp(1.0 - rangeFraction * rangeFraction, 0.0, 1.0);
+			float spot = clamp(dot(-Li, light.directionSpotOffset.xyz) * light.radianceSpotScale.w + light.directionSpotOffset.w, 0.0, 1.0);
+			float attenuation = (window * window) / (distanceSq + 1.0) * (spot * spot);
+			if(attenuation > 0.0) {
+				directLighting += directLight(Li, attenuation * light.radianceSpotScale.rgb, N, Lo, cosLo, F0, albedo, metalness, roughness);
+			}
+		}
 	}
 
 	// Ambient lighting (IBL).
@@ -154,28 +432,73 @@ void main()
 	{
 		// Sample diffuse irradiance at normal direction.
 		vec3 irradiance = texture(irradianceTexture, N).rgb;
+		if(EnvironmentBlending && environmentBlend > 0.0) {
+			irradiance = mix(irradiance, texture(prevIrradianceTexture, N).rgb, environmentBlend);
+		}
+
+		// Use local irradiance from the volume (accounting for the model itself) when shading within its bounds.
+		if(IrradianceVolume && volumeBounds.w > 0.0) {
+			vec3 p = (vin.position - volumeBounds.xyz) * volumeInvExtent.xyz;
+			if(all(greaterThanEqual(p, vec3(0.0))) && all(lessThanEqual(p, vec3(1.0)))) {
+				irradiance = sampleIrradianceVolume(p, N);
+			}
+		}
 
 		// Calculate Fresnel term for ambient lighting.
 		// Since we use pre-filtered cubemap(s) and irradiance is coming from many directions
 		// use cosLo instead of angle with light's half-vector (cosLh above).
 		// See: https://seblagarde.wordpress.com/2011/08/17/hello-world/
-		vec3 F = fresnelSchlick(F0, cosLo);
+		hvec3 F = fresnelSchlick(F0, hfloat(cosLo));
 
 		// Get diffuse contribution factor (as with direct lighting).
-		vec3 kd = mix(vec3(1.0) - F, vec3(0.0), metalness);
+		vec3 diffuseAlbedo = vec3(mix(hvec3(1.0) - F, hvec3(0.0), metalness) * albedo);
 
 		// Irradiance map contains exitant radiance assuming Lambertian BRDF, no need to scale by 1/PI here either.
-		vec3 diffuseIBL = kd * albedo * irradiance;
+		vec3 diffuseIBL = diffuseAlbedo * irradiance;
 
 		// Sample pre-filtered specular reflection environment at correct mipmap level.
-		int specularTextureLevels = textureQueryLevels(specularTexture);
-		vec3 specularIrradiance = textureLod(specularTexture, Lr, roughness * specularTextureLevels).rgb;
+		// Atlas is twice the cube face size, so its height has one more power of two than the cube map has levels.
+		int specularTextureLevels = OctahedralAtlas ? findMSB(textureSize(specularAtlas, 0).y) : textureQueryLevels(specularTexture);
+		vec3 specularIrradiance;
+		if(OctahedralAtlas) {
+			specularIrradiance = sampleSpecularAtlas(Lr, roughness * specularTextureLevels);
+		}
+		else {
+			specularIrradiance = textureLod(specularTexture, Lr, roughness * specularTextureLevels).rgb;
+		}
+		if(EnvironmentBlending && environmentBlend > 0.0) {
+			specularIrradiance = mix(specularIrradiance, textureLod(prevSpecularTexture, Lr, roughness * specularTextureLevels).rgb, environmentBlend);
+		}
+
+		// Blend in nearby reflection probes. Overlapping probes share at most full weight, global environment gets whatever remains.
+		if(ReflectionProbes && numProbes > 0) {
+			float totalWeight = 0.0;
+			for(uint i=0; i<numProbes; ++i) {
+				totalWeight += probeWeight(probes[i], vin.position);
+			}
+			if(totalWeight > 0.0) {
+				float scale = 1.0 / max(1.0, totalWeight);
+				int probeTextureLevels = textureQueryLevels(probeSpecularTextures);
+				vec3 probeIrradiance = vec3(0);
+				vec3 probeSpecularIrradiance = vec3(0);
+				for(uint i=0; i<numProbes; ++i) {
+					float weight = scale * probeWeight(probes[i], vin.position);
+					if(weight > 0.0) {
+						probeIrradiance += weight * textureLod(probeIrradianceTextures, vec4(N, i), 0).rgb;
+						probeSpecularIrradiance += weight * textureLod(probeSpecularTextures, vec4(Lr, i), roughness * probeTextureLevels).rgb;
+					}
+				}
+				float environmentWeight = 1.0 - scale * totalWeight;
+				diffuseIBL = diffuseAlbedo * (environmentWeight * irradiance + probeIrradiance);
+				specularIrradiance = environmentWeight * specularIrradiance + probeSpecularIrradiance;
+			}
+		}
 
 		// Split-sum approximation factors for Cook-Torrance specular BRDF.
-		vec2 specularBRDF = texture(specularBRDF_LUT, vec2(cosLo, roughness)).rg;
+		vec2 specularBRDF = AnalyticBRDF ? specularBRDFApprox(cosLo, roughness) : texture(specularBRDF_LUT, vec2(cosLo, roughness)).rg;
 
 		// Total specular IBL contribution.
-		vec3 specularIBL = (F0 * specularBRDF.x + specularBRDF.y) * specularIrradiance;
+		vec3 specularIBL = vec3(F0 * hfloat(specularBRDF.x) + hfloat(specularBRDF.y)) * specularIrradiance;
 
 		// Total ambient lighting contribution.
 		ambientLighting = diffuseIBL + specularIBL;
@@ -28,6 +28,9 @@ layout(location=0) out Vertex
 	mat3 tangentBasis;
 } vout;
 
+// Must match depth_vs (depth pre-pass is followed by an equal depth test).
+invariant gl_Position;
+
 void main()
 {
 	vout.position = vec3(sceneRotationMatrix * vec4(position, 1.0));
@@ -0,0 +1,22 @@
+#version 450 core
+// Physically Based Rendering
+// Copyright (c) 2017-2018 Michał Siejak
+
+// Shadow map depth pass: Vertex program (reads position-only vertex stream, no fragment program).
+
+layout(location=0) in vec3 position;
+
+#if VULKAN
+layout(push_constant) uniform PushConstants
+{
+	// Light view-projection matrix of the cascade combined with scene rotation.
+	mat4 shadowViewProjectionMatrix;
+};
+#else
+layout(location=0) uniform mat4 shadowViewProjectionMatrix;
+#endif // VULKAN
+
+void main()
+{
+	gl_Position = shadowViewProjectionMatrix * vec4(position, 1.0);
+}
@@ -0,0 +1,120 @@
+#version 450 core
+// Physically Based Rendering
+// Copyright (c) 2017-2018 Michał Siejak
+
+// Projects captured radiance cube maps onto 3rd order spherical harmonics & convolves them with clamped cosine lobe,
+// producing irradiance volume probes. Each thread group processes one probe: captures of the whole batch are layers
+// of a cube map array and destination probe grid coordinates are read from a buffer.
+
+// Must match IrradianceVolume::NumCoefficients & NumTextureSlabs.
+const int NumCoefficients = 9;
+const int NumTextureSlabs = 7;
+const uint NumThreads = 64;
+
+#if VULKAN
+layout(set=0, binding=0) uniform samplerCubeArray inputTexture;
+layout(set=0, binding=1, rgba16f) restrict writeonly uniform image3D outputTexture;
+layout(set=0, binding=3, std430) readonly buffer ProbeCoords
+{
+	ivec4 coords[];
+} probeCoords;
+#else
+layout(binding=0) uniform samplerCubeArray inputTexture;
+layout(binding=0, rgba16f) restrict writeonly uniform image3D outputTexture;
+layout(binding=0, std430) readonly buffer ProbeCoords
+{
+	ivec4 coords[];
+} probeCoords;
+#endif // VULKAN
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+shared vec3 partialSums[NumThreads][NumCoefficients];
+shared vec3 coefficients[NumCoefficients];
+
+// Direction (not normalized) through given point of a cubemap face.
+// See: OpenGL core profile specs, section 8.13.
+vec3 getSamplingVector(uint face, vec2 uv)
+{
+	if(face == 0)      return vec3(1.0,  uv.y, -uv.x);
+	else if(face == 1) return vec3(-1.0, uv.y,  uv.x);
+	else if(face == 2) return vec3(uv.x, 1.0, -uv.y);
+	else if(face == 3) return vec3(uv.x, -1.0, uv.y);
+	else if(face == 4) return vec3(uv.x, uv.y, 1.0);
+	else               return vec3(-uv.x, uv.y, -1.0);
+}
+
+// Real SH basis functions of bands 0-2 (ordered by band, then by m = -l..l).
+void evaluateBasis(vec3 v, out float basis[NumCoefficients])
+{
+	basis[0] = 0.282095;
+	basis[1] = 0.488603 * v.y;
+	basis[2] = 0.488603 * v.z;
+	basis[3] = 0.488603 * v.x;
+	basis[4] = 1.092548 * v.x * v.y;
+	basis[5] = 1.092548 * v.y * v.z;
+	basis[6] = 0.315392 * (3.0 * v.z * v.z - 1.0);
+	basis[7] = 1.092548 * v.x * v.z;
+	basis[8] = 0.546274 * (v.x * v.x - v.y * v.y);
+}
+
+void main(void)
+{
+	uint probe = gl_WorkGroupID.x;
+	uint size = uint(textureSize(inputTexture, 0).x);
+	uint numTexels = 6 * size * size;
+
+	// Each thread integrates radiance over an interleaved subset of all texels of all faces.
+	vec3 sums[NumCoefficients];
+	for(int c=0; c<NumCoefficients; ++c) {
+		sums[c] = vec3(0);
+	}
+	for(uint i=gl_LocalInvocationIndex; i<numTexels; i+=NumThreads) {
+		uint face = i / (size * size);
+		vec2 st = (vec2(i % size, (i / size) % size) + 0.5) / float(size);
+		vec3 v = getSamplingVector(face, 2.0 * vec2(st.x, 1.0-st.y) - vec2(1.0));
+
+		// Solid angle subtended by the texel: dA * cos / r^2 with face at unit distance (texels sum up to 4*PI).
+		float solidAngle = 4.0 / (float(size * size) * pow(dot(v, v), 1.5));
+		vec3 L = normalize(v);
+		vec3 radiance = textureLod(inputTexture, vec4(L, probe), 0).rgb;
+
+		float basis[NumCoefficients];
+		evaluateBasis(L, basis);
+		for(int c=0; c<NumCoefficients; ++c) {
+			sums[c] += radiance * (basis[c] * solidAngle);
+		}
+	}
+	for(int c=0; c<NumCoefficients; ++c) {
+		partialSums[gl_LocalInvocationIndex][c] = sums[c];
+	}
+	barrier();
+
+	// Reduce partial sums & convolve with clamped cosine lobe (band factors PI, 2PI/3, PI/4 divided by PI, since irradiance
+	// is stored as exitant radiance of a white Lambertian surface, as in the irradiance map).
+	if(gl_LocalInvocationIndex < NumCoefficients) {
+		uint c = gl_LocalInvocationIndex;
+		vec3 sum = vec3(0);
+		for(uint t=0; t<NumThreads; ++t) {
+			sum += partialSums[t][c];
+		}
+		float lobe = (c == 0) ? 1.0 : ((c < 4) ? 2.0/3.0 : 0.25);
+		coefficients[c] = lobe * sum;
+	}
+	barrier();
+
+	// Pack 27 coefficient values into RGBA texels of consecutive slabs.
+	if(gl_LocalInvocationIndex < NumTextureSlabs) {
+		uint slab = gl_LocalInvocationIndex;
+		vec4 value = vec4(0);
+		for(uint k=0; k<4; ++k) {
+			uint index = 4 * slab + k;
+			if(index < 3 * NumCoefficients) {
+				value[k] = coefficients[index / 3][index % 3];
+			}
+		}
+		int gridSizeX = imageSize(outputTexture).x / NumTextureSlabs;
+		ivec3 coord = probeCoords.coords[probe].xyz + ivec3(slab * gridSizeX, 0, 0);
+		imageStore(outputTexture, coord, value);
+	}
+}
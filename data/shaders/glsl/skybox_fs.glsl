@@ -4,17 +4,63 @@
 
 // Environment skybox: Fragment program.
 
+// Sample current environment from level 0 of octahedral specular atlas instead of cube map (see pbr_fs).
+#if VULKAN
+layout(constant_id=0) const bool OctahedralAtlas = false;
+#elif defined(OCTAHEDRAL_ATLAS)
+const bool OctahedralAtlas = true;
+#else
+const bool OctahedralAtlas = false;
+#endif
+
 layout(location=0) in vec3 localPosition;
 layout(location=0) out vec4 color;
 
+#if VULKAN
+layout(set=0, binding=1) uniform ShadingUniforms
+#else
+layout(std140, binding=1) uniform ShadingUniforms
+#endif // VULKAN
+{
+	// Only environment blend factor is used here (see pbr_fs for full block layout).
+	vec4 lights[6];
+	vec3 eyePosition;
+	float environmentBlend;
+};
+
 #if VULKAN
 layout(set=1, binding=0) uniform samplerCube envTexture;
+layout(set=1, binding=1) uniform samplerCube prevEnvTexture;
+layout(set=1, binding=2) uniform sampler2D envAtlas;
 #else
 layout(binding=0) uniform samplerCube envTexture;
+layout(binding=1) uniform samplerCube prevEnvTexture;
+layout(binding=2) uniform sampler2D envAtlas;
 #endif // VULKAN
 
+vec2 signNotZero(vec2 v)
+{
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Level 0 lookup of octahedral atlas (left square of the atlas with one texel gutter).
+vec4 sampleAtlas(vec3 v)
+{
+	v /= abs(v.x) + abs(v.y) + abs(v.z);
+	vec2 e = v.xy;
+	if(v.z < 0.0) {
+		e = (1.0 - abs(v.yx)) * signNotZero(v.xy);
+	}
+	ivec2 atlasSize = textureSize(envAtlas, 0);
+	vec2 texel = 1.0 + (0.5 * e + 0.5) * float(atlasSize.y - 2);
+	return textureLod(envAtlas, texel / vec2(atlasSize), 0);
+}
+
 void main()
 {
 	vec3 envVector = normalize(localPosition);
-	color = textureLod(envTexture, envVector, 0);
+	color = OctahedralAtlas ? sampleAtlas(envVector) : textureLod(envTexture, envVector, 0);
+	if(environmentBlend > 0.0) {
+		color = mix(color, textureLod(prevEnvTexture, envVector, 0), environmentBlend);
+	}
 }
@@ -20,5 +20,6 @@ layout(location=0) out vec3 localPosition;
 void main()
 {
 	localPosition = position.xyz;
-	gl_Position   = skyProjectionMatrix * vec4(position, 1.0);
+	// Skybox lies at the far plane (depth of 1) so that it can be drawn last with depth testing.
+	gl_Position   = (skyProjectionMatrix * vec4(position, 1.0)).xyww;
 }
@@ -10,12 +10,16 @@ const float PI = 3.141592;
 const float TwoPI = 2 * PI;
 const float Epsilon = 0.001; // This program needs larger eps.
 
-const uint NumSamples = 1024;
-const float InvNumSamples = 1.0 / float(NumSamples);
-
+// Sample count is a specialization constant in Vulkan and an optional preprocessor definition in OpenGL.
 #if VULKAN
+layout(constant_id=0) const uint NumSamples = 1024;
 layout(set=0, binding=1, rg16f) restrict writeonly uniform image2D LUT;
 #else
+#if defined(NUM_SAMPLES)
+const uint NumSamples = NUM_SAMPLES;
+#else
+const uint NumSamples = 1024;
+#endif
 layout(binding=0, rg16f) restrict writeonly uniform image2D LUT;
 #endif // VULKAN
 
@@ -34,7 +38,7 @@ float radicalInverse_VdC(uint bits)
 // Sample i-th point from Hammersley point set of NumSamples points total.
 vec2 sampleHammersley(uint i)
 {
-	return vec2(i * InvNumSamples, radicalInverse_VdC(i));
+	return vec2(i / float(NumSamples), radicalInverse_VdC(i));
 }
 
 // Importance sample GGX normal distribution function for a fixed roughness value.
@@ -66,7 +70,15 @@ float gaSchlickGGX_IBL(float cosLi, float cosLo, float roughness)
 	return gaSchlickG1(cosLi, k) * gaSchlickG1(cosLo, k);
 }
 
+// Thread group size is chosen at startup (see WorkgroupTuner): a specialization constant in Vulkan and an optional
+// preprocessor definition in OpenGL.
+#if VULKAN
+layout(local_size_x_id=1, local_size_y_id=2, local_size_z=1) in;
+#elif defined(WORKGROUP_SIZE)
+layout(local_size_x=WORKGROUP_SIZE, local_size_y=WORKGROUP_SIZE, local_size_z=1) in;
+#else
 layout(local_size_x=32, local_size_y=32, local_size_z=1) in;
+#endif
 void main(void)
 {
 	// Get integration parameters.
@@ -108,5 +120,5 @@ void main(void)
 		}
 	}
 
-	imageStore(LUT, ivec2(gl_GlobalInvocationID), vec4(DFG1, DFG2, 0, 0) * InvNumSamples);
+	imageStore(LUT, ivec2(gl_GlobalInvocationID), vec4(DFG1, DFG2, 0, 0) / float(NumSamples));
 }
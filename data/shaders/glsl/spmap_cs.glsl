@@ -9,19 +9,59 @@ const float PI = 3.141592;
 const float TwoPI = 2 * PI;
 const float Epsilon = 0.00001;
 
-const uint NumSamples = 1024;
-const float InvNumSamples = 1.0 / float(NumSamples);
+// Never take fewer samples than this even for nearly mirror-like roughness values.
+const uint MinNumSamples = 16;
+
+// Precomputed per-level sample directions & source LODs (see SpecularSampleTable).
+const int MaxSampleTableLevels = 16;
+struct SampleTableLevel
+{
+	uint offset;
+	uint count;
+	float invWeight;
+	float padding;
+};
 
 // In Vulkan whole mip tail is bound to the descriptor set and appropriate mip level is selected via a push constant.
+// Sample count limits & thread group size are specialization constants.
 #if VULKAN
 layout(constant_id=0) const int NumMipLevels = 1;
+layout(constant_id=1) const uint MaxNumSamples = 1024;
+layout(constant_id=2) const float SampleErrorTarget = 0.03125;
+layout(constant_id=3) const bool FoldedMipTail = false;
+layout(constant_id=6) const bool UseSampleTable = true;
 layout(set=0, binding=0) uniform samplerCube inputTexture;
 layout(set=0, binding=2, rgba16f) restrict writeonly uniform imageCube outputTexture[NumMipLevels];
+layout(set=0, binding=3, std430) readonly buffer SampleTable
+{
+	SampleTableLevel levels[MaxSampleTableLevels];
+	vec4 samples[];
+} sampleTable;
+#else
+// In OpenGL only a single mip level is bound, unless whole mip tail is processed by a single dispatch (FOLDED_MIP_TAIL_GROUP_SIZE
+// is defined at compile time), in which case NUM_MIP_LEVELS consecutive levels are bound to image units starting at 0.
+#if defined(FOLDED_MIP_TAIL_GROUP_SIZE)
+const int NumMipLevels = NUM_MIP_LEVELS;
+const bool FoldedMipTail = true;
 #else
-// In OpenGL only a single mip level is bound.
 const int NumMipLevels = 1;
+const bool FoldedMipTail = false;
+#endif
+#if defined(SAMPLE_TABLE)
+const bool UseSampleTable = true;
+#else
+const bool UseSampleTable = false;
+#endif
 layout(binding=0) uniform samplerCube inputTexture;
 layout(binding=0, rgba16f) restrict writeonly uniform imageCube outputTexture[NumMipLevels];
+layout(binding=0, std430) readonly buffer SampleTable
+{
+	SampleTableLevel levels[MaxSampleTableLevels];
+	vec4 samples[];
+} sampleTable;
+// Sample count limits.
+layout(location=3) uniform float sampleErrorTarget;
+layout(location=4) uniform uint maxNumSamples;
 #endif // VULKAN
 
 #if VULKAN
@@ -31,18 +71,50 @@ layout(push_constant) uniform PushConstants
 	int level;
 	// Roughness value to pre-filter for.
 	float roughness;
+	// First output cubemap face & row (allows processing output in smaller slices).
+	uint face;
+	uint row;
+	// Roughness increment between consecutive mip levels (folded mip tail only).
+	float deltaRoughness;
 } pushConstants;
 
-#define PARAM_LEVEL     pushConstants.level
-#define PARAM_ROUGHNESS pushConstants.roughness
+#define PARAM_LEVEL           pushConstants.level
+#define PARAM_ROUGHNESS       pushConstants.roughness
+#define PARAM_OFFSET          uvec3(0, pushConstants.row, pushConstants.face)
+#define PARAM_DELTA_ROUGHNESS pushConstants.deltaRoughness
+#define PARAM_ERROR_TARGET    SampleErrorTarget
+#define PARAM_MAX_SAMPLES     MaxNumSamples
+#define PARAM_MIP_BASE        1
 #else
 // Roughness value to pre-filter for.
 layout(location=0) uniform float roughness;
+// First output cubemap face & row (allows processing output in smaller slices).
+layout(location=1) uniform uint face;
+layout(location=2) uniform uint row;
+// Roughness increment between consecutive mip levels (folded mip tail only).
+layout(location=5) uniform float deltaRoughness;
+// Mip level bound to the first image unit (sample table lookup only).
+layout(location=6) uniform int mipLevel;
 
-#define PARAM_LEVEL     0
-#define PARAM_ROUGHNESS roughness
+#define PARAM_LEVEL           0
+#define PARAM_ROUGHNESS       roughness
+#define PARAM_OFFSET          uvec3(0, row, face)
+#define PARAM_DELTA_ROUGHNESS deltaRoughness
+#define PARAM_ERROR_TARGET    sampleErrorTarget
+#define PARAM_MAX_SAMPLES     maxNumSamples
+#define PARAM_MIP_BASE        mipLevel
 #endif // VULKAN
 
+#if VULKAN
+layout(local_size_x_id=4, local_size_y_id=5, local_size_z=1) in;
+#elif defined(FOLDED_MIP_TAIL_GROUP_SIZE)
+layout(local_size_x=FOLDED_MIP_TAIL_GROUP_SIZE, local_size_y=1, local_size_z=1) in;
+#elif defined(WORKGROUP_SIZE)
+layout(local_size_x=WORKGROUP_SIZE, local_size_y=WORKGROUP_SIZE, local_size_z=1) in;
+#else
+layout(local_size_x=32, local_size_y=32, local_size_z=1) in;
+#endif
+
 // Compute Van der Corput radical inverse
 // See: http://holger.dammertz.org/stuff/notes_HammersleyOnHemisphere.html
 float radicalInverse_VdC(uint bits)
@@ -55,10 +127,25 @@ float radicalInverse_VdC(uint bits)
 	return float(bits) * 2.3283064365386963e-10; // / 0x100000000
 }
 
-// Sample i-th point from Hammersley point set of NumSamples points total.
-vec2 sampleHammersley(uint i)
+// Sample i-th point from Hammersley point set of numSamples points total.
+vec2 sampleHammersley(uint i, float invNumSamples)
 {
-	return vec2(i * InvNumSamples, radicalInverse_VdC(i));
+	return vec2(i * invNumSamples, radicalInverse_VdC(i));
+}
+
+// Number of samples needed to pre-filter for given roughness value.
+// Noise of the estimate grows with GGX lobe width (alpha) and falls off with square root of sample count so pick the smallest
+// power of two keeping alpha/sqrt(N) below error target. Mirror-like levels need very few samples since mipmap filtered
+// importance sampling reads pre-blurred source texels. Must match IBLScheduler::specularSampleCount().
+uint numSamplesForRoughness(float roughness)
+{
+	if(PARAM_ERROR_TARGET <= 0.0) {
+		return PARAM_MAX_SAMPLES;
+	}
+	float alpha = roughness * roughness;
+	float n = (alpha / PARAM_ERROR_TARGET) * (alpha / PARAM_ERROR_TARGET);
+	uint numSamples = 1u << uint(min(ceil(log2(max(n, 1.0))), 31.0));
+	return clamp(numSamples, MinNumSamples, PARAM_MAX_SAMPLES);
 }
 
 // Importance sample GGX normal distribution function for a fixed roughness value.
@@ -87,23 +174,23 @@ float ndfGGX(float cosLh, float roughness)
 	return alphaSq / (PI * denom * denom);
 }
 
-// Calculate normalized sampling direction vector based on current fragment coordinates (gl_GlobalInvocationID.xyz).
+// Calculate normalized sampling direction vector based on current fragment coordinates (id.xyz).
 // This is essentially "inverse-sampling": we reconstruct what the sampling vector would be if we wanted it to "hit"
 // this particular fragment in a cubemap.
 // See: OpenGL core profile specs, section 8.13.
-vec3 getSamplingVector()
+vec3 getSamplingVector(uvec3 id, int level)
 {
-    vec2 st = gl_GlobalInvocationID.xy/vec2(imageSize(outputTexture[PARAM_LEVEL]));
+    vec2 st = id.xy/vec2(imageSize(outputTexture[level]));
     vec2 uv = 2.0 * vec2(st.x, 1.0-st.y) - vec2(1.0);
 
     vec3 ret;
     // Sadly 'switch' doesn't seem to work, at least on NVIDIA.
-    if(gl_GlobalInvocationID.z == 0)      ret = vec3(1.0,  uv.y, -uv.x);
-    else if(gl_GlobalInvocationID.z == 1) ret = vec3(-1.0, uv.y,  uv.x);
-    else if(gl_GlobalInvocationID.z == 2) ret = vec3(uv.x, 1.0, -uv.y);
-    else if(gl_GlobalInvocationID.z == 3) ret = vec3(uv.x, -1.0, uv.y);
-    else if(gl_GlobalInvocationID.z == 4) ret = vec3(uv.x, uv.y, 1.0);
-    else if(gl_GlobalInvocationID.z == 5) ret = vec3(-uv.x, uv.y, -1.0);
+    if(id.z == 0)      ret = vec3(1.0,  uv.y, -uv.x);
+    else if(id.z == 1) ret = vec3(-1.0, uv.y,  uv.x);
+    else if(id.z == 2) ret = vec3(uv.x, 1.0, -uv.y);
+    else if(id.z == 3) ret = vec3(uv.x, -1.0, uv.y);
+    else if(id.z == 4) ret = vec3(uv.x, uv.y, 1.0);
+    else if(id.z == 5) ret = vec3(-uv.x, uv.y, -1.0);
     return normalize(ret);
 }
 
@@ -124,22 +211,45 @@ vec3 tangentToWorld(const vec3 v, const vec3 N, const vec3 S, const vec3 T)
 	return S * v.x + T * v.y + N * v.z;
 }
 
-layout(local_size_x=32, local_size_y=32, local_size_z=1) in;
-void main(void)
+// Pre-filter single output texel (id.xyz) of given mip level using precomputed sample table.
+void prefilterSampleTable(uvec3 id, int level)
+{
+	vec3 N = getSamplingVector(id, level);
+
+	vec3 S, T;
+	computeBasisVectors(N, S, T);
+
+	// Samples are already importance sampled, reflected around N, culled & assigned source LOD: only rotate them into world space.
+	SampleTableLevel tableLevel = sampleTable.levels[level + PARAM_MIP_BASE];
+
+	vec3 color = vec3(0);
+	for(uint i=0; i<tableLevel.count; ++i) {
+		vec4 Li = sampleTable.samples[tableLevel.offset + i];
+		color += textureLod(inputTexture, tangentToWorld(Li.xyz, N, S, T), Li.w).rgb * Li.z;
+	}
+	color *= tableLevel.invWeight;
+
+	imageStore(outputTexture[level], ivec3(id), vec4(color, 1.0));
+}
+
+// Pre-filter single output texel (id.xyz) of given mip level.
+void prefilter(uvec3 id, int level, float roughness)
 {
-	// Make sure we won't write past output when computing higher mipmap levels.
-	ivec2 outputSize = imageSize(outputTexture[PARAM_LEVEL]);
-	if(gl_GlobalInvocationID.x >= outputSize.x || gl_GlobalInvocationID.y >= outputSize.y) {
+	if(UseSampleTable) {
+		prefilterSampleTable(id, level);
 		return;
 	}
-	
+
+	uint numSamples = numSamplesForRoughness(roughness);
+	float invNumSamples = 1.0 / float(numSamples);
+
 	// Solid angle associated with a single cubemap texel at zero mipmap level.
 	// This will come in handy for importance sampling below.
 	vec2 inputSize = vec2(textureSize(inputTexture, 0));
 	float wt = 4.0 * PI / (6 * inputSize.x * inputSize.y);
 	
 	// Approximation: Assume zero viewing angle (isotropic reflections).
-	vec3 N = getSamplingVector();
+	vec3 N = getSamplingVector(id, level);
 	vec3 Lo = N;
 	
 	vec3 S, T;
@@ -150,9 +260,9 @@ void main(void)
 
 	// Convolve environment map using GGX NDF importance sampling.
 	// Weight by cosine term since Epic claims it generally improves quality.
-	for(uint i=0; i<NumSamples; ++i) {
-		vec2 u = sampleHammersley(i);
-		vec3 Lh = tangentToWorld(sampleGGX(u.x, u.y, PARAM_ROUGHNESS), N, S, T);
+	for(uint i=0; i<numSamples; ++i) {
+		vec2 u = sampleHammersley(i, invNumSamples);
+		vec3 Lh = tangentToWorld(sampleGGX(u.x, u.y, roughness), N, S, T);
 
 		// Compute incident direction (Li) by reflecting viewing direction (Lo) around half-vector (Lh).
 		vec3 Li = 2.0 * dot(Lo, Lh) * Lh - Lo;
@@ -166,10 +276,10 @@ void main(void)
 
 			// GGX normal distribution function (D term) probability density function.
 			// Scaling by 1/4 is due to change of density in terms of Lh to Li (and since N=V, rest of the scaling factor cancels out).
-			float pdf = ndfGGX(cosLh, PARAM_ROUGHNESS) * 0.25;
+			float pdf = ndfGGX(cosLh, roughness) * 0.25;
 
 			// Solid angle associated with this sample.
-			float ws = 1.0 / (NumSamples * pdf);
+			float ws = invNumSamples / pdf;
 
 			// Mip level to sample from.
 			float mipLevel = max(0.5 * log2(ws / wt) + 1.0, 0.0);
@@ -180,5 +290,41 @@ void main(void)
 	}
 	color /= weight;
 
-	imageStore(outputTexture[PARAM_LEVEL], ivec3(gl_GlobalInvocationID), vec4(color, 1.0));
+	imageStore(outputTexture[level], ivec3(id), vec4(color, 1.0));
+}
+
+void main(void)
+{
+	if(FoldedMipTail) {
+		// Whole mip tail (levels smaller than a regular 32x32 thread group) is processed by a single 1D dispatch.
+		// Each level is covered by a whole number of thread groups so that mip level index stays uniform within a group.
+		int level = PARAM_LEVEL;
+		uint size = uint(imageSize(outputTexture[PARAM_LEVEL]).x);
+		uint group = gl_WorkGroupID.x;
+		for(; level < NumMipLevels-1; ++level, size = max(size/2, 1u)) {
+			uint numGroups = (6 * size * size + gl_WorkGroupSize.x - 1) / gl_WorkGroupSize.x;
+			if(group < numGroups) {
+				break;
+			}
+			group -= numGroups;
+		}
+
+		uint index = group * gl_WorkGroupSize.x + gl_LocalInvocationIndex;
+		if(index >= 6 * size * size) {
+			return;
+		}
+		uvec3 id = uvec3(index % size, (index / size) % size, index / (size * size));
+		prefilter(id, level, PARAM_ROUGHNESS + (level - PARAM_LEVEL) * PARAM_DELTA_ROUGHNESS);
+	}
+	else {
+		// Output texel coordinates (dispatch might cover only a slice of the output).
+		uvec3 id = gl_GlobalInvocationID + PARAM_OFFSET;
+
+		// Make sure we won't write past output when computing higher mipmap levels.
+		ivec2 outputSize = imageSize(outputTexture[PARAM_LEVEL]);
+		if(id.x >= outputSize.x || id.y >= outputSize.y) {
+			return;
+		}
+		prefilter(id, PARAM_LEVEL, PARAM_ROUGHNESS);
+	}
 }
@@ -0,0 +1,92 @@
+#version 450 core
+// Physically Based Rendering
+// Copyright (c) 2017-2018 Michał Siejak
+
+// Temporal anti-aliasing resolve (see TemporalAA class): blends current jittered frame with history reprojected from
+// the previous frame by each pixel's depth. History is clamped to the current frame's 3x3 neighbourhood (in YCoCg space)
+// to reject samples which were disoccluded or whose shading changed.
+
+#if VULKAN
+layout(set=0, binding=0) uniform TemporalAAUniforms
+#else
+layout(std140, binding=2) uniform TemporalAAUniforms
+#endif // VULKAN
+{
+	mat4 reprojectionMatrix;
+	mat4 skyReprojectionMatrix;
+	vec4 parameters; // x: history weight, y: depth at far plane
+};
+
+#if VULKAN
+layout(set=0, binding=1) uniform sampler2D sceneColor;
+layout(set=0, binding=2) uniform sampler2D sceneDepth;
+layout(set=0, binding=3) uniform sampler2D historyColor;
+layout(set=0, binding=4, rgba16f) restrict writeonly uniform image2D outputColor;
+#else
+layout(binding=0) uniform sampler2D sceneColor;
+layout(binding=1) uniform sampler2D sceneDepth;
+layout(binding=2) uniform sampler2D historyColor;
+layout(binding=0, rgba16f) restrict writeonly uniform image2D outputColor;
+#endif // VULKAN
+
+vec3 RGBToYCoCg(vec3 c)
+{
+	return vec3(dot(c, vec3(0.25, 0.5, 0.25)), dot(c, vec3(0.5, 0.0, -0.5)), dot(c, vec3(-0.25, 0.5, -0.25)));
+}
+
+vec3 YCoCgToRGB(vec3 c)
+{
+	return vec3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+}
+
+// Blend weight inversely proportional to luminance (keeps very bright HDR samples from dominating & flickering).
+float luminanceWeight(vec3 c)
+{
+	return 1.0 / (1.0 + dot(c, vec3(0.2126, 0.7152, 0.0722)));
+}
+
+layout(local_size_x=8, local_size_y=8, local_size_z=1) in;
+void main(void)
+{
+	ivec2 size = imageSize(outputColor);
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	if(any(greaterThanEqual(pixel, size))) {
+		return;
+	}
+
+	// Neighbourhood color bounds & closest depth (reprojecting by it keeps silhouettes from trailing).
+	vec3 color = texelFetch(sceneColor, pixel, 0).rgb;
+	vec3 minColor = RGBToYCoCg(color);
+	vec3 maxColor = minColor;
+	float depth = texelFetch(sceneDepth, pixel, 0).r;
+	for(int y=-1; y<=1; ++y) {
+		for(int x=-1; x<=1; ++x) {
+			ivec2 neighbour = clamp(pixel + ivec2(x, y), ivec2(0), size - 1);
+			vec3 neighbourColor = RGBToYCoCg(texelFetch(sceneColor, neighbour, 0).rgb);
+			minColor = min(minColor, neighbourColor);
+			maxColor = max(maxColor, neighbourColor);
+			depth = min(depth, texelFetch(sceneDepth, neighbour, 0).r);
+		}
+	}
+
+	// Pixels at the far plane only see the skybox, all others the model.
+	vec2 uv = (vec2(pixel) + 0.5) / vec2(size);
+	vec4 previousPosition = ((depth >= parameters.y) ? skyReprojectionMatrix : reprojectionMatrix) * vec4(uv, depth, 1.0);
+	vec2 previousUV = (previousPosition.xy / previousPosition.w) * 0.5 + 0.5;
+
+	float historyWeight = parameters.x;
+	if(previousPosition.w <= 0.0 || any(lessThan(previousUV, vec2(0.0))) || any(greaterThan(previousUV, vec2(1.0)))) {
+		historyWeight = 0.0;
+	}
+
+	vec3 result = color;
+	if(historyWeight > 0.0) {
+		vec3 history = textureLod(historyColor, previousUV, 0.0).rgb;
+		history = YCoCgToRGB(clamp(RGBToYCoCg(history), minColor, maxColor));
+
+		float currentWeight = (1.0 - historyWeight) * luminanceWeight(color);
+		float previousWeight = historyWeight * luminanceWeight(history);
+		result = (color * currentWeight + history * previousWeight) / (currentWeight + previousWeight);
+	}
+	imageStore(outputColor, pixel, vec4(result, 1.0));
+}
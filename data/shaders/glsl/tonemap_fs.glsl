@@ -5,24 +5,40 @@
 // Tone-mapping & gamma correction.
 
 const float gamma     = 2.2;
-const float exposure  = 1.0;
 const float pureWhite = 1.0;
 
 #if VULKAN
+// With dynamic resolution scene occupies only part of the render target, so it is sampled & upscaled instead of loaded.
+layout(constant_id=0) const bool upscale = false;
 layout(input_attachment_index=0, set=0, binding=0) uniform subpassInput sceneColor;
+layout(set=0, binding=1) uniform sampler2D sceneTexture;
+layout(push_constant) uniform SceneRegionConstants
+{
+	vec4 sceneRegion;
+};
+layout(set=0, binding=2, std430) readonly buffer Exposure
 #else
-layout(location=0) in  vec2 screenPosition;
 layout(binding=0) uniform sampler2D sceneColor;
+layout(location=0) uniform vec4 sceneRegion;
+layout(binding=1, std430) readonly buffer Exposure
 #endif // VULKAN
+{
+	float averageLuminance;
+	float exposure; // Written by exposure_cs with automatic exposure, otherwise 1.0
+};
+
+layout(location=0) in  vec2 screenPosition;
 
 layout(location=0) out vec4 outColor;
 
 void main()
 {
+	// Scene region xy is fraction of render target covered by scaled viewport, zw are texture coordinates clamped half a texel inside of it.
+	vec2 texcoord = min(screenPosition * sceneRegion.xy, sceneRegion.zw);
 #if VULKAN
-	vec3 color = subpassLoad(sceneColor).rgb * exposure;
+	vec3 color = (upscale ? texture(sceneTexture, texcoord).rgb : subpassLoad(sceneColor).rgb) * exposure;
 #else
-	vec3 color = texture(sceneColor, screenPosition).rgb * exposure;
+	vec3 color = texture(sceneColor, texcoord).rgb * exposure;
 #endif // VULKAN
 
 	// Reinhard tonemapping operator.
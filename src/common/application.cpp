@@ -7,11 +7,15 @@
 #include <GLFW/glfw3.h>
 
 #include "application.hpp"
+#include "framearena.hpp"
+#include "profiler.hpp"
+#include "startup.hpp"
 
 namespace {
 	const int DisplaySizeX = 1024;
 	const int DisplaySizeY = 1024;
 	const int DisplaySamples = 16;
+	const int DisplaySamplesTAA = 1;
 
 	const float ViewDistance = 150.0f;
 	const float ViewFOV      = 45.0f;
@@ -23,6 +27,7 @@ Application::Application()
 	: m_window(nullptr)
 	, m_prevCursorX(0.0)
 	, m_prevCursorY(0.0)
+	, m_numEnvironments(1)
 	, m_mode(InputMode::None)
 {
 	if(!glfwInit()) {
@@ -49,10 +54,24 @@ Application::~Application()
 	glfwTerminate();
 }
 
-void Application::run(const std::unique_ptr<RendererInterface>& renderer)
+void Application::run(const std::unique_ptr<RendererInterface>& renderer, const RendererSettings& settings)
 {
+	if(!settings.traceFilename.empty()) {
+		Profiler::start();
+	}
+	StartupReport::start();
+
 	glfwWindowHint(GLFW_RESIZABLE, 0);
-	m_window = renderer->initialize(DisplaySizeX, DisplaySizeY, DisplaySamples);
+	int samples = settings.msaaSamples;
+	if(samples <= 0) {
+		samples = settings.temporalAA ? DisplaySamplesTAA : DisplaySamples;
+	}
+	{
+		PROFILE_ZONE("initialize");
+		m_window = renderer->initialize(DisplaySizeX, DisplaySizeY, samples, settings);
+	}
+	m_numEnvironments = (int)settings.environments.size();
+	StartupReport::beginPhase("setup");
 
 	glfwSetWindowUserPointer(m_window, this);
 	glfwSetCursorPosCallback(m_window, Application::mousePositionCallback);
@@ -60,13 +79,33 @@ void Application::run(const std::unique_ptr<RendererInterface>& renderer)
 	glfwSetScrollCallback(m_window, Application::mouseScrollCallback);
 	glfwSetKeyCallback(m_window, Application::keyCallback);
 
-	renderer->setup();
-	while(!glfwWindowShouldClose(m_window)) {
-		renderer->render(m_window, m_viewSettings, m_sceneSettings);
-		glfwPollEvents();
+	{
+		PROFILE_ZONE("setup");
+		renderer->setup();
+	}
+	if(settings.benchmark != BenchmarkKind::None) {
+		StartupReport::finish(settings.startupReportFilename);
+		renderer->runBenchmark(settings.benchmark, m_window, m_viewSettings, m_sceneSettings);
+	}
+	else {
+		StartupReport::beginPhase("first frame");
+		while(!glfwWindowShouldClose(m_window)) {
+			PROFILE_ZONE("frame");
+			AllocationCounter::beginFrame();
+			renderer->render(m_window, m_viewSettings, m_sceneSettings);
+			AllocationCounter::endFrame();
+			StartupReport::finish(settings.startupReportFilename);
+			glfwPollEvents();
+		}
 	}
 
-	renderer->shutdown();
+	{
+		PROFILE_ZONE("shutdown");
+		renderer->shutdown();
+	}
+	if(!settings.traceFilename.empty()) {
+		Profiler::writeChromeTrace(settings.traceFilename);
+	}
 }
 
 void Application::mousePositionCallback(GLFWwindow* window, double xpos, double ypos)
@@ -145,6 +184,12 @@ void Application::keyCallback(GLFWwindow* window, int key, int scancode, int act
 		case GLFW_KEY_F3:
 			light = &self->m_sceneSettings.lights[2];
 			break;
+		case GLFW_KEY_F4:
+			self->m_sceneSettings.environment = (self->m_sceneSettings.environment + 1) % self->m_numEnvironments;
+			break;
+		case GLFW_KEY_F5:
+			++self->m_sceneSettings.memoryReportRequest;
+			break;
 		}
 
 		if(light) {
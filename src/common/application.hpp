@@ -14,7 +14,7 @@ public:
 	Application();
 	~Application();
 
-	void run(const std::unique_ptr<RendererInterface>& renderer);
+	void run(const std::unique_ptr<RendererInterface>& renderer, const RendererSettings& settings);
 
 private:
 	static void mousePositionCallback(GLFWwindow* window, double xpos, double ypos);
@@ -28,6 +28,7 @@ private:
 
 	ViewSettings m_viewSettings;
 	SceneSettings m_sceneSettings;
+	int m_numEnvironments;
 
 	enum class InputMode
 	{
@@ -0,0 +1,19 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <stdexcept>
+
+#include "benchmark.hpp"
+
+void BenchmarkFile::write(const std::string& filename, const std::function<void(FILE*)>& writeContents, bool binary)
+{
+	FILE* file = std::fopen(filename.c_str(), binary ? "wb" : "w");
+	if(!file) {
+		throw std::runtime_error("Failed to open benchmark results file: " + filename);
+	}
+	writeContents(file);
+	std::fclose(file);
+	std::printf("Benchmark results written to %s\n", filename.c_str());
+}
@@ -0,0 +1,44 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <string>
+
+// Results file of a benchmark (-bench-*): contents are written by given function, file name is printed once it's done.
+class BenchmarkFile
+{
+public:
+	// Throws if the file cannot be created.
+	static void write(const std::string& filename, const std::function<void(FILE*)>& writeContents, bool binary=false);
+};
+
+// Base of benchmarks which render the default view repeatedly & average per-frame measurements of each configuration.
+class FrameBenchmark
+{
+public:
+	// Frames rendered before measurements start (lets driver & GPU clocks settle) & measured frames per configuration.
+	static constexpr int NumWarmupFrames = 16;
+	static constexpr int NumTimedFrames = 64;
+
+	// Running sum of a per-frame measurement, averaged when reported.
+	struct Average
+	{
+		double sum = 0.0;
+		int count = 0;
+
+		void add(double value)
+		{
+			sum += value;
+			++count;
+		}
+		double value() const
+		{
+			return (count > 0) ? sum / count : 0.0;
+		}
+	};
+};
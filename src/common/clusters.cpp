@@ -0,0 +1,358 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <thread>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "clusters.hpp"
+#include "profiler.hpp"
+
+namespace {
+	const float PI = 3.141592f;
+
+	// Binning is only split between worker threads above this many lights (waking them would dominate otherwise).
+	const int MinParallelLights = 512;
+
+	// Light range & intensity relative to model bounding radius & light count (denser lights are dimmer to keep overall exposure).
+	const float LightRangeScale = 0.25f;
+	const float LightIntensityScale = 0.5f;
+
+	bool intersects(const glm::vec3& center, float radius, const glm::vec3& min, const glm::vec3& max)
+	{
+		const glm::vec3 closest = glm::clamp(center, min, max);
+		const glm::vec3 delta = center - closest;
+		return glm::dot(delta, delta) <= radius * radius;
+	}
+}
+
+ClusteredLights::ClusteredLights()
+	: m_gridSize(0)
+	, m_width(0)
+	, m_height(0)
+	, m_projectionMatrix(0.0f)
+	, m_zNear(0.0f)
+	, m_zFar(0.0f)
+	, m_depthParameters(0.0f)
+	, m_updateMilliseconds(0.0)
+	, m_droppedIndices(0)
+{}
+
+void ClusteredLights::reset(int numLights, float modelRadius, int maxWidth, int maxHeight)
+{
+	m_sources.clear();
+	m_lights.clear();
+	m_bounds.clear();
+
+	numLights = std::min(numLights, int(MaxLights));
+	if(numLights >= MinParallelLights) {
+		const int numWorkers = int(std::max(1u, std::thread::hardware_concurrency())) - 1;
+		if(m_workers.numThreads() != numWorkers + 1) {
+			m_workers.start(numWorkers);
+		}
+	}
+	else {
+		m_workers.stop();
+	}
+	if(numLights <= 0) {
+		return;
+	}
+
+	// Fixed seed so that benchmark runs see the same light distribution.
+	std::mt19937 generator{1};
+	std::uniform_real_distribution<float> uniform{0.0f, 1.0f};
+
+	const float range = LightRangeScale * modelRadius;
+	const float intensity = LightIntensityScale * range * range / std::sqrt(float(numLights));
+
+	m_sources.resize(numLights);
+	for(int i=0; i<numLights; ++i) {
+		Source& source = m_sources[i];
+
+		// Uniformly distributed direction & distance within a shell around the model.
+		const float z = 2.0f * uniform(generator) - 1.0f;
+		const float phi = 2.0f * PI * uniform(generator);
+		const float r = std::sqrt(std::max(0.0f, 1.0f - z*z));
+		const float distance = modelRadius * (0.5f + uniform(generator));
+		source.position = distance * glm::vec3{r * std::cos(phi), r * std::sin(phi), z};
+
+		const glm::vec3 color = glm::vec3{uniform(generator), uniform(generator), uniform(generator)};
+		source.radiance = intensity * color / std::max(color.r, std::max(color.g, color.b));
+		source.range = range;
+		source.orbitSpeed = uniform(generator) - 0.5f;
+
+		// Spot lights point roughly towards the model.
+		if(i % 2 == 1) {
+			const glm::vec3 target = 0.5f * modelRadius * (glm::vec3{uniform(generator), uniform(generator), uniform(generator)} - 0.5f);
+			source.direction = glm::normalize(target - source.position);
+			const float cosOuter = std::cos(glm::radians(20.0f + 25.0f * uniform(generator)));
+			const float cosInner = std::cos(0.75f * std::acos(cosOuter));
+			source.spotScale = 1.0f / std::max(cosInner - cosOuter, 1e-4f);
+			source.spotOffset = -cosOuter * source.spotScale;
+		}
+		else {
+			source.direction = glm::vec3{0.0f, -1.0f, 0.0f};
+			source.spotScale = 0.0f;
+			source.spotOffset = 1.0f;
+		}
+	}
+	m_lights.resize(numLights);
+	m_bounds.resize(numLights);
+
+	const int maxFroxels = numClusters(maxWidth, maxHeight);
+	m_froxels.reserve(maxFroxels);
+	m_froxelCounts.reserve(maxFroxels);
+	m_grid.reserve(maxFroxels);
+	m_indices.reserve(MaxLightIndices);
+}
+
+void ClusteredLights::update(double time, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, int width, int height, float zNear, float zFar)
+{
+	PROFILE_ZONE("ClusteredLights::update");
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	if(m_projectionMatrix != projectionMatrix || m_width != width || m_height != height || m_zNear != zNear || m_zFar != zFar) {
+		updateFroxels(projectionMatrix, width, height, zNear, zFar);
+	}
+	m_depthParameters = -glm::vec4{viewMatrix[0][2], viewMatrix[1][2], viewMatrix[2][2], viewMatrix[3][2]};
+
+	const int numLights = (int)m_sources.size();
+
+	// Move lights & compute their view space bounds.
+	m_workers.parallelFor(numLights, [this, time, &viewMatrix, &projectionMatrix](int begin, int end) {
+		PROFILE_ZONE("ClusteredLights::moveLights");
+		for(int i=begin; i<end; ++i) {
+			const Source& source = m_sources[i];
+			const glm::mat3 orbit = glm::mat3(glm::rotate(glm::mat4{1.0f}, float(source.orbitSpeed * time), glm::vec3{0.0f, 1.0f, 0.0f}));
+			m_lights[i].positionRange = glm::vec4{orbit * source.position, source.range};
+			m_lights[i].radianceSpotScale = glm::vec4{source.radiance, source.spotScale};
+			m_lights[i].directionSpotOffset = glm::vec4{orbit * source.direction, source.spotOffset};
+			m_bounds[i] = lightBounds(viewMatrix, projectionMatrix, i);
+		}
+	});
+
+	// Count lights of each froxel, each thread owns a range of depth slices.
+	m_workers.parallelFor(NumSlices, [this](int begin, int end) {
+		PROFILE_ZONE("ClusteredLights::countLights");
+		countLights(begin, end);
+	});
+
+	// Lay froxel lists out one after another in a single index list (truncated once it is full).
+	uint32_t numIndices = 0;
+	m_droppedIndices = 0;
+	for(size_t froxel=0; froxel<m_froxelCounts.size(); ++froxel) {
+		const uint32_t count = std::min(m_froxelCounts[froxel], uint32_t(MaxLightIndices) - numIndices);
+		m_grid[froxel] = glm::uvec2{ numIndices, count };
+		m_droppedIndices += int(m_froxelCounts[froxel] - count);
+		numIndices += count;
+	}
+	m_indices.resize(numIndices);
+
+	// Write lights into their froxels' lists.
+	m_workers.parallelFor(NumSlices, [this](int begin, int end) {
+		PROFILE_ZONE("ClusteredLights::binLights");
+		binLights(begin, end);
+	});
+
+	m_updateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+glm::vec4 ClusteredLights::sliceParameters() const
+{
+	const float logDepthRange = std::log(m_zFar / m_zNear);
+	return glm::vec4{ NumSlices / logDepthRange, -NumSlices * std::log(m_zNear) / logDepthRange, 0.0f, 0.0f };
+}
+
+glm::uvec4 ClusteredLights::gridParameters() const
+{
+	return glm::uvec4{ glm::uvec3(m_gridSize), m_sources.empty() ? 0 : 1 };
+}
+
+int ClusteredLights::numClusters(int width, int height)
+{
+	return ((width + TileSize - 1) / TileSize) * ((height + TileSize - 1) / TileSize) * NumSlices;
+}
+
+double ClusteredLights::averageClusterLights() const
+{
+	size_t numFroxels = 0;
+	for(const glm::uvec2& froxel : m_grid) {
+		numFroxels += (froxel.y > 0) ? 1 : 0;
+	}
+	return (numFroxels > 0) ? double(m_indices.size()) / double(numFroxels) : 0.0;
+}
+
+int ClusteredLights::maxClusterLights() const
+{
+	uint32_t maxLights = 0;
+	for(const glm::uvec2& froxel : m_grid) {
+		maxLights = std::max(maxLights, froxel.y);
+	}
+	return int(maxLights);
+}
+
+void ClusteredLights::updateFroxels(const glm::mat4& projectionMatrix, int width, int height, float zNear, float zFar)
+{
+	m_gridSize = glm::ivec3{ (width + TileSize - 1) / TileSize, (height + TileSize - 1) / TileSize, NumSlices };
+	m_width = width;
+	m_height = height;
+	m_projectionMatrix = projectionMatrix;
+	m_zNear = zNear;
+	m_zFar = zFar;
+
+	const int numFroxels = m_gridSize.x * m_gridSize.y * m_gridSize.z;
+	m_froxels.resize(numFroxels);
+	m_froxelCounts.resize(numFroxels);
+	m_grid.resize(numFroxels);
+
+	// View space point at given NDC position & depth (symmetric projection: clip space w equals depth).
+	auto unproject = [&projectionMatrix](float x, float y, float depth) {
+		return glm::vec3{ x * depth / projectionMatrix[0][0], y * depth / projectionMatrix[1][1], -depth };
+	};
+
+	for(int slice=0; slice<m_gridSize.z; ++slice) {
+		const float nearDepth = zNear * std::pow(zFar / zNear, float(slice) / NumSlices);
+		const float farDepth = zNear * std::pow(zFar / zNear, float(slice+1) / NumSlices);
+		for(int y=0; y<m_gridSize.y; ++y) {
+			const float y0 = 2.0f * float(y * TileSize) / height - 1.0f;
+			const float y1 = std::min(2.0f * float((y+1) * TileSize) / height - 1.0f, 1.0f);
+			for(int x=0; x<m_gridSize.x; ++x) {
+				const float x0 = 2.0f * float(x * TileSize) / width - 1.0f;
+				const float x1 = std::min(2.0f * float((x+1) * TileSize) / width - 1.0f, 1.0f);
+
+				AABB& froxel = m_froxels[(slice * m_gridSize.y + y) * m_gridSize.x + x];
+				froxel.min = glm::vec3{std::numeric_limits<float>::max()};
+				froxel.max = glm::vec3{-std::numeric_limits<float>::max()};
+				for(float depth : { nearDepth, farDepth }) {
+					for(const glm::vec2& corner : { glm::vec2{x0, y0}, glm::vec2{x1, y0}, glm::vec2{x0, y1}, glm::vec2{x1, y1} }) {
+						const glm::vec3 p = unproject(corner.x, corner.y, depth);
+						froxel.min = glm::min(froxel.min, p);
+						froxel.max = glm::max(froxel.max, p);
+					}
+				}
+			}
+		}
+	}
+}
+
+ClusteredLights::Bounds ClusteredLights::lightBounds(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, int light) const
+{
+	const Light& source = m_lights[light];
+	const float range = source.positionRange.w;
+	const glm::vec3 position = glm::vec3{source.positionRange};
+
+	// Tighter bounding sphere of a spot light cone: centered on its axis, through apex & cap rim (or cap circle for wide cones).
+	glm::vec3 center = position;
+	float radius = range;
+	if(source.radianceSpotScale.w > 0.0f) {
+		const glm::vec3 direction = glm::vec3{source.directionSpotOffset};
+		const float cosOuter = -source.directionSpotOffset.w / source.radianceSpotScale.w;
+		if(cosOuter > 0.7071f) {
+			radius = range / (2.0f * cosOuter);
+			center = position + radius * direction;
+		}
+		else {
+			radius = range * std::sqrt(std::max(0.0f, 1.0f - cosOuter * cosOuter));
+			center = position + range * cosOuter * direction;
+		}
+	}
+
+	Bounds bounds;
+	bounds.center = glm::vec3{viewMatrix * glm::vec4{center, 1.0f}};
+	bounds.radius = radius;
+	bounds.minSlice = 0;
+	bounds.maxSlice = -1;
+
+	const float minDepth = -bounds.center.z - radius;
+	const float maxDepth = -bounds.center.z + radius;
+	if(maxDepth < m_zNear || minDepth > m_zFar) {
+		return bounds;
+	}
+
+	// Slices of nearest & farthest point within froxel depth range.
+	const glm::vec4 slice = sliceParameters();
+	auto depthSlice = [this, &slice](float depth) {
+		return glm::clamp(int(std::floor(std::log(glm::clamp(depth, m_zNear, m_zFar)) * slice.x + slice.y)), 0, NumSlices-1);
+	};
+	bounds.minSlice = depthSlice(minDepth);
+	bounds.maxSlice = depthSlice(maxDepth);
+
+	// Sphere crossing near plane may cover any part of the screen.
+	bounds.minTile = glm::ivec2{0};
+	bounds.maxTile = glm::ivec2{m_gridSize.x - 1, m_gridSize.y - 1};
+	if(minDepth <= m_zNear) {
+		return bounds;
+	}
+
+	// Otherwise it projects within the screen space rectangle enclosing projected corners of its bounding box.
+	glm::vec2 minNDC{std::numeric_limits<float>::max()};
+	glm::vec2 maxNDC{-std::numeric_limits<float>::max()};
+	for(int corner=0; corner<8; ++corner) {
+		const glm::vec3 offset = glm::vec3{(corner & 1) ? radius : -radius, (corner & 2) ? radius : -radius, (corner & 4) ? radius : -radius};
+		const glm::vec4 clip = projectionMatrix * glm::vec4{bounds.center + offset, 1.0f};
+		const glm::vec2 ndc = glm::vec2{clip} / clip.w;
+		minNDC = glm::min(minNDC, ndc);
+		maxNDC = glm::max(maxNDC, ndc);
+	}
+	if(glm::any(glm::lessThan(maxNDC, glm::vec2{-1.0f})) || glm::any(glm::greaterThan(minNDC, glm::vec2{1.0f}))) {
+		bounds.maxSlice = -1;
+		return bounds;
+	}
+
+	const glm::vec2 screenSize = glm::vec2{float(m_width), float(m_height)};
+	const glm::ivec2 minTile = glm::ivec2{glm::floor((0.5f * minNDC + 0.5f) * screenSize / float(TileSize))};
+	const glm::ivec2 maxTile = glm::ivec2{glm::floor((0.5f * maxNDC + 0.5f) * screenSize / float(TileSize))};
+	bounds.minTile = glm::max(minTile, bounds.minTile);
+	bounds.maxTile = glm::min(maxTile, bounds.maxTile);
+	return bounds;
+}
+
+template<typename Func> void ClusteredLights::forEachFroxelLight(int minSlice, int maxSlice, const Func& func) const
+{
+	for(size_t light=0; light<m_bounds.size(); ++light) {
+		const Bounds& bounds = m_bounds[light];
+		const int sliceBegin = std::max(bounds.minSlice, minSlice);
+		const int sliceEnd = std::min(bounds.maxSlice + 1, maxSlice);
+		for(int slice=sliceBegin; slice<sliceEnd; ++slice) {
+			for(int y=bounds.minTile.y; y<=bounds.maxTile.y; ++y) {
+				for(int x=bounds.minTile.x; x<=bounds.maxTile.x; ++x) {
+					const int froxel = (slice * m_gridSize.y + y) * m_gridSize.x + x;
+					if(intersects(bounds.center, bounds.radius, m_froxels[froxel].min, m_froxels[froxel].max)) {
+						func(froxel, uint32_t(light));
+					}
+				}
+			}
+		}
+	}
+}
+
+void ClusteredLights::countLights(int minSlice, int maxSlice)
+{
+	const int tilesPerSlice = m_gridSize.x * m_gridSize.y;
+	std::fill(m_froxelCounts.begin() + minSlice * tilesPerSlice, m_froxelCounts.begin() + maxSlice * tilesPerSlice, 0u);
+	forEachFroxelLight(minSlice, maxSlice, [this](int froxel, uint32_t light) {
+		++m_froxelCounts[froxel];
+	});
+}
+
+void ClusteredLights::binLights(int minSlice, int maxSlice)
+{
+	// Lights past a truncated list's end are dropped.
+	const int tilesPerSlice = m_gridSize.x * m_gridSize.y;
+	std::fill(m_froxelCounts.begin() + minSlice * tilesPerSlice, m_froxelCounts.begin() + maxSlice * tilesPerSlice, 0u);
+	forEachFroxelLight(minSlice, maxSlice, [this](int froxel, uint32_t light) {
+		const glm::uvec2& list = m_grid[froxel];
+		uint32_t& position = m_froxelCounts[froxel];
+		if(position < list.y) {
+			m_indices[list.x + position] = light;
+		}
+		++position;
+	});
+}
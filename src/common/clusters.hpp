@@ -0,0 +1,126 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "workerpool.hpp"
+
+// Clustered forward shading of dynamic point & spot lights. View frustum is split into froxels: screen space tiles times
+// depth slices distributed exponentially between near & far plane. Every frame lights are moved along their orbits, transformed
+// into view space & binned into all froxels their bounding spheres overlap; pbr_fs then only iterates lights of its own froxel.
+// Lights are first counted per froxel, which gives each froxel's offset into a single flat index list, & then written into it.
+// Both passes are split by depth slices between persistent worker threads (see WorkerPool, only started for large light counts)
+// so that each froxel is counted & written by a single thread.
+class ClusteredLights
+{
+public:
+	// Must match ClusterTileSize in pbr_fs shader.
+	static const int TileSize = 64;
+	static const int NumSlices = 24;
+	// Capacity of light & light index buffers (froxel lists are truncated once index list is full).
+	static const int MaxLights = 16 * 1024;
+	static const int MaxLightIndices = 1024 * 1024;
+
+	// Shader light record (std430): world space position & range, radiance & spot cone scale, spot direction & cone offset.
+	// Angular attenuation is saturate(dot(-L, direction) * scale + offset)^2, point lights have zero scale & unit offset.
+	struct Light
+	{
+		glm::vec4 positionRange;
+		glm::vec4 radianceSpotScale;
+		glm::vec4 directionSpotOffset;
+	};
+
+	ClusteredLights();
+
+	// Scatter given number of lights (every other one a spot light) with random colors & orbits around model of given bounding radius.
+	// Froxel & index storage is allocated for viewports up to given size, so that updates never touch the heap.
+	void reset(int numLights, float modelRadius, int maxWidth, int maxHeight);
+	int numLights() const { return (int)m_sources.size(); }
+
+	// Move lights to their orbit positions at given time (in seconds) & bin them into froxels of given view.
+	// Projection must be a symmetric perspective projection (Y axis may be flipped), froxels span zNear to zFar.
+	void update(double time, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, int width, int height, float zNear, float zFar);
+
+	const std::vector<Light>& lights() const { return m_lights; }
+	// Per froxel offset into index list (x) & number of lights (y); froxel index is (slice * tilesY + tileY) * tilesX + tileX.
+	const std::vector<glm::uvec2>& grid() const { return m_grid; }
+	const std::vector<uint32_t>& indices() const { return m_indices; }
+
+	// Shading parameters: view space depth of world position p is dot(depthParameters, vec4(p, 1)), its depth slice is
+	// log(depth) * x + y of sliceParameters & gridParameters are froxel counts along each axis (w: non-zero if there are lights to shade).
+	const glm::vec4& depthParameters() const { return m_depthParameters; }
+	glm::vec4 sliceParameters() const;
+	glm::uvec4 gridParameters() const;
+
+	// Number of froxels for given framebuffer size (GPU grid buffer capacity).
+	static int numClusters(int width, int height);
+
+	// Statistics of last update: CPU time of animation & binning, average & maximum number of lights per non-empty froxel
+	// and number of light indices which did not fit into index list.
+	double updateMilliseconds() const { return m_updateMilliseconds; }
+	double averageClusterLights() const;
+	int maxClusterLights() const;
+	int droppedIndices() const { return m_droppedIndices; }
+
+private:
+	struct Source
+	{
+		glm::vec3 position;  // Orbit position at time zero.
+		glm::vec3 direction; // Spot direction at time zero.
+		glm::vec3 radiance;
+		float range;
+		float spotScale;
+		float spotOffset;
+		float orbitSpeed;    // Angular speed around vertical axis (radians per second).
+	};
+
+	// View space bounding sphere of a light & range of froxels it may overlap (empty if minSlice > maxSlice).
+	struct Bounds
+	{
+		glm::vec3 center;
+		float radius;
+		int minSlice, maxSlice;
+		glm::ivec2 minTile, maxTile;
+	};
+
+	struct AABB
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+
+	void updateFroxels(const glm::mat4& projectionMatrix, int width, int height, float zNear, float zFar);
+	Bounds lightBounds(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, int light) const;
+	// Run for each froxel of given depth slices with list of lights overlapping it.
+	template<typename Func> void forEachFroxelLight(int minSlice, int maxSlice, const Func& func) const;
+	void countLights(int minSlice, int maxSlice);
+	void binLights(int minSlice, int maxSlice);
+
+	std::vector<Source> m_sources;
+	std::vector<Light> m_lights;
+	std::vector<Bounds> m_bounds;
+
+	// View space bounds of froxels (rebuilt when projection changes) & number of lights overlapping each of them (before
+	// truncation, also used as each froxel's write position while binning).
+	std::vector<AABB> m_froxels;
+	std::vector<uint32_t> m_froxelCounts;
+	glm::ivec3 m_gridSize;
+	int m_width, m_height;
+	glm::mat4 m_projectionMatrix;
+	float m_zNear, m_zFar;
+
+	std::vector<glm::uvec2> m_grid;
+	std::vector<uint32_t> m_indices;
+	glm::vec4 m_depthParameters;
+
+	double m_updateMilliseconds;
+	int m_droppedIndices;
+
+	WorkerPool m_workers;
+};
@@ -0,0 +1,137 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "dynres.hpp"
+
+namespace {
+	// Lowest fraction of framebuffer size rendered & amount by which resolution is raised.
+	const float MinScale = 0.5f;
+	const float ScaleStep = 0.05f;
+	// Weight of the latest frame in exponentially smoothed frame time.
+	const double SmoothingFactor = 0.1;
+	// Quality is only raised once smoothed frame time falls below this fraction of the budget (hysteresis band).
+	const double HeadroomRatio = 0.8;
+	// Number of consecutive frames over or under budget before quality changes.
+	const int SettleFrames = 10;
+	// Frames to skip after a change (timings of frames already in flight still reflect previous settings).
+	const int CooldownFrames = 8;
+
+	// Sample counts step through powers of two, so a non power of two maximum (e.g. 6x) is only ever used as the top step.
+	int lowerSampleCount(int samples)
+	{
+		int lower = 1;
+		while(lower * 2 < samples) {
+			lower *= 2;
+		}
+		return lower;
+	}
+	int higherSampleCount(int samples)
+	{
+		int higher = 1;
+		while(higher <= samples) {
+			higher *= 2;
+		}
+		return higher;
+	}
+}
+
+DynamicResolution::DynamicResolution()
+{
+	reset(0.0f, 1, false);
+}
+
+void DynamicResolution::reset(float budgetMilliseconds, int maxSamples, bool scaleSamples)
+{
+	m_budget = budgetMilliseconds;
+	m_maxSamples = std::max(maxSamples, 1);
+	m_minSamples = scaleSamples ? std::min(m_maxSamples, 2) : m_maxSamples;
+
+	m_scale = 1.0f;
+	m_samples = m_maxSamples;
+
+	m_averageMilliseconds = 0.0;
+	m_overBudgetFrames = 0;
+	m_underBudgetFrames = 0;
+	m_cooldownFrames = CooldownFrames;
+
+	m_numFrames = 0;
+	m_numChanges = 0;
+	m_totalScale = 0.0;
+	m_totalMilliseconds = 0.0;
+}
+
+bool DynamicResolution::update(double frameMilliseconds)
+{
+	++m_numFrames;
+	m_totalScale += m_scale;
+	m_totalMilliseconds += frameMilliseconds;
+
+	if(m_cooldownFrames > 0) {
+		if(--m_cooldownFrames == 0) {
+			m_averageMilliseconds = frameMilliseconds;
+		}
+		return false;
+	}
+	m_averageMilliseconds += SmoothingFactor * (frameMilliseconds - m_averageMilliseconds);
+
+	if(m_averageMilliseconds > m_budget) {
+		++m_overBudgetFrames;
+		m_underBudgetFrames = 0;
+	}
+	else if(m_averageMilliseconds < m_budget * HeadroomRatio) {
+		++m_underBudgetFrames;
+		m_overBudgetFrames = 0;
+	}
+	else {
+		m_overBudgetFrames = 0;
+		m_underBudgetFrames = 0;
+	}
+
+	const float previousScale = m_scale;
+	const int previousSamples = m_samples;
+	if(m_overBudgetFrames >= SettleFrames) {
+		if(m_samples > m_minSamples) {
+			m_samples = std::max(lowerSampleCount(m_samples), m_minSamples);
+		}
+		else {
+			// Cost is roughly proportional to pixel count, so scale both dimensions by square root of the overshoot.
+			const float targetScale = m_scale * float(std::sqrt(m_budget / m_averageMilliseconds));
+			m_scale = std::max(std::min(targetScale, m_scale - ScaleStep), MinScale);
+		}
+	}
+	else if(m_underBudgetFrames >= SettleFrames) {
+		if(m_scale < 1.0f) {
+			m_scale = std::min(m_scale + ScaleStep, 1.0f);
+		}
+		else if(m_samples < m_maxSamples) {
+			m_samples = std::min(higherSampleCount(m_samples), m_maxSamples);
+		}
+	}
+
+	if(m_scale == previousScale && m_samples == previousSamples) {
+		return false;
+	}
+	m_overBudgetFrames = 0;
+	m_underBudgetFrames = 0;
+	m_cooldownFrames = CooldownFrames;
+	++m_numChanges;
+	return true;
+}
+
+glm::ivec2 DynamicResolution::viewportSize(int width, int height) const
+{
+	return glm::max(glm::ivec2{glm::vec2{float(width), float(height)} * m_scale + 0.5f}, glm::ivec2{1});
+}
+
+void DynamicResolution::report() const
+{
+	const int numFrames = std::max(m_numFrames, 1);
+	std::printf("Dynamic resolution (%.2f ms budget): %d changes in %d frames, average scale %.2f, %.3f ms per frame, final scale %.2f with %dx MSAA\n",
+		m_budget, m_numChanges, m_numFrames, m_totalScale / numFrames, m_totalMilliseconds / numFrames, m_scale, m_samples);
+}
@@ -0,0 +1,52 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Dynamic resolution: keeps GPU frame time within a budget by rendering the scene into a scaled viewport of the offscreen
+// target (tone mapping then upscales it to the window) & optionally by lowering the number of MSAA samples.
+// Frame times are smoothed & quality only changes after the budget has been missed (or undercut by a safe margin) for a number
+// of consecutive frames; after each change the controller waits for frames rendered with the new settings before deciding again.
+// Over budget, samples are lowered first (in power of two steps, down to 2x) & then resolution is lowered; under budget, resolution is restored first.
+class DynamicResolution
+{
+public:
+	DynamicResolution();
+
+	// Start at full resolution with given number of samples (1 for no MSAA), which is also the maximum; samples are only scaled if requested.
+	void reset(float budgetMilliseconds, int maxSamples, bool scaleSamples);
+	bool enabled() const { return m_budget > 0.0f; }
+
+	// Account GPU time of a completed frame, returns true if scale or number of samples changed.
+	bool update(double frameMilliseconds);
+
+	float scale() const { return m_scale; }
+	int samples() const { return m_samples; }
+	// Size of scaled viewport for given framebuffer size (at least one pixel).
+	glm::ivec2 viewportSize(int width, int height) const;
+
+	// Print number of changes, average scale & frame time.
+	void report() const;
+
+private:
+	float m_budget;
+	int m_maxSamples;
+	int m_minSamples;
+
+	float m_scale;
+	int m_samples;
+
+	double m_averageMilliseconds;
+	int m_overBudgetFrames;
+	int m_underBudgetFrames;
+	int m_cooldownFrames;
+
+	int m_numFrames;
+	int m_numChanges;
+	double m_totalScale;
+	double m_totalMilliseconds;
+};
@@ -0,0 +1,250 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "envcache.hpp"
+#include "profiler.hpp"
+#include "renderer.hpp"
+#include "startup.hpp"
+
+namespace {
+	const uint32_t BakeMagic   = 0x4C424950; // "PIBL"
+	const uint32_t BakeVersion = 2;
+
+	struct BakeHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		int32_t envMapSize;
+		int32_t envMapLevels;
+		int32_t irmapSize;
+		uint32_t settingsHash;
+		// Environment image file the bake was computed from.
+		uint64_t sourceSize;
+		int64_t sourceTime;
+	};
+
+	void querySourceFile(const std::string& environmentFilename, BakeHeader& header)
+	{
+		struct stat info;
+		if(stat(environmentFilename.c_str(), &info) != 0) {
+			throw std::runtime_error("Could not query environment image file: " + environmentFilename);
+		}
+		header.sourceSize = uint64_t(info.st_size);
+		header.sourceTime = int64_t(info.st_mtime);
+	}
+
+	// FNV-1a
+	void hashBytes(uint32_t& hash, const void* data, size_t size)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+		for(size_t i=0; i<size; ++i) {
+			hash = (hash ^ bytes[i]) * 16777619u;
+		}
+	}
+}
+
+size_t EnvironmentCache::Bake::envMapLevelOffset(int level) const
+{
+	size_t offset = 0;
+	for(int i=0, size=envMapSize; i<level; ++i, size=std::max(size/2, 1)) {
+		offset += 6 * size_t(size) * size;
+	}
+	return offset;
+}
+
+size_t EnvironmentCache::Bake::irmapOffset() const
+{
+	return envMapLevelOffset(envMapLevels);
+}
+
+size_t EnvironmentCache::Bake::numTexels() const
+{
+	return irmapOffset() + 6 * size_t(irmapSize) * irmapSize;
+}
+
+EnvironmentCache::EnvironmentCache()
+	: m_clock(0)
+{}
+
+void EnvironmentCache::reset(int numSlots)
+{
+	m_slots.assign(numSlots, Slot{ -1, 0 });
+	m_clock = 0;
+}
+
+int EnvironmentCache::lookup(int environment) const
+{
+	for(int slot=0; slot<numSlots(); ++slot) {
+		if(m_slots[slot].environment == environment) {
+			return slot;
+		}
+	}
+	return -1;
+}
+
+int EnvironmentCache::allocate(int environment, std::initializer_list<int> inUse)
+{
+	int victim = -1;
+	for(int slot=0; slot<numSlots(); ++slot) {
+		if(std::find(inUse.begin(), inUse.end(), slot) != inUse.end()) {
+			continue;
+		}
+		// Free slots have never been used so they always win.
+		if(victim == -1 || m_slots[slot].lastUsed < m_slots[victim].lastUsed) {
+			victim = slot;
+		}
+	}
+	if(victim != -1) {
+		m_slots[victim].environment = environment;
+		touch(victim);
+	}
+	return victim;
+}
+
+void EnvironmentCache::release(int slot)
+{
+	m_slots[slot].environment = -1;
+	m_slots[slot].lastUsed = 0;
+}
+
+void EnvironmentCache::touch(int slot)
+{
+	m_slots[slot].lastUsed = ++m_clock;
+}
+
+int EnvironmentCache::numSlotsForBudget(double budgetMegabytes, size_t slotSize, int minSlots, int maxSlots)
+{
+	const int numSlots = int(budgetMegabytes * 1024.0 * 1024.0 / double(slotSize));
+	return std::max(minSlots, std::min(numSlots, maxSlots));
+}
+
+size_t EnvironmentCache::slotSize(int envMapSize, int envMapLevels, int irmapSize)
+{
+	const Bake layout = { envMapSize, envMapLevels, irmapSize };
+	return layout.numTexels() * 4 * sizeof(uint16_t);
+}
+
+std::string EnvironmentCache::bakeFilename(const std::string& environmentFilename)
+{
+	return environmentFilename + ".ibl";
+}
+
+bool EnvironmentCache::bakeExists(const std::string& environmentFilename)
+{
+	return std::ifstream{bakeFilename(environmentFilename), std::ios::binary}.is_open();
+}
+
+uint32_t EnvironmentCache::bakeSettingsHash(const RendererSettings& settings)
+{
+	const uint8_t sampleTables = settings.iblSampleTables ? 1 : 0;
+	const uint8_t envImportanceSampling = settings.iblEnvImportanceSampling ? 1 : 0;
+
+	uint32_t hash = 2166136261u;
+	hashBytes(hash, &settings.iblSampleErrorTarget, sizeof(settings.iblSampleErrorTarget));
+	hashBytes(hash, &sampleTables, sizeof(sampleTables));
+	hashBytes(hash, &envImportanceSampling, sizeof(envImportanceSampling));
+	return hash;
+}
+
+void EnvironmentCache::saveBake(const std::string& environmentFilename, uint32_t settingsHash, const Bake& bake)
+{
+	PROFILE_ZONE("EnvironmentCache::saveBake");
+	BakeHeader header = { BakeMagic, BakeVersion, bake.envMapSize, bake.envMapLevels, bake.irmapSize, settingsHash, 0, 0 };
+	querySourceFile(environmentFilename, header);
+
+	const std::string filename = bakeFilename(environmentFilename);
+	const std::string tempFilename = filename + ".tmp";
+	std::ofstream file{tempFilename, std::ios::binary};
+	if(!file.is_open()) {
+		throw std::runtime_error("Could not create environment bake file: " + tempFilename);
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	// Alpha is unused and RGB9E5 keeps enough precision for pre-filtered radiance at half the size of RGBA16F.
+	const size_t numTexels = bake.numTexels();
+	std::vector<uint32_t> packed(numTexels);
+	for(size_t i=0; i<numTexels; ++i) {
+		const uint16_t* texel = &bake.texels[4*i];
+		const glm::vec3 color = { glm::unpackHalf1x16(texel[0]), glm::unpackHalf1x16(texel[1]), glm::unpackHalf1x16(texel[2]) };
+		packed[i] = glm::packF3x9_E1x5(color);
+	}
+	file.write(reinterpret_cast<const char*>(packed.data()), packed.size() * sizeof(uint32_t));
+	file.close();
+	if(!file.good()) {
+		std::remove(tempFilename.c_str());
+		throw std::runtime_error("Failed to write environment bake file: " + tempFilename);
+	}
+
+	// Renaming over an existing file fails on Windows.
+	if(std::rename(tempFilename.c_str(), filename.c_str()) != 0) {
+		std::remove(filename.c_str());
+		if(std::rename(tempFilename.c_str(), filename.c_str()) != 0) {
+			std::remove(tempFilename.c_str());
+			throw std::runtime_error("Failed to replace environment bake file: " + filename);
+		}
+	}
+}
+
+std::shared_ptr<EnvironmentCache::Bake> EnvironmentCache::loadBake(const std::string& environmentFilename, uint32_t settingsHash, int envMapSize, int envMapLevels, int irmapSize)
+{
+	PROFILE_ZONE("EnvironmentCache::loadBake");
+	BakeHeader source = {};
+	querySourceFile(environmentFilename, source);
+
+	const std::string filename = bakeFilename(environmentFilename);
+	std::ifstream file{filename, std::ios::binary};
+	if(!file.is_open()) {
+		throw std::runtime_error("Could not open environment bake file: " + filename);
+	}
+
+	BakeHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if(!file.good() || header.magic != BakeMagic || header.version != BakeVersion) {
+		throw std::runtime_error("Invalid environment bake file: " + filename);
+	}
+	// Checked before sizing the texel buffer by the header, so a corrupt header can't request an arbitrarily large allocation.
+	if(header.envMapSize != envMapSize || header.envMapLevels != envMapLevels || header.irmapSize != irmapSize) {
+		throw std::runtime_error("Environment bake file has mismatched dimensions: " + filename);
+	}
+	if(header.sourceSize != source.sourceSize || header.sourceTime != source.sourceTime) {
+		throw std::runtime_error("Environment bake file is out of date with its environment image: " + filename);
+	}
+	if(header.settingsHash != settingsHash) {
+		throw std::runtime_error("Environment bake file was computed with different IBL settings: " + filename);
+	}
+
+	std::shared_ptr<Bake> bake{new Bake{ header.envMapSize, header.envMapLevels, header.irmapSize }};
+
+	const size_t numTexels = bake->numTexels();
+	std::vector<uint32_t> packed(numTexels);
+	file.read(reinterpret_cast<char*>(packed.data()), packed.size() * sizeof(uint32_t));
+	if(!file.good()) {
+		throw std::runtime_error("Truncated environment bake file: " + filename);
+	}
+	StartupReport::addBytesRead(sizeof(header) + packed.size() * sizeof(uint32_t));
+
+	bake->texels.resize(4 * numTexels);
+	for(size_t i=0; i<numTexels; ++i) {
+		const glm::vec3 color = glm::unpackF3x9_E1x5(packed[i]);
+		uint16_t* texel = &bake->texels[4*i];
+		texel[0] = glm::packHalf1x16(color.r);
+		texel[1] = glm::packHalf1x16(color.g);
+		texel[2] = glm::packHalf1x16(color.b);
+		texel[3] = glm::packHalf1x16(1.0f);
+	}
+	return bake;
+}
@@ -0,0 +1,82 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct RendererSettings;
+
+// Keeps track of which environments currently reside in a fixed number of GPU "slots" (sets of pre-filtered specular
+// & irradiance maps) and picks least recently used slot for eviction. Evicted environments are backed by compact on-disk
+// bakes (RGB9E5 encoded pre-filtered maps) which can be read back asynchronously instead of being pre-filtered again.
+class EnvironmentCache
+{
+public:
+	struct Bake
+	{
+		Bake(int envMapSize=0, int envMapLevels=0, int irmapSize=0)
+			: envMapSize(envMapSize)
+			, envMapLevels(envMapLevels)
+			, irmapSize(irmapSize)
+		{}
+
+		int envMapSize;
+		int envMapLevels;
+		int irmapSize;
+		// RGBA half float texels: specular env map mip chain (6 faces per level) followed by irradiance map (6 faces).
+		std::vector<uint16_t> texels;
+
+		size_t envMapLevelOffset(int level) const;
+		size_t irmapOffset() const;
+		size_t numTexels() const;
+	};
+
+	EnvironmentCache();
+
+	void reset(int numSlots);
+	int numSlots() const { return (int)m_slots.size(); }
+
+	// Returns slot holding given environment or -1 if it's not resident.
+	int lookup(int environment) const;
+	int environment(int slot) const { return m_slots[slot].environment; }
+
+	// Assign a slot to given environment, evicting least recently used environment if no slot is free.
+	// Slots listed in inUse (-1 entries are ignored) are never evicted. Returns -1 if no slot is available.
+	int allocate(int environment, std::initializer_list<int> inUse);
+	// Mark slot contents as invalid (e.g. when its pre-filtering has been abandoned).
+	void release(int slot);
+	// Mark slot as most recently used.
+	void touch(int slot);
+
+	// Number of slots fitting into given budget (clamped to [minSlots, maxSlots]).
+	static int numSlotsForBudget(double budgetMegabytes, size_t slotSize, int minSlots, int maxSlots);
+	// Device memory size of a single slot with RGBA16F pre-filtered maps.
+	static size_t slotSize(int envMapSize, int envMapLevels, int irmapSize);
+
+	static std::string bakeFilename(const std::string& environmentFilename);
+	static bool bakeExists(const std::string& environmentFilename);
+	// Hash of the settings which change pre-filtered map contents (sample counts & sample placement).
+	static uint32_t bakeSettingsHash(const RendererSettings& settings);
+	// Bake of given environment image is written to a temporary file first & renamed into place, so an interrupted write
+	// never leaves a partial bake behind. Size & modification time of the image file are recorded along with settings hash.
+	static void saveBake(const std::string& environmentFilename, uint32_t settingsHash, const Bake& bake);
+	// Throws if the bake file is invalid, truncated, its map sizes differ from the expected ones or it is stale, i.e. the
+	// environment image file has changed or the bake was computed with different settings.
+	static std::shared_ptr<Bake> loadBake(const std::string& environmentFilename, uint32_t settingsHash, int envMapSize, int envMapLevels, int irmapSize);
+
+private:
+	struct Slot
+	{
+		int environment;
+		uint64_t lastUsed;
+	};
+	std::vector<Slot> m_slots;
+	uint64_t m_clock;
+};
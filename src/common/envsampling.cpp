@@ -0,0 +1,165 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include "envsampling.hpp"
+#include "profiler.hpp"
+#include "image.hpp"
+
+namespace {
+	const double PI = 3.141592;
+
+	// Solid angle of a single cell in given row of equirectangular grid.
+	double cellSolidAngle(int row, int width, int height)
+	{
+		const double cosTheta0 = std::cos(PI * row / height);
+		const double cosTheta1 = std::cos(PI * (row + 1) / height);
+		return 2.0 * PI / width * (cosTheta0 - cosTheta1);
+	}
+}
+
+EnvironmentDistribution EnvironmentDistribution::build(const Image& image, int maxWidth, unsigned int numThreads)
+{
+	PROFILE_ZONE("EnvironmentDistribution::build");
+	if(!image.isHDR() || image.channels() < 3) {
+		throw std::runtime_error("Environment distribution requires RGB HDR image");
+	}
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	EnvironmentDistribution distribution;
+	distribution.m_width  = std::min(image.width(), maxWidth);
+	distribution.m_height = std::max(1, image.height() * distribution.m_width / image.width());
+
+	const int width  = distribution.m_width;
+	const int height = distribution.m_height;
+	const size_t numCells = size_t(width) * height;
+
+	// Average luminance of source texels covered by each cell, weighted by cell solid angle.
+	std::vector<double> weights(numCells);
+	auto computeWeights = [&image, &weights, width, height](int rowBegin, int rowEnd) {
+		PROFILE_ZONE("EnvironmentDistribution::computeWeights");
+		const float* pixels = image.pixels<float>();
+		const int channels = image.channels();
+		for(int y=rowBegin; y<rowEnd; ++y) {
+			const int srcY0 = y * image.height() / height;
+			const int srcY1 = std::max(srcY0 + 1, (y + 1) * image.height() / height);
+			const double solidAngle = cellSolidAngle(y, width, height);
+			for(int x=0; x<width; ++x) {
+				const int srcX0 = x * image.width() / width;
+				const int srcX1 = std::max(srcX0 + 1, (x + 1) * image.width() / width);
+
+				double luminance = 0.0;
+				for(int srcY=srcY0; srcY<srcY1; ++srcY) {
+					const float* texel = &pixels[(size_t(srcY) * image.width() + srcX0) * channels];
+					for(int srcX=srcX0; srcX<srcX1; ++srcX, texel+=channels) {
+						const double value = 0.2126 * texel[0] + 0.7152 * texel[1] + 0.0722 * texel[2];
+						if(std::isfinite(value) && value > 0.0) {
+							luminance += value;
+						}
+					}
+				}
+				luminance /= double(srcX1 - srcX0) * (srcY1 - srcY0);
+				weights[size_t(y) * width + x] = luminance * solidAngle;
+			}
+		}
+	};
+
+	if(numThreads == 0) {
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	numThreads = std::min(numThreads, unsigned(height));
+	{
+		std::vector<std::thread> workers;
+		const int rowsPerThread = (height + numThreads - 1) / numThreads;
+		for(unsigned int i=1; i<numThreads; ++i) {
+			workers.emplace_back(computeWeights, std::min(height, int(i) * rowsPerThread), std::min(height, int(i+1) * rowsPerThread));
+		}
+		computeWeights(0, std::min(height, rowsPerThread));
+		for(std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+
+	double totalWeight = 0.0;
+	for(double weight : weights) {
+		totalWeight += weight;
+	}
+	// Black environment: fall back to uniform sphere sampling.
+	if(totalWeight <= 0.0) {
+		for(int y=0; y<height; ++y) {
+			std::fill_n(weights.begin() + size_t(y) * width, width, cellSolidAngle(y, width, height));
+		}
+		totalWeight = 4.0 * PI;
+	}
+
+	// Build alias table using Vose's method.
+	distribution.m_entries.resize(numCells);
+	std::vector<double> scaled(numCells);
+	std::vector<uint32_t> small, large;
+	small.reserve(numCells);
+	large.reserve(numCells);
+	for(size_t i=0; i<numCells; ++i) {
+		const int y = int(i / width);
+		distribution.m_entries[i].pdf = float(weights[i] / (totalWeight * cellSolidAngle(y, width, height)));
+
+		scaled[i] = weights[i] * numCells / totalWeight;
+		if(scaled[i] < 1.0) {
+			small.push_back(uint32_t(i));
+		}
+		else {
+			large.push_back(uint32_t(i));
+		}
+	}
+	while(!small.empty() && !large.empty()) {
+		const uint32_t less = small.back();
+		const uint32_t more = large.back();
+		small.pop_back();
+		large.pop_back();
+
+		distribution.m_entries[less].threshold = float(scaled[less]);
+		distribution.m_entries[less].alias = more;
+
+		scaled[more] = (scaled[more] + scaled[less]) - 1.0;
+		if(scaled[more] < 1.0) {
+			small.push_back(more);
+		}
+		else {
+			large.push_back(more);
+		}
+	}
+	// Remaining entries are (up to numerical error) exactly full.
+	for(uint32_t i : large) {
+		distribution.m_entries[i].threshold = 1.0f;
+		distribution.m_entries[i].alias = i;
+	}
+	for(uint32_t i : small) {
+		distribution.m_entries[i].threshold = 1.0f;
+		distribution.m_entries[i].alias = i;
+	}
+
+	const std::chrono::duration<double, std::milli> buildTime = std::chrono::high_resolution_clock::now() - startTime;
+	std::printf("Built environment alias table (%dx%d) in %.2f ms using %u threads\n", width, height, buildTime.count(), numThreads);
+	return distribution;
+}
+
+size_t EnvironmentDistribution::bufferSize() const
+{
+	return 2 * sizeof(uint32_t) + m_entries.size() * sizeof(Entry);
+}
+
+void EnvironmentDistribution::copyToBuffer(void* buffer) const
+{
+	const uint32_t header[] = { uint32_t(m_width), uint32_t(m_height) };
+	std::memcpy(buffer, header, sizeof(header));
+	std::memcpy(reinterpret_cast<char*>(buffer) + sizeof(header), m_entries.data(), m_entries.size() * sizeof(Entry));
+}
@@ -0,0 +1,43 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Image;
+
+// Piecewise constant distribution of environment radiance over a (downsampled) equirectangular grid, stored as an alias
+// table (Vose's method) for O(1) importance sampling of bright directions on the GPU. Cells span equal ranges of phi and
+// cos(theta) so that sampling uniformly within a cell yields constant density per solid angle.
+// Buffer layout matches EnvironmentDistribution block in irmap_cs shader.
+class EnvironmentDistribution
+{
+public:
+	struct Entry
+	{
+		float threshold;  // Probability of keeping this cell (otherwise alias is taken).
+		uint32_t alias;   // Alternative cell index.
+		float pdf;        // Sampling density of this cell (per steradian).
+	};
+
+	// Builds distribution from luminance of HDR equirectangular image (downsampled to at most maxWidth columns).
+	// Downsampling is split across numThreads worker threads (0 selects hardware concurrency).
+	static EnvironmentDistribution build(const Image& image, int maxWidth=512, unsigned int numThreads=0);
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+	const std::vector<Entry>& entries() const { return m_entries; }
+
+	size_t bufferSize() const;
+	void copyToBuffer(void* buffer) const;
+
+private:
+	int m_width = 0;
+	int m_height = 0;
+	std::vector<Entry> m_entries;
+};
@@ -0,0 +1,53 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "exposure.hpp"
+
+namespace {
+	// Luminance range covered by the histogram (about 1/1000 of a moonless night to direct sunlight on bright surfaces).
+	const float MinLogLuminance = -10.0f;
+	const float MaxLogLuminance = 6.0f;
+	// Rate (per second) at which adapted luminance approaches the current one.
+	const float AdaptationRate = 1.5f;
+	// Average scene luminance is exposed to middle grey.
+	const float KeyValue = 0.18f;
+}
+
+AutoExposure::AutoExposure()
+	: m_previousTime(-1.0)
+	, m_numTimedFrames(0)
+	, m_totalMilliseconds(0.0)
+{}
+
+AutoExposure::Parameters AutoExposure::update(double time, int width, int height)
+{
+	// First frame has nothing to adapt from (exposure_cs also starts over if there is no adapted luminance yet).
+	const float elapsedTime = (m_previousTime >= 0.0) ? float(time - m_previousTime) : 0.0f;
+	m_previousTime = time;
+
+	const float logLuminanceRange = MaxLogLuminance - MinLogLuminance;
+
+	Parameters parameters;
+	parameters.histogramRange = glm::vec4{MinLogLuminance, 1.0f / logLuminanceRange, logLuminanceRange, 0.0f};
+	parameters.adaptation = glm::vec4{1.0f - std::exp(-elapsedTime * AdaptationRate), KeyValue, 0.0f, 0.0f};
+	parameters.region = glm::uvec4{uint32_t(width), uint32_t(height), uint32_t(width) * uint32_t(height), 0};
+	return parameters;
+}
+
+void AutoExposure::addPassTime(double ms)
+{
+	m_totalMilliseconds += ms;
+	++m_numTimedFrames;
+}
+
+void AutoExposure::report() const
+{
+	std::printf("Auto exposure: histogram & adaptation %.3f ms per frame (GPU, average of %d frames)\n",
+		m_totalMilliseconds / std::max(m_numTimedFrames, 1), m_numTimedFrames);
+}
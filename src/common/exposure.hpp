@@ -0,0 +1,40 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Automatic exposure: histogram_cs bins log2 luminance of the resolved scene (shared memory histogram per thread group added to
+// a global one), exposure_cs then averages it (ignoring black pixels), adapts towards the result over time & writes exposure
+// for tone mapping into a tiny buffer. Everything stays on the GPU, the CPU only supplies parameters & accumulates pass timings.
+class AutoExposure
+{
+public:
+	static const int NumBins = 256; // Must match histogram_cs & exposure_cs.
+
+	// Shader parameters (std140 uniform block in OpenGL, push constants in Vulkan).
+	struct Parameters
+	{
+		glm::vec4 histogramRange; // x: minimum log2 luminance, y: inverse of log2 luminance range, z: log2 luminance range
+		glm::vec4 adaptation;     // x: weight of this frame's average luminance, y: key value (exposed average luminance)
+		glm::uvec4 region;        // xy: size of scene region (scaled viewport), z: number of its pixels
+	};
+
+	AutoExposure();
+
+	// Parameters for this frame: scene occupies width x height pixels at the origin of the render target, adaptation weight
+	// follows from time elapsed since previous call (given in seconds).
+	Parameters update(double time, int width, int height);
+
+	// Accumulate GPU time of histogram & adaptation passes & print its average on exit.
+	void addPassTime(double ms);
+	void report() const;
+
+private:
+	double m_previousTime;
+	int m_numTimedFrames;
+	double m_totalMilliseconds;
+};
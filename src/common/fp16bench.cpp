@@ -0,0 +1,99 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+#include "fp16bench.hpp"
+
+HalfPrecisionBenchmark::HalfPrecisionBenchmark()
+	: m_width(0)
+	, m_height(0)
+	, m_bottomUp(false)
+{}
+
+void HalfPrecisionBenchmark::addFrame(bool halfPrecision, double gpuMs)
+{
+	m_results[halfPrecision ? 1 : 0].gpuMs.add(gpuMs);
+}
+
+void HalfPrecisionBenchmark::setImage(bool halfPrecision, int width, int height, std::vector<float>&& pixels, bool bottomUp)
+{
+	if(size_t(width) * size_t(height) * 3 != pixels.size()) {
+		throw std::runtime_error("Half precision benchmark image has unexpected size");
+	}
+	m_width = width;
+	m_height = height;
+	m_bottomUp = bottomUp;
+	m_results[halfPrecision ? 1 : 0].pixels = std::move(pixels);
+}
+
+void HalfPrecisionBenchmark::report(const std::string& backend, const std::string& device) const
+{
+	const std::vector<float>& reference = m_results[0].pixels;
+	const std::vector<float>& pixels = m_results[1].pixels;
+	if(reference.empty() || reference.size() != pixels.size()) {
+		throw std::runtime_error("Half precision benchmark is missing scene color of one of the modes");
+	}
+
+	// Error of linear scene color & number of pixels whose difference would still show after a simple x/(1+x) tone curve
+	// quantized to 8 bits (tone mapping itself is not part of the comparison).
+	const size_t numPixels = reference.size() / 3;
+	double sumSquaredError = 0.0;
+	double sumAbsError = 0.0;
+	double sumReference = 0.0;
+	double maxError = 0.0;
+	size_t numVisiblePixels = 0;
+	std::vector<unsigned char> errorImage(reference.size());
+	for(size_t i=0; i<numPixels; ++i) {
+		bool visible = false;
+		for(size_t c=3*i; c<3*i+3; ++c) {
+			const double error = std::abs(double(pixels[c]) - double(reference[c]));
+			sumSquaredError += error * error;
+			sumAbsError += error;
+			sumReference += std::abs(double(reference[c]));
+			maxError = std::max(maxError, error);
+			const double value = std::max(double(pixels[c]), 0.0);
+			const double referenceValue = std::max(double(reference[c]), 0.0);
+			const double displayError = std::abs(value / (1.0 + value) - referenceValue / (1.0 + referenceValue));
+			visible = visible || displayError * 255.0 >= 1.0;
+
+			// Error image is written top to bottom.
+			const size_t x = i % m_width;
+			const size_t y = m_bottomUp ? (m_height - 1 - i / m_width) : (i / m_width);
+			errorImage[3 * (y * m_width + x) + (c - 3*i)] = (unsigned char)(std::min(error * ErrorImageScale, 1.0) * 255.0 + 0.5);
+		}
+		numVisiblePixels += visible ? 1 : 0;
+	}
+	const double rmse = std::sqrt(sumSquaredError / double(reference.size()));
+	const double relativeError = (sumReference > 0.0) ? sumAbsError / sumReference : 0.0;
+	const double visiblePercentage = 100.0 * double(numVisiblePixels) / double(numPixels);
+
+	const char* modeNames[] = { "fp32", "fp16" };
+
+	std::printf("Half precision benchmark (%s, %s): averages of %d frames\n", backend.c_str(), device.c_str(), NumTimedFrames);
+	double gpuMs[2];
+	for(int mode=0; mode<2; ++mode) {
+		gpuMs[mode] = m_results[mode].gpuMs.value();
+		std::printf("  %s: scene %7.3f ms (GPU)\n", modeNames[mode], gpuMs[mode]);
+	}
+	std::printf("  Saved %.3f ms (%.1f%%)\n", gpuMs[0] - gpuMs[1], (gpuMs[0] > 0.0) ? 100.0 * (gpuMs[0] - gpuMs[1]) / gpuMs[0] : 0.0);
+	std::printf("  Scene color error: RMSE %.6f, max %.6f, relative %.4f%%, %.3f%% of pixels differ after 8-bit tone curve\n",
+		rmse, maxError, 100.0 * relativeError, visiblePercentage);
+
+	BenchmarkFile::write("fp16_benchmark_" + backend + ".csv", [&](FILE* file) {
+		std::fprintf(file, "backend,device,half_precision,gpu_scene_ms,rmse,max_error,relative_error,visible_pixels_pct\n");
+		std::fprintf(file, "%s,\"%s\",0,%.4f,0,0,0,0\n", backend.c_str(), device.c_str(), gpuMs[0]);
+		std::fprintf(file, "%s,\"%s\",1,%.4f,%.6f,%.6f,%.6f,%.4f\n", backend.c_str(), device.c_str(), gpuMs[1], rmse, maxError, relativeError, visiblePercentage);
+	});
+
+	// Binary PPM, readable by most image viewers without any additional dependency.
+	BenchmarkFile::write("fp16_error_" + backend + ".ppm", [&](FILE* file) {
+		std::fprintf(file, "P6\n%d %d\n255\n", m_width, m_height);
+		std::fwrite(errorImage.data(), 1, errorImage.size(), file);
+	}, true);
+}
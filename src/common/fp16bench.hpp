@@ -0,0 +1,43 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+// Half precision shading benchmark (-bench-fp16): renders the default view with full & then half precision pbr_fs variant,
+// reports GPU time of the main scene pass & error of the last half precision frame's scene color (linear HDR, before tone
+// mapping) compared with the last full precision one. Results are written as CSV & the error as an image.
+class HalfPrecisionBenchmark : public FrameBenchmark
+{
+public:
+	// Absolute error is scaled by this factor in the error image (so errors of 1/64 and above saturate).
+	static constexpr float ErrorImageScale = 64.0f;
+
+	HalfPrecisionBenchmark();
+
+	// Record one measured frame rendered in full or half precision.
+	void addFrame(bool halfPrecision, double gpuMs);
+	// Scene color (RGB) of the last frame rendered in full or half precision, rows ordered bottom to top if bottomUp is set.
+	void setImage(bool halfPrecision, int width, int height, std::vector<float>&& pixels, bool bottomUp);
+
+	// Print averages of both modes & error statistics, write them to fp16_benchmark_<backend>.csv & per-pixel absolute
+	// error to fp16_error_<backend>.ppm.
+	void report(const std::string& backend, const std::string& device) const;
+
+private:
+	struct Result
+	{
+		Average gpuMs;
+		std::vector<float> pixels;
+	};
+	Result m_results[2];
+	int m_width;
+	int m_height;
+	bool m_bottomUp;
+};
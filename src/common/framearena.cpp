@@ -0,0 +1,145 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "framearena.hpp"
+
+FrameArena::FrameArena(size_t capacity)
+	: m_block(new uint8_t[capacity])
+	, m_capacity(capacity)
+	, m_used(0)
+	, m_overflowBytes(0)
+{}
+
+FrameArena::~FrameArena()
+{
+	for(void* allocation : m_overflow) {
+		std::free(allocation);
+	}
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+	const uintptr_t base = reinterpret_cast<uintptr_t>(m_block.get());
+	const uintptr_t aligned = (base + m_used + alignment - 1) & ~uintptr_t(alignment - 1);
+	const size_t end = size_t(aligned - base) + size;
+	if(end <= m_capacity) {
+		m_used = end;
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	// Block is full: fall back to the heap for the rest of this frame (over-allocated to honor any alignment).
+	void* allocation = std::malloc(size + alignment);
+	if(!allocation) {
+		throw std::bad_alloc();
+	}
+	m_overflow.push_back(allocation);
+	m_overflowBytes += size + alignment;
+	return reinterpret_cast<void*>((reinterpret_cast<uintptr_t>(allocation) + alignment - 1) & ~uintptr_t(alignment - 1));
+}
+
+void FrameArena::reset()
+{
+	if(!m_overflow.empty()) {
+		for(void* allocation : m_overflow) {
+			std::free(allocation);
+		}
+		m_overflow.clear();
+
+		m_capacity = std::max(2 * m_capacity, m_used + m_overflowBytes);
+		m_block.reset(new uint8_t[m_capacity]);
+		m_overflowBytes = 0;
+		AllocationCounter::allowFrame();
+	}
+	m_used = 0;
+}
+
+#ifndef NDEBUG
+
+namespace {
+	thread_local bool t_counting = false;
+	thread_local uint64_t t_frameAllocations = 0;
+
+	bool g_frameAllowed = false;
+	int g_frame = 0;
+
+	void* countedAllocate(std::size_t size)
+	{
+		if(t_counting) {
+			++t_frameAllocations;
+		}
+		void* ptr = std::malloc(size > 0 ? size : 1);
+		if(!ptr) {
+			throw std::bad_alloc();
+		}
+		return ptr;
+	}
+}
+
+// Array & sized forms are replaced as well, so that every allocation is counted & freed the same way regardless of
+// how the standard library implements their defaults.
+void* operator new(std::size_t size)
+{
+	return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return countedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void AllocationCounter::beginFrame()
+{
+	t_frameAllocations = 0;
+	t_counting = true;
+	g_frameAllowed = false;
+}
+
+void AllocationCounter::endFrame()
+{
+	t_counting = false;
+	if(++g_frame > WarmupFrames && !g_frameAllowed && t_frameAllocations > 0) {
+		std::fprintf(stderr, "Frame %d made %llu heap allocation(s) after warmup\n", g_frame, (unsigned long long)t_frameAllocations);
+		assert(t_frameAllocations == 0);
+	}
+}
+
+void AllocationCounter::allowFrame()
+{
+	g_frameAllowed = true;
+}
+
+#else
+
+void AllocationCounter::beginFrame() {}
+void AllocationCounter::endFrame() {}
+void AllocationCounter::allowFrame() {}
+
+#endif // NDEBUG
@@ -0,0 +1,88 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Linear allocator for short lived data of a single frame: allocations bump a pointer within one block & are all released at
+// once by reset() at the start of the next frame. Allocations which do not fit go to the heap & the block is grown to the
+// frame's high water mark on reset, so that steady state frames do not touch the heap at all.
+class FrameArena
+{
+public:
+	static const size_t DefaultCapacity = 64 * 1024;
+
+	explicit FrameArena(size_t capacity=DefaultCapacity);
+	~FrameArena();
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	void* allocate(size_t size, size_t alignment);
+	void reset();
+
+	size_t capacity() const { return m_capacity; }
+	size_t used() const { return m_used; }
+
+private:
+	std::unique_ptr<uint8_t[]> m_block;
+	size_t m_capacity;
+	size_t m_used;
+	size_t m_overflowBytes;
+	std::vector<void*> m_overflow;
+};
+
+// STL allocator adapter drawing from a frame arena (deallocation is a no-op). Containers using it must not outlive the frame.
+template<typename T> class FrameAllocator
+{
+public:
+	using value_type = T;
+
+	explicit FrameAllocator(FrameArena& arena)
+		: m_arena(&arena)
+	{}
+	template<typename U> FrameAllocator(const FrameAllocator<U>& other)
+		: m_arena(other.arena())
+	{}
+
+	T* allocate(size_t n)
+	{
+		return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+	}
+	void deallocate(T*, size_t) {}
+
+	FrameArena* arena() const { return m_arena; }
+
+private:
+	FrameArena* m_arena;
+};
+
+template<typename T, typename U> bool operator==(const FrameAllocator<T>& a, const FrameAllocator<U>& b)
+{
+	return a.arena() == b.arena();
+}
+template<typename T, typename U> bool operator!=(const FrameAllocator<T>& a, const FrameAllocator<U>& b)
+{
+	return a.arena() != b.arena();
+}
+
+template<typename T> using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+// Debug builds only (compiled out with NDEBUG): counts global operator new calls made by the rendering thread between
+// beginFrame() & endFrame() and asserts there were none once warmup frames have passed. Frames which do one-off work
+// (environment switch, resource re-creation, reports) call allowFrame() to be excluded from the check.
+class AllocationCounter
+{
+public:
+	static const int WarmupFrames = 60;
+
+	static void beginFrame();
+	static void endFrame();
+	static void allowFrame();
+};
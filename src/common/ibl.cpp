@@ -0,0 +1,253 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <glm/glm.hpp>
+
+#include "ibl.hpp"
+
+namespace {
+	// Conservative initial GPU throughput estimate, refined as soon as first timings arrive.
+	const double InitialNanosecondsPerSample = 1.0;
+	// Exponential moving average factor for throughput measurements.
+	const double ThroughputSmoothing = 0.25;
+	// Lower specular pre-filter sample count limit (must match MinNumSamples in spmap_cs shader).
+	const int MinSpecularSamples = 16;
+
+	const double PI = 3.141592;
+
+	// Van der Corput radical inverse (second Hammersley point coordinate).
+	double radicalInverse_VdC(uint32_t bits)
+	{
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return double(bits) * 2.3283064365386963e-10; // / 0x100000000
+	}
+}
+
+IBLScheduler::IBLScheduler()
+	: m_totalCost(0.0)
+	, m_pendingCost(0.0)
+	, m_nanosecondsPerSample(InitialNanosecondsPerSample)
+{}
+
+void IBLScheduler::queueEnvironmentConversion(int envMapSize)
+{
+	// These passes are bandwidth bound, count each output texel as a single sample.
+	const Slice::Pass passes[] = { Slice::ConvertEquirect, Slice::GenerateMipmaps, Slice::CopyBaseLevel };
+	for(Slice::Pass pass : passes) {
+		Slice slice = {};
+		slice.pass    = pass;
+		slice.cost    = 6.0 * envMapSize * envMapSize;
+		m_queue.push_back(slice);
+		m_totalCost   += slice.cost;
+		m_pendingCost += slice.cost;
+	}
+}
+
+void IBLScheduler::queueSpecularFilter(int envMapSize, int numLevels, float errorTarget, int maxSamples, int groupSize)
+{
+	const float deltaRoughness = 1.0f / std::max(float(numLevels-1), 1.0f);
+	const int tailLevel = specularMipTailLevel(envMapSize, numLevels, groupSize);
+
+	for(int level=1, size=envMapSize/2; level<tailLevel; ++level, size/=2) {
+		const int numSamples = specularSampleCount(level * deltaRoughness, errorTarget, maxSamples);
+		// Compute shaders process the output in square thread groups so split each face into bands of whole groups.
+		const int numRows = std::min(size, groupSize);
+		for(int face=0; face<6; ++face) {
+			for(int row=0; row<size; row+=numRows) {
+				Slice slice = {};
+				slice.pass    = Slice::SpecularFilter;
+				slice.level   = level;
+				slice.face    = face;
+				slice.row     = row;
+				slice.numRows = numRows;
+				slice.cost    = double(size) * numRows * numSamples;
+				m_queue.push_back(slice);
+				m_totalCost   += slice.cost;
+				m_pendingCost += slice.cost;
+			}
+		}
+	}
+
+	if(tailLevel < numLevels) {
+		Slice slice = {};
+		slice.pass  = Slice::SpecularFilterMipTail;
+		slice.level = tailLevel;
+		for(int level=tailLevel, size=std::max(envMapSize >> tailLevel, 1); level<numLevels; ++level, size=std::max(size/2, 1)) {
+			slice.cost += 6.0 * size * size * specularSampleCount(level * deltaRoughness, errorTarget, maxSamples);
+		}
+		m_queue.push_back(slice);
+		m_totalCost   += slice.cost;
+		m_pendingCost += slice.cost;
+	}
+}
+
+void IBLScheduler::queueIrradianceFilter(int irmapSize, int numSamples, int numBatches)
+{
+	for(int face=0; face<6; ++face) {
+		for(int batch=0; batch<numBatches; ++batch) {
+			Slice slice = {};
+			slice.pass       = Slice::IrradianceFilter;
+			slice.face       = face;
+			slice.batch      = batch;
+			slice.numBatches = numBatches;
+			slice.cost       = double(irmapSize) * irmapSize * (numSamples / numBatches);
+			m_queue.push_back(slice);
+			m_totalCost   += slice.cost;
+			m_pendingCost += slice.cost;
+		}
+	}
+}
+
+void IBLScheduler::nextSlices(double budgetMilliseconds, FrameVector<Slice>& slices)
+{
+	slices.clear();
+
+	const double budgetSamples = budgetMilliseconds * 1e6 / m_nanosecondsPerSample;
+	double cost = 0.0;
+	while(!m_queue.empty()) {
+		const Slice& slice = m_queue.front();
+		if(!slices.empty() && cost + slice.cost > budgetSamples) {
+			break;
+		}
+		cost += slice.cost;
+		m_pendingCost -= slice.cost;
+		slices.push_back(slice);
+		m_queue.pop_front();
+	}
+}
+
+void IBLScheduler::reportGPUTime(double cost, double milliseconds)
+{
+	if(cost <= 0.0 || milliseconds <= 0.0) {
+		return;
+	}
+	const double nanosecondsPerSample = milliseconds * 1e6 / cost;
+	m_nanosecondsPerSample += ThroughputSmoothing * (nanosecondsPerSample - m_nanosecondsPerSample);
+}
+
+void IBLScheduler::clear()
+{
+	m_queue.clear();
+	m_totalCost   = 0.0;
+	m_pendingCost = 0.0;
+}
+
+float IBLScheduler::progress() const
+{
+	if(m_totalCost <= 0.0) {
+		return 1.0f;
+	}
+	return float(1.0 - m_pendingCost / m_totalCost);
+}
+
+float IBLScheduler::irradianceSourceLod(int envMapSize, int numSamples)
+{
+	// Solid angle of a single uniform hemisphere sample vs. solid angle of a base level cubemap texel.
+	// See: https://developer.nvidia.com/gpugems/GPUGems3/gpugems3_ch20.html, section 20.4
+	const double ws = 2.0 * 3.141592 / numSamples;
+	const double wt = 4.0 * 3.141592 / (6.0 * envMapSize * envMapSize);
+	return float(std::max(0.5 * std::log2(ws / wt) + 1.0, 0.0));
+}
+
+int IBLScheduler::specularSampleCount(float roughness, float errorTarget, int maxSamples)
+{
+	if(errorTarget <= 0.0f) {
+		return maxSamples;
+	}
+	// Estimator noise scales with GGX lobe width (alpha) over square root of sample count.
+	const float alpha = roughness * roughness;
+	const float n = (alpha / errorTarget) * (alpha / errorTarget);
+	const int log2Samples = int(std::min(std::ceil(std::log2(std::max(n, 1.0f))), 31.0f));
+	const int64_t numSamples = int64_t(1) << log2Samples;
+	return int(std::max<int64_t>(MinSpecularSamples, std::min<int64_t>(numSamples, maxSamples)));
+}
+
+int IBLScheduler::specularMipTailLevel(int envMapSize, int numLevels, int groupSize)
+{
+	int level = 1;
+	for(int size=envMapSize/2; level<numLevels && size>=groupSize; ++level, size/=2) {}
+	return level;
+}
+
+int IBLScheduler::specularMipTailGroups(int tailSize, int numTailLevels, int groupSize)
+{
+	int numGroups = 0;
+	for(int level=0, size=tailSize; level<numTailLevels; ++level, size=std::max(size/2, 1)) {
+		numGroups += (6 * size * size + groupSize - 1) / groupSize;
+	}
+	return numGroups;
+}
+
+SpecularSampleTable SpecularSampleTable::build(int envMapSize, int numLevels, float errorTarget, int maxSamples)
+{
+	if(numLevels > MaxLevels) {
+		throw std::runtime_error("Too many environment map levels for specular sample table");
+	}
+
+	SpecularSampleTable table = {};
+
+	// Solid angle of a single base level source cubemap texel.
+	const double wt = 4.0 * PI / (6.0 * envMapSize * envMapSize);
+	const float deltaRoughness = 1.0f / std::max(float(numLevels-1), 1.0f);
+
+	// Mirrors importance sampling loop in spmap_cs: GGX half-vectors from Hammersley point set reflected around N=V=(0,0,1).
+	for(int level=1; level<numLevels; ++level) {
+		const double roughness = level * deltaRoughness;
+		const double alphaSq = std::pow(roughness, 4.0);
+		const int numSamples = IBLScheduler::specularSampleCount(float(roughness), errorTarget, maxSamples);
+
+		Level& tableLevel = table.levels[level];
+		tableLevel.offset = uint32_t(table.samples.size());
+
+		double weight = 0.0;
+		for(int i=0; i<numSamples; ++i) {
+			const double u1 = double(i) / numSamples;
+			const double u2 = radicalInverse_VdC(uint32_t(i));
+
+			const double cosTheta = std::sqrt((1.0 - u2) / (1.0 + (alphaSq - 1.0) * u2));
+			const double sinTheta = std::sqrt(1.0 - cosTheta*cosTheta);
+			const double phi = 2.0 * PI * u1;
+			const glm::dvec3 Lh = { sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta };
+			const glm::dvec3 Li = 2.0 * Lh.z * Lh - glm::dvec3(0.0, 0.0, 1.0);
+			if(Li.z <= 0.0) {
+				continue;
+			}
+
+			// Mipmap filtered importance sampling: source LOD matching solid angle of this sample.
+			const double denom = (cosTheta * cosTheta) * (alphaSq - 1.0) + 1.0;
+			const double pdf = alphaSq / (PI * denom * denom) * 0.25;
+			const double ws = 1.0 / (numSamples * pdf);
+			const double lod = std::max(0.5 * std::log2(ws / wt) + 1.0, 0.0);
+
+			table.samples.push_back(glm::vec4(glm::vec3(Li), float(lod)));
+			weight += Li.z;
+		}
+
+		tableLevel.count = uint32_t(table.samples.size()) - tableLevel.offset;
+		tableLevel.invWeight = (weight > 0.0) ? float(1.0 / weight) : 0.0f;
+	}
+	return table;
+}
+
+size_t SpecularSampleTable::bufferSize() const
+{
+	return sizeof(levels) + samples.size() * sizeof(glm::vec4);
+}
+
+void SpecularSampleTable::copyToBuffer(void* buffer) const
+{
+	std::memcpy(buffer, levels, sizeof(levels));
+	std::memcpy(reinterpret_cast<char*>(buffer) + sizeof(levels), samples.data(), samples.size() * sizeof(glm::vec4));
+}
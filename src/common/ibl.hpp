@@ -0,0 +1,100 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <glm/vec4.hpp>
+
+#include "framearena.hpp"
+
+// Splits image based lighting pre-processing (environment map conversion, specular & irradiance filtering) into small
+// units of work ("slices") which are then executed between frames within a per-frame GPU time budget. Slice cost is
+// expressed in number of environment map samples taken and converted to time using GPU throughput measured by the renderer.
+class IBLScheduler
+{
+public:
+	struct Slice
+	{
+		enum Pass {
+			ConvertEquirect,
+			GenerateMipmaps,
+			CopyBaseLevel,
+			SpecularFilter,
+			SpecularFilterMipTail,
+			IrradianceFilter,
+		};
+		Pass pass;
+		int level;      // Output mip level (first level of the mip tail for folded specular filter).
+		int face;       // Output cubemap face.
+		int row;        // First output row (specular filter only).
+		int numRows;    // Number of output rows (specular filter only).
+		int batch;      // Sample batch index (irradiance filter only).
+		int numBatches; // Total number of sample batches (irradiance filter only).
+		double cost;    // Number of environment map samples taken.
+	};
+
+	IBLScheduler();
+
+	// Queue equirectangular to cubemap conversion, unfiltered mip chain generation & base level copy.
+	void queueEnvironmentConversion(int envMapSize);
+
+	// Queue pre-filtering of specular environment map mip chain (levels 1..numLevels-1).
+	// Levels smaller than a thread group (mip tail) are pre-filtered by a single folded dispatch.
+	void queueSpecularFilter(int envMapSize, int numLevels, float errorTarget, int maxSamples, int groupSize);
+	// Queue diffuse irradiance map computation split into sample batches which are accumulated into the target.
+	void queueIrradianceFilter(int irmapSize, int numSamples, int numBatches);
+
+	// Pop slices which are estimated to fit into given budget (at least one slice is always returned if available).
+	void nextSlices(double budgetMilliseconds, FrameVector<Slice>& slices);
+	// Feed back measured GPU time of previously executed slices to refine throughput estimate.
+	void reportGPUTime(double cost, double milliseconds);
+
+	void clear();
+	bool empty() const { return m_queue.empty(); }
+	float progress() const;
+
+	// Source environment map LOD matching solid angle of a single uniform hemisphere sample.
+	static float irradianceSourceLod(int envMapSize, int numSamples);
+
+	// Specular pre-filter sample count for given roughness: smallest power of two keeping estimated noise below error target
+	// (non-positive error target always selects maxSamples). Must match numSamplesForRoughness() in spmap_cs shader.
+	static int specularSampleCount(float roughness, float errorTarget, int maxSamples);
+	// First specular environment map level smaller than a thread group (start of the folded mip tail).
+	static int specularMipTailLevel(int envMapSize, int numLevels, int groupSize);
+	// Number of 1D thread groups of given size needed to cover numTailLevels levels of the mip tail (each level starting at a new group).
+	static int specularMipTailGroups(int tailSize, int numTailLevels, int groupSize);
+
+private:
+	std::deque<Slice> m_queue;
+	double m_totalCost;
+	double m_pendingCost;
+	double m_nanosecondsPerSample;
+};
+
+// GGX importance sample directions for specular pre-filtering. These only depend on roughness & sample index so they are
+// generated once on the CPU instead of for every output texel. Buffer layout matches SampleTable block in spmap_cs shader.
+struct SpecularSampleTable
+{
+	static const int MaxLevels = 16;
+	struct Level
+	{
+		uint32_t offset;  // Index of first sample.
+		uint32_t count;   // Number of samples (samples below the horizon are dropped).
+		float invWeight;  // Reciprocal of total cosine weight.
+		float padding;
+	};
+	// Indexed by mip level (level 0 is not pre-filtered).
+	Level levels[MaxLevels];
+	// Tangent space incident direction (xyz, z doubles as cosine weight) & source environment map LOD (w).
+	std::vector<glm::vec4> samples;
+
+	static SpecularSampleTable build(int envMapSize, int numLevels, float errorTarget, int maxSamples);
+	size_t bufferSize() const;
+	void copyToBuffer(void* buffer) const;
+};
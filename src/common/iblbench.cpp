@@ -0,0 +1,191 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <cstdio>
+
+#include "iblbench.hpp"
+#include "benchmark.hpp"
+
+namespace {
+	const IBLBenchmark::Kernel Kernels[] = {
+		IBLBenchmark::Kernel::SpecularFilter,
+		IBLBenchmark::Kernel::Irradiance,
+		IBLBenchmark::Kernel::SpecularBRDF,
+	};
+
+	// Device names may contain characters which need escaping in JSON strings.
+	std::string jsonString(const std::string& value)
+	{
+		std::string result = "\"";
+		for(char c : value) {
+			if(c == '"' || c == '\\') {
+				result += '\\';
+			}
+			result += c;
+		}
+		return result + "\"";
+	}
+}
+
+std::vector<IBLBenchmark::Config> IBLBenchmark::sweep(Kernel kernel)
+{
+	std::vector<Config> configs;
+	switch(kernel) {
+	case Kernel::SpecularFilter:
+		// Reference relies on adaptive sample counts as well: full 8K samples per texel would take seconds for the largest levels
+		// while near mirror-like levels converge with few samples (see IBLScheduler::specularSampleCount).
+		configs.push_back({ kernel, 1024, 8 * 1024, 1.0f / 256.0f, false, 1 });
+		for(int size : { 256, 512, 1024 }) {
+			for(int numSamples : { 256, 1024 }) {
+				for(float errorTarget : { 1.0f / 16.0f, 1.0f / 32.0f, 1.0f / 64.0f }) {
+					configs.push_back({ kernel, size, numSamples, errorTarget, false, 1 });
+				}
+			}
+		}
+		break;
+	case Kernel::Irradiance:
+		// Unbiased uniform hemisphere sampling reference (split into batches to keep individual dispatches short).
+		configs.push_back({ kernel, 64, 256 * 1024, 0.0f, false, 16 });
+		for(int size : { 32, 64 }) {
+			for(int numSamples : { 4 * 1024, 16 * 1024, 64 * 1024 }) {
+				configs.push_back({ kernel, size, numSamples, 0.0f, false, 1 });
+			}
+			for(int numSamples : { 256, 1024, 4 * 1024 }) {
+				configs.push_back({ kernel, size, numSamples, 0.0f, true, 1 });
+			}
+		}
+		break;
+	case Kernel::SpecularBRDF:
+		configs.push_back({ kernel, 512, 4 * 1024, 0.0f, false, 1 });
+		for(int size : { 64, 128, 256, 512 }) {
+			for(int numSamples : { 64, 256, 1024 }) {
+				configs.push_back({ kernel, size, numSamples, 0.0f, false, 1 });
+			}
+		}
+		break;
+	}
+	return configs;
+}
+
+const char* IBLBenchmark::kernelName(const Config& config)
+{
+	switch(config.kernel) {
+	case Kernel::SpecularFilter:
+		return "spmap";
+	case Kernel::Irradiance:
+		return config.envImportanceSampling ? "irmap_mis" : "irmap";
+	case Kernel::SpecularBRDF:
+		return "spbrdf";
+	}
+	return "";
+}
+
+double IBLBenchmark::relativeError(const std::vector<glm::vec2>& results)
+{
+	double errorSum = 0.0;
+	double referenceSum = 0.0;
+	for(const glm::vec2& result : results) {
+		errorSum += result.x;
+		referenceSum += result.y;
+	}
+	return (referenceSum > 0.0) ? errorSum / referenceSum : 0.0;
+}
+
+void IBLBenchmark::addReference(const Config& config, double gpuMs)
+{
+	m_references.push_back({ config, gpuMs, 0.0, false });
+}
+
+void IBLBenchmark::addResult(const Config& config, double gpuMs, double error)
+{
+	m_results.push_back({ config, gpuMs, error, false });
+}
+
+void IBLBenchmark::report(const std::string& backend, const std::string& device) const
+{
+	// Configuration is Pareto-optimal if no other configuration of the same kernel is both at least as fast & at least as accurate
+	// (irradiance sampling strategies compete with each other since they produce the same map).
+	std::vector<Result> results = m_results;
+	for(Result& result : results) {
+		result.pareto = true;
+		for(const Result& other : m_results) {
+			if(other.config.kernel != result.config.kernel) {
+				continue;
+			}
+			const bool dominates = other.gpuMs <= result.gpuMs && other.error <= result.error && (other.gpuMs < result.gpuMs || other.error < result.error);
+			if(dominates) {
+				result.pareto = false;
+				break;
+			}
+		}
+	}
+
+	std::printf("IBL benchmark (%s, %s): * marks Pareto-optimal configurations\n", backend.c_str(), device.c_str());
+	for(const Result& reference : m_references) {
+		std::printf("  %-10s reference %4d %6d samples: %9.3f ms\n", kernelName(reference.config), reference.config.size, reference.config.numSamples, reference.gpuMs);
+	}
+	for(Kernel kernel : Kernels) {
+		for(const Result& result : results) {
+			if(result.config.kernel == kernel) {
+				std::printf("%c %-10s size %4d %6d samples (error target %.4f): %9.3f ms, error %.3f%%\n", result.pareto ? '*' : ' ',
+					kernelName(result.config), result.config.size, result.config.numSamples, result.config.sampleErrorTarget, result.gpuMs, 100.0 * result.error);
+			}
+		}
+	}
+
+	std::printf("Irradiance importance sampling check: %s\n", checkIrradianceSampling() ? "passed" : "FAILED");
+
+	BenchmarkFile::write("ibl_benchmark_" + backend + ".csv", [&](FILE* file) {
+		std::fprintf(file, "backend,device,kernel,size,samples,error_target,gpu_ms,error,pareto\n");
+		for(const Result& result : results) {
+			std::fprintf(file, "%s,\"%s\",%s,%d,%d,%g,%.4f,%.6f,%d\n", backend.c_str(), device.c_str(), kernelName(result.config),
+				result.config.size, result.config.numSamples, result.config.sampleErrorTarget, result.gpuMs, result.error, result.pareto ? 1 : 0);
+		}
+	});
+
+	BenchmarkFile::write("ibl_benchmark_" + backend + ".json", [&](FILE* file) {
+		std::fprintf(file, "{\n  \"backend\": %s,\n  \"device\": %s,\n  \"results\": [\n", jsonString(backend).c_str(), jsonString(device).c_str());
+		for(size_t i=0; i<results.size(); ++i) {
+			const Result& result = results[i];
+			std::fprintf(file, "    { \"kernel\": \"%s\", \"size\": %d, \"samples\": %d, \"error_target\": %g, \"gpu_ms\": %.4f, \"error\": %.6f, \"pareto\": %s }%s\n",
+				kernelName(result.config), result.config.size, result.config.numSamples, result.config.sampleErrorTarget, result.gpuMs, result.error,
+				result.pareto ? "true" : "false", (i+1 < results.size()) ? "," : "");
+		}
+		std::fprintf(file, "  ]\n}\n");
+	});
+}
+
+bool IBLBenchmark::checkIrradianceSampling() const
+{
+	bool passed = true;
+	for(const Result& mis : m_results) {
+		if(mis.config.kernel != Kernel::Irradiance || !mis.config.envImportanceSampling) {
+			continue;
+		}
+		const Result* bestMIS = &mis;
+		const Result* worstUniform = nullptr;
+		for(const Result& other : m_results) {
+			if(other.config.kernel != Kernel::Irradiance || other.config.size != mis.config.size) {
+				continue;
+			}
+			if(other.config.envImportanceSampling && other.config.numSamples > bestMIS->config.numSamples) {
+				bestMIS = &other;
+			}
+			if(!other.config.envImportanceSampling && (!worstUniform || other.config.numSamples < worstUniform->config.numSamples)) {
+				worstUniform = &other;
+			}
+		}
+		// Each size is checked once (by its largest importance sampled configuration).
+		if(bestMIS != &mis || !worstUniform) {
+			continue;
+		}
+		if(mis.error > worstUniform->error) {
+			std::fprintf(stderr, "Warning: irradiance importance sampling (size %d, %d samples) error %.3f%% exceeds uniform sampling (%d samples) error %.3f%%\n",
+				mis.config.size, mis.config.numSamples, 100.0 * mis.error, worstUniform->config.numSamples, 100.0 * worstUniform->error);
+			passed = false;
+		}
+	}
+	return passed;
+}
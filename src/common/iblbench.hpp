@@ -0,0 +1,79 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+// IBL pre-processing benchmark (-bench-ibl): sweeps map sizes & sample counts of each pre-processing kernel, measures their GPU time
+// and error against a high sample count reference, then reports Pareto-optimal configurations as CSV & JSON for picking per-device presets.
+//
+// Kernels are swept independently since their outputs don't depend on each other: specular pre-filter (spmap_cs, timed together with
+// conversion from equirectangular source & mipmap generation at given size), irradiance map (irmap_cs, with uniform hemisphere
+// or environment importance sampling, integrating the source converted for specular reference) and split-sum BRDF LUT (spbrdf_cs).
+// Errors are measured by iblcompare_cs & brdfcompare_cs.
+class IBLBenchmark
+{
+public:
+	enum class Kernel
+	{
+		SpecularFilter,
+		Irradiance,
+		SpecularBRDF,
+	};
+
+	struct Config
+	{
+		Kernel kernel;
+		// Output cube map face or LUT size.
+		int size;
+		// Maximum specular samples per texel, irradiance samples (sample pairs with environment importance sampling) or BRDF samples.
+		int numSamples;
+		// Specular only: noise target for adaptive per-level sample counts (see RendererSettings::iblSampleErrorTarget).
+		float sampleErrorTarget;
+		// Irradiance only: sampling strategy & number of interleaved batches the integration is split into.
+		bool envImportanceSampling;
+		int numBatches;
+	};
+
+	// Each configuration is executed this many times, fastest run is reported.
+	static constexpr int NumTimedRuns = 3;
+	// Directions per roughness step compared by iblcompare_cs (must match the shader) & roughness steps compared for specular map.
+	static constexpr int NumErrorDirections = 4096;
+	static constexpr int NumErrorRoughnessSteps = 8;
+	// BRDF LUT is compared on a grid of this size by brdfcompare_cs (8x8 thread groups).
+	static constexpr int ErrorLUTGridSize = 64;
+
+	// Configurations to measure for given kernel: first one is the reference all others are compared against.
+	static std::vector<Config> sweep(Kernel kernel);
+	static const char* kernelName(const Config& config);
+
+	// Mean error relative to mean reference value. Comparison shaders write one (error, reference) pair per sample point.
+	static double relativeError(const std::vector<glm::vec2>& results);
+
+	void addReference(const Config& config, double gpuMs);
+	void addResult(const Config& config, double gpuMs, double error);
+
+	// Print results (marking Pareto-optimal ones) & write them to ibl_benchmark_<backend>.csv & .json.
+	void report(const std::string& backend, const std::string& device) const;
+
+	// Environment importance sampled irradiance at its largest sample count must be closer to the uniform reference than
+	// uniform sampling at its smallest one (a biased sampler stalls at a fixed error instead). Prints any failing map size.
+	bool checkIrradianceSampling() const;
+
+private:
+	struct Result
+	{
+		Config config;
+		double gpuMs;
+		double error;
+		bool pareto;
+	};
+	std::vector<Result> m_references;
+	std::vector<Result> m_results;
+};
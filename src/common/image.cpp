@@ -7,6 +7,9 @@
 #include <stb_image.h>
 
 #include "image.hpp"
+#include "profiler.hpp"
+#include "startup.hpp"
+#include "utils.hpp"
 
 Image::Image()
 	: m_width(0)
@@ -17,6 +20,7 @@ Image::Image()
 
 std::shared_ptr<Image> Image::fromFile(const std::string& filename, int channels)
 {
+	PROFILE_ZONE("Image::fromFile");
 	std::printf("Loading image: %s\n", filename.c_str());
 
 	std::shared_ptr<Image> image{new Image};
@@ -42,5 +46,6 @@ std::shared_ptr<Image> Image::fromFile(const std::string& filename, int channels
 	if(!image->m_pixels) {
 		throw std::runtime_error("Failed to load image file: " + filename);
 	}
+	StartupReport::addBytesRead(File::size(filename));
 	return image;
 }
@@ -0,0 +1,103 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+
+#include "irradiancevolume.hpp"
+#include "probes.hpp"
+
+IrradianceVolume::IrradianceVolume()
+	: m_resolution(0)
+	, m_boundsMin(0.0f)
+	, m_boundsMax(0.0f)
+	, m_numDirty(0)
+	, m_cursor(0)
+	, m_ready(false)
+	, m_hasScene(false)
+{}
+
+void IrradianceVolume::reset(const glm::ivec3& resolution, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	m_resolution = resolution;
+	m_boundsMin = boundsMin;
+	m_boundsMax = boundsMax;
+	m_dirty.assign(resolution.x * resolution.y * resolution.z, true);
+	m_numDirty = numProbes();
+	m_cursor = 0;
+	m_ready = false;
+	m_hasScene = false;
+}
+
+glm::ivec3 IrradianceVolume::probeCoord(int probe) const
+{
+	return { probe % m_resolution.x, (probe / m_resolution.x) % m_resolution.y, probe / (m_resolution.x * m_resolution.y) };
+}
+
+glm::vec3 IrradianceVolume::probePosition(int probe) const
+{
+	const glm::vec3 t = glm::vec3{probeCoord(probe)} / glm::vec3{glm::max(m_resolution - 1, glm::ivec3{1})};
+	return glm::mix(m_boundsMin, m_boundsMax, t);
+}
+
+glm::vec4 IrradianceVolume::boundsParameters() const
+{
+	return glm::vec4{m_boundsMin, m_ready ? 1.0f : 0.0f};
+}
+
+glm::vec4 IrradianceVolume::inverseExtentParameters() const
+{
+	return glm::vec4{1.0f / (m_boundsMax - m_boundsMin), 0.0f};
+}
+
+void IrradianceVolume::updateScene(const SceneSettings& scene, bool environmentChanged, float modelRadius)
+{
+	if(environmentChanged) {
+		invalidateAll();
+	}
+	else if(m_hasScene && ProbeScheduler::modelLightingChanged(m_scene, scene)) {
+		// Probes in the cell layer around the model sample it through interpolation as well.
+		const glm::vec3 cellSize = (m_boundsMax - m_boundsMin) / glm::vec3{glm::max(m_resolution - 1, glm::ivec3{1})};
+		invalidate(glm::vec3{0.0f}, modelRadius + glm::length(cellSize));
+	}
+	m_scene = scene;
+	m_hasScene = true;
+}
+
+void IrradianceVolume::invalidate(const glm::vec3& center, float radius)
+{
+	for(int probe=0; probe<numProbes(); ++probe) {
+		if(!m_dirty[probe] && glm::distance(probePosition(probe), center) < radius) {
+			m_dirty[probe] = true;
+			++m_numDirty;
+		}
+	}
+}
+
+void IrradianceVolume::invalidateAll()
+{
+	m_dirty.assign(m_dirty.size(), true);
+	m_numDirty = numProbes();
+	m_ready = false;
+}
+
+int IrradianceVolume::nextBatch(int maxProbes, FrameVector<int>& probes)
+{
+	probes.clear();
+	for(int i=0; i<numProbes() && m_numDirty > 0 && (int)probes.size() < maxProbes; ++i) {
+		const int probe = (m_cursor + i) % numProbes();
+		if(m_dirty[probe]) {
+			m_dirty[probe] = false;
+			--m_numDirty;
+			probes.push_back(probe);
+		}
+	}
+	if(!probes.empty()) {
+		m_cursor = (probes.back() + 1) % numProbes();
+	}
+	if(m_numDirty == 0) {
+		m_ready = true;
+	}
+	return (int)probes.size();
+}
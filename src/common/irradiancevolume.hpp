@@ -0,0 +1,65 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "framearena.hpp"
+#include "renderer.hpp"
+
+// Regular grid of diffuse light probes covering the model. Each probe stores irradiance as 3rd order (9 coefficient) RGB
+// spherical harmonics, packed into NumTextureSlabs RGBA half float slabs laid side by side along X axis of a single 3D texture
+// (so that trilinear filtering never crosses slab boundaries if texture coordinates are clamped to texel centers).
+// Probes are baked in batches: a small cube map is captured per probe & projected onto SH by one compute thread group each.
+// Only probes near the model are re-baked when it moves or its lighting changes.
+class IrradianceVolume
+{
+public:
+	// 9 RGB coefficients = 27 values, rounded up to whole RGBA texels. Must match pbr_fs & shproject_cs shaders.
+	static const int NumCoefficients = 9;
+	static const int NumTextureSlabs = 7;
+
+	IrradianceVolume();
+
+	// Set up grid resolution (probes along each axis) & world space bounds (probes sit at the corners of grid cells).
+	// All probes start out invalid.
+	void reset(const glm::ivec3& resolution, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+	int numProbes() const { return (int)m_dirty.size(); }
+	const glm::ivec3& resolution() const { return m_resolution; }
+
+	glm::ivec3 probeCoord(int probe) const;
+	glm::vec3 probePosition(int probe) const;
+
+	// Texture size holding all coefficient slabs.
+	glm::ivec3 textureSize() const { return { NumTextureSlabs * m_resolution.x, m_resolution.y, m_resolution.z }; }
+
+	// Shading parameters: minimum corner of the bounds (xyz) & whether volume can be sampled (w, all probes have been baked
+	// at least once), inverse extent of the bounds (xyz).
+	glm::vec4 boundsParameters() const;
+	glm::vec4 inverseExtentParameters() const;
+
+	// Compare scene against the state seen by last call & invalidate probes within given distance of origin if the model moved
+	// or its lighting changed. Environment changes invalidate all probes & disable the volume until it has been fully re-baked.
+	void updateScene(const SceneSettings& scene, bool environmentChanged, float modelRadius);
+	void invalidate(const glm::vec3& center, float radius);
+	void invalidateAll();
+
+	// Get up to maxProbes dirty probes to bake this frame (they are considered clean afterwards).
+	// Volume becomes ready once the batch completing initial bake has been handed out.
+	int nextBatch(int maxProbes, FrameVector<int>& probes);
+
+private:
+	glm::ivec3 m_resolution;
+	glm::vec3 m_boundsMin;
+	glm::vec3 m_boundsMax;
+	std::vector<bool> m_dirty;
+	int m_numDirty;
+	int m_cursor;
+	bool m_ready;
+	SceneSettings m_scene;
+	bool m_hasScene;
+};
@@ -0,0 +1,47 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cstdio>
+
+#include "lightbench.hpp"
+#include "clusters.hpp"
+
+std::vector<int> LightBenchmark::lightCounts()
+{
+	return { 10, 100, 1000, 10000 };
+}
+
+void LightBenchmark::addFrame(const ClusteredLights& lights, double gpuMs)
+{
+	if(m_results.empty() || m_results.back().numLights != lights.numLights()) {
+		m_results.push_back({ lights.numLights(), {}, {}, {}, 0, 0 });
+	}
+
+	Result& result = m_results.back();
+	result.cpuMs.add(lights.updateMilliseconds());
+	result.gpuMs.add(gpuMs);
+	result.averageClusterLights.add(lights.averageClusterLights());
+	result.maxClusterLights = std::max(result.maxClusterLights, lights.maxClusterLights());
+	result.droppedIndices = std::max(result.droppedIndices, lights.droppedIndices());
+}
+
+void LightBenchmark::report(const std::string& backend, const std::string& device) const
+{
+	std::printf("Clustered lighting benchmark (%s, %s): averages of %d frames\n", backend.c_str(), device.c_str(), NumTimedFrames);
+	for(const Result& result : m_results) {
+		std::printf("  %5d lights: binning %7.3f ms (CPU), scene %7.3f ms (GPU), %6.1f lights per froxel (max %d)%s\n", result.numLights,
+			result.cpuMs.value(), result.gpuMs.value(), result.averageClusterLights.value(), result.maxClusterLights,
+			result.droppedIndices > 0 ? ", index list overflow" : "");
+	}
+
+	BenchmarkFile::write("light_benchmark_" + backend + ".csv", [&](FILE* file) {
+		std::fprintf(file, "backend,device,lights,cpu_binning_ms,gpu_scene_ms,avg_froxel_lights,max_froxel_lights,dropped_indices\n");
+		for(const Result& result : m_results) {
+			std::fprintf(file, "%s,\"%s\",%d,%.4f,%.4f,%.2f,%d,%d\n", backend.c_str(), device.c_str(), result.numLights,
+				result.cpuMs.value(), result.gpuMs.value(), result.averageClusterLights.value(), result.maxClusterLights, result.droppedIndices);
+		}
+	});
+}
@@ -0,0 +1,40 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+class ClusteredLights;
+
+// Clustered shading benchmark (-bench-lights): renders the default view with increasing numbers of dynamic lights & reports
+// CPU time of light binning, GPU time of the main scene pass & froxel occupancy for each light count as CSV.
+class LightBenchmark : public FrameBenchmark
+{
+public:
+	// Light counts measured in turn (NumTimedFrames frames each).
+	static std::vector<int> lightCounts();
+
+	// Record one measured frame with given number of lights (binning statistics are taken from last update of clustered lights).
+	void addFrame(const ClusteredLights& lights, double gpuMs);
+
+	// Print averages per light count & write them to light_benchmark_<backend>.csv.
+	void report(const std::string& backend, const std::string& device) const;
+
+private:
+	struct Result
+	{
+		int numLights;
+		Average cpuMs;
+		Average gpuMs;
+		Average averageClusterLights;
+		int maxClusterLights;
+		int droppedIndices;
+	};
+	std::vector<Result> m_results;
+};
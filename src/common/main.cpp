@@ -8,11 +8,14 @@
 #endif
 
 #include <cstdio>
+#include <cstdlib>
 #include <string>
 #include <memory>
 #include <vector>
 
 #include "application.hpp"
+#include "probes.hpp"
+#include "clusters.hpp"
 
 #include "../opengl.hpp"
 #include "../vulkan.hpp"
@@ -40,7 +43,44 @@ static void printUsage(const char* argv0)
 	for(size_t i=0; i<flags.size(); ++i) {
 		std::fprintf(stderr, "%s%s", flags[i], i < (flags.size()-1) ? "|":"");
 	}
-	std::fprintf(stderr, "]\n");
+	std::fprintf(stderr, "] [options]\n");
+	std::fprintf(stderr, "Options:\n");
+	std::fprintf(stderr, "  -progressive      Refine IBL pre-filtered maps progressively after first frame (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -ibl-budget <ms>  Per-frame GPU time budget for progressive IBL refinement\n");
+	std::fprintf(stderr, "  -env <file>       Add environment map to switch between with F4 (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -ibl-blend <n>    Number of frames to blend between environments after a switch\n");
+	std::fprintf(stderr, "  -ibl-cache <MB>   Memory budget for pre-filtered environments kept resident when switching\n");
+	std::fprintf(stderr, "  -ibl-error <e>    Noise target for adaptive specular pre-filter sample counts (0 disables)\n");
+	std::fprintf(stderr, "  -ibl-inline-samples  Generate specular pre-filter samples in shader instead of using precomputed tables\n");
+	std::fprintf(stderr, "  -ibl-uniform-irradiance  Compute irradiance map with uniform hemisphere sampling only\n");
+	std::fprintf(stderr, "  -ibl-octahedral   Sample pre-filtered specular environment from octahedral atlas & report its cost (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -analytic-brdf    Approximate split-sum specular BRDF analytically instead of sampling its lookup texture (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -no-fp16          Shade in full precision even if the device supports half precision arithmetic (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -probe <x,y,z,r>  Add runtime reflection probe at given position with radius of influence (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -probe-size <n>   Reflection probe cube map face size (power of two, 32 to 1024)\n");
+	std::fprintf(stderr, "  -irradiance-volume <x,y,z>  Enable irradiance volume with given number of SH probes along each axis (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -shadows          Enable cascaded shadow maps of analytical lights (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -shadow-size <n>  Shadow map size (power of two, 256 to 4096)\n");
+	std::fprintf(stderr, "  -no-shadow-cache  Re-render all shadow cascades every frame\n");
+	std::fprintf(stderr, "  -depth-prepass    Render model depth first, shade with equal depth test & draw skybox last (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -bench-prepass    Render with & without depth pre-pass, write fragment shader invocations to prepass_benchmark_*.csv & exit (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -bench-fp16       Render with full & half precision shading, write timings & errors to fp16_benchmark_*.csv & exit (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -taa              Enable temporal anti-aliasing, report frame time & render target memory on exit (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -msaa <n>         Number of MSAA samples (1 to 16, default 16 or 1 with -taa)\n");
+	std::fprintf(stderr, "  -hdr-format <f>   Scene color format: rgba16f, r11g11b10f or rgb9e5, report memory & frame time on exit (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -dynres <ms>      Scale render resolution to keep GPU frame time within given budget (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -dynres-msaa      Also lower MSAA samples when over frame time budget (OpenGL only)\n");
+	std::fprintf(stderr, "  -bench-ibl        Sweep IBL pre-processing sizes & sample counts, write results to ibl_benchmark_*.csv/json & exit (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -auto-exposure    Expose the scene by its average luminance from a GPU histogram, report its cost on exit (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -lights <n>       Add given number of dynamic point & spot lights shaded with clustered forward shading (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -bench-lights     Render with 10 to 10000 dynamic lights, write timings to light_benchmark_*.csv & exit (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -no-autotune      Use cached or default compute thread group sizes instead of timing candidates (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -retune           Time compute thread group size candidates again, replacing values cached for this device\n");
+	std::fprintf(stderr, "  -memory-budget <MB>  Warn when tracked device memory exceeds given budget (OpenGL & Vulkan only)\n");
+	std::fprintf(stderr, "  -startup-json <file>  Write startup phase breakdown (printed after first frame) to given file as JSON\n");
+#if defined(ENABLE_PROFILER)
+	std::fprintf(stderr, "  -trace <file>     Record CPU trace zones & write them to given file as Chrome trace JSON on exit\n");
+#endif
 }
 
 static RendererInterface* createDefaultRenderer()
@@ -81,23 +121,200 @@ static RendererInterface* createNamedRenderer(const std::string& flag)
 	return nullptr;
 }
 
+static bool parseOption(int argc, char* argv[], int& index, RendererSettings& settings, bool& customEnvironments)
+{
+	const std::string option = argv[index];
+	if(option == "-progressive") {
+		settings.progressiveIBL = true;
+		return true;
+	}
+	if(option == "-ibl-budget" && index+1 < argc) {
+		settings.iblFrameBudget = std::strtof(argv[++index], nullptr);
+		return settings.iblFrameBudget > 0.0f;
+	}
+	if(option == "-env" && index+1 < argc) {
+		if(!customEnvironments) {
+			settings.environments.clear();
+			customEnvironments = true;
+		}
+		settings.environments.push_back(argv[++index]);
+		return true;
+	}
+	if(option == "-ibl-blend" && index+1 < argc) {
+		settings.iblBlendFrames = std::atoi(argv[++index]);
+		return settings.iblBlendFrames >= 0;
+	}
+	if(option == "-ibl-cache" && index+1 < argc) {
+		settings.iblCacheBudget = std::strtof(argv[++index], nullptr);
+		return settings.iblCacheBudget >= 0.0f;
+	}
+	if(option == "-ibl-uniform-irradiance") {
+		settings.iblEnvImportanceSampling = false;
+		return true;
+	}
+	if(option == "-ibl-octahedral") {
+		settings.iblOctahedralAtlas = true;
+		return true;
+	}
+	if(option == "-analytic-brdf") {
+		settings.analyticBRDF = true;
+		return true;
+	}
+	if(option == "-no-fp16") {
+		settings.halfPrecision = false;
+		return true;
+	}
+	if(option == "-bench-fp16") {
+		settings.benchmark = BenchmarkKind::HalfPrecision;
+		return true;
+	}
+	if(option == "-ibl-inline-samples") {
+		settings.iblSampleTables = false;
+		return true;
+	}
+	if(option == "-ibl-error" && index+1 < argc) {
+		settings.iblSampleErrorTarget = std::strtof(argv[++index], nullptr);
+		return settings.iblSampleErrorTarget >= 0.0f;
+	}
+	if(option == "-probe" && index+1 < argc) {
+		glm::vec4 probe;
+		if(settings.reflectionProbes.size() >= ProbeScheduler::MaxProbes) {
+			return false;
+		}
+		if(std::sscanf(argv[++index], "%f,%f,%f,%f", &probe.x, &probe.y, &probe.z, &probe.w) != 4 || probe.w <= 0.0f) {
+			return false;
+		}
+		settings.reflectionProbes.push_back(probe);
+		return true;
+	}
+	if(option == "-probe-size" && index+1 < argc) {
+		settings.reflectionProbeSize = std::atoi(argv[++index]);
+		const int size = settings.reflectionProbeSize;
+		return size >= 32 && size <= 1024 && (size & (size - 1)) == 0;
+	}
+	if(option == "-irradiance-volume" && index+1 < argc) {
+		glm::ivec3& resolution = settings.irradianceVolume;
+		if(std::sscanf(argv[++index], "%d,%d,%d", &resolution.x, &resolution.y, &resolution.z) != 3) {
+			return false;
+		}
+		return glm::all(glm::greaterThanEqual(resolution, glm::ivec3{2})) && glm::all(glm::lessThanEqual(resolution, glm::ivec3{32}));
+	}
+	if(option == "-shadows") {
+		settings.shadows = true;
+		return true;
+	}
+	if(option == "-shadow-size" && index+1 < argc) {
+		settings.shadowMapSize = std::atoi(argv[++index]);
+		const int size = settings.shadowMapSize;
+		return size >= 256 && size <= 4096 && (size & (size - 1)) == 0;
+	}
+	if(option == "-no-shadow-cache") {
+		settings.shadowCaching = false;
+		return true;
+	}
+	if(option == "-depth-prepass") {
+		settings.depthPrepass = true;
+		return true;
+	}
+	if(option == "-bench-prepass") {
+		settings.benchmark = BenchmarkKind::DepthPrepass;
+		return true;
+	}
+	if(option == "-taa") {
+		settings.temporalAA = true;
+		return true;
+	}
+	if(option == "-msaa" && index+1 < argc) {
+		settings.msaaSamples = std::atoi(argv[++index]);
+		return settings.msaaSamples >= 1 && settings.msaaSamples <= 16;
+	}
+	if(option == "-hdr-format" && index+1 < argc) {
+		settings.hdrFormat = argv[++index];
+		return settings.hdrFormat == "rgba16f" || settings.hdrFormat == "r11g11b10f" || settings.hdrFormat == "rgb9e5";
+	}
+	if(option == "-dynres" && index+1 < argc) {
+		settings.frameTimeBudget = float(std::atof(argv[++index]));
+		return settings.frameTimeBudget > 0.0f;
+	}
+	if(option == "-dynres-msaa") {
+		settings.dynamicSamples = true;
+		return true;
+	}
+	if(option == "-auto-exposure") {
+		settings.autoExposure = true;
+		return true;
+	}
+	if(option == "-bench-ibl") {
+		settings.benchmark = BenchmarkKind::IBL;
+		return true;
+	}
+	if(option == "-lights" && index+1 < argc) {
+		settings.numDynamicLights = std::atoi(argv[++index]);
+		return settings.numDynamicLights >= 0 && settings.numDynamicLights <= ClusteredLights::MaxLights;
+	}
+	if(option == "-bench-lights") {
+		settings.benchmark = BenchmarkKind::Lights;
+		return true;
+	}
+	if(option == "-no-autotune") {
+		settings.autotuneWorkgroups = false;
+		return true;
+	}
+	if(option == "-retune") {
+		settings.retuneWorkgroups = true;
+		return true;
+	}
+	if(option == "-memory-budget" && index+1 < argc) {
+		settings.memoryBudget = std::strtof(argv[++index], nullptr);
+		return settings.memoryBudget > 0.0f;
+	}
+	if(option == "-startup-json" && index+1 < argc) {
+		settings.startupReportFilename = argv[++index];
+		return true;
+	}
+#if defined(ENABLE_PROFILER)
+	if(option == "-trace" && index+1 < argc) {
+		settings.traceFilename = argv[++index];
+		return true;
+	}
+#endif
+	return false;
+}
+
 int main(int argc, char* argv[])
 {
-	RendererInterface* renderer = nullptr;
+	std::unique_ptr<RendererInterface> renderer;
+	RendererSettings settings;
+	bool customEnvironments = false;
 
-	if(argc < 2) {
-		renderer = createDefaultRenderer();
-	}
-	else {
-		renderer = createNamedRenderer(argv[1]);
+	for(int i=1; i<argc; ++i) {
 		if(!renderer) {
+			renderer.reset(createNamedRenderer(argv[i]));
+			if(renderer) {
+				continue;
+			}
+		}
+		if(!parseOption(argc, argv, i, settings, customEnvironments)) {
 			printUsage(argv[0]);
 			return 1;
 		}
 	}
+	if(settings.temporalAA && settings.frameTimeBudget > 0.0f) {
+		// History would have to be resampled whenever resolution changes.
+		std::fprintf(stderr, "Error: -dynres cannot be combined with -taa\n");
+		return 1;
+	}
+	if(settings.benchmark == BenchmarkKind::HalfPrecision && (settings.temporalAA || settings.frameTimeBudget > 0.0f)) {
+		// Compared frames must be rendered at the same resolution without projection jitter.
+		std::fprintf(stderr, "Error: -bench-fp16 cannot be combined with -taa or -dynres\n");
+		return 1;
+	}
+	if(!renderer) {
+		renderer.reset(createDefaultRenderer());
+	}
 
 	try {
-		Application().run(std::unique_ptr<RendererInterface>{ renderer });
+		Application().run(renderer, settings);
 	}
 	catch(const std::exception& e) {
 		std::fprintf(stderr, "Error: %s\n", e.what());
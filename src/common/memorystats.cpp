@@ -0,0 +1,136 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+#include "memorystats.hpp"
+
+namespace {
+	const double MB = 1024.0 * 1024.0;
+}
+
+MemoryStats::MemoryStats()
+{
+	reset(0);
+}
+
+void MemoryStats::reset(uint64_t budgetBytes)
+{
+	m_heaps.clear();
+	m_allocations.clear();
+	std::fill(m_categories, m_categories + NumCategories, Usage{0, 0});
+	m_deviceLocal = {0, 0};
+	m_budget = budgetBytes;
+	m_overBudget = false;
+}
+
+int MemoryStats::addHeap(const std::string& name, uint64_t size, bool deviceLocal)
+{
+	m_heaps.push_back({ name, size, deviceLocal, {0, 0}, false, 0, 0, false });
+	return (int)m_heaps.size() - 1;
+}
+
+void MemoryStats::allocate(uint64_t handle, MemoryCategory category, int heap, uint64_t bytes)
+{
+	assert(heap >= 0 && heap < (int)m_heaps.size());
+	assert(m_allocations.find(handle) == m_allocations.end());
+
+	m_allocations[handle] = { category, heap, bytes };
+
+	auto add = [bytes](Usage& usage) {
+		usage.current += bytes;
+		usage.peak = std::max(usage.peak, usage.current);
+	};
+	add(m_categories[int(category)]);
+	add(m_heaps[heap].usage);
+	if(m_heaps[heap].deviceLocal) {
+		add(m_deviceLocal);
+	}
+
+	// Warn once per crossing (not on every allocation made while over budget).
+	if(m_budget > 0 && m_deviceLocal.current > m_budget && !m_overBudget) {
+		std::fprintf(stderr, "Warning: device memory budget exceeded: %.1f MB of %.1f MB in use (after %.1f MB %s allocation)\n",
+			m_deviceLocal.current / MB, m_budget / MB, bytes / MB, categoryName(category));
+	}
+	m_overBudget = m_budget > 0 && m_deviceLocal.current > m_budget;
+}
+
+void MemoryStats::release(uint64_t handle)
+{
+	auto it = m_allocations.find(handle);
+	if(it == m_allocations.end()) {
+		return;
+	}
+	const Allocation& allocation = it->second;
+	m_categories[int(allocation.category)].current -= allocation.bytes;
+	m_heaps[allocation.heap].usage.current -= allocation.bytes;
+	if(m_heaps[allocation.heap].deviceLocal) {
+		m_deviceLocal.current -= allocation.bytes;
+	}
+	m_allocations.erase(it);
+
+	m_overBudget = m_budget > 0 && m_deviceLocal.current > m_budget;
+}
+
+void MemoryStats::setDriverBudget(int heap, uint64_t usage, uint64_t budget)
+{
+	assert(heap >= 0 && heap < (int)m_heaps.size());
+
+	Heap& h = m_heaps[heap];
+	h.driverReported = true;
+	h.driverUsage = usage;
+	h.driverBudget = budget;
+
+	// Driver usage includes other processes & allocations made by the driver itself, so it may exceed budget regardless of ours.
+	const bool overBudget = budget > 0 && usage > budget;
+	if(overBudget && !h.overDriverBudget) {
+		std::fprintf(stderr, "Warning: %s memory usage reported by the driver (%.1f MB) exceeds its budget (%.1f MB)\n",
+			h.name.c_str(), usage / MB, budget / MB);
+	}
+	h.overDriverBudget = overBudget;
+}
+
+void MemoryStats::report(const std::string& title) const
+{
+	std::printf("Memory usage (%s):\n", title.c_str());
+	std::printf("  %-16s %12s %12s\n", "Category", "Current MB", "Peak MB");
+	for(int i=0; i<NumCategories; ++i) {
+		std::printf("  %-16s %12.2f %12.2f\n", categoryName(MemoryCategory(i)), m_categories[i].current / MB, m_categories[i].peak / MB);
+	}
+
+	std::printf("  %-16s %12s %12s %12s %12s %12s\n", "Heap", "Current MB", "Peak MB", "Size MB", "Driver MB", "Budget MB");
+	for(const Heap& heap : m_heaps) {
+		char size[16] = "-";
+		char driverUsage[16] = "-";
+		char driverBudget[16] = "-";
+		if(heap.size > 0) {
+			std::snprintf(size, sizeof(size), "%.2f", heap.size / MB);
+		}
+		if(heap.driverReported) {
+			std::snprintf(driverUsage, sizeof(driverUsage), "%.2f", heap.driverUsage / MB);
+			std::snprintf(driverBudget, sizeof(driverBudget), "%.2f", heap.driverBudget / MB);
+		}
+		std::printf("  %-16s %12.2f %12.2f %12s %12s %12s\n", heap.name.c_str(), heap.usage.current / MB, heap.usage.peak / MB, size, driverUsage, driverBudget);
+	}
+
+	if(m_budget > 0) {
+		std::printf("  Device local: %.2f MB (peak %.2f MB) of %.2f MB budget\n", m_deviceLocal.current / MB, m_deviceLocal.peak / MB, m_budget / MB);
+	}
+}
+
+const char* MemoryStats::categoryName(MemoryCategory category)
+{
+	switch(category) {
+	case MemoryCategory::Mesh:         return "mesh";
+	case MemoryCategory::Material:     return "material";
+	case MemoryCategory::IBL:          return "IBL";
+	case MemoryCategory::RenderTarget: return "render target";
+	case MemoryCategory::Staging:      return "staging";
+	case MemoryCategory::Uniform:      return "uniform";
+	default:                           return "other";
+	}
+}
@@ -0,0 +1,82 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class MemoryCategory
+{
+	Mesh,
+	Material,
+	IBL,
+	RenderTarget,
+	Staging,
+	Uniform,
+	Other,
+};
+
+// Memory accounting: renderers record every buffer, texture & render target allocation (tagged with a category & the heap it
+// comes from) under its API handle & release it by the same handle. Current & peak usage is kept per category & per heap,
+// next to usage & budget reported by the driver where the API exposes them (VK_EXT_memory_budget, GL_NVX_gpu_memory_info).
+// Exceeding the configured budget (-memory-budget <MB>, counted over device local heaps) or the driver budget prints a warning.
+class MemoryStats
+{
+public:
+	static const int NumCategories = 7;
+
+	MemoryStats();
+
+	// Forget all heaps & allocations, zero budget disables the warning.
+	void reset(uint64_t budgetBytes);
+	// Returns index of the new heap (heaps are indexed in the order they were added). Size may be zero if unknown.
+	int addHeap(const std::string& name, uint64_t size, bool deviceLocal);
+
+	// Allocation handles must be unique among live allocations, releasing an unknown handle does nothing.
+	void allocate(uint64_t handle, MemoryCategory category, int heap, uint64_t bytes);
+	void release(uint64_t handle);
+
+	// Process-wide usage & budget of given heap as reported by the driver.
+	void setDriverBudget(int heap, uint64_t usage, uint64_t budget);
+
+	// Print current & peak usage per category & per heap.
+	void report(const std::string& title) const;
+
+	static const char* categoryName(MemoryCategory category);
+
+private:
+	struct Usage
+	{
+		uint64_t current;
+		uint64_t peak;
+	};
+	struct Heap
+	{
+		std::string name;
+		uint64_t size;
+		bool deviceLocal;
+		Usage usage;
+		bool driverReported;
+		uint64_t driverUsage;
+		uint64_t driverBudget;
+		bool overDriverBudget;
+	};
+	struct Allocation
+	{
+		MemoryCategory category;
+		int heap;
+		uint64_t bytes;
+	};
+
+	std::vector<Heap> m_heaps;
+	Usage m_categories[NumCategories];
+	Usage m_deviceLocal;
+	std::unordered_map<uint64_t, Allocation> m_allocations;
+	uint64_t m_budget;
+	bool m_overBudget;
+};
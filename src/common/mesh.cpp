@@ -11,6 +11,9 @@
 #include <assimp/LogStream.hpp>
 
 #include "mesh.hpp"
+#include "profiler.hpp"
+#include "startup.hpp"
+#include "utils.hpp"
 
 namespace {
 	const unsigned int ImportFlags = 
@@ -70,6 +73,7 @@ Mesh::Mesh(const aiMesh* mesh)
 
 std::shared_ptr<Mesh> Mesh::fromFile(const std::string& filename)
 {
+	PROFILE_ZONE("Mesh::fromFile");
 	LogStream::initialize();
 
 	std::printf("Loading mesh: %s\n", filename.c_str());
@@ -84,9 +88,30 @@ std::shared_ptr<Mesh> Mesh::fromFile(const std::string& filename)
 	else {
 		throw std::runtime_error("Failed to load mesh file: " + filename);
 	}
+	StartupReport::addBytesRead(File::size(filename));
 	return mesh;
 }
 
+std::vector<glm::vec3> Mesh::positions() const
+{
+	std::vector<glm::vec3> positions;
+	positions.reserve(m_vertices.size());
+	for(const Vertex& vertex : m_vertices) {
+		positions.push_back(vertex.position);
+	}
+	return positions;
+}
+
+std::vector<Mesh::Attributes> Mesh::attributes() const
+{
+	std::vector<Attributes> attributes;
+	attributes.reserve(m_vertices.size());
+	for(const Vertex& vertex : m_vertices) {
+		attributes.push_back({vertex.normal, vertex.tangent, vertex.bitangent, vertex.texcoord});
+	}
+	return attributes;
+}
+
 std::shared_ptr<Mesh> Mesh::fromString(const std::string& data)
 {
 	LogStream::initialize();
@@ -25,6 +25,16 @@ public:
 	static_assert(sizeof(Vertex) == 14 * sizeof(float));
 	static const int NumAttributes = 5;
 
+	// Vertex without position (second stream of de-interleaved layout).
+	struct Attributes
+	{
+		glm::vec3 normal;
+		glm::vec3 tangent;
+		glm::vec3 bitangent;
+		glm::vec2 texcoord;
+	};
+	static_assert(sizeof(Attributes) == 11 * sizeof(float));
+
 	struct Face
 	{
 		uint32_t v1, v2, v3;
@@ -37,6 +47,10 @@ public:
 	const std::vector<Vertex>& vertices() const { return m_vertices; }
 	const std::vector<Face>& faces() const { return m_faces; }
 
+	// De-interleaved layout: tightly packed positions & remaining attributes as separate streams.
+	std::vector<glm::vec3> positions() const;
+	std::vector<Attributes> attributes() const;
+
 private:
 	Mesh(const struct aiMesh* mesh);
 
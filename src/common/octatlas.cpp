@@ -0,0 +1,66 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+#include <glm/glm.hpp>
+
+#include "octatlas.hpp"
+
+namespace {
+	const size_t BytesPerTexel = 4 * sizeof(uint16_t);
+
+	float luminance(const glm::vec3& color)
+	{
+		return glm::dot(color, glm::vec3{0.2126f, 0.7152f, 0.0722f});
+	}
+}
+
+size_t OctahedralAtlas::atlasSize(int cubeSize)
+{
+	return size_t(width(cubeSize)) * height(cubeSize) * BytesPerTexel;
+}
+
+size_t OctahedralAtlas::cubeSize(int cubeSize, int cubeLevels)
+{
+	size_t numTexels = 0;
+	for(int level=0, size=cubeSize; level<cubeLevels; ++level, size=std::max(size/2, 1)) {
+		numTexels += 6 * size_t(size) * size;
+	}
+	return numTexels * BytesPerTexel;
+}
+
+void OctahedralAtlas::printReport(int cubeSize, int cubeLevels, const std::vector<glm::vec4>& errorResults, double cubeCostMs, double atlasCostMs)
+{
+	const double cubeMB  = OctahedralAtlas::cubeSize(cubeSize, cubeLevels) / (1024.0 * 1024.0);
+	const double atlasMB = OctahedralAtlas::atlasSize(cubeSize) / (1024.0 * 1024.0);
+	std::printf("Octahedral atlas: %dx%d, %d levels, %.1f MB (cube map: %.1f MB)\n", width(cubeSize), height(cubeSize), numLevels(cubeLevels), atlasMB, cubeMB);
+
+	if(cubeCostMs > 0.0 && atlasCostMs > 0.0) {
+		const double numSamples = double(NumCostInvocations) * NumCostSamplesPerInvocation;
+		std::printf("Octahedral atlas sampling cost: %.3f ms (cube map: %.3f ms) per %.0fM trilinear lookups\n", atlasCostMs, cubeCostMs, numSamples * 1e-6);
+	}
+
+	// Error relative to mean cube map luminance of the level (so that dark regions don't dominate).
+	const int numErrorLevels = int(errorResults.size()) / NumErrorDirections;
+	for(int level=0; level<numErrorLevels; ++level) {
+		double errorSum = 0.0;
+		double referenceSum = 0.0;
+		float maxError = 0.0f;
+		for(int i=0; i<NumErrorDirections; ++i) {
+			const glm::vec4& result = errorResults[level * NumErrorDirections + i];
+			const float error = luminance(glm::vec3{result});
+			errorSum += error;
+			referenceSum += result.w;
+			maxError = std::max(maxError, error);
+		}
+		if(referenceSum > 0.0) {
+			const double meanReference = referenceSum / NumErrorDirections;
+			std::printf("  level %d: mean error %.3f%%, max error %.2f%%\n", level, 100.0 * errorSum / referenceSum, 100.0 * maxError / meanReference);
+		}
+	}
+}
@@ -0,0 +1,40 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/vec4.hpp>
+
+// Alternate storage for pre-filtered specular environment map: all roughness levels packed into a single 2D texture
+// of octahedral maps. Level 0 (twice the cube face size) sits in the left square of the atlas, remaining levels are stacked
+// in a column of half width to its right. Every level has a one texel gutter holding octahedrally wrapped neighbours so that
+// bilinear filtering never needs to cross level or hemisphere seams.
+//
+// Atlas is derived from the pre-filtered cube map (which remains the pre-filtering target & cache format), level by level,
+// by octatlas_cs. The last cube level is dropped since its octahedral counterpart would consist of gutter texels only.
+class OctahedralAtlas
+{
+public:
+	// Directions per level compared when measuring atlas error & invocations per sampling cost pass (must match octcompare_cs).
+	static constexpr int NumErrorDirections = 4096;
+	static constexpr int NumCostInvocations = 256 * 1024;
+	static constexpr int NumCostSamplesPerInvocation = 16;
+
+	// Atlas height (size of level 0 octahedral map) & width for given cube face size.
+	static int height(int cubeSize) { return 2 * cubeSize; }
+	static int width(int cubeSize) { return 3 * cubeSize; }
+	static int numLevels(int cubeLevels) { return (cubeLevels > 1) ? cubeLevels - 1 : 1; }
+
+	// Device memory size of RGBA16F atlas & full cube mip chain of the same environment.
+	static size_t atlasSize(int cubeSize);
+	static size_t cubeSize(int cubeSize, int cubeLevels);
+
+	// Print memory, sampling cost & per-level error summary. Error results are written by octcompare_cs:
+	// one (|atlas - cube| RGB, cube luminance) entry per direction & level.
+	static void printReport(int cubeSize, int cubeLevels, const std::vector<glm::vec4>& errorResults, double cubeCostMs, double atlasCostMs);
+};
@@ -0,0 +1,99 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include "permutations.hpp"
+#include "renderer.hpp"
+
+namespace {
+	// Must match pbr_fs.
+	const char* const FeatureDefines[PBRPermutation::NumFeatures] = {
+		"OCTAHEDRAL_ATLAS",
+		"SHADOW_MAPPING",
+		"DYNAMIC_LIGHTING",
+		"REFLECTION_PROBES",
+		"IRRADIANCE_VOLUME",
+		"ENVIRONMENT_BLENDING",
+		"ANALYTIC_BRDF",
+		"HALF_PRECISION",
+	};
+	const char* const FeatureNames[PBRPermutation::NumFeatures] = {
+		"octahedral atlas",
+		"shadows",
+		"dynamic lights",
+		"probes",
+		"irradiance volume",
+		"environment blending",
+		"analytic BRDF",
+		"fp16",
+	};
+}
+
+PBRPermutation PBRPermutation::forScene(const RendererSettings& settings)
+{
+	PBRPermutation permutation;
+	permutation.set(Feature_OctahedralAtlas, settings.iblOctahedralAtlas);
+	permutation.set(Feature_ShadowMapping, settings.shadows);
+	permutation.set(Feature_DynamicLighting, settings.numDynamicLights > 0 || settings.benchmark == BenchmarkKind::Lights);
+	permutation.set(Feature_ReflectionProbes, !settings.reflectionProbes.empty());
+	permutation.set(Feature_IrradianceVolume, settings.irradianceVolume.x > 0);
+	permutation.set(Feature_EnvironmentBlending, settings.environments.size() > 1 && settings.iblBlendFrames > 0);
+	permutation.set(Feature_AnalyticBRDF, settings.analyticBRDF);
+	return permutation;
+}
+
+PBRPermutation PBRPermutation::forCapture() const
+{
+	// Probe captures may still be lit by the irradiance volume (volume captures disable it at runtime).
+	PBRPermutation permutation = *this;
+	permutation.set(Feature_DynamicLighting, false);
+	permutation.set(Feature_ReflectionProbes, false);
+	return permutation;
+}
+
+void PBRPermutation::set(Feature feature, bool enabled)
+{
+	if(enabled) {
+		m_features |= 1u << feature;
+	}
+	else {
+		m_features &= ~(1u << feature);
+	}
+}
+
+std::vector<std::string> PBRPermutation::defines() const
+{
+	std::vector<std::string> result;
+	for(uint32_t feature=0; feature<NumFeatures; ++feature) {
+		if(has(Feature(feature))) {
+			result.push_back(FeatureDefines[feature]);
+		}
+	}
+	return result;
+}
+
+std::vector<uint32_t> PBRPermutation::specializationConstants() const
+{
+	std::vector<uint32_t> result(NumSpecializedFeatures);
+	for(uint32_t feature=0; feature<NumSpecializedFeatures; ++feature) {
+		result[feature] = has(Feature(feature)) ? 1 : 0;
+	}
+	return result;
+}
+
+const char* PBRPermutation::spirvModule() const
+{
+	return has(Feature_HalfPrecision) ? "shaders/spirv/pbr_fs_fp16.spv" : "shaders/spirv/pbr_fs.spv";
+}
+
+std::string PBRPermutation::name() const
+{
+	std::string result;
+	for(uint32_t feature=0; feature<NumFeatures; ++feature) {
+		if(has(Feature(feature))) {
+			result += result.empty() ? FeatureNames[feature] : std::string(", ") + FeatureNames[feature];
+		}
+	}
+	return result.empty() ? "base" : result;
+}
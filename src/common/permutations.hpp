@@ -0,0 +1,62 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct RendererSettings;
+
+// Shader permutations of pbr_fs: optional shading features are compile time constants (preprocessor symbols in OpenGL,
+// specialization constants in Vulkan), so that the variant built for a pass contains only the features its settings can use
+// & the driver drops the code (and texture fetches) of all others. Features which are compiled in may still be inactive at
+// runtime (e.g. irradiance volume before it has been baked), the shader keeps checking those as before.
+class PBRPermutation
+{
+public:
+	// Specialization constant IDs in Vulkan (octahedral atlas shares constant 0 with skybox_fs). Features past the last
+	// specialized one select a separately compiled SPIR-V module instead (see spirvModule).
+	enum Feature : uint32_t {
+		Feature_OctahedralAtlas = 0,
+		Feature_ShadowMapping,
+		Feature_DynamicLighting,
+		Feature_ReflectionProbes,
+		Feature_IrradianceVolume,
+		Feature_EnvironmentBlending,
+		Feature_AnalyticBRDF,
+		// float16 arithmetic is a capability of the module, which a specialization constant cannot toggle (pbr_fs_fp16).
+		Feature_HalfPrecision,
+		NumFeatures,
+		NumSpecializedFeatures = Feature_HalfPrecision,
+	};
+
+	PBRPermutation() : m_features(0) {}
+
+	// Variant for the main view with all features enabled by settings (half precision is enabled by the renderer once it
+	// knows the device supports it).
+	static PBRPermutation forScene(const RendererSettings& settings);
+	// Variant for reflection probe & irradiance volume captures, which never shade dynamic lights or probes.
+	PBRPermutation forCapture() const;
+
+	bool has(Feature feature) const { return (m_features & (1u << feature)) != 0; }
+	void set(Feature feature, bool enabled);
+
+	bool operator==(const PBRPermutation& other) const { return m_features == other.m_features; }
+	bool operator!=(const PBRPermutation& other) const { return m_features != other.m_features; }
+
+	// Preprocessor symbols of enabled features (OpenGL).
+	std::vector<std::string> defines() const;
+	// Value (VK_TRUE or VK_FALSE) of each specialized feature's constant, indexed by constant ID (Vulkan).
+	std::vector<uint32_t> specializationConstants() const;
+	// SPIR-V module of this variant (Vulkan).
+	const char* spirvModule() const;
+	// Names of enabled features for logging.
+	std::string name() const;
+
+private:
+	uint32_t m_features;
+};
@@ -0,0 +1,39 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <cstdio>
+
+#include "prepassbench.hpp"
+
+void PrepassBenchmark::addFrame(bool depthPrepass, uint64_t fragmentInvocations, double gpuMs)
+{
+	Result& result = m_results[depthPrepass ? 1 : 0];
+	result.fragmentInvocations.add(double(fragmentInvocations));
+	result.gpuMs.add(gpuMs);
+}
+
+void PrepassBenchmark::report(const std::string& backend, const std::string& device) const
+{
+	const char* modeNames[] = { "skybox first", "depth pre-pass" };
+
+	std::printf("Depth pre-pass benchmark (%s, %s): averages of %d frames\n", backend.c_str(), device.c_str(), NumTimedFrames);
+	double fragmentInvocations[2];
+	double gpuMs[2];
+	for(int mode=0; mode<2; ++mode) {
+		fragmentInvocations[mode] = m_results[mode].fragmentInvocations.value();
+		gpuMs[mode] = m_results[mode].gpuMs.value();
+		std::printf("  %-14s: %12.0f fragment shader invocations, scene %7.3f ms (GPU)\n", modeNames[mode], fragmentInvocations[mode], gpuMs[mode]);
+	}
+	const double saved = fragmentInvocations[0] - fragmentInvocations[1];
+	std::printf("  Saved %.0f fragment shader invocations per frame (%.1f%%), %.3f ms\n", saved,
+		(fragmentInvocations[0] > 0.0) ? 100.0 * saved / fragmentInvocations[0] : 0.0, gpuMs[0] - gpuMs[1]);
+
+	BenchmarkFile::write("prepass_benchmark_" + backend + ".csv", [&](FILE* file) {
+		std::fprintf(file, "backend,device,depth_prepass,fs_invocations,gpu_scene_ms\n");
+		for(int mode=0; mode<2; ++mode) {
+			std::fprintf(file, "%s,\"%s\",%d,%.0f,%.4f\n", backend.c_str(), device.c_str(), mode, fragmentInvocations[mode], gpuMs[mode]);
+		}
+	});
+}
@@ -0,0 +1,31 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "benchmark.hpp"
+
+// Depth pre-pass benchmark (-bench-prepass): renders the default view with skybox drawn first & model shaded directly, then with
+// depth pre-pass & skybox drawn last, and reports fragment shader invocations (pipeline statistics) & GPU time of the main scene pass as CSV.
+class PrepassBenchmark : public FrameBenchmark
+{
+public:
+	// Record one measured frame rendered with or without depth pre-pass.
+	void addFrame(bool depthPrepass, uint64_t fragmentInvocations, double gpuMs);
+
+	// Print averages of both modes & fragment shader invocations saved by the pre-pass, write them to prepass_benchmark_<backend>.csv.
+	void report(const std::string& backend, const std::string& device) const;
+
+private:
+	struct Result
+	{
+		Average fragmentInvocations;
+		Average gpuMs;
+	};
+	Result m_results[2];
+};
@@ -0,0 +1,136 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "probes.hpp"
+#include "mesh.hpp"
+
+ProbeScheduler::ProbeScheduler()
+	: m_current(-1)
+	, m_previous(-1)
+	, m_modelRadius(0.0f)
+	, m_hasScene(false)
+{}
+
+void ProbeScheduler::reset(const std::vector<glm::vec4>& probes, float modelRadius)
+{
+	m_probes.clear();
+	for(const glm::vec4& probe : probes) {
+		m_probes.push_back(Probe{ glm::vec3{probe}, probe.w, 0, true, false });
+	}
+	m_current = -1;
+	m_previous = -1;
+	m_modelRadius = modelRadius;
+	m_hasScene = false;
+}
+
+glm::vec4 ProbeScheduler::shadingParameters(int probe) const
+{
+	const Probe& p = m_probes[probe];
+	return glm::vec4{p.position, p.ready ? p.radius : 0.0f};
+}
+
+void ProbeScheduler::updateScene(const SceneSettings& scene, bool environmentChanged)
+{
+	if(environmentChanged) {
+		invalidateAll();
+	}
+	else if(m_hasScene && modelLightingChanged(m_scene, scene)) {
+		invalidate(glm::vec3{0.0f}, m_modelRadius);
+	}
+	m_scene = scene;
+	m_hasScene = true;
+}
+
+void ProbeScheduler::invalidate(const glm::vec3& center, float radius)
+{
+	for(Probe& probe : m_probes) {
+		if(glm::distance(probe.position, center) < probe.radius + radius) {
+			probe.dirty = true;
+			probe.nextFace = 0;
+		}
+	}
+}
+
+void ProbeScheduler::invalidateAll()
+{
+	for(Probe& probe : m_probes) {
+		probe.dirty = true;
+		probe.nextFace = 0;
+	}
+}
+
+bool ProbeScheduler::nextCapture(Capture& capture)
+{
+	if(m_current == -1) {
+		// Round robin so that a frequently invalidated probe doesn't starve the others.
+		for(int i=0; i<numProbes(); ++i) {
+			const int probe = (m_previous + 1 + i) % numProbes();
+			if(m_probes[probe].dirty) {
+				m_current = probe;
+				break;
+			}
+		}
+		if(m_current == -1) {
+			return false;
+		}
+	}
+
+	Probe& probe = m_probes[m_current];
+	if(probe.nextFace == 0) {
+		probe.dirty = false;
+	}
+	capture.probe  = m_current;
+	capture.face   = probe.nextFace++;
+	capture.filter = (probe.nextFace == 6);
+	if(capture.filter) {
+		probe.nextFace = 0;
+		probe.ready = true;
+		m_previous = m_current;
+		m_current = -1;
+	}
+	return true;
+}
+
+bool ProbeScheduler::modelLightingChanged(const SceneSettings& previous, const SceneSettings& current)
+{
+	if(previous.pitch != current.pitch || previous.yaw != current.yaw) {
+		return true;
+	}
+	for(int i=0; i<SceneSettings::NumLights; ++i) {
+		const SceneSettings::Light& a = previous.lights[i];
+		const SceneSettings::Light& b = current.lights[i];
+		if(a.enabled != b.enabled) {
+			return true;
+		}
+		if(a.enabled && (a.direction != b.direction || a.radiance != b.radiance)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+glm::mat4 ProbeScheduler::faceViewMatrix(const glm::vec3& position, int face)
+{
+	static const glm::vec3 forward[6] = {
+		{ 1.0f, 0.0f, 0.0f }, {-1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f,-1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f,-1.0f },
+	};
+	static const glm::vec3 up[6] = {
+		{ 0.0f,-1.0f, 0.0f }, { 0.0f,-1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f,-1.0f }, { 0.0f,-1.0f, 0.0f }, { 0.0f,-1.0f, 0.0f },
+	};
+	return glm::lookAt(position, position + forward[face], up[face]);
+}
+
+float ProbeScheduler::boundingRadius(const Mesh& mesh)
+{
+	float radius = 0.0f;
+	for(const Mesh::Vertex& vertex : mesh.vertices()) {
+		radius = std::max(radius, glm::length(vertex.position));
+	}
+	return radius;
+}
@@ -0,0 +1,74 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "renderer.hpp"
+
+// Schedules runtime capture of reflection probes. A probe whose surroundings have changed is re-rendered one cube map face
+// per frame into a capture cube map; once all six faces are done the capture is pre-filtered into the probe's specular
+// & irradiance maps and the probe becomes visible to shading. Captures are restarted if the scene changes again mid-way.
+class ProbeScheduler
+{
+public:
+	// Must match MaxProbes in pbr_fs shader.
+	static const int MaxProbes = 8;
+
+	struct Capture
+	{
+		int probe;   // Index of the probe being captured.
+		int face;    // Cube map face to render this frame.
+		bool filter; // All faces have been rendered: pre-filter capture into probe maps.
+	};
+
+	ProbeScheduler();
+
+	// Set up probes (xyz: world space position, w: radius of influence) & bounding sphere radius of the model
+	// (centered at origin, so that it is invariant to scene rotation). All probes start out invalid.
+	void reset(const std::vector<glm::vec4>& probes, float modelRadius);
+	int numProbes() const { return (int)m_probes.size(); }
+
+	// Probe position (xyz) & radius of influence (w) for shading; radius is zero until the probe has been captured.
+	glm::vec4 shadingParameters(int probe) const;
+	const glm::vec3& position(int probe) const { return m_probes[probe].position; }
+
+	// Compare scene against the state seen by last call & invalidate probes near the model if it moved or its lighting changed.
+	// Environment changes are visible everywhere and invalidate all probes.
+	void updateScene(const SceneSettings& scene, bool environmentChanged);
+	// Invalidate probes whose influence sphere intersects given bounding sphere.
+	void invalidate(const glm::vec3& center, float radius);
+	void invalidateAll();
+
+	// Get capture work for this frame; returns false if all probes are up to date.
+	bool nextCapture(Capture& capture);
+
+	// True if model orientation or analytical lighting differs between given scene states.
+	static bool modelLightingChanged(const SceneSettings& previous, const SceneSettings& current);
+
+	// View matrix of given cube map face as seen from probe position (GL cube map face orientation).
+	static glm::mat4 faceViewMatrix(const glm::vec3& position, int face);
+
+	// Radius of bounding sphere of vertex positions centered at origin.
+	static float boundingRadius(const class Mesh& mesh);
+
+private:
+	struct Probe
+	{
+		glm::vec3 position;
+		float radius;
+		int nextFace; // Next face to capture (0 if capture hasn't started).
+		bool dirty;   // Needs to be (re)captured.
+		bool ready;   // Has valid pre-filtered maps.
+	};
+	std::vector<Probe> m_probes;
+	int m_current;  // Probe being captured (-1 if none).
+	int m_previous; // Last completed probe.
+	float m_modelRadius;
+	SceneSettings m_scene;
+	bool m_hasScene;
+};
@@ -0,0 +1,159 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "profiler.hpp"
+
+namespace {
+	// Zones timed when tracing starts to report per-zone overhead (discarded afterwards).
+	const int NumOverheadZones = 10000;
+
+	struct Event
+	{
+		const char* name;
+		uint64_t begin;
+		uint64_t end;
+	};
+
+	// Single producer ring buffer: only the owning thread writes events & advances count, export reads count with acquire
+	// ordering & copies events below it. Buffers are returned to a free list when their thread exits & reused by threads
+	// started later (thread ids in the trace are buffer indices, so short-lived workers do not each get a track of their own).
+	struct ThreadBuffer
+	{
+		uint32_t id;
+		const char* name;
+		std::atomic<uint64_t> count;
+		std::unique_ptr<Event[]> events;
+	};
+
+	std::mutex g_buffersMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+	std::vector<ThreadBuffer*> g_freeBuffers;
+
+	uint64_t g_startTimestamp;
+	std::chrono::steady_clock::time_point g_startTime;
+
+	thread_local ThreadBuffer* t_buffer = nullptr;
+
+	struct ThreadBufferOwner
+	{
+		~ThreadBufferOwner()
+		{
+			if(t_buffer) {
+				std::lock_guard<std::mutex> lock(g_buffersMutex);
+				g_freeBuffers.push_back(t_buffer);
+				t_buffer = nullptr;
+			}
+		}
+	};
+	thread_local ThreadBufferOwner t_bufferOwner;
+
+	ThreadBuffer* acquireBuffer()
+	{
+		(void)t_bufferOwner; // Constructs owner on this thread, so that the buffer is released on exit.
+
+		std::lock_guard<std::mutex> lock(g_buffersMutex);
+		if(!g_freeBuffers.empty()) {
+			t_buffer = g_freeBuffers.back();
+			g_freeBuffers.pop_back();
+		}
+		else {
+			std::unique_ptr<ThreadBuffer> buffer{new ThreadBuffer};
+			buffer->id = uint32_t(g_buffers.size());
+			buffer->count = 0;
+			buffer->events.reset(new Event[Profiler::BufferCapacity]()); // Zeroed, so that pages are not first touched while recording.
+			t_buffer = buffer.get();
+			g_buffers.push_back(std::move(buffer));
+		}
+		t_buffer->name = "Worker";
+		return t_buffer;
+	}
+}
+
+std::atomic<bool> Profiler::s_active{false};
+
+void Profiler::start()
+{
+	g_startTimestamp = timestamp();
+	g_startTime = std::chrono::steady_clock::now();
+	s_active = true;
+	setThreadName("Main");
+
+	// Time empty zones on this thread & drop them from its buffer.
+	const auto overheadStart = std::chrono::steady_clock::now();
+	for(int i=0; i<NumOverheadZones; ++i) {
+		ProfileZone zone("Overhead");
+	}
+	const auto overheadEnd = std::chrono::steady_clock::now();
+	t_buffer->count = 0;
+
+	const double nanoseconds = std::chrono::duration<double, std::nano>(overheadEnd - overheadStart).count();
+	std::printf("CPU trace zones: %.1f ns per zone\n", nanoseconds / NumOverheadZones);
+}
+
+void Profiler::setThreadName(const char* name)
+{
+	if(!active()) {
+		return;
+	}
+	ThreadBuffer* buffer = t_buffer ? t_buffer : acquireBuffer();
+	buffer->name = name;
+}
+
+void Profiler::record(const char* name, uint64_t begin, uint64_t end)
+{
+	ThreadBuffer* buffer = t_buffer ? t_buffer : acquireBuffer();
+	const uint64_t index = buffer->count.load(std::memory_order_relaxed);
+	buffer->events[index & (BufferCapacity - 1)] = { name, begin, end };
+	buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::writeChromeTrace(const std::string& filename)
+{
+	s_active = false;
+
+	// Timestamp ticks per microsecond measured over the whole trace (TSC frequency is not reported by the CPU).
+	const double elapsedMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - g_startTime).count();
+	const double ticksPerMicrosecond = double(timestamp() - g_startTimestamp) / std::max(elapsedMicroseconds, 1.0);
+
+	FILE* file = std::fopen(filename.c_str(), "w");
+	if(!file) {
+		throw std::runtime_error("Failed to open trace file: " + filename);
+	}
+
+	std::lock_guard<std::mutex> lock(g_buffersMutex);
+	uint64_t numEvents = 0;
+	uint64_t numDropped = 0;
+	std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for(const std::unique_ptr<ThreadBuffer>& buffer : g_buffers) {
+		std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			(buffer->id > 0) ? ",\n" : "", buffer->id, buffer->name);
+
+		const uint64_t count = buffer->count.load(std::memory_order_acquire);
+		const uint64_t first = (count > BufferCapacity) ? (count - BufferCapacity) : 0;
+		for(uint64_t i=first; i<count; ++i) {
+			const Event& event = buffer->events[i & (BufferCapacity - 1)];
+			const double begin = double(int64_t(event.begin - g_startTimestamp)) / ticksPerMicrosecond;
+			const double duration = double(event.end - event.begin) / ticksPerMicrosecond;
+			std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				event.name, buffer->id, begin, duration);
+		}
+		numEvents += count - first;
+		numDropped += first;
+	}
+	std::fprintf(file, "\n]}\n");
+	std::fclose(file);
+
+	std::printf("CPU trace: %llu zones from %zu threads written to %s\n", (unsigned long long)numEvents, g_buffers.size(), filename.c_str());
+	if(numDropped > 0) {
+		std::fprintf(stderr, "CPU trace: %llu oldest zones were overwritten (more than %u per thread)\n", (unsigned long long)numDropped, BufferCapacity);
+	}
+}
@@ -0,0 +1,90 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_RDTSC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define PROFILER_RDTSC 1
+#endif
+
+// CPU trace zones (-trace <file>): scoped zones record begin & end timestamps into a ring buffer owned by the calling thread
+// (no locks or allocations once a thread has its buffer), buffers are merged & written as Chrome trace_event JSON on exit
+// (open in chrome://tracing or ui.perfetto.dev). Zones cost a single relaxed load when tracing is not active & are compiled
+// out entirely unless ENABLE_PROFILER is defined.
+class Profiler
+{
+public:
+	// Events kept per thread (oldest ones are overwritten once a thread records more than this between start & export).
+	static const uint32_t BufferCapacity = 1 << 15;
+
+	static void start();
+	static bool active()
+	{
+		return s_active.load(std::memory_order_relaxed);
+	}
+
+	// Name of calling thread in the exported trace (worker threads are named "Worker" unless they set a name themselves).
+	// Must be a string literal or otherwise outlive the profiler.
+	static void setThreadName(const char* name);
+
+	// Raw timestamp: TSC ticks on x86 (converted to microseconds on export), steady_clock nanoseconds elsewhere.
+	static uint64_t timestamp()
+	{
+#if PROFILER_RDTSC
+		return __rdtsc();
+#else
+		return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+	}
+	static void record(const char* name, uint64_t begin, uint64_t end);
+
+	// Stop tracing & write zones recorded by all threads so far (call once workers are idle; zones still open are dropped).
+	static void writeChromeTrace(const std::string& filename);
+
+private:
+	static std::atomic<bool> s_active;
+};
+
+class ProfileZone
+{
+public:
+	// Name must be a string literal (only the pointer is stored).
+	explicit ProfileZone(const char* name)
+		: m_name(Profiler::active() ? name : nullptr)
+		, m_begin(m_name ? Profiler::timestamp() : 0)
+	{}
+	~ProfileZone()
+	{
+		if(m_name) {
+			Profiler::record(m_name, m_begin, Profiler::timestamp());
+		}
+	}
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+	const char* m_name;
+	uint64_t m_begin;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#if defined(ENABLE_PROFILER)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__){name}
+#define PROFILE_THREAD_NAME(name) Profiler::setThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_THREAD_NAME(name)
+#endif
@@ -4,6 +4,11 @@
  */
 
 #pragma once
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
 
 struct GLFWwindow;
@@ -21,6 +26,12 @@ struct SceneSettings
 	float pitch = 0.0f;
 	float yaw = 0.0f;
 
+	// Index into RendererSettings::environments.
+	int environment = 0;
+
+	// Incremented to request current memory usage to be printed (see MemoryStats).
+	int memoryReportRequest = 0;
+
 	static const int NumLights = 3;
 	struct Light {
 		glm::vec3 direction;
@@ -29,13 +40,99 @@ struct SceneSettings
 	} lights[NumLights];
 };
 
+// Benchmarks run after setup instead of rendering interactively; each writes its results to a file & exits.
+enum class BenchmarkKind
+{
+	None,
+	// Sweep IBL pre-processing parameters (see IBLBenchmark).
+	IBL,
+	// Render with increasing numbers of dynamic lights (see LightBenchmark).
+	Lights,
+	// Render with & without depth pre-pass & count fragment shader invocations (see PrepassBenchmark).
+	DepthPrepass,
+	// Render with full & half precision shading & compare scene pass timings & errors (see HalfPrecisionBenchmark).
+	HalfPrecision,
+};
+
+struct RendererSettings
+{
+	// Render first frame with cheap IBL approximation and refine pre-filtered maps over subsequent frames.
+	bool progressiveIBL = false;
+	// GPU time budget (in milliseconds) for progressive IBL pre-processing per frame.
+	float iblFrameBudget = 2.0f;
+	// Equirectangular HDR environment maps to switch between (first one is loaded at startup).
+	std::vector<std::string> environments = { "environment.hdr" };
+	// Number of frames to blend between old and new pre-filtered maps after environment switch (0 to swap instantly).
+	int iblBlendFrames = 30;
+	// Device memory budget (in megabytes) for pre-filtered environment maps kept resident for instant switching.
+	float iblCacheBudget = 256.0f;
+	// Noise target for adaptive per-level specular pre-filter sample counts (0 to always take the maximum of 1024 samples).
+	// Default yields full sample count only for the roughest level.
+	float iblSampleErrorTarget = 1.0f / 32.0f;
+	// Read GGX sample directions from precomputed per-level tables instead of generating them for every texel.
+	bool iblSampleTables = true;
+	// Combine cosine-weighted & environment radiance importance sampling when computing irradiance map (far fewer samples).
+	bool iblEnvImportanceSampling = true;
+	// Sample pre-filtered specular environment from a 2D octahedral atlas converted from the cube map (see OctahedralAtlas).
+	bool iblOctahedralAtlas = false;
+	// Approximate split-sum specular BRDF scale & bias analytically instead of sampling the pre-computed LUT.
+	bool analyticBRDF = false;
+	// Evaluate BRDF factors in half precision if the device supports fp16 shader arithmetic (see PBRPermutation).
+	bool halfPrecision = true;
+	// Runtime reflection probes (xyz: world space position, w: radius of influence) blended with global environment lighting.
+	std::vector<glm::vec4> reflectionProbes;
+	// Reflection probe cube map face size (power of two, 32 to 1024).
+	int reflectionProbeSize = 128;
+	// Irradiance volume grid resolution (number of SH probes along each axis, zero disables the volume).
+	glm::ivec3 irradianceVolume = glm::ivec3{0};
+	// Cascaded shadow maps of analytical lights (see ShadowCascades) & their size (power of two, 256 to 4096).
+	bool shadows = false;
+	int shadowMapSize = 1024;
+	// Re-render shadow cascades only once light, scene rotation or camera moves past a threshold (otherwise every frame).
+	bool shadowCaching = true;
+	// Lay down the model's depth in a position-only pre-pass, shade only fragments which pass an equal depth test & draw skybox last.
+	bool depthPrepass = false;
+	// Anti-alias with jittered projection & temporal reprojection of history (see TemporalAA) instead of only MSAA.
+	bool temporalAA = false;
+	// Number of MSAA samples (0 for default: 16 without & 1 with temporal anti-aliasing), clamped to what the device supports.
+	int msaaSamples = 0;
+	// Scene color render target format: "rgba16f", "r11g11b10f" or "rgb9e5" (empty for default rgba16f); formats which are not
+	// renderable with the chosen number of samples fall back to the next wider one.
+	std::string hdrFormat;
+	// GPU frame time budget (in milliseconds) kept by scaling internal render resolution (see DynamicResolution), zero disables.
+	float frameTimeBudget = 0.0f;
+	// Also lower number of MSAA samples before resolution when over frame time budget.
+	bool dynamicSamples = false;
+	// Expose scene by its average luminance (GPU histogram adapted over time, see AutoExposure) instead of fixed exposure.
+	bool autoExposure = false;
+	// Benchmark to run after setup instead of rendering interactively.
+	BenchmarkKind benchmark = BenchmarkKind::None;
+	// Number of dynamic point & spot lights orbiting the model, shaded with clustered forward shading (see ClusteredLights).
+	int numDynamicLights = 0;
+	// Time IBL compute kernels with candidate thread group sizes if they are not cached for this device yet (see WorkgroupTuner).
+	bool autotuneWorkgroups = true;
+	// Ignore cached thread group sizes & tune them again.
+	bool retuneWorkgroups = false;
+	// Record CPU trace zones from startup to exit & write them to this file as Chrome trace_event JSON (see Profiler), empty disables.
+	std::string traceFilename;
+	// Device memory budget (in megabytes) over which allocations tracked by MemoryStats print a warning, zero disables.
+	float memoryBudget = 0.0f;
+	// Write startup phase breakdown (printed after the first frame or before a benchmark, see StartupReport) to this file as JSON, empty disables.
+	std::string startupReportFilename;
+};
+
 class RendererInterface
 {
 public:
 	virtual ~RendererInterface() = default;
 
-	virtual GLFWwindow* initialize(int width, int height, int maxSamples) = 0;
+	virtual GLFWwindow* initialize(int width, int height, int maxSamples, const RendererSettings& settings) = 0;
 	virtual void shutdown() = 0;
 	virtual void setup() = 0;
 	virtual void render(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene) = 0;
+	// Renderers override this for the benchmarks they implement.
+	virtual void runBenchmark(BenchmarkKind kind, GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene)
+	{
+		throw std::runtime_error("Selected benchmark is not supported by this renderer");
+	}
 };
@@ -0,0 +1,189 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "shadows.hpp"
+
+namespace {
+	// Blend between logarithmic (1) & uniform (0) distribution of cascade splits.
+	const float SplitLambda = 0.75f;
+	// Cached squares are enlarged by this fraction so that the camera can move a bit before cascades need to be re-rendered.
+	const float CacheMargin = 0.25f;
+	// Re-fit cascade once the part of the frustum it covers shrinks below this fraction of its cached square.
+	const float MinCoverage = 0.5f;
+	// Light direction (cosine of angle) & scene rotation (degrees) changes tolerated by cached cascades.
+	const float LightDirectionThreshold = 0.99999f;
+	const float SceneRotationThreshold = 0.1f;
+	// Normal offset of shaded positions in texels of the map.
+	const float NormalOffsetTexels = 1.5f;
+}
+
+ShadowCascades::ShadowCascades()
+{
+	reset(0, 0.0f, true);
+}
+
+void ShadowCascades::reset(int mapSize, float modelRadius, bool caching)
+{
+	m_mapSize = mapSize;
+	m_modelRadius = modelRadius;
+	m_caching = caching;
+
+	for(Map& map : m_maps) {
+		map = {};
+		map.viewProjectionMatrix = glm::mat4{0.0f};
+	}
+	std::fill(m_lightEnabled, m_lightEnabled + SceneSettings::NumLights, false);
+}
+
+void ShadowCascades::update(const SceneSettings& scene, const glm::mat4& viewMatrix, float fov, float aspect, float zNear)
+{
+	const glm::mat4 inverseViewMatrix = glm::inverse(viewMatrix);
+	const float tanHalfFovY = std::tan(0.5f * fov);
+	const float tanHalfFovX = tanHalfFovY * aspect;
+	const float R = m_modelRadius;
+
+	// View space depth range covered by the model's bounding sphere (origin's view space depth is -z of view matrix translation).
+	const float originDepth = -viewMatrix[3].z;
+	const float minDepth = std::max(zNear, originDepth - R);
+	const float maxDepth = originDepth + R;
+
+	for(int light=0; light<SceneSettings::NumLights; ++light) {
+		m_lightEnabled[light] = scene.lights[light].enabled && maxDepth > minDepth;
+		for(int cascade=0; cascade<NumCascades; ++cascade) {
+			m_maps[light * NumCascades + cascade].dirty = false;
+		}
+		if(!m_lightEnabled[light]) {
+			continue;
+		}
+
+		const glm::vec3 direction = glm::normalize(scene.lights[light].direction);
+		const glm::mat4 lightToView = lightViewMatrix(direction) * inverseViewMatrix;
+
+		for(int cascade=0; cascade<NumCascades; ++cascade) {
+			Map& map = m_maps[light * NumCascades + cascade];
+			++map.numFrames;
+
+			float depth[2];
+			for(int i=0; i<2; ++i) {
+				const float t = float(cascade + i) / NumCascades;
+				const float logSplit = minDepth * std::pow(maxDepth / minDepth, t);
+				const float uniformSplit = minDepth + (maxDepth - minDepth) * t;
+				depth[i] = SplitLambda * logSplit + (1.0f - SplitLambda) * uniformSplit;
+			}
+
+			// Light space bounds of this part of the frustum clipped to the model's bounding square (nothing else casts or receives shadows).
+			glm::vec2 minCorner{FLT_MAX};
+			glm::vec2 maxCorner{-FLT_MAX};
+			for(int corner=0; corner<8; ++corner) {
+				const float d = depth[corner >> 2];
+				const glm::vec4 viewPosition = {
+					((corner & 1) ? d : -d) * tanHalfFovX,
+					((corner & 2) ? d : -d) * tanHalfFovY,
+					-d,
+					1.0f,
+				};
+				const glm::vec2 lightPosition = glm::vec2{lightToView * viewPosition};
+				minCorner = glm::min(minCorner, lightPosition);
+				maxCorner = glm::max(maxCorner, lightPosition);
+			}
+			minCorner = glm::max(minCorner, glm::vec2{-R});
+			maxCorner = glm::min(maxCorner, glm::vec2{R});
+			if(glm::any(glm::greaterThan(minCorner, maxCorner))) {
+				continue;
+			}
+			const glm::vec2 center = 0.5f * (minCorner + maxCorner);
+			const float halfSize = 0.5f * std::max(maxCorner.x - minCorner.x, maxCorner.y - minCorner.y);
+
+			bool refit = !map.valid || !m_caching;
+			refit = refit || glm::dot(direction, map.lightDirection) < LightDirectionThreshold;
+			refit = refit || std::abs(scene.pitch - map.scenePitch) > SceneRotationThreshold || std::abs(scene.yaw - map.sceneYaw) > SceneRotationThreshold;
+			refit = refit || glm::any(glm::lessThan(minCorner, map.center - map.halfSize)) || glm::any(glm::greaterThan(maxCorner, map.center + map.halfSize));
+			refit = refit || halfSize < MinCoverage * map.halfSize;
+			if(!refit) {
+				continue;
+			}
+
+			// Square covering whole model is centered at origin, otherwise its center is snapped to the map's texel grid
+			// (with one texel border to stay conservative) so that re-fitted cascades of equal size don't shimmer.
+			float newHalfSize = halfSize * (m_caching ? 1.0f + CacheMargin : 1.0f);
+			glm::vec2 newCenter = center;
+			if(newHalfSize >= R) {
+				newHalfSize = R;
+				newCenter = glm::vec2{0.0f};
+			}
+			else {
+				newHalfSize += 2.0f * newHalfSize / m_mapSize;
+				const float texelSize = 2.0f * newHalfSize / m_mapSize;
+				newCenter = glm::floor(newCenter / texelSize + 0.5f) * texelSize;
+			}
+
+			// Light view space depth of the model's bounding sphere is always within [-R, R].
+			const glm::mat4 projectionMatrix = glm::ortho(newCenter.x - newHalfSize, newCenter.x + newHalfSize, newCenter.y - newHalfSize, newCenter.y + newHalfSize, -R, R);
+			map.viewProjectionMatrix = projectionMatrix * lightViewMatrix(direction);
+			map.lightDirection = direction;
+			map.scenePitch = scene.pitch;
+			map.sceneYaw = scene.yaw;
+			map.center = newCenter;
+			map.halfSize = newHalfSize;
+			map.valid = true;
+			map.dirty = true;
+			++map.numUpdates;
+		}
+	}
+}
+
+glm::mat4 ShadowCascades::shadowMatrix(int map) const
+{
+	// Maps which were never rendered transform everything outside of the map (shading then treats it as unshadowed).
+	if(!m_maps[map].valid) {
+		return glm::mat4{0.0f};
+	}
+	const glm::mat4 biasMatrix = glm::scale(glm::translate(glm::mat4{1.0f}, glm::vec3{0.5f}), glm::vec3{0.5f});
+	return biasMatrix * m_maps[map].viewProjectionMatrix;
+}
+
+float ShadowCascades::normalOffset(int map) const
+{
+	return NormalOffsetTexels * 2.0f * m_maps[map].halfSize / std::max(m_mapSize, 1);
+}
+
+void ShadowCascades::addRenderTime(int map, double ms)
+{
+	m_maps[map].totalMilliseconds += ms;
+	++m_maps[map].numTimedUpdates;
+}
+
+void ShadowCascades::report() const
+{
+	std::printf("Shadow cascades (%dpx, %s):\n", m_mapSize, m_caching ? "cached" : "re-rendered every frame");
+	for(int light=0; light<SceneSettings::NumLights; ++light) {
+		for(int cascade=0; cascade<NumCascades; ++cascade) {
+			const Map& map = m_maps[light * NumCascades + cascade];
+			if(map.numFrames == 0) {
+				continue;
+			}
+			std::printf("  light %d cascade %d: %d updates in %d frames (%.1f%%)", light, cascade, map.numUpdates, map.numFrames, 100.0 * map.numUpdates / map.numFrames);
+			if(map.numTimedUpdates > 0) {
+				std::printf(", %.3f ms per update\n", map.totalMilliseconds / map.numTimedUpdates);
+			}
+			else {
+				std::printf("\n");
+			}
+		}
+	}
+}
+
+glm::mat4 ShadowCascades::lightViewMatrix(const glm::vec3& direction)
+{
+	const glm::vec3 up = (std::abs(direction.y) > 0.99f) ? glm::vec3{0.0f, 0.0f, 1.0f} : glm::vec3{0.0f, 1.0f, 0.0f};
+	return glm::lookAt(glm::vec3{0.0f}, direction, up);
+}
@@ -0,0 +1,76 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "renderer.hpp"
+
+// Cascaded shadow maps of analytical (directional) lights. Part of the view frustum covering the model is split into cascades
+// fitted to light space squares; all cascades of all lights live in layers of a single depth texture array (layer light * NumCascades + cascade).
+// Only the model casts shadows and nothing else moves, so a cascade's map stays valid until its light or scene rotation changes;
+// cascades are fitted with a margin & re-rendered only once the camera moves their part of the frustum outside of the cached square
+// (or it shrinks enough to waste most of the map's resolution).
+class ShadowCascades
+{
+public:
+	// Must match NumShadowCascades in pbr_fs shader.
+	static const int NumCascades = 3;
+	static const int NumMaps = SceneSettings::NumLights * NumCascades;
+
+	ShadowCascades();
+
+	// Set up cascades for maps of given size & model of given bounding radius (centered at origin); all cascades start out invalid.
+	// Without caching every cascade of every enabled light is re-rendered each frame.
+	void reset(int mapSize, float modelRadius, bool caching);
+	int mapSize() const { return m_mapSize; }
+
+	// Fit cascades of enabled lights to given view (symmetric perspective projection with given vertical field of view in radians)
+	// & mark those which need to be re-rendered this frame.
+	void update(const SceneSettings& scene, const glm::mat4& viewMatrix, float fov, float aspect, float zNear);
+
+	// Map needs to be re-rendered this frame (with renderMatrix below).
+	bool dirty(int map) const { return m_maps[map].dirty; }
+	// Light view-projection matrix (OpenGL clip space) the map was rendered with & matrix transforming world space positions
+	// into map texture coordinates & depth (all in 0 to 1 range).
+	const glm::mat4& renderMatrix(int map) const { return m_maps[map].viewProjectionMatrix; }
+	glm::mat4 shadowMatrix(int map) const;
+	// Normal offset applied to shaded positions before map lookup (scaled to world space texel size of the map).
+	float normalOffset(int map) const;
+	// Layer of first cascade of given light or -1 if it casts no shadows.
+	int firstMap(int light) const { return m_lightEnabled[light] ? light * NumCascades : -1; }
+
+	// Accumulate GPU time of rendering given map (for report).
+	void addRenderTime(int map, double ms);
+	// Print number of updates per frame & average render time of each cascade.
+	void report() const;
+
+private:
+	struct Map
+	{
+		glm::mat4 viewProjectionMatrix;
+		glm::vec3 lightDirection;
+		float scenePitch, sceneYaw;
+		glm::vec2 center; // Light space center of cached square.
+		float halfSize;   // Half size of cached square.
+		bool valid;
+		bool dirty;
+
+		// Statistics.
+		int numFrames;
+		int numUpdates;
+		int numTimedUpdates;
+		double totalMilliseconds;
+	};
+
+	static glm::mat4 lightViewMatrix(const glm::vec3& direction);
+
+	Map m_maps[NumMaps];
+	bool m_lightEnabled[SceneSettings::NumLights];
+	int m_mapSize;
+	float m_modelRadius;
+	bool m_caching;
+};
@@ -0,0 +1,182 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <stdexcept>
+#include <vector>
+
+#if _WIN32
+#include <Windows.h>
+#endif // _WIN32
+
+#include "startup.hpp"
+
+namespace {
+	struct Phase
+	{
+		const char* name;
+		double wallMs;
+		double cpuMs;
+		double gpuMs;
+		bool gpuMeasured;
+		uint64_t bytesRead;
+		uint64_t bytesUploaded;
+	};
+
+	bool g_active = false;
+	std::vector<Phase> g_phases;
+
+	// Current phase start (byte counters are running totals, phases get the difference).
+	std::chrono::steady_clock::time_point g_phaseStartTime;
+	double g_phaseStartCpuMs;
+	uint64_t g_phaseStartBytesRead;
+	uint64_t g_phaseStartBytesUploaded;
+
+	std::atomic<uint64_t> g_bytesRead{0};
+	std::atomic<uint64_t> g_bytesUploaded{0};
+
+	// CPU time of all threads of the process (worker threads make it exceed wall time).
+	double processCpuMilliseconds()
+	{
+#if _WIN32
+		FILETIME creationTime, exitTime, kernelTime, userTime;
+		if(!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+			return 0.0;
+		}
+		const uint64_t kernel = (uint64_t(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+		const uint64_t user = (uint64_t(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+		return double(kernel + user) * 1e-4; // 100 ns units
+#else
+		timespec time;
+		if(clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time) != 0) {
+			return 0.0;
+		}
+		return double(time.tv_sec) * 1e3 + double(time.tv_nsec) * 1e-6;
+#endif // _WIN32
+	}
+
+	void openPhase(const char* name)
+	{
+		g_phases.push_back({ name, 0.0, 0.0, 0.0, false, 0, 0 });
+		g_phaseStartTime = std::chrono::steady_clock::now();
+		g_phaseStartCpuMs = processCpuMilliseconds();
+		g_phaseStartBytesRead = g_bytesRead;
+		g_phaseStartBytesUploaded = g_bytesUploaded;
+	}
+
+	void closePhase()
+	{
+		Phase& phase = g_phases.back();
+		phase.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - g_phaseStartTime).count();
+		phase.cpuMs = processCpuMilliseconds() - g_phaseStartCpuMs;
+		phase.bytesRead = g_bytesRead - g_phaseStartBytesRead;
+		phase.bytesUploaded = g_bytesUploaded - g_phaseStartBytesUploaded;
+	}
+}
+
+void StartupReport::start()
+{
+	g_phases.clear();
+	g_active = true;
+	openPhase("initialize");
+}
+
+void StartupReport::beginPhase(const char* name)
+{
+	if(g_active) {
+		closePhase();
+		openPhase(name);
+	}
+}
+
+bool StartupReport::active()
+{
+	return g_active;
+}
+
+void StartupReport::addGpuTime(double ms)
+{
+	if(g_active) {
+		g_phases.back().gpuMs += ms;
+		g_phases.back().gpuMeasured = true;
+	}
+}
+
+void StartupReport::addBytesRead(uint64_t bytes)
+{
+	g_bytesRead += bytes;
+}
+
+void StartupReport::addBytesUploaded(uint64_t bytes)
+{
+	g_bytesUploaded += bytes;
+}
+
+void StartupReport::finish(const std::string& jsonFilename)
+{
+	if(!g_active) {
+		return;
+	}
+	closePhase();
+	g_active = false;
+
+	Phase total = { "total", 0.0, 0.0, 0.0, false, 0, 0 };
+	for(const Phase& phase : g_phases) {
+		total.wallMs += phase.wallMs;
+		total.cpuMs += phase.cpuMs;
+		total.gpuMs += phase.gpuMs;
+		total.gpuMeasured = total.gpuMeasured || phase.gpuMeasured;
+		total.bytesRead += phase.bytesRead;
+		total.bytesUploaded += phase.bytesUploaded;
+	}
+
+	const double MB = 1024.0 * 1024.0;
+	auto printPhase = [MB](const Phase& phase) {
+		char gpuMs[16] = "-";
+		if(phase.gpuMeasured) {
+			std::snprintf(gpuMs, sizeof(gpuMs), "%.2f", phase.gpuMs);
+		}
+		std::printf("  %-40s %10.2f %10.2f %10s %10.2f %10.2f\n", phase.name, phase.wallMs, phase.cpuMs, gpuMs, phase.bytesRead / MB, phase.bytesUploaded / MB);
+	};
+	std::printf("Startup breakdown:\n");
+	std::printf("  %-40s %10s %10s %10s %10s %10s\n", "Phase", "Wall ms", "CPU ms", "GPU ms", "Read MB", "Upload MB");
+	for(const Phase& phase : g_phases) {
+		printPhase(phase);
+	}
+	printPhase(total);
+
+	if(jsonFilename.empty()) {
+		return;
+	}
+	FILE* file = std::fopen(jsonFilename.c_str(), "w");
+	if(!file) {
+		throw std::runtime_error("Failed to open startup report file: " + jsonFilename);
+	}
+	// GPU time is null for phases without any measured pass.
+	auto writePhase = [file](const Phase& phase) {
+		std::fprintf(file, "{\"name\": \"%s\", \"wall_ms\": %.3f, \"cpu_ms\": %.3f, ", phase.name, phase.wallMs, phase.cpuMs);
+		if(phase.gpuMeasured) {
+			std::fprintf(file, "\"gpu_ms\": %.3f, ", phase.gpuMs);
+		}
+		else {
+			std::fprintf(file, "\"gpu_ms\": null, ");
+		}
+		std::fprintf(file, "\"bytes_read\": %llu, \"bytes_uploaded\": %llu}", (unsigned long long)phase.bytesRead, (unsigned long long)phase.bytesUploaded);
+	};
+	std::fprintf(file, "{\n  \"total_ms\": %.3f,\n  \"phases\": [\n", total.wallMs);
+	for(size_t i=0; i<g_phases.size(); ++i) {
+		std::fprintf(file, "    ");
+		writePhase(g_phases[i]);
+		std::fprintf(file, "%s\n", (i+1 < g_phases.size()) ? "," : "");
+	}
+	std::fprintf(file, "  ],\n  \"total\": ");
+	writePhase(total);
+	std::fprintf(file, "\n}\n");
+	std::fclose(file);
+	std::printf("Startup breakdown written to %s\n", jsonFilename.c_str());
+}
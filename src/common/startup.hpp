@@ -0,0 +1,31 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Startup accounting (time to first frame): startup is split into consecutive phases, each one lasting until the next begins.
+// Every phase gets its wall & process CPU time, GPU time of passes measured during it, bytes read from disk & bytes uploaded
+// to the GPU. The breakdown is printed once the first frame has been rendered (or before a benchmark starts, without the first
+// frame) & optionally written as JSON (-startup-json <file>).
+class StartupReport
+{
+public:
+	// Start accounting with the "initialize" phase (ends the previous report, if any).
+	static void start();
+	// End current phase & begin the next one. Name must be a string literal (only the pointer is stored).
+	static void beginPhase(const char* name);
+	static bool active();
+
+	// Attribute GPU time (measured by timer queries on the rendering thread) & transferred bytes (from any thread) to current phase.
+	static void addGpuTime(double ms);
+	static void addBytesRead(uint64_t bytes);
+	static void addBytesUploaded(uint64_t bytes);
+
+	// End last phase, print the breakdown & write it to given JSON file (unless empty). Does nothing if accounting is not active.
+	static void finish(const std::string& jsonFilename);
+};
@@ -0,0 +1,119 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cstdio>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "taa.hpp"
+
+namespace {
+	// Weight of reprojected history in the blended result (rest is current frame).
+	const float HistoryWeight = 0.9f;
+
+	// Radical inverse of index in given base (Halton sequence).
+	float halton(int index, int base)
+	{
+		float result = 0.0f;
+		float fraction = 1.0f / base;
+		for(; index > 0; index /= base) {
+			result += fraction * (index % base);
+			fraction /= base;
+		}
+		return result;
+	}
+}
+
+TemporalAA::TemporalAA()
+	: m_numTimedFrames(0)
+	, m_totalMilliseconds(0.0)
+{
+	reset(1, 1, false);
+}
+
+void TemporalAA::reset(int width, int height, bool depthZeroToOne)
+{
+	m_width = width;
+	m_height = height;
+	m_depthZeroToOne = depthZeroToOne;
+	m_frame = 0;
+	m_historyValid = false;
+}
+
+TemporalAA::Uniforms TemporalAA::update(const glm::mat4& viewProjectionMatrix, const glm::mat4& skyProjectionMatrix, const glm::mat4& sceneRotationMatrix)
+{
+	++m_frame;
+
+	// Texture coordinates & depth to clip space of current frame.
+	const glm::mat4 clipFromTexture = m_depthZeroToOne
+		? glm::scale(glm::translate(glm::mat4{1.0f}, glm::vec3{-1.0f, -1.0f, 0.0f}), glm::vec3{2.0f, 2.0f, 1.0f})
+		: glm::scale(glm::translate(glm::mat4{1.0f}, glm::vec3{-1.0f}), glm::vec3{2.0f});
+
+	Uniforms uniforms;
+	if(m_historyValid) {
+		// Model positions are rotated by the scene, skybox directions only by the view.
+		uniforms.reprojectionMatrix = m_previousViewProjectionMatrix * m_previousSceneRotationMatrix
+			* glm::inverse(viewProjectionMatrix * sceneRotationMatrix) * clipFromTexture;
+		uniforms.skyReprojectionMatrix = m_previousSkyProjectionMatrix * glm::inverse(skyProjectionMatrix) * clipFromTexture;
+		uniforms.parameters = glm::vec4{HistoryWeight, 1.0f, 0.0f, 0.0f};
+	}
+	else {
+		uniforms.reprojectionMatrix = glm::mat4{1.0f};
+		uniforms.skyReprojectionMatrix = glm::mat4{1.0f};
+		uniforms.parameters = glm::vec4{0.0f, 1.0f, 0.0f, 0.0f};
+	}
+
+	m_previousViewProjectionMatrix = viewProjectionMatrix;
+	m_previousSkyProjectionMatrix = skyProjectionMatrix;
+	m_previousSceneRotationMatrix = sceneRotationMatrix;
+	m_historyValid = true;
+	return uniforms;
+}
+
+glm::vec2 TemporalAA::jitter() const
+{
+	// Halton (2,3) sequence skipping its first point (origin).
+	const int index = int(m_frame % NumJitterSamples) + 1;
+	return glm::vec2{halton(index, 2), halton(index, 3)} - 0.5f;
+}
+
+glm::mat4 TemporalAA::jitterProjection(const glm::mat4& projectionMatrix) const
+{
+	// Offset in NDC is twice the offset in pixels divided by framebuffer size (translation is scaled by clip space w).
+	const glm::vec2 offset = 2.0f * jitter() / glm::vec2{float(m_width), float(m_height)};
+	return glm::translate(glm::mat4{1.0f}, glm::vec3{offset, 0.0f}) * projectionMatrix;
+}
+
+void TemporalAA::addFrameTime(double ms)
+{
+	m_totalMilliseconds += ms;
+	++m_numTimedFrames;
+}
+
+void TemporalAA::report(const std::string& backend, const std::string& device, bool enabled, int samples, const std::string& colorFormat, uint64_t renderTargetBytes) const
+{
+	const std::string mode = std::to_string(samples) + "x MSAA" + (enabled ? " + TAA" : "") + ", " + colorFormat;
+	const double renderTargetMB = renderTargetBytes / (1024.0 * 1024.0);
+	const double frameMs = m_totalMilliseconds / std::max(m_numTimedFrames, 1);
+	std::printf("Anti-aliasing (%s): render targets %.1f MB, %.3f ms per frame (GPU, average of %d frames)\n",
+		mode.c_str(), renderTargetMB, frameMs, m_numTimedFrames);
+
+	// Appended to, so that runs with different anti-aliasing settings end up in the same table (reported on every exit,
+	// so failing to write it is not an error).
+	const std::string csvFilename = "aa_report_" + backend + ".csv";
+	FILE* file = std::fopen(csvFilename.c_str(), "a");
+	if(!file) {
+		std::fprintf(stderr, "Failed to open anti-aliasing report file: %s\n", csvFilename.c_str());
+		return;
+	}
+	std::fseek(file, 0, SEEK_END);
+	if(std::ftell(file) == 0) {
+		std::fprintf(file, "backend,device,msaa_samples,taa,color_format,width,height,render_target_mb,gpu_frame_ms,frames\n");
+	}
+	std::fprintf(file, "%s,\"%s\",%d,%d,%s,%d,%d,%.2f,%.4f,%d\n", backend.c_str(), device.c_str(), samples, enabled ? 1 : 0, colorFormat.c_str(),
+		m_width, m_height, renderTargetMB, frameMs, m_numTimedFrames);
+	std::fclose(file);
+}
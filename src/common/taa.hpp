@@ -0,0 +1,64 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <glm/glm.hpp>
+
+// Temporal anti-aliasing: projection is jittered by a sub-pixel Halton sequence every frame & taa_cs blends the current frame
+// with history reprojected from the previous one (clamped to the current pixel's neighbourhood). Nothing but the camera & the
+// model's rotation moves, so instead of a motion vector buffer each pixel is reprojected from its depth: pixels at the far plane
+// belong to the skybox (view rotation only), all others to the model (view & scene rotation).
+// Also accumulates render target memory & GPU frame time, so that anti-aliasing modes & scene color formats can be compared between runs.
+class TemporalAA
+{
+public:
+	static const int NumJitterSamples = 8;
+
+	// Shader parameters (std140): reprojection matrices map current texture coordinates & depth (uv, depth, 1) to previous
+	// frame's clip space, x of parameters is weight of history (zero if there is none) & y is depth at the far plane.
+	struct Uniforms
+	{
+		glm::mat4 reprojectionMatrix;
+		glm::mat4 skyReprojectionMatrix;
+		glm::vec4 parameters;
+	};
+
+	TemporalAA();
+
+	// Start over with empty history for given framebuffer size; depth range of window space is [0,1] mapped either
+	// to [-1,1] (OpenGL) or [0,1] (Vulkan) clip space depth.
+	void reset(int width, int height, bool depthZeroToOne);
+
+	// Begin new frame: advance jitter sequence & compute reprojection of this frame's pixels (given unjittered matrices)
+	// into the previous one (matrices of the previous call).
+	Uniforms update(const glm::mat4& viewProjectionMatrix, const glm::mat4& skyProjectionMatrix, const glm::mat4& sceneRotationMatrix);
+
+	// Sub-pixel jitter of current frame in pixels (within [-0.5, 0.5]) & given projection matrix offset by it.
+	glm::vec2 jitter() const;
+	glm::mat4 jitterProjection(const glm::mat4& projectionMatrix) const;
+	// Index (0 or 1) of history buffer written this frame, the other one holds previous frame.
+	int historyIndex() const { return int(m_frame & 1); }
+
+	// Accumulate GPU time of a whole frame & print averages together with render target memory on exit
+	// (also appended to aa_report_<backend>.csv to compare anti-aliasing modes & color formats side by side).
+	void addFrameTime(double ms);
+	void report(const std::string& backend, const std::string& device, bool enabled, int samples, const std::string& colorFormat, uint64_t renderTargetBytes) const;
+
+private:
+	int m_width, m_height;
+	bool m_depthZeroToOne;
+	uint64_t m_frame;
+
+	bool m_historyValid;
+	glm::mat4 m_previousViewProjectionMatrix;
+	glm::mat4 m_previousSkyProjectionMatrix;
+	glm::mat4 m_previousSceneRotationMatrix;
+
+	int m_numTimedFrames;
+	double m_totalMilliseconds;
+};
@@ -12,9 +12,12 @@
 #endif // _WIN32
 
 #include "utils.hpp"
+#include "profiler.hpp"
+#include "startup.hpp"
 
 std::string File::readText(const std::string& filename)
 {
+	PROFILE_ZONE("File::readText");
 	std::ifstream file{filename};
 	if(!file.is_open()) {
 		throw std::runtime_error("Could not open file: " + filename);
@@ -22,11 +25,14 @@ std::string File::readText(const std::string& filename)
 
 	std::stringstream buffer;
 	buffer << file.rdbuf();
-	return buffer.str();
+	std::string text = buffer.str();
+	StartupReport::addBytesRead(text.size());
+	return text;
 }
 	
 std::vector<char> File::readBinary(const std::string& filename)
 {
+	PROFILE_ZONE("File::readBinary");
 	std::ifstream file{filename, std::ios::binary | std::ios::ate};
 	if(!file.is_open()) {
 		throw std::runtime_error("Could not open file: " + filename);
@@ -37,9 +43,19 @@ std::vector<char> File::readBinary(const std::string& filename)
 
 	std::vector<char> buffer(size);
 	file.read(buffer.data(), size);
+	StartupReport::addBytesRead(uint64_t(size));
 	return buffer;
 }
 
+uint64_t File::size(const std::string& filename)
+{
+	std::ifstream file{filename, std::ios::binary | std::ios::ate};
+	if(!file.is_open()) {
+		return 0;
+	}
+	return uint64_t(file.tellg());
+}
+
 #if _WIN32
 std::string Utility::convertToUTF8(const std::wstring& wstr)
 {
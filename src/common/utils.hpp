@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -13,6 +14,8 @@ class File
 public:
 	static std::string readText(const std::string& filename);
 	static std::vector<char> readBinary(const std::string& filename);
+	// Size of a file in bytes (zero if it cannot be opened).
+	static uint64_t size(const std::string& filename);
 };
 
 class Utility
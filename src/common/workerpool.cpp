@@ -0,0 +1,99 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+
+#include "workerpool.hpp"
+
+WorkerPool::WorkerPool()
+	: m_task(nullptr)
+	, m_context(nullptr)
+	, m_count(0)
+	, m_countPerThread(0)
+	, m_pending(0)
+	, m_generation(0)
+	, m_stopping(false)
+{}
+
+WorkerPool::~WorkerPool()
+{
+	stop();
+}
+
+void WorkerPool::start(int numWorkers)
+{
+	stop();
+	m_stopping = false;
+	for(int i=1; i<=numWorkers; ++i) {
+		m_workers.emplace_back(&WorkerPool::workerMain, this, i, m_generation);
+	}
+}
+
+void WorkerPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	for(std::thread& worker : m_workers) {
+		worker.join();
+	}
+	m_workers.clear();
+}
+
+void WorkerPool::run(int count, Task task, const void* context)
+{
+	const int numThreads = std::min(count, this->numThreads());
+	if(numThreads <= 1) {
+		if(count > 0) {
+			task(context, 0, count);
+		}
+		return;
+	}
+
+	const int countPerThread = (count + numThreads - 1) / numThreads;
+	{
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_task = task;
+		m_context = context;
+		m_count = count;
+		m_countPerThread = countPerThread;
+		m_pending = (int)m_workers.size();
+		++m_generation;
+	}
+	m_wake.notify_all();
+
+	task(context, 0, std::min(count, countPerThread));
+
+	std::unique_lock<std::mutex> lock{m_mutex};
+	m_done.wait(lock, [this]() { return m_pending == 0; });
+}
+
+void WorkerPool::workerMain(int index, uint64_t generation)
+{
+	std::unique_lock<std::mutex> lock{m_mutex};
+	while(true) {
+		m_wake.wait(lock, [this, &generation]() { return m_stopping || m_generation != generation; });
+		if(m_stopping) {
+			return;
+		}
+		generation = m_generation;
+
+		// Workers beyond the end of a short range have nothing to do but still report back.
+		const Task task = m_task;
+		const void* context = m_context;
+		const int begin = std::min(m_count, index * m_countPerThread);
+		const int end = std::min(m_count, (index+1) * m_countPerThread);
+		lock.unlock();
+		if(begin < end) {
+			task(context, begin, end);
+		}
+		lock.lock();
+		if(--m_pending == 0) {
+			m_done.notify_one();
+		}
+	}
+}
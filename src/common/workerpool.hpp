@@ -0,0 +1,57 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads for CPU work split every frame: threads are started once & woken for each parallel loop, so that
+// frames neither pay for thread creation nor allocate thread state on the heap.
+class WorkerPool
+{
+public:
+	WorkerPool();
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// (Re)start given number of worker threads in addition to the calling thread (zero runs everything on the calling thread).
+	void start(int numWorkers);
+	void stop();
+	int numThreads() const { return (int)m_workers.size() + 1; }
+
+	// Run function over [0, count) range split evenly between workers & the calling thread (which takes the first part)
+	// and wait for all parts to finish. Function is called as func(begin, end) & must not be invoked re-entrantly.
+	template<typename Func> void parallelFor(int count, const Func& func)
+	{
+		run(count, [](const void* context, int begin, int end) { (*static_cast<const Func*>(context))(begin, end); }, &func);
+	}
+
+private:
+	using Task = void(*)(const void* context, int begin, int end);
+
+	void run(int count, Task task, const void* context);
+	// Worker waits for the first loop after given generation (the one current when it was started).
+	void workerMain(int index, uint64_t generation);
+
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	// Current loop (guarded by m_mutex): workers pick it up once generation changes & decrement pending count when done.
+	Task m_task;
+	const void* m_context;
+	int m_count;
+	int m_countPerThread;
+	int m_pending;
+	uint64_t m_generation;
+	bool m_stopping;
+};
@@ -0,0 +1,142 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "workgroups.hpp"
+
+namespace {
+	// One line per device: device key, tab, sizes of all kernels (in WorkgroupTuner::Kernel order) separated by spaces.
+	const char* CacheFilename = "workgroups.cache";
+
+	// Keys are stored verbatim up to the separator so make sure device & driver strings can't contain one.
+	std::string sanitizeKey(std::string key)
+	{
+		std::replace(key.begin(), key.end(), '\t', ' ');
+		std::replace(key.begin(), key.end(), '\n', ' ');
+		return key;
+	}
+
+	std::vector<std::string> readCacheLines()
+	{
+		std::vector<std::string> lines;
+		std::ifstream file{CacheFilename};
+		std::string line;
+		while(std::getline(file, line)) {
+			if(!line.empty()) {
+				lines.push_back(line);
+			}
+		}
+		return lines;
+	}
+}
+
+WorkgroupTuner::WorkgroupTuner()
+	: m_tuned(false)
+{
+	std::fill(m_sizes, m_sizes + NumKernels, int(DefaultSize));
+	std::fill(m_pending, m_pending + NumKernels, false);
+}
+
+void WorkgroupTuner::reset(const std::string& deviceKey, bool autotune, bool retune)
+{
+	m_deviceKey = sanitizeKey(deviceKey);
+	m_tuned = false;
+	std::fill(m_sizes, m_sizes + NumKernels, int(DefaultSize));
+	std::fill(m_pending, m_pending + NumKernels, autotune);
+
+	if(autotune && retune) {
+		return;
+	}
+	for(const std::string& line : readCacheLines()) {
+		const size_t separator = line.find('\t');
+		if(separator == std::string::npos || line.substr(0, separator) != m_deviceKey) {
+			continue;
+		}
+		std::istringstream sizes{line.substr(separator+1)};
+		for(int kernel=0; kernel<NumKernels; ++kernel) {
+			// Dispatch sizes assume groups evenly divide power of two textures (no larger than the default).
+			int size;
+			if(sizes >> size && size > 0 && size <= DefaultSize && (size & (size-1)) == 0) {
+				m_sizes[kernel] = size;
+				m_pending[kernel] = false;
+			}
+		}
+		std::printf("Workgroup sizes: using cached values for %s\n", m_deviceKey.c_str());
+		break;
+	}
+}
+
+void WorkgroupTuner::save() const
+{
+	if(!m_tuned) {
+		return;
+	}
+
+	std::ostringstream entry;
+	entry << m_deviceKey << '\t';
+	for(int kernel=0; kernel<NumKernels; ++kernel) {
+		entry << (kernel > 0 ? " " : "") << m_sizes[kernel];
+	}
+
+	// Replace existing entry for this device, keep entries of other devices.
+	std::vector<std::string> lines = readCacheLines();
+	lines.erase(std::remove_if(lines.begin(), lines.end(), [this](const std::string& line) {
+		return line.substr(0, line.find('\t')) == m_deviceKey;
+	}), lines.end());
+	lines.push_back(entry.str());
+
+	std::ofstream file{CacheFilename};
+	if(!file.is_open()) {
+		throw std::runtime_error(std::string("Could not create workgroup cache file: ") + CacheFilename);
+	}
+	for(const std::string& line : lines) {
+		file << line << '\n';
+	}
+}
+
+void WorkgroupTuner::select(Kernel kernel, const std::vector<int>& candidates, const std::vector<double>& timings)
+{
+	if(candidates.empty() || timings.size() != candidates.size()) {
+		return;
+	}
+
+	const size_t best = std::min_element(timings.begin(), timings.end()) - timings.begin();
+	m_sizes[kernel] = candidates[best];
+	m_pending[kernel] = false;
+	m_tuned = true;
+
+	std::printf("Workgroup size for %s: %dx%d (", kernelName(kernel), m_sizes[kernel], m_sizes[kernel]);
+	for(size_t i=0; i<candidates.size(); ++i) {
+		std::printf("%s%dx%d: %.3f ms", i > 0 ? ", " : "", candidates[i], candidates[i], timings[i]);
+	}
+	std::printf(")\n");
+}
+
+std::vector<int> WorkgroupTuner::candidates(int maxInvocations)
+{
+	std::vector<int> sizes;
+	for(int size : { 8, 16, 32 }) {
+		if(size * size <= maxInvocations) {
+			sizes.push_back(size);
+		}
+	}
+	return sizes;
+}
+
+const char* WorkgroupTuner::kernelName(Kernel kernel)
+{
+	switch(kernel) {
+	case Equirect2Cube:  return "equirect2cube_cs";
+	case SpecularFilter: return "spmap_cs";
+	case Irradiance:     return "irmap_cs";
+	case SpecularBRDF:   return "spbrdf_cs";
+	default:             return "unknown";
+	}
+}
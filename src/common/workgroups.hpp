@@ -0,0 +1,54 @@
+/*
+ * Physically Based Rendering
+ * Copyright (c) 2017-2018 Michał Siejak
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Thread group sizes of IBL pre-processing compute kernels. Best size depends on the device (large 32x32 groups schedule
+// poorly on many GPUs & software rasterizers) so each kernel is timed with every candidate size on first run and the
+// fastest ones are cached per device & driver in a text file, to be reused on subsequent startups.
+// Groups are always square so that kernels keep processing whole rows of groups (see IBLScheduler).
+class WorkgroupTuner
+{
+public:
+	enum Kernel
+	{
+		Equirect2Cube,
+		SpecularFilter,
+		Irradiance,
+		SpecularBRDF,
+		NumKernels,
+	};
+
+	static const int DefaultSize = 32;
+	// Timed dispatches per candidate (fastest one counts), each preceded by a single warm-up dispatch.
+	static const int NumTimedRuns = 3;
+
+	WorkgroupTuner();
+
+	// Start with sizes cached for given device (or defaults). Kernels missing from cache, or all of them if retune is set,
+	// are marked pending. If autotune is not set nothing is ever pending and defaults are used unless cached.
+	void reset(const std::string& deviceKey, bool autotune, bool retune);
+	// Write back sizes of all tuned kernels (no-op if nothing has been tuned since reset).
+	void save() const;
+
+	bool pending(Kernel kernel) const { return m_pending[kernel]; }
+	int size(Kernel kernel) const { return m_sizes[kernel]; }
+
+	// Pick fastest candidate given dispatch timings (in milliseconds, in the same order).
+	void select(Kernel kernel, const std::vector<int>& candidates, const std::vector<double>& timings);
+
+	// Candidate group sizes (width & height) fitting within device limit of threads per group.
+	static std::vector<int> candidates(int maxInvocations);
+	static const char* kernelName(Kernel kernel);
+
+private:
+	std::string m_deviceKey;
+	int m_sizes[NumKernels];
+	bool m_pending[NumKernels];
+	bool m_tuned;
+};
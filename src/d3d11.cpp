@@ -43,7 +43,7 @@ struct ShadingCB
 	glm::vec4 eyePosition;
 };
 
-GLFWwindow* Renderer::initialize(int width, int height, int maxSamples)
+GLFWwindow* Renderer::initialize(int width, int height, int maxSamples, const RendererSettings& settings)
 {
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 	GLFWwindow* window = glfwCreateWindow(width, height, "Physically Based Rendering (Direct3D 11)", nullptr, nullptr);
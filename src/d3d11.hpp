@@ -69,7 +69,7 @@ struct Texture
 class Renderer final : public RendererInterface
 {
 public:
-	GLFWwindow* initialize(int width, int height, int maxSamples) override;
+	GLFWwindow* initialize(int width, int height, int maxSamples, const RendererSettings& settings) override;
 	void shutdown() override {}
 	void setup() override;
 	void render(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene) override;
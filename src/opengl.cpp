@@ -8,7 +8,10 @@
 #if defined(ENABLE_OPENGL)
 
 #include <stdexcept>
+#include <cstring>
 #include <memory>
+#include <chrono>
+#include <limits>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -18,11 +21,155 @@
 
 #include "common/mesh.hpp"
 #include "common/image.hpp"
+#include "common/envsampling.hpp"
+#include "common/iblbench.hpp"
+#include "common/lightbench.hpp"
+#include "common/prepassbench.hpp"
+#include "common/fp16bench.hpp"
 #include "common/utils.hpp"
+#include "common/profiler.hpp"
+#include "common/startup.hpp"
 #include "opengl.hpp"
 
+// ARB_pipeline_statistics_query (core since OpenGL 4.6).
+#ifndef GL_FRAGMENT_SHADER_INVOCATIONS
+#define GL_FRAGMENT_SHADER_INVOCATIONS 0x82F4
+#endif
+
+// NVX_gpu_memory_info (dedicated video memory size & currently available amount, in kilobytes).
+#ifndef GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX
+#define GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX 0x9048
+#define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#endif
+
 namespace OpenGL {
 
+// Maximum specular pre-filter sample count & irradiance sample count (must match default NumSamples in irmap_cs shader).
+static constexpr int kSpecularSamples = 1024;
+static constexpr int kIrradianceSamples = 64 * 1024;
+// Irradiance sample pairs (cosine lobe & environment distribution) taken with environment importance sampling.
+static constexpr int kIrradianceMISSamples = 2 * 1024;
+
+// Specular pre-filter processes each level in square thread groups (of tuned size, see WorkgroupTuner), mip tail levels
+// smaller than that are folded into a single dispatch of 1D thread groups.
+static constexpr int kSpecularMipTailGroupSize = 64;
+
+// Number of sample batches used for progressive irradiance map refinement & its initial approximation.
+static constexpr int kIrradianceBatches = 16;
+static constexpr int kIrradianceApproxBatches = 64;
+
+// Reflection probe captures change often so their irradiance is computed with plain uniform hemisphere sampling in a single
+// dispatch (without building an environment distribution). Probe irradiance map fits a single default size irmap_cs thread group per face.
+static constexpr int kProbeIrradianceSamples = 4 * 1024;
+static constexpr int kProbeIrradianceMapSize = 32;
+
+// Irradiance volume probes baked per frame & their capture cube map face size (SH projection only needs low frequencies).
+static constexpr int kVolumeBatchSize = 8;
+static constexpr int kVolumeCaptureSize = 32;
+
+// Slope scaled & constant depth bias of shadow map rendering.
+static constexpr float kShadowSlopeBias = 2.0f;
+static constexpr float kShadowConstantBias = 4.0f;
+
+// Depth range of main view projection (also spanned by clustered light froxels).
+static constexpr float kViewZNear = 1.0f;
+static constexpr float kViewZFar = 1000.0f;
+
+// Number of frames between queries of driver reported memory usage (NVX_gpu_memory_info).
+static constexpr int kMemoryBudgetQueryInterval = 64;
+
+// Scene color formats (names as given by -hdr-format) & their size per sample, ordered from most compact to widest (fallback order).
+static const struct {
+	const char* name;
+	GLenum format;
+	int bytesPerSample;
+} kHDRFormats[] = {
+	{ "rgb9e5",     GL_RGB9_E5,         4 },
+	{ "r11g11b10f", GL_R11F_G11F_B10F,  4 },
+	{ "rgba16f",    GL_RGBA16F,         8 },
+};
+static constexpr int kNumHDRFormats = sizeof(kHDRFormats) / sizeof(kHDRFormats[0]);
+
+// Index of requested scene color format (rgba16f if empty) or of the next wider one which is renderable with given number of samples
+// (shared exponent formats are not color-renderable in core OpenGL, so RGB9E5 usually falls back).
+static int chooseHDRFormat(const std::string& name, int samples)
+{
+	int index = kNumHDRFormats - 1;
+	for(int i=0; i<kNumHDRFormats; ++i) {
+		if(name == kHDRFormats[i].name) {
+			index = i;
+		}
+	}
+	for(; index < kNumHDRFormats - 1; ++index) {
+		GLint renderable = GL_NONE;
+		glGetInternalformativ(GL_TEXTURE_2D, kHDRFormats[index].format, GL_FRAMEBUFFER_RENDERABLE, 1, &renderable);
+		GLint maxSamples = 0;
+		if(samples > 0) {
+			glGetInternalformativ(GL_RENDERBUFFER, kHDRFormats[index].format, GL_SAMPLES, 1, &maxSamples);
+		}
+		if(renderable == GL_FULL_SUPPORT && maxSamples >= samples) {
+			break;
+		}
+		std::fprintf(stderr, "Scene color format %s is not renderable with %dx MSAA, falling back to %s\n",
+			kHDRFormats[index].name, glm::max(samples, 1), kHDRFormats[index + 1].name);
+	}
+	return index;
+}
+
+// Wait for result of a timer query & convert it to milliseconds.
+static double elapsedMilliseconds(GLuint query)
+{
+	GLuint64 elapsedTime;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedTime);
+	return elapsedTime * 1e-6;
+}
+
+// Memory accounting handle of an OpenGL object (names of objects of different types may be equal).
+static uint64_t memoryHandle(GLenum type, GLuint name)
+{
+	return (uint64_t(type) << 32) | name;
+}
+
+// Estimated size of texture or renderbuffer storage, since OpenGL does not expose allocation sizes (RGB formats are assumed
+// to be padded to four components). Layers (array layers, cube map faces or 3D texture slices) are not halved along the mip chain.
+static uint64_t imageBytes(GLenum internalformat, int width, int height, int layers, int levels, int samples=1)
+{
+	int texelBytes;
+	switch(internalformat) {
+	case GL_R8:
+		texelBytes = 1;
+		break;
+	case GL_RGB16F:
+	case GL_RGBA16F:
+		texelBytes = 8;
+		break;
+	case GL_RGBA32F:
+		texelBytes = 16;
+		break;
+	default: // 8-bit RGB(A), RG16F, packed float & 32-bit depth(-stencil) formats.
+		texelBytes = 4;
+		break;
+	}
+
+	uint64_t texels = 0;
+	for(int level=0; level<levels; ++level) {
+		texels += uint64_t(glm::max(width >> level, 1)) * glm::max(height >> level, 1) * layers;
+	}
+	return texels * texelBytes * samples;
+}
+
+// Preprocessor definition selecting square thread group size of IBL compute kernels (see WorkgroupTuner).
+static std::string workgroupSizeDefine(int groupSize)
+{
+	return "WORKGROUP_SIZE " + std::to_string(groupSize);
+}
+
+// Environment map lookups per irradiance map texel (used for cost & source LOD estimates).
+static int irradianceLookups(const RendererSettings& settings)
+{
+	return settings.iblEnvImportanceSampling ? 2 * kIrradianceMISSamples : kIrradianceSamples;
+}
+
 struct TransformUB
 {
 	glm::mat4 viewProjectionMatrix;
@@ -33,298 +180,2314 @@ struct TransformUB
 struct ShadingUB
 {
 	struct {
-		glm::vec4 direction;
+		glm::vec3 direction;
+		int32_t shadowMap;
 		glm::vec4 radiance;
 	} lights[SceneSettings::NumLights];
-	glm::vec4 eyePosition;
+	glm::vec3 eyePosition;
+	float environmentBlend;
+	glm::vec4 probes[ProbeScheduler::MaxProbes];
+	uint32_t numProbes;
+	uint32_t numLights;
+	uint32_t padding[2];
+	glm::vec4 volumeBounds;
+	glm::vec4 volumeInvExtent;
+	glm::vec4 clusterDepth;
+	glm::vec4 clusterSlices;
+	glm::uvec4 clusterGrid;
+	glm::mat4 shadowMatrices[ShadowCascades::NumMaps];
+	glm::vec4 shadowNormalOffsets[SceneSettings::NumLights];
 };
 
-GLFWwindow* Renderer::initialize(int width, int height, int maxSamples)
+GLFWwindow* Renderer::initialize(int width, int height, int maxSamples, const RendererSettings& settings)
+{
+	glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+#if _DEBUG
+	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+#endif
+
+	glfwWindowHint(GLFW_DEPTH_BITS, 0);
+	glfwWindowHint(GLFW_STENCIL_BITS, 0);
+	glfwWindowHint(GLFW_SAMPLES, 0);
+
+	GLFWwindow* window = glfwCreateWindow(width, height, "Physically Based Rendering (OpenGL 4.5)", nullptr, nullptr);
+	if(!window) {
+		throw std::runtime_error("Failed to create OpenGL context");
+	}
+
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(-1);
+
+	if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		throw std::runtime_error("Failed to initialize OpenGL extensions loader");
+	}
+	
+	StartupReport::beginPhase("initialize: render targets");
+
+	glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &m_capabilities.maxAnisotropy);
+
+#if _DEBUG
+	glDebugMessageCallback(Renderer::logMessage, nullptr);
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+#endif
+
+	GLint maxSupportedSamples;
+	glGetIntegerv(GL_MAX_SAMPLES, &maxSupportedSamples);
+
+	// Account allocations in a single heap (its size is known only if the driver reports it).
+	m_memory.driverInfo = isExtensionSupported("GL_NVX_gpu_memory_info");
+	GLint totalKilobytes = 0;
+	if(m_memory.driverInfo) {
+		glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &totalKilobytes);
+	}
+	m_memoryStats.reset(uint64_t(double(settings.memoryBudget) * 1024.0 * 1024.0));
+	m_memoryStats.addHeap("device", uint64_t(totalKilobytes) * 1024, true);
+	updateMemoryBudget();
+
+	m_settings = settings;
+
+	// Single sample rendering (temporal anti-aliasing default) needs no multisample renderbuffers & no resolve.
+	const int samples = (maxSamples > 1) ? glm::min(maxSamples, maxSupportedSamples) : 0;
+	// Temporal anti-aliasing reprojects history by resolved depth, so it needs to be sampleable too.
+	const bool sampledDepth = m_settings.temporalAA;
+	const GLenum colorFormat = kHDRFormats[chooseHDRFormat(m_settings.hdrFormat, samples)].format;
+	m_framebuffer = createFrameBuffer(width, height, samples, colorFormat, GL_DEPTH24_STENCIL8, sampledDepth && samples == 0);
+	if(samples > 0) {
+		m_resolveFramebuffer = createFrameBuffer(width, height, 0, colorFormat, sampledDepth ? GL_DEPTH24_STENCIL8 : GL_NONE, sampledDepth);
+	}
+	else {
+		m_resolveFramebuffer = m_framebuffer;
+	}
+	m_temporalAA.reset(width, height, false);
+	m_dynamicResolution.reset(m_settings.frameTimeBudget, glm::max(samples, 1), m_settings.dynamicSamples && samples > 1);
+
+	std::printf("OpenGL 4.5 Renderer [%s]\n", glGetString(GL_RENDERER));
+	return window;
+}
+
+void Renderer::shutdown()
+{
+	updateMemoryBudget();
+	m_memoryStats.report(std::string("OpenGL, ") + reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+
+	if(m_settings.shadows) {
+		m_shadowCascades.report();
+	}
+	if(m_dynamicResolution.enabled()) {
+		m_dynamicResolution.report();
+	}
+	if(m_settings.temporalAA || m_settings.msaaSamples > 0 || !m_settings.hdrFormat.empty()) {
+		int hdrFormat = kNumHDRFormats - 1;
+		while(kHDRFormats[hdrFormat].format != m_framebuffer.colorFormat) {
+			--hdrFormat;
+		}
+		// Estimated from formats (scene color, 24-bit depth & 8-bit stencil, RGBA16F history), since OpenGL does not expose allocation sizes.
+		const uint64_t numPixels = uint64_t(m_framebuffer.width) * m_framebuffer.height;
+		const int colorBytes = kHDRFormats[hdrFormat].bytesPerSample;
+		uint64_t renderTargetBytes = numPixels * (colorBytes + 4) * glm::max(m_framebuffer.samples, 1);
+		if(m_resolveFramebuffer.id != m_framebuffer.id) {
+			renderTargetBytes += numPixels * (m_resolveFramebuffer.depthStencilTarget ? colorBytes + 4 : colorBytes);
+		}
+		if(m_settings.temporalAA) {
+			renderTargetBytes += 2 * numPixels * 8;
+		}
+		m_temporalAA.report("opengl", reinterpret_cast<const char*>(glGetString(GL_RENDERER)), m_settings.temporalAA, glm::max(m_framebuffer.samples, 1),
+			kHDRFormats[hdrFormat].name, renderTargetBytes);
+	}
+	if(m_taa.timestampQueries[0][0]) {
+		glDeleteQueries(4, &m_taa.timestampQueries[0][0]);
+	}
+	if(m_settings.autoExposure) {
+		m_autoExposure.report();
+		glDeleteQueries(2, m_exposure.timerQueries);
+	}
+
+	if(m_framebuffer.id != m_resolveFramebuffer.id) {
+		deleteFrameBuffer(m_resolveFramebuffer);
+	}
+	deleteFrameBuffer(m_framebuffer);
+
+	glDeleteVertexArrays(1, &m_emptyVAO);
+
+	deleteBuffer(m_transformUB);
+	deleteBuffer(m_shadingUB);
+
+	deleteMeshBuffer(m_skybox);
+	deleteMeshBuffer(m_pbrModel);
+	
+	glDeleteProgram(m_tonemapProgram);
+	glDeleteProgram(m_skyboxProgram);
+	if(m_capturePbrProgram != m_pbrProgram) {
+		glDeleteProgram(m_capturePbrProgram);
+	}
+	if(m_halfPrecision.referenceProgram) {
+		glDeleteProgram(m_halfPrecision.referenceProgram);
+	}
+	glDeleteProgram(m_pbrProgram);
+
+	if(m_ibl.slots.empty()) {
+		deleteTexture(m_envTexture);
+		deleteTexture(m_irmapTexture);
+	}
+	deleteTexture(m_spBRDF_LUT);
+
+	deleteTexture(m_albedoTexture);
+	deleteTexture(m_normalTexture);
+	deleteTexture(m_metalnessTexture);
+	deleteTexture(m_roughnessTexture);
+
+	releaseIBLResources();
+	for(EnvironmentSlot& slot : m_ibl.slots) {
+		deleteTexture(slot.envTexture);
+		deleteTexture(slot.irmapTexture);
+	}
+	if(m_ibl.readbackFence) {
+		glDeleteSync(m_ibl.readbackFence);
+	}
+	deleteBuffer(m_ibl.readbackBuffer);
+
+	for(EnvironmentSlot& view : m_probes.views) {
+		deleteTexture(view.envTexture);
+		deleteTexture(view.irmapTexture);
+	}
+	deleteTexture(m_probes.specularTextures);
+	deleteTexture(m_probes.irradianceTextures);
+	deleteTexture(m_probes.captureTexture);
+	glDeleteFramebuffers(1, &m_probes.captureFramebuffer);
+	m_memoryStats.release(memoryHandle(GL_RENDERBUFFER, m_probes.captureDepthTarget));
+	glDeleteRenderbuffers(1, &m_probes.captureDepthTarget);
+	deleteBuffer(m_probes.transformUB);
+	deleteBuffer(m_probes.shadingUB);
+	deleteBuffer(m_probes.sampleTableBuffer);
+	glDeleteProgram(m_probes.irmapProgram);
+
+	deleteTexture(m_volume.texture);
+	deleteTexture(m_volume.captureTexture);
+	glDeleteFramebuffers(1, &m_volume.captureFramebuffer);
+	m_memoryStats.release(memoryHandle(GL_RENDERBUFFER, m_volume.captureDepthTarget));
+	glDeleteRenderbuffers(1, &m_volume.captureDepthTarget);
+	deleteBuffer(m_volume.transformUB);
+	deleteBuffer(m_volume.shadingUB);
+	deleteBuffer(m_volume.coordsBuffer);
+	glDeleteProgram(m_volume.shprojectProgram);
+
+	deleteTexture(m_atlas.texture);
+	glDeleteProgram(m_atlas.convertProgram);
+
+	deleteTexture(m_shadows.texture);
+	glDeleteFramebuffers(1, &m_shadows.framebuffer);
+	glDeleteProgram(m_shadows.program);
+	if(m_shadows.timerQueries[0]) {
+		glDeleteQueries(ShadowCascades::NumMaps, m_shadows.timerQueries);
+	}
+
+	deleteBuffer(m_lights.lightBuffer);
+	deleteBuffer(m_lights.gridBuffer);
+	deleteBuffer(m_lights.indexBuffer);
+
+	glDeleteProgram(m_prepass.program);
+
+	deleteTexture(m_taa.history[0]);
+	deleteTexture(m_taa.history[1]);
+	deleteBuffer(m_taa.uniformBuffer);
+	glDeleteProgram(m_taa.program);
+
+	deleteBuffer(m_exposure.histogramBuffer);
+	deleteBuffer(m_exposure.exposureBuffer);
+	deleteBuffer(m_exposure.parameterBuffer);
+	glDeleteProgram(m_exposure.histogramProgram);
+	glDeleteProgram(m_exposure.exposureProgram);
+}
+
+void Renderer::setup()
+{
+	// Parameters
+	static constexpr int kEnvMapSize = 1024;
+	static constexpr int kIrradianceMapSize = 32;
+	static constexpr int kBRDF_LUT_Size = 256;
+
+	// Set global OpenGL state.
+	glEnable(GL_CULL_FACE);
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+	glFrontFace(GL_CCW);
+
+	// Create empty VAO for rendering full screen triangle.
+	glCreateVertexArrays(1, &m_emptyVAO);
+
+	// IBL compute kernel thread group sizes are either cached for this device & driver or tuned as the kernels run below.
+	{
+		const std::string deviceKey = std::string("OpenGL|")
+			+ reinterpret_cast<const char*>(glGetString(GL_VENDOR)) + "|"
+			+ reinterpret_cast<const char*>(glGetString(GL_RENDERER)) + "|"
+			+ reinterpret_cast<const char*>(glGetString(GL_VERSION));
+		m_workgroups.reset(deviceKey, m_settings.autotuneWorkgroups, m_settings.retuneWorkgroups);
+	}
+
+	// Create uniform buffers.
+	m_transformUB = createUniformBuffer<TransformUB>();
+	m_shadingUB = createUniformBuffer<ShadingUB>();
+
+	// Load assets & compile/link rendering programs.
+	m_tonemapProgram = linkProgram({
+		compileShader("shaders/glsl/tonemap_vs.glsl", GL_VERTEX_SHADER),
+		compileShader("shaders/glsl/tonemap_fs.glsl", GL_FRAGMENT_SHADER)
+	});
+
+	// Skybox samples current environment from octahedral atlas if enabled (as does PBR model, see its permutation below).
+	std::vector<std::string> environmentDefines;
+	if(m_settings.iblOctahedralAtlas) {
+		environmentDefines.push_back("OCTAHEDRAL_ATLAS");
+	}
+
+	m_skybox = createMeshBuffer(Mesh::fromFile("meshes/skybox.obj"));
+	m_skyboxProgram = linkProgram({
+		compileShader("shaders/glsl/skybox_vs.glsl", GL_VERTEX_SHADER),
+		compileShader("shaders/glsl/skybox_fs.glsl", GL_FRAGMENT_SHADER, environmentDefines)
+	});
+
+	std::shared_ptr<Mesh> pbrModel = Mesh::fromFile("meshes/cerberus.fbx");
+	// Depth-only passes need the model's vertex data de-interleaved (position stream & attribute stream).
+	const bool depthPrepass = m_settings.depthPrepass || m_settings.benchmark == BenchmarkKind::DepthPrepass;
+	m_pbrModel = createMeshBuffer(pbrModel, m_settings.shadows || depthPrepass);
+	// PBR program is specialized for features enabled by settings, probe & volume captures get a leaner variant of their own.
+	// Half precision variant is used whenever the driver supports fp16 arithmetic in shaders (desktop GLSL ignores precision
+	// qualifiers, so this needs explicit float16 types).
+	m_halfPrecision.supported = isExtensionSupported("GL_AMD_gpu_shader_half_float");
+	PBRPermutation scenePermutation = PBRPermutation::forScene(m_settings);
+	scenePermutation.set(PBRPermutation::Feature_HalfPrecision, m_halfPrecision.supported && (m_settings.halfPrecision || m_settings.benchmark == BenchmarkKind::HalfPrecision));
+	const PBRPermutation capturePermutation = scenePermutation.forCapture();
+	m_pbrProgram = linkProgram({
+		compileShader("shaders/glsl/pbr_vs.glsl", GL_VERTEX_SHADER),
+		compileShader("shaders/glsl/pbr_fs.glsl", GL_FRAGMENT_SHADER, scenePermutation.defines())
+	});
+	if(m_settings.benchmark == BenchmarkKind::HalfPrecision && m_halfPrecision.supported) {
+		PBRPermutation referencePermutation = scenePermutation;
+		referencePermutation.set(PBRPermutation::Feature_HalfPrecision, false);
+		m_halfPrecision.referenceProgram = linkProgram({
+			compileShader("shaders/glsl/pbr_vs.glsl", GL_VERTEX_SHADER),
+			compileShader("shaders/glsl/pbr_fs.glsl", GL_FRAGMENT_SHADER, referencePermutation.defines())
+		});
+	}
+	m_capturePbrProgram = m_pbrProgram;
+	if((!m_settings.reflectionProbes.empty() || m_settings.irradianceVolume.x > 0) && capturePermutation != scenePermutation) {
+		m_capturePbrProgram = linkProgram({
+			compileShader("shaders/glsl/pbr_vs.glsl", GL_VERTEX_SHADER),
+			compileShader("shaders/glsl/pbr_fs.glsl", GL_FRAGMENT_SHADER, capturePermutation.defines())
+		});
+		std::printf("PBR shader variants: %s (captures: %s)\n", scenePermutation.name().c_str(), capturePermutation.name().c_str());
+	}
+	else {
+		std::printf("PBR shader variant: %s\n", scenePermutation.name().c_str());
+	}
+	if(depthPrepass) {
+		m_prepass.program = linkProgram({
+			compileShader("shaders/glsl/depth_vs.glsl", GL_VERTEX_SHADER)
+		});
+		m_prepass.enabled = m_settings.depthPrepass;
+	}
+
+	// Temporal anti-aliasing resolve & its history (clamped, since reprojected coordinates may land on the edge).
+	if(m_settings.temporalAA) {
+		m_taa.program = linkProgram({
+			compileShader("shaders/glsl/taa_cs.glsl", GL_COMPUTE_SHADER)
+		});
+		m_taa.uniformBuffer = createUniformBuffer<TemporalAA::Uniforms>();
+		for(Texture& history : m_taa.history) {
+			history = createTexture(GL_TEXTURE_2D, m_framebuffer.width, m_framebuffer.height, GL_RGBA16F, MemoryCategory::RenderTarget, 1);
+			glTextureParameteri(history.id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(history.id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		}
+	}
+	// Anti-aliasing cost is reported if either mode or scene color format was requested explicitly (so that they can be compared),
+	// the same frame time also drives dynamic resolution.
+	if(m_settings.temporalAA || m_settings.msaaSamples > 0 || !m_settings.hdrFormat.empty() || m_dynamicResolution.enabled()) {
+		glCreateQueries(GL_TIMESTAMP, 4, &m_taa.timestampQueries[0][0]);
+	}
+
+	// Exposure buffer (average luminance & exposure) is read by tone mapping even with fixed exposure. Automatic exposure starts
+	// with an empty histogram & no adapted luminance (exposure_cs clears the histogram after each use).
+	{
+		const float initialExposure[2] = { 0.0f, 1.0f };
+		m_exposure.exposureBuffer = createBuffer(sizeof(initialExposure), initialExposure, 0, MemoryCategory::Other);
+	}
+	if(m_settings.autoExposure) {
+		m_exposure.histogramProgram = linkProgram({
+			compileShader("shaders/glsl/histogram_cs.glsl", GL_COMPUTE_SHADER)
+		});
+		m_exposure.exposureProgram = linkProgram({
+			compileShader("shaders/glsl/exposure_cs.glsl", GL_COMPUTE_SHADER)
+		});
+		const std::vector<GLuint> emptyHistogram(AutoExposure::NumBins, 0);
+		m_exposure.histogramBuffer = createBuffer(emptyHistogram.size() * sizeof(GLuint), emptyHistogram.data(), 0, MemoryCategory::Other);
+		m_exposure.parameterBuffer = createUniformBuffer<AutoExposure::Parameters>();
+		glCreateQueries(GL_TIME_ELAPSED, 2, m_exposure.timerQueries);
+	}
+
+	StartupReport::beginPhase("setup: model textures");
+	m_albedoTexture = createTexture(Image::fromFile("textures/cerberus_A.png", 3), GL_RGB, GL_SRGB8, MemoryCategory::Material);
+	m_normalTexture = createTexture(Image::fromFile("textures/cerberus_N.png", 3), GL_RGB, GL_RGB8, MemoryCategory::Material);
+	m_metalnessTexture = createTexture(Image::fromFile("textures/cerberus_M.png", 1), GL_RED, GL_R8, MemoryCategory::Material);
+	m_roughnessTexture = createTexture(Image::fromFile("textures/cerberus_R.png", 1), GL_RED, GL_R8, MemoryCategory::Material);
+	
+	// Pre-processing resources are kept alive if pre-filtering continues after setup (progressive mode, environment switching
+	// or reflection probes, which are pre-filtered with the same specular programs).
+	const bool dynamicEnvironment = m_settings.environments.size() > 1;
+	const bool reflectionProbes = !m_settings.reflectionProbes.empty();
+	const bool keepIBLResources = m_settings.progressiveIBL || dynamicEnvironment || reflectionProbes;
+
+	// Unfiltered environment cube map (temporary).
+	Texture envTextureUnfiltered = createTexture(GL_TEXTURE_CUBE_MAP, kEnvMapSize, kEnvMapSize, GL_RGBA16F, MemoryCategory::IBL);
+	
+	// Load & convert equirectangular environment map to a cubemap texture.
+	StartupReport::beginPhase("setup: environment");
+	{
+		PROFILE_ZONE("setup: environment");
+		std::shared_ptr<Image> envImage = Image::fromFile(m_settings.environments[0], 3);
+		Texture envTextureEquirect = createTexture(envImage, GL_RGB, GL_RGB16F, MemoryCategory::IBL, 1);
+		if(m_settings.iblEnvImportanceSampling) {
+			m_ibl.distributionBuffer = createEnvironmentDistributionBuffer(*envImage);
+		}
+
+		glBindTextureUnit(0, envTextureEquirect.id);
+		glBindImageTexture(0, envTextureUnfiltered.id, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+		tuneWorkgroupSize(WorkgroupTuner::Equirect2Cube,
+			[](int groupSize) {
+				return linkProgram({ compileShader("shaders/glsl/equirect2cube_cs.glsl", GL_COMPUTE_SHADER, { workgroupSizeDefine(groupSize) }) });
+			},
+			[&envTextureUnfiltered](GLuint program, int groupSize) {
+				glUseProgram(program);
+				glDispatchCompute(envTextureUnfiltered.width/groupSize, envTextureUnfiltered.height/groupSize, 6);
+			});
+
+		const int groupSize = m_workgroups.size(WorkgroupTuner::Equirect2Cube);
+		GLuint equirectToCubeProgram = linkProgram({
+			compileShader("shaders/glsl/equirect2cube_cs.glsl", GL_COMPUTE_SHADER, { workgroupSizeDefine(groupSize) })
+		});
+
+		// Measure GPU time for startup breakdown (not with progressive pre-processing, which must not stall).
+		GLuint timerQuery = 0;
+		if(!m_settings.progressiveIBL) {
+			glCreateQueries(GL_TIME_ELAPSED, 1, &timerQuery);
+			glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+		}
+
+		glUseProgram(equirectToCubeProgram);
+		glDispatchCompute(envTextureUnfiltered.width/groupSize, envTextureUnfiltered.height/groupSize, 6);
+		glGenerateTextureMipmap(envTextureUnfiltered.id);
+
+		if(timerQuery) {
+			glEndQuery(GL_TIME_ELAPSED);
+			GLuint64 elapsedTime;
+			glGetQueryObjectui64v(timerQuery, GL_QUERY_RESULT, &elapsedTime);
+			glDeleteQueries(1, &timerQuery);
+			StartupReport::addGpuTime(elapsedTime * 1e-6);
+		}
+		
+		deleteTexture(envTextureEquirect);
+		if(dynamicEnvironment) {
+			m_ibl.equirectToCubeProgram = equirectToCubeProgram;
+		}
+		else {
+			glDeleteProgram(equirectToCubeProgram);
+		}
+	}
+	
+	// Compute pre-filtered specular environment map.
+	StartupReport::beginPhase("setup: specular pre-filter");
+	{
+		PROFILE_ZONE("setup: specular pre-filter");
+		m_envTexture = createTexture(GL_TEXTURE_CUBE_MAP, kEnvMapSize, kEnvMapSize, GL_RGBA16F, MemoryCategory::IBL);
+
+		// GGX sample directions are shared by all texels of a level: precompute them once.
+		GLuint sampleTableBuffer;
+		{
+			const SpecularSampleTable sampleTable = SpecularSampleTable::build(kEnvMapSize, m_envTexture.levels, m_settings.iblSampleErrorTarget, kSpecularSamples);
+			std::vector<char> data(sampleTable.bufferSize());
+			sampleTable.copyToBuffer(data.data());
+			sampleTableBuffer = createBuffer(data.size(), data.data(), 0, MemoryCategory::IBL);
+			StartupReport::addBytesUploaded(data.size());
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sampleTableBuffer);
+		}
+
+		std::vector<std::string> spmapDefines;
+		if(m_settings.iblSampleTables) {
+			spmapDefines.push_back("SAMPLE_TABLE");
+		}
+		const float deltaRoughness = 1.0f / glm::max(float(m_envTexture.levels-1), 1.0f);
+
+		// Tune on first pre-filtered level (it's overwritten below, both by the copy & the actual pre-filtering pass).
+		tuneWorkgroupSize(WorkgroupTuner::SpecularFilter,
+			[this, &spmapDefines, deltaRoughness](int groupSize) {
+				std::vector<std::string> defines = spmapDefines;
+				defines.push_back(workgroupSizeDefine(groupSize));
+				GLuint program = linkProgram({ compileShader("shaders/glsl/spmap_cs.glsl", GL_COMPUTE_SHADER, defines) });
+				glProgramUniform1f(program, 0, deltaRoughness);
+				glProgramUniform1f(program, 3, m_settings.iblSampleErrorTarget);
+				glProgramUniform1ui(program, 4, kSpecularSamples);
+				glProgramUniform1i(program, 6, 1);
+				return program;
+			},
+			[this, &envTextureUnfiltered](GLuint program, int groupSize) {
+				const GLuint numGroups = (kEnvMapSize/2) / groupSize;
+				glUseProgram(program);
+				glBindTextureUnit(0, envTextureUnfiltered.id);
+				glBindImageTexture(0, m_envTexture.id, 1, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+				glDispatchCompute(numGroups, numGroups, 6);
+			});
+
+		const int groupSize = m_workgroups.size(WorkgroupTuner::SpecularFilter);
+		const int tailLevel = IBLScheduler::specularMipTailLevel(kEnvMapSize, m_envTexture.levels, groupSize);
+		std::vector<std::string> spmapLevelDefines = spmapDefines;
+		spmapLevelDefines.push_back(workgroupSizeDefine(groupSize));
+		GLuint spmapProgram = linkProgram({
+			compileShader("shaders/glsl/spmap_cs.glsl", GL_COMPUTE_SHADER, spmapLevelDefines)
+		});
+		spmapDefines.push_back("FOLDED_MIP_TAIL_GROUP_SIZE " + std::to_string(kSpecularMipTailGroupSize));
+		spmapDefines.push_back("NUM_MIP_LEVELS " + std::to_string(glm::max(m_envTexture.levels - tailLevel, 1)));
+		GLuint spmapTailProgram = linkProgram({
+			compileShader("shaders/glsl/spmap_cs.glsl", GL_COMPUTE_SHADER, spmapDefines)
+		});
+		for(GLuint program : { spmapProgram, spmapTailProgram }) {
+			glProgramUniform1f(program, 3, m_settings.iblSampleErrorTarget);
+			glProgramUniform1ui(program, 4, kSpecularSamples);
+		}
+
+		if(m_settings.progressiveIBL) {
+			// Use whole (box filtered) mip chain as initial approximation & pre-filter it over next frames.
+			for(int level=0, size=kEnvMapSize; level<m_envTexture.levels; ++level, size/=2) {
+				glCopyImageSubData(envTextureUnfiltered.id, GL_TEXTURE_CUBE_MAP, level, 0, 0, 0,
+					m_envTexture.id, GL_TEXTURE_CUBE_MAP, level, 0, 0, 0,
+					size, size, 6);
+			}
+		}
+		else {
+			// Copy 0th mipmap level into destination environment map.
+			glCopyImageSubData(envTextureUnfiltered.id, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+				m_envTexture.id, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+				m_envTexture.width, m_envTexture.height, 6);
+
+			GLuint timerQuery;
+			glCreateQueries(GL_TIME_ELAPSED, 1, &timerQuery);
+			glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+
+			glUseProgram(spmapProgram);
+			glBindTextureUnit(0, envTextureUnfiltered.id);
+
+			// Pre-filter rest of the mip chain.
+			for(int level=1, size=kEnvMapSize/2; level<tailLevel; ++level, size/=2) {
+				const GLuint numGroups = size / groupSize;
+				glBindImageTexture(0, m_envTexture.id, level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+				glProgramUniform1f(spmapProgram, 0, level * deltaRoughness);
+				if(m_settings.iblSampleTables) {
+					glProgramUniform1i(spmapProgram, 6, level);
+				}
+				glDispatchCompute(numGroups, numGroups, 6);
+			}
+			if(tailLevel < m_envTexture.levels) {
+				dispatchSpecularMipTail(spmapTailProgram, m_envTexture, tailLevel);
+			}
+
+			glEndQuery(GL_TIME_ELAPSED);
+			GLuint64 elapsedTime;
+			glGetQueryObjectui64v(timerQuery, GL_QUERY_RESULT, &elapsedTime);
+			glDeleteQueries(1, &timerQuery);
+			std::printf("Specular pre-filter GPU time: %.2f ms\n", elapsedTime * 1e-6);
+			StartupReport::addGpuTime(elapsedTime * 1e-6);
+		}
+
+		if(keepIBLResources) {
+			m_ibl.spmapProgram = spmapProgram;
+			m_ibl.spmapTailProgram = spmapTailProgram;
+			m_ibl.sampleTableBuffer = sampleTableBuffer;
+		}
+		else {
+			glDeleteProgram(spmapProgram);
+			glDeleteProgram(spmapTailProgram);
+			deleteBuffer(sampleTableBuffer);
+		}
+	}
+
+	// Compute diffuse irradiance cubemap.
+	StartupReport::beginPhase("setup: irradiance map");
+	{
+		PROFILE_ZONE("setup: irradiance map");
+		std::vector<std::string> irmapDefines;
+		if(m_settings.iblEnvImportanceSampling) {
+			irmapDefines.push_back("ENV_IMPORTANCE_SAMPLING");
+			irmapDefines.push_back("NUM_SAMPLES " + std::to_string(kIrradianceMISSamples));
+		}
+
+		m_irmapTexture = createTexture(GL_TEXTURE_CUBE_MAP, kIrradianceMapSize, kIrradianceMapSize, GL_RGBA16F, MemoryCategory::IBL, 1);
+
+		glBindImageTexture(0, m_irmapTexture.id, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA16F);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_ibl.distributionBuffer);
+
+		// Tune with full sample count reading from current specular map (output is overwritten below).
+		tuneWorkgroupSize(WorkgroupTuner::Irradiance,
+			[&irmapDefines](int groupSize) {
+				std::vector<std::string> defines = irmapDefines;
+				defines.push_back(workgroupSizeDefine(groupSize));
+				return linkProgram({ compileShader("shaders/glsl/irmap_cs.glsl", GL_COMPUTE_SHADER, defines) });
+			},
+			[this](GLuint program, int groupSize) {
+				glUseProgram(program);
+				glBindTextureUnit(0, m_envTexture.id);
+				glDispatchCompute(m_irmapTexture.width/groupSize, m_irmapTexture.height/groupSize, 6);
+			});
+
+		const int groupSize = m_workgroups.size(WorkgroupTuner::Irradiance);
+		irmapDefines.push_back(workgroupSizeDefine(groupSize));
+		GLuint irmapProgram = linkProgram({
+			compileShader("shaders/glsl/irmap_cs.glsl", GL_COMPUTE_SHADER, irmapDefines)
+		});
+
+		glUseProgram(irmapProgram);
+		if(m_settings.progressiveIBL) {
+			// Initial approximation: single low sample count batch reading from appropriately blurred mip level.
+			glBindTextureUnit(0, envTextureUnfiltered.id);
+			glProgramUniform1ui(irmapProgram, 2, kIrradianceApproxBatches);
+			glProgramUniform1f(irmapProgram, 3, IBLScheduler::irradianceSourceLod(kEnvMapSize, irradianceLookups(m_settings) / kIrradianceApproxBatches));
+			glDispatchCompute(m_irmapTexture.width/groupSize, m_irmapTexture.height/groupSize, 6);
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		}
+		else {
+			GLuint timerQuery;
+			glCreateQueries(GL_TIME_ELAPSED, 1, &timerQuery);
+			glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+
+			glBindTextureUnit(0, m_envTexture.id);
+			glDispatchCompute(m_irmapTexture.width/groupSize, m_irmapTexture.height/groupSize, 6);
+
+			glEndQuery(GL_TIME_ELAPSED);
+			GLuint64 elapsedTime;
+			glGetQueryObjectui64v(timerQuery, GL_QUERY_RESULT, &elapsedTime);
+			glDeleteQueries(1, &timerQuery);
+			std::printf("Irradiance map GPU time: %.2f ms\n", elapsedTime * 1e-6);
+			StartupReport::addGpuTime(elapsedTime * 1e-6);
+		}
+
+		if(keepIBLResources) {
+			m_ibl.irmapProgram = irmapProgram;
+		}
+		else {
+			glDeleteProgram(irmapProgram);
+			deleteBuffer(m_ibl.distributionBuffer);
+			m_ibl.distributionBuffer = 0;
+		}
+	}
+
+	// Convert pre-filtered specular map into octahedral atlas & compare the two (with progressive pre-processing this measures
+	// initial approximation, atlas is re-converted as it gets refined).
+	StartupReport::beginPhase("setup: scene resources");
+	if(m_settings.iblOctahedralAtlas) {
+		m_atlas.texture = createTexture(GL_TEXTURE_2D, OctahedralAtlas::width(kEnvMapSize), OctahedralAtlas::height(kEnvMapSize), GL_RGBA16F, MemoryCategory::IBL, 1);
+		glTextureParameteri(m_atlas.texture.id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(m_atlas.texture.id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTextureParameterf(m_atlas.texture.id, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1.0f);
+		m_atlas.convertProgram = linkProgram({
+			compileShader("shaders/glsl/octatlas_cs.glsl", GL_COMPUTE_SHADER)
+		});
+
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		convertSpecularAtlas();
+		reportSpecularAtlas();
+	}
+
+	if(m_settings.progressiveIBL) {
+		// Irradiance converges quickly and its approximation is the most noticeable so refine it first.
+		m_iblScheduler.queueIrradianceFilter(kIrradianceMapSize, irradianceLookups(m_settings), kIrradianceBatches);
+		m_iblScheduler.queueSpecularFilter(kEnvMapSize, m_envTexture.levels, m_settings.iblSampleErrorTarget, kSpecularSamples, m_workgroups.size(WorkgroupTuner::SpecularFilter));
+		m_ibl.envTextureUnfiltered = envTextureUnfiltered;
+	}
+	else {
+		deleteTexture(envTextureUnfiltered);
+	}
+
+	if(keepIBLResources) {
+		glCreateQueries(GL_TIME_ELAPSED, NumIBLTimerQueries, m_ibl.timerQueries);
+	}
+
+	// Keep as many pre-filtered environments resident as fit into the budget (at least two: current one and one being switched to).
+	// Startup environment occupies first slot, remaining slots are allocated on first use.
+	if(dynamicEnvironment) {
+		const int numEnvironments = (int)m_settings.environments.size();
+		const size_t slotSize = EnvironmentCache::slotSize(kEnvMapSize, m_envTexture.levels, kIrradianceMapSize);
+		m_ibl.cache.reset(EnvironmentCache::numSlotsForBudget(m_settings.iblCacheBudget, slotSize, 2, numEnvironments));
+		m_ibl.slots.resize(m_ibl.cache.numSlots());
+		m_ibl.slots[0] = { m_envTexture, m_irmapTexture };
+		m_ibl.currentSlot = m_ibl.previousSlot = m_ibl.cache.allocate(0, {});
+		std::printf("Environment cache: %d slots, %.1f MB each\n", m_ibl.cache.numSlots(), slotSize / (1024.0 * 1024.0));
+
+		if(!m_settings.progressiveIBL) {
+			readbackEnvironmentSlot(m_ibl.currentSlot);
+		}
+	}
+
+	if(reflectionProbes) {
+		setupReflectionProbes(ProbeScheduler::boundingRadius(*pbrModel));
+	}
+	if(m_settings.irradianceVolume.x > 0) {
+		setupIrradianceVolume(ProbeScheduler::boundingRadius(*pbrModel));
+	}
+	setupShadows(ProbeScheduler::boundingRadius(*pbrModel));
+	setupDynamicLights(ProbeScheduler::boundingRadius(*pbrModel));
+
+	// Compute Cook-Torrance BRDF 2D LUT for split-sum approximation.
+	StartupReport::beginPhase("setup: BRDF LUT");
+	{
+		PROFILE_ZONE("setup: BRDF LUT");
+		m_spBRDF_LUT = createTexture(GL_TEXTURE_2D, kBRDF_LUT_Size, kBRDF_LUT_Size, GL_RG16F, MemoryCategory::IBL, 1);
+		glTextureParameteri(m_spBRDF_LUT.id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(m_spBRDF_LUT.id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindImageTexture(0, m_spBRDF_LUT.id, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+
+		tuneWorkgroupSize(WorkgroupTuner::SpecularBRDF,
+			[](int groupSize) {
+				return linkProgram({ compileShader("shaders/glsl/spbrdf_cs.glsl", GL_COMPUTE_SHADER, { workgroupSizeDefine(groupSize) }) });
+			},
+			[this](GLuint program, int groupSize) {
+				glUseProgram(program);
+				glDispatchCompute(m_spBRDF_LUT.width/groupSize, m_spBRDF_LUT.height/groupSize, 1);
+			});
+
+		const int groupSize = m_workgroups.size(WorkgroupTuner::SpecularBRDF);
+		GLuint spBRDFProgram = linkProgram({
+			compileShader("shaders/glsl/spbrdf_cs.glsl", GL_COMPUTE_SHADER, { workgroupSizeDefine(groupSize) })
+		});
+
+		GLuint timerQuery = 0;
+		if(!m_settings.progressiveIBL) {
+			glCreateQueries(GL_TIME_ELAPSED, 1, &timerQuery);
+			glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+		}
+
+		glUseProgram(spBRDFProgram);
+		glDispatchCompute(m_spBRDF_LUT.width/groupSize, m_spBRDF_LUT.height/groupSize, 1);
+
+		if(timerQuery) {
+			glEndQuery(GL_TIME_ELAPSED);
+			GLuint64 elapsedTime;
+			glGetQueryObjectui64v(timerQuery, GL_QUERY_RESULT, &elapsedTime);
+			glDeleteQueries(1, &timerQuery);
+			StartupReport::addGpuTime(elapsedTime * 1e-6);
+		}
+		glDeleteProgram(spBRDFProgram);
+	}
+	m_workgroups.save();
+
+	if(m_settings.progressiveIBL) {
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+	else {
+		glFinish();
+	}
+}
+
+void Renderer::render(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene)
+{
+	PROFILE_ZONE("Renderer::render");
+	m_frameArena.reset();
+
+	if(++m_memory.frame % kMemoryBudgetQueryInterval == 0) {
+		updateMemoryBudget();
+	}
+	if(scene.memoryReportRequest != m_memory.reportRequest) {
+		// Report is formatted into strings on request only.
+		AllocationCounter::allowFrame();
+		m_memory.reportRequest = scene.memoryReportRequest;
+		updateMemoryBudget();
+		m_memoryStats.report(std::string("OpenGL, ") + reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	}
+
+	// Read back timestamps of the frame which used this pair of queries (if available, so as not to stall).
+	const int timestampPair = m_taa.frame++ & 1;
+	if(m_taa.timestampQueries[0][0] && m_taa.pendingQueries[timestampPair]) {
+		const GLuint* queries = m_taa.timestampQueries[timestampPair];
+		GLint available = 0;
+		glGetQueryObjectiv(queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if(available) {
+			GLuint64 start, end;
+			glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+			const double frameMilliseconds = double(end - start) / 1e6;
+			m_temporalAA.addFrameTime(frameMilliseconds);
+			if(m_dynamicResolution.enabled() && m_dynamicResolution.update(frameMilliseconds)
+				&& m_dynamicResolution.samples() != m_framebuffer.samples)
+			{
+				// New render targets are recorded in MemoryStats.
+				AllocationCounter::allowFrame();
+				const int width = m_framebuffer.width;
+				const int height = m_framebuffer.height;
+				const GLenum colorFormat = m_framebuffer.colorFormat;
+				deleteFrameBuffer(m_framebuffer);
+				m_framebuffer = createFrameBuffer(width, height, m_dynamicResolution.samples(), colorFormat, GL_DEPTH24_STENCIL8);
+			}
+			m_taa.pendingQueries[timestampPair] = false;
+		}
+	}
+	const glm::ivec2 viewportSize = m_dynamicResolution.viewportSize(m_framebuffer.width, m_framebuffer.height);
+
+	const glm::mat4 projectionMatrix = glm::perspectiveFov(view.fov, float(m_framebuffer.width), float(m_framebuffer.height), kViewZNear, kViewZFar);
+	const glm::mat4 viewRotationMatrix = glm::eulerAngleXY(glm::radians(view.pitch), glm::radians(view.yaw));
+	const glm::mat4 sceneRotationMatrix = glm::eulerAngleXY(glm::radians(scene.pitch), glm::radians(scene.yaw));
+	const glm::mat4 viewMatrix = glm::translate(glm::mat4{ 1.0f }, { 0.0f, 0.0f, -view.distance }) * viewRotationMatrix;
+	const glm::vec3 eyePosition = glm::inverse(viewMatrix)[3];
+
+	// Switch environment: resident maps are bound immediately, otherwise on-disk bake or source map is loaded in the background.
+	// Events below start background tasks (std::async shared state), copy bakes or create textures & buffers (recorded in
+	// MemoryStats); they happen on environment switches only, steady state frames skip all of them.
+	if(scene.environment != m_ibl.environment) {
+		AllocationCounter::allowFrame();
+		switchEnvironment(scene.environment);
+	}
+	if(m_ibl.pendingBake.valid() && m_ibl.pendingBake.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		AllocationCounter::allowFrame();
+		const int environment = m_ibl.loadingBakeEnvironment;
+		m_ibl.loadingBakeEnvironment = -1;
+		if(!uploadPendingEnvironmentBake(environment) && environment == m_ibl.environment) {
+			loadEnvironment(environment);
+		}
+	}
+	if(m_ibl.pendingEnvironment.valid() && m_ibl.pendingEnvironment.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		AllocationCounter::allowFrame();
+		std::shared_ptr<Image> image = m_ibl.pendingEnvironment.get();
+		if(m_ibl.loadingEnvironment == m_ibl.environment) {
+			queueEnvironmentFilter(image);
+		}
+		m_ibl.loadingEnvironment = -1;
+	}
+	if(m_ibl.readbackFence && glClientWaitSync(m_ibl.readbackFence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+		AllocationCounter::allowFrame();
+		saveEnvironmentReadback();
+	}
+
+	// Execute pending progressive IBL pre-processing work.
+	const bool iblRefined = !m_iblScheduler.empty() && m_ibl.targetSlot < 0;
+	if(!m_iblScheduler.empty()) {
+		updateIBL();
+	}
+	if(m_atlas.texture.id && (iblRefined || m_atlas.dirty)) {
+		convertSpecularAtlas();
+	}
+
+	// Weight of previous environment while blending after a switch.
+	float environmentBlend = 0.0f;
+	const EnvironmentSlot* previousEnvironment = nullptr;
+	if(m_ibl.blendFrames > 0) {
+		environmentBlend = float(m_ibl.blendFrames--) / float(m_settings.iblBlendFrames + 1);
+		previousEnvironment = &m_ibl.slots[m_ibl.previousSlot];
+	}
+
+	// Update transform uniform buffer (projection is jittered by a sub-pixel offset with temporal anti-aliasing).
+	{
+		glm::mat4 sceneProjectionMatrix = projectionMatrix;
+		if(m_settings.temporalAA) {
+			const TemporalAA::Uniforms taaUniforms = m_temporalAA.update(projectionMatrix * viewMatrix, projectionMatrix * viewRotationMatrix, sceneRotationMatrix);
+			glNamedBufferSubData(m_taa.uniformBuffer, 0, sizeof(TemporalAA::Uniforms), &taaUniforms);
+			sceneProjectionMatrix = m_temporalAA.jitterProjection(projectionMatrix);
+		}
+
+		TransformUB transformUniforms;
+		transformUniforms.viewProjectionMatrix = sceneProjectionMatrix * viewMatrix;
+		transformUniforms.skyProjectionMatrix  = sceneProjectionMatrix * viewRotationMatrix;
+		transformUniforms.sceneRotationMatrix  = sceneRotationMatrix;
+		glNamedBufferSubData(m_transformUB, 0, sizeof(TransformUB), &transformUniforms);
+	}
+
+	// Re-render shadow cascades invalidated by light, scene or camera movement (before any pass which samples them).
+	if(m_settings.shadows) {
+		updateShadows(view, scene, viewMatrix, sceneRotationMatrix);
+	}
+
+	// Update shading uniform buffer.
+	{
+		PROFILE_ZONE("render: shading uniforms");
+		ShadingUB shadingUniforms = {};
+		shadingUniforms.eyePosition = eyePosition;
+		shadingUniforms.environmentBlend = environmentBlend;
+		for(int i=0; i<SceneSettings::NumLights; ++i) {
+			const SceneSettings::Light& light = scene.lights[i];
+			if(light.enabled) {
+				const uint32_t index = shadingUniforms.numLights++;
+				const int firstShadowMap = m_shadowCascades.firstMap(i);
+				shadingUniforms.lights[index].direction = light.direction;
+				shadingUniforms.lights[index].shadowMap = firstShadowMap;
+				shadingUniforms.lights[index].radiance = glm::vec4{light.radiance, 0.0f};
+				for(int cascade=0; cascade<ShadowCascades::NumCascades && firstShadowMap >= 0; ++cascade) {
+					shadingUniforms.shadowNormalOffsets[index][cascade] = m_shadowCascades.normalOffset(firstShadowMap + cascade);
+				}
+			}
+		}
+		for(int map=0; map<ShadowCascades::NumMaps; ++map) {
+			shadingUniforms.shadowMatrices[map] = m_shadowCascades.shadowMatrix(map);
+		}
+
+		// Capture & pre-filter reflection probes before drawing the frame which samples them.
+		if(m_probeScheduler.numProbes() > 0) {
+			const bool environmentChanged = iblRefined || environmentBlend > 0.0f || m_ibl.currentSlot != m_probes.environmentSlot;
+			m_probes.environmentSlot = m_ibl.currentSlot;
+			updateReflectionProbes(scene, sceneRotationMatrix, shadingUniforms, previousEnvironment, environmentChanged);
+
+			shadingUniforms.numProbes = m_probeScheduler.numProbes();
+			for(int i=0; i<m_probeScheduler.numProbes(); ++i) {
+				shadingUniforms.probes[i] = m_probeScheduler.shadingParameters(i);
+			}
+		}
+
+		// Bake next batch of irradiance volume probes (captures see neither reflection probes nor the volume itself).
+		if(m_irradianceVolume.numProbes() > 0) {
+			const bool environmentChanged = iblRefined || environmentBlend > 0.0f || m_ibl.currentSlot != m_volume.environmentSlot;
+			m_volume.environmentSlot = m_ibl.currentSlot;
+			ShadingUB captureShadingUniforms = shadingUniforms;
+			captureShadingUniforms.numProbes = 0;
+			updateIrradianceVolume(scene, sceneRotationMatrix, captureShadingUniforms, previousEnvironment, environmentChanged);
+
+			shadingUniforms.volumeBounds = m_irradianceVolume.boundsParameters();
+			shadingUniforms.volumeInvExtent = m_irradianceVolume.inverseExtentParameters();
+		}
+
+		// Bin dynamic lights into froxels of this view (after captures, so they are rendered without them).
+		if(m_clusteredLights.numLights() > 0) {
+			updateDynamicLights(viewMatrix, projectionMatrix, shadingUniforms);
+		}
+		glNamedBufferSubData(m_shadingUB, 0, sizeof(ShadingUB), &shadingUniforms);
+	}
+
+	if(m_taa.timestampQueries[0][0]) {
+		glQueryCounter(m_taa.timestampQueries[timestampPair][0], GL_TIMESTAMP);
+	}
+
+	// Prepare framebuffer for rendering.
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer.id);
+	glClear(GL_DEPTH_BUFFER_BIT); // No need to clear color, since we'll overwrite the screen with our skybox.
+	glViewport(0, 0, viewportSize.x, viewportSize.y);
+	
+	// Bind uniform buffers.
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_transformUB);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 1, m_shadingUB);
+
+	// Draw skybox & PBR model.
+	if(m_lights.timerQuery) {
+		glBeginQuery(GL_TIME_ELAPSED, m_lights.timerQuery);
+	}
+	if(m_prepass.timerQuery) {
+		glBeginQuery(GL_TIME_ELAPSED, m_prepass.timerQuery);
+		glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS, m_prepass.statisticsQuery);
+	}
+	if(m_halfPrecision.timerQuery) {
+		glBeginQuery(GL_TIME_ELAPSED, m_halfPrecision.timerQuery);
+	}
+	drawScene(m_pbrProgram, previousEnvironment, m_prepass.enabled);
+	if(m_halfPrecision.timerQuery) {
+		glEndQuery(GL_TIME_ELAPSED);
+	}
+	if(m_prepass.timerQuery) {
+		glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS);
+		glEndQuery(GL_TIME_ELAPSED);
+	}
+	if(m_lights.timerQuery) {
+		glEndQuery(GL_TIME_ELAPSED);
+	}
+		
+	// Resolve multisample framebuffer.
+	resolveFramebuffer(m_framebuffer, m_resolveFramebuffer, viewportSize);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_framebuffer.width, m_framebuffer.height);
+
+	// Blend resolved frame with reprojected history.
+	GLuint sceneColor = m_resolveFramebuffer.colorTarget;
+	if(m_settings.temporalAA) {
+		PROFILE_ZONE("render: temporal AA");
+		const int history = m_temporalAA.historyIndex();
+		glUseProgram(m_taa.program);
+		glBindBufferBase(GL_UNIFORM_BUFFER, 2, m_taa.uniformBuffer);
+		glBindTextureUnit(0, m_resolveFramebuffer.colorTarget);
+		glBindTextureUnit(1, m_resolveFramebuffer.depthStencilTarget);
+		glBindTextureUnit(2, m_taa.history[1 - history].id);
+		glBindImageTexture(0, m_taa.history[history].id, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+		glDispatchCompute((m_framebuffer.width + 7) / 8, (m_framebuffer.height + 7) / 8, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		sceneColor = m_taa.history[history].id;
+	}
+
+	// Build luminance histogram of the scene region & adapt exposure to its average (read back with a frame of latency, so as not to stall).
+	if(m_settings.autoExposure) {
+		PROFILE_ZONE("render: auto exposure");
+		if(m_exposure.pendingQueries[timestampPair]) {
+			GLint available = 0;
+			glGetQueryObjectiv(m_exposure.timerQueries[timestampPair], GL_QUERY_RESULT_AVAILABLE, &available);
+			if(available) {
+				GLuint64 elapsed;
+				glGetQueryObjectui64v(m_exposure.timerQueries[timestampPair], GL_QUERY_RESULT, &elapsed);
+				m_autoExposure.addPassTime(double(elapsed) / 1e6);
+			}
+		}
+		glBeginQuery(GL_TIME_ELAPSED, m_exposure.timerQueries[timestampPair]);
+
+		const AutoExposure::Parameters exposureParameters = m_autoExposure.update(glfwGetTime(), viewportSize.x, viewportSize.y);
+		glNamedBufferSubData(m_exposure.parameterBuffer, 0, sizeof(AutoExposure::Parameters), &exposureParameters);
+		glBindBufferBase(GL_UNIFORM_BUFFER, 2, m_exposure.parameterBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_exposure.histogramBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_exposure.exposureBuffer);
+		glBindTextureUnit(0, sceneColor);
+
+		glUseProgram(m_exposure.histogramProgram);
+		glDispatchCompute((viewportSize.x + 15) / 16, (viewportSize.y + 15) / 16, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		glUseProgram(m_exposure.exposureProgram);
+		glDispatchCompute(1, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		glEndQuery(GL_TIME_ELAPSED);
+		m_exposure.pendingQueries[timestampPair] = true;
+	}
+
+	// Draw a full screen triangle for postprocessing/tone mapping (upscaling scaled viewport; texture coordinates are clamped
+	// half a texel inside of it, so that filtering does not pick up stale pixels beyond its edge).
+	const glm::vec2 framebufferSize = glm::vec2{float(m_framebuffer.width), float(m_framebuffer.height)};
+	const glm::vec2 sceneScale = glm::vec2{viewportSize} / framebufferSize;
+	const glm::vec2 sceneMaxTexCoord = (glm::vec2{viewportSize} - 0.5f) / framebufferSize;
+	glProgramUniform4f(m_tonemapProgram, 0, sceneScale.x, sceneScale.y, sceneMaxTexCoord.x, sceneMaxTexCoord.y);
+	glUseProgram(m_tonemapProgram);
+	glBindTextureUnit(0, sceneColor);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_exposure.exposureBuffer);
+	glBindVertexArray(m_emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	if(m_taa.timestampQueries[0][0]) {
+		glQueryCounter(m_taa.timestampQueries[timestampPair][1], GL_TIMESTAMP);
+		m_taa.pendingQueries[timestampPair] = true;
+	}
+
+	{
+		PROFILE_ZONE("render: present");
+		glfwSwapBuffers(window);
+	}
+}
+
+void Renderer::runBenchmark(BenchmarkKind kind, GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene)
+{
+	switch(kind) {
+	case BenchmarkKind::IBL:
+		benchmarkIBL();
+		break;
+	case BenchmarkKind::Lights:
+		benchmarkLights(window, view, scene);
+		break;
+	case BenchmarkKind::DepthPrepass:
+		benchmarkDepthPrepass(window, view, scene);
+		break;
+	case BenchmarkKind::HalfPrecision:
+		benchmarkHalfPrecision(window, view, scene);
+		break;
+	default:
+		RendererInterface::runBenchmark(kind, window, view, scene);
+		break;
+	}
+}
+
+void Renderer::benchmarkIBL()
+{
+	IBLBenchmark benchmark;
+
+	// Kernels run with thread group sizes selected during setup.
+	const int equirectGroupSize = m_workgroups.size(WorkgroupTuner::Equirect2Cube);
+	const int spmapGroupSize = m_workgroups.size(WorkgroupTuner::SpecularFilter);
+	const int irmapGroupSize = m_workgroups.size(WorkgroupTuner::Irradiance);
+	const int spbrdfGroupSize = m_workgroups.size(WorkgroupTuner::SpecularBRDF);
+
+	std::shared_ptr<Image> envImage = Image::fromFile(m_settings.environments[0], 3);
+	Texture envTextureEquirect = createTexture(envImage, GL_RGB, GL_RGB16F, MemoryCategory::IBL, 1);
+	GLuint distributionBuffer = createEnvironmentDistributionBuffer(*envImage);
+
+	GLuint equirectToCubeProgram = linkProgram({
+		compileShader("shaders/glsl/equirect2cube_cs.glsl", GL_COMPUTE_SHADER, { workgroupSizeDefine(equirectGroupSize) })
+	});
+	GLuint compareProgram = linkProgram({
+		compileShader("shaders/glsl/iblcompare_cs.glsl", GL_COMPUTE_SHADER)
+	});
+	GLuint compareLUTProgram = linkProgram({
+		compileShader("shaders/glsl/brdfcompare_cs.glsl", GL_COMPUTE_SHADER)
+	});
+
+	GLuint resultsBuffer = createBuffer(IBLBenchmark::NumErrorRoughnessSteps * IBLBenchmark::NumErrorDirections * sizeof(glm::vec2), nullptr, 0, MemoryCategory::Other);
+
+	GLuint timerQuery;
+	glCreateQueries(GL_TIME_ELAPSED, 1, &timerQuery);
+
+	// Unfiltered source of the reference specular map is kept for irradiance kernels.
+	Texture sourceTexture;
+
+	// Specular pre-filter: each run converts equirectangular environment to a cube map of swept size, generates its mipmaps
+	// & pre-filters the mip chain (as non-progressive setup does).
+	{
+		const std::vector<IBLBenchmark::Config> configs = IBLBenchmark::sweep(IBLBenchmark::Kernel::SpecularFilter);
+
+		std::vector<std::string> spmapDefines;
+		if(m_settings.iblSampleTables) {
+			spmapDefines.push_back("SAMPLE_TABLE");
+		}
+		std::vector<std::string> spmapLevelDefines = spmapDefines;
+		spmapLevelDefines.push_back(workgroupSizeDefine(spmapGroupSize));
+		GLuint spmapProgram = linkProgram({
+			compileShader("shaders/glsl/spmap_cs.glsl", GL_COMPUTE_SHADER, spmapLevelDefines)
+		});
+
+		Texture referenceTexture;
+		for(size_t i=0; i<configs.size(); ++i) {
+			const IBLBenchmark::Config& config = configs[i];
+
+			Texture envTextureUnfiltered = createTexture(GL_TEXTURE_CUBE_MAP, config.size, config.size, GL_RGBA16F, MemoryCategory::IBL);
+			Texture envTexture = createTexture(GL_TEXTURE_CUBE_MAP, config.size, config.size, GL_RGBA16F, MemoryCategory::IBL);
+
+			const int tailLevel = IBLScheduler::specularMipTailLevel(config.size, envTexture.levels, spmapGroupSize);
+			std::vector<std::string> spmapTailDefines = spmapDefines;
+			spmapTailDefines.push_back("FOLDED_MIP_TAIL_GROUP_SIZE " + std::to_string(kSpecularMipTailGroupSize));
+			spmapTailDefines.push_back("NUM_MIP_LEVELS " + std::to_string(glm::max(envTexture.levels - tailLevel, 1)));
+			GLuint spmapTailProgram = linkProgram({
+				compileShader("shaders/glsl/spmap_cs.glsl", GL_COMPUTE_SHADER, spmapTailDefines)
+			});
+			for(GLuint program : { spmapProgram, spmapTailProgram }) {
+				glProgramUniform1f(program, 3, config.sampleErrorTarget);
+				glProgramUniform1ui(program, 4, config.numSamples);
+			}
+
+			GLuint sampleTableBuffer = 0;
+			if(m_settings.iblSampleTables) {
+				const SpecularSampleTable sampleTable = SpecularSampleTable::build(config.size, envTexture.levels, config.sampleErrorTarget, config.numSamples);
+				std::vector<char> data(sampleTable.bufferSize());
+				sampleTable.copyToBuffer(data.data());
+				sampleTableBuffer = createBuffer(data.size(), data.data(), 0, MemoryCategory::IBL);
+			}
+
+			double gpuTime = std::numeric_limits<double>::max();
+			for(int run=0; run<IBLBenchmark::NumTimedRuns; ++run) {
+				glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+
+				glUseProgram(equirectToCubeProgram);
+				glBindTextureUnit(0, envTextureEquirect.id);
+				glBindImageTexture(0, envTextureUnfiltered.id, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+				glDispatchCompute(config.size/equirectGroupSize, config.size/equirectGroupSize, 6);
+				glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+				glGenerateTextureMipmap(envTextureUnfiltered.id);
+				glCopyImageSubData(envTextureUnfiltered.id, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+					envTexture.id, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+					envTexture.width, envTexture.height, 6);
+
+				glUseProgram(spmapProgram);
+				glBindTextureUnit(0, envTextureUnfiltered.id);
+				glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sampleTableBuffer);
+
+				const float deltaRoughness = 1.0f / glm::max(float(envTexture.levels-1), 1.0f);
+				for(int level=1, size=config.size/2; level<tailLevel; ++level, size/=2) {
+					const GLuint numGroups = size / spmapGroupSize;
+					glBindImageTexture(0, envTexture.id, level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+					glProgramUniform1f(spmapProgram, 0, level * deltaRoughness);
+					if(m_settings.iblSampleTables) {
+						glProgramUniform1i(spmapProgram, 6, level);
+					}
+					glDispatchCompute(numGroups, numGroups, 6);
+				}
+				if(tailLevel < envTexture.levels) {
+					dispatchSpecularMipTail(spmapTailProgram, envTexture, tailLevel);
+				}
+
+				glEndQuery(GL_TIME_ELAPSED);
+				gpuTime = std::min(gpuTime, elapsedMilliseconds(timerQuery));
+			}
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+			if(i == 0) {
+				benchmark.addReference(config, gpuTime);
+				referenceTexture = envTexture;
+				sourceTexture = envTextureUnfiltered;
+			}
+			else {
+				const double error = compareIBLMaps(compareProgram, envTexture, referenceTexture, resultsBuffer, IBLBenchmark::NumErrorDirections/64, IBLBenchmark::NumErrorRoughnessSteps);
+				benchmark.addResult(config, gpuTime, error);
+				deleteTexture(envTexture);
+				deleteTexture(envTextureUnfiltered);
+			}
+
+			glDeleteProgram(spmapTailProgram);
+			deleteBuffer(sampleTableBuffer);
+		}
+
+		deleteTexture(referenceTexture);
+		glDeleteProgram(spmapProgram);
+	}
+
+	// Irradiance map: both sampling strategies integrate the same source (mip level 0, as non-progressive setup does).
+	{
+		const std::vector<IBLBenchmark::Config> configs = IBLBenchmark::sweep(IBLBenchmark::Kernel::Irradiance);
+
+		Texture referenceTexture;
+		for(size_t i=0; i<configs.size(); ++i) {
+			const IBLBenchmark::Config& config = configs[i];
+
+			std::vector<std::string> irmapDefines;
+			if(config.envImportanceSampling) {
+				irmapDefines.push_back("ENV_IMPORTANCE_SAMPLING");
+			}
+			irmapDefines.push_back("NUM_SAMPLES " + std::to_string(config.numSamples));
+			irmapDefines.push_back(workgroupSizeDefine(irmapGroupSize));
+			GLuint irmapProgram = linkProgram({
+				compileShader("shaders/glsl/irmap_cs.glsl", GL_COMPUTE_SHADER, irmapDefines)
+			});
+			glProgramUniform1ui(irmapProgram, 2, config.numBatches);
+			glProgramUniform1f(irmapProgram, 3, 0.0f);
+
+			Texture irmapTexture = createTexture(GL_TEXTURE_CUBE_MAP, config.size, config.size, GL_RGBA16F, MemoryCategory::IBL, 1);
+
+			double gpuTime = std::numeric_limits<double>::max();
+			for(int run=0; run<IBLBenchmark::NumTimedRuns; ++run) {
+				glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+
+				glUseProgram(irmapProgram);
+				glBindTextureUnit(0, sourceTexture.id);
+				glBindImageTexture(0, irmapTexture.id, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA16F);
+				glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, distributionBuffer);
+				for(int batch=0; batch<config.numBatches; ++batch) {
+					glProgramUniform1ui(irmapProgram, 1, batch);
+					glDispatchCompute(config.size/irmapGroupSize, config.size/irmapGroupSize, 6);
+					glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+				}
+
+				glEndQuery(GL_TIME_ELAPSED);
+				gpuTime = std::min(gpuTime, elapsedMilliseconds(timerQuery));
+			}
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+			if(i == 0) {
+				benchmark.addReference(config, gpuTime);
+				referenceTexture = irmapTexture;
+			}
+			else {
+				const double error = compareIBLMaps(compareProgram, irmapTexture, referenceTexture, resultsBuffer, IBLBenchmark::NumErrorDirections/64, 1);
+				benchmark.addResult(config, gpuTime, error);
+				deleteTexture(irmapTexture);
+			}
+			glDeleteProgram(irmapProgram);
+		}
+
+		deleteTexture(referenceTexture);
+	}
+
+	// Split-sum BRDF LUT.
+	{
+		const std::vector<IBLBenchmark::Config> configs = IBLBenchmark::sweep(IBLBenchmark::Kernel::SpecularBRDF);
+
+		Texture referenceTexture;
+		for(size_t i=0; i<configs.size(); ++i) {
+			const IBLBenchmark::Config& config = configs[i];
+
+			GLuint spBRDFProgram = linkProgram({
+				compileShader("shaders/glsl/spbrdf_cs.glsl", GL_COMPUTE_SHADER, { "NUM_SAMPLES " + std::to_string(config.numSamples), workgroupSizeDefine(spbrdfGroupSize) })
+			});
+
+			Texture spBRDF_LUT = createTexture(GL_TEXTURE_2D, config.size, config.size, GL_RG16F, MemoryCategory::IBL, 1);
+			glTextureParameteri(spBRDF_LUT.id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(spBRDF_LUT.id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+			double gpuTime = std::numeric_limits<double>::max();
+			for(int run=0; run<IBLBenchmark::NumTimedRuns; ++run) {
+				glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+
+				glUseProgram(spBRDFProgram);
+				glBindImageTexture(0, spBRDF_LUT.id, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+				glDispatchCompute(config.size/spbrdfGroupSize, config.size/spbrdfGroupSize, 1);
+
+				glEndQuery(GL_TIME_ELAPSED);
+				gpuTime = std::min(gpuTime, elapsedMilliseconds(timerQuery));
+			}
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+			if(i == 0) {
+				benchmark.addReference(config, gpuTime);
+				referenceTexture = spBRDF_LUT;
+			}
+			else {
+				const double error = compareIBLMaps(compareLUTProgram, spBRDF_LUT, referenceTexture, resultsBuffer, IBLBenchmark::ErrorLUTGridSize/8, IBLBenchmark::ErrorLUTGridSize/8);
+				benchmark.addResult(config, gpuTime, error);
+				deleteTexture(spBRDF_LUT);
+			}
+			glDeleteProgram(spBRDFProgram);
+		}
+
+		deleteTexture(referenceTexture);
+	}
+
+	benchmark.report("opengl", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+
+	glDeleteQueries(1, &timerQuery);
+	deleteBuffer(resultsBuffer);
+	deleteBuffer(distributionBuffer);
+	glDeleteProgram(equirectToCubeProgram);
+	glDeleteProgram(compareProgram);
+	glDeleteProgram(compareLUTProgram);
+	deleteTexture(sourceTexture);
+	deleteTexture(envTextureEquirect);
+}
+	
+void Renderer::drawScene(GLuint pbrProgram, const EnvironmentSlot* previousEnvironment, bool depthPrepass) const
+{
+	PROFILE_ZONE("Renderer::drawScene");
+	auto drawSkybox = [this, previousEnvironment]() {
+		glUseProgram(m_skyboxProgram);
+		glBindTextureUnit(0, m_envTexture.id);
+		glBindTextureUnit(1, previousEnvironment ? previousEnvironment->envTexture.id : m_envTexture.id);
+		glBindTextureUnit(2, m_atlas.texture.id);
+		glBindVertexArray(m_skybox.vao);
+		glDrawElements(GL_TRIANGLES, m_skybox.numElements, GL_UNSIGNED_INT, 0);
+	};
+
+	if(depthPrepass) {
+		// Lay down model's depth from position stream only, PBR model then shades just the visible samples.
+		glEnable(GL_DEPTH_TEST);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glUseProgram(m_prepass.program);
+		glBindVertexArray(m_pbrModel.positionVao);
+		glDrawElements(GL_TRIANGLES, m_pbrModel.numElements, GL_UNSIGNED_INT, 0);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthMask(GL_FALSE);
+		glDepthFunc(GL_EQUAL);
+	}
+	else {
+		// Draw skybox.
+		glDisable(GL_DEPTH_TEST);
+		drawSkybox();
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	// Draw PBR model.
+	glUseProgram(pbrProgram);
+	glBindTextureUnit(0, m_albedoTexture.id);
+	glBindTextureUnit(1, m_normalTexture.id);
+	glBindTextureUnit(2, m_metalnessTexture.id);
+	glBindTextureUnit(3, m_roughnessTexture.id);
+	glBindTextureUnit(4, m_envTexture.id);
+	glBindTextureUnit(5, m_irmapTexture.id);
+	glBindTextureUnit(6, m_spBRDF_LUT.id);
+	glBindTextureUnit(7, previousEnvironment ? previousEnvironment->envTexture.id : m_envTexture.id);
+	glBindTextureUnit(8, previousEnvironment ? previousEnvironment->irmapTexture.id : m_irmapTexture.id);
+	glBindTextureUnit(9, m_probes.specularTextures.id);
+	glBindTextureUnit(10, m_probes.irradianceTextures.id);
+	glBindTextureUnit(11, m_volume.texture.id);
+	glBindTextureUnit(12, m_atlas.texture.id);
+	glBindTextureUnit(13, m_shadows.texture.id);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_lights.lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_lights.gridBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_lights.indexBuffer);
+	glBindVertexArray(m_pbrModel.vao);
+	glDrawElements(GL_TRIANGLES, m_pbrModel.numElements, GL_UNSIGNED_INT, 0);
+
+	// Draw skybox last (at far plane) only where the model left depth buffer clear.
+	if(depthPrepass) {
+		glDepthFunc(GL_LEQUAL);
+		drawSkybox();
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+	}
+}
+
+void Renderer::benchmarkLights(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene)
+{
+	LightBenchmark benchmark;
+	glCreateQueries(GL_TIME_ELAPSED, 1, &m_lights.timerQuery);
+
+	for(int numLights : LightBenchmark::lightCounts()) {
+		m_clusteredLights.reset(numLights, m_lights.modelRadius, m_framebuffer.width, m_framebuffer.height);
+		for(int frame=0; frame<LightBenchmark::NumWarmupFrames + LightBenchmark::NumTimedFrames; ++frame) {
+			render(window, view, scene);
+			glfwPollEvents();
+			if(frame >= LightBenchmark::NumWarmupFrames) {
+				benchmark.addFrame(m_clusteredLights, elapsedMilliseconds(m_lights.timerQuery));
+			}
+		}
+	}
+
+	glDeleteQueries(1, &m_lights.timerQuery);
+	m_lights.timerQuery = 0;
+	benchmark.report("opengl", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+}
+
+void Renderer::benchmarkDepthPrepass(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene)
+{
+	GLint version[2];
+	glGetIntegerv(GL_MAJOR_VERSION, &version[0]);
+	glGetIntegerv(GL_MINOR_VERSION, &version[1]);
+	const bool pipelineStatistics = (version[0] > 4 || (version[0] == 4 && version[1] >= 6)) || isExtensionSupported("GL_ARB_pipeline_statistics_query");
+	if(!pipelineStatistics) {
+		throw std::runtime_error("Depth pre-pass benchmark requires pipeline statistics query support");
+	}
+
+	PrepassBenchmark benchmark;
+	glCreateQueries(GL_TIME_ELAPSED, 1, &m_prepass.timerQuery);
+	glCreateQueries(GL_FRAGMENT_SHADER_INVOCATIONS, 1, &m_prepass.statisticsQuery);
+
+	for(bool depthPrepass : { false, true }) {
+		m_prepass.enabled = depthPrepass;
+		for(int frame=0; frame<PrepassBenchmark::NumWarmupFrames + PrepassBenchmark::NumTimedFrames; ++frame) {
+			render(window, view, scene);
+			glfwPollEvents();
+			if(frame >= PrepassBenchmark::NumWarmupFrames) {
+				GLuint64 fragmentInvocations = 0;
+				glGetQueryObjectui64v(m_prepass.statisticsQuery, GL_QUERY_RESULT, &fragmentInvocations);
+				benchmark.addFrame(depthPrepass, fragmentInvocations, elapsedMilliseconds(m_prepass.timerQuery));
+			}
+		}
+	}
+	m_prepass.enabled = m_settings.depthPrepass;
+
+	glDeleteQueries(1, &m_prepass.timerQuery);
+	glDeleteQueries(1, &m_prepass.statisticsQuery);
+	m_prepass.timerQuery = 0;
+	m_prepass.statisticsQuery = 0;
+	benchmark.report("opengl", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+}
+
+void Renderer::benchmarkHalfPrecision(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene)
+{
+	if(!m_halfPrecision.supported) {
+		throw std::runtime_error("Half precision benchmark requires fp16 shader arithmetic support (GL_AMD_gpu_shader_half_float)");
+	}
+
+	HalfPrecisionBenchmark benchmark;
+	glCreateQueries(GL_TIME_ELAPSED, 1, &m_halfPrecision.timerQuery);
+
+	const GLuint halfPrecisionProgram = m_pbrProgram;
+	for(bool halfPrecision : { false, true }) {
+		m_pbrProgram = halfPrecision ? halfPrecisionProgram : m_halfPrecision.referenceProgram;
+		for(int frame=0; frame<HalfPrecisionBenchmark::NumWarmupFrames + HalfPrecisionBenchmark::NumTimedFrames; ++frame) {
+			render(window, view, scene);
+			glfwPollEvents();
+			if(frame >= HalfPrecisionBenchmark::NumWarmupFrames) {
+				benchmark.addFrame(halfPrecision, elapsedMilliseconds(m_halfPrecision.timerQuery));
+			}
+		}
+
+		// Resolved scene color of the last frame (converted to float from any scene color format).
+		std::vector<float> pixels(3 * size_t(m_resolveFramebuffer.width) * size_t(m_resolveFramebuffer.height));
+		glGetTextureImage(m_resolveFramebuffer.colorTarget, 0, GL_RGB, GL_FLOAT, GLsizei(pixels.size() * sizeof(float)), pixels.data());
+		benchmark.setImage(halfPrecision, m_resolveFramebuffer.width, m_resolveFramebuffer.height, std::move(pixels), true);
+	}
+	m_pbrProgram = halfPrecisionProgram;
+
+	glDeleteQueries(1, &m_halfPrecision.timerQuery);
+	m_halfPrecision.timerQuery = 0;
+	benchmark.report("opengl", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+}
+
+void Renderer::setupShadows(float modelRadius)
+{
+	PROFILE_ZONE("Renderer::setupShadows");
+	// Single layer placeholder is never sampled (all lights then have negative shadow map layer).
+	const int size = m_settings.shadows ? m_settings.shadowMapSize : 1;
+	m_shadows.texture.width  = size;
+	m_shadows.texture.height = size;
+	m_shadows.texture.levels = 1;
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &m_shadows.texture.id);
+	glTextureStorage3D(m_shadows.texture.id, 1, GL_DEPTH_COMPONENT32F, size, size, m_settings.shadows ? ShadowCascades::NumMaps : 1);
+	m_memoryStats.allocate(memoryHandle(GL_TEXTURE, m_shadows.texture.id), MemoryCategory::RenderTarget, 0,
+		imageBytes(GL_DEPTH_COMPONENT32F, size, size, m_settings.shadows ? ShadowCascades::NumMaps : 1, 1));
+	glTextureParameteri(m_shadows.texture.id, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(m_shadows.texture.id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(m_shadows.texture.id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(m_shadows.texture.id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(m_shadows.texture.id, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTextureParameteri(m_shadows.texture.id, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	if(!m_settings.shadows) {
+		return;
+	}
+
+	m_shadowCascades.reset(size, modelRadius, m_settings.shadowCaching);
+
+	glCreateFramebuffers(1, &m_shadows.framebuffer);
+	glNamedFramebufferDrawBuffer(m_shadows.framebuffer, GL_NONE);
+	glNamedFramebufferReadBuffer(m_shadows.framebuffer, GL_NONE);
+
+	m_shadows.program = linkProgram({
+		compileShader("shaders/glsl/shadow_vs.glsl", GL_VERTEX_SHADER)
+	});
+	glCreateQueries(GL_TIME_ELAPSED, ShadowCascades::NumMaps, m_shadows.timerQueries);
+
+	std::printf("Shadow maps: %d lights x %d cascades, %dpx\n", SceneSettings::NumLights, ShadowCascades::NumCascades, size);
+}
+
+void Renderer::updateShadows(const ViewSettings& view, const SceneSettings& scene, const glm::mat4& viewMatrix, const glm::mat4& sceneRotationMatrix)
+{
+	PROFILE_ZONE("Renderer::updateShadows");
+	// Collect render times of maps updated in previous frames (without waiting for the GPU).
+	for(int map=0; map<ShadowCascades::NumMaps; ++map) {
+		if(m_shadows.pendingQueries[map]) {
+			GLuint available = GL_FALSE;
+			glGetQueryObjectuiv(m_shadows.timerQueries[map], GL_QUERY_RESULT_AVAILABLE, &available);
+			if(available) {
+				m_shadowCascades.addRenderTime(map, elapsedMilliseconds(m_shadows.timerQueries[map]));
+				m_shadows.pendingQueries[map] = false;
+			}
+		}
+	}
+
+	m_shadowCascades.update(scene, viewMatrix, view.fov, float(m_framebuffer.width) / float(m_framebuffer.height), kViewZNear);
+
+	bool dirty = false;
+	for(int map=0; map<ShadowCascades::NumMaps; ++map) {
+		dirty = dirty || m_shadowCascades.dirty(map);
+	}
+	if(!dirty) {
+		return;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_shadows.framebuffer);
+	glViewport(0, 0, m_shadows.texture.width, m_shadows.texture.height);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(kShadowSlopeBias, kShadowConstantBias);
+	glUseProgram(m_shadows.program);
+	glBindVertexArray(m_pbrModel.positionVao);
+
+	for(int map=0; map<ShadowCascades::NumMaps; ++map) {
+		if(!m_shadowCascades.dirty(map)) {
+			continue;
+		}
+		const glm::mat4 shadowViewProjectionMatrix = m_shadowCascades.renderMatrix(map) * sceneRotationMatrix;
+		glNamedFramebufferTextureLayer(m_shadows.framebuffer, GL_DEPTH_ATTACHMENT, m_shadows.texture.id, 0, map);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		glProgramUniformMatrix4fv(m_shadows.program, 0, 1, GL_FALSE, &shadowViewProjectionMatrix[0][0]);
+
+		// Updates are left untimed while previous update's query result is still pending.
+		const bool timed = !m_shadows.pendingQueries[map];
+		if(timed) {
+			glBeginQuery(GL_TIME_ELAPSED, m_shadows.timerQueries[map]);
+		}
+		glDrawElements(GL_TRIANGLES, m_pbrModel.numElements, GL_UNSIGNED_INT, 0);
+		if(timed) {
+			glEndQuery(GL_TIME_ELAPSED);
+			m_shadows.pendingQueries[map] = true;
+		}
+	}
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glViewport(0, 0, m_framebuffer.width, m_framebuffer.height);
+}
+
+void Renderer::setupDynamicLights(float modelRadius)
+{
+	PROFILE_ZONE("Renderer::setupDynamicLights");
+	m_lights.modelRadius = modelRadius;
+	m_clusteredLights.reset(m_settings.numDynamicLights, modelRadius, m_framebuffer.width, m_framebuffer.height);
+
+	// Buffers are always bound to pbr_fs, they only get full capacity if there are going to be any lights to shade.
+	const bool enabled = m_settings.numDynamicLights > 0 || m_settings.benchmark == BenchmarkKind::Lights;
+	const size_t numLights = enabled ? ClusteredLights::MaxLights : 1;
+	const size_t numClusters = enabled ? ClusteredLights::numClusters(m_framebuffer.width, m_framebuffer.height) : 1;
+	const size_t numIndices = enabled ? ClusteredLights::MaxLightIndices : 1;
+
+	m_lights.lightBuffer = createBuffer(numLights * sizeof(ClusteredLights::Light), nullptr, GL_DYNAMIC_STORAGE_BIT, MemoryCategory::Uniform);
+	m_lights.gridBuffer = createBuffer(numClusters * sizeof(glm::uvec2), nullptr, GL_DYNAMIC_STORAGE_BIT, MemoryCategory::Uniform);
+	m_lights.indexBuffer = createBuffer(numIndices * sizeof(uint32_t), nullptr, GL_DYNAMIC_STORAGE_BIT, MemoryCategory::Uniform);
+
+	if(m_settings.numDynamicLights > 0) {
+		std::printf("Dynamic lights: %d\n", m_settings.numDynamicLights);
+	}
+}
+
+void Renderer::updateDynamicLights(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, ShadingUB& shadingUniforms)
+{
+	PROFILE_ZONE("Renderer::updateDynamicLights");
+	// Tiles are in window coordinates of the (possibly scaled) viewport.
+	const glm::ivec2 viewportSize = m_dynamicResolution.viewportSize(m_framebuffer.width, m_framebuffer.height);
+	m_clusteredLights.update(glfwGetTime(), viewMatrix, projectionMatrix, viewportSize.x, viewportSize.y, kViewZNear, kViewZFar);
+
+	const std::vector<ClusteredLights::Light>& lights = m_clusteredLights.lights();
+	const std::vector<glm::uvec2>& grid = m_clusteredLights.grid();
+	const std::vector<uint32_t>& indices = m_clusteredLights.indices();
+	glNamedBufferSubData(m_lights.lightBuffer, 0, lights.size() * sizeof(ClusteredLights::Light), lights.data());
+	glNamedBufferSubData(m_lights.gridBuffer, 0, grid.size() * sizeof(glm::uvec2), grid.data());
+	if(!indices.empty()) {
+		glNamedBufferSubData(m_lights.indexBuffer, 0, indices.size() * sizeof(uint32_t), indices.data());
+	}
+
+	shadingUniforms.clusterDepth = m_clusteredLights.depthParameters();
+	shadingUniforms.clusterSlices = m_clusteredLights.sliceParameters();
+	shadingUniforms.clusterGrid = m_clusteredLights.gridParameters();
+}
+
+void Renderer::setupReflectionProbes(float modelRadius)
+{
+	PROFILE_ZONE("Renderer::setupReflectionProbes");
+	const int size = m_settings.reflectionProbeSize;
+	const int numProbes = (int)m_settings.reflectionProbes.size();
+	m_probeScheduler.reset(m_settings.reflectionProbes, modelRadius);
+
+	// Pre-filtered maps of all probes live in two cube map arrays sampled by pbr_fs.
+	auto createCubeMapArray = [this, numProbes](int faceSize, int levels) {
+		Texture texture;
+		texture.width  = faceSize;
+		texture.height = faceSize;
+		texture.levels = levels;
+		glCreateTextures(GL_TEXTURE_CUBE_MAP_ARRAY, 1, &texture.id);
+		glTextureStorage3D(texture.id, texture.levels, GL_RGBA16F, faceSize, faceSize, 6 * numProbes);
+		m_memoryStats.allocate(memoryHandle(GL_TEXTURE, texture.id), MemoryCategory::IBL, 0, imageBytes(GL_RGBA16F, faceSize, faceSize, 6 * numProbes, texture.levels));
+		glTextureParameteri(texture.id, GL_TEXTURE_MIN_FILTER, texture.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTextureParameteri(texture.id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		return texture;
+	};
+	m_probes.specularTextures = createCubeMapArray(size, Utility::numMipmapLevels(size, size));
+	m_probes.irradianceTextures = createCubeMapArray(kProbeIrradianceMapSize, 1);
+
+	// Cube map views of each probe's layers let probes reuse environment pre-filtering programs unchanged.
+	auto createCubeMapView = [](const Texture& texture, int probe) {
+		Texture view = texture;
+		glGenTextures(1, &view.id);
+		glTextureView(view.id, GL_TEXTURE_CUBE_MAP, texture.id, GL_RGBA16F, 0, texture.levels, 6 * probe, 6);
+		return view;
+	};
+	m_probes.views.resize(numProbes);
+	for(int probe=0; probe<numProbes; ++probe) {
+		m_probes.views[probe].envTexture = createCubeMapView(m_probes.specularTextures, probe);
+		m_probes.views[probe].irmapTexture = createCubeMapView(m_probes.irradianceTextures, probe);
+	}
+
+	// Unfiltered capture is rendered one face at a time & shared by all probes.
+	m_probes.captureTexture = createTexture(GL_TEXTURE_CUBE_MAP, size, size, GL_RGBA16F, MemoryCategory::RenderTarget);
+	glCreateRenderbuffers(1, &m_probes.captureDepthTarget);
+	glNamedRenderbufferStorage(m_probes.captureDepthTarget, GL_DEPTH_COMPONENT24, size, size);
+	m_memoryStats.allocate(memoryHandle(GL_RENDERBUFFER, m_probes.captureDepthTarget), MemoryCategory::RenderTarget, 0, imageBytes(GL_DEPTH_COMPONENT24, size, size, 1, 1));
+	glCreateFramebuffers(1, &m_probes.captureFramebuffer);
+	glNamedFramebufferRenderbuffer(m_probes.captureFramebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_probes.captureDepthTarget);
+
+	m_probes.transformUB = createUniformBuffer<TransformUB>();
+	m_probes.shadingUB = createUniformBuffer<ShadingUB>();
+
+	{
+		const SpecularSampleTable sampleTable = SpecularSampleTable::build(size, m_probes.specularTextures.levels, m_settings.iblSampleErrorTarget, kSpecularSamples);
+		std::vector<char> data(sampleTable.bufferSize());
+		sampleTable.copyToBuffer(data.data());
+		m_probes.sampleTableBuffer = createBuffer(data.size(), data.data(), 0, MemoryCategory::IBL);
+		StartupReport::addBytesUploaded(data.size());
+	}
+	m_probes.tailLevel = IBLScheduler::specularMipTailLevel(size, m_probes.specularTextures.levels, m_workgroups.size(WorkgroupTuner::SpecularFilter));
+
+	m_probes.irmapProgram = linkProgram({
+		compileShader("shaders/glsl/irmap_cs.glsl", GL_COMPUTE_SHADER, {
+			"NUM_SAMPLES " + std::to_string(kProbeIrradianceSamples),
+			workgroupSizeDefine(m_workgroups.size(WorkgroupTuner::Irradiance)),
+		})
+	});
+	glProgramUniform1ui(m_probes.irmapProgram, 0, 0);
+	glProgramUniform1ui(m_probes.irmapProgram, 1, 0);
+	glProgramUniform1ui(m_probes.irmapProgram, 2, 1);
+	glProgramUniform1f(m_probes.irmapProgram, 3, IBLScheduler::irradianceSourceLod(size, kProbeIrradianceSamples));
+
+	std::printf("Reflection probes: %d x %dpx\n", numProbes, size);
+}
+
+void Renderer::updateReflectionProbes(const SceneSettings& scene, const glm::mat4& sceneRotationMatrix, const ShadingUB& shadingUniforms, const EnvironmentSlot* previousEnvironment, bool environmentChanged)
+{
+	PROFILE_ZONE("Renderer::updateReflectionProbes");
+	m_probeScheduler.updateScene(scene, environmentChanged);
+
+	ProbeScheduler::Capture capture;
+	if(!m_probeScheduler.nextCapture(capture)) {
+		return;
+	}
+
+	const glm::vec3& probePosition = m_probeScheduler.position(capture.probe);
+	const glm::mat4 projectionMatrix = glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 1000.0f);
+	const glm::mat4 viewMatrix = ProbeScheduler::faceViewMatrix(probePosition, capture.face);
+
+	TransformUB transformUniforms;
+	transformUniforms.viewProjectionMatrix = projectionMatrix * viewMatrix;
+	transformUniforms.skyProjectionMatrix  = projectionMatrix * glm::mat4{glm::mat3{viewMatrix}};
+	transformUniforms.sceneRotationMatrix  = sceneRotationMatrix;
+	glNamedBufferSubData(m_probes.transformUB, 0, sizeof(TransformUB), &transformUniforms);
+
+	// Captures are lit by the global environment only so that probes never feed back into each other.
+	ShadingUB captureShadingUniforms = shadingUniforms;
+	captureShadingUniforms.eyePosition = probePosition;
+	captureShadingUniforms.numProbes = 0;
+	glNamedBufferSubData(m_probes.shadingUB, 0, sizeof(ShadingUB), &captureShadingUniforms);
+
+	const int size = m_probes.captureTexture.width;
+	glNamedFramebufferTextureLayer(m_probes.captureFramebuffer, GL_COLOR_ATTACHMENT0, m_probes.captureTexture.id, 0, capture.face);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_probes.captureFramebuffer);
+	glViewport(0, 0, size, size);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_probes.transformUB);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 1, m_probes.shadingUB);
+	drawScene(m_capturePbrProgram, previousEnvironment);
+
+	glViewport(0, 0, m_framebuffer.width, m_framebuffer.height);
+
+	if(capture.filter) {
+		filterReflectionProbe(capture.probe);
+	}
+}
+
+void Renderer::filterReflectionProbe(int probe)
+{
+	const Texture& captureTexture = m_probes.captureTexture;
+	const Texture& envTarget = m_probes.views[probe].envTexture;
+	const Texture& irmapTarget = m_probes.views[probe].irmapTexture;
+
+	glGenerateTextureMipmap(captureTexture.id);
+	glCopyImageSubData(captureTexture.id, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+		envTarget.id, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+		envTarget.width, envTarget.height, 6);
+
+	glBindTextureUnit(0, captureTexture.id);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_probes.sampleTableBuffer);
+
+	// Same as startup specular pre-filter (whole faces at a time).
+	const int spmapGroupSize = m_workgroups.size(WorkgroupTuner::SpecularFilter);
+	const int irmapGroupSize = m_workgroups.size(WorkgroupTuner::Irradiance);
+	glUseProgram(m_ibl.spmapProgram);
+	glProgramUniform1ui(m_ibl.spmapProgram, 1, 0);
+	glProgramUniform1ui(m_ibl.spmapProgram, 2, 0);
+	const float deltaRoughness = 1.0f / glm::max(float(envTarget.levels-1), 1.0f);
+	for(int level=1, size=envTarget.width/2; level<m_probes.tailLevel; ++level, size/=2) {
+		const GLuint numGroups = size / spmapGroupSize;
+		glBindImageTexture(0, envTarget.id, level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+		glProgramUniform1f(m_ibl.spmapProgram, 0, level * deltaRoughness);
+		if(m_settings.iblSampleTables) {
+			glProgramUniform1i(m_ibl.spmapProgram, 6, level);
+		}
+		glDispatchCompute(numGroups, numGroups, 6);
+	}
+	dispatchSpecularMipTail(m_ibl.spmapTailProgram, envTarget, m_probes.tailLevel);
+
+	glUseProgram(m_probes.irmapProgram);
+	glBindImageTexture(0, irmapTarget.id, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA16F);
+	glDispatchCompute(irmapTarget.width/irmapGroupSize, irmapTarget.height/irmapGroupSize, 6);
+
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void Renderer::setupIrradianceVolume(float modelRadius)
+{
+	PROFILE_ZONE("Renderer::setupIrradianceVolume");
+	// Grid spans the bounding cube of the model's bounding sphere so that it stays covered at any rotation.
+	const glm::ivec3 resolution = m_settings.irradianceVolume;
+	m_irradianceVolume.reset(resolution, glm::vec3{-modelRadius}, glm::vec3{modelRadius});
+	m_volume.modelRadius = modelRadius;
+
+	const glm::ivec3 textureSize = m_irradianceVolume.textureSize();
+	m_volume.texture.width  = textureSize.x;
+	m_volume.texture.height = textureSize.y;
+	m_volume.texture.levels = 1;
+	glCreateTextures(GL_TEXTURE_3D, 1, &m_volume.texture.id);
+	glTextureStorage3D(m_volume.texture.id, 1, GL_RGBA16F, textureSize.x, textureSize.y, textureSize.z);
+	m_memoryStats.allocate(memoryHandle(GL_TEXTURE, m_volume.texture.id), MemoryCategory::IBL, 0, imageBytes(GL_RGBA16F, textureSize.x, textureSize.y, textureSize.z, 1));
+	glTextureParameteri(m_volume.texture.id, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(m_volume.texture.id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(m_volume.texture.id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(m_volume.texture.id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(m_volume.texture.id, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	// Each probe of the batch is captured into 6 consecutive layers of a cube map array.
+	m_volume.captureTexture.width  = kVolumeCaptureSize;
+	m_volume.captureTexture.height = kVolumeCaptureSize;
+	m_volume.captureTexture.levels = 1;
+	glCreateTextures(GL_TEXTURE_CUBE_MAP_ARRAY, 1, &m_volume.captureTexture.id);
+	glTextureStorage3D(m_volume.captureTexture.id, 1, GL_RGBA16F, kVolumeCaptureSize, kVolumeCaptureSize, 6 * kVolumeBatchSize);
+	m_memoryStats.allocate(memoryHandle(GL_TEXTURE, m_volume.captureTexture.id), MemoryCategory::RenderTarget, 0,
+		imageBytes(GL_RGBA16F, kVolumeCaptureSize, kVolumeCaptureSize, 6 * kVolumeBatchSize, 1));
+	glTextureParameteri(m_volume.captureTexture.id, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(m_volume.captureTexture.id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glCreateRenderbuffers(1, &m_volume.captureDepthTarget);
+	glNamedRenderbufferStorage(m_volume.captureDepthTarget, GL_DEPTH_COMPONENT24, kVolumeCaptureSize, kVolumeCaptureSize);
+	m_memoryStats.allocate(memoryHandle(GL_RENDERBUFFER, m_volume.captureDepthTarget), MemoryCategory::RenderTarget, 0,
+		imageBytes(GL_DEPTH_COMPONENT24, kVolumeCaptureSize, kVolumeCaptureSize, 1, 1));
+	glCreateFramebuffers(1, &m_volume.captureFramebuffer);
+	glNamedFramebufferRenderbuffer(m_volume.captureFramebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_volume.captureDepthTarget);
+
+	m_volume.transformUB = createUniformBuffer<TransformUB>();
+	m_volume.shadingUB = createUniformBuffer<ShadingUB>();
+	m_volume.coordsBuffer = createBuffer(kVolumeBatchSize * sizeof(glm::ivec4), nullptr, GL_DYNAMIC_STORAGE_BIT, MemoryCategory::Uniform);
+
+	m_volume.shprojectProgram = linkProgram({
+		compileShader("shaders/glsl/shproject_cs.glsl", GL_COMPUTE_SHADER)
+	});
+
+	const size_t textureBytes = size_t(textureSize.x) * textureSize.y * textureSize.z * 4 * sizeof(uint16_t);
+	std::printf("Irradiance volume: %dx%dx%d probes, %.1f KB\n", resolution.x, resolution.y, resolution.z, textureBytes / 1024.0);
+}
+
+void Renderer::updateIrradianceVolume(const SceneSettings& scene, const glm::mat4& sceneRotationMatrix, const ShadingUB& shadingUniforms, const EnvironmentSlot* previousEnvironment, bool environmentChanged)
+{
+	PROFILE_ZONE("Renderer::updateIrradianceVolume");
+	m_irradianceVolume.updateScene(scene, environmentChanged, m_volume.modelRadius);
+
+	FrameVector<int> batch{FrameAllocator<int>(m_frameArena)};
+	batch.reserve(kVolumeBatchSize);
+	if(m_irradianceVolume.nextBatch(kVolumeBatchSize, batch) == 0) {
+		return;
+	}
+
+	const glm::mat4 projectionMatrix = glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 1000.0f);
+
+	ShadingUB captureShadingUniforms = shadingUniforms;
+	captureShadingUniforms.volumeBounds = glm::vec4{0.0f};
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_volume.captureFramebuffer);
+	glViewport(0, 0, kVolumeCaptureSize, kVolumeCaptureSize);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_volume.transformUB);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 1, m_volume.shadingUB);
+
+	FrameVector<glm::ivec4> coords(batch.size(), FrameAllocator<glm::ivec4>(m_frameArena));
+	for(int i=0; i<(int)batch.size(); ++i) {
+		const glm::vec3 probePosition = m_irradianceVolume.probePosition(batch[i]);
+		coords[i] = glm::ivec4{m_irradianceVolume.probeCoord(batch[i]), 0};
+
+		captureShadingUniforms.eyePosition = probePosition;
+		glNamedBufferSubData(m_volume.shadingUB, 0, sizeof(ShadingUB), &captureShadingUniforms);
+
+		for(int face=0; face<6; ++face) {
+			const glm::mat4 viewMatrix = ProbeScheduler::faceViewMatrix(probePosition, face);
+
+			TransformUB transformUniforms;
+			transformUniforms.viewProjectionMatrix = projectionMatrix * viewMatrix;
+			transformUniforms.skyProjectionMatrix  = projectionMatrix * glm::mat4{glm::mat3{viewMatrix}};
+			transformUniforms.sceneRotationMatrix  = sceneRotationMatrix;
+			glNamedBufferSubData(m_volume.transformUB, 0, sizeof(TransformUB), &transformUniforms);
+
+			glNamedFramebufferTextureLayer(m_volume.captureFramebuffer, GL_COLOR_ATTACHMENT0, m_volume.captureTexture.id, 0, 6 * i + face);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			drawScene(m_capturePbrProgram, previousEnvironment);
+		}
+	}
+
+	glViewport(0, 0, m_framebuffer.width, m_framebuffer.height);
+
+	// Project all captures of the batch at once (one thread group per probe).
+	glNamedBufferSubData(m_volume.coordsBuffer, 0, coords.size() * sizeof(glm::ivec4), coords.data());
+	glUseProgram(m_volume.shprojectProgram);
+	glBindTextureUnit(0, m_volume.captureTexture.id);
+	glBindImageTexture(0, m_volume.texture.id, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_volume.coordsBuffer);
+	glDispatchCompute((GLuint)batch.size(), 1, 1);
+
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void Renderer::switchEnvironment(int environment)
+{
+	PROFILE_ZONE("Renderer::switchEnvironment");
+	m_ibl.environment = environment;
+
+	// Abandon any unfinished pre-processing, partially filtered slot contents are no longer valid.
+	if(!m_iblScheduler.empty()) {
+		m_iblScheduler.clear();
+		m_ibl.cache.release(m_ibl.targetSlot >= 0 ? m_ibl.targetSlot : m_ibl.currentSlot);
+		m_ibl.targetSlot = -1;
+	}
+
+	const int slot = m_ibl.cache.lookup(environment);
+	if(slot >= 0) {
+		activateEnvironmentSlot(slot);
+	}
+	else if(m_ibl.loadingBakeEnvironment != environment && m_ibl.loadingEnvironment != environment) {
+		// Environment which is already being loaded gets activated (or pre-filtered) as soon as it arrives.
+		if(EnvironmentCache::bakeExists(m_settings.environments[environment])) {
+			loadEnvironmentBake(environment);
+		}
+		else {
+			loadEnvironment(environment);
+		}
+	}
+}
+
+void Renderer::loadEnvironment(int environment)
 {
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
-#if _DEBUG
-	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
-#endif
+	m_ibl.loadingEnvironment = environment;
 
-	glfwWindowHint(GLFW_DEPTH_BITS, 0);
-	glfwWindowHint(GLFW_STENCIL_BITS, 0);
-	glfwWindowHint(GLFW_SAMPLES, 0);
+	const std::string filename = m_settings.environments[environment];
+	m_ibl.pendingEnvironment = std::async(std::launch::async, [filename]() {
+		return Image::fromFile(filename, 3);
+	});
+}
 
-	GLFWwindow* window = glfwCreateWindow(width, height, "Physically Based Rendering (OpenGL 4.5)", nullptr, nullptr);
-	if(!window) {
-		throw std::runtime_error("Failed to create OpenGL context");
+void Renderer::loadEnvironmentBake(int environment)
+{
+	// Only one bake is read at a time: finish (and upload) the one in flight first.
+	if(m_ibl.pendingBake.valid()) {
+		uploadPendingEnvironmentBake(m_ibl.loadingBakeEnvironment);
 	}
+	m_ibl.loadingBakeEnvironment = environment;
+
+	const std::string filename = m_settings.environments[environment];
+	const uint32_t settingsHash = EnvironmentCache::bakeSettingsHash(m_settings);
+	const int envMapSize = m_envTexture.width;
+	const int envMapLevels = m_envTexture.levels;
+	const int irmapSize = m_irmapTexture.width;
+	m_ibl.pendingBake = std::async(std::launch::async, [filename, settingsHash, envMapSize, envMapLevels, irmapSize]() {
+		return EnvironmentCache::loadBake(filename, settingsHash, envMapSize, envMapLevels, irmapSize);
+	});
+}
 
-	glfwMakeContextCurrent(window);
-	glfwSwapInterval(-1);
-
-	if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-		throw std::runtime_error("Failed to initialize OpenGL extensions loader");
+void Renderer::queueEnvironmentFilter(const std::shared_ptr<Image>& image)
+{
+	PROFILE_ZONE("Renderer::queueEnvironmentFilter");
+	deleteTexture(m_ibl.envTextureEquirect);
+	m_ibl.envTextureEquirect = createTexture(image, GL_RGB, GL_RGB16F, MemoryCategory::IBL, 1);
+	if(m_settings.iblEnvImportanceSampling) {
+		deleteBuffer(m_ibl.distributionBuffer);
+		m_ibl.distributionBuffer = createEnvironmentDistributionBuffer(*image);
+	}
+	if(m_ibl.envTextureUnfiltered.id == 0) {
+		m_ibl.envTextureUnfiltered = createTexture(GL_TEXTURE_CUBE_MAP, m_envTexture.width, m_envTexture.height, GL_RGBA16F, MemoryCategory::IBL);
 	}
-	
-	glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &m_capabilities.maxAnisotropy);
 
-#if _DEBUG
-	glDebugMessageCallback(Renderer::logMessage, nullptr);
-	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-#endif
+	m_ibl.targetSlot = acquireEnvironmentSlot(m_ibl.environment);
 
-	GLint maxSupportedSamples;
-	glGetIntegerv(GL_MAX_SAMPLES, &maxSupportedSamples);
+	m_iblScheduler.queueEnvironmentConversion(m_envTexture.width);
+	m_iblScheduler.queueIrradianceFilter(m_irmapTexture.width, irradianceLookups(m_settings), kIrradianceBatches);
+	m_iblScheduler.queueSpecularFilter(m_envTexture.width, m_envTexture.levels, m_settings.iblSampleErrorTarget, kSpecularSamples, m_workgroups.size(WorkgroupTuner::SpecularFilter));
+}
 
-	const int samples = glm::min(maxSamples, maxSupportedSamples);
-	m_framebuffer = createFrameBuffer(width, height, samples, GL_RGBA16F, GL_DEPTH24_STENCIL8);
-	if(samples > 0) {
-		m_resolveFramebuffer = createFrameBuffer(width, height, 0, GL_RGBA16F, GL_NONE);
+bool Renderer::uploadPendingEnvironmentBake(int environment)
+{
+	std::shared_ptr<EnvironmentCache::Bake> bake;
+	try {
+		bake = m_ibl.pendingBake.get();
 	}
-	else {
-		m_resolveFramebuffer = m_framebuffer;
+	catch(const std::exception& e) {
+		std::fprintf(stderr, "Ignoring environment bake: %s\n", e.what());
+		return false;
 	}
-
-	std::printf("OpenGL 4.5 Renderer [%s]\n", glGetString(GL_RENDERER));
-	return window;
+	return uploadEnvironmentBake(bake, environment);
 }
 
-void Renderer::shutdown()
+bool Renderer::uploadEnvironmentBake(const std::shared_ptr<EnvironmentCache::Bake>& bake, int environment)
 {
-	if(m_framebuffer.id != m_resolveFramebuffer.id) {
-		deleteFrameBuffer(m_resolveFramebuffer);
+	PROFILE_ZONE("Renderer::uploadEnvironmentBake");
+	if(bake->envMapSize != m_envTexture.width || bake->envMapLevels != m_envTexture.levels || bake->irmapSize != m_irmapTexture.width) {
+		std::fprintf(stderr, "Ignoring environment bake with mismatched dimensions: %s\n", EnvironmentCache::bakeFilename(m_settings.environments[environment]).c_str());
+		return false;
+	}
+	if(m_ibl.cache.lookup(environment) >= 0) {
+		return true;
 	}
-	deleteFrameBuffer(m_framebuffer);
-
-	glDeleteVertexArrays(1, &m_emptyVAO);
-
-	glDeleteBuffers(1, &m_transformUB);
-	glDeleteBuffers(1, &m_shadingUB);
 
-	deleteMeshBuffer(m_skybox);
-	deleteMeshBuffer(m_pbrModel);
-	
-	glDeleteProgram(m_tonemapProgram);
-	glDeleteProgram(m_skyboxProgram);
-	glDeleteProgram(m_pbrProgram);
+	const int slot = acquireEnvironmentSlot(environment);
+	if(slot == -1) {
+		return false;
+	}
 
-	deleteTexture(m_envTexture);
-	deleteTexture(m_irmapTexture);
-	deleteTexture(m_spBRDF_LUT);
+	const EnvironmentSlot& target = m_ibl.slots[slot];
+	for(int level=0, size=bake->envMapSize; level<bake->envMapLevels; ++level, size=glm::max(size/2, 1)) {
+		glTextureSubImage3D(target.envTexture.id, level, 0, 0, 0, size, size, 6, GL_RGBA, GL_HALF_FLOAT, &bake->texels[4 * bake->envMapLevelOffset(level)]);
+	}
+	glTextureSubImage3D(target.irmapTexture.id, 0, 0, 0, 0, bake->irmapSize, bake->irmapSize, 6, GL_RGBA, GL_HALF_FLOAT, &bake->texels[4 * bake->irmapOffset()]);
 
-	deleteTexture(m_albedoTexture);
-	deleteTexture(m_normalTexture);
-	deleteTexture(m_metalnessTexture);
-	deleteTexture(m_roughnessTexture);
+	if(environment == m_ibl.environment) {
+		activateEnvironmentSlot(slot);
+	}
+	return true;
 }
 
-void Renderer::setup()
+void Renderer::readbackEnvironmentSlot(int slot)
 {
-	// Parameters
-	static constexpr int kEnvMapSize = 1024;
-	static constexpr int kIrradianceMapSize = 32;
-	static constexpr int kBRDF_LUT_Size = 256;
+	// Only one readback is in flight at a time, environments which miss it are simply baked next time they get pre-filtered.
+	const int environment = m_ibl.cache.environment(slot);
+	if(m_ibl.readbackBuffer != 0 || EnvironmentCache::bakeExists(m_settings.environments[environment])) {
+		return;
+	}
 
-	// Set global OpenGL state.
-	glEnable(GL_CULL_FACE);
-	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
-	glFrontFace(GL_CCW);
+	// Pre-filtered maps have been written by compute shaders.
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
 
-	// Create empty VAO for rendering full screen triangle.
-	glCreateVertexArrays(1, &m_emptyVAO);
+	const EnvironmentSlot& source = m_ibl.slots[slot];
+	const EnvironmentCache::Bake layout = { source.envTexture.width, source.envTexture.levels, source.irmapTexture.width };
+	const size_t bufferSize = layout.numTexels() * 4 * sizeof(uint16_t);
 
-	// Create uniform buffers.
-	m_transformUB = createUniformBuffer<TransformUB>();
-	m_shadingUB = createUniformBuffer<ShadingUB>();
+	// Copy into pixel pack buffer & map it only after GPU has signaled the fence to avoid stalling.
+	m_ibl.readbackBuffer = createBuffer(bufferSize, nullptr, GL_MAP_READ_BIT, MemoryCategory::Staging);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_ibl.readbackBuffer);
+	for(int level=0, size=layout.envMapSize; level<layout.envMapLevels; ++level, size=glm::max(size/2, 1)) {
+		const size_t offset = 4 * sizeof(uint16_t) * layout.envMapLevelOffset(level);
+		glGetTextureImage(source.envTexture.id, level, GL_RGBA, GL_HALF_FLOAT, GLsizei(bufferSize - offset), reinterpret_cast<void*>(offset));
+	}
+	{
+		const size_t offset = 4 * sizeof(uint16_t) * layout.irmapOffset();
+		glGetTextureImage(source.irmapTexture.id, 0, GL_RGBA, GL_HALF_FLOAT, GLsizei(bufferSize - offset), reinterpret_cast<void*>(offset));
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
-	// Load assets & compile/link rendering programs.
-	m_tonemapProgram = linkProgram({
-		compileShader("shaders/glsl/tonemap_vs.glsl", GL_VERTEX_SHADER),
-		compileShader("shaders/glsl/tonemap_fs.glsl", GL_FRAGMENT_SHADER)
-	});
+	m_ibl.readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_ibl.readbackEnvironment = environment;
+}
 
-	m_skybox = createMeshBuffer(Mesh::fromFile("meshes/skybox.obj"));
-	m_skyboxProgram = linkProgram({
-		compileShader("shaders/glsl/skybox_vs.glsl", GL_VERTEX_SHADER),
-		compileShader("shaders/glsl/skybox_fs.glsl", GL_FRAGMENT_SHADER)
+void Renderer::saveEnvironmentReadback()
+{
+	PROFILE_ZONE("Renderer::saveEnvironmentReadback");
+	std::shared_ptr<EnvironmentCache::Bake> bake{new EnvironmentCache::Bake{ m_envTexture.width, m_envTexture.levels, m_irmapTexture.width }};
+	bake->texels.resize(4 * bake->numTexels());
+	glGetNamedBufferSubData(m_ibl.readbackBuffer, 0, bake->texels.size() * sizeof(uint16_t), bake->texels.data());
+
+	glDeleteSync(m_ibl.readbackFence);
+	deleteBuffer(m_ibl.readbackBuffer);
+	m_ibl.readbackFence = nullptr;
+	m_ibl.readbackBuffer = 0;
+
+	// Encoding & writing is done in the background; failure to write a bake is not fatal.
+	const std::string filename = m_settings.environments[m_ibl.readbackEnvironment];
+	const uint32_t settingsHash = EnvironmentCache::bakeSettingsHash(m_settings);
+	m_ibl.bakeWriter = std::async(std::launch::async, [filename, settingsHash, bake]() {
+		try {
+			EnvironmentCache::saveBake(filename, settingsHash, *bake);
+		}
+		catch(const std::exception& e) {
+			std::fprintf(stderr, "%s\n", e.what());
+		}
 	});
+}
 
-	m_pbrModel = createMeshBuffer(Mesh::fromFile("meshes/cerberus.fbx"));
-	m_pbrProgram = linkProgram({
-		compileShader("shaders/glsl/pbr_vs.glsl", GL_VERTEX_SHADER),
-		compileShader("shaders/glsl/pbr_fs.glsl", GL_FRAGMENT_SHADER)
-	});
+int Renderer::acquireEnvironmentSlot(int environment)
+{
+	// Never evict current environment, the one being pre-filtered & (preferably) the one still being blended from.
+	const int blendSlot = (m_ibl.blendFrames > 0) ? m_ibl.previousSlot : -1;
+	int slot = m_ibl.cache.allocate(environment, { m_ibl.currentSlot, m_ibl.targetSlot, blendSlot });
+	if(slot == -1 && blendSlot != -1) {
+		m_ibl.blendFrames = 0;
+		slot = m_ibl.cache.allocate(environment, { m_ibl.currentSlot, m_ibl.targetSlot });
+	}
 
-	m_albedoTexture = createTexture(Image::fromFile("textures/cerberus_A.png", 3), GL_RGB, GL_SRGB8);
-	m_normalTexture = createTexture(Image::fromFile("textures/cerberus_N.png", 3), GL_RGB, GL_RGB8);
-	m_metalnessTexture = createTexture(Image::fromFile("textures/cerberus_M.png", 1), GL_RED, GL_R8);
-	m_roughnessTexture = createTexture(Image::fromFile("textures/cerberus_R.png", 1), GL_RED, GL_R8);
-	
-	// Unfiltered environment cube map (temporary).
-	Texture envTextureUnfiltered = createTexture(GL_TEXTURE_CUBE_MAP, kEnvMapSize, kEnvMapSize, GL_RGBA16F);
-	
-	// Load & convert equirectangular environment map to a cubemap texture.
-	{
-		GLuint equirectToCubeProgram = linkProgram({
-			compileShader("shaders/glsl/equirect2cube_cs.glsl", GL_COMPUTE_SHADER)
-		});
+	if(slot != -1 && m_ibl.slots[slot].envTexture.id == 0) {
+		m_ibl.slots[slot].envTexture = createTexture(GL_TEXTURE_CUBE_MAP, m_envTexture.width, m_envTexture.height, GL_RGBA16F, MemoryCategory::IBL);
+		m_ibl.slots[slot].irmapTexture = createTexture(GL_TEXTURE_CUBE_MAP, m_irmapTexture.width, m_irmapTexture.height, GL_RGBA16F, MemoryCategory::IBL, 1);
+	}
+	return slot;
+}
 
-		Texture envTextureEquirect = createTexture(Image::fromFile("environment.hdr", 3), GL_RGB, GL_RGB16F, 1);
+void Renderer::activateEnvironmentSlot(int slot)
+{
+	// Only texture bindings change: blend from the previous environment over next frames.
+	m_ibl.previousSlot = m_ibl.currentSlot;
+	m_ibl.currentSlot = slot;
+	m_ibl.blendFrames = (m_ibl.previousSlot != slot) ? m_settings.iblBlendFrames : 0;
+	m_ibl.cache.touch(slot);
+
+	m_envTexture = m_ibl.slots[slot].envTexture;
+	m_irmapTexture = m_ibl.slots[slot].irmapTexture;
+	m_atlas.dirty = true;
+
+	// Environments are cycled in order: prefetch the next one if it has been baked but is no longer resident.
+	const int nextEnvironment = (m_ibl.environment + 1) % (int)m_settings.environments.size();
+	if(m_ibl.cache.lookup(nextEnvironment) == -1 && !m_ibl.pendingBake.valid() && EnvironmentCache::bakeExists(m_settings.environments[nextEnvironment])) {
+		loadEnvironmentBake(nextEnvironment);
+	}
+}
 
-		glUseProgram(equirectToCubeProgram);
-		glBindTextureUnit(0, envTextureEquirect.id);
-		glBindImageTexture(0, envTextureUnfiltered.id, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-		glDispatchCompute(envTextureUnfiltered.width/32, envTextureUnfiltered.height/32, 6);
-		
-		glDeleteTextures(1, &envTextureEquirect.id);
-		glDeleteProgram(equirectToCubeProgram);
+void Renderer::updateIBL()
+{
+	PROFILE_ZONE("Renderer::updateIBL");
+	// Read back GPU timings of previously executed slices to refine throughput estimate.
+	GLuint timerQuery = 0;
+	int timerQueryIndex = -1;
+	for(int i=0; i<NumIBLTimerQueries; ++i) {
+		if(m_ibl.timerQueryCost[i] > 0.0) {
+			GLint available;
+			glGetQueryObjectiv(m_ibl.timerQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+			if(available) {
+				GLuint64 elapsedTime;
+				glGetQueryObjectui64v(m_ibl.timerQueries[i], GL_QUERY_RESULT, &elapsedTime);
+				m_iblScheduler.reportGPUTime(m_ibl.timerQueryCost[i], elapsedTime * 1e-6);
+				m_ibl.timerQueryCost[i] = 0.0;
+			}
+		}
+		if(m_ibl.timerQueryCost[i] == 0.0 && timerQueryIndex == -1) {
+			timerQuery = m_ibl.timerQueries[i];
+			timerQueryIndex = i;
+		}
 	}
-	
-	glGenerateTextureMipmap(envTextureUnfiltered.id);
-	
-	// Compute pre-filtered specular environment map.
-	{
-		GLuint spmapProgram = linkProgram({
-			compileShader("shaders/glsl/spmap_cs.glsl", GL_COMPUTE_SHADER)
-		});
 
-		m_envTexture = createTexture(GL_TEXTURE_CUBE_MAP, kEnvMapSize, kEnvMapSize, GL_RGBA16F);
+	FrameVector<IBLScheduler::Slice> slices{FrameAllocator<IBLScheduler::Slice>(m_frameArena)};
+	m_iblScheduler.nextSlices(m_settings.iblFrameBudget, slices);
+
+	if(timerQuery) {
+		glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+	}
 
-		// Copy 0th mipmap level into destination environment map.
-		glCopyImageSubData(envTextureUnfiltered.id, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
-			m_envTexture.id, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
-			m_envTexture.width, m_envTexture.height, 6);
+	// Startup refinement writes directly into current maps, environment switch into target slot.
+	const Texture& envTarget = (m_ibl.targetSlot >= 0) ? m_ibl.slots[m_ibl.targetSlot].envTexture : m_envTexture;
+	const Texture& irmapTarget = (m_ibl.targetSlot >= 0) ? m_ibl.slots[m_ibl.targetSlot].irmapTexture : m_irmapTexture;
+
+	const float deltaRoughness = 1.0f / glm::max(float(envTarget.levels-1), 1.0f);
+	const int equirectGroupSize = m_workgroups.size(WorkgroupTuner::Equirect2Cube);
+	const int spmapGroupSize = m_workgroups.size(WorkgroupTuner::SpecularFilter);
+	const int irmapGroupSize = m_workgroups.size(WorkgroupTuner::Irradiance);
+
+	double cost = 0.0;
+	for(const IBLScheduler::Slice& slice : slices) {
+		switch(slice.pass) {
+		case IBLScheduler::Slice::ConvertEquirect:
+			glUseProgram(m_ibl.equirectToCubeProgram);
+			glBindTextureUnit(0, m_ibl.envTextureEquirect.id);
+			glBindImageTexture(0, m_ibl.envTextureUnfiltered.id, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+			glDispatchCompute(m_ibl.envTextureUnfiltered.width/equirectGroupSize, m_ibl.envTextureUnfiltered.height/equirectGroupSize, 6);
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+			deleteTexture(m_ibl.envTextureEquirect);
+			break;
+		case IBLScheduler::Slice::GenerateMipmaps:
+			glGenerateTextureMipmap(m_ibl.envTextureUnfiltered.id);
+			break;
+		case IBLScheduler::Slice::CopyBaseLevel:
+			glCopyImageSubData(m_ibl.envTextureUnfiltered.id, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+				envTarget.id, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+				envTarget.width, envTarget.height, 6);
+			break;
+		case IBLScheduler::Slice::SpecularFilter:
+			glUseProgram(m_ibl.spmapProgram);
+			glBindTextureUnit(0, m_ibl.envTextureUnfiltered.id);
+			glBindImageTexture(0, envTarget.id, slice.level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+			glProgramUniform1f(m_ibl.spmapProgram, 0, slice.level * deltaRoughness);
+			glProgramUniform1ui(m_ibl.spmapProgram, 1, slice.face);
+			glProgramUniform1ui(m_ibl.spmapProgram, 2, slice.row);
+			if(m_settings.iblSampleTables) {
+				glProgramUniform1i(m_ibl.spmapProgram, 6, slice.level);
+			}
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_ibl.sampleTableBuffer);
+			glDispatchCompute((envTarget.width >> slice.level) / spmapGroupSize, slice.numRows / spmapGroupSize, 1);
+			break;
+		case IBLScheduler::Slice::SpecularFilterMipTail:
+			glBindTextureUnit(0, m_ibl.envTextureUnfiltered.id);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_ibl.sampleTableBuffer);
+			dispatchSpecularMipTail(m_ibl.spmapTailProgram, envTarget, slice.level);
+			break;
+		case IBLScheduler::Slice::IrradianceFilter:
+			glUseProgram(m_ibl.irmapProgram);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_ibl.distributionBuffer);
+			glBindTextureUnit(0, m_ibl.envTextureUnfiltered.id);
+			glBindImageTexture(0, irmapTarget.id, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA16F);
+			glProgramUniform1ui(m_ibl.irmapProgram, 0, slice.face);
+			glProgramUniform1ui(m_ibl.irmapProgram, 1, slice.batch);
+			glProgramUniform1ui(m_ibl.irmapProgram, 2, slice.numBatches);
+			glProgramUniform1f(m_ibl.irmapProgram, 3, 0.0f);
+			glDispatchCompute(irmapTarget.width/irmapGroupSize, irmapTarget.height/irmapGroupSize, 1);
+			// Next batch reads back results of this one.
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+			break;
+		}
+		cost += slice.cost;
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
 
-		glUseProgram(spmapProgram);
-		glBindTextureUnit(0, envTextureUnfiltered.id);
+	if(timerQuery) {
+		glEndQuery(GL_TIME_ELAPSED);
+		m_ibl.timerQueryCost[timerQueryIndex] = cost;
+	}
 
-		// Pre-filter rest of the mip chain.
-		const float deltaRoughness = 1.0f / glm::max(float(m_envTexture.levels-1), 1.0f);
-		for(int level=1, size=kEnvMapSize/2; level<=m_envTexture.levels; ++level, size/=2) {
-			const GLuint numGroups = glm::max(1, size/32);
-			glBindImageTexture(0, m_envTexture.id, level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-			glProgramUniform1f(spmapProgram, 0, level * deltaRoughness);
-			glDispatchCompute(numGroups, numGroups, 6);
+	if(m_iblScheduler.empty()) {
+		// Readback buffer is recorded in MemoryStats & activation may prefetch the next environment's bake (std::async).
+		AllocationCounter::allowFrame();
+		if(m_ibl.targetSlot >= 0) {
+			// New environment is ready: bake it to disk for later reuse & bind it.
+			const int slot = m_ibl.targetSlot;
+			m_ibl.targetSlot = -1;
+			readbackEnvironmentSlot(slot);
+			activateEnvironmentSlot(slot);
+		}
+		else {
+			std::printf("Progressive IBL pre-processing complete\n");
+			if(!m_ibl.slots.empty()) {
+				readbackEnvironmentSlot(m_ibl.currentSlot);
+			}
+		}
+
+		// Release pre-processing resources once all work has been submitted (keep programs if environment can still change
+		// or reflection probes need them).
+		deleteTexture(m_ibl.envTextureUnfiltered);
+		if(m_settings.environments.size() <= 1 && m_settings.reflectionProbes.empty()) {
+			releaseIBLResources();
 		}
-		glDeleteProgram(spmapProgram);
 	}
+}
+
+void Renderer::convertSpecularAtlas()
+{
+	PROFILE_ZONE("Renderer::convertSpecularAtlas");
+	// Whole atlas in one dispatch, texels outside of level regions are skipped.
+	glUseProgram(m_atlas.convertProgram);
+	glBindTextureUnit(0, m_envTexture.id);
+	glBindImageTexture(0, m_atlas.texture.id, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glDispatchCompute(m_atlas.texture.width/32, m_atlas.texture.height/32, 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	m_atlas.dirty = false;
+}
 
-	glDeleteTextures(1, &envTextureUnfiltered.id);
+void Renderer::reportSpecularAtlas() const
+{
+	GLuint compareProgram = linkProgram({
+		compileShader("shaders/glsl/octcompare_cs.glsl", GL_COMPUTE_SHADER)
+	});
 
-	// Compute diffuse irradiance cubemap.
-	{
-		GLuint irmapProgram = linkProgram({
-			compileShader("shaders/glsl/irmap_cs.glsl", GL_COMPUTE_SHADER)
-		});
+	const int numLevels = OctahedralAtlas::numLevels(m_envTexture.levels);
+	std::vector<glm::vec4> errorResults(numLevels * OctahedralAtlas::NumErrorDirections);
 
-		m_irmapTexture = createTexture(GL_TEXTURE_CUBE_MAP, kIrradianceMapSize, kIrradianceMapSize, GL_RGBA16F, 1);
+	GLuint resultsBuffer = createBuffer(errorResults.size() * sizeof(glm::vec4), nullptr, 0, MemoryCategory::Other);
 
-		glUseProgram(irmapProgram);
-		glBindTextureUnit(0, m_envTexture.id);
-		glBindImageTexture(0, m_irmapTexture.id, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-		glDispatchCompute(m_irmapTexture.width/32, m_irmapTexture.height/32, 6);
-		glDeleteProgram(irmapProgram);
+	glUseProgram(compareProgram);
+	glBindTextureUnit(0, m_envTexture.id);
+	glBindTextureUnit(1, m_atlas.texture.id);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, resultsBuffer);
+
+	// Per-level error.
+	glProgramUniform1ui(compareProgram, 0, 0);
+	glDispatchCompute(OctahedralAtlas::NumErrorDirections/64, numLevels, 1);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glGetNamedBufferSubData(resultsBuffer, 0, errorResults.size() * sizeof(glm::vec4), errorResults.data());
+
+	// Sampling cost of cube map (mode 1) & atlas (mode 2): first dispatch of each mode warms up caches & is not timed.
+	GLuint timerQueries[2];
+	glCreateQueries(GL_TIME_ELAPSED, 2, timerQueries);
+	for(GLuint mode=1; mode<=2; ++mode) {
+		glProgramUniform1ui(compareProgram, 0, mode);
+		glDispatchCompute(OctahedralAtlas::NumCostInvocations/64, 1, 1);
+		glBeginQuery(GL_TIME_ELAPSED, timerQueries[mode-1]);
+		glDispatchCompute(OctahedralAtlas::NumCostInvocations/64, 1, 1);
+		glEndQuery(GL_TIME_ELAPSED);
 	}
+	GLuint64 elapsedTime[2];
+	glGetQueryObjectui64v(timerQueries[0], GL_QUERY_RESULT, &elapsedTime[0]);
+	glGetQueryObjectui64v(timerQueries[1], GL_QUERY_RESULT, &elapsedTime[1]);
 
-	// Compute Cook-Torrance BRDF 2D LUT for split-sum approximation.
-	{
-		GLuint spBRDFProgram = linkProgram({
-			compileShader("shaders/glsl/spbrdf_cs.glsl", GL_COMPUTE_SHADER)
-		});
+	OctahedralAtlas::printReport(m_envTexture.width, m_envTexture.levels, errorResults, elapsedTime[0] * 1e-6, elapsedTime[1] * 1e-6);
 
-		m_spBRDF_LUT = createTexture(GL_TEXTURE_2D, kBRDF_LUT_Size, kBRDF_LUT_Size, GL_RG16F, 1);
-		glTextureParameteri(m_spBRDF_LUT.id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTextureParameteri(m_spBRDF_LUT.id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glDeleteQueries(2, timerQueries);
+	deleteBuffer(resultsBuffer);
+	glDeleteProgram(compareProgram);
+}
 
-		glUseProgram(spBRDFProgram);
-		glBindImageTexture(0, m_spBRDF_LUT.id, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
-		glDispatchCompute(m_spBRDF_LUT.width/32, m_spBRDF_LUT.height/32, 1);
-		glDeleteProgram(spBRDFProgram);
-	}
+GLuint Renderer::createEnvironmentDistributionBuffer(const Image& image) const
+{
+	const EnvironmentDistribution distribution = EnvironmentDistribution::build(image);
+	std::vector<char> data(distribution.bufferSize());
+	distribution.copyToBuffer(data.data());
 
-	glFinish();
+	const GLuint buffer = createBuffer(data.size(), data.data(), 0, MemoryCategory::IBL);
+	StartupReport::addBytesUploaded(data.size());
+	return buffer;
 }
 
-void Renderer::render(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene)
+double Renderer::compareIBLMaps(GLuint program, const Texture& texture, const Texture& reference, GLuint resultsBuffer, int numGroupsX, int numGroupsY)
 {
-	const glm::mat4 projectionMatrix = glm::perspectiveFov(view.fov, float(m_framebuffer.width), float(m_framebuffer.height), 1.0f, 1000.0f);
-	const glm::mat4 viewRotationMatrix = glm::eulerAngleXY(glm::radians(view.pitch), glm::radians(view.yaw));
-	const glm::mat4 sceneRotationMatrix = glm::eulerAngleXY(glm::radians(scene.pitch), glm::radians(scene.yaw));
-	const glm::mat4 viewMatrix = glm::translate(glm::mat4{ 1.0f }, { 0.0f, 0.0f, -view.distance }) * viewRotationMatrix;
-	const glm::vec3 eyePosition = glm::inverse(viewMatrix)[3];
+	// Both comparison programs run 64 invocations per thread group, each writing a single (error, reference) pair.
+	std::vector<glm::vec2> results(numGroupsX * numGroupsY * 64);
+
+	glUseProgram(program);
+	glBindTextureUnit(0, texture.id);
+	glBindTextureUnit(1, reference.id);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, resultsBuffer);
+	glDispatchCompute(numGroupsX, numGroupsY, 1);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glGetNamedBufferSubData(resultsBuffer, 0, results.size() * sizeof(glm::vec2), results.data());
+
+	return IBLBenchmark::relativeError(results);
+}
 
-	// Update transform uniform buffer.
-	{
-		TransformUB transformUniforms;
-		transformUniforms.viewProjectionMatrix = projectionMatrix * viewMatrix;
-		transformUniforms.skyProjectionMatrix  = projectionMatrix * viewRotationMatrix;
-		transformUniforms.sceneRotationMatrix  = sceneRotationMatrix;
-		glNamedBufferSubData(m_transformUB, 0, sizeof(TransformUB), &transformUniforms);
+void Renderer::dispatchSpecularMipTail(GLuint program, const Texture& envTexture, int tailLevel) const
+{
+	// Bind all mip tail levels to consecutive image units & pre-filter them with a single dispatch.
+	const float deltaRoughness = 1.0f / glm::max(float(envTexture.levels-1), 1.0f);
+	for(int level=tailLevel; level<envTexture.levels; ++level) {
+		glBindImageTexture(level - tailLevel, envTexture.id, level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	}
+	glUseProgram(program);
+	glProgramUniform1f(program, 0, tailLevel * deltaRoughness);
+	glProgramUniform1f(program, 5, deltaRoughness);
+	if(m_settings.iblSampleTables) {
+		glProgramUniform1i(program, 6, tailLevel);
 	}
 
-	// Update shading uniform buffer.
-	{
-		ShadingUB shadingUniforms;
-		shadingUniforms.eyePosition = glm::vec4(eyePosition, 0.0f);
-		for(int i=0; i<SceneSettings::NumLights; ++i) {
-			const SceneSettings::Light& light = scene.lights[i];
-			shadingUniforms.lights[i].direction = glm::vec4{light.direction, 0.0f};
-			if(light.enabled) {
-				shadingUniforms.lights[i].radiance = glm::vec4{light.radiance, 0.0f};
+	const int tailSize = glm::max(envTexture.width >> tailLevel, 1);
+	glDispatchCompute(IBLScheduler::specularMipTailGroups(tailSize, envTexture.levels - tailLevel, kSpecularMipTailGroupSize), 1, 1);
+}
+
+void Renderer::tuneWorkgroupSize(WorkgroupTuner::Kernel kernel, const std::function<GLuint(int)>& linkVariant, const std::function<void(GLuint, int)>& dispatch)
+{
+	if(!m_workgroups.pending(kernel)) {
+		return;
+	}
+
+	GLint maxInvocations;
+	glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &maxInvocations);
+	const std::vector<int> candidates = WorkgroupTuner::candidates(maxInvocations);
+
+	GLuint timerQuery;
+	glCreateQueries(GL_TIME_ELAPSED, 1, &timerQuery);
+
+	// Every candidate writes the same output so dispatches only need to be serialized (first one is a warm-up).
+	std::vector<double> timings;
+	for(int groupSize : candidates) {
+		GLuint program = linkVariant(groupSize);
+		double minTime = std::numeric_limits<double>::max();
+		for(int run=0; run<=WorkgroupTuner::NumTimedRuns; ++run) {
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+			if(run > 0) {
+				glBeginQuery(GL_TIME_ELAPSED, timerQuery);
 			}
-			else {
-				shadingUniforms.lights[i].radiance = glm::vec4{};
+			dispatch(program, groupSize);
+			if(run > 0) {
+				glEndQuery(GL_TIME_ELAPSED);
+				minTime = std::min(minTime, elapsedMilliseconds(timerQuery));
 			}
 		}
-		glNamedBufferSubData(m_shadingUB, 0, sizeof(ShadingUB), &shadingUniforms);
+		timings.push_back(minTime);
+		glDeleteProgram(program);
 	}
 
-	// Prepare framebuffer for rendering.
-	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer.id);
-	glClear(GL_DEPTH_BUFFER_BIT); // No need to clear color, since we'll overwrite the screen with our skybox.
-	
-	// Bind uniform buffers.
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_transformUB);
-	glBindBufferBase(GL_UNIFORM_BUFFER, 1, m_shadingUB);
-
-	// Draw skybox.
-	glDisable(GL_DEPTH_TEST);
-	glUseProgram(m_skyboxProgram);
-	glBindTextureUnit(0, m_envTexture.id);
-	glBindVertexArray(m_skybox.vao);
-	glDrawElements(GL_TRIANGLES, m_skybox.numElements, GL_UNSIGNED_INT, 0);
-
-	// Draw PBR model.
-	glEnable(GL_DEPTH_TEST);
-	glUseProgram(m_pbrProgram);
-	glBindTextureUnit(0, m_albedoTexture.id);
-	glBindTextureUnit(1, m_normalTexture.id);
-	glBindTextureUnit(2, m_metalnessTexture.id);
-	glBindTextureUnit(3, m_roughnessTexture.id);
-	glBindTextureUnit(4, m_envTexture.id);
-	glBindTextureUnit(5, m_irmapTexture.id);
-	glBindTextureUnit(6, m_spBRDF_LUT.id);
-	glBindVertexArray(m_pbrModel.vao);
-	glDrawElements(GL_TRIANGLES, m_pbrModel.numElements, GL_UNSIGNED_INT, 0);
-		
-	// Resolve multisample framebuffer.
-	resolveFramebuffer(m_framebuffer, m_resolveFramebuffer);
-
-	// Draw a full screen triangle for postprocessing/tone mapping.
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glUseProgram(m_tonemapProgram);
-	glBindTextureUnit(0, m_resolveFramebuffer.colorTarget);
-	glBindVertexArray(m_emptyVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glDeleteQueries(1, &timerQuery);
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	m_workgroups.select(kernel, candidates, timings);
+}
 
-	glfwSwapBuffers(window);
+void Renderer::releaseIBLResources()
+{
+	glDeleteProgram(m_ibl.equirectToCubeProgram);
+	glDeleteProgram(m_ibl.spmapProgram);
+	glDeleteProgram(m_ibl.spmapTailProgram);
+	glDeleteProgram(m_ibl.irmapProgram);
+	deleteBuffer(m_ibl.sampleTableBuffer);
+	deleteBuffer(m_ibl.distributionBuffer);
+	glDeleteQueries(NumIBLTimerQueries, m_ibl.timerQueries);
+	deleteTexture(m_ibl.envTextureEquirect);
+	deleteTexture(m_ibl.envTextureUnfiltered);
+
+	m_ibl.equirectToCubeProgram = 0;
+	m_ibl.spmapProgram = 0;
+	m_ibl.spmapTailProgram = 0;
+	m_ibl.sampleTableBuffer = 0;
+	m_ibl.distributionBuffer = 0;
+	m_ibl.irmapProgram = 0;
+	std::memset(m_ibl.timerQueries, 0, sizeof(m_ibl.timerQueries));
 }
 	
-GLuint Renderer::compileShader(const std::string& filename, GLenum type)
+GLuint Renderer::compileShader(const std::string& filename, GLenum type, const std::vector<std::string>& defines)
 {
-	const std::string src = File::readText(filename);
+	PROFILE_ZONE("Renderer::compileShader");
+	std::string src = File::readText(filename);
 	if(src.empty()) {
 		throw std::runtime_error("Cannot read shader source file: " + filename);
 	}
+	if(!defines.empty()) {
+		// Preprocessor definitions must follow #version directive.
+		std::string definitions;
+		for(const std::string& define : defines) {
+			definitions += "#define " + define + "\n";
+		}
+		const size_t versionEnd = src.find('\n', src.find("#version"));
+		src.insert(versionEnd == std::string::npos ? src.size() : versionEnd + 1, definitions);
+	}
 	const GLchar* srcBufferPtr = src.c_str();
 
 	std::printf("Compiling GLSL shader: %s\n", filename.c_str());
@@ -345,8 +2508,21 @@ GLuint Renderer::compileShader(const std::string& filename, GLenum type)
 	return shader;
 }
 	
+bool Renderer::isExtensionSupported(const char* name)
+{
+	GLint numExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+	for(GLint i=0; i<numExtensions; ++i) {
+		if(std::strcmp(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)), name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
 GLuint Renderer::linkProgram(std::initializer_list<GLuint> shaders)
 {
+	PROFILE_ZONE("Renderer::linkProgram");
 	GLuint program = glCreateProgram();
 
 	for(GLuint shader : shaders) {
@@ -374,7 +2550,7 @@ GLuint Renderer::linkProgram(std::initializer_list<GLuint> shaders)
 	return program;
 }
 	
-Texture Renderer::createTexture(GLenum target, int width, int height, GLenum internalformat, int levels) const
+Texture Renderer::createTexture(GLenum target, int width, int height, GLenum internalformat, MemoryCategory category, int levels) const
 {
 	Texture texture;
 	texture.width  = width;
@@ -383,21 +2559,25 @@ Texture Renderer::createTexture(GLenum target, int width, int height, GLenum int
 	
 	glCreateTextures(target, 1, &texture.id);
 	glTextureStorage2D(texture.id, texture.levels, internalformat, width, height);
+	m_memoryStats.allocate(memoryHandle(GL_TEXTURE, texture.id), category, 0,
+		imageBytes(internalformat, width, height, (target == GL_TEXTURE_CUBE_MAP) ? 6 : 1, texture.levels));
 	glTextureParameteri(texture.id, GL_TEXTURE_MIN_FILTER, texture.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
 	glTextureParameteri(texture.id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTextureParameterf(texture.id, GL_TEXTURE_MAX_ANISOTROPY_EXT, m_capabilities.maxAnisotropy);
 	return texture;
 }
 	
-Texture Renderer::createTexture(const std::shared_ptr<class Image>& image, GLenum format, GLenum internalformat, int levels) const
+Texture Renderer::createTexture(const std::shared_ptr<class Image>& image, GLenum format, GLenum internalformat, MemoryCategory category, int levels) const
 {
-	Texture texture = createTexture(GL_TEXTURE_2D, image->width(), image->height(), internalformat, levels);
+	PROFILE_ZONE("Renderer::createTexture");
+	Texture texture = createTexture(GL_TEXTURE_2D, image->width(), image->height(), internalformat, category, levels);
 	if(image->isHDR()) {
 		glTextureSubImage2D(texture.id, 0, 0, 0, texture.width, texture.height, format, GL_FLOAT, image->pixels<float>());
 	}
 	else {
 		glTextureSubImage2D(texture.id, 0, 0, 0, texture.width, texture.height, format, GL_UNSIGNED_BYTE, image->pixels<unsigned char>());
 	}
+	StartupReport::addBytesUploaded(uint64_t(image->width()) * image->height() * image->channels() * (image->isHDR() ? sizeof(float) : 1));
 
 	if(texture.levels > 1) {
 		glGenerateTextureMipmap(texture.id);
@@ -405,18 +2585,23 @@ Texture Renderer::createTexture(const std::shared_ptr<class Image>& image, GLenu
 	return texture;
 }
 	
-void Renderer::deleteTexture(Texture& texture)
+void Renderer::deleteTexture(Texture& texture) const
 {
+	m_memoryStats.release(memoryHandle(GL_TEXTURE, texture.id));
 	glDeleteTextures(1, &texture.id);
 	std::memset(&texture, 0, sizeof(Texture));
 }
 
-FrameBuffer Renderer::createFrameBuffer(int width, int height, int samples, GLenum colorFormat, GLenum depthstencilFormat)
+FrameBuffer Renderer::createFrameBuffer(int width, int height, int samples, GLenum colorFormat, GLenum depthstencilFormat, bool sampledDepth) const
 {
+	assert(!sampledDepth || samples == 0);
+
 	FrameBuffer fb;
 	fb.width   = width;
 	fb.height  = height;
 	fb.samples = samples;
+	fb.colorFormat = colorFormat;
+	fb.sampledDepth = sampledDepth;
 
 	glCreateFramebuffers(1, &fb.id);
 
@@ -424,15 +2609,23 @@ FrameBuffer Renderer::createFrameBuffer(int width, int height, int samples, GLen
 		if(samples > 0) {
 			glCreateRenderbuffers(1, &fb.colorTarget);
 			glNamedRenderbufferStorageMultisample(fb.colorTarget, samples, colorFormat, width, height);
+			m_memoryStats.allocate(memoryHandle(GL_RENDERBUFFER, fb.colorTarget), MemoryCategory::RenderTarget, 0, imageBytes(colorFormat, width, height, 1, 1, samples));
 			glNamedFramebufferRenderbuffer(fb.id, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, fb.colorTarget);
 		}
 		else {
 			glCreateTextures(GL_TEXTURE_2D, 1, &fb.colorTarget);
 			glTextureStorage2D(fb.colorTarget, 1, colorFormat, width, height);
+			m_memoryStats.allocate(memoryHandle(GL_TEXTURE, fb.colorTarget), MemoryCategory::RenderTarget, 0, imageBytes(colorFormat, width, height, 1, 1));
 			glNamedFramebufferTexture(fb.id, GL_COLOR_ATTACHMENT0, fb.colorTarget, 0);
 		}
 	}
-	if(depthstencilFormat != GL_NONE) {
+	if(depthstencilFormat != GL_NONE && sampledDepth) {
+		glCreateTextures(GL_TEXTURE_2D, 1, &fb.depthStencilTarget);
+		glTextureStorage2D(fb.depthStencilTarget, 1, depthstencilFormat, width, height);
+		m_memoryStats.allocate(memoryHandle(GL_TEXTURE, fb.depthStencilTarget), MemoryCategory::RenderTarget, 0, imageBytes(depthstencilFormat, width, height, 1, 1));
+		glNamedFramebufferTexture(fb.id, GL_DEPTH_STENCIL_ATTACHMENT, fb.depthStencilTarget, 0);
+	}
+	else if(depthstencilFormat != GL_NONE) {
 		glCreateRenderbuffers(1, &fb.depthStencilTarget);
 		if(samples > 0) {
 			glNamedRenderbufferStorageMultisample(fb.depthStencilTarget, samples, depthstencilFormat, width, height);
@@ -440,6 +2633,8 @@ FrameBuffer Renderer::createFrameBuffer(int width, int height, int samples, GLen
 		else {
 			glNamedRenderbufferStorage(fb.depthStencilTarget, depthstencilFormat, width, height);
 		}
+		m_memoryStats.allocate(memoryHandle(GL_RENDERBUFFER, fb.depthStencilTarget), MemoryCategory::RenderTarget, 0,
+			imageBytes(depthstencilFormat, width, height, 1, 1, glm::max(samples, 1)));
 		glNamedFramebufferRenderbuffer(fb.id, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, fb.depthStencilTarget);
 	}
 
@@ -450,88 +2645,162 @@ FrameBuffer Renderer::createFrameBuffer(int width, int height, int samples, GLen
 	return fb;
 }
 
-void Renderer::resolveFramebuffer(const FrameBuffer& srcfb, const FrameBuffer& dstfb)
+void Renderer::resolveFramebuffer(const FrameBuffer& srcfb, const FrameBuffer& dstfb, const glm::ivec2& size)
 {
+	PROFILE_ZONE("Renderer::resolveFramebuffer");
 	if(srcfb.id == dstfb.id) {
 		return;
 	}
 
-	std::vector<GLenum> attachments;
+	GLenum attachments[2];
+	GLsizei numAttachments = 0;
 	if(srcfb.colorTarget) {
-		attachments.push_back(GL_COLOR_ATTACHMENT0);
+		attachments[numAttachments++] = GL_COLOR_ATTACHMENT0;
 	}
 	if(srcfb.depthStencilTarget) {
-		attachments.push_back(GL_DEPTH_STENCIL_ATTACHMENT);
+		attachments[numAttachments++] = GL_DEPTH_STENCIL_ATTACHMENT;
 	}
-	assert(attachments.size() > 0);
+	assert(numAttachments > 0);
 
-	glBlitNamedFramebuffer(srcfb.id, dstfb.id, 0, 0, srcfb.width, srcfb.height, 0, 0, dstfb.width, dstfb.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-	glInvalidateNamedFramebufferData(srcfb.id, (GLsizei)attachments.size(), &attachments[0]);
+	// Depth is resolved too if destination has a depth target (blit picks one of the samples).
+	const GLbitfield mask = dstfb.depthStencilTarget ? (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT) : GL_COLOR_BUFFER_BIT;
+	glBlitNamedFramebuffer(srcfb.id, dstfb.id, 0, 0, size.x, size.y, 0, 0, size.x, size.y, mask, GL_NEAREST);
+	glInvalidateNamedFramebufferData(srcfb.id, numAttachments, attachments);
 }
 	
-void Renderer::deleteFrameBuffer(FrameBuffer& fb)
+void Renderer::deleteFrameBuffer(FrameBuffer& fb) const
 {
 	if(fb.id) {
 		glDeleteFramebuffers(1, &fb.id);
 	}
 	if(fb.colorTarget) {
 		if(fb.samples == 0) {
+			m_memoryStats.release(memoryHandle(GL_TEXTURE, fb.colorTarget));
 			glDeleteTextures(1, &fb.colorTarget);
 		}
 		else {
+			m_memoryStats.release(memoryHandle(GL_RENDERBUFFER, fb.colorTarget));
 			glDeleteRenderbuffers(1, &fb.colorTarget);
 		}
 	}
 	if(fb.depthStencilTarget) {
-		glDeleteRenderbuffers(1, &fb.depthStencilTarget);
+		if(fb.sampledDepth) {
+			m_memoryStats.release(memoryHandle(GL_TEXTURE, fb.depthStencilTarget));
+			glDeleteTextures(1, &fb.depthStencilTarget);
+		}
+		else {
+			m_memoryStats.release(memoryHandle(GL_RENDERBUFFER, fb.depthStencilTarget));
+			glDeleteRenderbuffers(1, &fb.depthStencilTarget);
+		}
 	}
 	std::memset(&fb, 0, sizeof(FrameBuffer));
 }
 
-MeshBuffer Renderer::createMeshBuffer(const std::shared_ptr<class Mesh>& mesh)
+MeshBuffer Renderer::createMeshBuffer(const std::shared_ptr<class Mesh>& mesh, bool deinterleaved) const
 {
+	PROFILE_ZONE("Renderer::createMeshBuffer");
 	MeshBuffer buffer;
 	buffer.numElements = static_cast<GLuint>(mesh->faces().size()) * 3;
 
-	const size_t vertexDataSize = mesh->vertices().size() * sizeof(Mesh::Vertex);
 	const size_t indexDataSize  = mesh->faces().size() * sizeof(Mesh::Face);
 
-	glCreateBuffers(1, &buffer.vbo);
-	glNamedBufferStorage(buffer.vbo, vertexDataSize, reinterpret_cast<const void*>(&mesh->vertices()[0]), 0);
-	glCreateBuffers(1, &buffer.ibo);
-	glNamedBufferStorage(buffer.ibo, indexDataSize, reinterpret_cast<const void*>(&mesh->faces()[0]), 0);
+	buffer.ibo = createBuffer(indexDataSize, &mesh->faces()[0], 0, MemoryCategory::Mesh);
+	StartupReport::addBytesUploaded(indexDataSize);
 
 	glCreateVertexArrays(1, &buffer.vao);
 	glVertexArrayElementBuffer(buffer.vao, buffer.ibo);
-	for(int i=0; i<Mesh::NumAttributes; ++i) {
-		glVertexArrayVertexBuffer(buffer.vao, i, buffer.vbo, i * sizeof(glm::vec3), sizeof(Mesh::Vertex));
-		glEnableVertexArrayAttrib(buffer.vao, i);
-		glVertexArrayAttribFormat(buffer.vao, i, i==(Mesh::NumAttributes-1) ? 2 : 3, GL_FLOAT, GL_FALSE, 0);
-		glVertexArrayAttribBinding(buffer.vao, i, i);
+
+	if(!deinterleaved) {
+		const size_t vertexDataSize = mesh->vertices().size() * sizeof(Mesh::Vertex);
+		buffer.vbo = createBuffer(vertexDataSize, &mesh->vertices()[0], 0, MemoryCategory::Mesh);
+		StartupReport::addBytesUploaded(vertexDataSize);
+
+		for(int i=0; i<Mesh::NumAttributes; ++i) {
+			glVertexArrayVertexBuffer(buffer.vao, i, buffer.vbo, i * sizeof(glm::vec3), sizeof(Mesh::Vertex));
+			glEnableVertexArrayAttrib(buffer.vao, i);
+			glVertexArrayAttribFormat(buffer.vao, i, i==(Mesh::NumAttributes-1) ? 2 : 3, GL_FLOAT, GL_FALSE, 0);
+			glVertexArrayAttribBinding(buffer.vao, i, i);
+		}
+	}
+	else {
+		// Binding 0: positions, binding 1: remaining attributes (depth-only passes fetch only 12 bytes per vertex).
+		const std::vector<glm::vec3> positions = mesh->positions();
+		const std::vector<Mesh::Attributes> attributes = mesh->attributes();
+		buffer.positionVbo = createBuffer(positions.size() * sizeof(glm::vec3), positions.data(), 0, MemoryCategory::Mesh);
+		buffer.vbo = createBuffer(attributes.size() * sizeof(Mesh::Attributes), attributes.data(), 0, MemoryCategory::Mesh);
+		StartupReport::addBytesUploaded(positions.size() * sizeof(glm::vec3) + attributes.size() * sizeof(Mesh::Attributes));
+
+		glVertexArrayVertexBuffer(buffer.vao, 0, buffer.positionVbo, 0, sizeof(glm::vec3));
+		glVertexArrayVertexBuffer(buffer.vao, 1, buffer.vbo, 0, sizeof(Mesh::Attributes));
+		for(int i=0; i<Mesh::NumAttributes; ++i) {
+			glEnableVertexArrayAttrib(buffer.vao, i);
+			glVertexArrayAttribFormat(buffer.vao, i, i==(Mesh::NumAttributes-1) ? 2 : 3, GL_FLOAT, GL_FALSE, i > 0 ? (i-1) * sizeof(glm::vec3) : 0);
+			glVertexArrayAttribBinding(buffer.vao, i, i > 0 ? 1 : 0);
+		}
+
+		glCreateVertexArrays(1, &buffer.positionVao);
+		glVertexArrayElementBuffer(buffer.positionVao, buffer.ibo);
+		glVertexArrayVertexBuffer(buffer.positionVao, 0, buffer.positionVbo, 0, sizeof(glm::vec3));
+		glEnableVertexArrayAttrib(buffer.positionVao, 0);
+		glVertexArrayAttribFormat(buffer.positionVao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+		glVertexArrayAttribBinding(buffer.positionVao, 0, 0);
 	}
 	return buffer;
 }
 
-void Renderer::deleteMeshBuffer(MeshBuffer& buffer)
+void Renderer::deleteMeshBuffer(MeshBuffer& buffer) const
 {
 	if(buffer.vao) {
 		glDeleteVertexArrays(1, &buffer.vao);
 	}
+	if(buffer.positionVao) {
+		glDeleteVertexArrays(1, &buffer.positionVao);
+	}
+	if(buffer.positionVbo) {
+		deleteBuffer(buffer.positionVbo);
+	}
 	if(buffer.vbo) {
-		glDeleteBuffers(1, &buffer.vbo);
+		deleteBuffer(buffer.vbo);
 	}
 	if(buffer.ibo) {
-		glDeleteBuffers(1, &buffer.ibo);
+		deleteBuffer(buffer.ibo);
 	}
 	std::memset(&buffer, 0, sizeof(MeshBuffer));
 }
 	
-GLuint Renderer::createUniformBuffer(const void* data, size_t size)
+GLuint Renderer::createUniformBuffer(const void* data, size_t size) const
+{
+	return createBuffer(size, data, GL_DYNAMIC_STORAGE_BIT, MemoryCategory::Uniform);
+}
+
+GLuint Renderer::createBuffer(size_t size, const void* data, GLbitfield flags, MemoryCategory category) const
+{
+	GLuint buffer;
+	glCreateBuffers(1, &buffer);
+	glNamedBufferStorage(buffer, size, data, flags);
+	m_memoryStats.allocate(memoryHandle(GL_BUFFER, buffer), category, 0, size);
+	return buffer;
+}
+
+void Renderer::deleteBuffer(GLuint& buffer) const
+{
+	if(buffer) {
+		m_memoryStats.release(memoryHandle(GL_BUFFER, buffer));
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+}
+
+void Renderer::updateMemoryBudget()
 {
-	GLuint ubo;
-	glCreateBuffers(1, &ubo);
-	glNamedBufferStorage(ubo, size, data, GL_DYNAMIC_STORAGE_BIT);
-	return ubo;
+	if(!m_memory.driverInfo) {
+		return;
+	}
+	GLint totalKilobytes = 0;
+	GLint availableKilobytes = 0;
+	glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &totalKilobytes);
+	glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &availableKilobytes);
+	m_memoryStats.setDriverBudget(0, uint64_t(totalKilobytes - availableKilobytes) * 1024, uint64_t(totalKilobytes) * 1024);
 }
 
 #if _DEBUG
@@ -10,27 +10,50 @@
 #if defined(ENABLE_OPENGL)
 
 #include <string>
+#include <vector>
+#include <future>
+#include <functional>
 #include <glad/glad.h>
 
 #include "common/renderer.hpp"
+#include "common/ibl.hpp"
+#include "common/envcache.hpp"
+#include "common/probes.hpp"
+#include "common/irradiancevolume.hpp"
+#include "common/octatlas.hpp"
+#include "common/workgroups.hpp"
+#include "common/clusters.hpp"
+#include "common/shadows.hpp"
+#include "common/taa.hpp"
+#include "common/dynres.hpp"
+#include "common/exposure.hpp"
+#include "common/permutations.hpp"
+#include "common/memorystats.hpp"
+#include "common/framearena.hpp"
 
 namespace OpenGL {
 
 struct MeshBuffer
 {
-	MeshBuffer() : vbo(0), ibo(0), vao(0) {}
+	MeshBuffer() : vbo(0), ibo(0), vao(0), positionVbo(0), positionVao(0) {}
 	GLuint vbo, ibo, vao;
+	// De-interleaved layout only: tightly packed position stream (vbo then holds remaining attributes)
+	// & vertex array reading just that stream (for depth-only passes).
+	GLuint positionVbo, positionVao;
 	GLuint numElements;
 };
 
 struct FrameBuffer
 {
-	FrameBuffer() : id(0), colorTarget(0), depthStencilTarget(0) {}
+	FrameBuffer() : id(0), colorTarget(0), depthStencilTarget(0), colorFormat(GL_NONE), sampledDepth(false) {}
 	GLuint id;
 	GLuint colorTarget;
 	GLuint depthStencilTarget;
+	GLenum colorFormat;
 	int width, height;
 	int samples;
+	// Single sample depth-stencil target is a texture (otherwise a renderbuffer).
+	bool sampledDepth;
 };
 
 struct Texture
@@ -41,31 +64,84 @@ struct Texture
 	int levels;
 };
 
+struct EnvironmentSlot
+{
+	Texture envTexture;
+	Texture irmapTexture;
+};
+
+struct ShadingUB;
+
 class Renderer final : public RendererInterface
 {
 public:
-	GLFWwindow* initialize(int width, int height, int maxSamples) override;
+	GLFWwindow* initialize(int width, int height, int maxSamples, const RendererSettings& settings) override;
 	void shutdown() override;
 	void setup() override;
 	void render(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene) override;
+	void runBenchmark(BenchmarkKind kind, GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene) override;
 
 private:
-	static GLuint compileShader(const std::string& filename, GLenum type);
+	void benchmarkIBL();
+	void benchmarkLights(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene);
+	void benchmarkDepthPrepass(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene);
+	void benchmarkHalfPrecision(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene);
+
+	static GLuint compileShader(const std::string& filename, GLenum type, const std::vector<std::string>& defines={});
 	static GLuint linkProgram(std::initializer_list<GLuint> shaders);
+	static bool isExtensionSupported(const char* name);
 
-	Texture createTexture(GLenum target, int width, int height, GLenum internalformat, int levels=0) const;
-	Texture createTexture(const std::shared_ptr<class Image>& image, GLenum format, GLenum internalformat, int levels=0) const;
-	static void deleteTexture(Texture& texture);
+	Texture createTexture(GLenum target, int width, int height, GLenum internalformat, MemoryCategory category, int levels=0) const;
+	Texture createTexture(const std::shared_ptr<class Image>& image, GLenum format, GLenum internalformat, MemoryCategory category, int levels=0) const;
+	void deleteTexture(Texture& texture) const;
 
-	static FrameBuffer createFrameBuffer(int width, int height, int samples, GLenum colorFormat, GLenum depthstencilFormat);
-	static void resolveFramebuffer(const FrameBuffer& srcfb, const FrameBuffer& dstfb);
-	static void deleteFrameBuffer(FrameBuffer& fb);
+	FrameBuffer createFrameBuffer(int width, int height, int samples, GLenum colorFormat, GLenum depthstencilFormat, bool sampledDepth=false) const;
+	// Only given region (from origin) is resolved, scaled viewport with dynamic resolution.
+	static void resolveFramebuffer(const FrameBuffer& srcfb, const FrameBuffer& dstfb, const glm::ivec2& size);
+	void deleteFrameBuffer(FrameBuffer& fb) const;
 
-	static MeshBuffer createMeshBuffer(const std::shared_ptr<class Mesh>& mesh);
-	static void deleteMeshBuffer(MeshBuffer& buffer);
+	MeshBuffer createMeshBuffer(const std::shared_ptr<class Mesh>& mesh, bool deinterleaved=false) const;
+	void deleteMeshBuffer(MeshBuffer& buffer) const;
 
-	static GLuint createUniformBuffer(const void* data, size_t size);
-	template<typename T> GLuint createUniformBuffer(const T* data=nullptr)
+	// Immutable buffer storage (glNamedBufferStorage) recorded in memory stats under given category.
+	GLuint createBuffer(size_t size, const void* data, GLbitfield flags, MemoryCategory category) const;
+	void deleteBuffer(GLuint& buffer) const;
+	void updateMemoryBudget();
+
+	void switchEnvironment(int environment);
+	void loadEnvironment(int environment);
+	void loadEnvironmentBake(int environment);
+	void queueEnvironmentFilter(const std::shared_ptr<class Image>& image);
+	bool uploadEnvironmentBake(const std::shared_ptr<EnvironmentCache::Bake>& bake, int environment);
+	// Waits for the bake read in the background & uploads it, returns false if it could not be read (e.g. corrupt file) or uploaded.
+	bool uploadPendingEnvironmentBake(int environment);
+	void readbackEnvironmentSlot(int slot);
+	void saveEnvironmentReadback();
+	int acquireEnvironmentSlot(int environment);
+	void activateEnvironmentSlot(int slot);
+	void updateIBL();
+	void dispatchSpecularMipTail(GLuint program, const Texture& envTexture, int tailLevel) const;
+	// Time dispatches of program variants for all candidate sizes & select the fastest one (unless size is already known).
+	void tuneWorkgroupSize(WorkgroupTuner::Kernel kernel, const std::function<GLuint(int)>& linkVariant, const std::function<void(GLuint, int)>& dispatch);
+	GLuint createEnvironmentDistributionBuffer(const class Image& image) const;
+	void releaseIBLResources();
+	void convertSpecularAtlas();
+	void reportSpecularAtlas() const;
+	static double compareIBLMaps(GLuint program, const Texture& texture, const Texture& reference, GLuint resultsBuffer, int numGroupsX, int numGroupsY);
+
+	void drawScene(GLuint pbrProgram, const EnvironmentSlot* previousEnvironment, bool depthPrepass=false) const;
+	void setupDynamicLights(float modelRadius);
+	void updateDynamicLights(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, ShadingUB& shadingUniforms);
+	void setupShadows(float modelRadius);
+	void updateShadows(const ViewSettings& view, const SceneSettings& scene, const glm::mat4& viewMatrix, const glm::mat4& sceneRotationMatrix);
+	void setupReflectionProbes(float modelRadius);
+	void updateReflectionProbes(const SceneSettings& scene, const glm::mat4& sceneRotationMatrix, const ShadingUB& shadingUniforms, const EnvironmentSlot* previousEnvironment, bool environmentChanged);
+	void filterReflectionProbe(int probe);
+	void setupIrradianceVolume(float modelRadius);
+	void updateIrradianceVolume(const SceneSettings& scene, const glm::mat4& sceneRotationMatrix, const ShadingUB& shadingUniforms, const EnvironmentSlot* previousEnvironment, bool environmentChanged);
+
+	GLuint createUniformBuffer(const void* data, size_t size) const;
+	template<typename T> GLuint createUniformBuffer(const T* data=nullptr) const
 	{
 		return createUniformBuffer(data, sizeof(T));
 	}
@@ -78,6 +154,21 @@ private:
 		float maxAnisotropy = 1.0f;
 	} m_capabilities;
 
+	RendererSettings m_settings;
+
+	// Buffer, texture & renderbuffer allocations (sizes estimated from formats) in a single heap. Driver reported usage & budget
+	// is queried every few frames if GL_NVX_gpu_memory_info is supported.
+	mutable MemoryStats m_memoryStats;
+
+	// Scratch memory of the frame being rendered (reset at the start of render()).
+	FrameArena m_frameArena;
+
+	struct {
+		bool driverInfo = false;
+		int reportRequest = 0;
+		int frame = 0;
+	} m_memory;
+
 	FrameBuffer m_framebuffer;
 	FrameBuffer m_resolveFramebuffer;
 
@@ -89,6 +180,8 @@ private:
 	GLuint m_tonemapProgram;
 	GLuint m_skyboxProgram;
 	GLuint m_pbrProgram;
+	// Variant of PBR program without features captures never use (same program if it has none of them, see PBRPermutation).
+	GLuint m_capturePbrProgram = 0;
 
 	Texture m_envTexture;
 	Texture m_irmapTexture;
@@ -101,6 +194,152 @@ private:
 
 	GLuint m_transformUB;
 	GLuint m_shadingUB;
+
+	// Progressive IBL pre-processing & environment switching state.
+	static constexpr int NumIBLTimerQueries = 4;
+	IBLScheduler m_iblScheduler;
+	WorkgroupTuner m_workgroups;
+	struct {
+		GLuint equirectToCubeProgram = 0;
+		GLuint spmapProgram = 0;
+		GLuint spmapTailProgram = 0;
+		GLuint sampleTableBuffer = 0;
+		GLuint distributionBuffer = 0;
+		GLuint irmapProgram = 0;
+		Texture envTextureEquirect;
+		Texture envTextureUnfiltered;
+		GLuint timerQueries[NumIBLTimerQueries] = {};
+		double timerQueryCost[NumIBLTimerQueries] = {};
+		std::future<std::shared_ptr<class Image>> pendingEnvironment;
+		std::future<std::shared_ptr<EnvironmentCache::Bake>> pendingBake;
+		std::future<void> bakeWriter;
+		int loadingEnvironment = -1;
+		int loadingBakeEnvironment = -1;
+		int environment = 0;
+		int blendFrames = 0;
+		// Resident pre-filtered maps: m_envTexture & m_irmapTexture alias current slot (-1 target means startup refinement of current slot).
+		EnvironmentCache cache;
+		std::vector<EnvironmentSlot> slots;
+		int currentSlot = 0;
+		int previousSlot = 0;
+		int targetSlot = -1;
+		GLuint readbackBuffer = 0;
+		GLsync readbackFence = nullptr;
+		int readbackEnvironment = -1;
+	} m_ibl;
+
+	// Runtime reflection probes: per-probe views alias 6 layer ranges of specular & irradiance cube map arrays.
+	ProbeScheduler m_probeScheduler;
+	struct {
+		Texture specularTextures;
+		Texture irradianceTextures;
+		std::vector<EnvironmentSlot> views;
+		Texture captureTexture;
+		GLuint captureFramebuffer = 0;
+		GLuint captureDepthTarget = 0;
+		GLuint transformUB = 0;
+		GLuint shadingUB = 0;
+		GLuint irmapProgram = 0;
+		GLuint sampleTableBuffer = 0;
+		int tailLevel = 0;
+		// Environment slot seen by last capture (switching environments invalidates all probes).
+		int environmentSlot = 0;
+	} m_probes;
+
+	// Irradiance volume: SH probes of the whole grid live in a single 3D texture, a batch of probes is captured into
+	// a cube map array & projected each frame.
+	IrradianceVolume m_irradianceVolume;
+	struct {
+		Texture texture;
+		Texture captureTexture;
+		GLuint captureFramebuffer = 0;
+		GLuint captureDepthTarget = 0;
+		GLuint transformUB = 0;
+		GLuint shadingUB = 0;
+		GLuint coordsBuffer = 0;
+		GLuint shprojectProgram = 0;
+		float modelRadius = 0.0f;
+		// Environment slot seen by last capture (switching environments invalidates all probes).
+		int environmentSlot = 0;
+	} m_volume;
+
+	// Octahedral specular atlas: re-converted from current pre-filtered cube map whenever its contents change.
+	struct {
+		Texture texture;
+		GLuint convertProgram = 0;
+		bool dirty = false;
+	} m_atlas;
+
+	// Cascaded shadow maps of analytical lights: all cascades live in layers of a depth texture array (single layer placeholder
+	// if disabled, since pbr_fs always binds it). Render time of each map update is read back once its timer query is available.
+	ShadowCascades m_shadowCascades;
+	struct {
+		Texture texture;
+		GLuint framebuffer = 0;
+		GLuint program = 0;
+		GLuint timerQueries[ShadowCascades::NumMaps] = {};
+		bool pendingQueries[ShadowCascades::NumMaps] = {};
+	} m_shadows;
+
+	// Clustered dynamic lights: light records, froxel grid & light index list are uploaded every frame.
+	ClusteredLights m_clusteredLights;
+	struct {
+		GLuint lightBuffer = 0;
+		GLuint gridBuffer = 0;
+		GLuint indexBuffer = 0;
+		// Scene pass timer query (only while benchmarking).
+		GLuint timerQuery = 0;
+		float modelRadius = 0.0f;
+	} m_lights;
+
+	// Depth pre-pass of the main view (captures always draw skybox first): model's position stream is rendered depth-only,
+	// then shaded with an equal depth test & skybox is drawn last. Benchmark toggles it & times the scene pass.
+	struct {
+		bool enabled = false;
+		GLuint program = 0;
+		// Scene pass timer & fragment shader invocations queries (only while benchmarking).
+		GLuint timerQuery = 0;
+		GLuint statisticsQuery = 0;
+	} m_prepass;
+
+	// Half precision shading: all PBR programs are linked with the fp16 variant of pbr_fs if the driver supports fp16 shader
+	// arithmetic. Benchmark also links the full precision variant, swaps between both & times the scene pass.
+	struct {
+		bool supported = false;
+		GLuint referenceProgram = 0;
+		// Scene pass timer query (only while benchmarking).
+		GLuint timerQuery = 0;
+	} m_halfPrecision;
+
+	// Temporal anti-aliasing: resolve program reads one history texture & writes the other, tone mapping samples the latter.
+	// GPU time of scene & anti-aliasing passes is measured with double buffered timestamp queries (only if it is reported
+	// or drives dynamic resolution).
+	TemporalAA m_temporalAA;
+	struct {
+		GLuint program = 0;
+		GLuint uniformBuffer = 0;
+		Texture history[2];
+		GLuint timestampQueries[2][2] = {};
+		bool pendingQueries[2] = {};
+		int frame = 0;
+	} m_taa;
+
+	// Dynamic resolution: scene is drawn into a scaled viewport of the offscreen framebuffer (recreated whenever number of samples
+	// changes) & tone mapping upscales it.
+	DynamicResolution m_dynamicResolution;
+
+	// Automatic exposure: histogram & adaptation programs write the exposure buffer read by tone mapping (which always exists
+	// & holds fixed exposure of 1.0 otherwise). GPU time of both passes is measured with double buffered timer queries.
+	AutoExposure m_autoExposure;
+	struct {
+		GLuint histogramProgram = 0;
+		GLuint exposureProgram = 0;
+		GLuint histogramBuffer = 0;
+		GLuint exposureBuffer = 0;
+		GLuint parameterBuffer = 0;
+		GLuint timerQueries[2] = {};
+		bool pendingQueries[2] = {};
+	} m_exposure;
 };
 
 } // OpenGL
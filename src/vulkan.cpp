@@ -8,7 +8,10 @@
 #if defined(ENABLE_VULKAN)
 
 #include <stdexcept>
+#include <cstddef>
+#include <chrono>
 #include <algorithm>
+#include <limits>
 #include <array>
 #include <vector>
 #include <map>
@@ -17,11 +20,19 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/euler_angles.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include "vulkan.hpp"
 #include "common/mesh.hpp"
 #include "common/image.hpp"
+#include "common/envsampling.hpp"
+#include "common/iblbench.hpp"
+#include "common/lightbench.hpp"
+#include "common/prepassbench.hpp"
+#include "common/fp16bench.hpp"
 #include "common/utils.hpp"
+#include "common/profiler.hpp"
+#include "common/startup.hpp"
 
 #include <GLFW/glfw3.h>
 
@@ -40,19 +51,129 @@ struct TransformUniforms
 struct ShadingUniforms
 {
 	struct {
-		glm::vec4 direction;
+		glm::vec3 direction;
+		int32_t shadowMap;
 		glm::vec4 radiance;
 	} lights[SceneSettings::NumLights];
-	glm::vec4 eyePosition;
+	glm::vec3 eyePosition;
+	float environmentBlend;
+	glm::vec4 probes[ProbeScheduler::MaxProbes];
+	uint32_t numProbes;
+	uint32_t numLights;
+	uint32_t padding[2];
+	glm::vec4 volumeBounds;
+	glm::vec4 volumeInvExtent;
+	glm::vec4 clusterDepth;
+	glm::vec4 clusterSlices;
+	glm::uvec4 clusterGrid;
+	glm::mat4 shadowMatrices[ShadowCascades::NumMaps];
+	glm::vec4 shadowNormalOffsets[SceneSettings::NumLights];
 };
 
+// Maximum specular pre-filter sample count & uniform irradiance sample count.
+static constexpr uint32_t kSpecularSamples = 1024;
+static constexpr uint32_t kIrradianceSamples = 64 * 1024;
+// Irradiance sample pairs (cosine lobe & environment distribution) taken with environment importance sampling.
+static constexpr uint32_t kIrradianceMISSamples = 2 * 1024;
+
+// Specular pre-filter processes each level in square thread groups (of tuned size, see WorkgroupTuner), mip tail levels
+// smaller than that are folded into a single dispatch of 1D thread groups.
+static constexpr uint32_t kSpecularMipTailGroupSize = 64;
+
+// Split-sum BRDF LUT sample count (must match default NumSamples in spbrdf_cs shader).
+static constexpr uint32_t kSpecularBRDFSamples = 1024;
+
+// Number of sample batches used for progressive irradiance map refinement & its initial approximation.
+static constexpr uint32_t kIrradianceBatches = 16;
+static constexpr uint32_t kIrradianceApproxBatches = 64;
+
+// Depth range of main view projection (also spanned by clustered light froxels).
+static constexpr float kViewZNear = 1.0f;
+static constexpr float kViewZFar = 1000.0f;
+
+// Scene color formats (names as given by -hdr-format), ordered from most compact to widest (fallback order).
+static const struct {
+	const char* name;
+	VkFormat format;
+} kHDRFormats[] = {
+	{ "rgb9e5",     VK_FORMAT_E5B9G9R9_UFLOAT_PACK32 },
+	{ "r11g11b10f", VK_FORMAT_B10G11R11_UFLOAT_PACK32 },
+	{ "rgba16f",    VK_FORMAT_R16G16B16A16_SFLOAT },
+};
+static constexpr int kNumHDRFormats = sizeof(kHDRFormats) / sizeof(kHDRFormats[0]);
+
+// Slope scaled & constant depth bias of shadow map rendering.
+static constexpr float kShadowSlopeBias = 2.0f;
+static constexpr float kShadowConstantBias = 4.0f;
+
+// Reflection probe captures change often so their irradiance is computed with plain uniform hemisphere sampling in a single
+// dispatch (without building an environment distribution). Probe irradiance map fits a single default size irmap_cs thread group per face.
+static constexpr uint32_t kProbeIrradianceSamples = 4 * 1024;
+static constexpr uint32_t kProbeIrradianceMapSize = 32;
+
+// Irradiance volume probes baked per frame & their capture cube map face size (SH projection only needs low frequencies).
+static constexpr uint32_t kVolumeBatchSize = 8;
+static constexpr uint32_t kVolumeCaptureSize = 32;
+
+// Number of frames between queries of driver reported memory usage & budget (VK_EXT_memory_budget).
+static constexpr uint32_t kMemoryBudgetQueryInterval = 64;
+
 struct SpecularFilterPushConstants
 {
 	uint32_t level;
 	float roughness;
+	uint32_t face;
+	uint32_t row;
+	float deltaRoughness;
+};
+
+struct SpecularFilterSpecialization
+{
+	uint32_t numMipLevels;
+	uint32_t maxNumSamples;
+	float sampleErrorTarget;
+	VkBool32 foldedMipTail;
+	uint32_t localSizeX;
+	uint32_t localSizeY;
+	VkBool32 useSampleTable;
+};
+
+struct IrradianceFilterSpecialization
+{
+	uint32_t numSamples;
+	VkBool32 envImportanceSampling;
+	uint32_t localSizeX;
+	uint32_t localSizeY;
+};
+
+struct EquirectToCubeSpecialization
+{
+	uint32_t localSizeX;
+	uint32_t localSizeY;
+};
+
+struct SpecularBRDFSpecialization
+{
+	uint32_t numSamples;
+	uint32_t localSizeX;
+	uint32_t localSizeY;
+};
+
+// Environment map lookups per irradiance map texel (used for cost & source LOD estimates).
+static uint32_t irradianceLookups(const RendererSettings& settings)
+{
+	return settings.iblEnvImportanceSampling ? 2 * kIrradianceMISSamples : kIrradianceSamples;
+}
+
+struct IrradianceFilterPushConstants
+{
+	uint32_t face;
+	uint32_t batch;
+	uint32_t numBatches;
+	float sourceLod;
 };
 
-GLFWwindow* Renderer::initialize(int width, int height, int maxSamples)
+GLFWwindow* Renderer::initialize(int width, int height, int maxSamples, const RendererSettings& settings)
 {
 	if(VKFAILED(volkInitialize())) {
 		throw std::runtime_error("Vulkan loader has not been found");
@@ -69,6 +190,23 @@ GLFWwindow* Renderer::initialize(int width, int height, int maxSamples)
 			instanceExtensions = std::vector<const char*>{glfwRequiredExtensions, glfwRequiredExtensions + glfwNumRequiredExtensions};
 		}
 
+		// Extended physical device queries (optional, needed to find out if optional features such as half precision shading are supported).
+		m_physicalDeviceProperties2 = false;
+		{
+			uint32_t numInstanceExtensions = 0;
+			vkEnumerateInstanceExtensionProperties(nullptr, &numInstanceExtensions, nullptr);
+			std::vector<VkExtensionProperties> supportedInstanceExtensions(numInstanceExtensions);
+			if(numInstanceExtensions > 0) {
+				vkEnumerateInstanceExtensionProperties(nullptr, &numInstanceExtensions, &supportedInstanceExtensions[0]);
+			}
+			for(const VkExtensionProperties& extension : supportedInstanceExtensions) {
+				if(std::strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+					instanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+					m_physicalDeviceProperties2 = true;
+				}
+			}
+		}
+
 #if _DEBUG
 		instanceLayers.push_back("VK_LAYER_LUNARG_standard_validation");
 		instanceExtensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
@@ -123,10 +261,36 @@ GLFWwindow* Renderer::initialize(int width, int height, int maxSamples)
 	VkPhysicalDeviceFeatures requiredDeviceFeatures = {};
 	requiredDeviceFeatures.shaderStorageImageExtendedFormats = VK_TRUE;
 	requiredDeviceFeatures.samplerAnisotropy = VK_TRUE;
+	requiredDeviceFeatures.imageCubeArray = VK_TRUE;
 
 	m_phyDevice = choosePhyDevice(m_surface, requiredDeviceFeatures, requiredDeviceExtensions);
 	queryPhyDeviceSurfaceCapabilities(m_phyDevice, m_surface);
 
+	// Depth pre-pass benchmark counts fragment shader invocations (optional, benchmark fails without it).
+	if(settings.benchmark == BenchmarkKind::DepthPrepass) {
+		requiredDeviceFeatures.pipelineStatisticsQuery = m_phyDevice.features.pipelineStatisticsQuery;
+	}
+
+	// Half precision shading (optional, full precision pbr_fs module is used without it).
+	std::vector<const char*> deviceExtensions = requiredDeviceExtensions;
+	VkPhysicalDeviceFloat16Int8FeaturesKHR float16Features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FLOAT16_INT8_FEATURES_KHR };
+	if((settings.halfPrecision || settings.benchmark == BenchmarkKind::HalfPrecision) && m_physicalDeviceProperties2 && isExtensionSupported(m_phyDevice, VK_KHR_SHADER_FLOAT16_INT8_EXTENSION_NAME)) {
+		VkPhysicalDeviceFeatures2KHR features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR };
+		features.pNext = &float16Features;
+		vkGetPhysicalDeviceFeatures2KHR(m_phyDevice.handle, &features);
+		float16Features.shaderInt8 = VK_FALSE;
+		if(float16Features.shaderFloat16) {
+			deviceExtensions.push_back(VK_KHR_SHADER_FLOAT16_INT8_EXTENSION_NAME);
+		}
+	}
+	m_halfPrecision.supported = (float16Features.shaderFloat16 == VK_TRUE);
+
+	// Driver reported memory usage & budget per heap (optional, only allocations tracked by MemoryStats are reported without it).
+	m_memoryBudgetSupported = m_physicalDeviceProperties2 && isExtensionSupported(m_phyDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	if(m_memoryBudgetSupported) {
+		deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+
 	// Create logical device
 	{
 		float queuePriority = 1.0f;
@@ -136,11 +300,12 @@ GLFWwindow* Renderer::initialize(int width, int height, int maxSamples)
 		queueCreateInfo.pQueuePriorities = &queuePriority;
 		
 		VkDeviceCreateInfo createInfo = { VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
+		createInfo.pNext = m_halfPrecision.supported ? &float16Features : nullptr;
 		createInfo.queueCreateInfoCount = 1;
 		createInfo.pQueueCreateInfos = &queueCreateInfo;
 		createInfo.pEnabledFeatures = &requiredDeviceFeatures;
-		createInfo.enabledExtensionCount = (uint32_t)requiredDeviceExtensions.size();
-		createInfo.ppEnabledExtensionNames = &requiredDeviceExtensions[0];
+		createInfo.enabledExtensionCount = (uint32_t)deviceExtensions.size();
+		createInfo.ppEnabledExtensionNames = &deviceExtensions[0];
 		if(VKFAILED(vkCreateDevice(m_phyDevice.handle, &createInfo, nullptr, &m_device))) {
 			throw std::runtime_error("Failed to create Vulkan logical device");
 		}
@@ -149,6 +314,18 @@ GLFWwindow* Renderer::initialize(int width, int height, int maxSamples)
 		vkGetDeviceQueue(m_device, m_phyDevice.queueFamilyIndex, 0, &m_queue);
 	}
 
+	// Account device memory allocations per Vulkan memory heap.
+	m_memoryStats.reset(uint64_t(double(settings.memoryBudget) * 1024.0 * 1024.0));
+	for(uint32_t i=0; i<m_phyDevice.memory.memoryHeapCount; ++i) {
+		const VkMemoryHeap& heap = m_phyDevice.memory.memoryHeaps[i];
+		const bool deviceLocal = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		m_memoryStats.addHeap((deviceLocal ? "device local " : "host ") + std::to_string(i), heap.size, deviceLocal);
+	}
+	m_memoryReportRequest = 0;
+	updateMemoryBudget();
+
+	StartupReport::beginPhase("initialize: swapchain & render targets");
+
 	// Create swap chain
 	{
 		uint32_t selectedMinImageCount = 2;
@@ -207,23 +384,50 @@ GLFWwindow* Renderer::initialize(int width, int height, int maxSamples)
 
 	// Create render targets
 	{
-		const VkFormat colorFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
 		const VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
 
-		const uint32_t maxColorSamples = queryRenderTargetFormatMaxSamples(colorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
-		const uint32_t maxDepthSamples = queryRenderTargetFormatMaxSamples(depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+		// Temporal anti-aliasing samples resolved color & (possibly multisampled) depth, tone mapping samples color to upscale it
+		// with dynamic resolution & automatic exposure builds its histogram from resolved color.
+		const VkImageUsageFlags sampledUsage = (settings.temporalAA || settings.frameTimeBudget > 0.0f || settings.autoExposure) ? VK_IMAGE_USAGE_SAMPLED_BIT : 0;
+		// Half precision benchmark copies resolved scene color to host memory.
+		const VkImageUsageFlags readbackUsage = (settings.benchmark == BenchmarkKind::HalfPrecision) ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0;
+
+		const uint32_t maxColorSamples = queryRenderTargetFormatMaxSamples(VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+		const uint32_t maxDepthSamples = queryRenderTargetFormatMaxSamples(depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | sampledUsage);
 
 		m_renderSamples = std::min({uint32_t(maxSamples), maxColorSamples, maxDepthSamples});
 		assert(m_renderSamples >= 1);
 
+		// Scene color format: requested one (RGBA16F by default) unless it is not renderable with as many samples as RGBA16F
+		// (or as single sample tone mapping input), then the next wider one (RGBA16F support is checked when choosing device).
+		int hdrFormat = kNumHDRFormats - 1;
+		for(int i=0; i<kNumHDRFormats; ++i) {
+			if(settings.hdrFormat == kHDRFormats[i].name) {
+				hdrFormat = i;
+			}
+		}
+		for(; hdrFormat < kNumHDRFormats - 1; ++hdrFormat) {
+			const VkFormat format = kHDRFormats[hdrFormat].format;
+			const uint32_t maxFormatSamples = queryRenderTargetFormatMaxSamples(format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | sampledUsage);
+			const bool inputAttachment = queryRenderTargetFormatMaxSamples(format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | sampledUsage) > 0;
+			if(maxFormatSamples >= m_renderSamples && inputAttachment) {
+				break;
+			}
+			std::fprintf(stderr, "Scene color format %s is not renderable with %ux MSAA, falling back to %s\n",
+				kHDRFormats[hdrFormat].name, m_renderSamples, kHDRFormats[hdrFormat + 1].name);
+		}
+		const VkFormat colorFormat = kHDRFormats[hdrFormat].format;
+
 		m_renderTargets.resize(m_numFrames);
 		m_resolveRenderTargets.resize(m_numFrames);
 		for(uint32_t i=0; i<m_numFrames; ++i) {
-			m_renderTargets[i] = createRenderTarget(width, height, m_renderSamples, colorFormat, depthFormat);
+			m_renderTargets[i] = createRenderTarget(width, height, m_renderSamples, colorFormat, depthFormat, sampledUsage | readbackUsage);
 			if(m_renderSamples > 1) {
-				m_resolveRenderTargets[i] = createRenderTarget(width, height, 1, colorFormat, VK_FORMAT_UNDEFINED);
+				m_resolveRenderTargets[i] = createRenderTarget(width, height, 1, colorFormat, VK_FORMAT_UNDEFINED, sampledUsage | readbackUsage);
 			}
 		}
+		m_temporalAA.reset(width, height, true);
+		m_dynamicResolution.reset(settings.frameTimeBudget, int(m_renderSamples), false);
 	}
 
 	// Create command pool & allocate command buffers
@@ -244,6 +448,15 @@ GLFWwindow* Renderer::initialize(int width, int height, int maxSamples)
 			throw std::runtime_error("Failed to allocate command buffer");
 		}
 	}
+	m_immediateQueryPool = VK_NULL_HANDLE;
+	if(m_phyDevice.properties.limits.timestampComputeAndGraphics) {
+		VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		createInfo.queryCount = 2;
+		if(VKFAILED(vkCreateQueryPool(m_device, &createInfo, nullptr, &m_immediateQueryPool))) {
+			throw std::runtime_error("Failed to create timestamp query pool");
+		}
+	}
 
 	// Create fences
 	m_submitFences.resize(m_numFrames);
@@ -270,14 +483,16 @@ GLFWwindow* Renderer::initialize(int width, int height, int maxSamples)
 
 	// Create descriptor pool
 	{
-		const std::array<VkDescriptorPoolSize, 3> poolSizes = {{
-			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 16 },
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 16 },
+		const std::array<VkDescriptorPoolSize, 5> poolSizes = {{
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 128 },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 24 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 40 },
 			{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 16 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 16 },
 		}};
 
 		VkDescriptorPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
-		createInfo.maxSets = 16;
+		createInfo.maxSets = 56;
 		createInfo.poolSizeCount = (uint32_t)poolSizes.size();
 		createInfo.pPoolSizes = poolSizes.data();
 		if(VKFAILED(vkCreateDescriptorPool(m_device, &createInfo, nullptr, &m_descriptorPool))) {
@@ -287,6 +502,7 @@ GLFWwindow* Renderer::initialize(int width, int height, int maxSamples)
 
 	m_frameRect  = { 0, 0, (uint32_t)width, (uint32_t)height };
 	m_frameCount = 0;
+	m_settings   = settings;
 
 	std::printf("Vulkan 1.0 Renderer [%s]\n", m_phyDevice.properties.deviceName);
 	return window;
@@ -295,11 +511,145 @@ GLFWwindow* Renderer::initialize(int width, int height, int maxSamples)
 void Renderer::shutdown()
 {
 	vkDeviceWaitIdle(m_device);
+
+	updateMemoryBudget();
+	m_memoryStats.report(std::string("Vulkan, ") + m_phyDevice.properties.deviceName);
 	
-	destroyTexture(m_envTexture);
-	destroyTexture(m_irmapTexture);
+	releaseIBLResources();
+	for(EnvironmentSlot& slot : m_ibl.slots) {
+		if(slot.envTexture.image.resource != VK_NULL_HANDLE) {
+			destroyTexture(slot.envTexture);
+			destroyTexture(slot.irmapTexture);
+		}
+	}
+	for(auto& stagingBuffer : m_ibl.stagingBuffers) {
+		destroyBuffer(stagingBuffer.first);
+	}
+	if(m_ibl.readbackBuffer.resource != VK_NULL_HANDLE) {
+		destroyBuffer(m_ibl.readbackBuffer);
+	}
+
+	if(m_ibl.slots.empty()) {
+		destroyTexture(m_envTexture);
+		destroyTexture(m_irmapTexture);
+	}
 	destroyTexture(m_spBRDF_LUT);
 
+	for(VkImageView view : m_probes.layerViews) {
+		vkDestroyImageView(m_device, view, nullptr);
+	}
+	for(VkImageView view : m_probes.captureFaceViews) {
+		vkDestroyImageView(m_device, view, nullptr);
+	}
+	for(VkFramebuffer framebuffer : m_probes.captureFramebuffers) {
+		vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+	}
+	destroyTexture(m_probes.specularTextures);
+	destroyTexture(m_probes.irradianceTextures);
+	if(m_probes.captureTexture.image.resource != VK_NULL_HANDLE) {
+		destroyTexture(m_probes.captureTexture);
+		destroyRenderTarget(m_probes.captureDepthTarget);
+	}
+	destroyBuffer(m_probes.sampleTableBuffer);
+	vkDestroyPipeline(m_device, m_probes.irmapPipeline, nullptr);
+	vkDestroyPipeline(m_device, m_probes.captureSkyboxPipeline, nullptr);
+	vkDestroyPipeline(m_device, m_probes.capturePbrPipeline, nullptr);
+	vkDestroyRenderPass(m_device, m_probes.captureRenderPass, nullptr);
+	vkDestroyDescriptorPool(m_device, m_probes.descriptorPool, nullptr);
+
+	destroyTexture(m_volume.texture);
+	for(VkImageView view : m_volume.captureLayerViews) {
+		vkDestroyImageView(m_device, view, nullptr);
+	}
+	for(VkFramebuffer framebuffer : m_volume.captureFramebuffers) {
+		vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+	}
+	if(m_volume.captureTexture.image.resource != VK_NULL_HANDLE) {
+		destroyTexture(m_volume.captureTexture);
+		destroyRenderTarget(m_volume.captureDepthTarget);
+		destroyUniformBuffer(m_volume.uniformBuffer);
+		vkUnmapMemory(m_device, m_volume.coordsBuffer.memory);
+		destroyBuffer(m_volume.coordsBuffer);
+	}
+	vkDestroyPipeline(m_device, m_volume.shprojectPipeline, nullptr);
+	vkDestroyPipeline(m_device, m_volume.captureSkyboxPipeline, nullptr);
+	vkDestroyPipeline(m_device, m_volume.capturePbrPipeline, nullptr);
+	vkDestroyRenderPass(m_device, m_volume.captureRenderPass, nullptr);
+	vkDestroyDescriptorPool(m_device, m_volume.descriptorPool, nullptr);
+
+	vkUnmapMemory(m_device, m_lights.buffer.memory);
+	destroyBuffer(m_lights.buffer);
+
+	if(m_settings.shadows) {
+		m_shadowCascades.report();
+	}
+	if(m_dynamicResolution.enabled()) {
+		m_dynamicResolution.report();
+	}
+	for(VkFramebuffer framebuffer : m_shadows.framebuffers) {
+		vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+	}
+	for(VkImageView view : m_shadows.layerViews) {
+		vkDestroyImageView(m_device, view, nullptr);
+	}
+	destroyTexture(m_shadows.texture);
+	vkDestroySampler(m_device, m_shadows.sampler, nullptr);
+	vkDestroyPipeline(m_device, m_shadows.pipeline, nullptr);
+	vkDestroyPipelineLayout(m_device, m_shadows.pipelineLayout, nullptr);
+	vkDestroyRenderPass(m_device, m_shadows.renderPass, nullptr);
+	vkDestroyQueryPool(m_device, m_shadows.timestampQueryPool, nullptr);
+
+	vkDestroyPipeline(m_device, m_prepass.depthPipeline, nullptr);
+	vkDestroyPipeline(m_device, m_prepass.pbrPipeline, nullptr);
+	vkDestroyPipeline(m_device, m_prepass.skyboxPipeline, nullptr);
+	vkDestroyPipeline(m_device, m_halfPrecision.referencePipeline, nullptr);
+
+	// Anti-aliasing cost is reported if either mode or scene color format was requested explicitly (so that they can be compared).
+	if(m_settings.temporalAA || m_settings.msaaSamples > 0 || !m_settings.hdrFormat.empty()) {
+		int hdrFormat = kNumHDRFormats - 1;
+		while(kHDRFormats[hdrFormat].format != m_renderTargets[0].colorFormat) {
+			--hdrFormat;
+		}
+		VkDeviceSize renderTargetBytes = m_taa.history[0].image.allocationSize + m_taa.history[1].image.allocationSize + m_taa.depthTexture.image.allocationSize;
+		for(uint32_t i=0; i<m_numFrames; ++i) {
+			renderTargetBytes += m_renderTargets[i].colorImage.allocationSize + m_renderTargets[i].depthImage.allocationSize;
+			renderTargetBytes += m_resolveRenderTargets[i].colorImage.allocationSize;
+		}
+		m_temporalAA.report("vulkan", m_phyDevice.properties.deviceName, m_settings.temporalAA, m_renderSamples, kHDRFormats[hdrFormat].name, renderTargetBytes);
+	}
+	if(m_settings.temporalAA) {
+		destroyTexture(m_taa.history[0]);
+		destroyTexture(m_taa.history[1]);
+		if(m_renderSamples > 1) {
+			destroyTexture(m_taa.depthTexture);
+		}
+		for(VkFramebuffer framebuffer : m_taa.tonemapFramebuffers) {
+			vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+		}
+	}
+	vkDestroyRenderPass(m_device, m_taa.tonemapRenderPass, nullptr);
+	vkDestroyPipeline(m_device, m_taa.pipeline, nullptr);
+	vkDestroyPipelineLayout(m_device, m_taa.pipelineLayout, nullptr);
+	vkDestroyPipeline(m_device, m_taa.depthResolvePipeline, nullptr);
+	vkDestroyPipelineLayout(m_device, m_taa.depthResolvePipelineLayout, nullptr);
+	vkDestroyQueryPool(m_device, m_taa.timestampQueryPool, nullptr);
+
+	if(m_settings.autoExposure) {
+		m_autoExposure.report();
+	}
+	destroyBuffer(m_exposure.histogramBuffer);
+	destroyBuffer(m_exposure.exposureBuffer);
+	vkDestroyPipeline(m_device, m_exposure.histogramPipeline, nullptr);
+	vkDestroyPipeline(m_device, m_exposure.exposurePipeline, nullptr);
+	vkDestroyPipelineLayout(m_device, m_exposure.pipelineLayout, nullptr);
+	vkDestroyQueryPool(m_device, m_exposure.timestampQueryPool, nullptr);
+
+	destroyTexture(m_atlas.texture);
+	vkDestroyPipeline(m_device, m_atlas.convertPipeline, nullptr);
+	vkDestroyPipelineLayout(m_device, m_atlas.pipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, m_atlas.setLayout, nullptr);
+	vkDestroyDescriptorPool(m_device, m_atlas.descriptorPool, nullptr);
+
 	destroyMeshBuffer(m_skybox);
 
 	destroyMeshBuffer(m_pbrModel);
@@ -335,6 +685,7 @@ void Renderer::shutdown()
 
 	vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
 	vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+	vkDestroyQueryPool(m_device, m_immediateQueryPool, nullptr);
 	vkDestroyFence(m_device, m_presentationFence, nullptr);
 	vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
 	vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
@@ -356,6 +707,17 @@ void Renderer::setup()
 	static constexpr uint32_t kEnvMapLevels = Utility::numMipmapLevels(kEnvMapSize, kEnvMapSize);
 	static constexpr VkDeviceSize kUniformBufferSize = 64 * 1024;
 
+	// IBL compute kernel thread group sizes are either cached for this device & driver or tuned as the kernels run below
+	// (tuning needs timestamp queries, defaults are used without them).
+	{
+		const VkPhysicalDeviceProperties& properties = m_phyDevice.properties;
+		const std::string deviceKey = std::string("Vulkan|") + properties.deviceName
+			+ "|" + std::to_string(properties.vendorID) + ":" + std::to_string(properties.deviceID)
+			+ "|" + std::to_string(properties.driverVersion);
+		const bool autotune = m_settings.autotuneWorkgroups && properties.limits.timestampComputeAndGraphics;
+		m_workgroups.reset(deviceKey, autotune, m_settings.retuneWorkgroups);
+	}
+
 	// Common descriptor set layouts
 	struct {
 		VkDescriptorSetLayout uniforms;
@@ -367,8 +729,11 @@ void Renderer::setup()
 
 	// Friendly binding names for per-frame uniform blocks
 	enum UniformsDescriptorSetBindingNames : uint32_t {
-		Binding_TransformUniforms = 0,
-		Binding_ShadingUniforms   = 1,
+		Binding_TransformUniforms   = 0,
+		Binding_ShadingUniforms     = 1,
+		Binding_DynamicLights       = 2,
+		Binding_ClusterGrid         = 3,
+		Binding_ClusterLightIndices = 4,
 	};
 
 	// Friendly binding names for compute pipeline descriptor set
@@ -376,8 +741,23 @@ void Renderer::setup()
 		Binding_InputTexture  = 0,
 		Binding_OutputTexture = 1,
 		Binding_OutputMipTail = 2,
+		Binding_SampleTable   = 3,
+		Binding_Distribution  = 4,
 	};
 
+	// Pre-processing resources are kept alive if pre-filtering continues after setup (progressive mode, environment switching,
+	// reflection probes, which are pre-filtered with the same specular pipelines, or irradiance volume, which shares pipeline layout).
+	const bool dynamicEnvironment = m_settings.environments.size() > 1;
+	const bool reflectionProbes = !m_settings.reflectionProbes.empty();
+	const bool irradianceVolume = m_settings.irradianceVolume.x > 0;
+	const bool keepIBLResources = m_settings.progressiveIBL || dynamicEnvironment || reflectionProbes || irradianceVolume;
+
+	// Skybox fragment shader samples current environment from octahedral atlas if enabled (specialization constant 0, which
+	// PBR fragment shader shares as the first feature of its permutation).
+	const VkBool32 octahedralAtlas = m_settings.iblOctahedralAtlas ? VK_TRUE : VK_FALSE;
+	const VkSpecializationMapEntry environmentSpecializationMap = { 0, 0, sizeof(VkBool32) };
+	const VkSpecializationInfo environmentSpecializationInfo = { 1, &environmentSpecializationMap, sizeof(VkBool32), &octahedralAtlas };
+
 	// Create host-mapped uniform buffer for sub-allocation of uniform block ranges.
 	m_uniformBuffer = createUniformBuffer(kUniformBufferSize);
 
@@ -416,9 +796,11 @@ void Renderer::setup()
 	// Create temporary descriptor pool for pre-processing compute shaders.
 	VkDescriptorPool computeDescriptorPool;
 	{
-		const std::array<VkDescriptorPoolSize, 2> poolSizes = {{
-			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 },
-			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, kEnvMapLevels },
+		// Second set is used for environment map conversion when switching environments.
+		const std::array<VkDescriptorPoolSize, 3> poolSizes = {{
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, kEnvMapLevels + 1 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
 		}};
 
 		VkDescriptorPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
@@ -439,16 +821,21 @@ void Renderer::setup()
 			{ Binding_InputTexture, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, &computeSampler },
 			{ Binding_OutputTexture, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
 			{ Binding_OutputMipTail, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, kEnvMapLevels-1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+			{ Binding_SampleTable, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+			{ Binding_Distribution, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
 		};
 
 		setLayout.compute = createDescriptorSetLayout(&descriptorSetLayoutBindings);
 		computeDescriptorSet = allocateDescriptorSet(computeDescriptorPool, setLayout.compute);
+		if(dynamicEnvironment) {
+			m_ibl.convertDescriptorSet = allocateDescriptorSet(computeDescriptorPool, setLayout.compute);
+		}
 
 		const std::vector<VkDescriptorSetLayout> pipelineSetLayouts = {
 			setLayout.compute,
 		};
 		const std::vector<VkPushConstantRange> pipelinePushConstantRanges = {
-			{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SpecularFilterPushConstants) },
+			{ VK_SHADER_STAGE_COMPUTE_BIT, 0, (uint32_t)std::max(sizeof(SpecularFilterPushConstants), sizeof(IrradianceFilterPushConstants)) },
 		};
 		computePipelineLayout = createPipelineLayout(&pipelineSetLayouts, &pipelinePushConstantRanges);
 	}
@@ -456,12 +843,49 @@ void Renderer::setup()
 	// Create descriptor set layout for per-frame shader uniforms
 	{
 		const std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings = {
-			{ Binding_TransformUniforms, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT,   nullptr },
-			{ Binding_ShadingUniforms,   VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+			{ Binding_TransformUniforms,   VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT,   nullptr },
+			{ Binding_ShadingUniforms,     VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+			{ Binding_DynamicLights,       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+			{ Binding_ClusterGrid,         VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+			{ Binding_ClusterLightIndices, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
 		};
 		setLayout.uniforms = createDescriptorSetLayout(&descriptorSetLayoutBindings);
 	}
 
+	// Create per-frame ranges of dynamic light buffer: light records, froxel grid & light index list, each aligned for
+	// use as a separate storage buffer. Full capacity is only reserved if there are going to be any lights to shade.
+	{
+		const bool enabled = m_settings.numDynamicLights > 0 || m_settings.benchmark == BenchmarkKind::Lights;
+		const VkDeviceSize numClusters = ClusteredLights::numClusters(m_frameRect.extent.width, m_frameRect.extent.height);
+		const VkDeviceSize minAlignment = m_phyDevice.properties.limits.minStorageBufferOffsetAlignment;
+		auto alignedSize = [minAlignment](VkDeviceSize size) {
+			return ((size + minAlignment - 1) / minAlignment) * minAlignment;
+		};
+
+		m_lights.lightsSize  = (enabled ? ClusteredLights::MaxLights : 1) * sizeof(ClusteredLights::Light);
+		m_lights.gridSize    = (enabled ? numClusters : 1) * sizeof(glm::uvec2);
+		m_lights.indexSize   = (enabled ? ClusteredLights::MaxLightIndices : 1) * sizeof(uint32_t);
+		m_lights.gridOffset  = alignedSize(m_lights.lightsSize);
+		m_lights.indexOffset = m_lights.gridOffset + alignedSize(m_lights.gridSize);
+		m_lights.stride      = m_lights.indexOffset + alignedSize(m_lights.indexSize);
+
+		m_lights.buffer = createBuffer(m_numFrames * m_lights.stride, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Uniform);
+		if(VKFAILED(vkMapMemory(m_device, m_lights.buffer.memory, 0, VK_WHOLE_SIZE, 0, &m_lights.memoryPtr))) {
+			throw std::runtime_error("Failed to map dynamic light buffer memory to host address space");
+		}
+	}
+
+	// Point storage buffer bindings of a uniforms descriptor set at given frame's range of dynamic light buffer.
+	auto updateDynamicLightDescriptors = [this](VkDescriptorSet descriptorSet, uint32_t frame) {
+		const VkDeviceSize offset = frame * m_lights.stride;
+		const VkDescriptorBufferInfo lightsDescriptor = { m_lights.buffer.resource, offset, m_lights.lightsSize };
+		const VkDescriptorBufferInfo gridDescriptor = { m_lights.buffer.resource, offset + m_lights.gridOffset, m_lights.gridSize };
+		const VkDescriptorBufferInfo indexDescriptor = { m_lights.buffer.resource, offset + m_lights.indexOffset, m_lights.indexSize };
+		updateDescriptorSet(descriptorSet, Binding_DynamicLights, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { lightsDescriptor });
+		updateDescriptorSet(descriptorSet, Binding_ClusterGrid, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { gridDescriptor });
+		updateDescriptorSet(descriptorSet, Binding_ClusterLightIndices, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { indexDescriptor });
+	};
+
 	// Allocate & update per-frame uniform buffer descriptor sets
 	{
 		m_uniformsDescriptorSets.resize(m_numFrames);
@@ -474,202 +898,229 @@ void Renderer::setup()
 
 			m_shadingUniforms.push_back(allocFromUniformBuffer<ShadingUniforms>(m_uniformBuffer));
 			updateDescriptorSet(m_uniformsDescriptorSets[i], Binding_ShadingUniforms, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, { m_shadingUniforms[i].descriptorInfo });
+			updateDynamicLightDescriptors(m_uniformsDescriptorSets[i], i);
 		}
 	}
-	
-	// Create render pass
-	{
-		enum AttachmentName : uint32_t {
-			MainColorAttachment = 0,
-			MainDepthStencilAttachment,
-			SwapchainColorAttachment,
-			ResolveColorAttachment,
-		};
 
-		std::vector<VkAttachmentDescription> attachments = {
-			// Main color attachment (0)
-			{
-				0,
-				m_renderTargets[0].colorFormat,
-				static_cast<VkSampleCountFlagBits>(m_renderSamples),
-				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-				VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-				VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			},
-			// Main depth-stencil attachment (1)
-			{
-				0,
-				m_renderTargets[0].depthFormat,
-				static_cast<VkSampleCountFlagBits>(m_renderSamples),
-				VK_ATTACHMENT_LOAD_OP_CLEAR,
-				VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-				VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-			},
-			// Swapchain color attachment (2)
-			{
-				0,
-				VK_FORMAT_B8G8R8A8_UNORM,
-				VK_SAMPLE_COUNT_1_BIT,
-				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-				VK_ATTACHMENT_STORE_OP_STORE,
-				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-				VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-			},
-		};
-		if(m_renderSamples > 1) {
-			// Resolve color attachment (3)
-			const VkAttachmentDescription resolveAttachment = 
-			{
-				0,
-				m_resolveRenderTargets[0].colorFormat,
-				VK_SAMPLE_COUNT_1_BIT,
-				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-				VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-				VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			};
-			attachments.push_back(resolveAttachment);
-		};
+	// Allocate & update per-frame uniform buffer descriptor sets for reflection probe capture
+	if(reflectionProbes) {
+		m_probes.uniformsDescriptorSets.resize(m_numFrames);
+		for(uint32_t i=0; i<m_numFrames; ++i) {
+			m_probes.uniformsDescriptorSets[i] = allocateDescriptorSet(m_descriptorPool, setLayout.uniforms);
 
-		// Main subpass
-		const std::array<VkAttachmentReference, 1> mainPassColorRefs = {
-			{ MainColorAttachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL }, 
-		};
-		const std::array<VkAttachmentReference, 1> mainPassResolveRefs = {
-			{ ResolveColorAttachment, VK_IMAGE_LAYOUT_GENERAL },
-		};
-		const VkAttachmentReference mainPassDepthStencilRef = {
-			  MainDepthStencilAttachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
-		};
-		VkSubpassDescription mainPass = {};
-		mainPass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		mainPass.colorAttachmentCount = (uint32_t)mainPassColorRefs.size();
-		mainPass.pColorAttachments = mainPassColorRefs.data();
-		mainPass.pDepthStencilAttachment = &mainPassDepthStencilRef;
-		if(m_renderSamples > 1) {
-			mainPass.pResolveAttachments = mainPassResolveRefs.data();
-		}
+			m_probes.transformUniforms.push_back(allocFromUniformBuffer<TransformUniforms>(m_uniformBuffer));
+			updateDescriptorSet(m_probes.uniformsDescriptorSets[i], Binding_TransformUniforms, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, { m_probes.transformUniforms[i].descriptorInfo });
 
-		// Tonemapping subpass
-		const std::array<VkAttachmentReference, 1> tonemapPassInputRefs = {
-			{ MainColorAttachment, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
-		};
-		const std::array<VkAttachmentReference, 1> tonemapPassMultisampleInputRefs = {
-			{ ResolveColorAttachment, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
-		};
-		const std::array<VkAttachmentReference, 1> tonemapPassColorRefs = {
-			{ SwapchainColorAttachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
-		};
-		VkSubpassDescription tonemapPass = {};
-		tonemapPass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		tonemapPass.colorAttachmentCount = (uint32_t)tonemapPassColorRefs.size();
-		tonemapPass.pColorAttachments = tonemapPassColorRefs.data();
-		if(m_renderSamples > 1) {
-			tonemapPass.inputAttachmentCount = (uint32_t)tonemapPassMultisampleInputRefs.size();
-			tonemapPass.pInputAttachments = tonemapPassMultisampleInputRefs.data();
-		}
-		else {
-			tonemapPass.inputAttachmentCount = (uint32_t)tonemapPassInputRefs.size();
-			tonemapPass.pInputAttachments = tonemapPassInputRefs.data();
+			m_probes.shadingUniforms.push_back(allocFromUniformBuffer<ShadingUniforms>(m_uniformBuffer));
+			updateDescriptorSet(m_probes.uniformsDescriptorSets[i], Binding_ShadingUniforms, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, { m_probes.shadingUniforms[i].descriptorInfo });
+			updateDynamicLightDescriptors(m_probes.uniformsDescriptorSets[i], i);
 		}
+	}
 
-		const std::array<VkSubpassDescription, 2> subpasses = {
-			mainPass,
-			tonemapPass,
-		};
+	// Create descriptor pool & allocate uniform buffer descriptor sets for irradiance volume capture: one set per frame & capture face,
+	// shading uniforms are shared by all faces of a probe. These don't fit into common uniform buffer so the volume has its own.
+	if(irradianceVolume) {
+		const uint32_t numCaptures = m_numFrames * kVolumeBatchSize;
+		{
+			const std::array<VkDescriptorPoolSize, 4> poolSizes = {{
+				{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * 6 * numCaptures },
+				{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_numFrames },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_numFrames },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * 6 * numCaptures + m_numFrames },
+			}};
+
+			VkDescriptorPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+			createInfo.maxSets = 6 * numCaptures + m_numFrames;
+			createInfo.poolSizeCount = (uint32_t)poolSizes.size();
+			createInfo.pPoolSizes = poolSizes.data();
+			if(VKFAILED(vkCreateDescriptorPool(m_device, &createInfo, nullptr, &m_volume.descriptorPool))) {
+				throw std::runtime_error("Failed to create irradiance volume descriptor pool");
+			}
+		}
 
-		// Main->Tonemapping dependency
-		const VkSubpassDependency mainToTonemapDependency = {
-			0,
-			1,
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-			VK_ACCESS_SHADER_READ_BIT,
-			VK_DEPENDENCY_BY_REGION_BIT,
-		};
+		const int minAlignment = (int)m_phyDevice.properties.limits.minUniformBufferOffsetAlignment;
+		const VkDeviceSize captureUniformsSize = 6 * Utility::roundToPowerOfTwo(sizeof(TransformUniforms), minAlignment) + Utility::roundToPowerOfTwo(sizeof(ShadingUniforms), minAlignment);
+		m_volume.uniformBuffer = createUniformBuffer(numCaptures * captureUniformsSize);
 
-		VkRenderPassCreateInfo createInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
-		createInfo.attachmentCount = (uint32_t)attachments.size();
-		createInfo.pAttachments = attachments.data();
-		createInfo.subpassCount = (uint32_t)subpasses.size();
-		createInfo.pSubpasses = subpasses.data();
-		createInfo.dependencyCount = 1;
-		createInfo.pDependencies = &mainToTonemapDependency;
+		for(uint32_t capture=0; capture<numCaptures; ++capture) {
+			m_volume.shadingUniforms.push_back(allocFromUniformBuffer<ShadingUniforms>(m_volume.uniformBuffer));
+			for(uint32_t face=0; face<6; ++face) {
+				VkDescriptorSet descriptorSet = allocateDescriptorSet(m_volume.descriptorPool, setLayout.uniforms);
 
-		if(VKFAILED(vkCreateRenderPass(m_device, &createInfo, nullptr, &m_renderPass))) {
-			throw std::runtime_error("Failed to create render pass");
+				m_volume.transformUniforms.push_back(allocFromUniformBuffer<TransformUniforms>(m_volume.uniformBuffer));
+				updateDescriptorSet(descriptorSet, Binding_TransformUniforms, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, { m_volume.transformUniforms.back().descriptorInfo });
+				updateDescriptorSet(descriptorSet, Binding_ShadingUniforms, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, { m_volume.shadingUniforms.back().descriptorInfo });
+				updateDynamicLightDescriptors(descriptorSet, capture / kVolumeBatchSize);
+				m_volume.uniformsDescriptorSets.push_back(descriptorSet);
+			}
 		}
 	}
+	
+	// Create main render pass & framebuffers (tone mapping runs in a separate render pass with temporal anti-aliasing).
+	createMainRenderPass();
+
+	// Create temporal anti-aliasing resources: history textures (both start out readable, so that tone mapping pass & resolve
+	// descriptors always see them in shader read-only layout), resolved depth texture if multisampled, tone mapping render pass
+	// & its framebuffers, resolve pipelines & their per-frame descriptor sets.
+	if(m_settings.temporalAA) {
+		createTAAResources();
+	}
 
-	// Create framebuffers
-	{
-		m_framebuffers.resize(m_numFrames);
-		for(uint32_t i=0; i<m_framebuffers.size(); ++i) {
+	// Create timestamp query pool for anti-aliasing cost (two queries per frame), reported if either mode or scene color format
+	// was requested explicitly. The same frame time drives dynamic resolution.
+	if((m_settings.temporalAA || m_settings.msaaSamples > 0 || !m_settings.hdrFormat.empty() || m_dynamicResolution.enabled()) && m_phyDevice.properties.limits.timestampComputeAndGraphics) {
+		VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		createInfo.queryCount = 2 * m_numFrames;
+		if(VKFAILED(vkCreateQueryPool(m_device, &createInfo, nullptr, &m_taa.timestampQueryPool))) {
+			throw std::runtime_error("Failed to create timestamp query pool");
+		}
+		m_taa.pendingQueries.resize(m_numFrames, false);
+	}
 
-			std::vector<VkImageView> attachments = {
-				m_renderTargets[i].colorView,
-				m_renderTargets[i].depthView,
-				m_swapchainViews[i],
-			};
-			if(m_renderSamples > 1) {
-				attachments.push_back(m_resolveRenderTargets[i].colorView);
-			}
+	// Create exposure buffer (read by tone mapping even with fixed exposure) & automatic exposure pipelines.
+	createExposureResources();
 
-			VkFramebufferCreateInfo createInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
-			createInfo.renderPass = m_renderPass;
-			createInfo.attachmentCount = (uint32_t)attachments.size();
-			createInfo.pAttachments = attachments.data();
-			createInfo.width  = m_frameRect.extent.width;
-			createInfo.height = m_frameRect.extent.height;
-			createInfo.layers = 1;
-			
-			if(VKFAILED(vkCreateFramebuffer(m_device, &createInfo, nullptr, &m_framebuffers[i]))) {
-				throw std::runtime_error("Failed to create framebuffer");
-			}
-		}
+	// Create render pass & per-face framebuffers for reflection probe capture.
+	// Captured face is left in transfer source layout for mipmap generation & copy into probe's maps.
+	VkRect2D captureRect = {};
+	if(reflectionProbes) {
+		captureRect.extent = { m_settings.reflectionProbeSize, m_settings.reflectionProbeSize };
+		createReflectionProbeCaptureResources();
 	}
 	
+	// Create render pass & per-layer framebuffers for irradiance volume capture.
+	// Captured layers are left in shader read only layout for SH projection (whole capture texture starts out in that layout).
+	const VkRect2D volumeCaptureRect = { { 0, 0 }, { kVolumeCaptureSize, kVolumeCaptureSize } };
+	if(irradianceVolume) {
+		createIrradianceVolumeCaptureResources();
+	}
+
+	// Create shadow map array & comparison sampler, with shadows enabled also their render pass, framebuffers & pipeline.
+	createShadowResources();
+
 	// Allocate common textures for later processing.
 	{
 		// Environment map (with pre-filtered mip chain)
-		m_envTexture = createTexture(kEnvMapSize, kEnvMapSize, 6, VK_FORMAT_R16G16B16A16_SFLOAT, 0, VK_IMAGE_USAGE_STORAGE_BIT);
-		// Irradiance map
-		m_irmapTexture = createTexture(kIrradianceMapSize, kIrradianceMapSize, 6, VK_FORMAT_R16G16B16A16_SFLOAT, 1, VK_IMAGE_USAGE_STORAGE_BIT);
+		m_envTexture = createTexture(kEnvMapSize, kEnvMapSize, 6, VK_FORMAT_R16G16B16A16_SFLOAT, MemoryCategory::IBL, 0, VK_IMAGE_USAGE_STORAGE_BIT);
+		// Irradiance map (read back for on-disk bakes when switching environments)
+		m_irmapTexture = createTexture(kIrradianceMapSize, kIrradianceMapSize, 6, VK_FORMAT_R16G16B16A16_SFLOAT, MemoryCategory::IBL, 1, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
 		// 2D LUT for split-sum approximation
-		m_spBRDF_LUT = createTexture(kBRDF_LUT_Size, kBRDF_LUT_Size, 1, VK_FORMAT_R16G16_SFLOAT, 1, VK_IMAGE_USAGE_STORAGE_BIT);
+		m_spBRDF_LUT = createTexture(kBRDF_LUT_Size, kBRDF_LUT_Size, 1, VK_FORMAT_R16G16_SFLOAT, MemoryCategory::IBL, 1, VK_IMAGE_USAGE_STORAGE_BIT);
 	}
-	
-	// Create graphics pipeline & descriptor set layout for tone mapping
+
+	// Allocate reflection probe maps: cube map arrays with six layers per probe (single texel placeholders if there are no probes,
+	// since pbr_fs always samples them). Probes are not ready before their first capture so contents start out undefined.
 	{
-		const std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings = {
-			{ 0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+		const uint32_t numProbes = std::max((uint32_t)m_settings.reflectionProbes.size(), 1u);
+		const uint32_t specularSize = reflectionProbes ? m_settings.reflectionProbeSize : 1;
+		const uint32_t irradianceSize = reflectionProbes ? kProbeIrradianceMapSize : 1;
+
+		// Always viewed as cube map arrays (default view of a single probe's six layers would be a plain cube map).
+		auto createCubeMapArray = [this, numProbes](uint32_t size, uint32_t levels) {
+			Texture texture = createTexture(size, size, 6 * numProbes, VK_FORMAT_R16G16B16A16_SFLOAT, MemoryCategory::IBL, levels, VK_IMAGE_USAGE_STORAGE_BIT);
+			vkDestroyImageView(m_device, texture.view, nullptr);
+			texture.view = createTextureView(texture, VK_IMAGE_VIEW_TYPE_CUBE_ARRAY, VK_FORMAT_R16G16B16A16_SFLOAT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS);
+			return texture;
 		};
-		setLayout.tonemap = createDescriptorSetLayout(&descriptorSetLayoutBindings);
+		m_probes.specularTextures = createCubeMapArray(specularSize, 0);
+		m_probes.irradianceTextures = createCubeMapArray(irradianceSize, 1);
 
-		const std::vector<VkDescriptorSetLayout> pipelineDescriptorSetLayouts = {
+		VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+		{
+			const std::initializer_list<ImageMemoryBarrier> barriers = {
+				ImageMemoryBarrier(m_probes.specularTextures, 0, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+				ImageMemoryBarrier(m_probes.irradianceTextures, 0, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+			};
+			pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, barriers);
+		}
+		executeImmediateCommandBuffer(commandBuffer);
+	}
+
+	// Allocate irradiance volume texture: coefficient slabs of all probes side by side along X axis (single texel placeholder
+	// if the volume is disabled, since pbr_fs always samples it). Volume is not used before all probes have been baked.
+	{
+		const glm::ivec3 resolution = irradianceVolume ? m_settings.irradianceVolume : glm::ivec3{1};
+		const uint32_t width = irradianceVolume ? IrradianceVolume::NumTextureSlabs * resolution.x : 1;
+		m_volume.texture = createVolumeTexture(width, resolution.y, resolution.z, VK_FORMAT_R16G16B16A16_SFLOAT, MemoryCategory::IBL, VK_IMAGE_USAGE_STORAGE_BIT);
+
+		VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+		{
+			std::vector<ImageMemoryBarrier> barriers = {
+				ImageMemoryBarrier(m_volume.texture, 0, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+			};
+			if(irradianceVolume) {
+				barriers.push_back(ImageMemoryBarrier(m_volume.captureTexture, 0, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+			}
+			pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, barriers);
+		}
+		executeImmediateCommandBuffer(commandBuffer);
+	}
+
+	// Allocate octahedral specular atlas (converted from pre-filtered cube map once it has been computed).
+	{
+		const uint32_t width  = m_settings.iblOctahedralAtlas ? OctahedralAtlas::width(kEnvMapSize) : 1;
+		const uint32_t height = m_settings.iblOctahedralAtlas ? OctahedralAtlas::height(kEnvMapSize) : 1;
+		m_atlas.texture = createTexture(width, height, 1, VK_FORMAT_R16G16B16A16_SFLOAT, MemoryCategory::IBL, 1, VK_IMAGE_USAGE_STORAGE_BIT);
+
+		VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+		{
+			const auto barrier = ImageMemoryBarrier(m_atlas.texture, 0, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { barrier });
+		}
+		executeImmediateCommandBuffer(commandBuffer);
+	}
+	
+	// Create graphics pipeline & descriptor set layout for tone mapping
+	{
+		const std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings = {
+			{ 0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+			{ 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_spBRDFSampler }, // Scene color (upscaled)
+			{ 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },                  // Exposure
+		};
+		setLayout.tonemap = createDescriptorSetLayout(&descriptorSetLayoutBindings);
+
+		const std::vector<VkDescriptorSetLayout> pipelineDescriptorSetLayouts = {
 			setLayout.tonemap,
 		};
-		m_tonemapPipelineLayout = createPipelineLayout(&pipelineDescriptorSetLayouts);
+		const std::vector<VkPushConstantRange> pipelinePushConstantRanges = {
+			{ VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(glm::vec4) }, // Scene region
+		};
+		// Sample scaled viewport instead of loading input attachment with dynamic resolution (specialization constant 0).
+		const VkBool32 upscale = m_dynamicResolution.enabled() ? VK_TRUE : VK_FALSE;
+		const VkSpecializationMapEntry specializationMap = { 0, 0, sizeof(VkBool32) };
+		const VkSpecializationInfo specializationInfo = { 1, &specializationMap, sizeof(VkBool32), &upscale };
+
+		m_tonemapPipelineLayout = createPipelineLayout(&pipelineDescriptorSetLayouts, &pipelinePushConstantRanges);
 		m_tonemapPipeline = createGraphicsPipeline(
-			1,
+			m_settings.temporalAA ? 0 : 1,
 			"shaders/spirv/tonemap_vs.spv",
 			"shaders/spirv/tonemap_fs.spv",
-			m_tonemapPipelineLayout);
+			m_tonemapPipelineLayout,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr,
+			m_taa.tonemapRenderPass,
+			nullptr,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE,
+			&specializationInfo);
 	}
 
-	// Allocate & update descriptor sets for tone mapping input (per-frame)
-	{
+	// Allocate & update descriptor sets for tone mapping input (per-frame, or per history texture with temporal anti-aliasing).
+	// Scene color is sampled only with dynamic resolution (render targets are not sampleable otherwise, so BRDF LUT stands in for it).
+	const VkDescriptorBufferInfo exposureDescriptor = { m_exposure.exposureBuffer.resource, 0, VK_WHOLE_SIZE };
+	if(m_settings.temporalAA) {
+		m_tonemapDescriptorSets.resize(2);
+		for(uint32_t i=0; i<2; ++i) {
+			const VkDescriptorImageInfo imageInfo = { VK_NULL_HANDLE, m_taa.history[i].view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			m_tonemapDescriptorSets[i] = allocateDescriptorSet(m_descriptorPool, setLayout.tonemap);
+			updateDescriptorSet(m_tonemapDescriptorSets[i], 0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, { imageInfo });
+			updateDescriptorSet(m_tonemapDescriptorSets[i], 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { imageInfo });
+			updateDescriptorSet(m_tonemapDescriptorSets[i], 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { exposureDescriptor });
+		}
+	}
+	else {
 		m_tonemapDescriptorSets.resize(m_numFrames);
 		for(uint32_t i=0; i<m_numFrames; ++i) {
 			const VkDescriptorImageInfo imageInfo = {
@@ -677,31 +1128,56 @@ void Renderer::setup()
 				(m_renderSamples > 1) ? m_resolveRenderTargets[i].colorView : m_renderTargets[i].colorView,
 				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
 			};
+			const VkDescriptorImageInfo sampledImageInfo = m_dynamicResolution.enabled()
+				? imageInfo
+				: VkDescriptorImageInfo{ VK_NULL_HANDLE, m_spBRDF_LUT.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
 			m_tonemapDescriptorSets[i] = allocateDescriptorSet(m_descriptorPool, setLayout.tonemap);
 			updateDescriptorSet(m_tonemapDescriptorSets[i], 0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, { imageInfo });
+			updateDescriptorSet(m_tonemapDescriptorSets[i], 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { sampledImageInfo });
+			updateDescriptorSet(m_tonemapDescriptorSets[i], 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { exposureDescriptor });
 		}
 	}
 	
+	StartupReport::beginPhase("setup: model & pipelines");
+
 	// Load PBR model assets.
-	m_pbrModel = createMeshBuffer(Mesh::fromFile("meshes/cerberus.fbx"));
+	std::shared_ptr<Mesh> pbrModel = Mesh::fromFile("meshes/cerberus.fbx");
+	// Depth-only passes need the model's vertex data de-interleaved (pipelines below then read two vertex streams).
+	const bool depthPrepass = m_settings.depthPrepass || m_settings.benchmark == BenchmarkKind::DepthPrepass;
+	const bool deinterleavedModel = m_settings.shadows || depthPrepass;
+	m_pbrModel = createMeshBuffer(pbrModel, deinterleavedModel);
 	
-	m_albedoTexture = createTexture(Image::fromFile("textures/cerberus_A.png"), VK_FORMAT_R8G8B8A8_SRGB);
-	m_normalTexture = createTexture(Image::fromFile("textures/cerberus_N.png"), VK_FORMAT_R8G8B8A8_UNORM);
-	m_metalnessTexture = createTexture(Image::fromFile("textures/cerberus_M.png", 1), VK_FORMAT_R8_UNORM);
-	m_roughnessTexture = createTexture(Image::fromFile("textures/cerberus_R.png", 1), VK_FORMAT_R8_UNORM);
+	m_albedoTexture = createTexture(Image::fromFile("textures/cerberus_A.png"), VK_FORMAT_R8G8B8A8_SRGB, MemoryCategory::Material);
+	m_normalTexture = createTexture(Image::fromFile("textures/cerberus_N.png"), VK_FORMAT_R8G8B8A8_UNORM, MemoryCategory::Material);
+	m_metalnessTexture = createTexture(Image::fromFile("textures/cerberus_M.png", 1), VK_FORMAT_R8_UNORM, MemoryCategory::Material);
+	m_roughnessTexture = createTexture(Image::fromFile("textures/cerberus_R.png", 1), VK_FORMAT_R8_UNORM, MemoryCategory::Material);
 	
 	// Create graphics pipeline & descriptor set layout for rendering PBR model
 	{
-		const std::vector<VkVertexInputBindingDescription> vertexInputBindings = {
+		PROFILE_ZONE("setup: PBR pipeline");
+		std::vector<VkVertexInputBindingDescription> vertexInputBindings = {
 			{ 0, sizeof(Mesh::Vertex), VK_VERTEX_INPUT_RATE_VERTEX },
 		};
-		const std::vector<VkVertexInputAttributeDescription> vertexAttributes = {
+		std::vector<VkVertexInputAttributeDescription> vertexAttributes = {
 			{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0  }, // Position
 			{ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, 12 }, // Normal
 			{ 2, 0, VK_FORMAT_R32G32B32_SFLOAT, 24 }, // Tangent
 			{ 3, 0, VK_FORMAT_R32G32B32_SFLOAT, 36 }, // Bitangent
 			{ 4, 0, VK_FORMAT_R32G32_SFLOAT,    48 }, // Texcoord
 		};
+		if(deinterleavedModel) {
+			vertexInputBindings = {
+				{ 0, sizeof(glm::vec3), VK_VERTEX_INPUT_RATE_VERTEX },
+				{ 1, sizeof(Mesh::Attributes), VK_VERTEX_INPUT_RATE_VERTEX },
+			};
+			vertexAttributes = {
+				{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0  }, // Position
+				{ 1, 1, VK_FORMAT_R32G32B32_SFLOAT, 0  }, // Normal
+				{ 2, 1, VK_FORMAT_R32G32B32_SFLOAT, 12 }, // Tangent
+				{ 3, 1, VK_FORMAT_R32G32B32_SFLOAT, 24 }, // Bitangent
+				{ 4, 1, VK_FORMAT_R32G32_SFLOAT,    36 }, // Texcoord
+			};
+		}
 
 		const std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings = {
 			{ 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_defaultSampler }, // Albedo texture
@@ -711,6 +1187,13 @@ void Renderer::setup()
 			{ 4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_defaultSampler }, // Specular env map texture
 			{ 5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_defaultSampler }, // Irradiance map texture
 			{ 6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_spBRDFSampler },  // Specular BRDF LUT
+			{ 7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_defaultSampler }, // Previous specular env map texture
+			{ 8, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_defaultSampler }, // Previous irradiance map texture
+			{ 9, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_defaultSampler }, // Reflection probe specular maps
+			{ 10, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_defaultSampler }, // Reflection probe irradiance maps
+			{ 11, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_defaultSampler }, // Irradiance volume texture
+			{ 12, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_spBRDFSampler },  // Octahedral specular atlas
+			{ 13, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_shadows.sampler }, // Shadow maps
 		};
 		setLayout.pbr = createDescriptorSetLayout(&descriptorSetLayoutBindings);
 
@@ -720,6 +1203,28 @@ void Renderer::setup()
 		};
 		m_pbrPipelineLayout = createPipelineLayout(&pipelineDescriptorSetLayouts);
 
+		// PBR fragment shader is specialized for features enabled by settings (specialization constant per feature, see PBRPermutation),
+		// probe & volume capture pipelines get a leaner variant of their own. Half precision variant is a module of its own.
+		PBRPermutation scenePermutation = PBRPermutation::forScene(m_settings);
+		scenePermutation.set(PBRPermutation::Feature_HalfPrecision, m_halfPrecision.supported);
+		const PBRPermutation capturePermutation = scenePermutation.forCapture();
+		const std::vector<uint32_t> sceneSpecializationData = scenePermutation.specializationConstants();
+		const std::vector<uint32_t> captureSpecializationData = capturePermutation.specializationConstants();
+		std::vector<VkSpecializationMapEntry> permutationSpecializationMap(PBRPermutation::NumSpecializedFeatures);
+		for(uint32_t feature=0; feature<PBRPermutation::NumSpecializedFeatures; ++feature) {
+			permutationSpecializationMap[feature] = { feature, uint32_t(feature * sizeof(VkBool32)), sizeof(VkBool32) };
+		}
+		const VkSpecializationInfo sceneSpecializationInfo = {
+			PBRPermutation::NumSpecializedFeatures, permutationSpecializationMap.data(), PBRPermutation::NumSpecializedFeatures * sizeof(VkBool32), sceneSpecializationData.data() };
+		const VkSpecializationInfo captureSpecializationInfo = {
+			PBRPermutation::NumSpecializedFeatures, permutationSpecializationMap.data(), PBRPermutation::NumSpecializedFeatures * sizeof(VkBool32), captureSpecializationData.data() };
+		if(reflectionProbes || irradianceVolume) {
+			std::printf("PBR shader variants: %s (captures: %s)\n", scenePermutation.name().c_str(), capturePermutation.name().c_str());
+		}
+		else {
+			std::printf("PBR shader variant: %s\n", scenePermutation.name().c_str());
+		}
+
 		VkPipelineMultisampleStateCreateInfo multisampleState = { VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
 		multisampleState.rasterizationSamples = static_cast<VkSampleCountFlagBits>(m_renderTargets[0].samples);
 
@@ -731,15 +1236,110 @@ void Renderer::setup()
 		m_pbrPipeline = createGraphicsPipeline(
 			0,
 			"shaders/spirv/pbr_vs.spv",
-			"shaders/spirv/pbr_fs.spv",
+			scenePermutation.spirvModule(),
 			m_pbrPipelineLayout,
 			&vertexInputBindings,
 			&vertexAttributes,
 			&multisampleState,
-			&depthStencilState);
+			&depthStencilState,
+			VK_NULL_HANDLE,
+			nullptr,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE,
+			&sceneSpecializationInfo);
+
+		// Full precision reference of the half precision benchmark.
+		if(m_settings.benchmark == BenchmarkKind::HalfPrecision && m_halfPrecision.supported) {
+			PBRPermutation referencePermutation = scenePermutation;
+			referencePermutation.set(PBRPermutation::Feature_HalfPrecision, false);
+			m_halfPrecision.referencePipeline = createGraphicsPipeline(
+				0,
+				"shaders/spirv/pbr_vs.spv",
+				referencePermutation.spirvModule(),
+				m_pbrPipelineLayout,
+				&vertexInputBindings,
+				&vertexAttributes,
+				&multisampleState,
+				&depthStencilState,
+				VK_NULL_HANDLE,
+				nullptr,
+				VK_FRONT_FACE_COUNTER_CLOCKWISE,
+				&sceneSpecializationInfo);
+		}
+
+		// Depth pre-pass renders position stream only, PBR model then shades just the samples which passed it.
+		if(depthPrepass) {
+			const std::vector<VkVertexInputBindingDescription> positionInputBindings = {
+				{ 0, sizeof(glm::vec3), VK_VERTEX_INPUT_RATE_VERTEX },
+			};
+			const std::vector<VkVertexInputAttributeDescription> positionAttributes = {
+				{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 }, // Position
+			};
+			m_prepass.depthPipeline = createGraphicsPipeline(
+				0,
+				"shaders/spirv/depth_vs.spv",
+				std::string(),
+				m_pbrPipelineLayout,
+				&positionInputBindings,
+				&positionAttributes,
+				&multisampleState,
+				&depthStencilState);
+
+			VkPipelineDepthStencilStateCreateInfo equalDepthStencilState = depthStencilState;
+			equalDepthStencilState.depthWriteEnable = VK_FALSE;
+			equalDepthStencilState.depthCompareOp = VK_COMPARE_OP_EQUAL;
+			m_prepass.pbrPipeline = createGraphicsPipeline(
+				0,
+				"shaders/spirv/pbr_vs.spv",
+				scenePermutation.spirvModule(),
+				m_pbrPipelineLayout,
+				&vertexInputBindings,
+				&vertexAttributes,
+				&multisampleState,
+				&equalDepthStencilState,
+				VK_NULL_HANDLE,
+				nullptr,
+				VK_FRONT_FACE_COUNTER_CLOCKWISE,
+				&sceneSpecializationInfo);
+			m_prepass.enabled = m_settings.depthPrepass;
+		}
+
+		// Probe captures are single sampled & use unflipped projection (matching OpenGL cube map face orientation), which reverses winding.
+		if(reflectionProbes) {
+			multisampleState.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+			m_probes.capturePbrPipeline = createGraphicsPipeline(
+				0,
+				"shaders/spirv/pbr_vs.spv",
+				capturePermutation.spirvModule(),
+				m_pbrPipelineLayout,
+				&vertexInputBindings,
+				&vertexAttributes,
+				&multisampleState,
+				&depthStencilState,
+				m_probes.captureRenderPass,
+				&captureRect,
+				VK_FRONT_FACE_CLOCKWISE,
+				&captureSpecializationInfo);
+		}
+		if(irradianceVolume) {
+			multisampleState.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+			m_volume.capturePbrPipeline = createGraphicsPipeline(
+				0,
+				"shaders/spirv/pbr_vs.spv",
+				capturePermutation.spirvModule(),
+				m_pbrPipelineLayout,
+				&vertexInputBindings,
+				&vertexAttributes,
+				&multisampleState,
+				&depthStencilState,
+				m_volume.captureRenderPass,
+				&volumeCaptureRect,
+				VK_FRONT_FACE_CLOCKWISE,
+				&captureSpecializationInfo);
+		}
 	}
 	
 	// Allocate & update descriptor set for PBR model
+	// With environment switching there is one set per frame as bound pre-filtered maps change over time.
 	{
 		const std::vector<VkDescriptorImageInfo> textures = {
 			{ VK_NULL_HANDLE, m_albedoTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
@@ -749,9 +1349,24 @@ void Renderer::setup()
 			{ VK_NULL_HANDLE, m_envTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
 			{ VK_NULL_HANDLE, m_irmapTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
 			{ VK_NULL_HANDLE, m_spBRDF_LUT.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+			{ VK_NULL_HANDLE, m_envTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+			{ VK_NULL_HANDLE, m_irmapTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+			{ VK_NULL_HANDLE, m_probes.specularTextures.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+			{ VK_NULL_HANDLE, m_probes.irradianceTextures.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+			{ VK_NULL_HANDLE, m_volume.texture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+			{ VK_NULL_HANDLE, m_atlas.texture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+			{ VK_NULL_HANDLE, m_shadows.texture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
 		};
 		m_pbrDescriptorSet = allocateDescriptorSet(m_descriptorPool, setLayout.pbr);
 		updateDescriptorSet(m_pbrDescriptorSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, textures);
+
+		if(dynamicEnvironment) {
+			m_ibl.pbrDescriptorSets.resize(m_numFrames);
+			for(uint32_t i=0; i<m_numFrames; ++i) {
+				m_ibl.pbrDescriptorSets[i] = allocateDescriptorSet(m_descriptorPool, setLayout.pbr);
+				updateDescriptorSet(m_ibl.pbrDescriptorSets[i], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, textures);
+			}
+		}
 	}
 	
 	// Load skybox assets.
@@ -768,6 +1383,8 @@ void Renderer::setup()
 
 		const std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings = {
 			{ 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_defaultSampler }, // Environment texture
+			{ 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_defaultSampler }, // Previous environment texture
+			{ 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_spBRDFSampler },  // Octahedral environment atlas
 		};
 		setLayout.skybox = createDescriptorSetLayout(&descriptorSetLayoutBindings);
 
@@ -790,31 +1407,118 @@ void Renderer::setup()
 			&vertexInputBindings,
 			&vertexAttributes,
 			&multisampleState,
-			&depthStencilState);
+			&depthStencilState,
+			VK_NULL_HANDLE,
+			nullptr,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE,
+			&environmentSpecializationInfo);
+
+		// After depth pre-pass skybox is drawn last (at far plane) only where the model left depth buffer clear.
+		if(m_prepass.depthPipeline != VK_NULL_HANDLE) {
+			VkPipelineDepthStencilStateCreateInfo lastDepthStencilState = { VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO };
+			lastDepthStencilState.depthTestEnable = VK_TRUE;
+			lastDepthStencilState.depthWriteEnable = VK_FALSE;
+			lastDepthStencilState.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+			m_prepass.skyboxPipeline = createGraphicsPipeline(0,
+				"shaders/spirv/skybox_vs.spv",
+				"shaders/spirv/skybox_fs.spv",
+				m_skyboxPipelineLayout,
+				&vertexInputBindings,
+				&vertexAttributes,
+				&multisampleState,
+				&lastDepthStencilState,
+				VK_NULL_HANDLE,
+				nullptr,
+				VK_FRONT_FACE_COUNTER_CLOCKWISE,
+				&environmentSpecializationInfo);
+		}
+
+		if(reflectionProbes) {
+			multisampleState.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+			m_probes.captureSkyboxPipeline = createGraphicsPipeline(0,
+				"shaders/spirv/skybox_vs.spv",
+				"shaders/spirv/skybox_fs.spv",
+				m_skyboxPipelineLayout,
+				&vertexInputBindings,
+				&vertexAttributes,
+				&multisampleState,
+				&depthStencilState,
+				m_probes.captureRenderPass,
+				&captureRect,
+				VK_FRONT_FACE_CLOCKWISE,
+				&environmentSpecializationInfo);
+		}
+		if(irradianceVolume) {
+			multisampleState.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+			m_volume.captureSkyboxPipeline = createGraphicsPipeline(0,
+				"shaders/spirv/skybox_vs.spv",
+				"shaders/spirv/skybox_fs.spv",
+				m_skyboxPipelineLayout,
+				&vertexInputBindings,
+				&vertexAttributes,
+				&multisampleState,
+				&depthStencilState,
+				m_volume.captureRenderPass,
+				&volumeCaptureRect,
+				VK_FRONT_FACE_CLOCKWISE,
+				&environmentSpecializationInfo);
+		}
 	}
 
 	// Allocate & update descriptor set for skybox.
 	{
 		const VkDescriptorImageInfo skyboxTexture = { VK_NULL_HANDLE, m_envTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		const VkDescriptorImageInfo skyboxAtlas = { VK_NULL_HANDLE, m_atlas.texture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
 		m_skyboxDescriptorSet = allocateDescriptorSet(m_descriptorPool, setLayout.skybox);
-		updateDescriptorSet(m_skyboxDescriptorSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { skyboxTexture });
+		updateDescriptorSet(m_skyboxDescriptorSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { skyboxTexture, skyboxTexture });
+		updateDescriptorSet(m_skyboxDescriptorSet, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { skyboxAtlas });
+
+		if(dynamicEnvironment) {
+			m_ibl.skyboxDescriptorSets.resize(m_numFrames);
+			for(uint32_t i=0; i<m_numFrames; ++i) {
+				m_ibl.skyboxDescriptorSets[i] = allocateDescriptorSet(m_descriptorPool, setLayout.skybox);
+				updateDescriptorSet(m_ibl.skyboxDescriptorSets[i], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { skyboxTexture, skyboxTexture });
+				updateDescriptorSet(m_ibl.skyboxDescriptorSets[i], 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { skyboxAtlas });
+			}
+		}
 	}
 
 	// Load & pre-process environment map.
 	{
-		Texture envTextureUnfiltered = createTexture(kEnvMapSize, kEnvMapSize, 6, VK_FORMAT_R16G16B16A16_SFLOAT, 0, VK_IMAGE_USAGE_STORAGE_BIT);
+		Texture envTextureUnfiltered = createTexture(kEnvMapSize, kEnvMapSize, 6, VK_FORMAT_R16G16B16A16_SFLOAT, MemoryCategory::IBL, 0, VK_IMAGE_USAGE_STORAGE_BIT);
 
 		// Load & convert equirectangular envuronment map to cubemap texture
 		{
-			VkPipeline pipeline = createComputePipeline("shaders/spirv/equirect2cube_cs.spv", computePipelineLayout);
-
-			Texture envTextureEquirect = createTexture(Image::fromFile("environment.hdr"), VK_FORMAT_R32G32B32A32_SFLOAT, 1);
+			StartupReport::beginPhase("setup: environment");
+			PROFILE_ZONE("setup: environment");
+			std::shared_ptr<Image> envImage = Image::fromFile(m_settings.environments[0]);
+			Texture envTextureEquirect = createTexture(envImage, VK_FORMAT_R32G32B32A32_SFLOAT, MemoryCategory::IBL, 1);
+
+			// Irradiance shader references environment distribution even if it is disabled so it's always built.
+			m_ibl.distributionBuffer = createEnvironmentDistributionBuffer(*envImage);
+			const VkDescriptorBufferInfo distributionDescriptor = { m_ibl.distributionBuffer.resource, 0, VK_WHOLE_SIZE };
+			updateDescriptorSet(computeDescriptorSet, Binding_Distribution, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { distributionDescriptor });
 			
 			const VkDescriptorImageInfo inputTexture  = { VK_NULL_HANDLE, envTextureEquirect.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
 			const VkDescriptorImageInfo outputTexture = { VK_NULL_HANDLE, envTextureUnfiltered.view, VK_IMAGE_LAYOUT_GENERAL };
 			updateDescriptorSet(computeDescriptorSet, Binding_InputTexture, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { inputTexture });
 			updateDescriptorSet(computeDescriptorSet, Binding_OutputTexture, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, { outputTexture });
 
+			tuneWorkgroupSize(WorkgroupTuner::Equirect2Cube,
+				[this, computePipelineLayout](uint32_t groupSize) {
+					return createEquirectToCubePipeline(computePipelineLayout, groupSize);
+				},
+				[this, &envTextureUnfiltered, computePipelineLayout, computeDescriptorSet](VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t groupSize) {
+					const auto barrier = ImageMemoryBarrier(envTextureUnfiltered, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL).mipLevels(0, 1);
+					pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { barrier });
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeDescriptorSet, 0, nullptr);
+					vkCmdDispatch(commandBuffer, kEnvMapSize/groupSize, kEnvMapSize/groupSize, 6);
+				});
+
+			const uint32_t groupSize = m_workgroups.size(WorkgroupTuner::Equirect2Cube);
+			VkPipeline pipeline = createEquirectToCubePipeline(computePipelineLayout, groupSize);
+
 			VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
 			{
 				const auto preDispatchBarrier = ImageMemoryBarrier(envTextureUnfiltered, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL).mipLevels(0, 1);
@@ -822,14 +1526,19 @@ void Renderer::setup()
 
 				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
 				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeDescriptorSet, 0, nullptr);
-				vkCmdDispatch(commandBuffer, kEnvMapSize/32, kEnvMapSize/32, 6);
+				vkCmdDispatch(commandBuffer, kEnvMapSize/groupSize, kEnvMapSize/groupSize, 6);
 
 				const auto postDispatchBarrier = ImageMemoryBarrier(envTextureUnfiltered, VK_ACCESS_SHADER_WRITE_BIT, 0, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL).mipLevels(0, 1);
 				pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, { postDispatchBarrier });
 			}
 			executeImmediateCommandBuffer(commandBuffer);
 
-			vkDestroyPipeline(m_device, pipeline, nullptr);
+			if(dynamicEnvironment) {
+				m_ibl.equirectToCubePipeline = pipeline;
+			}
+			else {
+				vkDestroyPipeline(m_device, pipeline, nullptr);
+			}
 			destroyTexture(envTextureEquirect);
 
 			generateMipmaps(envTextureUnfiltered);
@@ -837,69 +1546,145 @@ void Renderer::setup()
 
 		// Compute pre-filtered specular environment map.
 		{
+			StartupReport::beginPhase("setup: specular pre-filter");
+			PROFILE_ZONE("setup: specular pre-filter");
 			const uint32_t numMipTailLevels = kEnvMapLevels - 1;
 
-			VkPipeline pipeline;
+			// GGX sample directions are shared by all texels of a level: precompute them once.
+			// Buffer is always bound since the shader references it even if the table is disabled.
+			Resource<VkBuffer> sampleTableBuffer;
+			{
+				const SpecularSampleTable sampleTable = SpecularSampleTable::build(kEnvMapSize, kEnvMapLevels, m_settings.iblSampleErrorTarget, kSpecularSamples);
+				std::vector<char> data(sampleTable.bufferSize());
+				sampleTable.copyToBuffer(data.data());
+				sampleTableBuffer = createBuffer(data.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::IBL);
+				copyToDevice(sampleTableBuffer.memory, data.data(), data.size());
+
+				const VkDescriptorBufferInfo sampleTableDescriptor = { sampleTableBuffer.resource, 0, VK_WHOLE_SIZE };
+				updateDescriptorSet(computeDescriptorSet, Binding_SampleTable, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { sampleTableDescriptor });
+			}
+
+			// Output mip tail is bound before tuning, which writes first pre-filtered level (overwritten below, like the rest of the chain).
+			std::vector<VkImageView> envTextureMipTailViews;
 			{
-				const VkSpecializationMapEntry specializationMap = { 0, 0, sizeof(uint32_t) };
-				const uint32_t specializationData[] = { numMipTailLevels };
+				std::vector<VkDescriptorImageInfo> envTextureMipTailDescriptors;
+				const VkDescriptorImageInfo inputTexture  = { VK_NULL_HANDLE, envTextureUnfiltered.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+				updateDescriptorSet(computeDescriptorSet, Binding_InputTexture, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { inputTexture });
+
+				for(uint32_t level=1; level<kEnvMapLevels; ++level) {
+					envTextureMipTailViews.push_back(createTextureView(m_envTexture, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, level, 1));
+					envTextureMipTailDescriptors.push_back(VkDescriptorImageInfo{ VK_NULL_HANDLE, envTextureMipTailViews[level-1], VK_IMAGE_LAYOUT_GENERAL });
+				}
+				updateDescriptorSet(computeDescriptorSet, Binding_OutputMipTail, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, envTextureMipTailDescriptors);
+			}
 
-				const VkSpecializationInfo specializationInfo = { 1, &specializationMap, sizeof(specializationData), specializationData };
-				pipeline = createComputePipeline("shaders/spirv/spmap_cs.spv", computePipelineLayout, &specializationInfo);
+			SpecularFilterSpecialization specializationData = { numMipTailLevels, kSpecularSamples, m_settings.iblSampleErrorTarget, VK_FALSE, 0, 0,
+				m_settings.iblSampleTables ? VK_TRUE : VK_FALSE };
+			const float deltaRoughness = 1.0f / std::max(float(numMipTailLevels), 1.0f);
+
+			tuneWorkgroupSize(WorkgroupTuner::SpecularFilter,
+				[this, computePipelineLayout, specializationData](uint32_t groupSize) {
+					SpecularFilterSpecialization variantData = specializationData;
+					variantData.localSizeX = variantData.localSizeY = groupSize;
+					return createSpecularFilterPipeline(computePipelineLayout, variantData);
+				},
+				[this, computePipelineLayout, computeDescriptorSet, deltaRoughness](VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t groupSize) {
+					const auto barrier = ImageMemoryBarrier(m_envTexture, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL).mipLevels(1, kEnvMapLevels-1);
+					pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { barrier });
+
+					const uint32_t numGroups = (kEnvMapSize/2) / groupSize;
+					const SpecularFilterPushConstants pushConstants = { 0, deltaRoughness, 0, 0, deltaRoughness };
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeDescriptorSet, 0, nullptr);
+					vkCmdPushConstants(commandBuffer, computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SpecularFilterPushConstants), &pushConstants);
+					vkCmdDispatch(commandBuffer, numGroups, numGroups, 6);
+				});
+
+			// Regular pipeline processes single level in 2D thread groups, tail pipeline folds mip tail into 1D thread groups.
+			const uint32_t groupSize = m_workgroups.size(WorkgroupTuner::SpecularFilter);
+			const uint32_t tailLevel = IBLScheduler::specularMipTailLevel(kEnvMapSize, kEnvMapLevels, groupSize);
+
+			specializationData.localSizeX = specializationData.localSizeY = groupSize;
+			VkPipeline pipeline = createSpecularFilterPipeline(computePipelineLayout, specializationData);
+
+			specializationData.foldedMipTail = VK_TRUE;
+			specializationData.localSizeX = kSpecularMipTailGroupSize;
+			specializationData.localSizeY = 1;
+			VkPipeline tailPipeline = createSpecularFilterPipeline(computePipelineLayout, specializationData);
+
+			// Measure GPU time of whole pre-filtering pass (if not time-sliced).
+			VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+			if(!m_settings.progressiveIBL && m_phyDevice.properties.limits.timestampComputeAndGraphics) {
+				VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+				createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+				createInfo.queryCount = 2;
+				if(VKFAILED(vkCreateQueryPool(m_device, &createInfo, nullptr, &timestampQueryPool))) {
+					throw std::runtime_error("Failed to create timestamp query pool");
+				}
 			}
 
 			VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
 
 			// Copy base mipmap level into destination environment map.
+			// In progressive mode whole (box filtered) mip chain is copied as initial approximation & pre-filtered over next frames.
 			{
-				const std::vector<ImageMemoryBarrier> preCopyBarriers = {
-					ImageMemoryBarrier(envTextureUnfiltered, 0, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL).mipLevels(0, 1),
+				const uint32_t numCopyLevels = m_settings.progressiveIBL ? kEnvMapLevels : 1;
+				const VkImageLayout finalLayout = m_settings.progressiveIBL ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+				const VkAccessFlags finalAccess = m_settings.progressiveIBL ? VK_ACCESS_SHADER_READ_BIT : VK_ACCESS_SHADER_WRITE_BIT;
+
+				const std::initializer_list<ImageMemoryBarrier> preCopyBarriers = {
+					ImageMemoryBarrier(envTextureUnfiltered, 0, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL).mipLevels(0, numCopyLevels),
 					ImageMemoryBarrier(m_envTexture, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL),
 				};
-				const std::vector<ImageMemoryBarrier> postCopyBarriers = {
-					ImageMemoryBarrier(envTextureUnfiltered, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL).mipLevels(0, 1),
-					ImageMemoryBarrier(m_envTexture, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL),
+				const std::initializer_list<ImageMemoryBarrier> postCopyBarriers = {
+					ImageMemoryBarrier(envTextureUnfiltered, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL).mipLevels(0, numCopyLevels),
+					ImageMemoryBarrier(m_envTexture, VK_ACCESS_TRANSFER_WRITE_BIT, finalAccess, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalLayout),
 				};
 
 				pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, preCopyBarriers);
 
-				VkImageCopy copyRegion = {};
-				copyRegion.extent = { m_envTexture.width, m_envTexture.height, 1 };
-				copyRegion.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-				copyRegion.srcSubresource.layerCount = m_envTexture.layers;
-				copyRegion.dstSubresource = copyRegion.srcSubresource;
+				std::vector<VkImageCopy> copyRegions(numCopyLevels);
+				for(uint32_t level=0; level<numCopyLevels; ++level) {
+					VkImageCopy& copyRegion = copyRegions[level];
+					copyRegion = {};
+					copyRegion.extent = { std::max(m_envTexture.width >> level, 1u), std::max(m_envTexture.height >> level, 1u), 1 };
+					copyRegion.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+					copyRegion.srcSubresource.mipLevel = level;
+					copyRegion.srcSubresource.layerCount = m_envTexture.layers;
+					copyRegion.dstSubresource = copyRegion.srcSubresource;
+				}
 				vkCmdCopyImage(commandBuffer,
 					envTextureUnfiltered.image.resource, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 					m_envTexture.image.resource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-					1, &copyRegion);
+					(uint32_t)copyRegions.size(), copyRegions.data());
 
-				pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, postCopyBarriers);
+				pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, m_settings.progressiveIBL ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, postCopyBarriers);
 			}
 				
 			// Pre-filter rest of the mip-chain.
-			std::vector<VkImageView> envTextureMipTailViews;
-			{
-				std::vector<VkDescriptorImageInfo> envTextureMipTailDescriptors;
-				const VkDescriptorImageInfo inputTexture  = { VK_NULL_HANDLE, envTextureUnfiltered.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
-				updateDescriptorSet(computeDescriptorSet, Binding_InputTexture, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { inputTexture });
-
-				for(uint32_t level=1; level<kEnvMapLevels; ++level) {
-					envTextureMipTailViews.push_back(createTextureView(m_envTexture, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, level, 1));
-					envTextureMipTailDescriptors.push_back(VkDescriptorImageInfo{ VK_NULL_HANDLE, envTextureMipTailViews[level-1], VK_IMAGE_LAYOUT_GENERAL });
+			if(!m_settings.progressiveIBL) {
+				if(timestampQueryPool != VK_NULL_HANDLE) {
+					vkCmdResetQueryPool(commandBuffer, timestampQueryPool, 0, 2);
+					vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, 0);
 				}
-				updateDescriptorSet(computeDescriptorSet, Binding_OutputMipTail, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, envTextureMipTailDescriptors);
 
 				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
 				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeDescriptorSet, 0, nullptr);
 
-				const float deltaRoughness = 1.0f / std::max(float(numMipTailLevels), 1.0f);
-				for(uint32_t level=1, size=kEnvMapSize/2; level<kEnvMapLevels; ++level, size/=2) {
-					const uint32_t numGroups = std::max<uint32_t>(1, size/32);
+				for(uint32_t level=1, size=kEnvMapSize/2; level<tailLevel; ++level, size/=2) {
+					const uint32_t numGroups = size / groupSize;
 
-					const SpecularFilterPushConstants pushConstants = { level-1, level * deltaRoughness };
+					const SpecularFilterPushConstants pushConstants = { level-1, level * deltaRoughness, 0, 0, deltaRoughness };
 					vkCmdPushConstants(commandBuffer, computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SpecularFilterPushConstants), &pushConstants);
 					vkCmdDispatch(commandBuffer, numGroups, numGroups, 6);
 				}
+				if(tailLevel < kEnvMapLevels) {
+					dispatchSpecularMipTail(commandBuffer, tailPipeline, computePipelineLayout, m_envTexture, tailLevel);
+				}
+
+				if(timestampQueryPool != VK_NULL_HANDLE) {
+					vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, 1);
+				}
 
 				const auto barrier = ImageMemoryBarrier(m_envTexture, VK_ACCESS_SHADER_WRITE_BIT, 0, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 				pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, { barrier });
@@ -907,22 +1692,79 @@ void Renderer::setup()
 
 			executeImmediateCommandBuffer(commandBuffer);
 
-			for(VkImageView mipTailView : envTextureMipTailViews) {
-				vkDestroyImageView(m_device, mipTailView, nullptr);
+			if(timestampQueryPool != VK_NULL_HANDLE) {
+				uint64_t timestamps[2];
+				if(vkGetQueryPoolResults(m_device, timestampQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS) {
+					const double milliseconds = double(timestamps[1] - timestamps[0]) * m_phyDevice.properties.limits.timestampPeriod * 1e-6;
+					std::printf("Specular pre-filter GPU time: %.2f ms\n", milliseconds);
+				}
+				vkDestroyQueryPool(m_device, timestampQueryPool, nullptr);
+			}
+
+			if(keepIBLResources) {
+				m_ibl.spmapPipeline = pipeline;
+				m_ibl.spmapTailPipeline = tailPipeline;
+				m_ibl.sampleTableBuffer = sampleTableBuffer;
+				m_ibl.envTextureMipTailViews = std::move(envTextureMipTailViews);
+			}
+			else {
+				destroyBuffer(sampleTableBuffer);
+				for(VkImageView mipTailView : envTextureMipTailViews) {
+					vkDestroyImageView(m_device, mipTailView, nullptr);
+				}
+				vkDestroyPipeline(m_device, pipeline, nullptr);
+				vkDestroyPipeline(m_device, tailPipeline, nullptr);
 			}
-			vkDestroyPipeline(m_device, pipeline, nullptr);
-			destroyTexture(envTextureUnfiltered);
 		}
 
 		// Compute diffuse irradiance cubemap
 		{
-			VkPipeline pipeline = createComputePipeline("shaders/spirv/irmap_cs.spv", computePipelineLayout);
+			StartupReport::beginPhase("setup: irradiance map");
+			PROFILE_ZONE("setup: irradiance map");
+			const uint32_t numSamples = m_settings.iblEnvImportanceSampling ? kIrradianceMISSamples : kIrradianceSamples;
+
+			// In progressive mode compute initial approximation using single low sample count batch reading from appropriately blurred mip level.
+			IrradianceFilterPushConstants pushConstants = { 0, 0, 1, 0.0f };
+			Texture& inputEnvTexture = m_settings.progressiveIBL ? envTextureUnfiltered : m_envTexture;
+			if(m_settings.progressiveIBL) {
+				pushConstants.numBatches = kIrradianceApproxBatches;
+				pushConstants.sourceLod  = IBLScheduler::irradianceSourceLod(kEnvMapSize, irradianceLookups(m_settings) / kIrradianceApproxBatches);
+			}
+
+			VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+			if(!m_settings.progressiveIBL && m_phyDevice.properties.limits.timestampComputeAndGraphics) {
+				VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+				createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+				createInfo.queryCount = 2;
+				if(VKFAILED(vkCreateQueryPool(m_device, &createInfo, nullptr, &timestampQueryPool))) {
+					throw std::runtime_error("Failed to create timestamp query pool");
+				}
+			}
 
-			const VkDescriptorImageInfo inputTexture  = { VK_NULL_HANDLE, m_envTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			const VkDescriptorImageInfo inputTexture  = { VK_NULL_HANDLE, inputEnvTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
 			const VkDescriptorImageInfo outputTexture = { VK_NULL_HANDLE, m_irmapTexture.view, VK_IMAGE_LAYOUT_GENERAL };
 			updateDescriptorSet(computeDescriptorSet, Binding_InputTexture, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { inputTexture });
 			updateDescriptorSet(computeDescriptorSet, Binding_OutputTexture, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, { outputTexture });
 
+			// Tune with full sample count in a single batch (output is overwritten below).
+			tuneWorkgroupSize(WorkgroupTuner::Irradiance,
+				[this, computePipelineLayout, numSamples](uint32_t groupSize) {
+					return createIrradianceFilterPipeline(computePipelineLayout, numSamples, m_settings.iblEnvImportanceSampling, groupSize);
+				},
+				[this, computePipelineLayout, computeDescriptorSet](VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t groupSize) {
+					const auto barrier = ImageMemoryBarrier(m_irmapTexture, 0, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+					pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { barrier });
+
+					const IrradianceFilterPushConstants pushConstants = { 0, 0, 1, 0.0f };
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeDescriptorSet, 0, nullptr);
+					vkCmdPushConstants(commandBuffer, computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(IrradianceFilterPushConstants), &pushConstants);
+					vkCmdDispatch(commandBuffer, kIrradianceMapSize/groupSize, kIrradianceMapSize/groupSize, 6);
+				});
+
+			const uint32_t groupSize = m_workgroups.size(WorkgroupTuner::Irradiance);
+			VkPipeline pipeline = createIrradianceFilterPipeline(computePipelineLayout, numSamples, m_settings.iblEnvImportanceSampling, groupSize);
+
 			VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
 			{
 				const auto preDispatchBarrier = ImageMemoryBarrier(m_irmapTexture, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
@@ -930,22 +1772,62 @@ void Renderer::setup()
 
 				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
 				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeDescriptorSet, 0, nullptr);
-				vkCmdDispatch(commandBuffer, kIrradianceMapSize/32, kIrradianceMapSize/32, 6);
+				vkCmdPushConstants(commandBuffer, computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(IrradianceFilterPushConstants), &pushConstants);
+				if(timestampQueryPool != VK_NULL_HANDLE) {
+					vkCmdResetQueryPool(commandBuffer, timestampQueryPool, 0, 2);
+					vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, 0);
+				}
+				vkCmdDispatch(commandBuffer, kIrradianceMapSize/groupSize, kIrradianceMapSize/groupSize, 6);
+				if(timestampQueryPool != VK_NULL_HANDLE) {
+					vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, 1);
+				}
 
 				const auto postDispatchBarrier = ImageMemoryBarrier(m_irmapTexture, VK_ACCESS_SHADER_WRITE_BIT, 0, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 				pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, { postDispatchBarrier });
 			}
 			executeImmediateCommandBuffer(commandBuffer);
-			vkDestroyPipeline(m_device, pipeline, nullptr);
+
+			if(timestampQueryPool != VK_NULL_HANDLE) {
+				uint64_t timestamps[2];
+				if(vkGetQueryPoolResults(m_device, timestampQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS) {
+					const double milliseconds = double(timestamps[1] - timestamps[0]) * m_phyDevice.properties.limits.timestampPeriod * 1e-6;
+					std::printf("Irradiance map GPU time: %.2f ms\n", milliseconds);
+				}
+				vkDestroyQueryPool(m_device, timestampQueryPool, nullptr);
+			}
+
+			if(keepIBLResources) {
+				m_ibl.irmapPipeline = pipeline;
+			}
+			else {
+				vkDestroyPipeline(m_device, pipeline, nullptr);
+				destroyBuffer(m_ibl.distributionBuffer);
+			}
 		}
 		
 		// Compute Cook-Torrance BRDF 2D LUT for split-sum approximation.
 		{
-			VkPipeline pipeline = createComputePipeline("shaders/spirv/spbrdf_cs.spv", computePipelineLayout);
-			
+			StartupReport::beginPhase("setup: BRDF LUT");
+			PROFILE_ZONE("setup: BRDF LUT");
 			const VkDescriptorImageInfo outputTexture = { VK_NULL_HANDLE, m_spBRDF_LUT.view, VK_IMAGE_LAYOUT_GENERAL };
 			updateDescriptorSet(computeDescriptorSet, Binding_OutputTexture, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, { outputTexture });
 
+			tuneWorkgroupSize(WorkgroupTuner::SpecularBRDF,
+				[this, computePipelineLayout](uint32_t groupSize) {
+					return createSpecularBRDFPipeline(computePipelineLayout, kSpecularBRDFSamples, groupSize);
+				},
+				[this, computePipelineLayout, computeDescriptorSet](VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t groupSize) {
+					const auto barrier = ImageMemoryBarrier(m_spBRDF_LUT, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+					pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { barrier });
+
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeDescriptorSet, 0, nullptr);
+					vkCmdDispatch(commandBuffer, kBRDF_LUT_Size/groupSize, kBRDF_LUT_Size/groupSize, 1);
+				});
+
+			const uint32_t groupSize = m_workgroups.size(WorkgroupTuner::SpecularBRDF);
+			VkPipeline pipeline = createSpecularBRDFPipeline(computePipelineLayout, kSpecularBRDFSamples, groupSize);
+
 			VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
 			{
 				const auto preDispatchBarrier = ImageMemoryBarrier(m_spBRDF_LUT, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
@@ -953,7 +1835,7 @@ void Renderer::setup()
 
 				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
 				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeDescriptorSet, 0, nullptr);
-				vkCmdDispatch(commandBuffer, kBRDF_LUT_Size/32, kBRDF_LUT_Size/32, 6);
+				vkCmdDispatch(commandBuffer, kBRDF_LUT_Size/groupSize, kBRDF_LUT_Size/groupSize, 1);
 
 				const auto postDispatchBarrier = ImageMemoryBarrier(m_spBRDF_LUT, VK_ACCESS_SHADER_WRITE_BIT, 0, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 				pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, { postDispatchBarrier });
@@ -961,793 +1843,4099 @@ void Renderer::setup()
 			executeImmediateCommandBuffer(commandBuffer);
 			vkDestroyPipeline(m_device, pipeline, nullptr);
 		}
+
+		if(m_settings.progressiveIBL) {
+			// Irradiance converges quickly and its approximation is the most noticeable so refine it first.
+			m_iblScheduler.queueIrradianceFilter(kIrradianceMapSize, irradianceLookups(m_settings), kIrradianceBatches);
+			m_iblScheduler.queueSpecularFilter(kEnvMapSize, kEnvMapLevels, m_settings.iblSampleErrorTarget, kSpecularSamples, m_workgroups.size(WorkgroupTuner::SpecularFilter));
+		}
+		if(m_settings.progressiveIBL || dynamicEnvironment) {
+			m_ibl.envTextureUnfiltered = envTextureUnfiltered;
+
+			// Both filters read from unfiltered environment map; output mip tail is already bound.
+			const VkDescriptorImageInfo inputTexture  = { VK_NULL_HANDLE, envTextureUnfiltered.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			const VkDescriptorImageInfo outputTexture = { VK_NULL_HANDLE, m_irmapTexture.view, VK_IMAGE_LAYOUT_GENERAL };
+			updateDescriptorSet(computeDescriptorSet, Binding_InputTexture, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { inputTexture });
+			updateDescriptorSet(computeDescriptorSet, Binding_OutputTexture, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, { outputTexture });
+		}
+		else {
+			destroyTexture(envTextureUnfiltered);
+		}
 	}
+	m_workgroups.save();
 	
-	// Clean up
-	vkDestroyDescriptorSetLayout(m_device, setLayout.uniforms, nullptr);
-	vkDestroyDescriptorSetLayout(m_device, setLayout.pbr, nullptr);
-	vkDestroyDescriptorSetLayout(m_device, setLayout.skybox, nullptr);
-	vkDestroyDescriptorSetLayout(m_device, setLayout.tonemap, nullptr);
-	vkDestroyDescriptorSetLayout(m_device, setLayout.compute, nullptr);
+	StartupReport::beginPhase("setup: scene resources");
 
-	vkDestroySampler(m_device, computeSampler, nullptr);
-	vkDestroyPipelineLayout(m_device, computePipelineLayout, nullptr);
-	vkDestroyDescriptorPool(m_device, computeDescriptorPool, nullptr);
-}
-	
-void Renderer::render(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene)
-{
-	const VkDeviceSize zeroOffset = 0;
+	// Create reflection probe pre-filtering resources: sample table & irradiance pipeline for probe map size and
+	// per-probe compute descriptor sets (reading shared capture texture, writing probe's layers).
+	if(reflectionProbes) {
+		const uint32_t numProbes = (uint32_t)m_settings.reflectionProbes.size();
+		const uint32_t size = m_probes.specularTextures.width;
+		const uint32_t levels = m_probes.specularTextures.levels;
 
-	glm::mat4 projectionMatrix = glm::perspectiveFov(view.fov, float(m_frameRect.extent.width), float(m_frameRect.extent.height), 1.0f, 1000.0f);
-	projectionMatrix[1][1] *= -1.0f; // Vulkan uses right handed NDC with Y axis pointing down, compensate for that.
-	
-	const glm::mat4 viewRotationMatrix = glm::eulerAngleXY(glm::radians(view.pitch), glm::radians(view.yaw));
-	const glm::mat4 sceneRotationMatrix = glm::eulerAngleXY(glm::radians(scene.pitch), glm::radians(scene.yaw));
-	const glm::mat4 viewMatrix = glm::translate(glm::mat4{ 1.0f }, { 0.0f, 0.0f, -view.distance }) * viewRotationMatrix;
-	const glm::vec3 eyePosition = glm::inverse(viewMatrix)[3];
-	
-	VkCommandBuffer commandBuffer = m_commandBuffers[m_frameIndex];
-	VkImage swapchainImage = m_swapchainImages[m_frameIndex];
-	VkFramebuffer framebuffer = m_framebuffers[m_frameIndex];
+		m_probeScheduler.reset(m_settings.reflectionProbes, ProbeScheduler::boundingRadius(*pbrModel));
+		m_probes.tailLevel = IBLScheduler::specularMipTailLevel(size, levels, m_workgroups.size(WorkgroupTuner::SpecularFilter));
+		m_probes.irradianceSourceLod = IBLScheduler::irradianceSourceLod(size, kProbeIrradianceSamples);
 
-	VkDescriptorSet uniformsDescriptorSet = m_uniformsDescriptorSets[m_frameIndex];
-	VkDescriptorSet tonemapDescriptorSet = m_tonemapDescriptorSets[m_frameIndex];
+		{
+			const SpecularSampleTable sampleTable = SpecularSampleTable::build(size, levels, m_settings.iblSampleErrorTarget, kSpecularSamples);
+			std::vector<char> data(sampleTable.bufferSize());
+			sampleTable.copyToBuffer(data.data());
+			m_probes.sampleTableBuffer = createBuffer(data.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::IBL);
+			copyToDevice(m_probes.sampleTableBuffer.memory, data.data(), data.size());
+		}
 
-	// Update transform uniforms
-	{
-		TransformUniforms* const transformUniforms = m_transformUniforms[m_frameIndex].as<TransformUniforms>();
-		transformUniforms->viewProjectionMatrix = projectionMatrix * viewMatrix;
-		transformUniforms->skyProjectionMatrix  = projectionMatrix * viewRotationMatrix;
-		transformUniforms->sceneRotationMatrix  = sceneRotationMatrix;
-	}
-	
-	// Update shading uniforms
-	{
-		ShadingUniforms* const shadingUniforms = m_shadingUniforms[m_frameIndex].as<ShadingUniforms>();
-		shadingUniforms->eyePosition = glm::vec4{eyePosition, 0.0f};
-		for(int i=0; i<SceneSettings::NumLights; ++i) {
-			const SceneSettings::Light& light = scene.lights[i];
-			shadingUniforms->lights[i].direction = glm::vec4{light.direction, 0.0f};
-			if(light.enabled) {
-				shadingUniforms->lights[i].radiance = glm::vec4{light.radiance, 0.0f};
+		m_probes.irmapPipeline = createIrradianceFilterPipeline(computePipelineLayout, kProbeIrradianceSamples, false, m_workgroups.size(WorkgroupTuner::Irradiance));
+
+		{
+			const std::array<VkDescriptorPoolSize, 3> poolSizes = {{
+				{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, numProbes },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, numProbes * kEnvMapLevels },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, numProbes * 2 },
+			}};
+
+			VkDescriptorPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+			createInfo.maxSets = numProbes;
+			createInfo.poolSizeCount = (uint32_t)poolSizes.size();
+			createInfo.pPoolSizes = poolSizes.data();
+			if(VKFAILED(vkCreateDescriptorPool(m_device, &createInfo, nullptr, &m_probes.descriptorPool))) {
+				throw std::runtime_error("Failed to create reflection probe descriptor pool");
 			}
-			else {
-				shadingUniforms->lights[i].radiance = glm::vec4{};
+		}
+
+		const VkDescriptorImageInfo inputTexture = { VK_NULL_HANDLE, m_probes.captureTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		const VkDescriptorBufferInfo sampleTableDescriptor = { m_probes.sampleTableBuffer.resource, 0, VK_WHOLE_SIZE };
+		for(uint32_t probe=0; probe<numProbes; ++probe) {
+			VkDescriptorSet descriptorSet = allocateDescriptorSet(m_probes.descriptorPool, setLayout.compute);
+
+			// Mip tail binding is sized for the global environment map: pad unused entries with last level (never written).
+			std::vector<VkDescriptorImageInfo> mipTailDescriptors;
+			for(uint32_t level=1; level<kEnvMapLevels; ++level) {
+				if(level < levels) {
+					m_probes.layerViews.push_back(createTextureView(m_probes.specularTextures, VK_IMAGE_VIEW_TYPE_CUBE, VK_FORMAT_R16G16B16A16_SFLOAT, level, 1, 6 * probe, 6));
+				}
+				mipTailDescriptors.push_back(VkDescriptorImageInfo{ VK_NULL_HANDLE, m_probes.layerViews.back(), VK_IMAGE_LAYOUT_GENERAL });
 			}
+			m_probes.layerViews.push_back(createTextureView(m_probes.irradianceTextures, VK_IMAGE_VIEW_TYPE_CUBE, VK_FORMAT_R16G16B16A16_SFLOAT, 0, 1, 6 * probe, 6));
+			const VkDescriptorImageInfo outputTexture = { VK_NULL_HANDLE, m_probes.layerViews.back(), VK_IMAGE_LAYOUT_GENERAL };
+
+			updateDescriptorSet(descriptorSet, Binding_InputTexture, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { inputTexture });
+			updateDescriptorSet(descriptorSet, Binding_OutputTexture, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, { outputTexture });
+			updateDescriptorSet(descriptorSet, Binding_OutputMipTail, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, mipTailDescriptors);
+			updateDescriptorSet(descriptorSet, Binding_SampleTable, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { sampleTableDescriptor });
+			// Probe irradiance doesn't use environment importance sampling but the binding must still be valid.
+			updateDescriptorSet(descriptorSet, Binding_Distribution, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { sampleTableDescriptor });
+			m_probes.filterDescriptorSets.push_back(descriptorSet);
 		}
-	}
 
-	// Begin recording current frame command buffer.
-	{
-		VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	
-		vkResetCommandBuffer(commandBuffer, 0);
-		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		std::printf("Reflection probes: %u x %upx\n", numProbes, size);
 	}
 
-	// Begin render pass
-	{
-		std::array<VkClearValue, 2> clearValues = {};
-		clearValues[1].depthStencil.depth = 1.0f;
+	// Create irradiance volume SH projection resources: pipeline & per-frame compute descriptor sets (reading whole capture
+	// cube map array, writing volume texture). Only bindings statically used by shproject_cs are written.
+	// Grid spans the bounding cube of the model's bounding sphere so that it stays covered at any rotation.
+	if(irradianceVolume) {
+		const float modelRadius = ProbeScheduler::boundingRadius(*pbrModel);
+		m_irradianceVolume.reset(m_settings.irradianceVolume, glm::vec3{-modelRadius}, glm::vec3{modelRadius});
+		m_volume.modelRadius = modelRadius;
+
+		m_volume.shprojectPipeline = createComputePipeline("shaders/spirv/shproject_cs.spv", computePipelineLayout);
+
+		const VkDeviceSize coordsSize = kVolumeBatchSize * sizeof(glm::ivec4);
+		const VkDeviceSize minAlignment = m_phyDevice.properties.limits.minStorageBufferOffsetAlignment;
+		m_volume.coordsStride = ((coordsSize + minAlignment - 1) / minAlignment) * minAlignment;
+		m_volume.coordsBuffer = createBuffer(m_numFrames * m_volume.coordsStride, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Uniform);
+		if(VKFAILED(vkMapMemory(m_device, m_volume.coordsBuffer.memory, 0, VK_WHOLE_SIZE, 0, &m_volume.coordsMemoryPtr))) {
+			throw std::runtime_error("Failed to map irradiance volume coordinates buffer memory to host address space");
+		}
 
-		VkRenderPassBeginInfo beginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
-		beginInfo.renderPass = m_renderPass;
-		beginInfo.framebuffer = framebuffer;
-		beginInfo.renderArea = m_frameRect;
-		beginInfo.clearValueCount = (uint32_t)clearValues.size();
-		beginInfo.pClearValues = clearValues.data();
+		const VkDescriptorImageInfo inputTexture = { VK_NULL_HANDLE, m_volume.captureTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		const VkDescriptorImageInfo outputTexture = { VK_NULL_HANDLE, m_volume.texture.view, VK_IMAGE_LAYOUT_GENERAL };
+		for(uint32_t i=0; i<m_numFrames; ++i) {
+			VkDescriptorSet descriptorSet = allocateDescriptorSet(m_volume.descriptorPool, setLayout.compute);
 
-		// Begin in main draw subpass
-		vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
-	}
-	
-	// Draw skybox
-	{
-		const std::array<VkDescriptorSet, 2> descriptorSets = {
-			uniformsDescriptorSet,
-			m_skyboxDescriptorSet,
-		};
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_skyboxPipeline);
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_skyboxPipelineLayout, 0, (uint32_t)descriptorSets.size(), descriptorSets.data(), 0, nullptr);
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_skybox.vertexBuffer.resource, &zeroOffset);
-		vkCmdBindIndexBuffer(commandBuffer, m_skybox.indexBuffer.resource, 0, VK_INDEX_TYPE_UINT32);
-		vkCmdDrawIndexed(commandBuffer, m_skybox.numElements, 1, 0, 0, 0);
-	}
+			const VkDescriptorBufferInfo coordsDescriptor = { m_volume.coordsBuffer.resource, i * m_volume.coordsStride, coordsSize };
+			updateDescriptorSet(descriptorSet, Binding_InputTexture, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { inputTexture });
+			updateDescriptorSet(descriptorSet, Binding_OutputTexture, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, { outputTexture });
+			updateDescriptorSet(descriptorSet, Binding_SampleTable, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { coordsDescriptor });
+			m_volume.projectDescriptorSets.push_back(descriptorSet);
+		}
 
-	// Draw PBR model
-	{
-		const std::array<VkDescriptorSet, 1> descriptorSets = {
-			m_pbrDescriptorSet,
-		};
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pbrPipeline);
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pbrPipelineLayout, 1, (uint32_t)descriptorSets.size(), descriptorSets.data(), 0, nullptr);
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_pbrModel.vertexBuffer.resource, &zeroOffset);
-		vkCmdBindIndexBuffer(commandBuffer, m_pbrModel.indexBuffer.resource, 0, VK_INDEX_TYPE_UINT32);
-		vkCmdDrawIndexed(commandBuffer, m_pbrModel.numElements, 1, 0, 0, 0);
+		const glm::ivec3 resolution = m_irradianceVolume.resolution();
+		const glm::ivec3 textureSize = m_irradianceVolume.textureSize();
+		const size_t textureBytes = size_t(textureSize.x) * textureSize.y * textureSize.z * 4 * sizeof(uint16_t);
+		std::printf("Irradiance volume: %dx%dx%d probes, %.1f KB\n", resolution.x, resolution.y, resolution.z, textureBytes / 1024.0);
 	}
 
-	// Transition to tone mapping subpass
-	vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+	m_lights.modelRadius = ProbeScheduler::boundingRadius(*pbrModel);
+	m_clusteredLights.reset(m_settings.numDynamicLights, m_lights.modelRadius, (int)m_frameRect.extent.width, (int)m_frameRect.extent.height);
+	if(m_settings.numDynamicLights > 0) {
+		std::printf("Dynamic lights: %d\n", m_settings.numDynamicLights);
+	}
+	if(m_settings.shadows) {
+		m_shadowCascades.reset(m_settings.shadowMapSize, m_lights.modelRadius, m_settings.shadowCaching);
+		std::printf("Shadow maps: %d lights x %d cascades, %dpx\n", SceneSettings::NumLights, ShadowCascades::NumCascades, m_settings.shadowMapSize);
+	}
 
-	// Draw a full screen triangle for postprocessing/tone mapping.
-	{
-		const std::array<VkDescriptorSet, 1> descriptorSets = {
-			tonemapDescriptorSet
-		};
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_tonemapPipeline);
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_tonemapPipelineLayout, 0, (uint32_t)descriptorSets.size(), descriptorSets.data(), 0, nullptr);
-		vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+	// Create octahedral atlas conversion & comparison resources (own layout: cube map input, atlas output, atlas input, results buffer),
+	// convert pre-filtered specular map & compare the two (with progressive pre-processing this measures initial approximation,
+	// atlas is re-converted as it gets refined). One extra descriptor set is used by the comparison.
+	if(m_settings.iblOctahedralAtlas) {
+		createOctahedralAtlasResources();
 	}
 
-	// End render pass & command buffer recording
-	vkCmdEndRenderPass(commandBuffer);
+	// Clean up
+	vkDestroyDescriptorSetLayout(m_device, setLayout.uniforms, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, setLayout.pbr, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, setLayout.skybox, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, setLayout.tonemap, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, setLayout.compute, nullptr);
+
+	if(keepIBLResources) {
+		// Keep pre-processing resources alive until all queued work has been executed.
+		m_ibl.sampler = computeSampler;
+		m_ibl.pipelineLayout = computePipelineLayout;
+		m_ibl.descriptorPool = computeDescriptorPool;
+		m_ibl.descriptorSet = computeDescriptorSet;
+
+		// Create timestamp query pool for GPU throughput measurements (two queries per frame).
+		if(m_phyDevice.properties.limits.timestampComputeAndGraphics) {
+			VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+			createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			createInfo.queryCount = 2 * m_numFrames;
+			if(VKFAILED(vkCreateQueryPool(m_device, &createInfo, nullptr, &m_ibl.timestampQueryPool))) {
+				throw std::runtime_error("Failed to create timestamp query pool");
+			}
+			m_ibl.frameCost.resize(m_numFrames, 0.0);
+		}
+	}
+	else {
+		vkDestroySampler(m_device, computeSampler, nullptr);
+		vkDestroyPipelineLayout(m_device, computePipelineLayout, nullptr);
+		vkDestroyDescriptorPool(m_device, computeDescriptorPool, nullptr);
+	}
+
+	// Keep as many pre-filtered environments resident as fit into the budget (at least two: current one and one being switched to).
+	// Startup environment occupies first slot, remaining slots are allocated on first use.
+	if(dynamicEnvironment) {
+		const int numEnvironments = (int)m_settings.environments.size();
+		const size_t slotSize = EnvironmentCache::slotSize(kEnvMapSize, kEnvMapLevels, kIrradianceMapSize);
+		m_ibl.cache.reset(EnvironmentCache::numSlotsForBudget(m_settings.iblCacheBudget, slotSize, 2, numEnvironments));
+		m_ibl.slots.resize(m_ibl.cache.numSlots());
+		m_ibl.slots[0] = { m_envTexture, m_irmapTexture };
+		m_ibl.currentSlot = m_ibl.previousSlot = m_ibl.cache.allocate(0, {});
+		m_ibl.boundSlots.resize(m_numFrames, std::make_pair(m_ibl.currentSlot, m_ibl.currentSlot));
+		std::printf("Environment cache: %d slots, %.1f MB each\n", m_ibl.cache.numSlots(), slotSize / (1024.0 * 1024.0));
+
+		if(!m_settings.progressiveIBL) {
+			VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+			readbackEnvironmentSlot(commandBuffer, m_ibl.currentSlot);
+			executeImmediateCommandBuffer(commandBuffer);
+		}
+	}
+}
+	
+void Renderer::createMainRenderPass()
+{
+	// Create render pass
+	if(!m_settings.temporalAA) {
+		PROFILE_ZONE("setup: render pass");
+		enum AttachmentName : uint32_t {
+			MainColorAttachment = 0,
+			MainDepthStencilAttachment,
+			SwapchainColorAttachment,
+			ResolveColorAttachment,
+		};
+
+		// Automatic exposure builds its histogram from single sample scene color after the render pass, half precision benchmark copies it.
+		const bool readSceneColor = m_settings.autoExposure || m_settings.benchmark == BenchmarkKind::HalfPrecision;
+		const bool storeSceneColor = readSceneColor && m_renderSamples == 1;
+
+		std::vector<VkAttachmentDescription> attachments = {
+			// Main color attachment (0), stored for automatic exposure & benchmark readback if it is not resolved.
+			{
+				0,
+				m_renderTargets[0].colorFormat,
+				static_cast<VkSampleCountFlagBits>(m_renderSamples),
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				storeSceneColor ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				storeSceneColor ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			},
+			// Main depth-stencil attachment (1)
+			{
+				0,
+				m_renderTargets[0].depthFormat,
+				static_cast<VkSampleCountFlagBits>(m_renderSamples),
+				VK_ATTACHMENT_LOAD_OP_CLEAR,
+				VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			},
+			// Swapchain color attachment (2)
+			{
+				0,
+				VK_FORMAT_B8G8R8A8_UNORM,
+				VK_SAMPLE_COUNT_1_BIT,
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				VK_ATTACHMENT_STORE_OP_STORE,
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			},
+		};
+		if(m_renderSamples > 1) {
+			// Resolve color attachment (3), stored for automatic exposure & benchmark readback.
+			const VkAttachmentDescription resolveAttachment = 
+			{
+				0,
+				m_resolveRenderTargets[0].colorFormat,
+				VK_SAMPLE_COUNT_1_BIT,
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				readSceneColor ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			};
+			attachments.push_back(resolveAttachment);
+		};
+
+		// Main subpass
+		const std::array<VkAttachmentReference, 1> mainPassColorRefs = {
+			{ MainColorAttachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL }, 
+		};
+		const std::array<VkAttachmentReference, 1> mainPassResolveRefs = {
+			{ ResolveColorAttachment, VK_IMAGE_LAYOUT_GENERAL },
+		};
+		const VkAttachmentReference mainPassDepthStencilRef = {
+			  MainDepthStencilAttachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+		};
+		VkSubpassDescription mainPass = {};
+		mainPass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		mainPass.colorAttachmentCount = (uint32_t)mainPassColorRefs.size();
+		mainPass.pColorAttachments = mainPassColorRefs.data();
+		mainPass.pDepthStencilAttachment = &mainPassDepthStencilRef;
+		if(m_renderSamples > 1) {
+			mainPass.pResolveAttachments = mainPassResolveRefs.data();
+		}
+
+		// Tonemapping subpass
+		const std::array<VkAttachmentReference, 1> tonemapPassInputRefs = {
+			{ MainColorAttachment, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+		};
+		const std::array<VkAttachmentReference, 1> tonemapPassMultisampleInputRefs = {
+			{ ResolveColorAttachment, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+		};
+		const std::array<VkAttachmentReference, 1> tonemapPassColorRefs = {
+			{ SwapchainColorAttachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+		};
+		VkSubpassDescription tonemapPass = {};
+		tonemapPass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		tonemapPass.colorAttachmentCount = (uint32_t)tonemapPassColorRefs.size();
+		tonemapPass.pColorAttachments = tonemapPassColorRefs.data();
+		if(m_renderSamples > 1) {
+			tonemapPass.inputAttachmentCount = (uint32_t)tonemapPassMultisampleInputRefs.size();
+			tonemapPass.pInputAttachments = tonemapPassMultisampleInputRefs.data();
+		}
+		else {
+			tonemapPass.inputAttachmentCount = (uint32_t)tonemapPassInputRefs.size();
+			tonemapPass.pInputAttachments = tonemapPassInputRefs.data();
+		}
+
+		const std::array<VkSubpassDescription, 2> subpasses = {
+			mainPass,
+			tonemapPass,
+		};
+
+		const std::array<VkSubpassDependency, 2> dependencies = {{
+			// Main->Tonemapping dependency (not framebuffer-local when tone mapping upscales scaled viewport with dynamic resolution).
+			{
+				0,
+				1,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				m_dynamicResolution.enabled() ? VkDependencyFlags(0) : VkDependencyFlags(VK_DEPENDENCY_BY_REGION_BIT),
+			},
+			// Tonemapping->Automatic exposure histogram & benchmark readback dependency (scene color store)
+			{
+				1,
+				VK_SUBPASS_EXTERNAL,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT,
+				0,
+			},
+		}};
+
+		VkRenderPassCreateInfo createInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
+		createInfo.attachmentCount = (uint32_t)attachments.size();
+		createInfo.pAttachments = attachments.data();
+		createInfo.subpassCount = (uint32_t)subpasses.size();
+		createInfo.pSubpasses = subpasses.data();
+		createInfo.dependencyCount = readSceneColor ? 2 : 1;
+		createInfo.pDependencies = dependencies.data();
+
+		if(VKFAILED(vkCreateRenderPass(m_device, &createInfo, nullptr, &m_renderPass))) {
+			throw std::runtime_error("Failed to create render pass");
+		}
+	}
+
+	// Create main render pass for temporal anti-aliasing: color (resolved if multisampled) & depth are stored for the resolve
+	// compute pass, tone mapping runs in a render pass of its own afterwards (see below).
+	if(m_settings.temporalAA) {
+		PROFILE_ZONE("setup: temporal AA");
+		enum AttachmentName : uint32_t {
+			MainColorAttachment = 0,
+			MainDepthStencilAttachment,
+			ResolveColorAttachment,
+		};
+
+		const bool multisampled = m_renderSamples > 1;
+		std::vector<VkAttachmentDescription> attachments = {
+			// Main color attachment (0)
+			{
+				0,
+				m_renderTargets[0].colorFormat,
+				static_cast<VkSampleCountFlagBits>(m_renderSamples),
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				multisampled ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			},
+			// Main depth-stencil attachment (1)
+			{
+				0,
+				m_renderTargets[0].depthFormat,
+				static_cast<VkSampleCountFlagBits>(m_renderSamples),
+				VK_ATTACHMENT_LOAD_OP_CLEAR,
+				VK_ATTACHMENT_STORE_OP_STORE,
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+			},
+		};
+		if(multisampled) {
+			// Resolve color attachment (2)
+			const VkAttachmentDescription resolveAttachment =
+			{
+				0,
+				m_resolveRenderTargets[0].colorFormat,
+				VK_SAMPLE_COUNT_1_BIT,
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				VK_ATTACHMENT_STORE_OP_STORE,
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			};
+			attachments.push_back(resolveAttachment);
+		}
+
+		const VkAttachmentReference mainPassColorRef = { MainColorAttachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		const VkAttachmentReference mainPassResolveRef = { ResolveColorAttachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		const VkAttachmentReference mainPassDepthStencilRef = { MainDepthStencilAttachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+		VkSubpassDescription mainPass = {};
+		mainPass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		mainPass.colorAttachmentCount = 1;
+		mainPass.pColorAttachments = &mainPassColorRef;
+		mainPass.pDepthStencilAttachment = &mainPassDepthStencilRef;
+		if(multisampled) {
+			mainPass.pResolveAttachments = &mainPassResolveRef;
+		}
+
+		// Main->Resolve compute pass dependency
+		const VkSubpassDependency mainToResolveDependency = {
+			0,
+			VK_SUBPASS_EXTERNAL,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			0,
+		};
+
+		VkRenderPassCreateInfo createInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
+		createInfo.attachmentCount = (uint32_t)attachments.size();
+		createInfo.pAttachments = attachments.data();
+		createInfo.subpassCount = 1;
+		createInfo.pSubpasses = &mainPass;
+		createInfo.dependencyCount = 1;
+		createInfo.pDependencies = &mainToResolveDependency;
+
+		if(VKFAILED(vkCreateRenderPass(m_device, &createInfo, nullptr, &m_renderPass))) {
+			throw std::runtime_error("Failed to create render pass");
+		}
+	}
+
+	// Create framebuffers (swapchain image is tone mapped in a separate render pass with temporal anti-aliasing)
+	{
+		m_framebuffers.resize(m_numFrames);
+		for(uint32_t i=0; i<m_framebuffers.size(); ++i) {
+
+			std::vector<VkImageView> attachments = {
+				m_renderTargets[i].colorView,
+				m_renderTargets[i].depthView,
+			};
+			if(!m_settings.temporalAA) {
+				attachments.push_back(m_swapchainViews[i]);
+			}
+			if(m_renderSamples > 1) {
+				attachments.push_back(m_resolveRenderTargets[i].colorView);
+			}
+
+			VkFramebufferCreateInfo createInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+			createInfo.renderPass = m_renderPass;
+			createInfo.attachmentCount = (uint32_t)attachments.size();
+			createInfo.pAttachments = attachments.data();
+			createInfo.width  = m_frameRect.extent.width;
+			createInfo.height = m_frameRect.extent.height;
+			createInfo.layers = 1;
+			
+			if(VKFAILED(vkCreateFramebuffer(m_device, &createInfo, nullptr, &m_framebuffers[i]))) {
+				throw std::runtime_error("Failed to create framebuffer");
+			}
+		}
+	}
+}
+
+void Renderer::createTAAResources()
+{
+	const uint32_t width = m_frameRect.extent.width;
+	const uint32_t height = m_frameRect.extent.height;
+	const bool multisampled = m_renderSamples > 1;
+
+	for(Texture& history : m_taa.history) {
+		history = createTexture(width, height, 1, VK_FORMAT_R16G16B16A16_SFLOAT, MemoryCategory::RenderTarget, 1, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT);
+	}
+	if(multisampled) {
+		m_taa.depthTexture = createTexture(width, height, 1, VK_FORMAT_R32_SFLOAT, MemoryCategory::RenderTarget, 1, VK_IMAGE_USAGE_STORAGE_BIT);
+	}
+
+	VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+	{
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, {
+			ImageMemoryBarrier(m_taa.history[0], 0, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+			ImageMemoryBarrier(m_taa.history[1], 0, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+		});
+	}
+	executeImmediateCommandBuffer(commandBuffer);
+
+	// Tone mapping render pass: history is only read (loaded & stored to keep it for next frame's resolve).
+	{
+		const std::array<VkAttachmentDescription, 2> attachments = {{
+			// History color attachment (0)
+			{
+				0,
+				VK_FORMAT_R16G16B16A16_SFLOAT,
+				VK_SAMPLE_COUNT_1_BIT,
+				VK_ATTACHMENT_LOAD_OP_LOAD,
+				VK_ATTACHMENT_STORE_OP_STORE,
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			},
+			// Swapchain color attachment (1)
+			{
+				0,
+				VK_FORMAT_B8G8R8A8_UNORM,
+				VK_SAMPLE_COUNT_1_BIT,
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				VK_ATTACHMENT_STORE_OP_STORE,
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			},
+		}};
+
+		const VkAttachmentReference tonemapPassInputRef = { 0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		const VkAttachmentReference tonemapPassColorRef = { 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		VkSubpassDescription tonemapPass = {};
+		tonemapPass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		tonemapPass.inputAttachmentCount = 1;
+		tonemapPass.pInputAttachments = &tonemapPassInputRef;
+		tonemapPass.colorAttachmentCount = 1;
+		tonemapPass.pColorAttachments = &tonemapPassColorRef;
+
+		// Tonemapping->Next frame's resolve dependency (history store)
+		const VkSubpassDependency tonemapToResolveDependency = {
+			0,
+			VK_SUBPASS_EXTERNAL,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			0,
+		};
+
+		VkRenderPassCreateInfo createInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
+		createInfo.attachmentCount = (uint32_t)attachments.size();
+		createInfo.pAttachments = attachments.data();
+		createInfo.subpassCount = 1;
+		createInfo.pSubpasses = &tonemapPass;
+		createInfo.dependencyCount = 1;
+		createInfo.pDependencies = &tonemapToResolveDependency;
+		if(VKFAILED(vkCreateRenderPass(m_device, &createInfo, nullptr, &m_taa.tonemapRenderPass))) {
+			throw std::runtime_error("Failed to create tone mapping render pass");
+		}
+	}
+
+	m_taa.tonemapFramebuffers.resize(2 * m_numFrames);
+	for(uint32_t i=0; i<m_numFrames; ++i) {
+		for(uint32_t history=0; history<2; ++history) {
+			const std::array<VkImageView, 2> attachments = {
+				m_taa.history[history].view,
+				m_swapchainViews[i],
+			};
+
+			VkFramebufferCreateInfo createInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+			createInfo.renderPass = m_taa.tonemapRenderPass;
+			createInfo.attachmentCount = (uint32_t)attachments.size();
+			createInfo.pAttachments = attachments.data();
+			createInfo.width  = width;
+			createInfo.height = height;
+			createInfo.layers = 1;
+			if(VKFAILED(vkCreateFramebuffer(m_device, &createInfo, nullptr, &m_taa.tonemapFramebuffers[2 * i + history]))) {
+				throw std::runtime_error("Failed to create tone mapping framebuffer");
+			}
+		}
+	}
+
+	// Resolve pipeline & descriptor sets (per frame & history texture written).
+	{
+		const std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings = {
+			{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },                   // Temporal AA uniforms
+			{ 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, &m_spBRDFSampler },  // Scene color
+			{ 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, &m_spBRDFSampler },  // Scene depth
+			{ 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, &m_spBRDFSampler },  // History (previous frame)
+			{ 4, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },                    // History (this frame)
+		};
+		VkDescriptorSetLayout descriptorSetLayout = createDescriptorSetLayout(&descriptorSetLayoutBindings);
+
+		const std::vector<VkDescriptorSetLayout> pipelineSetLayouts = {
+			descriptorSetLayout,
+		};
+		m_taa.pipelineLayout = createPipelineLayout(&pipelineSetLayouts);
+		m_taa.pipeline = createComputePipeline("shaders/spirv/taa_cs.spv", m_taa.pipelineLayout);
+
+		for(uint32_t i=0; i<m_numFrames; ++i) {
+			m_taa.uniforms.push_back(allocFromUniformBuffer<TemporalAA::Uniforms>(m_uniformBuffer));
+
+			const VkDescriptorImageInfo colorTexture = {
+				VK_NULL_HANDLE,
+				multisampled ? m_resolveRenderTargets[i].colorView : m_renderTargets[i].colorView,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			};
+			const VkDescriptorImageInfo depthTexture = multisampled
+				? VkDescriptorImageInfo{ VK_NULL_HANDLE, m_taa.depthTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }
+				: VkDescriptorImageInfo{ VK_NULL_HANDLE, m_renderTargets[i].depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+			for(uint32_t history=0; history<2; ++history) {
+				const VkDescriptorImageInfo previousHistoryTexture = { VK_NULL_HANDLE, m_taa.history[1 - history].view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+				const VkDescriptorImageInfo historyTexture = { VK_NULL_HANDLE, m_taa.history[history].view, VK_IMAGE_LAYOUT_GENERAL };
+
+				VkDescriptorSet descriptorSet = allocateDescriptorSet(m_descriptorPool, descriptorSetLayout);
+				updateDescriptorSet(descriptorSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, { m_taa.uniforms[i].descriptorInfo });
+				updateDescriptorSet(descriptorSet, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { colorTexture });
+				updateDescriptorSet(descriptorSet, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { depthTexture });
+				updateDescriptorSet(descriptorSet, 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { previousHistoryTexture });
+				updateDescriptorSet(descriptorSet, 4, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, { historyTexture });
+				m_taa.descriptorSets.push_back(descriptorSet);
+			}
+		}
+		vkDestroyDescriptorSetLayout(m_device, descriptorSetLayout, nullptr);
+	}
+
+	// Depth resolve pipeline & descriptor sets (per frame).
+	if(multisampled) {
+		const std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings = {
+			{ 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, &m_spBRDFSampler },  // Multisampled scene depth
+			{ 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },                    // Resolved depth
+		};
+		VkDescriptorSetLayout descriptorSetLayout = createDescriptorSetLayout(&descriptorSetLayoutBindings);
+
+		const std::vector<VkDescriptorSetLayout> pipelineSetLayouts = {
+			descriptorSetLayout,
+		};
+		m_taa.depthResolvePipelineLayout = createPipelineLayout(&pipelineSetLayouts);
+		m_taa.depthResolvePipeline = createComputePipeline("shaders/spirv/depthresolve_cs.spv", m_taa.depthResolvePipelineLayout);
+
+		const VkDescriptorImageInfo outputTexture = { VK_NULL_HANDLE, m_taa.depthTexture.view, VK_IMAGE_LAYOUT_GENERAL };
+		for(uint32_t i=0; i<m_numFrames; ++i) {
+			const VkDescriptorImageInfo inputTexture = { VK_NULL_HANDLE, m_renderTargets[i].depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+			VkDescriptorSet descriptorSet = allocateDescriptorSet(m_descriptorPool, descriptorSetLayout);
+			updateDescriptorSet(descriptorSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { inputTexture });
+			updateDescriptorSet(descriptorSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, { outputTexture });
+			m_taa.depthResolveDescriptorSets.push_back(descriptorSet);
+		}
+		vkDestroyDescriptorSetLayout(m_device, descriptorSetLayout, nullptr);
+	}
+}
+
+void Renderer::createExposureResources()
+{
+	// Create exposure buffer (average luminance & exposure), read by tone mapping even with fixed exposure. Automatic exposure starts
+	// with an empty histogram & no adapted luminance (exposure_cs clears the histogram after each use).
+	{
+		const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		const float initialExposure[2] = { 0.0f, 1.0f };
+		m_exposure.exposureBuffer = createBuffer(sizeof(initialExposure), usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Other);
+		if(m_settings.autoExposure) {
+			m_exposure.histogramBuffer = createBuffer(AutoExposure::NumBins * sizeof(uint32_t), usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Other);
+		}
+
+		VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+		vkCmdUpdateBuffer(commandBuffer, m_exposure.exposureBuffer.resource, 0, sizeof(initialExposure), initialExposure);
+		if(m_settings.autoExposure) {
+			vkCmdFillBuffer(commandBuffer, m_exposure.histogramBuffer.resource, 0, VK_WHOLE_SIZE, 0);
+		}
+		executeImmediateCommandBuffer(commandBuffer);
+	}
+
+	// Create automatic exposure histogram & adaptation pipelines (sharing layout & push constant parameters), descriptor set
+	// per scene color image & timestamp query pool for their GPU time (two queries per frame).
+	if(m_settings.autoExposure) {
+		PROFILE_ZONE("setup: auto exposure");
+		const std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings = {
+			{ 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, &m_spBRDFSampler }, // Scene color
+			{ 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },                  // Histogram
+			{ 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },                  // Exposure
+		};
+		VkDescriptorSetLayout descriptorSetLayout = createDescriptorSetLayout(&descriptorSetLayoutBindings);
+
+		const std::vector<VkDescriptorSetLayout> pipelineSetLayouts = {
+			descriptorSetLayout,
+		};
+		const std::vector<VkPushConstantRange> pipelinePushConstantRanges = {
+			{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AutoExposure::Parameters) },
+		};
+		m_exposure.pipelineLayout = createPipelineLayout(&pipelineSetLayouts, &pipelinePushConstantRanges);
+		m_exposure.histogramPipeline = createComputePipeline("shaders/spirv/histogram_cs.spv", m_exposure.pipelineLayout);
+		m_exposure.exposurePipeline = createComputePipeline("shaders/spirv/exposure_cs.spv", m_exposure.pipelineLayout);
+
+		const VkDescriptorBufferInfo histogramDescriptor = { m_exposure.histogramBuffer.resource, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo exposureDescriptor = { m_exposure.exposureBuffer.resource, 0, VK_WHOLE_SIZE };
+		const uint32_t numSceneColorImages = m_settings.temporalAA ? 2 : m_numFrames;
+		for(uint32_t i=0; i<numSceneColorImages; ++i) {
+			VkImageView sceneColorView;
+			if(m_settings.temporalAA) {
+				sceneColorView = m_taa.history[i].view;
+			}
+			else {
+				sceneColorView = (m_renderSamples > 1) ? m_resolveRenderTargets[i].colorView : m_renderTargets[i].colorView;
+			}
+			const VkDescriptorImageInfo sceneColorTexture = { VK_NULL_HANDLE, sceneColorView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+			VkDescriptorSet descriptorSet = allocateDescriptorSet(m_descriptorPool, descriptorSetLayout);
+			updateDescriptorSet(descriptorSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { sceneColorTexture });
+			updateDescriptorSet(descriptorSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { histogramDescriptor });
+			updateDescriptorSet(descriptorSet, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { exposureDescriptor });
+			m_exposure.descriptorSets.push_back(descriptorSet);
+		}
+		vkDestroyDescriptorSetLayout(m_device, descriptorSetLayout, nullptr);
+
+		if(m_phyDevice.properties.limits.timestampComputeAndGraphics) {
+			VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+			createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			createInfo.queryCount = 2 * m_numFrames;
+			if(VKFAILED(vkCreateQueryPool(m_device, &createInfo, nullptr, &m_exposure.timestampQueryPool))) {
+				throw std::runtime_error("Failed to create timestamp query pool");
+			}
+			m_exposure.pendingQueries.resize(m_numFrames, false);
+		}
+	}
+}
+
+void Renderer::createReflectionProbeCaptureResources()
+{
+	PROFILE_ZONE("setup: reflection probes");
+	const uint32_t size = m_settings.reflectionProbeSize;
+
+	m_probes.captureTexture = createTexture(size, size, 6, VK_FORMAT_R16G16B16A16_SFLOAT, MemoryCategory::RenderTarget, 0, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+	m_probes.captureDepthTarget = createRenderTarget(size, size, 1, VK_FORMAT_UNDEFINED, m_renderTargets[0].depthFormat);
+
+	const std::array<VkAttachmentDescription, 2> attachments = {{
+		// Capture color attachment (0)
+		{
+			0,
+			VK_FORMAT_R16G16B16A16_SFLOAT,
+			VK_SAMPLE_COUNT_1_BIT,
+			VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			VK_ATTACHMENT_STORE_OP_STORE,
+			VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		},
+		// Capture depth-stencil attachment (1)
+		{
+			0,
+			m_renderTargets[0].depthFormat,
+			VK_SAMPLE_COUNT_1_BIT,
+			VK_ATTACHMENT_LOAD_OP_CLEAR,
+			VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		},
+	}};
+
+	const VkAttachmentReference colorRef = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	const VkAttachmentReference depthStencilRef = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+	VkSubpassDescription capturePass = {};
+	capturePass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	capturePass.colorAttachmentCount = 1;
+	capturePass.pColorAttachments = &colorRef;
+	capturePass.pDepthStencilAttachment = &depthStencilRef;
+
+	// Previous capture (shared depth buffer) & its pre-filtering (which reads the capture texture) must complete first;
+	// finished face is then read by transfer commands.
+	const std::array<VkSubpassDependency, 2> dependencies = {{
+		{
+			VK_SUBPASS_EXTERNAL,
+			0,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			0,
+		},
+		{
+			0,
+			VK_SUBPASS_EXTERNAL,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_ACCESS_TRANSFER_READ_BIT,
+			0,
+		},
+	}};
+
+	VkRenderPassCreateInfo createInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
+	createInfo.attachmentCount = (uint32_t)attachments.size();
+	createInfo.pAttachments = attachments.data();
+	createInfo.subpassCount = 1;
+	createInfo.pSubpasses = &capturePass;
+	createInfo.dependencyCount = (uint32_t)dependencies.size();
+	createInfo.pDependencies = dependencies.data();
+	if(VKFAILED(vkCreateRenderPass(m_device, &createInfo, nullptr, &m_probes.captureRenderPass))) {
+		throw std::runtime_error("Failed to create reflection probe capture render pass");
+	}
+
+	for(uint32_t face=0; face<6; ++face) {
+		m_probes.captureFaceViews.push_back(createTextureView(m_probes.captureTexture, VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R16G16B16A16_SFLOAT, 0, 1, face, 1));
+
+		const std::array<VkImageView, 2> framebufferAttachments = {
+			m_probes.captureFaceViews[face],
+			m_probes.captureDepthTarget.depthView,
+		};
+
+		VkFramebufferCreateInfo framebufferCreateInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+		framebufferCreateInfo.renderPass = m_probes.captureRenderPass;
+		framebufferCreateInfo.attachmentCount = (uint32_t)framebufferAttachments.size();
+		framebufferCreateInfo.pAttachments = framebufferAttachments.data();
+		framebufferCreateInfo.width  = size;
+		framebufferCreateInfo.height = size;
+		framebufferCreateInfo.layers = 1;
+
+		VkFramebuffer framebuffer;
+		if(VKFAILED(vkCreateFramebuffer(m_device, &framebufferCreateInfo, nullptr, &framebuffer))) {
+			throw std::runtime_error("Failed to create reflection probe capture framebuffer");
+		}
+		m_probes.captureFramebuffers.push_back(framebuffer);
+	}
+}
+
+void Renderer::createIrradianceVolumeCaptureResources()
+{
+	PROFILE_ZONE("setup: irradiance volume");
+	m_volume.captureTexture = createTexture(kVolumeCaptureSize, kVolumeCaptureSize, 6 * kVolumeBatchSize, VK_FORMAT_R16G16B16A16_SFLOAT, MemoryCategory::RenderTarget, 1, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+	m_volume.captureDepthTarget = createRenderTarget(kVolumeCaptureSize, kVolumeCaptureSize, 1, VK_FORMAT_UNDEFINED, m_renderTargets[0].depthFormat);
+
+	const std::array<VkAttachmentDescription, 2> attachments = {{
+		// Capture color attachment (0)
+		{
+			0,
+			VK_FORMAT_R16G16B16A16_SFLOAT,
+			VK_SAMPLE_COUNT_1_BIT,
+			VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			VK_ATTACHMENT_STORE_OP_STORE,
+			VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		},
+		// Capture depth-stencil attachment (1)
+		{
+			0,
+			m_renderTargets[0].depthFormat,
+			VK_SAMPLE_COUNT_1_BIT,
+			VK_ATTACHMENT_LOAD_OP_CLEAR,
+			VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		},
+	}};
+
+	const VkAttachmentReference colorRef = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	const VkAttachmentReference depthStencilRef = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+	VkSubpassDescription capturePass = {};
+	capturePass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	capturePass.colorAttachmentCount = 1;
+	capturePass.pColorAttachments = &colorRef;
+	capturePass.pDepthStencilAttachment = &depthStencilRef;
+
+	// Previous capture (shared depth buffer) & previous projection (which reads the capture texture) must complete first;
+	// finished layer is then read by the projection compute shader.
+	const std::array<VkSubpassDependency, 2> dependencies = {{
+		{
+			VK_SUBPASS_EXTERNAL,
+			0,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			0,
+		},
+		{
+			0,
+			VK_SUBPASS_EXTERNAL,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			0,
+		},
+	}};
+
+	VkRenderPassCreateInfo createInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
+	createInfo.attachmentCount = (uint32_t)attachments.size();
+	createInfo.pAttachments = attachments.data();
+	createInfo.subpassCount = 1;
+	createInfo.pSubpasses = &capturePass;
+	createInfo.dependencyCount = (uint32_t)dependencies.size();
+	createInfo.pDependencies = dependencies.data();
+	if(VKFAILED(vkCreateRenderPass(m_device, &createInfo, nullptr, &m_volume.captureRenderPass))) {
+		throw std::runtime_error("Failed to create irradiance volume capture render pass");
+	}
+
+	for(uint32_t layer=0; layer<m_volume.captureTexture.layers; ++layer) {
+		m_volume.captureLayerViews.push_back(createTextureView(m_volume.captureTexture, VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R16G16B16A16_SFLOAT, 0, 1, layer, 1));
+
+		const std::array<VkImageView, 2> framebufferAttachments = {
+			m_volume.captureLayerViews[layer],
+			m_volume.captureDepthTarget.depthView,
+		};
+
+		VkFramebufferCreateInfo framebufferCreateInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+		framebufferCreateInfo.renderPass = m_volume.captureRenderPass;
+		framebufferCreateInfo.attachmentCount = (uint32_t)framebufferAttachments.size();
+		framebufferCreateInfo.pAttachments = framebufferAttachments.data();
+		framebufferCreateInfo.width  = kVolumeCaptureSize;
+		framebufferCreateInfo.height = kVolumeCaptureSize;
+		framebufferCreateInfo.layers = 1;
+
+		VkFramebuffer framebuffer;
+		if(VKFAILED(vkCreateFramebuffer(m_device, &framebufferCreateInfo, nullptr, &framebuffer))) {
+			throw std::runtime_error("Failed to create irradiance volume capture framebuffer");
+		}
+		m_volume.captureFramebuffers.push_back(framebuffer);
+	}
+}
+
+void Renderer::createShadowResources()
+{
+	// Create shadow map array (single texel placeholder if shadows are disabled, since pbr_fs always samples it) & its comparison sampler.
+	// With shadows enabled also create depth-only render pass, per-layer framebuffers & pipeline rendering the model's position stream.
+	// Whole array starts out in shader read only layout; render pass returns rendered layers to that layout.
+	{
+		PROFILE_ZONE("setup: shadow maps");
+		m_shadows.format = VK_FORMAT_D32_SFLOAT;
+		{
+			const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+			VkFormatProperties formatProperties;
+			vkGetPhysicalDeviceFormatProperties(m_phyDevice.handle, m_shadows.format, &formatProperties);
+			if((formatProperties.optimalTilingFeatures & requiredFeatures) != requiredFeatures) {
+				m_shadows.format = VK_FORMAT_D16_UNORM;
+			}
+		}
+
+		const uint32_t size = m_settings.shadows ? m_settings.shadowMapSize : 1;
+		const uint32_t layers = m_settings.shadows ? ShadowCascades::NumMaps : 1;
+		m_shadows.texture.width  = size;
+		m_shadows.texture.height = size;
+		m_shadows.texture.layers = layers;
+		m_shadows.texture.levels = 1;
+		m_shadows.texture.image = createImage(size, size, layers, 1, m_shadows.format, 1, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, MemoryCategory::RenderTarget);
+		m_shadows.texture.view = createTextureView(m_shadows.texture, VK_IMAGE_VIEW_TYPE_2D_ARRAY, m_shadows.format, 0, 1, 0, layers, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+		VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+		{
+			const auto barrier = ImageMemoryBarrier(m_shadows.texture, 0, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL).aspectMask(VK_IMAGE_ASPECT_DEPTH_BIT);
+			pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, { barrier });
+		}
+		executeImmediateCommandBuffer(commandBuffer);
+
+		VkSamplerCreateInfo samplerCreateInfo = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+		samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+		samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+		samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCreateInfo.compareEnable = VK_TRUE;
+		samplerCreateInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+		samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+		if(VKFAILED(vkCreateSampler(m_device, &samplerCreateInfo, nullptr, &m_shadows.sampler))) {
+			throw std::runtime_error("Failed to create shadow map comparison sampler");
+		}
+	}
+	if(m_settings.shadows) {
+		const VkAttachmentDescription attachment = {
+			0,
+			m_shadows.format,
+			VK_SAMPLE_COUNT_1_BIT,
+			VK_ATTACHMENT_LOAD_OP_CLEAR,
+			VK_ATTACHMENT_STORE_OP_STORE,
+			VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		};
+
+		const VkAttachmentReference depthRef = { 0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+		VkSubpassDescription shadowPass = {};
+		shadowPass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		shadowPass.pDepthStencilAttachment = &depthRef;
+
+		// Previous frames' shading must finish sampling a layer before it gets cleared; rendered layer is then sampled by pbr_fs.
+		const std::array<VkSubpassDependency, 2> dependencies = {{
+			{
+				VK_SUBPASS_EXTERNAL,
+				0,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				0,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				0,
+			},
+			{
+				0,
+				VK_SUBPASS_EXTERNAL,
+				VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				0,
+			},
+		}};
+
+		VkRenderPassCreateInfo createInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
+		createInfo.attachmentCount = 1;
+		createInfo.pAttachments = &attachment;
+		createInfo.subpassCount = 1;
+		createInfo.pSubpasses = &shadowPass;
+		createInfo.dependencyCount = (uint32_t)dependencies.size();
+		createInfo.pDependencies = dependencies.data();
+		if(VKFAILED(vkCreateRenderPass(m_device, &createInfo, nullptr, &m_shadows.renderPass))) {
+			throw std::runtime_error("Failed to create shadow map render pass");
+		}
+
+		for(uint32_t layer=0; layer<m_shadows.texture.layers; ++layer) {
+			m_shadows.layerViews.push_back(createTextureView(m_shadows.texture, VK_IMAGE_VIEW_TYPE_2D, m_shadows.format, 0, 1, layer, 1, VK_IMAGE_ASPECT_DEPTH_BIT));
+
+			VkFramebufferCreateInfo framebufferCreateInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+			framebufferCreateInfo.renderPass = m_shadows.renderPass;
+			framebufferCreateInfo.attachmentCount = 1;
+			framebufferCreateInfo.pAttachments = &m_shadows.layerViews[layer];
+			framebufferCreateInfo.width  = m_shadows.texture.width;
+			framebufferCreateInfo.height = m_shadows.texture.height;
+			framebufferCreateInfo.layers = 1;
+
+			VkFramebuffer framebuffer;
+			if(VKFAILED(vkCreateFramebuffer(m_device, &framebufferCreateInfo, nullptr, &framebuffer))) {
+				throw std::runtime_error("Failed to create shadow map framebuffer");
+			}
+			m_shadows.framebuffers.push_back(framebuffer);
+		}
+
+		const std::vector<VkPushConstantRange> pipelinePushConstantRanges = {
+			{ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4) },
+		};
+		m_shadows.pipelineLayout = createPipelineLayout(nullptr, &pipelinePushConstantRanges);
+
+		const std::vector<VkVertexInputBindingDescription> vertexInputBindings = {
+			{ 0, sizeof(glm::vec3), VK_VERTEX_INPUT_RATE_VERTEX },
+		};
+		const std::vector<VkVertexInputAttributeDescription> vertexAttributes = {
+			{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 }, // Position
+		};
+
+		VkPipelineDepthStencilStateCreateInfo depthStencilState = { VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO };
+		depthStencilState.depthTestEnable = VK_TRUE;
+		depthStencilState.depthWriteEnable = VK_TRUE;
+		depthStencilState.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+		// Light view-projection matrices are not flipped (OpenGL texture orientation), which reverses winding.
+		VkPipelineRasterizationStateCreateInfo rasterizationState = { VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
+		rasterizationState.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizationState.cullMode = VK_CULL_MODE_BACK_BIT;
+		rasterizationState.frontFace = VK_FRONT_FACE_CLOCKWISE;
+		rasterizationState.depthBiasEnable = VK_TRUE;
+		rasterizationState.depthBiasConstantFactor = kShadowConstantBias;
+		rasterizationState.depthBiasSlopeFactor = kShadowSlopeBias;
+		rasterizationState.lineWidth = 1.0f;
+
+		const VkRect2D shadowRect = { { 0, 0 }, { m_shadows.texture.width, m_shadows.texture.height } };
+		m_shadows.pipeline = createGraphicsPipeline(
+			0,
+			"shaders/spirv/shadow_vs.spv",
+			std::string(),
+			m_shadows.pipelineLayout,
+			&vertexInputBindings,
+			&vertexAttributes,
+			nullptr,
+			&depthStencilState,
+			m_shadows.renderPass,
+			&shadowRect,
+			VK_FRONT_FACE_CLOCKWISE,
+			nullptr,
+			&rasterizationState);
+
+		// Two timestamps per map in each frame's range.
+		if(m_phyDevice.properties.limits.timestampComputeAndGraphics) {
+			VkQueryPoolCreateInfo queryPoolCreateInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+			queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryPoolCreateInfo.queryCount = 2 * ShadowCascades::NumMaps * m_numFrames;
+			if(VKFAILED(vkCreateQueryPool(m_device, &queryPoolCreateInfo, nullptr, &m_shadows.timestampQueryPool))) {
+				throw std::runtime_error("Failed to create timestamp query pool");
+			}
+			m_shadows.pendingQueries.resize(ShadowCascades::NumMaps * m_numFrames, false);
+		}
+	}
+}
+
+void Renderer::createOctahedralAtlasResources()
+{
+	PROFILE_ZONE("setup: octahedral atlas");
+	{
+		const std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings = {
+			{ 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, &m_defaultSampler }, // Pre-filtered cube map
+			{ 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },                    // Output atlas
+			{ 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, &m_spBRDFSampler },  // Input atlas
+			{ 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },                   // Comparison results
+		};
+		m_atlas.setLayout = createDescriptorSetLayout(&descriptorSetLayoutBindings);
+
+		const std::vector<VkDescriptorSetLayout> pipelineSetLayouts = {
+			m_atlas.setLayout,
+		};
+		const std::vector<VkPushConstantRange> pipelinePushConstantRanges = {
+			{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t) },
+		};
+		m_atlas.pipelineLayout = createPipelineLayout(&pipelineSetLayouts, &pipelinePushConstantRanges);
+	}
+	{
+		const uint32_t numSets = m_numFrames + 1;
+		const std::array<VkDescriptorPoolSize, 3> poolSizes = {{
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 * numSets },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, numSets },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, numSets },
+		}};
+
+		VkDescriptorPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+		createInfo.maxSets = numSets;
+		createInfo.poolSizeCount = (uint32_t)poolSizes.size();
+		createInfo.pPoolSizes = poolSizes.data();
+		if(VKFAILED(vkCreateDescriptorPool(m_device, &createInfo, nullptr, &m_atlas.descriptorPool))) {
+			throw std::runtime_error("Failed to create octahedral atlas descriptor pool");
+		}
+	}
+
+	const VkDescriptorImageInfo outputTexture = { VK_NULL_HANDLE, m_atlas.texture.view, VK_IMAGE_LAYOUT_GENERAL };
+	for(uint32_t i=0; i<m_numFrames; ++i) {
+		VkDescriptorSet descriptorSet = allocateDescriptorSet(m_atlas.descriptorPool, m_atlas.setLayout);
+		updateDescriptorSet(descriptorSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, { outputTexture });
+		m_atlas.convertDescriptorSets.push_back(descriptorSet);
+	}
+	m_atlas.convertPipeline = createComputePipeline("shaders/spirv/octatlas_cs.spv", m_atlas.pipelineLayout);
+
+	VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+	convertSpecularAtlas(commandBuffer);
+	executeImmediateCommandBuffer(commandBuffer);
+
+	reportSpecularAtlas();
+}
+	
+void Renderer::render(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene)
+{
+	PROFILE_ZONE("Renderer::render");
+	m_frameArena.reset();
+
+	glm::mat4 projectionMatrix = glm::perspectiveFov(view.fov, float(m_frameRect.extent.width), float(m_frameRect.extent.height), kViewZNear, kViewZFar);
+	projectionMatrix[1][1] *= -1.0f; // Vulkan uses right handed NDC with Y axis pointing down, compensate for that.
+	
+	const glm::mat4 viewRotationMatrix = glm::eulerAngleXY(glm::radians(view.pitch), glm::radians(view.yaw));
+	const glm::mat4 sceneRotationMatrix = glm::eulerAngleXY(glm::radians(scene.pitch), glm::radians(scene.yaw));
+	const glm::mat4 viewMatrix = glm::translate(glm::mat4{ 1.0f }, { 0.0f, 0.0f, -view.distance }) * viewRotationMatrix;
+	const glm::vec3 eyePosition = glm::inverse(viewMatrix)[3];
+	
+	VkCommandBuffer commandBuffer = m_commandBuffers[m_frameIndex];
+	VkImage swapchainImage = m_swapchainImages[m_frameIndex];
+	VkFramebuffer framebuffer = m_framebuffers[m_frameIndex];
+
+	VkDescriptorSet uniformsDescriptorSet = m_uniformsDescriptorSets[m_frameIndex];
+
+	if(m_frameCount % kMemoryBudgetQueryInterval == 0) {
+		updateMemoryBudget();
+	}
+	if(scene.memoryReportRequest != m_memoryReportRequest) {
+		// Report is formatted into strings on request only.
+		AllocationCounter::allowFrame();
+		m_memoryReportRequest = scene.memoryReportRequest;
+		updateMemoryBudget();
+		m_memoryStats.report(std::string("Vulkan, ") + m_phyDevice.properties.deviceName);
+	}
+
+	// Collect GPU time of this frame's previous command buffer (which has already completed) & scale resolution accordingly.
+	if(m_taa.timestampQueryPool != VK_NULL_HANDLE && m_taa.pendingQueries[m_frameIndex]) {
+		uint64_t timestamps[2];
+		if(VKSUCCESS(vkGetQueryPoolResults(m_device, m_taa.timestampQueryPool, 2 * m_frameIndex, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT))) {
+			const double frameMilliseconds = double(timestamps[1] - timestamps[0]) * m_phyDevice.properties.limits.timestampPeriod * 1e-6;
+			m_temporalAA.addFrameTime(frameMilliseconds);
+			if(m_dynamicResolution.enabled()) {
+				m_dynamicResolution.update(frameMilliseconds);
+			}
+		}
+	}
+	if(m_exposure.timestampQueryPool != VK_NULL_HANDLE && m_exposure.pendingQueries[m_frameIndex]) {
+		uint64_t timestamps[2];
+		if(VKSUCCESS(vkGetQueryPoolResults(m_device, m_exposure.timestampQueryPool, 2 * m_frameIndex, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT))) {
+			m_autoExposure.addPassTime(double(timestamps[1] - timestamps[0]) * m_phyDevice.properties.limits.timestampPeriod * 1e-6);
+		}
+	}
+	const glm::ivec2 viewportSize = m_dynamicResolution.viewportSize(m_frameRect.extent.width, m_frameRect.extent.height);
+
+	// Update transform uniforms (projection is jittered by a sub-pixel offset with temporal anti-aliasing)
+	{
+		glm::mat4 sceneProjectionMatrix = projectionMatrix;
+		if(m_settings.temporalAA) {
+			*m_taa.uniforms[m_frameIndex].as<TemporalAA::Uniforms>() = m_temporalAA.update(projectionMatrix * viewMatrix, projectionMatrix * viewRotationMatrix, sceneRotationMatrix);
+			sceneProjectionMatrix = m_temporalAA.jitterProjection(projectionMatrix);
+		}
+
+		TransformUniforms* const transformUniforms = m_transformUniforms[m_frameIndex].as<TransformUniforms>();
+		transformUniforms->viewProjectionMatrix = sceneProjectionMatrix * viewMatrix;
+		transformUniforms->skyProjectionMatrix  = sceneProjectionMatrix * viewRotationMatrix;
+		transformUniforms->sceneRotationMatrix  = sceneRotationMatrix;
+	}
+	VkDescriptorSet tonemapDescriptorSet = m_settings.temporalAA ? m_tonemapDescriptorSets[m_temporalAA.historyIndex()] : m_tonemapDescriptorSets[m_frameIndex];
+	
+	// Begin recording current frame command buffer.
+	{
+		VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	
+		vkResetCommandBuffer(commandBuffer, 0);
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	}
+
+	// Switch environment: resident maps are bound immediately, otherwise on-disk bake or source map is loaded in the background.
+	// Bakes are uploaded by this frame's command buffer (uploads of prefetched environments are recorded here as well).
+	// Events below start background tasks (std::async shared state), copy bakes or create images & buffers (recorded in
+	// MemoryStats); they happen on environment switches only, steady state frames skip all of them.
+	if(scene.environment != m_ibl.environment) {
+		AllocationCounter::allowFrame();
+		switchEnvironment(commandBuffer, scene.environment);
+	}
+	if(m_ibl.pendingBake.valid() && m_ibl.pendingBake.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		AllocationCounter::allowFrame();
+		const int environment = m_ibl.loadingBakeEnvironment;
+		m_ibl.loadingBakeEnvironment = -1;
+		if(!uploadPendingEnvironmentBake(commandBuffer, environment) && environment == m_ibl.environment) {
+			loadEnvironment(environment);
+		}
+	}
+	if(m_ibl.pendingEnvironment.valid() && m_ibl.pendingEnvironment.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		AllocationCounter::allowFrame();
+		std::shared_ptr<Image> image = m_ibl.pendingEnvironment.get();
+		if(m_ibl.loadingEnvironment == m_ibl.environment) {
+			queueEnvironmentFilter(image);
+		}
+		m_ibl.loadingEnvironment = -1;
+	}
+
+	// Save & release host visible buffers once all frames which used them have completed.
+	if(m_ibl.readbackBuffer.resource != VK_NULL_HANDLE && m_frameCount >= m_ibl.readbackFrameCount) {
+		AllocationCounter::allowFrame();
+		saveEnvironmentReadback();
+	}
+	for(auto it=m_ibl.stagingBuffers.begin(); it!=m_ibl.stagingBuffers.end();) {
+		if(m_frameCount >= it->second) {
+			destroyBuffer(it->first);
+			it = m_ibl.stagingBuffers.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	// Weight of previous environment while blending after a switch.
+	float environmentBlend = 0.0f;
+	if(m_ibl.blendFrames > 0) {
+		environmentBlend = float(m_ibl.blendFrames--) / float(m_settings.iblBlendFrames + 1);
+	}
+
+	// Point this frame's descriptor sets at current (and previous) environment slot.
+	// This frame's previous command buffer has already completed so its sets can be safely updated.
+	VkDescriptorSet pbrDescriptorSet = m_pbrDescriptorSet;
+	VkDescriptorSet skyboxDescriptorSet = m_skyboxDescriptorSet;
+	if(!m_ibl.slots.empty()) {
+		const std::pair<int, int> boundSlots = { m_ibl.currentSlot, (environmentBlend > 0.0f) ? m_ibl.previousSlot : m_ibl.currentSlot };
+		pbrDescriptorSet = m_ibl.pbrDescriptorSets[m_frameIndex];
+		skyboxDescriptorSet = m_ibl.skyboxDescriptorSets[m_frameIndex];
+		if(m_ibl.boundSlots[m_frameIndex] != boundSlots) {
+			const EnvironmentSlot& current = m_ibl.slots[boundSlots.first];
+			const EnvironmentSlot& previous = m_ibl.slots[boundSlots.second];
+
+			const VkDescriptorImageInfo envTexture = { VK_NULL_HANDLE, current.envTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			const VkDescriptorImageInfo irmapTexture = { VK_NULL_HANDLE, current.irmapTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			const VkDescriptorImageInfo prevEnvTexture = { VK_NULL_HANDLE, previous.envTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			const VkDescriptorImageInfo prevIrmapTexture = { VK_NULL_HANDLE, previous.irmapTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			updateDescriptorSet(pbrDescriptorSet, 4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { envTexture, irmapTexture });
+			updateDescriptorSet(pbrDescriptorSet, 7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { prevEnvTexture, prevIrmapTexture });
+			updateDescriptorSet(skyboxDescriptorSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { envTexture, prevEnvTexture });
+			m_ibl.boundSlots[m_frameIndex] = boundSlots;
+		}
+	}
+
+	// Re-render shadow cascades invalidated by light, scene or camera movement (before any pass which samples them).
+	if(m_settings.shadows) {
+		updateShadows(commandBuffer, view, scene, viewMatrix, sceneRotationMatrix);
+	}
+
+	// Update shading uniforms
+	ShadingUniforms* const shadingUniforms = m_shadingUniforms[m_frameIndex].as<ShadingUniforms>();
+	{
+		PROFILE_ZONE("render: shading uniforms");
+		shadingUniforms->eyePosition = eyePosition;
+		shadingUniforms->environmentBlend = environmentBlend;
+		shadingUniforms->numLights = 0;
+		for(int i=0; i<SceneSettings::NumLights; ++i) {
+			const SceneSettings::Light& light = scene.lights[i];
+			if(light.enabled) {
+				const uint32_t index = shadingUniforms->numLights++;
+				const int firstShadowMap = m_settings.shadows ? m_shadowCascades.firstMap(i) : -1;
+				shadingUniforms->lights[index].direction = light.direction;
+				shadingUniforms->lights[index].shadowMap = firstShadowMap;
+				shadingUniforms->lights[index].radiance = glm::vec4{light.radiance, 0.0f};
+				shadingUniforms->shadowNormalOffsets[index] = glm::vec4{0.0f};
+				for(int cascade=0; cascade<ShadowCascades::NumCascades && firstShadowMap >= 0; ++cascade) {
+					shadingUniforms->shadowNormalOffsets[index][cascade] = m_shadowCascades.normalOffset(firstShadowMap + cascade);
+				}
+			}
+		}
+		for(int map=0; map<ShadowCascades::NumMaps; ++map) {
+			shadingUniforms->shadowMatrices[map] = m_shadowCascades.shadowMatrix(map);
+		}
+		shadingUniforms->numProbes = 0;
+		shadingUniforms->volumeBounds = glm::vec4{0.0f};
+		shadingUniforms->clusterGrid = glm::uvec4{0};
+	}
+
+	// Record pending progressive IBL pre-processing work (or release its resources once no longer in use).
+	const bool iblRefined = !m_iblScheduler.empty() && m_ibl.targetSlot < 0;
+	if(!m_iblScheduler.empty()) {
+		updateIBL(commandBuffer);
+	}
+	else if(m_ibl.releaseFrameCount > 0 && m_frameCount >= m_ibl.releaseFrameCount) {
+		releaseIBLResources();
+		m_ibl.releaseFrameCount = 0;
+	}
+	if(m_settings.iblOctahedralAtlas && (iblRefined || m_atlas.dirty)) {
+		convertSpecularAtlas(commandBuffer);
+	}
+
+	// Capture & pre-filter reflection probes before the render pass which samples them.
+	if(m_probeScheduler.numProbes() > 0) {
+		const bool environmentChanged = iblRefined || environmentBlend > 0.0f || m_ibl.currentSlot != m_probes.environmentSlot;
+		m_probes.environmentSlot = m_ibl.currentSlot;
+		updateReflectionProbes(commandBuffer, scene, sceneRotationMatrix, *shadingUniforms, skyboxDescriptorSet, pbrDescriptorSet, environmentChanged);
+
+		shadingUniforms->numProbes = m_probeScheduler.numProbes();
+		for(int i=0; i<m_probeScheduler.numProbes(); ++i) {
+			shadingUniforms->probes[i] = m_probeScheduler.shadingParameters(i);
+		}
+	}
+
+	// Bake next batch of irradiance volume probes (captures see neither reflection probes nor the volume itself).
+	if(m_irradianceVolume.numProbes() > 0) {
+		const bool environmentChanged = iblRefined || environmentBlend > 0.0f || m_ibl.currentSlot != m_volume.environmentSlot;
+		m_volume.environmentSlot = m_ibl.currentSlot;
+		updateIrradianceVolume(commandBuffer, scene, sceneRotationMatrix, *shadingUniforms, skyboxDescriptorSet, pbrDescriptorSet, environmentChanged);
+
+		shadingUniforms->volumeBounds = m_irradianceVolume.boundsParameters();
+		shadingUniforms->volumeInvExtent = m_irradianceVolume.inverseExtentParameters();
+	}
+
+	// Bin dynamic lights into froxels of this view (after captures, so they are rendered without them).
+	if(m_clusteredLights.numLights() > 0) {
+		updateDynamicLights(viewMatrix, projectionMatrix, *shadingUniforms);
+	}
+	if(m_lights.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, m_lights.timestampQueryPool, 0, 2);
+	}
+	if(m_prepass.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, m_prepass.timestampQueryPool, 0, 2);
+		vkCmdResetQueryPool(commandBuffer, m_prepass.statisticsQueryPool, 0, 1);
+	}
+	if(m_halfPrecision.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, m_halfPrecision.timestampQueryPool, 0, 2);
+	}
+
+	if(m_taa.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, m_taa.timestampQueryPool, 2 * m_frameIndex, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_taa.timestampQueryPool, 2 * m_frameIndex);
+	}
+
+	// Begin render pass
+	{
+		std::array<VkClearValue, 2> clearValues = {};
+		clearValues[1].depthStencil.depth = 1.0f;
+
+		VkRenderPassBeginInfo beginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+		beginInfo.renderPass = m_renderPass;
+		beginInfo.framebuffer = framebuffer;
+		beginInfo.renderArea = m_frameRect;
+		beginInfo.clearValueCount = (uint32_t)clearValues.size();
+		beginInfo.pClearValues = clearValues.data();
+
+		// Begin in main draw subpass
+		vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	}
+
+	// Restrict main pass to scaled viewport (dynamic state of its pipelines with dynamic resolution).
+	if(m_dynamicResolution.enabled()) {
+		const VkViewport viewport = { 0.0f, 0.0f, float(viewportSize.x), float(viewportSize.y), 0.0f, 1.0f };
+		const VkRect2D scissor = { { 0, 0 }, { uint32_t(viewportSize.x), uint32_t(viewportSize.y) } };
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	}
+	
+	// Draw skybox & PBR model
+	if(m_lights.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_lights.timestampQueryPool, 0);
+	}
+	if(m_prepass.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_prepass.timestampQueryPool, 0);
+		vkCmdBeginQuery(commandBuffer, m_prepass.statisticsQueryPool, 0, 0);
+	}
+	if(m_halfPrecision.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_halfPrecision.timestampQueryPool, 0);
+	}
+	if(m_prepass.enabled) {
+		drawScene(commandBuffer, m_prepass.skyboxPipeline, m_prepass.pbrPipeline, uniformsDescriptorSet, skyboxDescriptorSet, pbrDescriptorSet, m_prepass.depthPipeline);
+	}
+	else {
+		drawScene(commandBuffer, m_skyboxPipeline, m_pbrPipeline, uniformsDescriptorSet, skyboxDescriptorSet, pbrDescriptorSet);
+	}
+	if(m_halfPrecision.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_halfPrecision.timestampQueryPool, 1);
+	}
+	if(m_prepass.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdEndQuery(commandBuffer, m_prepass.statisticsQueryPool, 0);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_prepass.timestampQueryPool, 1);
+	}
+	if(m_lights.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_lights.timestampQueryPool, 1);
+	}
+
+	// Transition to tone mapping subpass (temporal anti-aliasing resolves between main & tone mapping render passes instead).
+	if(m_settings.temporalAA) {
+		vkCmdEndRenderPass(commandBuffer);
+		resolveTemporalAA(commandBuffer);
+
+		VkRenderPassBeginInfo beginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+		beginInfo.renderPass = m_taa.tonemapRenderPass;
+		beginInfo.framebuffer = m_taa.tonemapFramebuffers[2 * m_frameIndex + m_temporalAA.historyIndex()];
+		beginInfo.renderArea = m_frameRect;
+		vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	}
+	else {
+		vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+	}
+
+	// Draw a full screen triangle for postprocessing/tone mapping.
+	{
+		const std::array<VkDescriptorSet, 1> descriptorSets = {
+			tonemapDescriptorSet
+		};
+		// Texture coordinates are clamped half a texel inside of scaled viewport, so that filtering does not pick up stale pixels beyond its edge.
+		const glm::vec2 frameSize = glm::vec2{float(m_frameRect.extent.width), float(m_frameRect.extent.height)};
+		const glm::vec4 sceneRegion = glm::vec4{glm::vec2{viewportSize} / frameSize, (glm::vec2{viewportSize} - 0.5f) / frameSize};
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_tonemapPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_tonemapPipelineLayout, 0, (uint32_t)descriptorSets.size(), descriptorSets.data(), 0, nullptr);
+		vkCmdPushConstants(commandBuffer, m_tonemapPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(glm::vec4), &sceneRegion);
+		vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+	}
+
+	// End render pass & command buffer recording
+	vkCmdEndRenderPass(commandBuffer);
+
+	// Build luminance histogram of this frame's scene color & adapt exposure (read by next frame's tone mapping).
+	if(m_settings.autoExposure) {
+		computeAutoExposure(commandBuffer, m_autoExposure.update(glfwGetTime(), viewportSize.x, viewportSize.y));
+		if(m_exposure.timestampQueryPool != VK_NULL_HANDLE) {
+			m_exposure.pendingQueries[m_frameIndex] = true;
+		}
+	}
+	// Copy scene color of the last frame of each half precision benchmark mode.
+	if(m_halfPrecision.readbackRequested) {
+		readbackSceneColor(commandBuffer);
+	}
+	if(m_taa.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_taa.timestampQueryPool, 2 * m_frameIndex + 1);
+		m_taa.pendingQueries[m_frameIndex] = true;
+	}
 	vkEndCommandBuffer(commandBuffer);
 
-	// Submit command buffer to GPU queue for execution.
+	// Submit command buffer to GPU queue for execution.
+	{
+		PROFILE_ZONE("render: submit");
+		VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		vkQueueSubmit(m_queue, 1, &submitInfo, m_submitFences[m_frameIndex]);
+	}
+
+	presentFrame();
+}
+
+void Renderer::runBenchmark(BenchmarkKind kind, GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene)
+{
+	switch(kind) {
+	case BenchmarkKind::IBL:
+		benchmarkIBL();
+		break;
+	case BenchmarkKind::Lights:
+		benchmarkLights(window, view, scene);
+		break;
+	case BenchmarkKind::DepthPrepass:
+		benchmarkDepthPrepass(window, view, scene);
+		break;
+	case BenchmarkKind::HalfPrecision:
+		benchmarkHalfPrecision(window, view, scene);
+		break;
+	default:
+		RendererInterface::runBenchmark(kind, window, view, scene);
+		break;
+	}
+}
+
+void Renderer::benchmarkLights(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene)
+{
+	if(!m_phyDevice.properties.limits.timestampComputeAndGraphics) {
+		throw std::runtime_error("Clustered lighting benchmark requires timestamp query support");
+	}
+
+	{
+		VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		createInfo.queryCount = 2;
+		if(VKFAILED(vkCreateQueryPool(m_device, &createInfo, nullptr, &m_lights.timestampQueryPool))) {
+			throw std::runtime_error("Failed to create timestamp query pool");
+		}
+	}
+
+	LightBenchmark benchmark;
+	for(int numLights : LightBenchmark::lightCounts()) {
+		m_clusteredLights.reset(numLights, m_lights.modelRadius, (int)m_frameRect.extent.width, (int)m_frameRect.extent.height);
+		for(int frame=0; frame<LightBenchmark::NumWarmupFrames + LightBenchmark::NumTimedFrames; ++frame) {
+			render(window, view, scene);
+			glfwPollEvents();
+			if(frame >= LightBenchmark::NumWarmupFrames) {
+				benchmark.addFrame(m_clusteredLights, elapsedMilliseconds(m_lights.timestampQueryPool));
+			}
+		}
+	}
+
+	vkDeviceWaitIdle(m_device);
+	vkDestroyQueryPool(m_device, m_lights.timestampQueryPool, nullptr);
+	m_lights.timestampQueryPool = VK_NULL_HANDLE;
+	benchmark.report("vulkan", m_phyDevice.properties.deviceName);
+}
+
+void Renderer::benchmarkDepthPrepass(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene)
+{
+	if(!m_phyDevice.properties.limits.timestampComputeAndGraphics || !m_phyDevice.features.pipelineStatisticsQuery) {
+		throw std::runtime_error("Depth pre-pass benchmark requires timestamp & pipeline statistics query support");
+	}
+
+	{
+		VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		createInfo.queryCount = 2;
+		if(VKFAILED(vkCreateQueryPool(m_device, &createInfo, nullptr, &m_prepass.timestampQueryPool))) {
+			throw std::runtime_error("Failed to create timestamp query pool");
+		}
+
+		createInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		createInfo.queryCount = 1;
+		createInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+		if(VKFAILED(vkCreateQueryPool(m_device, &createInfo, nullptr, &m_prepass.statisticsQueryPool))) {
+			throw std::runtime_error("Failed to create pipeline statistics query pool");
+		}
+	}
+
+	PrepassBenchmark benchmark;
+	for(bool depthPrepass : { false, true }) {
+		m_prepass.enabled = depthPrepass;
+		for(int frame=0; frame<PrepassBenchmark::NumWarmupFrames + PrepassBenchmark::NumTimedFrames; ++frame) {
+			render(window, view, scene);
+			glfwPollEvents();
+			if(frame >= PrepassBenchmark::NumWarmupFrames) {
+				uint64_t fragmentInvocations = 0;
+				if(vkGetQueryPoolResults(m_device, m_prepass.statisticsQueryPool, 0, 1, sizeof(fragmentInvocations), &fragmentInvocations, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
+					throw std::runtime_error("Failed to read pipeline statistics query results");
+				}
+				benchmark.addFrame(depthPrepass, fragmentInvocations, elapsedMilliseconds(m_prepass.timestampQueryPool));
+			}
+		}
+	}
+	m_prepass.enabled = m_settings.depthPrepass;
+
+	vkDeviceWaitIdle(m_device);
+	vkDestroyQueryPool(m_device, m_prepass.timestampQueryPool, nullptr);
+	vkDestroyQueryPool(m_device, m_prepass.statisticsQueryPool, nullptr);
+	m_prepass.timestampQueryPool = VK_NULL_HANDLE;
+	m_prepass.statisticsQueryPool = VK_NULL_HANDLE;
+	benchmark.report("vulkan", m_phyDevice.properties.deviceName);
+}
+
+void Renderer::benchmarkHalfPrecision(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene)
+{
+	if(!m_halfPrecision.supported) {
+		throw std::runtime_error("Half precision benchmark requires fp16 shader arithmetic support (VK_KHR_shader_float16_int8)");
+	}
+	if(!m_phyDevice.properties.limits.timestampComputeAndGraphics) {
+		throw std::runtime_error("Half precision benchmark requires timestamp query support");
+	}
+
+	{
+		VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		createInfo.queryCount = 2;
+		if(VKFAILED(vkCreateQueryPool(m_device, &createInfo, nullptr, &m_halfPrecision.timestampQueryPool))) {
+			throw std::runtime_error("Failed to create timestamp query pool");
+		}
+	}
+
+	const VkFormat colorFormat = m_renderTargets[0].colorFormat;
+	const VkExtent2D extent = m_frameRect.extent;
+	const size_t numPixels = size_t(extent.width) * size_t(extent.height);
+	const VkDeviceSize bytesPerTexel = (colorFormat == VK_FORMAT_R16G16B16A16_SFLOAT) ? 4 * sizeof(uint16_t) : sizeof(uint32_t);
+	m_halfPrecision.readbackBuffer = createBuffer(numPixels * bytesPerTexel, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, MemoryCategory::Staging);
+
+	HalfPrecisionBenchmark benchmark;
+	const VkPipeline halfPrecisionPipeline = m_pbrPipeline;
+	// Depth pre-pass variant of the PBR pipeline is not swapped, so both modes draw the scene directly.
+	m_prepass.enabled = false;
+	for(bool halfPrecision : { false, true }) {
+		m_pbrPipeline = halfPrecision ? halfPrecisionPipeline : m_halfPrecision.referencePipeline;
+		const int numFrames = HalfPrecisionBenchmark::NumWarmupFrames + HalfPrecisionBenchmark::NumTimedFrames;
+		for(int frame=0; frame<numFrames; ++frame) {
+			m_halfPrecision.readbackRequested = (frame == numFrames - 1);
+			render(window, view, scene);
+			glfwPollEvents();
+			if(frame >= HalfPrecisionBenchmark::NumWarmupFrames) {
+				benchmark.addFrame(halfPrecision, elapsedMilliseconds(m_halfPrecision.timestampQueryPool));
+			}
+		}
+		m_halfPrecision.readbackRequested = false;
+		vkDeviceWaitIdle(m_device);
+
+		// Decode scene color texels of the last frame.
+		const VkMappedMemoryRange invalidateRange = {
+			VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+			nullptr,
+			m_halfPrecision.readbackBuffer.memory,
+			0,
+			VK_WHOLE_SIZE
+		};
+		void* mappedMemory;
+		if(VKFAILED(vkMapMemory(m_device, m_halfPrecision.readbackBuffer.memory, 0, VK_WHOLE_SIZE, 0, &mappedMemory))) {
+			throw std::runtime_error("Failed to map device memory to host address space");
+		}
+		vkInvalidateMappedMemoryRanges(m_device, 1, &invalidateRange);
+		std::vector<float> pixels(3 * numPixels);
+		for(size_t i=0; i<numPixels; ++i) {
+			glm::vec3 color;
+			switch(colorFormat) {
+			case VK_FORMAT_R16G16B16A16_SFLOAT:
+				color = glm::vec3{glm::unpackHalf4x16(reinterpret_cast<const glm::uint64*>(mappedMemory)[i])};
+				break;
+			case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+				color = glm::unpackF2x11_1x10(reinterpret_cast<const glm::uint32*>(mappedMemory)[i]);
+				break;
+			default:
+				color = glm::unpackF3x9_E1x5(reinterpret_cast<const glm::uint32*>(mappedMemory)[i]);
+				break;
+			}
+			pixels[3 * i + 0] = color.r;
+			pixels[3 * i + 1] = color.g;
+			pixels[3 * i + 2] = color.b;
+		}
+		vkUnmapMemory(m_device, m_halfPrecision.readbackBuffer.memory);
+		benchmark.setImage(halfPrecision, int(extent.width), int(extent.height), std::move(pixels), false);
+	}
+	m_pbrPipeline = halfPrecisionPipeline;
+	m_prepass.enabled = m_settings.depthPrepass;
+
+	vkDestroyQueryPool(m_device, m_halfPrecision.timestampQueryPool, nullptr);
+	m_halfPrecision.timestampQueryPool = VK_NULL_HANDLE;
+	destroyBuffer(m_halfPrecision.readbackBuffer);
+	m_halfPrecision.readbackBuffer = {};
+	benchmark.report("vulkan", m_phyDevice.properties.deviceName);
+}
+
+void Renderer::benchmarkIBL()
+{
+	if(!m_phyDevice.properties.limits.timestampComputeAndGraphics) {
+		throw std::runtime_error("IBL benchmark requires timestamp query support");
+	}
+
+	// Friendly binding names for benchmark descriptor sets: pre-processing bindings of setup() followed by comparison bindings.
+	enum BenchmarkDescriptorSetBindingNames : uint32_t {
+		Binding_InputTexture     = 0,
+		Binding_OutputTexture    = 1,
+		Binding_OutputMipTail    = 2,
+		Binding_SampleTable      = 3,
+		Binding_Distribution     = 4,
+		Binding_ReferenceTexture = 5,
+		Binding_Results          = 6,
+	};
+
+	const std::vector<IBLBenchmark::Config> specularConfigs = IBLBenchmark::sweep(IBLBenchmark::Kernel::SpecularFilter);
+	uint32_t maxSpecularLevels = 1;
+	for(const IBLBenchmark::Config& config : specularConfigs) {
+		maxSpecularLevels = std::max(maxSpecularLevels, Utility::numMipmapLevels(uint32_t(config.size), uint32_t(config.size)));
+	}
+
+	IBLBenchmark benchmark;
+
+	// Kernels read their input through the same sampler as in setup() while comparisons need trilinear filtering,
+	// so samplers are not immutable & are provided with each descriptor update.
+	VkSampler computeSampler;
+	VkSampler compareSampler;
+	{
+		VkSamplerCreateInfo createInfo = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+		createInfo.minFilter = VK_FILTER_LINEAR;
+		createInfo.magFilter = VK_FILTER_LINEAR;
+		createInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+		if(VKFAILED(vkCreateSampler(m_device, &createInfo, nullptr, &computeSampler))) {
+			throw std::runtime_error("Failed to create pre-processing sampler");
+		}
+
+		createInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		createInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		createInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		createInfo.maxLod = FLT_MAX;
+		if(VKFAILED(vkCreateSampler(m_device, &createInfo, nullptr, &compareSampler))) {
+			throw std::runtime_error("Failed to create comparison sampler");
+		}
+	}
+
+	// Separate sets for equirectangular conversion, pre-processing kernels & comparisons: both the first two are used
+	// within a single command buffer.
+	VkDescriptorSetLayout setLayout;
+	VkPipelineLayout pipelineLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet convertDescriptorSet;
+	VkDescriptorSet filterDescriptorSet;
+	VkDescriptorSet compareDescriptorSet;
+	{
+		const std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings = {
+			{ Binding_InputTexture, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+			{ Binding_OutputTexture, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+			{ Binding_OutputMipTail, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, maxSpecularLevels-1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+			{ Binding_SampleTable, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+			{ Binding_Distribution, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+			{ Binding_ReferenceTexture, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+			{ Binding_Results, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+		};
+		setLayout = createDescriptorSetLayout(&descriptorSetLayoutBindings);
+
+		const std::vector<VkDescriptorSetLayout> pipelineSetLayouts = {
+			setLayout,
+		};
+		const std::vector<VkPushConstantRange> pipelinePushConstantRanges = {
+			{ VK_SHADER_STAGE_COMPUTE_BIT, 0, (uint32_t)std::max(sizeof(SpecularFilterPushConstants), sizeof(IrradianceFilterPushConstants)) },
+		};
+		pipelineLayout = createPipelineLayout(&pipelineSetLayouts, &pipelinePushConstantRanges);
+
+		const uint32_t numSets = 3;
+		const std::array<VkDescriptorPoolSize, 3> poolSizes = {{
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, numSets * 2 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, numSets * maxSpecularLevels },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, numSets * 3 },
+		}};
+
+		VkDescriptorPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+		createInfo.maxSets = numSets;
+		createInfo.poolSizeCount = (uint32_t)poolSizes.size();
+		createInfo.pPoolSizes = poolSizes.data();
+		if(VKFAILED(vkCreateDescriptorPool(m_device, &createInfo, nullptr, &descriptorPool))) {
+			throw std::runtime_error("Failed to create benchmark descriptor pool");
+		}
+
+		convertDescriptorSet = allocateDescriptorSet(descriptorPool, setLayout);
+		filterDescriptorSet = allocateDescriptorSet(descriptorPool, setLayout);
+		compareDescriptorSet = allocateDescriptorSet(descriptorPool, setLayout);
+	}
+
+	VkQueryPool timestampQueryPool;
+	{
+		VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		createInfo.queryCount = 2;
+		if(VKFAILED(vkCreateQueryPool(m_device, &createInfo, nullptr, &timestampQueryPool))) {
+			throw std::runtime_error("Failed to create timestamp query pool");
+		}
+	}
+
+	std::shared_ptr<Image> envImage = Image::fromFile(m_settings.environments[0]);
+	Texture envTextureEquirect = createTexture(envImage, VK_FORMAT_R32G32B32A32_SFLOAT, MemoryCategory::IBL, 1);
+	Resource<VkBuffer> distributionBuffer = createEnvironmentDistributionBuffer(*envImage);
+
+	const VkDeviceSize resultsSize = IBLBenchmark::NumErrorRoughnessSteps * IBLBenchmark::NumErrorDirections * sizeof(glm::vec2);
+	Resource<VkBuffer> resultsBuffer = createBuffer(resultsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Other);
+	{
+		const VkDescriptorImageInfo inputTexture = { computeSampler, envTextureEquirect.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		const VkDescriptorBufferInfo distributionDescriptor = { distributionBuffer.resource, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo resultsDescriptor = { resultsBuffer.resource, 0, resultsSize };
+		updateDescriptorSet(convertDescriptorSet, Binding_InputTexture, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { inputTexture });
+		updateDescriptorSet(filterDescriptorSet, Binding_Distribution, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { distributionDescriptor });
+		updateDescriptorSet(compareDescriptorSet, Binding_Results, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { resultsDescriptor });
+	}
+
+	// Kernels run with thread group sizes selected during setup.
+	const uint32_t equirectGroupSize = m_workgroups.size(WorkgroupTuner::Equirect2Cube);
+	const uint32_t spmapGroupSize = m_workgroups.size(WorkgroupTuner::SpecularFilter);
+	const uint32_t irmapGroupSize = m_workgroups.size(WorkgroupTuner::Irradiance);
+	const uint32_t spbrdfGroupSize = m_workgroups.size(WorkgroupTuner::SpecularBRDF);
+
+	VkPipeline equirectToCubePipeline = createEquirectToCubePipeline(pipelineLayout, equirectGroupSize);
+	VkPipeline comparePipeline = createComputePipeline("shaders/spirv/iblcompare_cs.spv", pipelineLayout);
+	VkPipeline compareLUTPipeline = createComputePipeline("shaders/spirv/brdfcompare_cs.spv", pipelineLayout);
+
+	// Unfiltered source of the reference specular map is kept for irradiance kernels.
+	Texture sourceTexture = {};
+
+	// Specular pre-filter: each run converts equirectangular environment to a cube map of swept size, generates its mipmaps
+	// & pre-filters the mip chain (as non-progressive setup does).
+	{
+		Texture referenceTexture = {};
+		for(size_t i=0; i<specularConfigs.size(); ++i) {
+			const IBLBenchmark::Config& config = specularConfigs[i];
+
+			Texture envTextureUnfiltered = createTexture(config.size, config.size, 6, VK_FORMAT_R16G16B16A16_SFLOAT, MemoryCategory::IBL, 0, VK_IMAGE_USAGE_STORAGE_BIT);
+			Texture envTexture = createTexture(config.size, config.size, 6, VK_FORMAT_R16G16B16A16_SFLOAT, MemoryCategory::IBL, 0, VK_IMAGE_USAGE_STORAGE_BIT);
+
+			const uint32_t numMipTailLevels = envTexture.levels - 1;
+			const uint32_t tailLevel = IBLScheduler::specularMipTailLevel(config.size, envTexture.levels, spmapGroupSize);
+
+			// Buffer is always bound since the shader references it even if the table is disabled.
+			Resource<VkBuffer> sampleTableBuffer;
+			{
+				const SpecularSampleTable sampleTable = SpecularSampleTable::build(config.size, envTexture.levels, config.sampleErrorTarget, config.numSamples);
+				std::vector<char> data(sampleTable.bufferSize());
+				sampleTable.copyToBuffer(data.data());
+				sampleTableBuffer = createBuffer(data.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::IBL);
+				copyToDevice(sampleTableBuffer.memory, data.data(), data.size());
+			}
+
+			SpecularFilterSpecialization specializationData = { numMipTailLevels, uint32_t(config.numSamples), config.sampleErrorTarget, VK_FALSE, spmapGroupSize, spmapGroupSize,
+				m_settings.iblSampleTables ? VK_TRUE : VK_FALSE };
+			VkPipeline pipeline = createSpecularFilterPipeline(pipelineLayout, specializationData);
+
+			specializationData.foldedMipTail = VK_TRUE;
+			specializationData.localSizeX = kSpecularMipTailGroupSize;
+			specializationData.localSizeY = 1;
+			VkPipeline tailPipeline = createSpecularFilterPipeline(pipelineLayout, specializationData);
+
+			std::vector<VkImageView> envTextureMipTailViews;
+			{
+				std::vector<VkDescriptorImageInfo> envTextureMipTailDescriptors;
+				for(uint32_t level=1; level<envTexture.levels; ++level) {
+					envTextureMipTailViews.push_back(createTextureView(envTexture, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, level, 1));
+					envTextureMipTailDescriptors.push_back(VkDescriptorImageInfo{ VK_NULL_HANDLE, envTextureMipTailViews[level-1], VK_IMAGE_LAYOUT_GENERAL });
+				}
+
+				const VkDescriptorImageInfo convertOutputTexture = { VK_NULL_HANDLE, envTextureUnfiltered.view, VK_IMAGE_LAYOUT_GENERAL };
+				const VkDescriptorImageInfo inputTexture = { computeSampler, envTextureUnfiltered.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+				const VkDescriptorBufferInfo sampleTableDescriptor = { sampleTableBuffer.resource, 0, VK_WHOLE_SIZE };
+				updateDescriptorSet(convertDescriptorSet, Binding_OutputTexture, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, { convertOutputTexture });
+				updateDescriptorSet(filterDescriptorSet, Binding_InputTexture, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { inputTexture });
+				updateDescriptorSet(filterDescriptorSet, Binding_OutputMipTail, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, envTextureMipTailDescriptors);
+				updateDescriptorSet(filterDescriptorSet, Binding_SampleTable, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { sampleTableDescriptor });
+			}
+
+			double gpuTime = std::numeric_limits<double>::max();
+			for(int run=0; run<IBLBenchmark::NumTimedRuns; ++run) {
+				VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+				vkCmdResetQueryPool(commandBuffer, timestampQueryPool, 0, 2);
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, 0);
+
+				// Convert equirectangular environment & generate mipmaps.
+				{
+					const auto preDispatchBarrier = ImageMemoryBarrier(envTextureUnfiltered, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL).mipLevels(0, 1);
+					pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { preDispatchBarrier });
+
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, equirectToCubePipeline);
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &convertDescriptorSet, 0, nullptr);
+					vkCmdDispatch(commandBuffer, config.size/equirectGroupSize, config.size/equirectGroupSize, 6);
+
+					const auto postDispatchBarrier = ImageMemoryBarrier(envTextureUnfiltered, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL).mipLevels(0, 1);
+					pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, { postDispatchBarrier });
+
+					generateMipmaps(commandBuffer, envTextureUnfiltered, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+				}
+
+				// Copy base mipmap level into destination environment map.
+				{
+					const std::initializer_list<ImageMemoryBarrier> preCopyBarriers = {
+						ImageMemoryBarrier(envTextureUnfiltered, 0, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL).mipLevels(0, 1),
+						ImageMemoryBarrier(envTexture, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL),
+					};
+					const std::initializer_list<ImageMemoryBarrier> postCopyBarriers = {
+						ImageMemoryBarrier(envTextureUnfiltered, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL).mipLevels(0, 1),
+						ImageMemoryBarrier(envTexture, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL),
+					};
+					pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, preCopyBarriers);
+
+					VkImageCopy copyRegion = {};
+					copyRegion.extent = { envTexture.width, envTexture.height, 1 };
+					copyRegion.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+					copyRegion.srcSubresource.layerCount = envTexture.layers;
+					copyRegion.dstSubresource = copyRegion.srcSubresource;
+					vkCmdCopyImage(commandBuffer,
+						envTextureUnfiltered.image.resource, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+						envTexture.image.resource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+						1, &copyRegion);
+
+					pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, postCopyBarriers);
+				}
+
+				// Pre-filter rest of the mip chain.
+				{
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &filterDescriptorSet, 0, nullptr);
+
+					const float deltaRoughness = 1.0f / std::max(float(numMipTailLevels), 1.0f);
+					for(uint32_t level=1, size=config.size/2; level<tailLevel; ++level, size/=2) {
+						const uint32_t numGroups = size / spmapGroupSize;
+
+						const SpecularFilterPushConstants pushConstants = { level-1, level * deltaRoughness, 0, 0, deltaRoughness };
+						vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SpecularFilterPushConstants), &pushConstants);
+						vkCmdDispatch(commandBuffer, numGroups, numGroups, 6);
+					}
+					if(tailLevel < envTexture.levels) {
+						dispatchSpecularMipTail(commandBuffer, tailPipeline, pipelineLayout, envTexture, tailLevel);
+					}
+				}
+
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, 1);
+
+				const auto barrier = ImageMemoryBarrier(envTexture, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+				pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { barrier });
+
+				executeImmediateCommandBuffer(commandBuffer);
+				gpuTime = std::min(gpuTime, elapsedMilliseconds(timestampQueryPool));
+			}
+
+			if(i == 0) {
+				benchmark.addReference(config, gpuTime);
+				referenceTexture = envTexture;
+				sourceTexture = envTextureUnfiltered;
+			}
+			else {
+				const double error = compareIBLMaps(comparePipeline, pipelineLayout, compareDescriptorSet, compareSampler, envTexture, referenceTexture, resultsBuffer,
+					IBLBenchmark::NumErrorDirections/64, IBLBenchmark::NumErrorRoughnessSteps);
+				benchmark.addResult(config, gpuTime, error);
+				destroyTexture(envTexture);
+				destroyTexture(envTextureUnfiltered);
+			}
+
+			for(VkImageView mipTailView : envTextureMipTailViews) {
+				vkDestroyImageView(m_device, mipTailView, nullptr);
+			}
+			vkDestroyPipeline(m_device, pipeline, nullptr);
+			vkDestroyPipeline(m_device, tailPipeline, nullptr);
+			destroyBuffer(sampleTableBuffer);
+		}
+
+		destroyTexture(referenceTexture);
+	}
+
+	// Irradiance map: both sampling strategies integrate the same source (base mip level, as non-progressive setup does).
+	{
+		const std::vector<IBLBenchmark::Config> configs = IBLBenchmark::sweep(IBLBenchmark::Kernel::Irradiance);
+
+		const VkDescriptorImageInfo inputTexture = { computeSampler, sourceTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		updateDescriptorSet(filterDescriptorSet, Binding_InputTexture, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { inputTexture });
+
+		Texture referenceTexture = {};
+		for(size_t i=0; i<configs.size(); ++i) {
+			const IBLBenchmark::Config& config = configs[i];
+
+			VkPipeline pipeline = createIrradianceFilterPipeline(pipelineLayout, uint32_t(config.numSamples), config.envImportanceSampling, irmapGroupSize);
+
+			Texture irmapTexture = createTexture(config.size, config.size, 6, VK_FORMAT_R16G16B16A16_SFLOAT, MemoryCategory::IBL, 1, VK_IMAGE_USAGE_STORAGE_BIT);
+			const VkDescriptorImageInfo outputTexture = { VK_NULL_HANDLE, irmapTexture.view, VK_IMAGE_LAYOUT_GENERAL };
+			updateDescriptorSet(filterDescriptorSet, Binding_OutputTexture, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, { outputTexture });
+
+			double gpuTime = std::numeric_limits<double>::max();
+			for(int run=0; run<IBLBenchmark::NumTimedRuns; ++run) {
+				VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+				{
+					const auto preDispatchBarrier = ImageMemoryBarrier(irmapTexture, 0, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+					pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { preDispatchBarrier });
+
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &filterDescriptorSet, 0, nullptr);
+					vkCmdResetQueryPool(commandBuffer, timestampQueryPool, 0, 2);
+					vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, 0);
+
+					// Each batch blends into the result of the previous one.
+					for(int batch=0; batch<config.numBatches; ++batch) {
+						const IrradianceFilterPushConstants pushConstants = { 0, uint32_t(batch), uint32_t(config.numBatches), 0.0f };
+						vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(IrradianceFilterPushConstants), &pushConstants);
+						vkCmdDispatch(commandBuffer, config.size/irmapGroupSize, config.size/irmapGroupSize, 6);
+
+						const auto batchBarrier = ImageMemoryBarrier(irmapTexture, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+						pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { batchBarrier });
+					}
+
+					vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, 1);
+
+					const auto postDispatchBarrier = ImageMemoryBarrier(irmapTexture, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+					pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { postDispatchBarrier });
+				}
+				executeImmediateCommandBuffer(commandBuffer);
+				gpuTime = std::min(gpuTime, elapsedMilliseconds(timestampQueryPool));
+			}
+
+			if(i == 0) {
+				benchmark.addReference(config, gpuTime);
+				referenceTexture = irmapTexture;
+			}
+			else {
+				const double error = compareIBLMaps(comparePipeline, pipelineLayout, compareDescriptorSet, compareSampler, irmapTexture, referenceTexture, resultsBuffer,
+					IBLBenchmark::NumErrorDirections/64, 1);
+				benchmark.addResult(config, gpuTime, error);
+				destroyTexture(irmapTexture);
+			}
+			vkDestroyPipeline(m_device, pipeline, nullptr);
+		}
+
+		destroyTexture(referenceTexture);
+	}
+
+	// Split-sum BRDF LUT.
+	{
+		const std::vector<IBLBenchmark::Config> configs = IBLBenchmark::sweep(IBLBenchmark::Kernel::SpecularBRDF);
+
+		Texture referenceTexture = {};
+		for(size_t i=0; i<configs.size(); ++i) {
+			const IBLBenchmark::Config& config = configs[i];
+
+			VkPipeline pipeline = createSpecularBRDFPipeline(pipelineLayout, uint32_t(config.numSamples), spbrdfGroupSize);
+
+			Texture spBRDF_LUT = createTexture(config.size, config.size, 1, VK_FORMAT_R16G16_SFLOAT, MemoryCategory::IBL, 1, VK_IMAGE_USAGE_STORAGE_BIT);
+			const VkDescriptorImageInfo outputTexture = { VK_NULL_HANDLE, spBRDF_LUT.view, VK_IMAGE_LAYOUT_GENERAL };
+			updateDescriptorSet(filterDescriptorSet, Binding_OutputTexture, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, { outputTexture });
+
+			double gpuTime = std::numeric_limits<double>::max();
+			for(int run=0; run<IBLBenchmark::NumTimedRuns; ++run) {
+				VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+				{
+					const auto preDispatchBarrier = ImageMemoryBarrier(spBRDF_LUT, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+					pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { preDispatchBarrier });
+
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &filterDescriptorSet, 0, nullptr);
+					vkCmdResetQueryPool(commandBuffer, timestampQueryPool, 0, 2);
+					vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, 0);
+					vkCmdDispatch(commandBuffer, config.size/spbrdfGroupSize, config.size/spbrdfGroupSize, 1);
+					vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, 1);
+
+					const auto postDispatchBarrier = ImageMemoryBarrier(spBRDF_LUT, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+					pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { postDispatchBarrier });
+				}
+				executeImmediateCommandBuffer(commandBuffer);
+				gpuTime = std::min(gpuTime, elapsedMilliseconds(timestampQueryPool));
+			}
+
+			if(i == 0) {
+				benchmark.addReference(config, gpuTime);
+				referenceTexture = spBRDF_LUT;
+			}
+			else {
+				const double error = compareIBLMaps(compareLUTPipeline, pipelineLayout, compareDescriptorSet, compareSampler, spBRDF_LUT, referenceTexture, resultsBuffer,
+					IBLBenchmark::ErrorLUTGridSize/8, IBLBenchmark::ErrorLUTGridSize/8);
+				benchmark.addResult(config, gpuTime, error);
+				destroyTexture(spBRDF_LUT);
+			}
+			vkDestroyPipeline(m_device, pipeline, nullptr);
+		}
+
+		destroyTexture(referenceTexture);
+	}
+
+	benchmark.report("vulkan", m_phyDevice.properties.deviceName);
+
+	vkDestroyPipeline(m_device, equirectToCubePipeline, nullptr);
+	vkDestroyPipeline(m_device, comparePipeline, nullptr);
+	vkDestroyPipeline(m_device, compareLUTPipeline, nullptr);
+	destroyTexture(sourceTexture);
+	destroyTexture(envTextureEquirect);
+	destroyBuffer(distributionBuffer);
+	destroyBuffer(resultsBuffer);
+	vkDestroyQueryPool(m_device, timestampQueryPool, nullptr);
+	vkDestroyDescriptorPool(m_device, descriptorPool, nullptr);
+	vkDestroyPipelineLayout(m_device, pipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, setLayout, nullptr);
+	vkDestroySampler(m_device, computeSampler, nullptr);
+	vkDestroySampler(m_device, compareSampler, nullptr);
+}
+
+void Renderer::drawScene(VkCommandBuffer commandBuffer, VkPipeline skyboxPipeline, VkPipeline pbrPipeline, VkDescriptorSet uniformsDescriptorSet, VkDescriptorSet skyboxDescriptorSet, VkDescriptorSet pbrDescriptorSet,
+	VkPipeline depthPipeline) const
+{
+	PROFILE_ZONE("Renderer::drawScene");
+	const VkDeviceSize zeroOffset = 0;
+
+	auto drawSkybox = [&]() {
+		const std::array<VkDescriptorSet, 2> descriptorSets = {
+			uniformsDescriptorSet,
+			skyboxDescriptorSet,
+		};
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skyboxPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_skyboxPipelineLayout, 0, (uint32_t)descriptorSets.size(), descriptorSets.data(), 0, nullptr);
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_skybox.vertexBuffer.resource, &zeroOffset);
+		vkCmdBindIndexBuffer(commandBuffer, m_skybox.indexBuffer.resource, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(commandBuffer, m_skybox.numElements, 1, 0, 0, 0);
+	};
+
+	// Draw skybox first, unless depth pre-pass is to be followed by skybox drawn last.
+	if(depthPipeline == VK_NULL_HANDLE) {
+		drawSkybox();
+	}
+
+	// Draw PBR model (depth pre-pass uses the same uniforms set & PBR pipeline layout, but only the position stream).
+	{
+		const std::array<VkDescriptorSet, 2> descriptorSets = {
+			uniformsDescriptorSet,
+			pbrDescriptorSet,
+		};
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pbrPipelineLayout, 0, (uint32_t)descriptorSets.size(), descriptorSets.data(), 0, nullptr);
+		vkCmdBindIndexBuffer(commandBuffer, m_pbrModel.indexBuffer.resource, 0, VK_INDEX_TYPE_UINT32);
+		if(depthPipeline != VK_NULL_HANDLE) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPipeline);
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_pbrModel.positionBuffer.resource, &zeroOffset);
+			vkCmdDrawIndexed(commandBuffer, m_pbrModel.numElements, 1, 0, 0, 0);
+		}
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pbrPipeline);
+		if(m_pbrModel.positionBuffer.resource != VK_NULL_HANDLE) {
+			const VkBuffer vertexBuffers[] = { m_pbrModel.positionBuffer.resource, m_pbrModel.vertexBuffer.resource };
+			const VkDeviceSize vertexBufferOffsets[] = { 0, 0 };
+			vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, vertexBufferOffsets);
+		}
+		else {
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_pbrModel.vertexBuffer.resource, &zeroOffset);
+		}
+		vkCmdDrawIndexed(commandBuffer, m_pbrModel.numElements, 1, 0, 0, 0);
+	}
+
+	if(depthPipeline != VK_NULL_HANDLE) {
+		drawSkybox();
+	}
+}
+
+void Renderer::updateReflectionProbes(VkCommandBuffer commandBuffer, const SceneSettings& scene, const glm::mat4& sceneRotationMatrix, const ShadingUniforms& shadingUniforms,
+	VkDescriptorSet skyboxDescriptorSet, VkDescriptorSet pbrDescriptorSet, bool environmentChanged)
+{
+	PROFILE_ZONE("Renderer::updateReflectionProbes");
+	m_probeScheduler.updateScene(scene, environmentChanged);
+
+	ProbeScheduler::Capture capture;
+	if(!m_probeScheduler.nextCapture(capture)) {
+		return;
+	}
+
+	// Projection is not flipped so that faces end up in the same orientation as when rendered by OpenGL.
+	const glm::vec3& probePosition = m_probeScheduler.position(capture.probe);
+	const glm::mat4 projectionMatrix = glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 1000.0f);
+	const glm::mat4 viewMatrix = ProbeScheduler::faceViewMatrix(probePosition, capture.face);
+
+	{
+		TransformUniforms* const transformUniforms = m_probes.transformUniforms[m_frameIndex].as<TransformUniforms>();
+		transformUniforms->viewProjectionMatrix = projectionMatrix * viewMatrix;
+		transformUniforms->skyProjectionMatrix  = projectionMatrix * glm::mat4{glm::mat3{viewMatrix}};
+		transformUniforms->sceneRotationMatrix  = sceneRotationMatrix;
+	}
+
+	// Captures are lit by the global environment only so that probes never feed back into each other.
+	{
+		ShadingUniforms* const captureShadingUniforms = m_probes.shadingUniforms[m_frameIndex].as<ShadingUniforms>();
+		*captureShadingUniforms = shadingUniforms;
+		captureShadingUniforms->eyePosition = probePosition;
+		captureShadingUniforms->numProbes = 0;
+	}
+
+	{
+		std::array<VkClearValue, 2> clearValues = {};
+		clearValues[1].depthStencil.depth = 1.0f;
+
+		VkRenderPassBeginInfo beginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+		beginInfo.renderPass = m_probes.captureRenderPass;
+		beginInfo.framebuffer = m_probes.captureFramebuffers[capture.face];
+		beginInfo.renderArea.extent = { m_probes.captureTexture.width, m_probes.captureTexture.height };
+		beginInfo.clearValueCount = (uint32_t)clearValues.size();
+		beginInfo.pClearValues = clearValues.data();
+
+		vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		drawScene(commandBuffer, m_probes.captureSkyboxPipeline, m_probes.capturePbrPipeline, m_probes.uniformsDescriptorSets[m_frameIndex], skyboxDescriptorSet, pbrDescriptorSet);
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	if(capture.filter) {
+		filterReflectionProbe(commandBuffer, capture.probe);
+	}
+}
+
+void Renderer::filterReflectionProbe(VkCommandBuffer commandBuffer, int probe) const
+{
+	const Texture& captureTexture = m_probes.captureTexture;
+	const Texture& envTarget = m_probes.specularTextures;
+	const Texture& irmapTarget = m_probes.irradianceTextures;
+	const uint32_t baseLayer = 6 * probe;
+
+	// Copy base level of all captured faces into probe's layers, then build capture mip chain for filtered importance sampling.
+	{
+		const auto preCopyBarrier = ImageMemoryBarrier(envTarget, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL).mipLevels(0, 1).arrayLayers(baseLayer, 6);
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, { preCopyBarrier });
+
+		VkImageCopy copyRegion = {};
+		copyRegion.extent = { envTarget.width, envTarget.height, 1 };
+		copyRegion.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 6 };
+		copyRegion.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, baseLayer, 6 };
+		vkCmdCopyImage(commandBuffer,
+			captureTexture.image.resource, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			envTarget.image.resource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &copyRegion);
+
+		generateMipmaps(commandBuffer, captureTexture, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+		const std::initializer_list<ImageMemoryBarrier> preDispatchBarriers = {
+			ImageMemoryBarrier(envTarget, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL).mipLevels(0, 1).arrayLayers(baseLayer, 6),
+			ImageMemoryBarrier(envTarget, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL).mipLevels(1).arrayLayers(baseLayer, 6),
+			ImageMemoryBarrier(irmapTarget, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL).arrayLayers(baseLayer, 6),
+		};
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, preDispatchBarriers);
+	}
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ibl.pipelineLayout, 0, 1, &m_probes.filterDescriptorSets[probe], 0, nullptr);
+
+	// Same as startup specular pre-filter (whole faces at a time).
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ibl.spmapPipeline);
+
+		const uint32_t groupSize = m_workgroups.size(WorkgroupTuner::SpecularFilter);
+		const float deltaRoughness = 1.0f / std::max(float(envTarget.levels-1), 1.0f);
+		for(uint32_t level=1, size=envTarget.width/2; level<m_probes.tailLevel; ++level, size/=2) {
+			const uint32_t numGroups = size / groupSize;
+
+			const SpecularFilterPushConstants pushConstants = { level-1, level * deltaRoughness, 0, 0, deltaRoughness };
+			vkCmdPushConstants(commandBuffer, m_ibl.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SpecularFilterPushConstants), &pushConstants);
+			vkCmdDispatch(commandBuffer, numGroups, numGroups, 6);
+		}
+		if(m_probes.tailLevel < envTarget.levels) {
+			dispatchSpecularMipTail(commandBuffer, m_ibl.spmapTailPipeline, m_ibl.pipelineLayout, envTarget, m_probes.tailLevel);
+		}
+	}
+
+	{
+		const uint32_t groupSize = m_workgroups.size(WorkgroupTuner::Irradiance);
+		const IrradianceFilterPushConstants pushConstants = { 0, 0, 1, m_probes.irradianceSourceLod };
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_probes.irmapPipeline);
+		vkCmdPushConstants(commandBuffer, m_ibl.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(IrradianceFilterPushConstants), &pushConstants);
+		vkCmdDispatch(commandBuffer, irmapTarget.width/groupSize, irmapTarget.height/groupSize, 6);
+	}
+
+	{
+		const std::initializer_list<ImageMemoryBarrier> postDispatchBarriers = {
+			ImageMemoryBarrier(envTarget, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL).mipLevels(1).arrayLayers(baseLayer, 6),
+			ImageMemoryBarrier(irmapTarget, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL).arrayLayers(baseLayer, 6),
+		};
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, postDispatchBarriers);
+	}
+}
+	
+void Renderer::updateIrradianceVolume(VkCommandBuffer commandBuffer, const SceneSettings& scene, const glm::mat4& sceneRotationMatrix, const ShadingUniforms& shadingUniforms,
+	VkDescriptorSet skyboxDescriptorSet, VkDescriptorSet pbrDescriptorSet, bool environmentChanged)
+{
+	PROFILE_ZONE("Renderer::updateIrradianceVolume");
+	m_irradianceVolume.updateScene(scene, environmentChanged, m_volume.modelRadius);
+
+	FrameVector<int> batch{FrameAllocator<int>(m_frameArena)};
+	batch.reserve(kVolumeBatchSize);
+	if(m_irradianceVolume.nextBatch(kVolumeBatchSize, batch) == 0) {
+		return;
+	}
+
+	// Projection is not flipped so that faces end up in the same orientation as when rendered by OpenGL.
+	const glm::mat4 projectionMatrix = glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 1000.0f);
+
+	glm::ivec4* const coords = reinterpret_cast<glm::ivec4*>(reinterpret_cast<uint8_t*>(m_volume.coordsMemoryPtr) + m_frameIndex * m_volume.coordsStride);
+	for(uint32_t i=0; i<batch.size(); ++i) {
+		const uint32_t capture = m_frameIndex * kVolumeBatchSize + i;
+		const glm::vec3 probePosition = m_irradianceVolume.probePosition(batch[i]);
+		coords[i] = glm::ivec4{m_irradianceVolume.probeCoord(batch[i]), 0};
+
+		// Captures are lit by the global environment only.
+		{
+			ShadingUniforms* const captureShadingUniforms = m_volume.shadingUniforms[capture].as<ShadingUniforms>();
+			*captureShadingUniforms = shadingUniforms;
+			captureShadingUniforms->eyePosition = probePosition;
+			captureShadingUniforms->numProbes = 0;
+			captureShadingUniforms->volumeBounds = glm::vec4{0.0f};
+		}
+
+		for(uint32_t face=0; face<6; ++face) {
+			const glm::mat4 viewMatrix = ProbeScheduler::faceViewMatrix(probePosition, face);
+			{
+				TransformUniforms* const transformUniforms = m_volume.transformUniforms[6 * capture + face].as<TransformUniforms>();
+				transformUniforms->viewProjectionMatrix = projectionMatrix * viewMatrix;
+				transformUniforms->skyProjectionMatrix  = projectionMatrix * glm::mat4{glm::mat3{viewMatrix}};
+				transformUniforms->sceneRotationMatrix  = sceneRotationMatrix;
+			}
+
+			std::array<VkClearValue, 2> clearValues = {};
+			clearValues[1].depthStencil.depth = 1.0f;
+
+			VkRenderPassBeginInfo beginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+			beginInfo.renderPass = m_volume.captureRenderPass;
+			beginInfo.framebuffer = m_volume.captureFramebuffers[6 * i + face];
+			beginInfo.renderArea.extent = { kVolumeCaptureSize, kVolumeCaptureSize };
+			beginInfo.clearValueCount = (uint32_t)clearValues.size();
+			beginInfo.pClearValues = clearValues.data();
+
+			vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+			drawScene(commandBuffer, m_volume.captureSkyboxPipeline, m_volume.capturePbrPipeline, m_volume.uniformsDescriptorSets[6 * capture + face], skyboxDescriptorSet, pbrDescriptorSet);
+			vkCmdEndRenderPass(commandBuffer);
+		}
+	}
+
+	// Project all captures of the batch at once (one thread group per probe).
+	{
+		const auto preDispatchBarrier = ImageMemoryBarrier(m_volume.texture, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { preDispatchBarrier });
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_volume.shprojectPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ibl.pipelineLayout, 0, 1, &m_volume.projectDescriptorSets[m_frameIndex], 0, nullptr);
+		vkCmdDispatch(commandBuffer, (uint32_t)batch.size(), 1, 1);
+
+		const auto postDispatchBarrier = ImageMemoryBarrier(m_volume.texture, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, { postDispatchBarrier });
+	}
+}
+	
+void Renderer::updateDynamicLights(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, ShadingUniforms& shadingUniforms)
+{
+	PROFILE_ZONE("Renderer::updateDynamicLights");
+	// Tiles are in window coordinates of the (possibly scaled) viewport.
+	const glm::ivec2 viewportSize = m_dynamicResolution.viewportSize(m_frameRect.extent.width, m_frameRect.extent.height);
+	m_clusteredLights.update(glfwGetTime(), viewMatrix, projectionMatrix, viewportSize.x, viewportSize.y, kViewZNear, kViewZFar);
+
+	// This frame's range of light buffer is no longer in use (its previous command buffer has already completed).
+	const std::vector<ClusteredLights::Light>& lights = m_clusteredLights.lights();
+	const std::vector<glm::uvec2>& grid = m_clusteredLights.grid();
+	const std::vector<uint32_t>& indices = m_clusteredLights.indices();
+	uint8_t* const memoryPtr = reinterpret_cast<uint8_t*>(m_lights.memoryPtr) + m_frameIndex * m_lights.stride;
+	std::memcpy(memoryPtr, lights.data(), lights.size() * sizeof(ClusteredLights::Light));
+	std::memcpy(memoryPtr + m_lights.gridOffset, grid.data(), grid.size() * sizeof(glm::uvec2));
+	if(!indices.empty()) {
+		std::memcpy(memoryPtr + m_lights.indexOffset, indices.data(), indices.size() * sizeof(uint32_t));
+	}
+
+	shadingUniforms.clusterDepth = m_clusteredLights.depthParameters();
+	shadingUniforms.clusterSlices = m_clusteredLights.sliceParameters();
+	shadingUniforms.clusterGrid = m_clusteredLights.gridParameters();
+}
+
+void Renderer::updateShadows(VkCommandBuffer commandBuffer, const ViewSettings& view, const SceneSettings& scene, const glm::mat4& viewMatrix, const glm::mat4& sceneRotationMatrix)
+{
+	PROFILE_ZONE("Renderer::updateShadows");
+	// Collect render times of maps updated by this frame's previous command buffer (which has already completed).
+	const uint32_t firstQuery = 2 * ShadowCascades::NumMaps * m_frameIndex;
+	if(m_shadows.timestampQueryPool != VK_NULL_HANDLE) {
+		for(int map=0; map<ShadowCascades::NumMaps; ++map) {
+			if(m_shadows.pendingQueries[ShadowCascades::NumMaps * m_frameIndex + map]) {
+				uint64_t timestamps[2];
+				if(VKSUCCESS(vkGetQueryPoolResults(m_device, m_shadows.timestampQueryPool, firstQuery + 2 * map, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT))) {
+					m_shadowCascades.addRenderTime(map, double(timestamps[1] - timestamps[0]) * m_phyDevice.properties.limits.timestampPeriod * 1e-6);
+				}
+				m_shadows.pendingQueries[ShadowCascades::NumMaps * m_frameIndex + map] = false;
+			}
+		}
+	}
+
+	m_shadowCascades.update(scene, viewMatrix, view.fov, float(m_frameRect.extent.width) / float(m_frameRect.extent.height), kViewZNear);
+
+	bool dirty = false;
+	for(int map=0; map<ShadowCascades::NumMaps; ++map) {
+		dirty = dirty || m_shadowCascades.dirty(map);
+	}
+	if(!dirty) {
+		return;
+	}
+	if(m_shadows.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, m_shadows.timestampQueryPool, firstQuery, 2 * ShadowCascades::NumMaps);
+	}
+
+	// Cascade matrices are in OpenGL clip space, remap depth to Vulkan's 0 to 1 range so that stored depth matches shadow matrices.
+	const glm::mat4 depthCorrectionMatrix = glm::scale(glm::translate(glm::mat4{1.0f}, glm::vec3{0.0f, 0.0f, 0.5f}), glm::vec3{1.0f, 1.0f, 0.5f});
+
+	const VkDeviceSize zeroOffset = 0;
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_shadows.pipeline);
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_pbrModel.positionBuffer.resource, &zeroOffset);
+	vkCmdBindIndexBuffer(commandBuffer, m_pbrModel.indexBuffer.resource, 0, VK_INDEX_TYPE_UINT32);
+
+	for(int map=0; map<ShadowCascades::NumMaps; ++map) {
+		if(!m_shadowCascades.dirty(map)) {
+			continue;
+		}
+		const glm::mat4 shadowViewProjectionMatrix = depthCorrectionMatrix * m_shadowCascades.renderMatrix(map) * sceneRotationMatrix;
+
+		VkClearValue clearValue = {};
+		clearValue.depthStencil.depth = 1.0f;
+
+		VkRenderPassBeginInfo beginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+		beginInfo.renderPass = m_shadows.renderPass;
+		beginInfo.framebuffer = m_shadows.framebuffers[map];
+		beginInfo.renderArea = { { 0, 0 }, { m_shadows.texture.width, m_shadows.texture.height } };
+		beginInfo.clearValueCount = 1;
+		beginInfo.pClearValues = &clearValue;
+
+		if(m_shadows.timestampQueryPool != VK_NULL_HANDLE) {
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_shadows.timestampQueryPool, firstQuery + 2 * map);
+		}
+		vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdPushConstants(commandBuffer, m_shadows.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &shadowViewProjectionMatrix);
+		vkCmdDrawIndexed(commandBuffer, m_pbrModel.numElements, 1, 0, 0, 0);
+		vkCmdEndRenderPass(commandBuffer);
+		if(m_shadows.timestampQueryPool != VK_NULL_HANDLE) {
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_shadows.timestampQueryPool, firstQuery + 2 * map + 1);
+			m_shadows.pendingQueries[ShadowCascades::NumMaps * m_frameIndex + map] = true;
+		}
+	}
+}
+
+void Renderer::resolveTemporalAA(VkCommandBuffer commandBuffer) const
+{
+	PROFILE_ZONE("Renderer::resolveTemporalAA");
+	const int history = m_temporalAA.historyIndex();
+	const uint32_t numGroupsX = (m_frameRect.extent.width + 7) / 8;
+	const uint32_t numGroupsY = (m_frameRect.extent.height + 7) / 8;
+
+	// Reduce multisampled depth to the closest sample of each pixel (previous frame's resolve has finished reading it).
+	if(m_renderSamples > 1) {
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, {
+			ImageMemoryBarrier(m_taa.depthTexture, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL)
+		});
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_taa.depthResolvePipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_taa.depthResolvePipelineLayout, 0, 1, &m_taa.depthResolveDescriptorSets[m_frameIndex], 0, nullptr);
+		vkCmdDispatch(commandBuffer, numGroupsX, numGroupsY, 1);
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, {
+			ImageMemoryBarrier(m_taa.depthTexture, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+		});
+	}
+
+	// Blend current frame with history reprojected from the other history texture into this frame's one
+	// (last read by tone mapping & resolve two frames ago, its contents are discarded).
+	pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, {
+		ImageMemoryBarrier(m_taa.history[history], 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL)
+	});
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_taa.pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_taa.pipelineLayout, 0, 1, &m_taa.descriptorSets[2 * m_frameIndex + history], 0, nullptr);
+	vkCmdDispatch(commandBuffer, numGroupsX, numGroupsY, 1);
+
+	// Read by tone mapping pass as input attachment & by next frame's resolve as history.
+	pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, {
+		ImageMemoryBarrier(m_taa.history[history], VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+	});
+}
+
+void Renderer::computeAutoExposure(VkCommandBuffer commandBuffer, const AutoExposure::Parameters& parameters) const
+{
+	PROFILE_ZONE("Renderer::computeAutoExposure");
+	const VkDescriptorSet descriptorSet = m_exposure.descriptorSets[m_settings.temporalAA ? m_temporalAA.historyIndex() : m_frameIndex];
+	const uint32_t numGroupsX = (parameters.region.x + 15) / 16;
+	const uint32_t numGroupsY = (parameters.region.y + 15) / 16;
+
+	if(m_exposure.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, m_exposure.timestampQueryPool, 2 * m_frameIndex, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_exposure.timestampQueryPool, 2 * m_frameIndex);
+	}
+
+	// Scene color was stored by the render pass (see its external dependency), exposure was last read by this frame's tone mapping.
+	{
+		const VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_exposure.histogramPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_exposure.pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, m_exposure.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AutoExposure::Parameters), &parameters);
+	vkCmdDispatch(commandBuffer, numGroupsX, numGroupsY, 1);
+
+	// Average histogram (complete once all groups have added their bins) & clear it for next frame.
+	{
+		const VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_exposure.exposurePipeline);
+	vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+	// Read by next frame's tone mapping & histogram passes.
+	{
+		const VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	if(m_exposure.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_exposure.timestampQueryPool, 2 * m_frameIndex + 1);
+	}
+}
+
+void Renderer::readbackSceneColor(VkCommandBuffer commandBuffer) const
+{
+	PROFILE_ZONE("Renderer::readbackSceneColor");
+	// Scene color (resolved if multisampled) is left in shader read-only layout by the main render pass, whose external dependency
+	// makes its writes available to transfer reads. Next frame's render pass discards whatever layout it ends up in.
+	const RenderTarget& sceneTarget = (m_renderSamples > 1) ? m_resolveRenderTargets[m_frameIndex] : m_renderTargets[m_frameIndex];
+
+	VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = sceneTarget.colorImage.resource;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	// Also waits for automatic exposure histogram reads of the same image.
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy copyRegion = {};
+	copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	copyRegion.imageExtent = { sceneTarget.width, sceneTarget.height, 1 };
+	vkCmdCopyImageToBuffer(commandBuffer, sceneTarget.colorImage.resource, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_halfPrecision.readbackBuffer.resource, 1, &copyRegion);
+
+	// Make transfer results visible to host reads (buffer is mapped only after the device has become idle).
+	VkBufferMemoryBarrier hostBarrier = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+	hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.buffer = m_halfPrecision.readbackBuffer.resource;
+	hostBarrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+}
+
+Resource<VkBuffer> Renderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryFlags, MemoryCategory category) const
+{
+	Resource<VkBuffer> buffer;
+
+	VkBufferCreateInfo createInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	createInfo.size = size;
+	createInfo.usage = usage;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if(VKFAILED(vkCreateBuffer(m_device, &createInfo, nullptr, &buffer.resource))) {
+		throw std::runtime_error("Failed to create buffer");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(m_device, buffer.resource, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+	allocateInfo.allocationSize = memoryRequirements.size;
+	allocateInfo.memoryTypeIndex = chooseMemoryType(memoryRequirements, memoryFlags);
+	if(VKFAILED(vkAllocateMemory(m_device, &allocateInfo, nullptr, &buffer.memory))) {
+		throw std::runtime_error("Failed to allocate device memory for buffer");
+	}
+	if(VKFAILED(vkBindBufferMemory(m_device, buffer.resource, buffer.memory, 0))) {
+		throw std::runtime_error("Failed to bind device memory to buffer");
+	}
+
+	buffer.allocationSize = allocateInfo.allocationSize;
+	buffer.memoryTypeIndex = allocateInfo.memoryTypeIndex;
+	m_memoryStats.allocate((uint64_t)buffer.memory, category, (int)m_phyDevice.memory.memoryTypes[buffer.memoryTypeIndex].heapIndex, buffer.allocationSize);
+	return buffer;
+}
+	
+Resource<VkImage> Renderer::createImage(uint32_t width, uint32_t height, uint32_t layers, uint32_t levels, VkFormat format, uint32_t samples, VkImageUsageFlags usage,
+	MemoryCategory category, VkImageType imageType, uint32_t depth) const
+{
+	assert(width > 0);
+	assert(height > 0);
+	assert(depth > 0);
+	assert(imageType == VK_IMAGE_TYPE_3D || depth == 1);
+	assert(levels > 0);
+	assert(layers > 0);
+	assert(samples > 0 && samples <= 64);
+
+	Resource<VkImage> image;
+
+	VkImageCreateInfo createInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+	createInfo.flags = (layers % 6 == 0) ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
+	createInfo.imageType = imageType;
+	createInfo.format = format;
+	createInfo.extent = { width, height, depth };
+	createInfo.mipLevels = levels;
+	createInfo.arrayLayers = layers;
+	createInfo.samples = static_cast<VkSampleCountFlagBits>(samples);
+	createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	createInfo.usage = usage;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if(VKFAILED(vkCreateImage(m_device, &createInfo, nullptr, &image.resource))) {
+		throw std::runtime_error("Failed to create image");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(m_device, image.resource, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+	allocateInfo.allocationSize = memoryRequirements.size;
+	allocateInfo.memoryTypeIndex = chooseMemoryType(memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if(VKFAILED(vkAllocateMemory(m_device, &allocateInfo, nullptr, &image.memory))) {
+		throw std::runtime_error("Failed to allocate device memory for image");
+	}
+	if(VKFAILED(vkBindImageMemory(m_device, image.resource, image.memory, 0))) {
+		throw std::runtime_error("Failed to bind device memory to image");
+	}
+
+	image.allocationSize = allocateInfo.allocationSize;
+	image.memoryTypeIndex = allocateInfo.memoryTypeIndex;
+	m_memoryStats.allocate((uint64_t)image.memory, category, (int)m_phyDevice.memory.memoryTypes[image.memoryTypeIndex].heapIndex, image.allocationSize);
+
+	return image;
+}
+
+void Renderer::destroyBuffer(Resource<VkBuffer>& buffer) const
+{
+	if(buffer.resource != VK_NULL_HANDLE) {
+		vkDestroyBuffer(m_device, buffer.resource, nullptr);
+	}
+	if(buffer.memory != VK_NULL_HANDLE) {
+		m_memoryStats.release((uint64_t)buffer.memory);
+		vkFreeMemory(m_device, buffer.memory, nullptr);
+	}
+	buffer = {};
+}
+
+void Renderer::destroyImage(Resource<VkImage>& image) const
+{
+	if(image.resource != VK_NULL_HANDLE) {
+		vkDestroyImage(m_device, image.resource, nullptr);
+	}
+	if(image.memory != VK_NULL_HANDLE) {
+		m_memoryStats.release((uint64_t)image.memory);
+		vkFreeMemory(m_device, image.memory, nullptr);
+	}
+	image = {};
+}
+	
+MeshBuffer Renderer::createMeshBuffer(const std::shared_ptr<Mesh>& mesh, bool deinterleaved) const
+{
+	PROFILE_ZONE("Renderer::createMeshBuffer");
+	assert(mesh);
+
+	MeshBuffer buffer;
+	buffer.numElements = static_cast<uint32_t>(mesh->faces().size() * 3);
+
+	// De-interleaved layout packs positions tightly (fewer bytes fetched per vertex by depth-only passes)
+	// & keeps remaining attributes in a second stream.
+	std::vector<glm::vec3> positions;
+	std::vector<Mesh::Attributes> attributes;
+	const void* vertexData = mesh->vertices().data();
+	size_t vertexDataSize = mesh->vertices().size() * sizeof(Mesh::Vertex);
+	if(deinterleaved) {
+		positions = mesh->positions();
+		attributes = mesh->attributes();
+		vertexData = attributes.data();
+		vertexDataSize = attributes.size() * sizeof(Mesh::Attributes);
+	}
+	const size_t indexDataSize = mesh->faces().size() * sizeof(Mesh::Face);
+
+	buffer.vertexBuffer = createBuffer(vertexDataSize,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Mesh);
+	buffer.indexBuffer = createBuffer(indexDataSize,
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Mesh);
+	if(deinterleaved) {
+		buffer.positionBuffer = createBuffer(positions.size() * sizeof(glm::vec3),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Mesh);
+	}
+
+	// Write data directly into host visible buffers, otherwise through temporary staging buffers.
+	std::vector<std::pair<Resource<VkBuffer>, const Resource<VkBuffer>*>> stagingBuffers;
+	std::vector<size_t> stagingDataSizes;
+	auto upload = [this, &stagingBuffers, &stagingDataSizes](const Resource<VkBuffer>& deviceBuffer, const void* data, size_t size) {
+		if(memoryTypeNeedsStaging(deviceBuffer.memoryTypeIndex)) {
+			Resource<VkBuffer> stagingBuffer = createBuffer(deviceBuffer.allocationSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, MemoryCategory::Staging);
+			copyToDevice(stagingBuffer.memory, data, size);
+			stagingBuffers.push_back(std::make_pair(stagingBuffer, &deviceBuffer));
+			stagingDataSizes.push_back(size);
+		}
+		else {
+			copyToDevice(deviceBuffer.memory, data, size);
+		}
+	};
+	upload(buffer.vertexBuffer, vertexData, vertexDataSize);
+	upload(buffer.indexBuffer, mesh->faces().data(), indexDataSize);
+	if(deinterleaved) {
+		upload(buffer.positionBuffer, positions.data(), positions.size() * sizeof(glm::vec3));
+	}
+
+	if(!stagingBuffers.empty()) {
+		VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+		for(size_t i=0; i<stagingBuffers.size(); ++i) {
+			const VkBufferCopy bufferCopyRegion = { 0, 0, stagingDataSizes[i] };
+			vkCmdCopyBuffer(commandBuffer, stagingBuffers[i].first.resource, stagingBuffers[i].second->resource, 1, &bufferCopyRegion);
+		}
+		executeImmediateCommandBuffer(commandBuffer);
+	}
+	for(auto& stagingBuffer : stagingBuffers) {
+		destroyBuffer(stagingBuffer.first);
+	}
+
+	return buffer;
+}
+
+void Renderer::destroyMeshBuffer(MeshBuffer& buffer) const
+{
+	destroyBuffer(buffer.vertexBuffer);
+	destroyBuffer(buffer.indexBuffer);
+	destroyBuffer(buffer.positionBuffer);
+	buffer = {};
+}
+	
+Texture Renderer::createTexture(uint32_t width, uint32_t height, uint32_t layers, VkFormat format, MemoryCategory category, uint32_t levels, VkImageUsageFlags additionalUsage) const
+{
+	assert(width > 0 && height > 0);
+	assert(layers > 0);
+
+	Texture texture;
+	texture.width  = width;
+	texture.height = height;
+	texture.layers = layers;
+	texture.levels = (levels > 0) ? levels : Utility::numMipmapLevels(width, height);
+
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | additionalUsage;
+	if(texture.levels > 1) {
+		usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT; // For mipmap generation
+	}
+
+	texture.image = createImage(width, height, layers, texture.levels, format, 1, usage, category);
+	texture.view = createTextureView(texture, format, VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS);
+	return texture;
+}
+	
+Texture Renderer::createTexture(const std::shared_ptr<Image>& image, VkFormat format, MemoryCategory category, uint32_t levels) const
+{
+	PROFILE_ZONE("Renderer::createTexture");
+	assert(image);
+
+	Texture texture = createTexture(image->width(), image->height(), 1, format, category, levels);
+
+	const size_t pixelDataSize = image->pitch() * image->height();
+	Resource<VkBuffer> stagingBuffer = createBuffer(pixelDataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, MemoryCategory::Staging);
+	copyToDevice(stagingBuffer.memory, image->pixels<void>(), pixelDataSize);
+
+	VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+	{
+		const auto barrier = ImageMemoryBarrier(texture, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL).mipLevels(0, 1);
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, { barrier });
+	}
+
+	VkBufferImageCopy copyRegion = {};
+	copyRegion.bufferOffset = 0;
+	copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	copyRegion.imageExtent = { texture.width, texture.height, 1 };
+	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer.resource, texture.image.resource,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+	{
+		// If we're going to generate mipmaps transition base mip to transfer src layout, otherwise use shader read only layout.
+		const VkImageLayout finalBaseMipLayout = 
+			(texture.levels > 1)
+			? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+			: VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		const auto barrier = ImageMemoryBarrier(texture, VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalBaseMipLayout).mipLevels(0, 1);
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, { barrier });
+	}
+
+	executeImmediateCommandBuffer(commandBuffer);
+	destroyBuffer(stagingBuffer);
+
+	if(texture.levels > 1) {
+		generateMipmaps(texture);
+	}
+
+	return texture;
+}
+	
+Texture Renderer::createVolumeTexture(uint32_t width, uint32_t height, uint32_t depth, VkFormat format, MemoryCategory category, VkImageUsageFlags additionalUsage) const
+{
+	assert(width > 0 && height > 0 && depth > 0);
+
+	// Single level only (volume textures are not mipmapped here).
+	Texture texture;
+	texture.width  = width;
+	texture.height = height;
+	texture.layers = 1;
+	texture.levels = 1;
+
+	const VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | additionalUsage;
+	texture.image = createImage(width, height, 1, 1, format, 1, usage, category, VK_IMAGE_TYPE_3D, depth);
+	texture.view = createTextureView(texture, VK_IMAGE_VIEW_TYPE_3D, format, 0, 1, 0, 1);
+	return texture;
+}
+
+VkImageView Renderer::createTextureView(const Texture& texture, VkFormat format, VkImageAspectFlags aspectMask, uint32_t baseMipLevel, uint32_t numMipLevels) const
+{
+	VkImageViewCreateInfo viewCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+	viewCreateInfo.image = texture.image.resource;
+	viewCreateInfo.viewType = (texture.layers == 6) ? VK_IMAGE_VIEW_TYPE_CUBE : (texture.layers % 6 == 0) ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+	viewCreateInfo.format = format;
+	viewCreateInfo.subresourceRange.aspectMask = aspectMask;
+	viewCreateInfo.subresourceRange.baseMipLevel = baseMipLevel;
+	viewCreateInfo.subresourceRange.levelCount = numMipLevels;
+	viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+	viewCreateInfo.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+	VkImageView view;
+	if(VKFAILED(vkCreateImageView(m_device, &viewCreateInfo, nullptr, &view))) {
+		throw std::runtime_error("Failed to create texture image view");
+	}
+	return view;
+}
+
+VkImageView Renderer::createTextureView(const Texture& texture, VkImageViewType viewType, VkFormat format, uint32_t baseMipLevel, uint32_t numMipLevels, uint32_t baseArrayLayer, uint32_t numArrayLayers,
+	VkImageAspectFlags aspectMask) const
+{
+	VkImageViewCreateInfo viewCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+	viewCreateInfo.image = texture.image.resource;
+	viewCreateInfo.viewType = viewType;
+	viewCreateInfo.format = format;
+	viewCreateInfo.subresourceRange.aspectMask = aspectMask;
+	viewCreateInfo.subresourceRange.baseMipLevel = baseMipLevel;
+	viewCreateInfo.subresourceRange.levelCount = numMipLevels;
+	viewCreateInfo.subresourceRange.baseArrayLayer = baseArrayLayer;
+	viewCreateInfo.subresourceRange.layerCount = numArrayLayers;
+
+	VkImageView view;
+	if(VKFAILED(vkCreateImageView(m_device, &viewCreateInfo, nullptr, &view))) {
+		throw std::runtime_error("Failed to create texture image view");
+	}
+	return view;
+}
+	
+void Renderer::generateMipmaps(const Texture& texture) const
+{
+	VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+	generateMipmaps(commandBuffer, texture, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+	executeImmediateCommandBuffer(commandBuffer);
+}
+
+void Renderer::generateMipmaps(VkCommandBuffer commandBuffer, const Texture& texture, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask) const
+{
+	assert(texture.levels > 1);
+
+	// Iterate through mip chain and consecutively blit from previous level to next level with linear filtering.
+	for(uint32_t level=1, prevLevelWidth=texture.width, prevLevelHeight=texture.height; level<texture.levels; ++level, prevLevelWidth/=2, prevLevelHeight/=2) {
+
+		const auto preBlitBarrier = ImageMemoryBarrier(texture, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL).mipLevels(level, 1);
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, { preBlitBarrier });
+
+		VkImageBlit region = {};
+		region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level-1, 0, texture.layers };
+		region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level,   0, texture.layers };
+		region.srcOffsets[1]  = { int32_t(prevLevelWidth),  int32_t(prevLevelHeight),   1 };
+		region.dstOffsets[1]  = { int32_t(prevLevelWidth/2),int32_t(prevLevelHeight/2), 1 };
+		vkCmdBlitImage(commandBuffer,
+			texture.image.resource, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			texture.image.resource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &region, VK_FILTER_LINEAR);
+
+		const auto postBlitBarrier = ImageMemoryBarrier(texture, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL).mipLevels(level, 1);
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, { postBlitBarrier });
+	}
+
+	// Transition whole mip chain to shader read only layout.
 	{
-		VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffer;
-		vkQueueSubmit(m_queue, 1, &submitInfo, m_submitFences[m_frameIndex]);
+		const auto barrier = ImageMemoryBarrier(texture, VK_ACCESS_TRANSFER_WRITE_BIT, dstAccessMask, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask, { barrier });
+	}
+}
+	
+void Renderer::destroyTexture(Texture& texture) const
+{
+	if(texture.view != VK_NULL_HANDLE) {
+		vkDestroyImageView(m_device, texture.view, nullptr);
+	}
+	destroyImage(texture.image);
+}
+	
+RenderTarget Renderer::createRenderTarget(uint32_t width, uint32_t height, uint32_t samples, VkFormat colorFormat, VkFormat depthFormat, VkImageUsageFlags additionalUsage) const
+{
+	assert(samples > 0 && samples <= 64);
+	
+	RenderTarget target = {};
+	target.width = width;
+	target.height = height;
+	target.samples = samples;
+	target.colorFormat = colorFormat;
+	target.depthFormat = depthFormat;
+
+	VkImageUsageFlags colorImageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | additionalUsage;
+	if(samples == 1) {
+		colorImageUsage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+	}
+
+	if(colorFormat != VK_FORMAT_UNDEFINED) {
+		target.colorImage = createImage(width, height, 1, 1, colorFormat, samples, colorImageUsage, MemoryCategory::RenderTarget);
+	}
+	if(depthFormat != VK_FORMAT_UNDEFINED) {
+		target.depthImage = createImage(width, height, 1, 1, depthFormat, samples, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | additionalUsage, MemoryCategory::RenderTarget);
+	}
+
+	VkImageViewCreateInfo viewCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewCreateInfo.subresourceRange.levelCount = 1;
+	viewCreateInfo.subresourceRange.layerCount = 1;
+
+	if(target.colorImage.resource != VK_NULL_HANDLE) {
+		viewCreateInfo.image = target.colorImage.resource;
+		viewCreateInfo.format = colorFormat;
+		viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		if(VKFAILED(vkCreateImageView(m_device, &viewCreateInfo, nullptr, &target.colorView))) {
+			throw std::runtime_error("Failed to create render target color image view");
+		}
+	}
+
+	if(target.depthImage.resource != VK_NULL_HANDLE) {
+		viewCreateInfo.image = target.depthImage.resource;
+		viewCreateInfo.format = depthFormat;
+		viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		if(VKFAILED(vkCreateImageView(m_device, &viewCreateInfo, nullptr, &target.depthView))) {
+			throw std::runtime_error("Failed to create render target depth-stencil image view");
+		}
+	}
+
+	return target;
+}
+
+void Renderer::destroyRenderTarget(RenderTarget& target) const
+{
+	destroyImage(target.colorImage);
+	destroyImage(target.depthImage);
+
+	if(target.colorView != VK_NULL_HANDLE) {
+		vkDestroyImageView(m_device, target.colorView, nullptr);
+	}
+	if(target.depthView != VK_NULL_HANDLE) {
+		vkDestroyImageView(m_device, target.depthView, nullptr);
+	}
+	target = {};
+}
+	
+UniformBuffer Renderer::createUniformBuffer(VkDeviceSize capacity) const
+{
+	assert(capacity > 0);
+
+	UniformBuffer buffer = {};
+	buffer.buffer   = createBuffer(capacity, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Uniform);
+	buffer.capacity = capacity;
+	
+	if(VKFAILED(vkMapMemory(m_device, buffer.buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.hostMemoryPtr))) {
+		throw std::runtime_error("Failed to map uniform buffer memory to host address space");
+	}
+
+	return buffer;
+}
+
+void Renderer::destroyUniformBuffer(UniformBuffer& buffer) const
+{
+	if(buffer.hostMemoryPtr != nullptr && buffer.buffer.memory != VK_NULL_HANDLE) {
+		vkUnmapMemory(m_device, buffer.buffer.memory);
+	}
+	destroyBuffer(buffer.buffer);
+	buffer = {};
+}
+	
+UniformBufferAllocation Renderer::allocFromUniformBuffer(UniformBuffer& buffer, VkDeviceSize size) const
+{
+	const VkDeviceSize minAlignment = m_phyDevice.properties.limits.minUniformBufferOffsetAlignment;
+	const VkDeviceSize alignedSize = Utility::roundToPowerOfTwo(size, (int)minAlignment);
+	if(alignedSize > m_phyDevice.properties.limits.maxUniformBufferRange) {
+		throw std::invalid_argument("Requested uniform buffer sub-allocation size exceeds maxUniformBufferRange of current physical device");
+	}
+	if(buffer.cursor + alignedSize > buffer.capacity) {
+		throw std::overflow_error("Out of uniform buffer capacity while allocating memory");
+	}
+
+	UniformBufferAllocation allocation;
+	allocation.descriptorInfo.buffer = buffer.buffer.resource;
+	allocation.descriptorInfo.offset = buffer.cursor;
+	allocation.descriptorInfo.range  = alignedSize;
+	allocation.hostMemoryPtr = reinterpret_cast<uint8_t*>(buffer.hostMemoryPtr) + buffer.cursor;
+
+	buffer.cursor += alignedSize;
+	return allocation;
+}
+	
+VkDescriptorSet Renderer::allocateDescriptorSet(VkDescriptorPool pool, VkDescriptorSetLayout layout) const
+{
+	VkDescriptorSet descriptorSet;
+	VkDescriptorSetAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+	allocateInfo.descriptorPool = pool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &layout;
+	if(VKFAILED(vkAllocateDescriptorSets(m_device, &allocateInfo, &descriptorSet))) {
+		throw std::runtime_error("Failed to allocate descriptor set");
+	}
+	return descriptorSet;
+}
+	
+void Renderer::updateDescriptorSet(VkDescriptorSet dstSet, uint32_t dstBinding, VkDescriptorType descriptorType, const std::vector<VkDescriptorImageInfo>& descriptors) const
+{
+	VkWriteDescriptorSet writeDescriptorSet = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+	writeDescriptorSet.dstSet = dstSet;
+	writeDescriptorSet.dstBinding = dstBinding;
+	writeDescriptorSet.descriptorType = descriptorType;
+	writeDescriptorSet.descriptorCount = (uint32_t)descriptors.size();
+	writeDescriptorSet.pImageInfo = descriptors.data();
+	vkUpdateDescriptorSets(m_device, 1, &writeDescriptorSet, 0, nullptr);
+}
+
+void Renderer::updateDescriptorSet(VkDescriptorSet dstSet, uint32_t dstBinding, VkDescriptorType descriptorType, const std::vector<VkDescriptorBufferInfo>& descriptors) const
+{
+	VkWriteDescriptorSet writeDescriptorSet = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+	writeDescriptorSet.dstSet = dstSet;
+	writeDescriptorSet.dstBinding = dstBinding;
+	writeDescriptorSet.descriptorType = descriptorType;
+	writeDescriptorSet.descriptorCount = (uint32_t)descriptors.size();
+	writeDescriptorSet.pBufferInfo = descriptors.data();
+	vkUpdateDescriptorSets(m_device, 1, &writeDescriptorSet, 0, nullptr);
+}
+
+void Renderer::updateDescriptorSet(VkDescriptorSet dstSet, uint32_t dstBinding, VkDescriptorType descriptorType, std::initializer_list<VkDescriptorImageInfo> descriptors) const
+{
+	VkWriteDescriptorSet writeDescriptorSet = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+	writeDescriptorSet.dstSet = dstSet;
+	writeDescriptorSet.dstBinding = dstBinding;
+	writeDescriptorSet.descriptorType = descriptorType;
+	writeDescriptorSet.descriptorCount = (uint32_t)descriptors.size();
+	writeDescriptorSet.pImageInfo = descriptors.begin();
+	vkUpdateDescriptorSets(m_device, 1, &writeDescriptorSet, 0, nullptr);
+}
+
+void Renderer::updateDescriptorSet(VkDescriptorSet dstSet, uint32_t dstBinding, VkDescriptorType descriptorType, std::initializer_list<VkDescriptorBufferInfo> descriptors) const
+{
+	VkWriteDescriptorSet writeDescriptorSet = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+	writeDescriptorSet.dstSet = dstSet;
+	writeDescriptorSet.dstBinding = dstBinding;
+	writeDescriptorSet.descriptorType = descriptorType;
+	writeDescriptorSet.descriptorCount = (uint32_t)descriptors.size();
+	writeDescriptorSet.pBufferInfo = descriptors.begin();
+	vkUpdateDescriptorSets(m_device, 1, &writeDescriptorSet, 0, nullptr);
+}
+
+VkDescriptorSetLayout Renderer::createDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>* bindings) const
+{
+	VkDescriptorSetLayout layout;
+	VkDescriptorSetLayoutCreateInfo createInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+	if(bindings && bindings->size() > 0) {
+		createInfo.bindingCount = (uint32_t)bindings->size();
+		createInfo.pBindings = bindings->data();
 	}
-
-	presentFrame();
+	if(VKFAILED(vkCreateDescriptorSetLayout(m_device, &createInfo, nullptr, &layout))) {
+		throw std::runtime_error("Failed to create descriptor set layout");
+	}
+	return layout;
 }
 	
-Resource<VkBuffer> Renderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryFlags) const
+VkPipelineLayout Renderer::createPipelineLayout(const std::vector<VkDescriptorSetLayout>* setLayouts, const std::vector<VkPushConstantRange>* pushConstants) const
 {
-	Resource<VkBuffer> buffer;
-
-	VkBufferCreateInfo createInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-	createInfo.size = size;
-	createInfo.usage = usage;
-	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	if(VKFAILED(vkCreateBuffer(m_device, &createInfo, nullptr, &buffer.resource))) {
-		throw std::runtime_error("Failed to create buffer");
+	VkPipelineLayout layout;
+	VkPipelineLayoutCreateInfo createInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+	if(setLayouts && setLayouts->size() > 0) {
+		createInfo.setLayoutCount = (uint32_t)setLayouts->size();
+		createInfo.pSetLayouts = setLayouts->data();
 	}
-
-	VkMemoryRequirements memoryRequirements;
-	vkGetBufferMemoryRequirements(m_device, buffer.resource, &memoryRequirements);
-
-	VkMemoryAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
-	allocateInfo.allocationSize = memoryRequirements.size;
-	allocateInfo.memoryTypeIndex = chooseMemoryType(memoryRequirements, memoryFlags);
-	if(VKFAILED(vkAllocateMemory(m_device, &allocateInfo, nullptr, &buffer.memory))) {
-		throw std::runtime_error("Failed to allocate device memory for buffer");
+	if(pushConstants && pushConstants->size() > 0) {
+		createInfo.pushConstantRangeCount = (uint32_t)pushConstants->size();
+		createInfo.pPushConstantRanges = pushConstants->data();
 	}
-	if(VKFAILED(vkBindBufferMemory(m_device, buffer.resource, buffer.memory, 0))) {
-		throw std::runtime_error("Failed to bind device memory to buffer");
+	if(VKFAILED(vkCreatePipelineLayout(m_device, &createInfo, nullptr, &layout))) {
+		throw std::runtime_error("Failed to create pipeline layout");
 	}
-
-	buffer.allocationSize = allocateInfo.allocationSize;
-	buffer.memoryTypeIndex = allocateInfo.memoryTypeIndex;
-	return buffer;
+	return layout;
 }
-	
-Resource<VkImage> Renderer::createImage(uint32_t width, uint32_t height, uint32_t layers, uint32_t levels, VkFormat format, uint32_t samples, VkImageUsageFlags usage) const
-{
-	assert(width > 0);
-	assert(height > 0);
-	assert(levels > 0);
-	assert(layers == 1 || layers == 6);
-	assert(samples > 0 && samples <= 64);
 
-	Resource<VkImage> image;
+VkPipeline Renderer::createGraphicsPipeline(uint32_t subpass,
+		const std::string& vs, const std::string& fs, VkPipelineLayout layout,
+		const std::vector<VkVertexInputBindingDescription>* vertexInputBindings,
+		const std::vector<VkVertexInputAttributeDescription>* vertexAttributes,
+		const VkPipelineMultisampleStateCreateInfo* multisampleState,
+		const VkPipelineDepthStencilStateCreateInfo* depthStencilState,
+		VkRenderPass renderPass,
+		const VkRect2D* renderArea,
+		VkFrontFace frontFace,
+		const VkSpecializationInfo* fragmentSpecializationInfo,
+		const VkPipelineRasterizationStateCreateInfo* rasterizationState) const
+{
+	PROFILE_ZONE("Renderer::createGraphicsPipeline");
+	// Main render pass & full frame viewport unless specified otherwise.
+	const VkRect2D& scissor = (renderArea != nullptr) ? *renderArea : m_frameRect;
+	const VkViewport defaultViewport = { 
+		(float)scissor.offset.x,
+		(float)scissor.offset.y, 
+		(float)scissor.extent.width,
+		(float)scissor.extent.height,
+		0.0f,
+		1.0f
+	};
+	const VkPipelineMultisampleStateCreateInfo defaultMultisampleState = {
+		VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+		nullptr,
+		0,
+		VK_SAMPLE_COUNT_1_BIT,
+	};
+	
+	VkPipelineColorBlendAttachmentState defaultColorBlendAttachmentState = {};
+	defaultColorBlendAttachmentState.blendEnable = VK_FALSE;
+	defaultColorBlendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 
-	VkImageCreateInfo createInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
-	createInfo.flags = (layers == 6) ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
-	createInfo.imageType = VK_IMAGE_TYPE_2D;
-	createInfo.format = format;
-	createInfo.extent = { width, height, 1 };
-	createInfo.mipLevels = levels;
-	createInfo.arrayLayers = layers;
-	createInfo.samples = static_cast<VkSampleCountFlagBits>(samples);
-	createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-	createInfo.usage = usage;
-	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	if(VKFAILED(vkCreateImage(m_device, &createInfo, nullptr, &image.resource))) {
-		throw std::runtime_error("Failed to create image");
-	}
+	// Depth-only pipelines have no fragment program.
+	VkShaderModule vertexShader = createShaderModuleFromFile(vs);
+	VkShaderModule fragmentShader = fs.empty() ? VK_NULL_HANDLE : createShaderModuleFromFile(fs);
 
-	VkMemoryRequirements memoryRequirements;
-	vkGetImageMemoryRequirements(m_device, image.resource, &memoryRequirements);
+	const VkPipelineShaderStageCreateInfo shaderStages[] = {
+		{ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0, VK_SHADER_STAGE_VERTEX_BIT,   vertexShader, "main", nullptr },
+		{ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0, VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader, "main", fragmentSpecializationInfo },
+	};
 
-	VkMemoryAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
-	allocateInfo.allocationSize = memoryRequirements.size;
-	allocateInfo.memoryTypeIndex = chooseMemoryType(memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	if(VKFAILED(vkAllocateMemory(m_device, &allocateInfo, nullptr, &image.memory))) {
-		throw std::runtime_error("Failed to allocate device memory for image");
+	VkPipelineVertexInputStateCreateInfo vertexInputState = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+	if(vertexInputBindings) {
+		vertexInputState.vertexBindingDescriptionCount = (uint32_t)vertexInputBindings->size();
+		vertexInputState.pVertexBindingDescriptions = vertexInputBindings->data();
 	}
-	if(VKFAILED(vkBindImageMemory(m_device, image.resource, image.memory, 0))) {
-		throw std::runtime_error("Failed to bind device memory to image");
+	if(vertexAttributes) {
+		vertexInputState.vertexAttributeDescriptionCount = (uint32_t)vertexAttributes->size();
+		vertexInputState.pVertexAttributeDescriptions = vertexAttributes->data();
 	}
 
-	image.allocationSize = allocateInfo.allocationSize;
-	image.memoryTypeIndex = allocateInfo.memoryTypeIndex;
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = { VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
+	inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssemblyState.primitiveRestartEnable = VK_FALSE;
 
-	return image;
-}
+	VkPipelineViewportStateCreateInfo viewportState = { VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+	viewportState.pViewports = &defaultViewport;
+	viewportState.pScissors = &scissor;
 
-void Renderer::destroyBuffer(Resource<VkBuffer>& buffer) const
-{
-	if(buffer.resource != VK_NULL_HANDLE) {
-		vkDestroyBuffer(m_device, buffer.resource, nullptr);
-	}
-	if(buffer.memory != VK_NULL_HANDLE) {
-		vkFreeMemory(m_device, buffer.memory, nullptr);
-	}
-	buffer = {};
-}
+	// Main pass is drawn into a scaled viewport with dynamic resolution (set by render before drawing the scene).
+	const VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState = { VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+	const bool dynamicViewport = m_dynamicResolution.enabled() && renderPass == VK_NULL_HANDLE && subpass == 0;
 
-void Renderer::destroyImage(Resource<VkImage>& image) const
-{
-	if(image.resource != VK_NULL_HANDLE) {
-		vkDestroyImage(m_device, image.resource, nullptr);
+	VkPipelineRasterizationStateCreateInfo defaultRasterizationState = { VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
+	defaultRasterizationState.polygonMode = VK_POLYGON_MODE_FILL;
+	defaultRasterizationState.cullMode = VK_CULL_MODE_BACK_BIT;
+	defaultRasterizationState.frontFace = frontFace;
+	defaultRasterizationState.lineWidth = 1.0f;
+
+	VkPipelineColorBlendStateCreateInfo colorBlendState = { VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
+	if(fragmentShader == VK_NULL_HANDLE) {
+		// Depth-only pass of main render pass still has its color attachment (writes masked), other depth-only passes have none.
+		defaultColorBlendAttachmentState.colorWriteMask = 0;
+		colorBlendState.attachmentCount = (renderPass == VK_NULL_HANDLE) ? 1 : 0;
 	}
-	if(image.memory != VK_NULL_HANDLE) {
-		vkFreeMemory(m_device, image.memory, nullptr);
+	else {
+		colorBlendState.attachmentCount = 1;
 	}
-	image = {};
-}
+	const VkPipelineColorBlendAttachmentState colorBlendAttachmentStates[] = {
+		defaultColorBlendAttachmentState
+	};
+	colorBlendState.pAttachments = colorBlendAttachmentStates;
 	
-MeshBuffer Renderer::createMeshBuffer(const std::shared_ptr<Mesh>& mesh) const
-{
-	assert(mesh);
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo = { VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+	pipelineCreateInfo.stageCount = (fragmentShader != VK_NULL_HANDLE) ? 2 : 1;
+	pipelineCreateInfo.pStages = shaderStages;
+	pipelineCreateInfo.pVertexInputState = &vertexInputState;
+	pipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
+	pipelineCreateInfo.pViewportState = &viewportState;
+	pipelineCreateInfo.pRasterizationState = (rasterizationState != nullptr) ? rasterizationState : &defaultRasterizationState;
+	pipelineCreateInfo.pMultisampleState = (multisampleState != nullptr) ? multisampleState : &defaultMultisampleState;
+	pipelineCreateInfo.pDepthStencilState = depthStencilState;
+	pipelineCreateInfo.pColorBlendState = &colorBlendState;
+	pipelineCreateInfo.pDynamicState = dynamicViewport ? &dynamicState : nullptr;
+	pipelineCreateInfo.layout = layout;
+	pipelineCreateInfo.renderPass = (renderPass != VK_NULL_HANDLE) ? renderPass : m_renderPass;
+	pipelineCreateInfo.subpass = subpass;
 
-	MeshBuffer buffer;
-	buffer.numElements = static_cast<uint32_t>(mesh->faces().size() * 3);
+	VkPipeline pipeline;
+	if(VKFAILED(vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline))) {
+		throw std::runtime_error("Failed to create graphics pipeline");
+	}
 
-	const size_t vertexDataSize = mesh->vertices().size() * sizeof(Mesh::Vertex);
-	const size_t indexDataSize = mesh->faces().size() * sizeof(Mesh::Face);
+	vkDestroyShaderModule(m_device, vertexShader, nullptr);
+	if(fragmentShader != VK_NULL_HANDLE) {
+		vkDestroyShaderModule(m_device, fragmentShader, nullptr);
+	}
 
-	buffer.vertexBuffer = createBuffer(vertexDataSize,
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	buffer.indexBuffer = createBuffer(indexDataSize,
-		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	return pipeline;
+}
 
-	bool usingStagingForVertexBuffer = false;
-	bool usingStagingForIndexBuffer = false;
+VkPipeline Renderer::createComputePipeline(const std::string& cs, VkPipelineLayout layout,
+	const VkSpecializationInfo* specializationInfo) const
+{
+	PROFILE_ZONE("Renderer::createComputePipeline");
+	VkShaderModule computeShader = createShaderModuleFromFile(cs);
 
-	Resource<VkBuffer> stagingVertexBuffer = buffer.vertexBuffer;
-	if(memoryTypeNeedsStaging(buffer.vertexBuffer.memoryTypeIndex)) {
-		stagingVertexBuffer = createBuffer(buffer.vertexBuffer.allocationSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-		usingStagingForVertexBuffer = true;
-	}
+	const VkPipelineShaderStageCreateInfo shaderStage = {
+		VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0, VK_SHADER_STAGE_COMPUTE_BIT, computeShader, "main", specializationInfo,
+	};
 
-	Resource<VkBuffer> stagingIndexBuffer  = buffer.indexBuffer;
-	if(memoryTypeNeedsStaging(buffer.indexBuffer.memoryTypeIndex)) {
-		stagingIndexBuffer = createBuffer(buffer.indexBuffer.allocationSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-		usingStagingForIndexBuffer = true;
+	VkComputePipelineCreateInfo createInfo = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+	createInfo.stage = shaderStage;
+	createInfo.layout = layout;
+
+	VkPipeline pipeline;
+	if(VKFAILED(vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &createInfo, nullptr, &pipeline))) {
+		throw std::runtime_error("Failed to create compute pipeline");
 	}
 
-	copyToDevice(stagingVertexBuffer.memory, mesh->vertices().data(), vertexDataSize);
-	copyToDevice(stagingIndexBuffer.memory, mesh->faces().data(), indexDataSize);
+	vkDestroyShaderModule(m_device, computeShader, nullptr);
+	
+	return pipeline;
+}
+	
+VkShaderModule Renderer::createShaderModuleFromFile(const std::string& filename) const
+{
+	PROFILE_ZONE("Renderer::createShaderModuleFromFile");
+	std::printf("Loading SPIR-V shader module: %s\n", filename.c_str());
 
-	if(usingStagingForVertexBuffer || usingStagingForIndexBuffer) {
-		VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
-		if(usingStagingForVertexBuffer) {
-			const VkBufferCopy bufferCopyRegion = { 0, 0, vertexDataSize };
-			vkCmdCopyBuffer(commandBuffer, stagingVertexBuffer.resource, buffer.vertexBuffer.resource, 1, &bufferCopyRegion);
-		}
-		if(usingStagingForIndexBuffer) {
-			const VkBufferCopy bufferCopyRegion = { 0, 0, indexDataSize };
-			vkCmdCopyBuffer(commandBuffer, stagingIndexBuffer.resource, buffer.indexBuffer.resource, 1, &bufferCopyRegion);
-		}
-		executeImmediateCommandBuffer(commandBuffer);
+	const auto shaderCode = File::readBinary(filename);
+	if(shaderCode.size() == 0) {
+		throw std::runtime_error("Invalid shader module file");
 	}
 
-	if(usingStagingForVertexBuffer) {
-		destroyBuffer(stagingVertexBuffer);
-	}
-	if(usingStagingForIndexBuffer) {
-		destroyBuffer(stagingIndexBuffer);
-	}
+	VkShaderModuleCreateInfo createInfo = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+	createInfo.codeSize = shaderCode.size();
+	createInfo.pCode    = reinterpret_cast<const uint32_t*>(&shaderCode[0]);
 
-	return buffer;
+	VkShaderModule shaderModule = VK_NULL_HANDLE;
+	if(VKFAILED(vkCreateShaderModule(m_device, &createInfo, nullptr, &shaderModule))) {
+		throw std::runtime_error("Failed to create shader module");
+	}
+	return shaderModule;
 }
-
-void Renderer::destroyMeshBuffer(MeshBuffer& buffer) const
+	
+VkCommandBuffer Renderer::beginImmediateCommandBuffer() const
 {
-	destroyBuffer(buffer.vertexBuffer);
-	destroyBuffer(buffer.indexBuffer);
-	buffer = {};
+	VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if(VKFAILED(vkBeginCommandBuffer(m_commandBuffers[m_frameIndex], &beginInfo))) {
+		throw std::runtime_error("Failed to begin immediate command buffer (still in recording state?)");
+	}
+	// Uploads, mipmap generation & pre-processing passes recorded during startup count towards GPU time of the current phase.
+	if(m_immediateQueryPool != VK_NULL_HANDLE && StartupReport::active()) {
+		vkCmdResetQueryPool(m_commandBuffers[m_frameIndex], m_immediateQueryPool, 0, 2);
+		vkCmdWriteTimestamp(m_commandBuffers[m_frameIndex], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_immediateQueryPool, 0);
+	}
+	return m_commandBuffers[m_frameIndex];
 }
 	
-Texture Renderer::createTexture(uint32_t width, uint32_t height, uint32_t layers, VkFormat format, uint32_t levels, VkImageUsageFlags additionalUsage) const
+void Renderer::executeImmediateCommandBuffer(VkCommandBuffer commandBuffer) const
 {
-	assert(width > 0 && height > 0);
-	assert(layers > 0);
+	PROFILE_ZONE("Renderer::executeImmediateCommandBuffer");
+	const bool timed = m_immediateQueryPool != VK_NULL_HANDLE && StartupReport::active();
+	if(timed) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_immediateQueryPool, 1);
+	}
+	if(VKFAILED(vkEndCommandBuffer(commandBuffer))) {
+		throw std::runtime_error("Failed to end immediate command buffer");
+	}
 
-	Texture texture;
-	texture.width  = width;
-	texture.height = height;
-	texture.layers = layers;
-	texture.levels = (levels > 0) ? levels : Utility::numMipmapLevels(width, height);
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE);
+	vkQueueWaitIdle(m_queue);
+	if(timed) {
+		StartupReport::addGpuTime(elapsedMilliseconds(m_immediateQueryPool));
+	}
 
-	VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | additionalUsage;
-	if(texture.levels > 1) {
-		usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT; // For mipmap generation
+	if(VKFAILED(vkResetCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT))) {
+		throw std::runtime_error("Failed to reset immediate command buffer");
 	}
+}
+	
+void Renderer::copyToDevice(VkDeviceMemory deviceMemory, const void* data, size_t size) const
+{
+	const VkMappedMemoryRange flushRange = {
+		VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+		nullptr,
+		deviceMemory,
+		0,
+		VK_WHOLE_SIZE
+	};
 
-	texture.image = createImage(width, height, layers, texture.levels, format, 1, usage);
-	texture.view = createTextureView(texture, format, VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS);
-	return texture;
+	void* mappedMemory;
+	if(VKFAILED(vkMapMemory(m_device, deviceMemory, 0, VK_WHOLE_SIZE, 0, &mappedMemory))) {
+		throw std::runtime_error("Failed to map device memory to host address space");
+	}
+	std::memcpy(mappedMemory, data, size);
+	vkFlushMappedMemoryRanges(m_device, 1, &flushRange);
+	vkUnmapMemory(m_device, deviceMemory);
+	StartupReport::addBytesUploaded(size);
 }
 	
-Texture Renderer::createTexture(const std::shared_ptr<Image>& image, VkFormat format, uint32_t levels) const
+void Renderer::pipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask, const std::vector<ImageMemoryBarrier>& barriers) const
 {
-	assert(image);
-
-	Texture texture = createTexture(image->width(), image->height(), 1, format, levels);
+	vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, (uint32_t)barriers.size(), reinterpret_cast<const VkImageMemoryBarrier*>(barriers.data()));
+}
 
-	const size_t pixelDataSize = image->pitch() * image->height();
-	Resource<VkBuffer> stagingBuffer = createBuffer(pixelDataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-	copyToDevice(stagingBuffer.memory, image->pixels<void>(), pixelDataSize);
+void Renderer::pipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask, std::initializer_list<ImageMemoryBarrier> barriers) const
+{
+	vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, (uint32_t)barriers.size(), reinterpret_cast<const VkImageMemoryBarrier*>(barriers.begin()));
+}
 
-	VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
-	{
-		const auto barrier = ImageMemoryBarrier(texture, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL).mipLevels(0, 1);
-		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, { barrier });
+void Renderer::switchEnvironment(VkCommandBuffer commandBuffer, int environment)
+{
+	PROFILE_ZONE("Renderer::switchEnvironment");
+	m_ibl.environment = environment;
+
+	// Abandon any unfinished pre-processing, partially filtered slot contents are no longer valid.
+	if(!m_iblScheduler.empty()) {
+		m_iblScheduler.clear();
+		m_ibl.cache.release(m_ibl.targetSlot >= 0 ? m_ibl.targetSlot : m_ibl.currentSlot);
+		m_ibl.targetSlot = -1;
 	}
 
-	VkBufferImageCopy copyRegion = {};
-	copyRegion.bufferOffset = 0;
-	copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-	copyRegion.imageExtent = { texture.width, texture.height, 1 };
-	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer.resource, texture.image.resource,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
-
-	{
-		// If we're going to generate mipmaps transition base mip to transfer src layout, otherwise use shader read only layout.
-		const VkImageLayout finalBaseMipLayout = 
-			(texture.levels > 1)
-			? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
-			: VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-		const auto barrier = ImageMemoryBarrier(texture, VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalBaseMipLayout).mipLevels(0, 1);
-		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, { barrier });
+	const int slot = m_ibl.cache.lookup(environment);
+	if(slot >= 0) {
+		activateEnvironmentSlot(commandBuffer, slot);
 	}
-
-	executeImmediateCommandBuffer(commandBuffer);
-	destroyBuffer(stagingBuffer);
-
-	if(texture.levels > 1) {
-		generateMipmaps(texture);
+	else if(m_ibl.loadingBakeEnvironment != environment && m_ibl.loadingEnvironment != environment) {
+		// Environment which is already being loaded gets activated (or pre-filtered) as soon as it arrives.
+		if(EnvironmentCache::bakeExists(m_settings.environments[environment])) {
+			loadEnvironmentBake(commandBuffer, environment);
+		}
+		else {
+			loadEnvironment(environment);
+		}
 	}
-
-	return texture;
 }
-	
-VkImageView Renderer::createTextureView(const Texture& texture, VkFormat format, VkImageAspectFlags aspectMask, uint32_t baseMipLevel, uint32_t numMipLevels) const
+
+void Renderer::loadEnvironment(int environment)
 {
-	VkImageViewCreateInfo viewCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
-	viewCreateInfo.image = texture.image.resource;
-	viewCreateInfo.viewType = (texture.layers == 6) ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_2D;
-	viewCreateInfo.format = format;
-	viewCreateInfo.subresourceRange.aspectMask = aspectMask;
-	viewCreateInfo.subresourceRange.baseMipLevel = baseMipLevel;
-	viewCreateInfo.subresourceRange.levelCount = numMipLevels;
-	viewCreateInfo.subresourceRange.baseArrayLayer = 0;
-	viewCreateInfo.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+	m_ibl.loadingEnvironment = environment;
 
-	VkImageView view;
-	if(VKFAILED(vkCreateImageView(m_device, &viewCreateInfo, nullptr, &view))) {
-		throw std::runtime_error("Failed to create texture image view");
+	const std::string filename = m_settings.environments[environment];
+	m_ibl.pendingEnvironment = std::async(std::launch::async, [filename]() {
+		return Image::fromFile(filename);
+	});
+}
+
+void Renderer::loadEnvironmentBake(VkCommandBuffer commandBuffer, int environment)
+{
+	// Only one bake is read at a time: finish (and upload) the one in flight first.
+	if(m_ibl.pendingBake.valid()) {
+		uploadPendingEnvironmentBake(commandBuffer, m_ibl.loadingBakeEnvironment);
 	}
-	return view;
+	m_ibl.loadingBakeEnvironment = environment;
+
+	const std::string filename = m_settings.environments[environment];
+	const uint32_t settingsHash = EnvironmentCache::bakeSettingsHash(m_settings);
+	const int envMapSize = (int)m_envTexture.width;
+	const int envMapLevels = (int)m_envTexture.levels;
+	const int irmapSize = (int)m_irmapTexture.width;
+	m_ibl.pendingBake = std::async(std::launch::async, [filename, settingsHash, envMapSize, envMapLevels, irmapSize]() {
+		return EnvironmentCache::loadBake(filename, settingsHash, envMapSize, envMapLevels, irmapSize);
+	});
 }
-	
-void Renderer::generateMipmaps(const Texture& texture) const
+
+void Renderer::queueEnvironmentFilter(const std::shared_ptr<Image>& image)
 {
-	assert(texture.levels > 1);
+	PROFILE_ZONE("Renderer::queueEnvironmentFilter");
+	enum ComputeDescriptorSetBindingNames : uint32_t {
+		Binding_InputTexture  = 0,
+		Binding_OutputTexture = 1,
+		Binding_OutputMipTail = 2,
+		Binding_Distribution  = 4,
+	};
 
-	VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+	// Make sure no in-flight frame uses resources & descriptor sets which are about to be replaced.
+	vkQueueWaitIdle(m_queue);
 
-	// Iterate through mip chain and consecutively blit from previous level to next level with linear filtering.
-	for(uint32_t level=1, prevLevelWidth=texture.width, prevLevelHeight=texture.height; level<texture.levels; ++level, prevLevelWidth/=2, prevLevelHeight/=2) {
+	destroyTexture(m_ibl.envTextureEquirect);
+	m_ibl.envTextureEquirect = createTexture(image, VK_FORMAT_R32G32B32A32_SFLOAT, MemoryCategory::IBL, 1);
 
-		const auto preBlitBarrier = ImageMemoryBarrier(texture, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL).mipLevels(level, 1);
-		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, { preBlitBarrier });
+	destroyBuffer(m_ibl.distributionBuffer);
+	m_ibl.distributionBuffer = createEnvironmentDistributionBuffer(*image);
+	const VkDescriptorBufferInfo distributionDescriptor = { m_ibl.distributionBuffer.resource, 0, VK_WHOLE_SIZE };
+	updateDescriptorSet(m_ibl.descriptorSet, Binding_Distribution, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { distributionDescriptor });
 
-		VkImageBlit region = {};
-		region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level-1, 0, texture.layers };
-		region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level,   0, texture.layers };
-		region.srcOffsets[1]  = { int32_t(prevLevelWidth),  int32_t(prevLevelHeight),   1 };
-		region.dstOffsets[1]  = { int32_t(prevLevelWidth/2),int32_t(prevLevelHeight/2), 1 };
-		vkCmdBlitImage(commandBuffer,
-			texture.image.resource, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			texture.image.resource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1, &region, VK_FILTER_LINEAR);
+	m_ibl.targetSlot = acquireEnvironmentSlot(m_ibl.environment);
+	const EnvironmentSlot& target = m_ibl.slots[m_ibl.targetSlot];
 
-		const auto postBlitBarrier = ImageMemoryBarrier(texture, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL).mipLevels(level, 1);
-		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, { postBlitBarrier });
-	}
+	// Redirect pre-filtering output to target slot.
+	{
+		for(VkImageView mipTailView : m_ibl.envTextureMipTailViews) {
+			vkDestroyImageView(m_device, mipTailView, nullptr);
+		}
+		m_ibl.envTextureMipTailViews.clear();
 
-	// Transition whole mip chain to shader read only layout.
+		std::vector<VkDescriptorImageInfo> envTextureMipTailDescriptors;
+		for(uint32_t level=1; level<target.envTexture.levels; ++level) {
+			m_ibl.envTextureMipTailViews.push_back(createTextureView(target.envTexture, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, level, 1));
+			envTextureMipTailDescriptors.push_back(VkDescriptorImageInfo{ VK_NULL_HANDLE, m_ibl.envTextureMipTailViews[level-1], VK_IMAGE_LAYOUT_GENERAL });
+		}
+		const VkDescriptorImageInfo outputTexture = { VK_NULL_HANDLE, target.irmapTexture.view, VK_IMAGE_LAYOUT_GENERAL };
+		updateDescriptorSet(m_ibl.descriptorSet, Binding_OutputTexture, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, { outputTexture });
+		updateDescriptorSet(m_ibl.descriptorSet, Binding_OutputMipTail, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, envTextureMipTailDescriptors);
+	}
 	{
-		const auto barrier = ImageMemoryBarrier(texture, VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, { barrier });
+		const VkDescriptorImageInfo inputTexture  = { VK_NULL_HANDLE, m_ibl.envTextureEquirect.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		const VkDescriptorImageInfo outputTexture = { VK_NULL_HANDLE, m_ibl.envTextureUnfiltered.view, VK_IMAGE_LAYOUT_GENERAL };
+		updateDescriptorSet(m_ibl.convertDescriptorSet, Binding_InputTexture, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { inputTexture });
+		updateDescriptorSet(m_ibl.convertDescriptorSet, Binding_OutputTexture, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, { outputTexture });
 	}
 
-	executeImmediateCommandBuffer(commandBuffer);
+	m_iblScheduler.queueEnvironmentConversion(m_envTexture.width);
+	m_iblScheduler.queueIrradianceFilter(m_irmapTexture.width, irradianceLookups(m_settings), kIrradianceBatches);
+	m_iblScheduler.queueSpecularFilter(m_envTexture.width, m_envTexture.levels, m_settings.iblSampleErrorTarget, kSpecularSamples, m_workgroups.size(WorkgroupTuner::SpecularFilter));
 }
-	
-void Renderer::destroyTexture(Texture& texture) const
+
+bool Renderer::uploadPendingEnvironmentBake(VkCommandBuffer commandBuffer, int environment)
 {
-	if(texture.view != VK_NULL_HANDLE) {
-		vkDestroyImageView(m_device, texture.view, nullptr);
+	std::shared_ptr<EnvironmentCache::Bake> bake;
+	try {
+		bake = m_ibl.pendingBake.get();
 	}
-	destroyImage(texture.image);
+	catch(const std::exception& e) {
+		std::fprintf(stderr, "Ignoring environment bake: %s\n", e.what());
+		return false;
+	}
+	return uploadEnvironmentBake(commandBuffer, bake, environment);
 }
-	
-RenderTarget Renderer::createRenderTarget(uint32_t width, uint32_t height, uint32_t samples, VkFormat colorFormat, VkFormat depthFormat) const
-{
-	assert(samples > 0 && samples <= 64);
-	
-	RenderTarget target = {};
-	target.width = width;
-	target.height = height;
-	target.samples = samples;
-	target.colorFormat = colorFormat;
-	target.depthFormat = depthFormat;
 
-	VkImageUsageFlags colorImageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-	if(samples == 1) {
-		colorImageUsage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+bool Renderer::uploadEnvironmentBake(VkCommandBuffer commandBuffer, const std::shared_ptr<EnvironmentCache::Bake>& bake, int environment)
+{
+	PROFILE_ZONE("Renderer::uploadEnvironmentBake");
+	if(bake->envMapSize != (int)m_envTexture.width || bake->envMapLevels != (int)m_envTexture.levels || bake->irmapSize != (int)m_irmapTexture.width) {
+		std::fprintf(stderr, "Ignoring environment bake with mismatched dimensions: %s\n", EnvironmentCache::bakeFilename(m_settings.environments[environment]).c_str());
+		return false;
+	}
+	if(m_ibl.cache.lookup(environment) >= 0) {
+		return true;
 	}
 
-	if(colorFormat != VK_FORMAT_UNDEFINED) {
-		target.colorImage = createImage(width, height, 1, 1, colorFormat, samples, colorImageUsage);
+	const int slot = acquireEnvironmentSlot(environment);
+	if(slot == -1) {
+		return false;
 	}
-	if(depthFormat != VK_FORMAT_UNDEFINED) {
-		target.depthImage = createImage(width, height, 1, 1, depthFormat, samples, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+	const EnvironmentSlot& target = m_ibl.slots[slot];
+
+	// Staging buffer is released once this frame has completed.
+	const size_t dataSize = bake->texels.size() * sizeof(uint16_t);
+	Resource<VkBuffer> stagingBuffer = createBuffer(dataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, MemoryCategory::Staging);
+	copyToDevice(stagingBuffer.memory, bake->texels.data(), dataSize);
+	m_ibl.stagingBuffers.push_back(std::make_pair(stagingBuffer, m_frameCount + m_numFrames));
+
+	std::vector<VkBufferImageCopy> envCopyRegions(bake->envMapLevels);
+	for(int level=0; level<bake->envMapLevels; ++level) {
+		VkBufferImageCopy& copyRegion = envCopyRegions[level];
+		copyRegion = {};
+		copyRegion.bufferOffset = 4 * sizeof(uint16_t) * bake->envMapLevelOffset(level);
+		copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, uint32_t(level), 0, 6 };
+		copyRegion.imageExtent = { std::max(target.envTexture.width >> level, 1u), std::max(target.envTexture.height >> level, 1u), 1 };
 	}
+	VkBufferImageCopy irmapCopyRegion = {};
+	irmapCopyRegion.bufferOffset = 4 * sizeof(uint16_t) * bake->irmapOffset();
+	irmapCopyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 6 };
+	irmapCopyRegion.imageExtent = { target.irmapTexture.width, target.irmapTexture.height, 1 };
+
+	// Previous contents of evicted slot are discarded (but might still be sampled by frames in flight).
+	const std::initializer_list<ImageMemoryBarrier> preCopyBarriers = {
+		ImageMemoryBarrier(target.envTexture, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL),
+		ImageMemoryBarrier(target.irmapTexture, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL),
+	};
+	const std::initializer_list<ImageMemoryBarrier> postCopyBarriers = {
+		ImageMemoryBarrier(target.envTexture, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+		ImageMemoryBarrier(target.irmapTexture, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+	};
+	pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, preCopyBarriers);
+	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer.resource, target.envTexture.image.resource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)envCopyRegions.size(), envCopyRegions.data());
+	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer.resource, target.irmapTexture.image.resource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &irmapCopyRegion);
+	pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, postCopyBarriers);
 
-	VkImageViewCreateInfo viewCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
-	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-	viewCreateInfo.subresourceRange.levelCount = 1;
-	viewCreateInfo.subresourceRange.layerCount = 1;
-
-	if(target.colorImage.resource != VK_NULL_HANDLE) {
-		viewCreateInfo.image = target.colorImage.resource;
-		viewCreateInfo.format = colorFormat;
-		viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		if(VKFAILED(vkCreateImageView(m_device, &viewCreateInfo, nullptr, &target.colorView))) {
-			throw std::runtime_error("Failed to create render target color image view");
-		}
+	if(environment == m_ibl.environment) {
+		activateEnvironmentSlot(commandBuffer, slot);
 	}
+	return true;
+}
 
-	if(target.depthImage.resource != VK_NULL_HANDLE) {
-		viewCreateInfo.image = target.depthImage.resource;
-		viewCreateInfo.format = depthFormat;
-		viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-		if(VKFAILED(vkCreateImageView(m_device, &viewCreateInfo, nullptr, &target.depthView))) {
-			throw std::runtime_error("Failed to create render target depth-stencil image view");
-		}
+void Renderer::readbackEnvironmentSlot(VkCommandBuffer commandBuffer, int slot)
+{
+	// Only one readback is in flight at a time, environments which miss it are simply baked next time they get pre-filtered.
+	const int environment = m_ibl.cache.environment(slot);
+	if(m_ibl.readbackBuffer.resource != VK_NULL_HANDLE || EnvironmentCache::bakeExists(m_settings.environments[environment])) {
+		return;
 	}
 
-	return target;
+	const EnvironmentSlot& source = m_ibl.slots[slot];
+	const EnvironmentCache::Bake layout = { (int)source.envTexture.width, (int)source.envTexture.levels, (int)source.irmapTexture.width };
+	const size_t bufferSize = layout.numTexels() * 4 * sizeof(uint16_t);
+	m_ibl.readbackBuffer = createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, MemoryCategory::Staging);
+
+	std::vector<VkBufferImageCopy> envCopyRegions(layout.envMapLevels);
+	for(int level=0; level<layout.envMapLevels; ++level) {
+		VkBufferImageCopy& copyRegion = envCopyRegions[level];
+		copyRegion = {};
+		copyRegion.bufferOffset = 4 * sizeof(uint16_t) * layout.envMapLevelOffset(level);
+		copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, uint32_t(level), 0, 6 };
+		copyRegion.imageExtent = { std::max(source.envTexture.width >> level, 1u), std::max(source.envTexture.height >> level, 1u), 1 };
+	}
+	VkBufferImageCopy irmapCopyRegion = {};
+	irmapCopyRegion.bufferOffset = 4 * sizeof(uint16_t) * layout.irmapOffset();
+	irmapCopyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 6 };
+	irmapCopyRegion.imageExtent = { source.irmapTexture.width, source.irmapTexture.height, 1 };
+
+	const std::initializer_list<ImageMemoryBarrier> preCopyBarriers = {
+		ImageMemoryBarrier(source.envTexture, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL),
+		ImageMemoryBarrier(source.irmapTexture, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL),
+	};
+	const std::initializer_list<ImageMemoryBarrier> postCopyBarriers = {
+		ImageMemoryBarrier(source.envTexture, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+		ImageMemoryBarrier(source.irmapTexture, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+	};
+	pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, preCopyBarriers);
+	vkCmdCopyImageToBuffer(commandBuffer, source.envTexture.image.resource, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_ibl.readbackBuffer.resource, (uint32_t)envCopyRegions.size(), envCopyRegions.data());
+	vkCmdCopyImageToBuffer(commandBuffer, source.irmapTexture.image.resource, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_ibl.readbackBuffer.resource, 1, &irmapCopyRegion);
+	pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, postCopyBarriers);
+
+	// Make transfer results visible to host reads (buffer is mapped only after the frame's fence has been waited on).
+	VkBufferMemoryBarrier hostBarrier = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+	hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.buffer = m_ibl.readbackBuffer.resource;
+	hostBarrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+
+	m_ibl.readbackFrameCount = m_frameCount + m_numFrames;
+	m_ibl.readbackEnvironment = environment;
 }
 
-void Renderer::destroyRenderTarget(RenderTarget& target) const
+void Renderer::saveEnvironmentReadback()
 {
-	destroyImage(target.colorImage);
-	destroyImage(target.depthImage);
+	PROFILE_ZONE("Renderer::saveEnvironmentReadback");
+	std::shared_ptr<EnvironmentCache::Bake> bake{new EnvironmentCache::Bake{ (int)m_envTexture.width, (int)m_envTexture.levels, (int)m_irmapTexture.width }};
+	bake->texels.resize(4 * bake->numTexels());
 
-	if(target.colorView != VK_NULL_HANDLE) {
-		vkDestroyImageView(m_device, target.colorView, nullptr);
-	}
-	if(target.depthView != VK_NULL_HANDLE) {
-		vkDestroyImageView(m_device, target.depthView, nullptr);
+	const VkMappedMemoryRange invalidateRange = {
+		VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+		nullptr,
+		m_ibl.readbackBuffer.memory,
+		0,
+		VK_WHOLE_SIZE
+	};
+
+	void* mappedMemory;
+	if(VKFAILED(vkMapMemory(m_device, m_ibl.readbackBuffer.memory, 0, VK_WHOLE_SIZE, 0, &mappedMemory))) {
+		throw std::runtime_error("Failed to map device memory to host address space");
 	}
-	target = {};
+	vkInvalidateMappedMemoryRanges(m_device, 1, &invalidateRange);
+	std::memcpy(bake->texels.data(), mappedMemory, bake->texels.size() * sizeof(uint16_t));
+	vkUnmapMemory(m_device, m_ibl.readbackBuffer.memory);
+	destroyBuffer(m_ibl.readbackBuffer);
+	m_ibl.readbackBuffer = {};
+
+	// Encoding & writing is done in the background; failure to write a bake is not fatal.
+	const std::string filename = m_settings.environments[m_ibl.readbackEnvironment];
+	const uint32_t settingsHash = EnvironmentCache::bakeSettingsHash(m_settings);
+	m_ibl.bakeWriter = std::async(std::launch::async, [filename, settingsHash, bake]() {
+		try {
+			EnvironmentCache::saveBake(filename, settingsHash, *bake);
+		}
+		catch(const std::exception& e) {
+			std::fprintf(stderr, "%s\n", e.what());
+		}
+	});
 }
-	
-UniformBuffer Renderer::createUniformBuffer(VkDeviceSize capacity) const
-{
-	assert(capacity > 0);
 
-	UniformBuffer buffer = {};
-	buffer.buffer   = createBuffer(capacity, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	buffer.capacity = capacity;
-	
-	if(VKFAILED(vkMapMemory(m_device, buffer.buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.hostMemoryPtr))) {
-		throw std::runtime_error("Failed to map uniform buffer memory to host address space");
+int Renderer::acquireEnvironmentSlot(int environment)
+{
+	// Never evict current environment, the one being pre-filtered & (preferably) the one still being blended from.
+	const int blendSlot = (m_ibl.blendFrames > 0) ? m_ibl.previousSlot : -1;
+	int slot = m_ibl.cache.allocate(environment, { m_ibl.currentSlot, m_ibl.targetSlot, blendSlot });
+	if(slot == -1 && blendSlot != -1) {
+		m_ibl.blendFrames = 0;
+		slot = m_ibl.cache.allocate(environment, { m_ibl.currentSlot, m_ibl.targetSlot });
 	}
 
-	return buffer;
+	if(slot != -1 && m_ibl.slots[slot].envTexture.image.resource == VK_NULL_HANDLE) {
+		EnvironmentSlot& target = m_ibl.slots[slot];
+		target.envTexture = createTexture(m_envTexture.width, m_envTexture.height, 6, VK_FORMAT_R16G16B16A16_SFLOAT, MemoryCategory::IBL, 0, VK_IMAGE_USAGE_STORAGE_BIT);
+		target.irmapTexture = createTexture(m_irmapTexture.width, m_irmapTexture.height, 6, VK_FORMAT_R16G16B16A16_SFLOAT, MemoryCategory::IBL, 1, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+
+		// Pre-filtering expects its targets in shader read only layout.
+		VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+		{
+			const std::initializer_list<ImageMemoryBarrier> barriers = {
+				ImageMemoryBarrier(target.envTexture, 0, 0, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+				ImageMemoryBarrier(target.irmapTexture, 0, 0, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+			};
+			pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, barriers);
+		}
+		executeImmediateCommandBuffer(commandBuffer);
+	}
+	return slot;
 }
 
-void Renderer::destroyUniformBuffer(UniformBuffer& buffer) const
+void Renderer::activateEnvironmentSlot(VkCommandBuffer commandBuffer, int slot)
 {
-	if(buffer.hostMemoryPtr != nullptr && buffer.buffer.memory != VK_NULL_HANDLE) {
-		vkUnmapMemory(m_device, buffer.buffer.memory);
+	// Only descriptor sets change: blend from the previous environment over next frames.
+	m_ibl.previousSlot = m_ibl.currentSlot;
+	m_ibl.currentSlot = slot;
+	m_ibl.blendFrames = (m_ibl.previousSlot != slot) ? m_settings.iblBlendFrames : 0;
+	m_ibl.cache.touch(slot);
+
+	m_envTexture = m_ibl.slots[slot].envTexture;
+	m_irmapTexture = m_ibl.slots[slot].irmapTexture;
+	m_atlas.dirty = true;
+
+	// Environments are cycled in order: prefetch the next one if it has been baked but is no longer resident.
+	const int nextEnvironment = (m_ibl.environment + 1) % (int)m_settings.environments.size();
+	if(m_ibl.cache.lookup(nextEnvironment) == -1 && !m_ibl.pendingBake.valid() && EnvironmentCache::bakeExists(m_settings.environments[nextEnvironment])) {
+		loadEnvironmentBake(commandBuffer, nextEnvironment);
 	}
-	destroyBuffer(buffer.buffer);
-	buffer = {};
 }
-	
-UniformBufferAllocation Renderer::allocFromUniformBuffer(UniformBuffer& buffer, VkDeviceSize size) const
+
+void Renderer::updateIBL(VkCommandBuffer commandBuffer)
 {
-	const VkDeviceSize minAlignment = m_phyDevice.properties.limits.minUniformBufferOffsetAlignment;
-	const VkDeviceSize alignedSize = Utility::roundToPowerOfTwo(size, (int)minAlignment);
-	if(alignedSize > m_phyDevice.properties.limits.maxUniformBufferRange) {
-		throw std::invalid_argument("Requested uniform buffer sub-allocation size exceeds maxUniformBufferRange of current physical device");
+	PROFILE_ZONE("Renderer::updateIBL");
+	// Read back GPU timings of slices executed last time this frame slot was used (its submit fence has already been waited on).
+	const uint32_t firstQuery = 2 * m_frameIndex;
+	if(m_ibl.timestampQueryPool != VK_NULL_HANDLE) {
+		if(m_ibl.frameCost[m_frameIndex] > 0.0) {
+			uint64_t timestamps[2];
+			if(vkGetQueryPoolResults(m_device, m_ibl.timestampQueryPool, firstQuery, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+				const double milliseconds = double(timestamps[1] - timestamps[0]) * m_phyDevice.properties.limits.timestampPeriod * 1e-6;
+				m_iblScheduler.reportGPUTime(m_ibl.frameCost[m_frameIndex], milliseconds);
+			}
+			m_ibl.frameCost[m_frameIndex] = 0.0;
+		}
+		vkCmdResetQueryPool(commandBuffer, m_ibl.timestampQueryPool, firstQuery, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_ibl.timestampQueryPool, firstQuery);
 	}
-	if(buffer.cursor + alignedSize > buffer.capacity) {
-		throw std::overflow_error("Out of uniform buffer capacity while allocating memory");
+
+	FrameVector<IBLScheduler::Slice> slices{FrameAllocator<IBLScheduler::Slice>(m_frameArena)};
+	m_iblScheduler.nextSlices(m_settings.iblFrameBudget, slices);
+
+	// Startup refinement writes directly into current maps, environment switch into target slot.
+	const Texture& envTarget = (m_ibl.targetSlot >= 0) ? m_ibl.slots[m_ibl.targetSlot].envTexture : m_envTexture;
+	const Texture& irmapTarget = (m_ibl.targetSlot >= 0) ? m_ibl.slots[m_ibl.targetSlot].irmapTexture : m_irmapTexture;
+	const Texture& envTextureUnfiltered = m_ibl.envTextureUnfiltered;
+
+	// Output textures are sampled by previous frames' fragment shaders: transition them for compute shader access.
+	{
+		const std::initializer_list<ImageMemoryBarrier> barriers = {
+			ImageMemoryBarrier(envTarget, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL).mipLevels(1),
+			ImageMemoryBarrier(irmapTarget, 0, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL),
+		};
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, barriers);
 	}
 
-	UniformBufferAllocation allocation;
-	allocation.descriptorInfo.buffer = buffer.buffer.resource;
-	allocation.descriptorInfo.offset = buffer.cursor;
-	allocation.descriptorInfo.range  = alignedSize;
-	allocation.hostMemoryPtr = reinterpret_cast<uint8_t*>(buffer.hostMemoryPtr) + buffer.cursor;
+	const float deltaRoughness = 1.0f / std::max(float(envTarget.levels-1), 1.0f);
+	const uint32_t equirectGroupSize = m_workgroups.size(WorkgroupTuner::Equirect2Cube);
+	const uint32_t spmapGroupSize = m_workgroups.size(WorkgroupTuner::SpecularFilter);
+	const uint32_t irmapGroupSize = m_workgroups.size(WorkgroupTuner::Irradiance);
+
+	double cost = 0.0;
+	for(const IBLScheduler::Slice& slice : slices) {
+		switch(slice.pass) {
+		case IBLScheduler::Slice::ConvertEquirect:
+			{
+				const auto preDispatchBarrier = ImageMemoryBarrier(envTextureUnfiltered, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL).mipLevels(0, 1);
+				pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { preDispatchBarrier });
+
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ibl.equirectToCubePipeline);
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ibl.pipelineLayout, 0, 1, &m_ibl.convertDescriptorSet, 0, nullptr);
+				vkCmdDispatch(commandBuffer, envTextureUnfiltered.width/equirectGroupSize, envTextureUnfiltered.height/equirectGroupSize, 6);
+
+				const auto postDispatchBarrier = ImageMemoryBarrier(envTextureUnfiltered, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL).mipLevels(0, 1);
+				pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, { postDispatchBarrier });
+			}
+			break;
+		case IBLScheduler::Slice::GenerateMipmaps:
+			generateMipmaps(commandBuffer, envTextureUnfiltered, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+			break;
+		case IBLScheduler::Slice::CopyBaseLevel:
+			{
+				const std::initializer_list<ImageMemoryBarrier> preCopyBarriers = {
+					ImageMemoryBarrier(envTextureUnfiltered, 0, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL).mipLevels(0, 1),
+					ImageMemoryBarrier(envTarget, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL).mipLevels(0, 1),
+				};
+				const std::initializer_list<ImageMemoryBarrier> postCopyBarriers = {
+					ImageMemoryBarrier(envTextureUnfiltered, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL).mipLevels(0, 1),
+					ImageMemoryBarrier(envTarget, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL).mipLevels(0, 1),
+				};
+
+				pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, preCopyBarriers);
+
+				VkImageCopy copyRegion = {};
+				copyRegion.extent = { envTarget.width, envTarget.height, 1 };
+				copyRegion.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				copyRegion.srcSubresource.layerCount = envTarget.layers;
+				copyRegion.dstSubresource = copyRegion.srcSubresource;
+				vkCmdCopyImage(commandBuffer,
+					envTextureUnfiltered.image.resource, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					envTarget.image.resource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					1, &copyRegion);
+
+				pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, postCopyBarriers);
+			}
+			break;
+		case IBLScheduler::Slice::SpecularFilter:
+			{
+				const uint32_t size = std::max(envTarget.width >> slice.level, 1u);
+				const SpecularFilterPushConstants pushConstants = { uint32_t(slice.level-1), slice.level * deltaRoughness, uint32_t(slice.face), uint32_t(slice.row), deltaRoughness };
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ibl.spmapPipeline);
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ibl.pipelineLayout, 0, 1, &m_ibl.descriptorSet, 0, nullptr);
+				vkCmdPushConstants(commandBuffer, m_ibl.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SpecularFilterPushConstants), &pushConstants);
+				vkCmdDispatch(commandBuffer, size / spmapGroupSize, uint32_t(slice.numRows) / spmapGroupSize, 1);
+			}
+			break;
+		case IBLScheduler::Slice::SpecularFilterMipTail:
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ibl.pipelineLayout, 0, 1, &m_ibl.descriptorSet, 0, nullptr);
+			dispatchSpecularMipTail(commandBuffer, m_ibl.spmapTailPipeline, m_ibl.pipelineLayout, envTarget, uint32_t(slice.level));
+			break;
+		case IBLScheduler::Slice::IrradianceFilter:
+			{
+				const IrradianceFilterPushConstants pushConstants = { uint32_t(slice.face), uint32_t(slice.batch), uint32_t(slice.numBatches), 0.0f };
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ibl.irmapPipeline);
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ibl.pipelineLayout, 0, 1, &m_ibl.descriptorSet, 0, nullptr);
+				vkCmdPushConstants(commandBuffer, m_ibl.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(IrradianceFilterPushConstants), &pushConstants);
+				vkCmdDispatch(commandBuffer, irmapTarget.width/irmapGroupSize, irmapTarget.height/irmapGroupSize, 1);
+
+				// Next batch reads back results of this one.
+				const auto barrier = ImageMemoryBarrier(irmapTarget, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+				pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { barrier });
+			}
+			break;
+		}
+		cost += slice.cost;
+	}
+
+	// Transition output textures back for sampling in this frame's fragment shaders.
+	{
+		const std::initializer_list<ImageMemoryBarrier> barriers = {
+			ImageMemoryBarrier(envTarget, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL).mipLevels(1),
+			ImageMemoryBarrier(irmapTarget, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+		};
+		pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, barriers);
+	}
 
-	buffer.cursor += alignedSize;
-	return allocation;
-}
-	
-VkDescriptorSet Renderer::allocateDescriptorSet(VkDescriptorPool pool, VkDescriptorSetLayout layout) const
-{
-	VkDescriptorSet descriptorSet;
-	VkDescriptorSetAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
-	allocateInfo.descriptorPool = pool;
-	allocateInfo.descriptorSetCount = 1;
-	allocateInfo.pSetLayouts = &layout;
-	if(VKFAILED(vkAllocateDescriptorSets(m_device, &allocateInfo, &descriptorSet))) {
-		throw std::runtime_error("Failed to allocate descriptor set");
+	if(m_ibl.timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_ibl.timestampQueryPool, firstQuery + 1);
+		m_ibl.frameCost[m_frameIndex] = cost;
+	}
+
+	if(m_iblScheduler.empty()) {
+		// Readback buffer is recorded in MemoryStats & activation may prefetch the next environment's bake (std::async).
+		AllocationCounter::allowFrame();
+		if(m_ibl.targetSlot >= 0) {
+			// New environment is ready: bake it to disk for later reuse & bind it.
+			const int slot = m_ibl.targetSlot;
+			m_ibl.targetSlot = -1;
+			readbackEnvironmentSlot(commandBuffer, slot);
+			activateEnvironmentSlot(commandBuffer, slot);
+		}
+		else {
+			std::printf("Progressive IBL pre-processing complete\n");
+			if(!m_ibl.slots.empty()) {
+				readbackEnvironmentSlot(commandBuffer, m_ibl.currentSlot);
+			}
+		}
+
+		// Resources can be released once all in-flight frames referencing them have completed (unless environment can still change
+		// or reflection probes & irradiance volume need them).
+		if(m_settings.environments.size() <= 1 && m_settings.reflectionProbes.empty() && m_settings.irradianceVolume.x == 0) {
+			m_ibl.releaseFrameCount = m_frameCount + m_numFrames;
+		}
 	}
-	return descriptorSet;
 }
-	
-void Renderer::updateDescriptorSet(VkDescriptorSet dstSet, uint32_t dstBinding, VkDescriptorType descriptorType, const std::vector<VkDescriptorImageInfo>& descriptors) const
+
+Resource<VkBuffer> Renderer::createEnvironmentDistributionBuffer(const Image& image) const
 {
-	VkWriteDescriptorSet writeDescriptorSet = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
-	writeDescriptorSet.dstSet = dstSet;
-	writeDescriptorSet.dstBinding = dstBinding;
-	writeDescriptorSet.descriptorType = descriptorType;
-	writeDescriptorSet.descriptorCount = (uint32_t)descriptors.size();
-	writeDescriptorSet.pImageInfo = descriptors.data();
-	vkUpdateDescriptorSets(m_device, 1, &writeDescriptorSet, 0, nullptr);
+	const EnvironmentDistribution distribution = EnvironmentDistribution::build(image);
+	std::vector<char> data(distribution.bufferSize());
+	distribution.copyToBuffer(data.data());
+
+	Resource<VkBuffer> buffer = createBuffer(data.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::IBL);
+	copyToDevice(buffer.memory, data.data(), data.size());
+	return buffer;
 }
 
-void Renderer::updateDescriptorSet(VkDescriptorSet dstSet, uint32_t dstBinding, VkDescriptorType descriptorType, const std::vector<VkDescriptorBufferInfo>& descriptors) const
+void Renderer::dispatchSpecularMipTail(VkCommandBuffer commandBuffer, VkPipeline pipeline, VkPipelineLayout pipelineLayout, const Texture& envTexture, uint32_t tailLevel) const
 {
-	VkWriteDescriptorSet writeDescriptorSet = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
-	writeDescriptorSet.dstSet = dstSet;
-	writeDescriptorSet.dstBinding = dstBinding;
-	writeDescriptorSet.descriptorType = descriptorType;
-	writeDescriptorSet.descriptorCount = (uint32_t)descriptors.size();
-	writeDescriptorSet.pBufferInfo = descriptors.data();
-	vkUpdateDescriptorSets(m_device, 1, &writeDescriptorSet, 0, nullptr);
+	// Whole mip tail is bound to the descriptor set: pre-filter it with a single dispatch.
+	const float deltaRoughness = 1.0f / std::max(float(envTexture.levels-1), 1.0f);
+	const SpecularFilterPushConstants pushConstants = { tailLevel-1, tailLevel * deltaRoughness, 0, 0, deltaRoughness };
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SpecularFilterPushConstants), &pushConstants);
+
+	const int tailSize = std::max(int(envTexture.width >> tailLevel), 1);
+	vkCmdDispatch(commandBuffer, IBLScheduler::specularMipTailGroups(tailSize, envTexture.levels - tailLevel, kSpecularMipTailGroupSize), 1, 1);
 }
 
-VkDescriptorSetLayout Renderer::createDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>* bindings) const
+VkPipeline Renderer::createEquirectToCubePipeline(VkPipelineLayout pipelineLayout, uint32_t groupSize) const
 {
-	VkDescriptorSetLayout layout;
-	VkDescriptorSetLayoutCreateInfo createInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
-	if(bindings && bindings->size() > 0) {
-		createInfo.bindingCount = (uint32_t)bindings->size();
-		createInfo.pBindings = bindings->data();
-	}
-	if(VKFAILED(vkCreateDescriptorSetLayout(m_device, &createInfo, nullptr, &layout))) {
-		throw std::runtime_error("Failed to create descriptor set layout");
-	}
-	return layout;
+	const VkSpecializationMapEntry specializationMap[] = {
+		{ 0, offsetof(EquirectToCubeSpecialization, localSizeX), sizeof(uint32_t) },
+		{ 1, offsetof(EquirectToCubeSpecialization, localSizeY), sizeof(uint32_t) },
+	};
+	const EquirectToCubeSpecialization specializationData = { groupSize, groupSize };
+
+	const VkSpecializationInfo specializationInfo = { 2, specializationMap, sizeof(specializationData), &specializationData };
+	return createComputePipeline("shaders/spirv/equirect2cube_cs.spv", pipelineLayout, &specializationInfo);
 }
-	
-VkPipelineLayout Renderer::createPipelineLayout(const std::vector<VkDescriptorSetLayout>* setLayouts, const std::vector<VkPushConstantRange>* pushConstants) const
+
+VkPipeline Renderer::createSpecularFilterPipeline(VkPipelineLayout pipelineLayout, const SpecularFilterSpecialization& specializationData) const
 {
-	VkPipelineLayout layout;
-	VkPipelineLayoutCreateInfo createInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
-	if(setLayouts && setLayouts->size() > 0) {
-		createInfo.setLayoutCount = (uint32_t)setLayouts->size();
-		createInfo.pSetLayouts = setLayouts->data();
-	}
-	if(pushConstants && pushConstants->size() > 0) {
-		createInfo.pushConstantRangeCount = (uint32_t)pushConstants->size();
-		createInfo.pPushConstantRanges = pushConstants->data();
-	}
-	if(VKFAILED(vkCreatePipelineLayout(m_device, &createInfo, nullptr, &layout))) {
-		throw std::runtime_error("Failed to create pipeline layout");
-	}
-	return layout;
+	const VkSpecializationMapEntry specializationMap[] = {
+		{ 0, offsetof(SpecularFilterSpecialization, numMipLevels), sizeof(uint32_t) },
+		{ 1, offsetof(SpecularFilterSpecialization, maxNumSamples), sizeof(uint32_t) },
+		{ 2, offsetof(SpecularFilterSpecialization, sampleErrorTarget), sizeof(float) },
+		{ 3, offsetof(SpecularFilterSpecialization, foldedMipTail), sizeof(VkBool32) },
+		{ 4, offsetof(SpecularFilterSpecialization, localSizeX), sizeof(uint32_t) },
+		{ 5, offsetof(SpecularFilterSpecialization, localSizeY), sizeof(uint32_t) },
+		{ 6, offsetof(SpecularFilterSpecialization, useSampleTable), sizeof(VkBool32) },
+	};
+
+	const VkSpecializationInfo specializationInfo = { 7, specializationMap, sizeof(SpecularFilterSpecialization), &specializationData };
+	return createComputePipeline("shaders/spirv/spmap_cs.spv", pipelineLayout, &specializationInfo);
 }
 
-VkPipeline Renderer::createGraphicsPipeline(uint32_t subpass,
-		const std::string& vs, const std::string& fs, VkPipelineLayout layout,
-		const std::vector<VkVertexInputBindingDescription>* vertexInputBindings,
-		const std::vector<VkVertexInputAttributeDescription>* vertexAttributes,
-		const VkPipelineMultisampleStateCreateInfo* multisampleState,
-		const VkPipelineDepthStencilStateCreateInfo* depthStencilState) const
+VkPipeline Renderer::createIrradianceFilterPipeline(VkPipelineLayout pipelineLayout, uint32_t numSamples, bool envImportanceSampling, uint32_t groupSize) const
 {
-	const VkViewport defaultViewport = { 
-		0.0f,
-		0.0f, 
-		(float)m_frameRect.extent.width,
-		(float)m_frameRect.extent.height,
-		0.0f,
-		1.0f
-	};
-	const VkPipelineMultisampleStateCreateInfo defaultMultisampleState = {
-		VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-		nullptr,
-		0,
-		VK_SAMPLE_COUNT_1_BIT,
+	const VkSpecializationMapEntry specializationMap[] = {
+		{ 0, offsetof(IrradianceFilterSpecialization, numSamples), sizeof(uint32_t) },
+		{ 1, offsetof(IrradianceFilterSpecialization, envImportanceSampling), sizeof(VkBool32) },
+		{ 2, offsetof(IrradianceFilterSpecialization, localSizeX), sizeof(uint32_t) },
+		{ 3, offsetof(IrradianceFilterSpecialization, localSizeY), sizeof(uint32_t) },
 	};
-	
-	VkPipelineColorBlendAttachmentState defaultColorBlendAttachmentState = {};
-	defaultColorBlendAttachmentState.blendEnable = VK_FALSE;
-	defaultColorBlendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	const IrradianceFilterSpecialization specializationData = { numSamples, envImportanceSampling ? VK_TRUE : VK_FALSE, groupSize, groupSize };
 
-	VkShaderModule vertexShader = createShaderModuleFromFile(vs);
-	VkShaderModule fragmentShader = createShaderModuleFromFile(fs);
+	const VkSpecializationInfo specializationInfo = { 4, specializationMap, sizeof(specializationData), &specializationData };
+	return createComputePipeline("shaders/spirv/irmap_cs.spv", pipelineLayout, &specializationInfo);
+}
 
-	const VkPipelineShaderStageCreateInfo shaderStages[] = {
-		{ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0, VK_SHADER_STAGE_VERTEX_BIT,   vertexShader, "main", nullptr },
-		{ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0, VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader, "main", nullptr },
+VkPipeline Renderer::createSpecularBRDFPipeline(VkPipelineLayout pipelineLayout, uint32_t numSamples, uint32_t groupSize) const
+{
+	const VkSpecializationMapEntry specializationMap[] = {
+		{ 0, offsetof(SpecularBRDFSpecialization, numSamples), sizeof(uint32_t) },
+		{ 1, offsetof(SpecularBRDFSpecialization, localSizeX), sizeof(uint32_t) },
+		{ 2, offsetof(SpecularBRDFSpecialization, localSizeY), sizeof(uint32_t) },
 	};
+	const SpecularBRDFSpecialization specializationData = { numSamples, groupSize, groupSize };
 
-	VkPipelineVertexInputStateCreateInfo vertexInputState = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
-	if(vertexInputBindings) {
-		vertexInputState.vertexBindingDescriptionCount = (uint32_t)vertexInputBindings->size();
-		vertexInputState.pVertexBindingDescriptions = vertexInputBindings->data();
-	}
-	if(vertexAttributes) {
-		vertexInputState.vertexAttributeDescriptionCount = (uint32_t)vertexAttributes->size();
-		vertexInputState.pVertexAttributeDescriptions = vertexAttributes->data();
+	const VkSpecializationInfo specializationInfo = { 3, specializationMap, sizeof(specializationData), &specializationData };
+	return createComputePipeline("shaders/spirv/spbrdf_cs.spv", pipelineLayout, &specializationInfo);
+}
+
+void Renderer::tuneWorkgroupSize(WorkgroupTuner::Kernel kernel,
+	const std::function<VkPipeline(uint32_t)>& createVariant,
+	const std::function<void(VkCommandBuffer, VkPipeline, uint32_t)>& recordDispatch)
+{
+	if(!m_workgroups.pending(kernel)) {
+		return;
 	}
 
-	VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = { VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
-	inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssemblyState.primitiveRestartEnable = VK_FALSE;
+	const std::vector<int> candidates = WorkgroupTuner::candidates(int(m_phyDevice.properties.limits.maxComputeWorkGroupInvocations));
+	std::vector<double> timings;
 
-	VkPipelineViewportStateCreateInfo viewportState = { VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
-	viewportState.viewportCount = 1;
-	viewportState.scissorCount = 1;
-	viewportState.pViewports = &defaultViewport;
-	viewportState.pScissors = &m_frameRect;
+	VkQueryPool timestampQueryPool;
+	{
+		VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		createInfo.queryCount = 2;
+		if(VKFAILED(vkCreateQueryPool(m_device, &createInfo, nullptr, &timestampQueryPool))) {
+			throw std::runtime_error("Failed to create timestamp query pool");
+		}
+	}
 
-	VkPipelineRasterizationStateCreateInfo rasterizationState = { VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
-	rasterizationState.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterizationState.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizationState.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-	rasterizationState.lineWidth = 1.0f;
+	for(int groupSize : candidates) {
+		VkPipeline pipeline = createVariant(uint32_t(groupSize));
 
-	const VkPipelineColorBlendAttachmentState colorBlendAttachmentStates[] = {
-		defaultColorBlendAttachmentState
-	};
-	VkPipelineColorBlendStateCreateInfo colorBlendState = { VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
-	colorBlendState.attachmentCount = 1;
-	colorBlendState.pAttachments = colorBlendAttachmentStates;
-	
-	VkGraphicsPipelineCreateInfo pipelineCreateInfo = { VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
-	pipelineCreateInfo.stageCount = 2;
-	pipelineCreateInfo.pStages = shaderStages;
-	pipelineCreateInfo.pVertexInputState = &vertexInputState;
-	pipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
-	pipelineCreateInfo.pViewportState = &viewportState;
-	pipelineCreateInfo.pRasterizationState = &rasterizationState;
-	pipelineCreateInfo.pMultisampleState = (multisampleState != nullptr) ? multisampleState : &defaultMultisampleState;
-	pipelineCreateInfo.pDepthStencilState = depthStencilState;
-	pipelineCreateInfo.pColorBlendState = &colorBlendState;
-	pipelineCreateInfo.layout = layout;
-	pipelineCreateInfo.renderPass = m_renderPass;
-	pipelineCreateInfo.subpass = subpass;
+		// First submission absorbs one-time costs (shader compilation, cache warm-up) and is not measured.
+		double gpuTime = std::numeric_limits<double>::max();
+		for(int run=0; run<=WorkgroupTuner::NumTimedRuns; ++run) {
+			VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+			vkCmdResetQueryPool(commandBuffer, timestampQueryPool, 0, 2);
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, 0);
+			recordDispatch(commandBuffer, pipeline, uint32_t(groupSize));
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, 1);
+			executeImmediateCommandBuffer(commandBuffer);
+			if(run > 0) {
+				gpuTime = std::min(gpuTime, elapsedMilliseconds(timestampQueryPool));
+			}
+		}
+		timings.push_back(gpuTime);
 
-	VkPipeline pipeline;
-	if(VKFAILED(vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline))) {
-		throw std::runtime_error("Failed to create graphics pipeline");
+		vkDestroyPipeline(m_device, pipeline, nullptr);
 	}
 
-	vkDestroyShaderModule(m_device, vertexShader, nullptr);
-	vkDestroyShaderModule(m_device, fragmentShader, nullptr);
-
-	return pipeline;
+	vkDestroyQueryPool(m_device, timestampQueryPool, nullptr);
+	m_workgroups.select(kernel, candidates, timings);
 }
 
-VkPipeline Renderer::createComputePipeline(const std::string& cs, VkPipelineLayout layout,
-	const VkSpecializationInfo* specializationInfo) const
+void Renderer::convertSpecularAtlas(VkCommandBuffer commandBuffer)
 {
-	VkShaderModule computeShader = createShaderModuleFromFile(cs);
-
-	const VkPipelineShaderStageCreateInfo shaderStage = {
-		VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0, VK_SHADER_STAGE_COMPUTE_BIT, computeShader, "main", specializationInfo,
+	PROFILE_ZONE("Renderer::convertSpecularAtlas");
+	// This frame's previous command buffer has already completed so its set can be safely pointed at current environment.
+	VkDescriptorSet descriptorSet = m_atlas.convertDescriptorSets[m_frameIndex];
+	const VkDescriptorImageInfo inputTexture = { VK_NULL_HANDLE, m_envTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	updateDescriptorSet(descriptorSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { inputTexture });
+
+	// Cube map may have just been written by pre-filtering or bake upload (whose barriers only cover fragment shader reads).
+	const std::initializer_list<ImageMemoryBarrier> preDispatchBarriers = {
+		ImageMemoryBarrier(m_envTexture, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+		ImageMemoryBarrier(m_atlas.texture, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL),
 	};
+	pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, preDispatchBarriers);
 
-	VkComputePipelineCreateInfo createInfo = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
-	createInfo.stage = shaderStage;
-	createInfo.layout = layout;
+	// Whole atlas in one dispatch, texels outside of level regions are skipped.
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_atlas.convertPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_atlas.pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	vkCmdDispatch(commandBuffer, m_atlas.texture.width/32, m_atlas.texture.height/32, 1);
 
-	VkPipeline pipeline;
-	if(VKFAILED(vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &createInfo, nullptr, &pipeline))) {
-		throw std::runtime_error("Failed to create compute pipeline");
-	}
+	const auto postDispatchBarrier = ImageMemoryBarrier(m_atlas.texture, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	pipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { postDispatchBarrier });
 
-	vkDestroyShaderModule(m_device, computeShader, nullptr);
-	
-	return pipeline;
+	m_atlas.dirty = false;
 }
-	
-VkShaderModule Renderer::createShaderModuleFromFile(const std::string& filename) const
+
+void Renderer::reportSpecularAtlas()
 {
-	std::printf("Loading SPIR-V shader module: %s\n", filename.c_str());
+	const uint32_t numLevels = OctahedralAtlas::numLevels(m_envTexture.levels);
+	std::vector<glm::vec4> errorResults(numLevels * OctahedralAtlas::NumErrorDirections);
+	const VkDeviceSize resultsSize = errorResults.size() * sizeof(glm::vec4);
 
-	const auto shaderCode = File::readBinary(filename);
-	if(shaderCode.size() == 0) {
-		throw std::runtime_error("Invalid shader module file");
+	Resource<VkBuffer> resultsBuffer = createBuffer(resultsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Other);
+	VkPipeline pipeline = createComputePipeline("shaders/spirv/octcompare_cs.spv", m_atlas.pipelineLayout);
+
+	VkDescriptorSet descriptorSet = allocateDescriptorSet(m_atlas.descriptorPool, m_atlas.setLayout);
+	{
+		const VkDescriptorImageInfo cubeTexture = { VK_NULL_HANDLE, m_envTexture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		const VkDescriptorImageInfo atlasTexture = { VK_NULL_HANDLE, m_atlas.texture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		const VkDescriptorBufferInfo results = { resultsBuffer.resource, 0, resultsSize };
+		updateDescriptorSet(descriptorSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { cubeTexture });
+		updateDescriptorSet(descriptorSet, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { atlasTexture });
+		updateDescriptorSet(descriptorSet, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { results });
 	}
 
-	VkShaderModuleCreateInfo createInfo = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
-	createInfo.codeSize = shaderCode.size();
-	createInfo.pCode    = reinterpret_cast<const uint32_t*>(&shaderCode[0]);
+	VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+	if(m_phyDevice.properties.limits.timestampComputeAndGraphics) {
+		VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		createInfo.queryCount = 4;
+		if(VKFAILED(vkCreateQueryPool(m_device, &createInfo, nullptr, &timestampQueryPool))) {
+			throw std::runtime_error("Failed to create timestamp query pool");
+		}
+	}
 
-	VkShaderModule shaderModule = VK_NULL_HANDLE;
-	if(VKFAILED(vkCreateShaderModule(m_device, &createInfo, nullptr, &shaderModule))) {
-		throw std::runtime_error("Failed to create shader module");
+	VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_atlas.pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+		// Per-level error.
+		uint32_t mode = 0;
+		vkCmdPushConstants(commandBuffer, m_atlas.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &mode);
+		vkCmdDispatch(commandBuffer, OctahedralAtlas::NumErrorDirections/64, numLevels, 1);
+
+		VkMemoryBarrier hostBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+		hostBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+
+		// Sampling cost of cube map (mode 1) & atlas (mode 2): first dispatch of each mode warms up caches & is not timed.
+		// Execution dependencies keep timed dispatches from overlapping with anything else.
+		if(timestampQueryPool != VK_NULL_HANDLE) {
+			vkCmdResetQueryPool(commandBuffer, timestampQueryPool, 0, 4);
+			for(mode=1; mode<=2; ++mode) {
+				const uint32_t firstQuery = 2 * (mode-1);
+				vkCmdPushConstants(commandBuffer, m_atlas.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &mode);
+				vkCmdDispatch(commandBuffer, OctahedralAtlas::NumCostInvocations/64, 1, 1);
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampQueryPool, firstQuery);
+				vkCmdDispatch(commandBuffer, OctahedralAtlas::NumCostInvocations/64, 1, 1);
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampQueryPool, firstQuery + 1);
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+			}
+		}
 	}
-	return shaderModule;
-}
-	
-VkCommandBuffer Renderer::beginImmediateCommandBuffer() const
-{
-	VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	if(VKFAILED(vkBeginCommandBuffer(m_commandBuffers[m_frameIndex], &beginInfo))) {
-		throw std::runtime_error("Failed to begin immediate command buffer (still in recording state?)");
+	executeImmediateCommandBuffer(commandBuffer);
+
+	void* resultsMemoryPtr;
+	if(VKFAILED(vkMapMemory(m_device, resultsBuffer.memory, 0, VK_WHOLE_SIZE, 0, &resultsMemoryPtr))) {
+		throw std::runtime_error("Failed to map octahedral atlas comparison results to host address space");
 	}
-	return m_commandBuffers[m_frameIndex];
+	std::memcpy(errorResults.data(), resultsMemoryPtr, resultsSize);
+	vkUnmapMemory(m_device, resultsBuffer.memory);
+
+	double costMilliseconds[2] = {};
+	if(timestampQueryPool != VK_NULL_HANDLE) {
+		uint64_t timestamps[4];
+		if(vkGetQueryPoolResults(m_device, timestampQueryPool, 0, 4, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS) {
+			for(int i=0; i<2; ++i) {
+				costMilliseconds[i] = double(timestamps[2*i+1] - timestamps[2*i]) * m_phyDevice.properties.limits.timestampPeriod * 1e-6;
+			}
+		}
+		vkDestroyQueryPool(m_device, timestampQueryPool, nullptr);
+	}
+
+	OctahedralAtlas::printReport(m_envTexture.width, m_envTexture.levels, errorResults, costMilliseconds[0], costMilliseconds[1]);
+
+	vkDestroyPipeline(m_device, pipeline, nullptr);
+	destroyBuffer(resultsBuffer);
 }
-	
-void Renderer::executeImmediateCommandBuffer(VkCommandBuffer commandBuffer) const
+
+double Renderer::compareIBLMaps(VkPipeline pipeline, VkPipelineLayout pipelineLayout, VkDescriptorSet descriptorSet, VkSampler sampler,
+	const Texture& texture, const Texture& reference, const Resource<VkBuffer>& resultsBuffer, uint32_t numGroupsX, uint32_t numGroupsY) const
 {
-	if(VKFAILED(vkEndCommandBuffer(commandBuffer))) {
-		throw std::runtime_error("Failed to end immediate command buffer");
-	}
+	// Both comparison shaders run 64 invocations per thread group, each writing a single (error, reference) pair.
+	std::vector<glm::vec2> results(numGroupsX * numGroupsY * 64);
 
-	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-	vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(m_queue);
+	// Compared maps are bound to input & reference texture bindings (0 & 5) of benchmark descriptor set.
+	const VkDescriptorImageInfo inputTexture = { sampler, texture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	const VkDescriptorImageInfo referenceTexture = { sampler, reference.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	updateDescriptorSet(descriptorSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { inputTexture });
+	updateDescriptorSet(descriptorSet, 5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { referenceTexture });
 
-	if(VKFAILED(vkResetCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT))) {
-		throw std::runtime_error("Failed to reset immediate command buffer");
+	VkCommandBuffer commandBuffer = beginImmediateCommandBuffer();
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+		vkCmdDispatch(commandBuffer, numGroupsX, numGroupsY, 1);
+
+		VkMemoryBarrier hostBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+		hostBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+	}
+	executeImmediateCommandBuffer(commandBuffer);
+
+	void* resultsMemoryPtr;
+	if(VKFAILED(vkMapMemory(m_device, resultsBuffer.memory, 0, VK_WHOLE_SIZE, 0, &resultsMemoryPtr))) {
+		throw std::runtime_error("Failed to map IBL benchmark comparison results to host address space");
 	}
+	std::memcpy(results.data(), resultsMemoryPtr, results.size() * sizeof(glm::vec2));
+	vkUnmapMemory(m_device, resultsBuffer.memory);
+
+	return IBLBenchmark::relativeError(results);
 }
-	
-void Renderer::copyToDevice(VkDeviceMemory deviceMemory, const void* data, size_t size) const
-{
-	const VkMappedMemoryRange flushRange = {
-		VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-		nullptr,
-		deviceMemory,
-		0,
-		VK_WHOLE_SIZE
-	};
 
-	void* mappedMemory;
-	if(VKFAILED(vkMapMemory(m_device, deviceMemory, 0, VK_WHOLE_SIZE, 0, &mappedMemory))) {
-		throw std::runtime_error("Failed to map device memory to host address space");
+double Renderer::elapsedMilliseconds(VkQueryPool timestampQueryPool) const
+{
+	uint64_t timestamps[2];
+	if(vkGetQueryPoolResults(m_device, timestampQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to read timestamp query results");
 	}
-	std::memcpy(mappedMemory, data, size);
-	vkFlushMappedMemoryRanges(m_device, 1, &flushRange);
-	vkUnmapMemory(m_device, deviceMemory);
+	return double(timestamps[1] - timestamps[0]) * m_phyDevice.properties.limits.timestampPeriod * 1e-6;
 }
-	
-void Renderer::pipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask, const std::vector<ImageMemoryBarrier>& barriers) const
+
+void Renderer::releaseIBLResources()
 {
-	vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, (uint32_t)barriers.size(), reinterpret_cast<const VkImageMemoryBarrier*>(barriers.data()));
+	for(VkImageView mipTailView : m_ibl.envTextureMipTailViews) {
+		vkDestroyImageView(m_device, mipTailView, nullptr);
+	}
+	m_ibl.envTextureMipTailViews.clear();
+
+	destroyTexture(m_ibl.envTextureUnfiltered);
+	destroyTexture(m_ibl.envTextureEquirect);
+	m_ibl.envTextureUnfiltered = {};
+	m_ibl.envTextureEquirect = {};
+
+	vkDestroyPipeline(m_device, m_ibl.equirectToCubePipeline, nullptr);
+	vkDestroyPipeline(m_device, m_ibl.spmapPipeline, nullptr);
+	vkDestroyPipeline(m_device, m_ibl.spmapTailPipeline, nullptr);
+	destroyBuffer(m_ibl.sampleTableBuffer);
+	destroyBuffer(m_ibl.distributionBuffer);
+	vkDestroyPipeline(m_device, m_ibl.irmapPipeline, nullptr);
+	vkDestroyPipelineLayout(m_device, m_ibl.pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(m_device, m_ibl.descriptorPool, nullptr);
+	vkDestroySampler(m_device, m_ibl.sampler, nullptr);
+	vkDestroyQueryPool(m_device, m_ibl.timestampQueryPool, nullptr);
+
+	m_ibl.equirectToCubePipeline = VK_NULL_HANDLE;
+	m_ibl.spmapPipeline = VK_NULL_HANDLE;
+	m_ibl.spmapTailPipeline = VK_NULL_HANDLE;
+	m_ibl.irmapPipeline = VK_NULL_HANDLE;
+	m_ibl.pipelineLayout = VK_NULL_HANDLE;
+	m_ibl.descriptorPool = VK_NULL_HANDLE;
+	m_ibl.descriptorSet = VK_NULL_HANDLE;
+	m_ibl.convertDescriptorSet = VK_NULL_HANDLE;
+	m_ibl.sampler = VK_NULL_HANDLE;
+	m_ibl.timestampQueryPool = VK_NULL_HANDLE;
 }
 
 void Renderer::presentFrame()
 {
+	PROFILE_ZONE("Renderer::presentFrame");
 	VkResult presentResult;
 
 	VkPresentInfoKHR presentInfo = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
@@ -1846,6 +6034,7 @@ PhyDevice Renderer::choosePhyDevice(VkSurfaceKHR surface, const VkPhysicalDevice
 		if(!requiredExtensionsSupported) {
 			continue;
 		}
+		phyDevice.extensions = phyDeviceExtensions;
 
 		// Check if all required image formats are supported.
 		if(!checkPhyDeviceImageFormatsSupport(phyDevice)) {
@@ -1906,6 +6095,16 @@ PhyDevice Renderer::choosePhyDevice(VkSurfaceKHR surface, const VkPhysicalDevice
 	}
 	return rankedPhyDevices.begin()->second;
 }
+
+bool Renderer::isExtensionSupported(const PhyDevice& phyDevice, const char* name)
+{
+	for(const VkExtensionProperties& extension : phyDevice.extensions) {
+		if(std::strcmp(extension.extensionName, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
 	
 void Renderer::queryPhyDeviceSurfaceCapabilities(PhyDevice& phyDevice, VkSurfaceKHR surface) const
 {
@@ -1951,6 +6150,12 @@ bool Renderer::checkPhyDeviceImageFormatsSupport(PhyDevice& phyDevice) const
 		return false;
 	}
 
+	// Check for scene color render target format support (wide format every compact one falls back to).
+	if(VKFAILED(vkGetPhysicalDeviceImageFormatProperties(phyDevice.handle,
+		VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, 0, &imageProperties))) {
+		return false;
+	}
+
 	// Check for BRDF LUT format support.
 	if(VKFAILED(vkGetPhysicalDeviceImageFormatProperties(phyDevice.handle,
 		VK_FORMAT_R16G16_SFLOAT, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, 0, &imageProperties))) {
@@ -2019,6 +6224,21 @@ bool Renderer::memoryTypeNeedsStaging(uint32_t memoryTypeIndex) const
 	return (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0;
 }
 
+void Renderer::updateMemoryBudget()
+{
+	if(!m_memoryBudgetSupported) {
+		return;
+	}
+
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT };
+	VkPhysicalDeviceMemoryProperties2KHR memoryProperties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR };
+	memoryProperties.pNext = &budgetProperties;
+	vkGetPhysicalDeviceMemoryProperties2KHR(m_phyDevice.handle, &memoryProperties);
+	for(uint32_t i=0; i<memoryProperties.memoryProperties.memoryHeapCount; ++i) {
+		m_memoryStats.setDriverBudget((int)i, budgetProperties.heapUsage[i], budgetProperties.heapBudget[i]);
+	}
+}
+
 #if _DEBUG
 VkBool32 Renderer::logMessage(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objectType, uint64_t object, size_t location, int32_t messageCode, const char* pLayerPrefix, const char* pMessage, void* pUserData)
 {
@@ -12,11 +12,28 @@
 #include <cstdint>
 #include <memory>
 #include <vector>
+#include <future>
+#include <utility>
 #include <initializer_list>
+#include <functional>
 
 #include <volk.h>
 
 #include "common/renderer.hpp"
+#include "common/ibl.hpp"
+#include "common/envcache.hpp"
+#include "common/probes.hpp"
+#include "common/irradiancevolume.hpp"
+#include "common/octatlas.hpp"
+#include "common/workgroups.hpp"
+#include "common/clusters.hpp"
+#include "common/shadows.hpp"
+#include "common/memorystats.hpp"
+#include "common/taa.hpp"
+#include "common/dynres.hpp"
+#include "common/exposure.hpp"
+#include "common/permutations.hpp"
+#include "common/framearena.hpp"
 
 class Mesh;
 class Image;
@@ -32,6 +49,7 @@ struct PhyDevice
 	VkSurfaceCapabilitiesKHR surfaceCaps;
 	std::vector<VkSurfaceFormatKHR> surfaceFormats;
 	std::vector<VkPresentModeKHR> presentModes;
+	std::vector<VkExtensionProperties> extensions;
 	uint32_t queueFamilyIndex;
 };
 
@@ -46,8 +64,9 @@ struct Resource
 
 struct MeshBuffer
 {
-	Resource<VkBuffer> vertexBuffer;
+	Resource<VkBuffer> vertexBuffer;   // Interleaved vertices or (de-interleaved layout) attributes without position.
 	Resource<VkBuffer> indexBuffer;
+	Resource<VkBuffer> positionBuffer; // De-interleaved layout only: tightly packed positions (binding 0, alone in depth-only passes).
 	uint32_t numElements;
 };
 
@@ -60,6 +79,12 @@ struct Texture
 	uint32_t levels;
 };
 
+struct EnvironmentSlot
+{
+	Texture envTexture;
+	Texture irmapTexture;
+};
+
 struct RenderTarget
 {
 	Resource<VkImage> colorImage;
@@ -128,30 +153,53 @@ struct ImageMemoryBarrier
 	}
 };
 
+struct ShadingUniforms;
+struct SpecularFilterSpecialization;
+
 class Renderer final : public RendererInterface
 {
 public:
-	GLFWwindow* initialize(int width, int height, int maxSamples) override;
+	GLFWwindow* initialize(int width, int height, int maxSamples, const RendererSettings& settings) override;
 	void shutdown() override;
 	void setup() override;
 	void render(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene) override;
+	void runBenchmark(BenchmarkKind kind, GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene) override;
 
 private:
-	Resource<VkBuffer> createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryFlags) const;
-	Resource<VkImage> createImage(uint32_t width, uint32_t height, uint32_t layers, uint32_t levels, VkFormat format, uint32_t samples, VkImageUsageFlags usage) const;
+	void benchmarkIBL();
+	void benchmarkLights(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene);
+	void benchmarkDepthPrepass(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene);
+	void benchmarkHalfPrecision(GLFWwindow* window, const ViewSettings& view, const SceneSettings& scene);
+
+	// Per-feature parts of setup().
+	void createMainRenderPass();
+	void createTAAResources();
+	void createExposureResources();
+	void createReflectionProbeCaptureResources();
+	void createIrradianceVolumeCaptureResources();
+	void createShadowResources();
+	void createOctahedralAtlasResources();
+
+	Resource<VkBuffer> createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryFlags, MemoryCategory category) const;
+	Resource<VkImage> createImage(uint32_t width, uint32_t height, uint32_t layers, uint32_t levels, VkFormat format, uint32_t samples, VkImageUsageFlags usage,
+		MemoryCategory category, VkImageType imageType = VK_IMAGE_TYPE_2D, uint32_t depth = 1) const;
 	void destroyBuffer(Resource<VkBuffer>& buffer) const;
 	void destroyImage(Resource<VkImage>& image) const;
 
-	MeshBuffer createMeshBuffer(const std::shared_ptr<Mesh>& mesh) const;
+	MeshBuffer createMeshBuffer(const std::shared_ptr<Mesh>& mesh, bool deinterleaved=false) const;
 	void destroyMeshBuffer(MeshBuffer& buffer) const;
 
-	Texture createTexture(uint32_t width, uint32_t height, uint32_t layers, VkFormat format, uint32_t levels=0, VkImageUsageFlags additionalUsage=0) const;
-	Texture createTexture(const std::shared_ptr<Image>& image, VkFormat format, uint32_t levels=0) const;
+	Texture createTexture(uint32_t width, uint32_t height, uint32_t layers, VkFormat format, MemoryCategory category, uint32_t levels=0, VkImageUsageFlags additionalUsage=0) const;
+	Texture createTexture(const std::shared_ptr<Image>& image, VkFormat format, MemoryCategory category, uint32_t levels=0) const;
+	Texture createVolumeTexture(uint32_t width, uint32_t height, uint32_t depth, VkFormat format, MemoryCategory category, VkImageUsageFlags additionalUsage=0) const;
 	VkImageView createTextureView(const Texture& texture, VkFormat format, VkImageAspectFlags aspectMask, uint32_t baseMipLevel, uint32_t numMipLevels) const;
+	VkImageView createTextureView(const Texture& texture, VkImageViewType viewType, VkFormat format, uint32_t baseMipLevel, uint32_t numMipLevels, uint32_t baseArrayLayer, uint32_t numArrayLayers,
+		VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT) const;
 	void generateMipmaps(const Texture& texture) const;
+	void generateMipmaps(VkCommandBuffer commandBuffer, const Texture& texture, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask) const;
 	void destroyTexture(Texture& texture) const;
 
-	RenderTarget createRenderTarget(uint32_t width, uint32_t height, uint32_t samples, VkFormat colorFormat, VkFormat depthFormat) const;
+	RenderTarget createRenderTarget(uint32_t width, uint32_t height, uint32_t samples, VkFormat colorFormat, VkFormat depthFormat, VkImageUsageFlags additionalUsage=0) const;
 	void destroyRenderTarget(RenderTarget& rt) const;
 
 	UniformBuffer createUniformBuffer(VkDeviceSize capacity) const;
@@ -166,6 +214,9 @@ private:
 	VkDescriptorSet allocateDescriptorSet(VkDescriptorPool pool, VkDescriptorSetLayout layout) const;
 	void updateDescriptorSet(VkDescriptorSet dstSet, uint32_t dstBinding, VkDescriptorType descriptorType, const std::vector<VkDescriptorImageInfo>& descriptors) const;
 	void updateDescriptorSet(VkDescriptorSet dstSet, uint32_t dstBinding, VkDescriptorType descriptorType, const std::vector<VkDescriptorBufferInfo>& descriptors) const;
+	// Braced descriptor lists (no temporary vector is allocated).
+	void updateDescriptorSet(VkDescriptorSet dstSet, uint32_t dstBinding, VkDescriptorType descriptorType, std::initializer_list<VkDescriptorImageInfo> descriptors) const;
+	void updateDescriptorSet(VkDescriptorSet dstSet, uint32_t dstBinding, VkDescriptorType descriptorType, std::initializer_list<VkDescriptorBufferInfo> descriptors) const;
 
 	VkDescriptorSetLayout createDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>* bindings=nullptr) const;
 	VkPipelineLayout createPipelineLayout(const std::vector<VkDescriptorSetLayout>* setLayouts=nullptr, const std::vector<VkPushConstantRange>* pushConstants=nullptr) const;
@@ -175,7 +226,12 @@ private:
 		const std::vector<VkVertexInputBindingDescription>* vertexInputBindings = nullptr,
 		const std::vector<VkVertexInputAttributeDescription>* vertexAttributes = nullptr,
 		const VkPipelineMultisampleStateCreateInfo* multisampleState = nullptr,
-		const VkPipelineDepthStencilStateCreateInfo* depthStencilState = nullptr) const;
+		const VkPipelineDepthStencilStateCreateInfo* depthStencilState = nullptr,
+		VkRenderPass renderPass = VK_NULL_HANDLE,
+		const VkRect2D* renderArea = nullptr,
+		VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+		const VkSpecializationInfo* fragmentSpecializationInfo = nullptr,
+		const VkPipelineRasterizationStateCreateInfo* rasterizationState = nullptr) const;
 
 	VkPipeline createComputePipeline(const std::string& cs, VkPipelineLayout layout,
 		const VkSpecializationInfo* specializationInfo=nullptr) const;
@@ -186,16 +242,59 @@ private:
 	void executeImmediateCommandBuffer(VkCommandBuffer commandBuffer) const;
 	void copyToDevice(VkDeviceMemory deviceMemory, const void* data, size_t size) const;
 	void pipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask, const std::vector<ImageMemoryBarrier>& barriers) const;
+	void pipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask, std::initializer_list<ImageMemoryBarrier> barriers) const;
+
+	void switchEnvironment(VkCommandBuffer commandBuffer, int environment);
+	void loadEnvironment(int environment);
+	void loadEnvironmentBake(VkCommandBuffer commandBuffer, int environment);
+	void queueEnvironmentFilter(const std::shared_ptr<Image>& image);
+	bool uploadEnvironmentBake(VkCommandBuffer commandBuffer, const std::shared_ptr<EnvironmentCache::Bake>& bake, int environment);
+	// Waits for the bake read in the background & uploads it, returns false if it could not be read (e.g. corrupt file) or uploaded.
+	bool uploadPendingEnvironmentBake(VkCommandBuffer commandBuffer, int environment);
+	void readbackEnvironmentSlot(VkCommandBuffer commandBuffer, int slot);
+	void saveEnvironmentReadback();
+	int acquireEnvironmentSlot(int environment);
+	void activateEnvironmentSlot(VkCommandBuffer commandBuffer, int slot);
+	void updateIBL(VkCommandBuffer commandBuffer);
+	void dispatchSpecularMipTail(VkCommandBuffer commandBuffer, VkPipeline pipeline, VkPipelineLayout pipelineLayout, const Texture& envTexture, uint32_t tailLevel) const;
+	VkPipeline createEquirectToCubePipeline(VkPipelineLayout pipelineLayout, uint32_t groupSize) const;
+	VkPipeline createSpecularFilterPipeline(VkPipelineLayout pipelineLayout, const SpecularFilterSpecialization& specializationData) const;
+	VkPipeline createIrradianceFilterPipeline(VkPipelineLayout pipelineLayout, uint32_t numSamples, bool envImportanceSampling, uint32_t groupSize) const;
+	VkPipeline createSpecularBRDFPipeline(VkPipelineLayout pipelineLayout, uint32_t numSamples, uint32_t groupSize) const;
+	void tuneWorkgroupSize(WorkgroupTuner::Kernel kernel, const std::function<VkPipeline(uint32_t)>& createVariant,
+		const std::function<void(VkCommandBuffer, VkPipeline, uint32_t)>& recordDispatch);
+	Resource<VkBuffer> createEnvironmentDistributionBuffer(const class Image& image) const;
+	void releaseIBLResources();
+	void convertSpecularAtlas(VkCommandBuffer commandBuffer);
+	void reportSpecularAtlas();
+	double compareIBLMaps(VkPipeline pipeline, VkPipelineLayout pipelineLayout, VkDescriptorSet descriptorSet, VkSampler sampler,
+		const Texture& texture, const Texture& reference, const Resource<VkBuffer>& resultsBuffer, uint32_t numGroupsX, uint32_t numGroupsY) const;
+	double elapsedMilliseconds(VkQueryPool timestampQueryPool) const;
+
+	void drawScene(VkCommandBuffer commandBuffer, VkPipeline skyboxPipeline, VkPipeline pbrPipeline, VkDescriptorSet uniformsDescriptorSet, VkDescriptorSet skyboxDescriptorSet, VkDescriptorSet pbrDescriptorSet,
+		VkPipeline depthPipeline = VK_NULL_HANDLE) const;
+	void updateReflectionProbes(VkCommandBuffer commandBuffer, const SceneSettings& scene, const glm::mat4& sceneRotationMatrix, const ShadingUniforms& shadingUniforms,
+		VkDescriptorSet skyboxDescriptorSet, VkDescriptorSet pbrDescriptorSet, bool environmentChanged);
+	void filterReflectionProbe(VkCommandBuffer commandBuffer, int probe) const;
+	void updateIrradianceVolume(VkCommandBuffer commandBuffer, const SceneSettings& scene, const glm::mat4& sceneRotationMatrix, const ShadingUniforms& shadingUniforms,
+		VkDescriptorSet skyboxDescriptorSet, VkDescriptorSet pbrDescriptorSet, bool environmentChanged);
+	void updateDynamicLights(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, ShadingUniforms& shadingUniforms);
+	void updateShadows(VkCommandBuffer commandBuffer, const ViewSettings& view, const SceneSettings& scene, const glm::mat4& viewMatrix, const glm::mat4& sceneRotationMatrix);
+	void resolveTemporalAA(VkCommandBuffer commandBuffer) const;
+	void computeAutoExposure(VkCommandBuffer commandBuffer, const AutoExposure::Parameters& parameters) const;
+	void readbackSceneColor(VkCommandBuffer commandBuffer) const;
 
 	void presentFrame();
 
 	PhyDevice choosePhyDevice(VkSurfaceKHR surface, const VkPhysicalDeviceFeatures& requiredFeatures, const std::vector<const char*>& requiredExtensions) const;
+	static bool isExtensionSupported(const PhyDevice& phyDevice, const char* name);
 	void queryPhyDeviceSurfaceCapabilities(PhyDevice& phyDevice, VkSurfaceKHR surface) const;
 	bool checkPhyDeviceImageFormatsSupport(PhyDevice& phyDevice) const;
 	
 	uint32_t queryRenderTargetFormatMaxSamples(VkFormat format, VkImageUsageFlags usage) const;
 	uint32_t chooseMemoryType(const VkMemoryRequirements& memoryRequirements, VkMemoryPropertyFlags preferredFlags, VkMemoryPropertyFlags requiredFlags=0) const;
 	bool memoryTypeNeedsStaging(uint32_t memoryTypeIndex) const;
+	void updateMemoryBudget();
 
 #if _DEBUG
 	static VkBool32 logMessage(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objectType, uint64_t object, size_t location, int32_t messageCode, const char* pLayerPrefix, const char* pMessage, void* pUserData);
@@ -203,11 +302,25 @@ private:
 #endif
 
 	VkInstance m_instance;
+	// VK_KHR_get_physical_device_properties2 has been enabled (extended physical device feature & property queries).
+	bool m_physicalDeviceProperties2;
 	VkDevice m_device;
 	VkQueue m_queue;
 	PhyDevice m_phyDevice;
+	RendererSettings m_settings;
+
+	// Every device memory allocation, keyed by its VkDeviceMemory handle (heaps are indexed as in m_phyDevice.memory).
+	mutable MemoryStats m_memoryStats;
+	// VK_EXT_memory_budget has been enabled (driver reported heap usage & budget).
+	bool m_memoryBudgetSupported;
+	int m_memoryReportRequest;
+
+	// Scratch memory of the frame being recorded (reset at the start of render()).
+	FrameArena m_frameArena;
 
 	VkCommandPool m_commandPool;
+	// Timestamps around immediate command buffers recorded during startup (GPU time of startup phases, see StartupReport).
+	VkQueryPool m_immediateQueryPool;
 	VkDescriptorPool m_descriptorPool;
 
 	VkRenderPass m_renderPass;
@@ -262,6 +375,219 @@ private:
 	Texture m_envTexture;
 	Texture m_irmapTexture;
 	Texture m_spBRDF_LUT;
+
+	// Progressive IBL pre-processing & environment switching state.
+	IBLScheduler m_iblScheduler;
+	WorkgroupTuner m_workgroups;
+	struct {
+		VkSampler sampler = VK_NULL_HANDLE;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		VkDescriptorSet convertDescriptorSet = VK_NULL_HANDLE;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline equirectToCubePipeline = VK_NULL_HANDLE;
+		VkPipeline spmapPipeline = VK_NULL_HANDLE;
+		VkPipeline spmapTailPipeline = VK_NULL_HANDLE;
+		Resource<VkBuffer> sampleTableBuffer = {};
+		Resource<VkBuffer> distributionBuffer = {};
+		VkPipeline irmapPipeline = VK_NULL_HANDLE;
+		Texture envTextureEquirect = {};
+		Texture envTextureUnfiltered = {};
+		std::vector<VkImageView> envTextureMipTailViews;
+		VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+		std::vector<double> frameCost;
+		std::future<std::shared_ptr<Image>> pendingEnvironment;
+		std::future<std::shared_ptr<EnvironmentCache::Bake>> pendingBake;
+		std::future<void> bakeWriter;
+		int loadingEnvironment = -1;
+		int loadingBakeEnvironment = -1;
+		int environment = 0;
+		int blendFrames = 0;
+		uint32_t releaseFrameCount = 0;
+		// Resident pre-filtered maps: m_envTexture & m_irmapTexture alias current slot (-1 target means startup refinement of current slot).
+		EnvironmentCache cache;
+		std::vector<EnvironmentSlot> slots;
+		int currentSlot = 0;
+		int previousSlot = 0;
+		int targetSlot = -1;
+		// Per-frame descriptor sets referencing (current, previous) slots; updated only once their frame is no longer in flight.
+		std::vector<VkDescriptorSet> pbrDescriptorSets;
+		std::vector<VkDescriptorSet> skyboxDescriptorSets;
+		std::vector<std::pair<int, int>> boundSlots;
+		// Host visible buffers: staging buffers are released & readback buffer is saved once frames using them have completed.
+		std::vector<std::pair<Resource<VkBuffer>, uint32_t>> stagingBuffers;
+		Resource<VkBuffer> readbackBuffer = {};
+		uint32_t readbackFrameCount = 0;
+		int readbackEnvironment = -1;
+	} m_ibl;
+
+	// Runtime reflection probes: pre-filtered maps of all probes live in two cube map arrays sampled by pbr_fs
+	// (single texel placeholders if there are no probes), per-probe descriptor sets point compute shaders at their layers.
+	ProbeScheduler m_probeScheduler;
+	struct {
+		Texture specularTextures = {};
+		Texture irradianceTextures = {};
+		std::vector<VkImageView> layerViews;
+		std::vector<VkDescriptorSet> filterDescriptorSets;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		Resource<VkBuffer> sampleTableBuffer = {};
+		VkPipeline irmapPipeline = VK_NULL_HANDLE;
+		uint32_t tailLevel = 0;
+		float irradianceSourceLod = 0.0f;
+		// Unfiltered capture is rendered one face per frame by its own single sampled render pass.
+		Texture captureTexture = {};
+		RenderTarget captureDepthTarget = {};
+		std::vector<VkImageView> captureFaceViews;
+		std::vector<VkFramebuffer> captureFramebuffers;
+		VkRenderPass captureRenderPass = VK_NULL_HANDLE;
+		VkPipeline captureSkyboxPipeline = VK_NULL_HANDLE;
+		VkPipeline capturePbrPipeline = VK_NULL_HANDLE;
+		std::vector<UniformBufferAllocation> transformUniforms;
+		std::vector<UniformBufferAllocation> shadingUniforms;
+		std::vector<VkDescriptorSet> uniformsDescriptorSets;
+		// Environment slot seen by last capture (switching environments invalidates all probes).
+		int environmentSlot = 0;
+	} m_probes;
+
+	// Irradiance volume: SH probes of the whole grid live in a single 3D texture sampled by pbr_fs (single texel placeholder
+	// if the volume is disabled). Each frame a batch of probes is captured into layers of a cube map array & projected by
+	// one compute dispatch; every capture face has its own uniforms so that the whole batch is recorded at once.
+	IrradianceVolume m_irradianceVolume;
+	struct {
+		Texture texture = {};
+		Texture captureTexture = {};
+		RenderTarget captureDepthTarget = {};
+		std::vector<VkImageView> captureLayerViews;
+		std::vector<VkFramebuffer> captureFramebuffers;
+		VkRenderPass captureRenderPass = VK_NULL_HANDLE;
+		VkPipeline captureSkyboxPipeline = VK_NULL_HANDLE;
+		VkPipeline capturePbrPipeline = VK_NULL_HANDLE;
+		UniformBuffer uniformBuffer = {};
+		std::vector<UniformBufferAllocation> transformUniforms;
+		std::vector<UniformBufferAllocation> shadingUniforms;
+		std::vector<VkDescriptorSet> uniformsDescriptorSets;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		// Per-frame ranges of host visible probe grid coordinates buffer & compute descriptor sets referencing them.
+		Resource<VkBuffer> coordsBuffer = {};
+		VkDeviceSize coordsStride = 0;
+		void* coordsMemoryPtr = nullptr;
+		std::vector<VkDescriptorSet> projectDescriptorSets;
+		VkPipeline shprojectPipeline = VK_NULL_HANDLE;
+		float modelRadius = 0.0f;
+		// Environment slot seen by last capture (switching environments invalidates all probes).
+		int environmentSlot = 0;
+	} m_volume;
+
+	// Octahedral specular atlas (single texel placeholder if disabled, since skybox_fs & pbr_fs always bind it).
+	// Re-converted from current pre-filtered cube map whenever its contents change; conversion descriptor sets are per frame
+	// since the source cube map changes with environment slot.
+	struct {
+		Texture texture = {};
+		VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> convertDescriptorSets;
+		VkPipeline convertPipeline = VK_NULL_HANDLE;
+		bool dirty = false;
+	} m_atlas;
+
+	// Clustered dynamic lights: light records, froxel grid & light index list are written every frame into that frame's range
+	// of a host visible storage buffer (ranges are minimal if there are no lights, since pbr_fs always binds them).
+	ClusteredLights m_clusteredLights;
+	struct {
+		Resource<VkBuffer> buffer = {};
+		VkDeviceSize stride = 0;
+		VkDeviceSize lightsSize = 0;
+		VkDeviceSize gridOffset = 0;
+		VkDeviceSize gridSize = 0;
+		VkDeviceSize indexOffset = 0;
+		VkDeviceSize indexSize = 0;
+		void* memoryPtr = nullptr;
+		// Scene pass timestamps (only while benchmarking).
+		VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+		float modelRadius = 0.0f;
+	} m_lights;
+
+	// Cascaded shadow maps: all cascades live in layers of a single depth texture array (single texel placeholder if disabled,
+	// since pbr_fs always binds it), each layer has its own framebuffer. Dirty layers are rendered by a depth-only pass before
+	// anything samples them; render times are read back from per-frame ranges of timestamp queries once their frame completes.
+	ShadowCascades m_shadowCascades;
+	struct {
+		Texture texture = {};
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkSampler sampler = VK_NULL_HANDLE;
+		std::vector<VkImageView> layerViews;
+		std::vector<VkFramebuffer> framebuffers;
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+		std::vector<bool> pendingQueries;
+	} m_shadows;
+
+	// Depth pre-pass of the main view (captures always draw skybox first): depth-only pipeline renders the model's position stream,
+	// PBR pipeline variant shades with an equal depth test & skybox variant is drawn last with depth testing.
+	// Benchmark toggles it & records timestamps and fragment shader invocations around the scene pass.
+	struct {
+		bool enabled = false;
+		VkPipeline depthPipeline = VK_NULL_HANDLE;
+		VkPipeline pbrPipeline = VK_NULL_HANDLE;
+		VkPipeline skyboxPipeline = VK_NULL_HANDLE;
+		VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+		VkQueryPool statisticsQueryPool = VK_NULL_HANDLE;
+	} m_prepass;
+
+	// Half precision shading: PBR pipelines use the pbr_fs_fp16 module if the device supports fp16 shader arithmetic
+	// (VK_KHR_shader_float16_int8). Benchmark also creates a full precision pipeline, swaps between both, records timestamps
+	// around the scene pass & copies scene color of the last frame of each mode (stored by the main render pass) to a host buffer.
+	struct {
+		bool supported = false;
+		VkPipeline referencePipeline = VK_NULL_HANDLE;
+		VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+		Resource<VkBuffer> readbackBuffer = {};
+		bool readbackRequested = false;
+	} m_halfPrecision;
+
+	// Temporal anti-aliasing: main render pass stores color (resolved if multisampled) & depth, taa_cs then blends them with
+	// one history texture into the other (multisampled depth is first reduced by depthresolve_cs). Tone mapping runs in a render
+	// pass of its own, reading this frame's history texture as input attachment (framebuffer per swapchain image & history texture).
+	// GPU time of scene & anti-aliasing passes is read back from per-frame timestamp query pairs once their frame completes.
+	TemporalAA m_temporalAA;
+	struct {
+		Texture history[2] = {};
+		Texture depthTexture = {};
+		VkRenderPass tonemapRenderPass = VK_NULL_HANDLE;
+		std::vector<VkFramebuffer> tonemapFramebuffers;
+		std::vector<UniformBufferAllocation> uniforms;
+		std::vector<VkDescriptorSet> descriptorSets;
+		std::vector<VkDescriptorSet> depthResolveDescriptorSets;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout depthResolvePipelineLayout = VK_NULL_HANDLE;
+		VkPipeline depthResolvePipeline = VK_NULL_HANDLE;
+		VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+		std::vector<bool> pendingQueries;
+	} m_taa;
+
+	// Dynamic resolution: main pass pipelines take viewport & scissor as dynamic state & scene is drawn into the scaled part of
+	// the render target, which tone mapping then samples (instead of loading input attachment) & upscales. Driven by the same
+	// timestamp queries as anti-aliasing cost; number of samples is baked into pipelines & render pass, so only resolution scales.
+	DynamicResolution m_dynamicResolution;
+
+	// Automatic exposure: once the frame's last render pass ends histogram_cs bins its scene color (descriptor set per resolved
+	// render target, or per history texture with temporal anti-aliasing) & exposure_cs adapts exposure in a device local buffer,
+	// which tone mapping reads in the next frame (it is always bound & holds fixed exposure of 1.0 otherwise).
+	AutoExposure m_autoExposure;
+	struct {
+		Resource<VkBuffer> histogramBuffer = {};
+		Resource<VkBuffer> exposureBuffer = {};
+		std::vector<VkDescriptorSet> descriptorSets;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline histogramPipeline = VK_NULL_HANDLE;
+		VkPipeline exposurePipeline = VK_NULL_HANDLE;
+		VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+		std::vector<bool> pendingQueries;
+	} m_exposure;
 };
 
 } // Vulkan